@@ -5,7 +5,9 @@
  * - Per-device topics
  * - Status model (retained)
  * - MQTT Last Will (offline detection)
- * - Command handling (ping, sleep, ota=<url>)
+ * - Command handling (ping, sleep=<sec>, ota=<url>, reboot; optional ;req=<id>)
+ * - Adaptive sleep interval (awake cost, battery; sleep=<sec> pins it)
+ * - Energy account per wake cycle in the telemetry
  *
  * Copyright (c) 2026 Friedrich Riedhammer
  *
@@ -22,7 +24,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
-#include <ctype.h>
+#include <sys/time.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -32,14 +34,23 @@
 #include "esp_err.h"
 #include "esp_system.h"
 #include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
 
 #include "nvs_flash.h"
 #include "esp_event.h"
 #include "esp_netif.h"
-#include "esp_wifi.h"
 #include "esp_mac.h"
 
 #include "mqtt_client.h"
+#include "mqtt_ack.h"
+#include "mqtt_cmd.h"
+#include "ota_engine.h"
+#include "telem_tlv.h"
+#include "energy_acct.h"
+#include "net_conn.h"
+#include "wifi_fast.h"
+#include "sleep_sched.h"
 
 /* -------------------- USER CONFIG -------------------- */
 
@@ -49,49 +60,121 @@
 #define MQTT_BROKER_URI       "mqtt://test.mosquitto.org"
 
 /*
- * Default sleep time. Can be changed at runtime via MQTT command:
- *   sleep=60
+ * Sleep time after power-on. The scheduler (sleep_sched.h) takes it from
+ * there; a fixed value can be set at runtime via MQTT command:
+ *   sleep=60      pinned to 60 s (kept in RTC memory)
+ *   sleep=0       adaptive again
  */
 #define DEFAULT_SLEEP_SEC     30
 
+/*
+ * Adaptive interval: every wake costs about s_last_awake_ms at
+ * SCHED_AWAKE_MA, the average must stay below SCHED_BUDGET_UA - a slow
+ * Wi-Fi/broker makes the node sleep longer (2 s awake -> 32 s).
+ * No sensor in this project, so the signal rule is off (Project 20 feeds
+ * its reading in). SCHED_BUDGET_UA 0 = always DEFAULT_SLEEP_SEC.
+ */
+#define SCHED_MIN_SEC         10
+#define SCHED_MAX_SEC         900
+#define SCHED_AWAKE_MA        80      /* Wi-Fi + MQTT, measure your board */
+#define SCHED_SLEEP_UA        10
+#define SCHED_BUDGET_UA       5000
+
 /*
  * Firmware version string (book-style).
  * Increase this when building OTA binaries.
  */
 #define FW_VERSION            "1.0.0"
 
+/*
+ * Telemetry format: 1 = compact TLV on aiot/<id>/telemetry/bin
+ * (telem_tlv.h, decode with tools/telem_decode.py), 0 = key=value text
+ */
+#define TELEMETRY_BINARY      1
+
+/*
+ * Average current per power state of this board in uA (energy_acct.h).
+ * Every telemetry message carries the account up to the previous wake.
+ */
+#define ENERGY_BOARD          ENERGY_BOARD_ESP32S3_DEFAULT
+
 /* -------------------- INTERNAL -------------------- */
 
 static const char *TAG = "PROJECT21";
 
-/* Wi-Fi synchronization */
-static EventGroupHandle_t s_wifi_event_group;
-#define WIFI_CONNECTED_BIT    BIT0
-#define WIFI_FAIL_BIT         BIT1
+/* Wi-Fi bring-up (components/aiot_net) */
 #define WIFI_MAX_RETRY        10
-static int s_retry_count = 0;
+#define WIFI_BACKOFF_MAX_MS   4000
+#define WIFI_CONNECT_TIMEOUT_MS 15000
+
+/*
+ * Publish-ack tracking (components/aiot_mqtt):
+ * sleep as soon as the broker confirmed all QoS 1 messages. Commands are
+ * still accepted for CMD_WINDOW_MS after the MQTT connect.
+ */
+#define MQTT_ACK_TIMEOUT_MS   3000
+#define CMD_WINDOW_MS         800
+
+/* An OTA started by ota=<url> may keep the node awake this long */
+#define OTA_TIMEOUT_MS        300000
 
 /* MQTT synchronization */
 static EventGroupHandle_t s_mqtt_event_group;
 #define MQTT_CONNECTED_BIT    BIT0
 static esp_mqtt_client_handle_t s_mqtt_client = NULL;
+static int64_t s_mqtt_connected_us = 0;
 
 /* Device identity and topics */
 static char s_node_id[16];            // "AABBCCDDEEFF"
 static char s_t_status[64];           // aiot/<id>/status
 static char s_t_telemetry[64];        // aiot/<id>/telemetry
+static char s_t_telemetry_bin[72];    // aiot/<id>/telemetry/bin
 static char s_t_cmd[64];              // aiot/<id>/cmd
 static char s_t_event[64];            // aiot/<id>/event
 
-/* Runtime parameters */
-static int s_sleep_sec = DEFAULT_SLEEP_SEC;
+/* Runtime parameters: interval of the coming sleep (sleep_sched_update) */
+static uint32_t s_sleep_sec = DEFAULT_SLEEP_SEC;
+static bool s_sleep_planned = false;
+
+/* adaptive interval state and the sleep= pin (survives deep sleep) */
+static RTC_DATA_ATTR sleep_sched_t s_sched;
+
+static const sleep_sched_config_t s_sched_cfg = {
+    .min_s = SCHED_MIN_SEC,
+    .max_s = SCHED_MAX_SEC,
+    .start_s = DEFAULT_SLEEP_SEC,
+    .awake_ma = SCHED_BUDGET_UA ? SCHED_AWAKE_MA : 0,
+    .sleep_ua = SCHED_SLEEP_UA,
+    .budget_ua = SCHED_BUDGET_UA,
+};
 
 /* Command handling */
-static volatile bool s_cmd_ota_requested = false;
+static volatile bool s_cmd_reboot_requested = false;
 static char s_ota_url[256] = {0};
 
+/* awake time of the previous cycle (boot -> deep sleep), sent in telemetry */
+static RTC_DATA_ATTR uint32_t s_last_awake_ms = 0;
+
+/* charge per power state since power-on (survives deep sleep and restarts) */
+static RTC_DATA_ATTR energy_acct_t s_energy;
+static const energy_board_t s_board = ENERGY_BOARD;
+
 /* -------------------- Helpers -------------------- */
 
+/* clock that keeps running through deep sleep (energy account) */
+static int64_t wall_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+/* close the energy cycle before deep sleep or a restart */
+static void energy_cycle_end(void)
+{
+    energy_acct_end(&s_energy, &s_board, esp_timer_get_time(), wall_us());
+}
+
 static void generate_node_id(void)
 {
     uint8_t mac[6];
@@ -109,12 +192,13 @@ static void build_topics(void)
 {
     snprintf(s_t_status, sizeof(s_t_status),    "aiot/%s/status",    s_node_id);
     snprintf(s_t_telemetry, sizeof(s_t_telemetry),"aiot/%s/telemetry", s_node_id);
+    snprintf(s_t_telemetry_bin, sizeof(s_t_telemetry_bin), "%s/bin", s_t_telemetry);
     snprintf(s_t_cmd, sizeof(s_t_cmd),          "aiot/%s/cmd",       s_node_id);
     snprintf(s_t_event, sizeof(s_t_event),      "aiot/%s/event",     s_node_id);
 
     ESP_LOGI(TAG, "Topics:");
     ESP_LOGI(TAG, "  %s", s_t_status);
-    ESP_LOGI(TAG, "  %s", s_t_telemetry);
+    ESP_LOGI(TAG, "  %s", TELEMETRY_BINARY ? s_t_telemetry_bin : s_t_telemetry);
     ESP_LOGI(TAG, "  %s", s_t_cmd);
     ESP_LOGI(TAG, "  %s", s_t_event);
 }
@@ -149,7 +233,7 @@ static void publish_status_retained(const char *state, const char *extra_kv)
     ESP_LOGI(TAG, "STATUS: %s", msg);
 
     /* retain=1 so last known state is visible even after reconnect */
-    esp_mqtt_client_publish(s_mqtt_client, s_t_status, msg, 0, 1, 1);
+    mqtt_ack_publish(s_mqtt_client, s_t_status, msg, 0, 1, 1);
 }
 
 /* Publish non-retained event (short-lived) */
@@ -157,124 +241,103 @@ static void publish_event(const char *event_kv)
 {
     if (!event_kv) return;
     ESP_LOGI(TAG, "EVENT: %s", event_kv);
-    esp_mqtt_client_publish(s_mqtt_client, s_t_event, event_kv, 0, 1, 0);
+    mqtt_ack_publish(s_mqtt_client, s_t_event, event_kv, 0, 1, 0);
 }
 
 /* -------------------- Wi-Fi -------------------- */
 
-static void wifi_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
-{
-    (void)arg; (void)data;
-
-    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_START) {
-        ESP_LOGI(TAG, "Wi-Fi started, connecting...");
-        esp_wifi_connect();
-        return;
-    }
-
-    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
-        if (s_retry_count < WIFI_MAX_RETRY) {
-            s_retry_count++;
-            ESP_LOGW(TAG, "Wi-Fi disconnected. Retry %d/%d", s_retry_count, WIFI_MAX_RETRY);
-            esp_wifi_connect();
-        } else {
-            ESP_LOGE(TAG, "Wi-Fi failed");
-            xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
-        }
-        return;
-    }
-
-    if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
-        ip_event_got_ip_t *event = (ip_event_got_ip_t *)data;
-        ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
-        s_retry_count = 0;
-        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
-        return;
-    }
-}
-
 static void wifi_init_and_connect(void)
 {
-    s_wifi_event_group = xEventGroupCreate();
-
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    esp_netif_create_default_wifi_sta();
-
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(
-        WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL, NULL));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(
-        IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL, NULL));
-
-    wifi_config_t wifi_config = {0};
-    strncpy((char *)wifi_config.sta.ssid, WIFI_SSID, sizeof(wifi_config.sta.ssid));
-    strncpy((char *)wifi_config.sta.password, WIFI_PASS, sizeof(wifi_config.sta.password));
-
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
+    net_conn_config_t cfg = {
+        .ssid = WIFI_SSID,
+        .password = WIFI_PASS,
+        .max_retries = WIFI_MAX_RETRY,
+        .backoff_max_ms = WIFI_BACKOFF_MAX_MS,
+        .connect_timeout_ms = WIFI_CONNECT_TIMEOUT_MS,
+        .fast_reconnect = true,
+    };
+    ESP_ERROR_CHECK(net_conn_start(&cfg));
 }
 
 /* -------------------- Command parsing -------------------- */
 
-static void trim_spaces(char *s)
+/*
+ * Every command is one table entry (components/aiot_mqtt/mqtt_cmd.h).
+ * Name, argument type and bounds are checked before the handler runs;
+ * the payload is parsed in place, nothing is copied.
+ */
+
+static void cmd_ping(const mqtt_cmd_t *cmd, char *reply, size_t reply_len, void *ctx)
 {
-    if (!s) return;
-    /* left trim */
-    while (*s && isspace((unsigned char)*s)) s++;
+    (void)cmd; (void)ctx;
+    snprintf(reply, reply_len, "event=pong");
 }
 
-static void handle_cmd_payload(const char *payload, int len)
+/* sleep=<sec> pins the interval, sleep=0 hands it back to the scheduler */
+static void cmd_sleep(const mqtt_cmd_t *cmd, char *reply, size_t reply_len, void *ctx)
 {
-    /* Copy to a null-terminated buffer */
-    char buf[256];
-    int n = (len < (int)sizeof(buf) - 1) ? len : (int)sizeof(buf) - 1;
-    memcpy(buf, payload, n);
-    buf[n] = '\0';
+    (void)ctx;
+    sleep_sched_pin(&s_sched, (uint32_t)cmd->ival);
+    snprintf(reply, reply_len, "event=sleep_set;sec=%d;mode=%s",
+             cmd->ival, cmd->ival ? "pinned" : "auto");
+}
 
-    ESP_LOGI(TAG, "CMD payload: %s", buf);
+/*
+ * The OTA engine (components/aiot_ota) runs in its own task, so it can be
+ * started right here; the MQTT task is not blocked by the download.
+ * The main flow waits for it before going to sleep.
+ */
+static void cmd_ota(const mqtt_cmd_t *cmd, char *reply, size_t reply_len, void *ctx)
+{
+    (void)ctx;
 
-    /* ping */
-    if (strcmp(buf, "ping") == 0) {
-        publish_event("event=pong");
+    if (ota_engine_busy()) {
+        snprintf(reply, reply_len, "event=err;reason=ota_busy");
         return;
     }
+    memcpy(s_ota_url, cmd->str, cmd->str_len);
+    s_ota_url[cmd->str_len] = '\0';
 
-    /* sleep=<sec> */
-    if (strncmp(buf, "sleep=", 6) == 0) {
-        int sec = atoi(buf + 6);
-        if (sec >= 1 && sec <= 86400) {
-            s_sleep_sec = sec;
-            char msg[64];
-            snprintf(msg, sizeof(msg), "event=sleep_set;sec=%d", s_sleep_sec);
-            publish_event(msg);
-        } else {
-            publish_event("event=err;reason=bad_sleep_range");
-        }
+    ota_engine_config_t cfg = {
+        .url = s_ota_url,
+        .reboot = false,            /* main flow reports "done" first */
+        .resume = true,             /* a repeated ota= continues after a drop/reset */
+    };
+    esp_err_t err = ota_engine_start(&cfg);
+    if (err != ESP_OK) {
+        snprintf(reply, reply_len, "event=err;reason=ota_start;err=%s", esp_err_to_name(err));
         return;
     }
+    ESP_LOGW(TAG, "OTA requested via CMD. URL=%s", s_ota_url);
+    snprintf(reply, reply_len, "event=ota_requested");
+}
 
-    /*
-     * ota=<url>
-     * This project only sets a flag and stores the URL.
-     * The actual OTA procedure is performed in the main flow (safe context).
-     */
-    if (strncmp(buf, "ota=", 4) == 0) {
-        const char *url = buf + 4;
-        if (strlen(url) >= 8 && strlen(url) < sizeof(s_ota_url)) {
-            strncpy(s_ota_url, url, sizeof(s_ota_url));
-            s_cmd_ota_requested = true;
-            publish_event("event=ota_requested");
-        } else {
-            publish_event("event=err;reason=bad_ota_url");
-        }
-        return;
-    }
+/* restart after the command window instead of deep sleep */
+static void cmd_reboot(const mqtt_cmd_t *cmd, char *reply, size_t reply_len, void *ctx)
+{
+    (void)cmd; (void)ctx;
+    s_cmd_reboot_requested = true;
+    snprintf(reply, reply_len, "event=reboot_scheduled");
+}
 
-    publish_event("event=err;reason=unknown_cmd");
+static const mqtt_cmd_def_t s_cmds[] = {
+    { "ping",   MQTT_CMD_ARG_NONE, 0, 0,                      cmd_ping,   NULL },
+    { "sleep",  MQTT_CMD_ARG_INT,  0, 86400,                  cmd_sleep,  "bad_sleep_range" },
+    { "ota",    MQTT_CMD_ARG_STR,  8, sizeof(s_ota_url) - 1,  cmd_ota,    "bad_ota_url" },
+    { "reboot", MQTT_CMD_ARG_NONE, 0, 0,                      cmd_reboot, NULL },
+};
+
+static void cmd_reply(const char *reply, void *ctx)
+{
+    (void)ctx;
+    publish_event(reply);
+}
+
+static void handle_cmd_payload(const char *payload, int len)
+{
+    ESP_LOGI(TAG, "CMD payload: %.*s", len, payload);
+    mqtt_cmd_dispatch(s_cmds, sizeof(s_cmds) / sizeof(s_cmds[0]),
+                      payload, (size_t)len, cmd_reply, NULL);
 }
 
 /* -------------------- MQTT -------------------- */
@@ -285,9 +348,13 @@ static void mqtt_event_handler(void *args, esp_event_base_t base, int32_t id, vo
 
     esp_mqtt_event_handle_t e = (esp_mqtt_event_handle_t)data;
 
+    /* PUBACKs are matched against the pending publishes */
+    mqtt_ack_on_event(e);
+
     switch ((esp_mqtt_event_id_t)id) {
         case MQTT_EVENT_CONNECTED:
             ESP_LOGI(TAG, "MQTT connected");
+            s_mqtt_connected_us = esp_timer_get_time();
             xEventGroupSetBits(s_mqtt_event_group, MQTT_CONNECTED_BIT);
 
             /* subscribe to per-device command topic */
@@ -317,6 +384,7 @@ static void mqtt_event_handler(void *args, esp_event_base_t base, int32_t id, vo
 static void mqtt_start(void)
 {
     s_mqtt_event_group = xEventGroupCreate();
+    ESP_ERROR_CHECK(mqtt_ack_init());
 
     /*
      * Last Will & Testament (LWT):
@@ -342,33 +410,85 @@ static void mqtt_start(void)
     esp_mqtt_client_start(s_mqtt_client);
 }
 
-/* -------------------- Optional OTA hook -------------------- */
+/* -------------------- Deep sleep -------------------- */
+
 /*
- * For Project 21 we only show where OTA fits in.
- * The actual OTA implementation is Project 19.
- *
- * If you want to trigger OTA here:
- * - include Project 19's ota_http_update(url) function
- * - call it when s_cmd_ota_requested becomes true
- *
- * This keeps Project 21 readable while showing the integration point.
+ * Pick the next interval once per wake: after the command window (a sleep=
+ * in this wake counts), or on the way to sleep after a failed connect.
+ * The awake cost is the one of the previous, complete cycle.
  */
-static void ota_placeholder_run_if_requested(void)
+static void plan_sleep(void)
 {
-    if (!s_cmd_ota_requested) return;
+    if (s_sleep_planned) return;
+    s_sleep_planned = true;
 
-    publish_status_retained("ota", "stage=requested");
-    ESP_LOGW(TAG, "OTA requested via CMD. URL=%s", s_ota_url);
+    sleep_sched_input_t in = {
+        .awake_ms = s_last_awake_ms,    /* 0 after power-on: unknown */
+    };
+    s_sleep_sec = sleep_sched_update(&s_sched, &s_sched_cfg, &in);
+}
 
-    /*
-     * Integration point:
-     *  - call ota_http_update_with_url(s_ota_url);
-     *  - on success device restarts into new firmware
-     */
-    publish_event("event=ota_not_executed_in_project21");
+static void enter_deep_sleep(void)
+{
+    plan_sleep();
+    s_last_awake_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    energy_cycle_end();
+    ESP_LOGI(TAG, "Deep sleep for %lu seconds (%s, awake %lu ms)",
+             (unsigned long)s_sleep_sec, sleep_sched_limit_name(sleep_sched_limit(&s_sched)),
+             (unsigned long)s_last_awake_ms);
+    esp_sleep_enable_timer_wakeup((uint64_t)s_sleep_sec * 1000000ULL);
+    esp_deep_sleep_start();
+}
+
+/* -------------------- OTA -------------------- */
 
-    /* Clear flag so we don't spam */
-    s_cmd_ota_requested = false;
+/* Engine progress -> aiot/<id>/event (runs in the event loop task) */
+static void ota_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    (void)arg; (void)base;
+    const ota_progress_t *p = data;
+    char msg[256];
+
+    int n = snprintf(msg, sizeof(msg), "event=ota;stage=%s;bytes=%lu;total=%lu;kbps=%lu",
+                     ota_engine_stage_name(p->stage), (unsigned long)p->bytes,
+                     (unsigned long)p->total, (unsigned long)p->kbps);
+
+    if (id == OTA_ENGINE_EVENT_DONE || id == OTA_ENGINE_EVENT_FAILED) {
+        snprintf(msg + n, sizeof(msg) - n, ";ms=%lu;download_ms=%lu;flash_ms=%lu;stall_ms=%lu;"
+                 "rx=%lu;image=%lu;resumed=%lu;retries=%lu;err=%s",
+                 (unsigned long)p->elapsed_ms, (unsigned long)(p->download_us / 1000),
+                 (unsigned long)(p->flash_us / 1000), (unsigned long)(p->stall_us / 1000),
+                 (unsigned long)p->rx_bytes, (unsigned long)p->image_bytes,
+                 (unsigned long)p->resumed_from,
+                 (unsigned long)p->retries, esp_err_to_name(p->err));
+    }
+    publish_event(msg);
+}
+
+/*
+ * An update started by ota=<url> keeps the node awake (commands are still
+ * served). Success -> report and boot the new image.
+ */
+static void ota_wait_if_running(void)
+{
+    if (!ota_engine_busy()) return;
+
+    publish_status_retained("ota", "stage=running");
+
+    ota_progress_t res;
+    esp_err_t err = ota_engine_wait(pdMS_TO_TICKS(OTA_TIMEOUT_MS), &res);
+
+    if (err == ESP_OK) {
+        publish_status_retained("ota", "stage=done");
+        mqtt_ack_wait_all(pdMS_TO_TICKS(MQTT_ACK_TIMEOUT_MS));
+        ESP_LOGI(TAG, "OTA done -> reboot into new firmware");
+        energy_cycle_end();
+        esp_restart();
+    }
+
+    /* timeout: deep sleep stops the download, boot partition is untouched */
+    ESP_LOGE(TAG, "OTA failed: %s", esp_err_to_name(err));
+    publish_status_retained("ota", err == ESP_ERR_TIMEOUT ? "stage=timeout" : "stage=failed");
 }
 
 /* -------------------- Main flow -------------------- */
@@ -380,6 +500,10 @@ void app_main(void)
     ESP_LOGI(TAG, "Project 21 starting");
     ESP_LOGI(TAG, "Wakeup reason: %s", wakeup_reason_str(cause));
 
+    sleep_sched_init(&s_sched, &s_sched_cfg);
+    energy_acct_init(&s_energy);
+    energy_acct_begin(&s_energy, wall_us(), esp_timer_get_time());
+
     /* Device identity + topics */
     generate_node_id();
     build_topics();
@@ -395,22 +519,19 @@ void app_main(void)
 
     /* Connect Wi-Fi */
     publish_event("event=boot");
+    energy_acct_enter(&s_energy, ENERGY_RADIO_RX, esp_timer_get_time());
     wifi_init_and_connect();
 
-    EventBits_t wb = xEventGroupWaitBits(
-        s_wifi_event_group,
-        WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-        pdFALSE, pdFALSE,
-        portMAX_DELAY
-    );
-
-    if (!(wb & WIFI_CONNECTED_BIT)) {
+    /* returns at the latest after WIFI_CONNECT_TIMEOUT_MS */
+    if (net_conn_wait_ready(portMAX_DELAY) != ESP_OK) {
         ESP_LOGE(TAG, "Wi-Fi failed -> sleep");
         /* No MQTT possible, go to sleep */
-        esp_sleep_enable_timer_wakeup((uint64_t)s_sleep_sec * 1000000ULL);
-        esp_deep_sleep_start();
+        enter_deep_sleep();
     }
 
+    /* OTA progress -> event topic */
+    esp_event_handler_register(OTA_ENGINE_EVENT, ESP_EVENT_ANY_ID, ota_event_handler, NULL);
+
     /* Start MQTT */
     mqtt_start();
 
@@ -423,8 +544,9 @@ void app_main(void)
 
     if (!(mb & MQTT_CONNECTED_BIT)) {
         ESP_LOGE(TAG, "MQTT timeout -> sleep");
-        esp_sleep_enable_timer_wakeup((uint64_t)s_sleep_sec * 1000000ULL);
-        esp_deep_sleep_start();
+        /* cached address may be stale: full DHCP next wake */
+        wifi_fast_invalidate();
+        enter_deep_sleep();
     }
 
     /* Publish a short "wakeup" event and status */
@@ -433,27 +555,69 @@ void app_main(void)
     publish_status_retained("online", extra);
 
     /* --- Telemetry placeholder (Project 20 provides real sensor data) --- */
-    char telem[128];
-    snprintf(telem, sizeof(telem),
-             "id=%s;fw=%s;reason=%s",
-             s_node_id, FW_VERSION, wakeup_reason_str(cause));
+    energy_acct_enter(&s_energy, ENERGY_RADIO_TX, esp_timer_get_time());
+#if TELEMETRY_BINARY
+    uint8_t telem[128];
+    telem_tlv_writer_t w;
+    telem_tlv_begin(&w, telem, sizeof(telem));
+    telem_tlv_put_str(&w, TELEM_TLV_NODE_ID, s_node_id);
+    telem_tlv_put_str(&w, TELEM_TLV_FW_VERSION, FW_VERSION);
+    telem_tlv_put_uint(&w, TELEM_TLV_WAKE_REASON, (uint32_t)cause);
+    telem_tlv_put_uint(&w, TELEM_TLV_AWAKE_MS, s_last_awake_ms);
+    telem_tlv_put_energy(&w, &s_energy);
+
+    mqtt_ack_publish(s_mqtt_client, s_t_telemetry_bin,
+                     (const char *)telem, (int)telem_tlv_end(&w), 1, 0);
+#else
+    char telem[320];
+    int hdr = snprintf(telem, sizeof(telem),
+                       "id=%s;fw=%s;reason=%s;awake_ms=%lu;",
+                       s_node_id, FW_VERSION, wakeup_reason_str(cause),
+                       (unsigned long)s_last_awake_ms);
+    energy_acct_format(&s_energy, telem + hdr, sizeof(telem) - hdr);
+
+    mqtt_ack_publish(s_mqtt_client, s_t_telemetry, telem, 0, 1, 0);
+#endif
+
+    /* Wait for the PUBACKs, not for a fixed time; acked = one delivered sample */
+    if (mqtt_ack_wait_all(pdMS_TO_TICKS(MQTT_ACK_TIMEOUT_MS)) == ESP_OK) {
+        energy_acct_delivered(&s_energy, 1);
+    }
+    energy_acct_enter(&s_energy, ENERGY_RADIO_RX, esp_timer_get_time());
 
-    esp_mqtt_client_publish(s_mqtt_client, s_t_telemetry, telem, 0, 1, 0);
+    /* Command window counts from the MQTT connect, only the rest is waited */
+    int64_t window_left_ms = CMD_WINDOW_MS - (esp_timer_get_time() - s_mqtt_connected_us) / 1000;
+    if (window_left_ms > 0) {
+        vTaskDelay(pdMS_TO_TICKS(window_left_ms));
+    }
 
-    /* Allow a short window for commands (optional) */
-    vTaskDelay(pdMS_TO_TICKS(800));
+    /* OTA started by a command? wait for it */
+    ota_wait_if_running();
 
-    /* Check OTA request integration point */
-    ota_placeholder_run_if_requested();
+    /* reboot command: restart instead of deep sleep */
+    if (s_cmd_reboot_requested) {
+        publish_status_retained("reboot", NULL);
+        mqtt_ack_wait_all(pdMS_TO_TICKS(MQTT_ACK_TIMEOUT_MS));
+        ESP_LOGW(TAG, "Reboot requested via CMD");
+        energy_cycle_end();
+        esp_restart();
+    }
 
-    /* Going to sleep -> retained status update */
+    /* Going to sleep -> retained status update (interval and the rule behind it) */
+    plan_sleep();
     char sleep_info[64];
-    snprintf(sleep_info, sizeof(sleep_info), "next=%d", s_sleep_sec);
+    snprintf(sleep_info, sizeof(sleep_info), "next=%lu;sched=%s;awake_avg_ms=%lu",
+             (unsigned long)s_sleep_sec, sleep_sched_limit_name(sleep_sched_limit(&s_sched)),
+             (unsigned long)s_sched.awake_ms);
     publish_status_retained("sleep", sleep_info);
 
-    vTaskDelay(pdMS_TO_TICKS(200));
+    /* also covers events published by command handlers in the window */
+    if (mqtt_ack_wait_all(pdMS_TO_TICKS(MQTT_ACK_TIMEOUT_MS)) == ESP_OK) {
+        mqtt_ack_stats_t st;
+        mqtt_ack_get_stats(&st);
+        ESP_LOGI(TAG, "%lu message(s) acked, slowest %lu ms",
+                 (unsigned long)st.acked, (unsigned long)(st.max_ack_us / 1000));
+    }
 
-    ESP_LOGI(TAG, "Deep sleep for %d seconds", s_sleep_sec);
-    esp_sleep_enable_timer_wakeup((uint64_t)s_sleep_sec * 1000000ULL);
-    esp_deep_sleep_start();
+    enter_deep_sleep();
 }
@@ -0,0 +1,237 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Project 20: Final Node – ADC session (created once per boot)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_adc/adc_cali.h"
+#include "esp_adc/adc_cali_scheme.h"
+
+#include "adc_stream.h"
+#include "adc_session.h"
+
+static const char *TAG = "ADC_SESSION";
+
+#define ADC_SESSION_TIMEOUT_MS   100
+
+/*
+ * raw -> mV table, sampled from the IDF calibration scheme.
+ * 33 points (every 128 LSB of the 12 bit range) + linear interpolation.
+ * The ADC curve is smooth, so the error stays below 1 mV.
+ */
+#define CALI_TABLE_STEP_SHIFT    7
+#define CALI_TABLE_POINTS        ((4096 >> CALI_TABLE_STEP_SHIFT) + 1)
+#define CALI_TABLE_MAGIC         0xCA11AD01u
+
+typedef struct {
+    uint32_t magic;
+    uint8_t  unit;
+    uint8_t  atten;
+    int16_t  mv[CALI_TABLE_POINTS];
+} cali_table_t;
+
+/* survives deep sleep, cleared on power-on */
+static RTC_DATA_ATTR cali_table_t s_cali_table;
+
+static adc_session_config_t s_cfg;
+static adc_stream_handle_t  s_stream = NULL;
+static QueueHandle_t        s_results = NULL;
+static bool                 s_cali_ok = false;
+static bool                 s_cali_from_rtc = false;
+
+/* --------------------------------------------------------------------------
+ * Calibration (only on cold boot)
+ * -------------------------------------------------------------------------- */
+
+static bool adc_create_calibration(adc_unit_t unit, adc_atten_t atten, adc_cali_handle_t *out_handle)
+{
+    adc_cali_handle_t handle = NULL;
+    esp_err_t ret;
+
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_curve_fitting_config_t cali_config = {
+        .unit_id = unit,
+        .atten = atten,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    ret = adc_cali_create_scheme_curve_fitting(&cali_config, &handle);
+    if (ret == ESP_OK) {
+        *out_handle = handle;
+        return true;
+    }
+#endif
+
+#if ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    adc_cali_line_fitting_config_t cali_config = {
+        .unit_id = unit,
+        .atten = atten,
+        .bitwidth = ADC_BITWIDTH_12,
+    };
+    ret = adc_cali_create_scheme_line_fitting(&cali_config, &handle);
+    if (ret == ESP_OK) {
+        *out_handle = handle;
+        return true;
+    }
+#endif
+
+    return false;
+}
+
+static void adc_delete_calibration(adc_cali_handle_t handle)
+{
+#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
+    adc_cali_delete_scheme_curve_fitting(handle);
+#elif ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
+    adc_cali_delete_scheme_line_fitting(handle);
+#endif
+}
+
+static bool cali_table_valid(void)
+{
+    return s_cali_table.magic == CALI_TABLE_MAGIC &&
+           s_cali_table.unit == (uint8_t)s_cfg.unit &&
+           s_cali_table.atten == (uint8_t)s_cfg.atten;
+}
+
+static bool cali_table_build(void)
+{
+    adc_cali_handle_t handle = NULL;
+    if (!adc_create_calibration(s_cfg.unit, s_cfg.atten, &handle)) {
+        return false;
+    }
+
+    for (int i = 0; i < CALI_TABLE_POINTS; i++) {
+        int raw = i << CALI_TABLE_STEP_SHIFT;
+        int mv = 0;
+        if (raw > 4095) raw = 4095;
+        if (adc_cali_raw_to_voltage(handle, raw, &mv) != ESP_OK) {
+            adc_delete_calibration(handle);
+            return false;
+        }
+        s_cali_table.mv[i] = (int16_t)mv;
+    }
+
+    /* handle is no longer needed: the table is all we keep */
+    adc_delete_calibration(handle);
+
+    s_cali_table.unit = (uint8_t)s_cfg.unit;
+    s_cali_table.atten = (uint8_t)s_cfg.atten;
+    s_cali_table.magic = CALI_TABLE_MAGIC;
+    return true;
+}
+
+static int cali_table_convert(int raw)
+{
+    if (raw < 0) raw = 0;
+    if (raw > 4095) raw = 4095;
+
+    int idx = raw >> CALI_TABLE_STEP_SHIFT;
+    int frac = raw & ((1 << CALI_TABLE_STEP_SHIFT) - 1);
+    int y0 = s_cali_table.mv[idx];
+    int y1 = s_cali_table.mv[idx + 1];
+
+    return y0 + (((y1 - y0) * frac) >> CALI_TABLE_STEP_SHIFT);
+}
+
+/* --------------------------------------------------------------------------
+ * Public API
+ * -------------------------------------------------------------------------- */
+
+esp_err_t adc_session_init(const adc_session_config_t *cfg)
+{
+    if (s_stream) {
+        return ESP_OK;
+    }
+    if (!cfg) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_cfg = *cfg;
+
+    /* calibration: reuse RTC table after a deep-sleep wake */
+    if (cali_table_valid()) {
+        s_cali_ok = true;
+        s_cali_from_rtc = true;
+    } else {
+        s_cali_ok = cali_table_build();
+        s_cali_from_rtc = false;
+    }
+    ESP_LOGI(TAG, "Calibration: %s",
+             !s_cali_ok ? "not available" : (s_cali_from_rtc ? "RTC cache" : "created"));
+
+    s_results = xQueueCreate(1, sizeof(adc_stream_result_t));
+    if (!s_results) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    adc_stream_config_t stream_cfg = {
+        .unit = s_cfg.unit,
+        .channel = s_cfg.channel,
+        .atten = s_cfg.atten,
+        .sample_freq_hz = s_cfg.sample_freq_hz,
+        .frame_samples = s_cfg.samples,
+        .cali = NULL,               /* conversion is done via the RTC table */
+        .result_queue = s_results,
+    };
+
+    esp_err_t err = adc_stream_new(&stream_cfg, &s_stream);
+    if (err != ESP_OK) {
+        vQueueDelete(s_results);
+        s_results = NULL;
+        s_stream = NULL;
+    }
+    return err;
+}
+
+esp_err_t adc_session_read(int *out_raw, int *out_mv)
+{
+    if (!s_stream) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xQueueReset(s_results);
+
+    esp_err_t err = adc_stream_start(s_stream);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    /* CPU blocks here (idle) while the DMA collects the frame */
+    adc_stream_result_t r;
+    bool got = (xQueueReceive(s_results, &r, pdMS_TO_TICKS(ADC_SESSION_TIMEOUT_MS)) == pdTRUE);
+
+    adc_stream_stop(s_stream);
+
+    if (!got) {
+        ESP_LOGW(TAG, "ADC stream timeout");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    if (out_raw) *out_raw = r.raw_avg;
+    if (out_mv)  *out_mv = s_cali_ok ? cali_table_convert(r.raw_avg) : -1;
+    return ESP_OK;
+}
+
+bool adc_session_cali_from_rtc(void)
+{
+    return s_cali_from_rtc;
+}
+
+void adc_session_deinit(void)
+{
+    if (s_stream) {
+        adc_stream_delete(s_stream);
+        s_stream = NULL;
+    }
+    if (s_results) {
+        vQueueDelete(s_results);
+        s_results = NULL;
+    }
+}
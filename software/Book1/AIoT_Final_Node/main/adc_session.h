@@ -0,0 +1,47 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Project 20: Final Node – ADC session (created once per boot)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ ******************************************************************************/
+
+/*
+ * The ADC session bundles everything a reader needs:
+ *  - the continuous ADC stream (components/aiot_adc_stream)
+ *  - a raw -> mV conversion table
+ *
+ * It is created once per boot and shared by every reader. The conversion
+ * table is derived from the IDF calibration scheme on the first (cold) boot
+ * and kept in RTC memory, so a timer wake converts raw values without
+ * running the curve-fitting setup again.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+
+#include "esp_err.h"
+#include "esp_adc/adc_continuous.h"
+
+typedef struct {
+    adc_unit_t    unit;
+    adc_channel_t channel;
+    adc_atten_t   atten;
+    uint32_t      sample_freq_hz;
+    uint32_t      samples;          /* averaging window per reading */
+} adc_session_config_t;
+
+/* Create the session. Safe to call more than once (only the first call acts). */
+esp_err_t adc_session_init(const adc_session_config_t *cfg);
+
+/*
+ * Take one averaged reading.
+ * *out_mv is -1 if no calibration is available for this chip/eFuse.
+ */
+esp_err_t adc_session_read(int *out_raw, int *out_mv);
+
+/* true if the conversion table came from RTC memory (no cali setup this boot) */
+bool adc_session_cali_from_rtc(void);
+
+/* Release stream and queue (call before deep sleep). RTC table is kept. */
+void adc_session_deinit(void);
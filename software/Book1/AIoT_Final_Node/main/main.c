@@ -8,27 +8,38 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/queue.h"
 
 #include "esp_log.h"
 #include "esp_err.h"
 #include "esp_system.h"
 #include "esp_sleep.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
 
 #include "nvs_flash.h"
 #include "esp_event.h"
 #include "esp_netif.h"
-#include "esp_wifi.h"
 
 #include "mqtt_client.h"
+#include "mqtt_ack.h"
+#include "telem_batch.h"
+#include "telem_tlv.h"
+#include "phase_timing.h"
+#include "energy_acct.h"
+#include "net_conn.h"
+#include "wifi_fast.h"
+#include "wake_stub.h"
+#include "sleep_sched.h"
 
 /* ---- ADC (Project 15) ---- */
-#include "esp_adc/adc_oneshot.h"
-#include "esp_adc/adc_cali.h"
-#include "esp_adc/adc_cali_scheme.h"
+#include "adc_session.h"
 
 /* --------------------------------------------------------------------------
  * USER CONFIG
@@ -43,28 +54,87 @@
 #define TOPIC_TELEMETRY     "aiot/node1/telemetry"
 #define TOPIC_STATUS        "aiot/node1/status"
 #define TOPIC_CMD           "aiot/node1/cmd"
+#define TOPIC_TELEMETRY_BIN "aiot/node1/telemetry/bin"
 
 #define WIFI_MAX_RETRY      10
-#define SLEEP_TIME_SEC      30
+#define WIFI_BACKOFF_MAX_MS 4000
+#define WIFI_CONNECT_TIMEOUT_MS 15000
+#define SLEEP_TIME_SEC      30      /* fixed, or the start of the adaptive interval */
+#define MQTT_ACK_TIMEOUT_MS 3000    /* give up waiting for PUBACK after this */
+
+/*
+ * Telemetry batching: the radio is only switched on every BATCH_EVERY_N_WAKES
+ * wakes (or when BATCH_FLUSH_THRESHOLD samples are buffered). In between,
+ * the sample goes to RTC memory. BATCH_EVERY_N_WAKES 1 = send every wake.
+ */
+#define BATCH_EVERY_N_WAKES     10
+#define BATCH_FLUSH_THRESHOLD   48      /* of TELEM_BATCH_CAPACITY */
+
+/*
+ * 1 = compact TLV on TOPIC_TELEMETRY_BIN (see telem_tlv.h, decode with
+ *     tools/telem_decode.py), 0 = key=value text on TOPIC_TELEMETRY
+ */
+#define TELEMETRY_BINARY        1
+
+/*
+ * Boot-to-sleep phase statistics (phase_timing.h) go along with the first
+ * telemetry message once PHASE_REPORT_EVERY_N wakes were recorded since
+ * the last report. 0 = never send them (still logged on radio wakes).
+ */
+#define PHASE_REPORT_EVERY_N    60
+
+/*
+ * Energy account (energy_acct.h): time per power state x this current
+ * table, summed in RTC memory. Goes along with the first telemetry message
+ * of every radio wake. Measure your board and put the averages here (uA).
+ */
+#define ENERGY_BOARD            ENERGY_BOARD_ESP32S3_DEFAULT
+
+/*
+ * Wake stub (wake_stub.h): a timer wake reads the ADC before the bootloader
+ * and goes straight back to sleep unless the reading moved by
+ * WAKE_STUB_DELTA_RAW counts or WAKE_STUB_HEARTBEAT wakes went by. Skipped
+ * wakes store no sample, so BATCH_EVERY_N_WAKES counts boots, not wakes.
+ * 0 = boot on every wake.
+ */
+#define WAKE_STUB_ENABLE        1
+#define WAKE_STUB_DELTA_RAW     25      /* ~20 mV at 12 dB */
+#define WAKE_STUB_HEARTBEAT     10      /* boot at least every 10th wake */
+
+/*
+ * Adaptive sleep interval (sleep_sched.h): longer while the reading stays
+ * within SCHED_CHANGE_MV, shorter when it moves; never so short that the
+ * measured awake time breaks SCHED_BUDGET_UA, stretched on a low battery.
+ * The choice goes out in the retained status on every radio wake.
+ * 0 = fixed SLEEP_TIME_SEC.
+ */
+#define SCHED_ENABLE            1
+#define SCHED_MIN_SEC           10
+#define SCHED_MAX_SEC           900
+#define SCHED_CHANGE_MV         20      /* change allowed between two wakes */
+#define SCHED_AWAKE_MA          40      /* average awake current, measure your board */
+#define SCHED_SLEEP_UA          10
+#define SCHED_BUDGET_UA         500     /* 0 = no cost rule */
+#define SCHED_BATT_OK_MV        3700
+#define SCHED_BATT_LOW_MV       3400
+
+/*
+ * Battery voltage for the scheduler: LiPo via a 1:BATTERY_DIVIDER divider on
+ * an ADC1 pin. The book board runs from USB -> 0 (no battery rule).
+ */
+#define BATTERY_ADC_ENABLE      0
+#define BATTERY_ADC_CHANNEL     ADC_CHANNEL_2   /* GPIO3 */
+#define BATTERY_DIVIDER         2
 
 /* ADC fixed for this book: ADC1 on GPIO2 */
 #define ADC_UNIT_USED       ADC_UNIT_1
 #define ADC_CHANNEL_USED    ADC_CHANNEL_1
 #define ADC_ATTEN           ADC_ATTEN_DB_11
-#define ADC_BITWIDTH        ADC_BITWIDTH_DEFAULT
 #define ADC_SAMPLES         64
+#define ADC_SAMPLE_FREQ_HZ  20000
 
 static const char *TAG = "PROJECT20";
 
-/* --------------------------------------------------------------------------
- * Wi-Fi sync
- * -------------------------------------------------------------------------- */
-
-static EventGroupHandle_t s_wifi_event_group;
-#define WIFI_CONNECTED_BIT  BIT0
-#define WIFI_FAIL_BIT       BIT1
-static int s_retry_count = 0;
-
 /* --------------------------------------------------------------------------
  * MQTT sync
  * -------------------------------------------------------------------------- */
@@ -73,80 +143,37 @@ static EventGroupHandle_t s_mqtt_event_group;
 #define MQTT_CONNECTED_BIT  BIT0
 static esp_mqtt_client_handle_t s_mqtt_client = NULL;
 
-/* --------------------------------------------------------------------------
- * ADC calibration
- * -------------------------------------------------------------------------- */
+/* awake time of the previous cycle (boot -> deep sleep), sent in telemetry */
+static RTC_DATA_ATTR uint32_t s_last_awake_ms = 0;
 
-static bool adc_create_calibration(adc_unit_t unit, adc_atten_t atten, adc_cali_handle_t *out_handle)
-{
-    adc_cali_handle_t handle = NULL;
-    esp_err_t ret;
-
-#if ADC_CALI_SCHEME_CURVE_FITTING_SUPPORTED
-    adc_cali_curve_fitting_config_t cali_config = {
-        .unit_id = unit,
-        .atten = atten,
-        .bitwidth = ADC_BITWIDTH,
-    };
-    ret = adc_cali_create_scheme_curve_fitting(&cali_config, &handle);
-    if (ret == ESP_OK) {
-        *out_handle = handle;
-        return true;
-    }
-#endif
+/* samples not yet delivered (survives deep sleep, see telem_batch.h) */
+static RTC_DATA_ATTR telem_batch_t s_batch;
 
-#if ADC_CALI_SCHEME_LINE_FITTING_SUPPORTED
-    adc_cali_line_fitting_config_t cali_config = {
-        .unit_id = unit,
-        .atten = atten,
-        .bitwidth = ADC_BITWIDTH,
-    };
-    ret = adc_cali_create_scheme_line_fitting(&cali_config, &handle);
-    if (ret == ESP_OK) {
-        *out_handle = handle;
-        return true;
-    }
-#endif
+/* where the awake time goes, per phase (survives deep sleep) */
+static RTC_DATA_ATTR phase_timing_t s_phases;
+static bool s_radio_wake = false;
 
-    return false;
-}
+/* charge per power state since power-on (survives deep sleep) */
+static RTC_DATA_ATTR energy_acct_t s_energy;
+static const energy_board_t s_board = ENERGY_BOARD;
 
-/* --------------------------------------------------------------------------
- * Wi-Fi event handler
- * -------------------------------------------------------------------------- */
+/* interval of the coming sleep; the scheduler state survives deep sleep */
+static RTC_DATA_ATTR sleep_sched_t s_sched;
+static uint32_t s_sleep_sec = SLEEP_TIME_SEC;
 
-static void wifi_event_handler(void *arg,
-                               esp_event_base_t event_base,
-                               int32_t event_id,
-                               void *event_data)
-{
-    (void)arg;
-
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
-        return;
-    }
+static const sleep_sched_config_t s_sched_cfg = {
+    .min_s = SCHED_MIN_SEC,
+    .max_s = SCHED_MAX_SEC,
+    .start_s = SLEEP_TIME_SEC,
+    .change = SCHED_CHANGE_MV,
+    .awake_ma = SCHED_BUDGET_UA ? SCHED_AWAKE_MA : 0,
+    .sleep_ua = SCHED_SLEEP_UA,
+    .budget_ua = SCHED_BUDGET_UA,
+    .batt_ok_mv = SCHED_BATT_OK_MV,
+    .batt_low_mv = SCHED_BATT_LOW_MV,
+};
 
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        if (s_retry_count < WIFI_MAX_RETRY) {
-            s_retry_count++;
-            ESP_LOGW(TAG, "Wi-Fi disconnected. Retry %d/%d", s_retry_count, WIFI_MAX_RETRY);
-            esp_wifi_connect();
-        } else {
-            ESP_LOGE(TAG, "Wi-Fi failed");
-            xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
-        }
-        return;
-    }
-
-    if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
-        ESP_LOGI(TAG, "Wi-Fi got IP: " IPSTR, IP2STR(&event->ip_info.ip));
-        s_retry_count = 0;
-        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
-        return;
-    }
-}
+static char s_payload[1280];
 
 /* --------------------------------------------------------------------------
  * MQTT event handler
@@ -162,6 +189,9 @@ static void mqtt_event_handler(void *handler_args,
 
     esp_mqtt_event_handle_t event = event_data;
 
+    /* PUBACKs are matched against the pending publishes */
+    mqtt_ack_on_event(event);
+
     switch ((esp_mqtt_event_id_t)event_id)
     {
         case MQTT_EVENT_CONNECTED:
@@ -183,32 +213,20 @@ static void mqtt_event_handler(void *handler_args,
 }
 
 /* --------------------------------------------------------------------------
- * Init Wi-Fi
+ * Init Wi-Fi (components/aiot_net: backoff, deadline, RTC fast reconnect)
  * -------------------------------------------------------------------------- */
 
 static void wifi_init_and_connect(void)
 {
-    s_wifi_event_group = xEventGroupCreate();
-
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-    esp_netif_create_default_wifi_sta();
-
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(
-        WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL, NULL));
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(
-        IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL, NULL));
-
-    wifi_config_t wifi_config = {0};
-    strncpy((char *)wifi_config.sta.ssid, WIFI_SSID, sizeof(wifi_config.sta.ssid));
-    strncpy((char *)wifi_config.sta.password, WIFI_PASS, sizeof(wifi_config.sta.password));
-
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
+    net_conn_config_t cfg = {
+        .ssid = WIFI_SSID,
+        .password = WIFI_PASS,
+        .max_retries = WIFI_MAX_RETRY,
+        .backoff_max_ms = WIFI_BACKOFF_MAX_MS,
+        .connect_timeout_ms = WIFI_CONNECT_TIMEOUT_MS,
+        .fast_reconnect = true,
+    };
+    ESP_ERROR_CHECK(net_conn_start(&cfg));
 }
 
 /* --------------------------------------------------------------------------
@@ -218,6 +236,7 @@ static void wifi_init_and_connect(void)
 static void mqtt_start(void)
 {
     s_mqtt_event_group = xEventGroupCreate();
+    ESP_ERROR_CHECK(mqtt_ack_init());
 
     esp_mqtt_client_config_t mqtt_cfg = {
         .broker.address.uri = MQTT_BROKER_URI,
@@ -234,42 +253,284 @@ static void mqtt_start(void)
 }
 
 /* --------------------------------------------------------------------------
- * Read ADC (returns mV if calibration available, else raw as negative marker)
+ * Read ADC (*out_mv = -1 if no calibration is available, *out_raw always)
  * -------------------------------------------------------------------------- */
 
-static int read_adc_mv(void)
+static esp_err_t read_adc(int *out_mv, int *out_raw)
 {
-    adc_oneshot_unit_handle_t adc_handle;
-    adc_oneshot_unit_init_cfg_t init_config = {
-        .unit_id = ADC_UNIT_USED,
+    /* session is created once per boot and shared by every reader */
+    adc_session_config_t cfg = {
+        .unit = ADC_UNIT_USED,
+        .channel = ADC_CHANNEL_USED,
+        .atten = ADC_ATTEN,
+        .sample_freq_hz = ADC_SAMPLE_FREQ_HZ,
+        .samples = ADC_SAMPLES,
+    };
+    esp_err_t err = adc_session_init(&cfg);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ADC session init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    *out_mv = -1;
+    *out_raw = 0;
+    err = adc_session_read(out_raw, out_mv);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ADC read failed: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+/* --------------------------------------------------------------------------
+ * Sample -> RTC batch
+ * -------------------------------------------------------------------------- */
+
+/*
+ * The stored value (mV, or raw without calibration) also goes to the
+ * scheduler. On a read error nothing is stored and false is returned.
+ */
+static bool sample_to_batch(int *out_value)
+{
+    int mv = -1;
+    int raw = 0;
+    if (read_adc(&mv, &raw) != ESP_OK) {
+        return false;
+    }
+
+    bool is_raw = mv < 0;
+    telem_sample_t s = {
+        .t_s = (uint32_t)time(NULL),    /* device clock keeps running in deep sleep */
+        .value = (uint16_t)(is_raw ? raw : mv),
+        .flags = is_raw ? TELEM_SAMPLE_RAW : 0,
     };
-    ESP_ERROR_CHECK(adc_oneshot_new_unit(&init_config, &adc_handle));
+    telem_batch_push(&s_batch, &s);
+
+    ESP_LOGI(TAG, "Sample %s=%u stored (%u buffered, %lu wakes)",
+             is_raw ? "adc_raw" : "adc_mv", (unsigned)s.value,
+             (unsigned)s_batch.count, (unsigned long)s_batch.wakes);
+    *out_value = s.value;
+    return true;
+}
+
+/* --------------------------------------------------------------------------
+ * Next sleep interval (sleep_sched.h)
+ * -------------------------------------------------------------------------- */
 
-    adc_oneshot_chan_cfg_t chan_config = {
+/* 0 = no battery input */
+static uint32_t read_battery_mv(void)
+{
+#if BATTERY_ADC_ENABLE
+    /* second session on the same unit/attenuation: calibration is shared */
+    adc_session_config_t cfg = {
+        .unit = ADC_UNIT_USED,
+        .channel = BATTERY_ADC_CHANNEL,
         .atten = ADC_ATTEN,
-        .bitwidth = ADC_BITWIDTH
+        .sample_freq_hz = ADC_SAMPLE_FREQ_HZ,
+        .samples = ADC_SAMPLES,
     };
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc_handle, ADC_CHANNEL_USED, &chan_config));
+    int raw = 0;
+    int mv = -1;
+    bool ok = adc_session_init(&cfg) == ESP_OK && adc_session_read(&raw, &mv) == ESP_OK;
+    adc_session_deinit();
+    return (ok && mv > 0) ? (uint32_t)mv * BATTERY_DIVIDER : 0;
+#else
+    return 0;
+#endif
+}
+
+/* after the sample, before any radio: the decision is known on every path */
+static void plan_sleep(bool has_value, int value)
+{
+#if SCHED_ENABLE
+    sleep_sched_input_t in = {
+        .now_s = (uint32_t)time(NULL),
+        .has_value = has_value,
+        .value = value,
+        .awake_ms = s_last_awake_ms,    /* previous cycle, 0 after power-on */
+        .batt_mv = read_battery_mv(),
+    };
+    s_sleep_sec = sleep_sched_update(&s_sched, &s_sched_cfg, &in);
+    ESP_LOGI(TAG, "Next sleep %lu s (%s)", (unsigned long)s_sleep_sec,
+             sleep_sched_limit_name(sleep_sched_limit(&s_sched)));
+#else
+    (void)has_value;
+    (void)value;
+#endif
+}
 
-    adc_cali_handle_t cali_handle = NULL;
-    bool cali_ok = adc_create_calibration(ADC_UNIT_USED, ADC_ATTEN, &cali_handle);
+/* retained, acked together with the first batch message */
+static void publish_status_sleep(void)
+{
+    char msg[128];
+    snprintf(msg, sizeof(msg), "state=sleep;id=%s;next=%lu;sched=%s;awake_avg_ms=%lu",
+             NODE_ID, (unsigned long)s_sleep_sec,
+             SCHED_ENABLE ? sleep_sched_limit_name(sleep_sched_limit(&s_sched)) : "fixed",
+             (unsigned long)s_sched.awake_ms);
+    mqtt_ack_publish(s_mqtt_client, TOPIC_STATUS, msg, 0, 1, 1);
+}
 
-    int sum = 0;
-    for (int i = 0; i < ADC_SAMPLES; i++) {
-        int raw = 0;
-        ESP_ERROR_CHECK(adc_oneshot_read(adc_handle, ADC_CHANNEL_USED, &raw));
-        sum += raw;
+/*
+ * One message with the oldest buffered samples into s_payload.
+ * Returns the number of samples in it, *len = message length.
+ */
+static uint16_t encode_batch_message(esp_sleep_wakeup_cause_t cause, bool with_phases,
+                                     bool with_energy, int *len)
+{
+    uint32_t now_s = (uint32_t)time(NULL);
+
+#if TELEMETRY_BINARY
+    telem_tlv_writer_t w;
+    telem_tlv_begin(&w, (uint8_t *)s_payload, sizeof(s_payload));
+    telem_tlv_put_str(&w, TELEM_TLV_NODE_ID, NODE_ID);
+    telem_tlv_put_uint(&w, TELEM_TLV_WAKE_REASON, (uint32_t)cause);
+    telem_tlv_put_uint(&w, TELEM_TLV_AWAKE_MS, s_last_awake_ms);
+    if (with_phases) {
+        telem_tlv_put_phases(&w, &s_phases);
+    }
+    if (with_energy) {
+        telem_tlv_put_energy(&w, &s_energy);
     }
-    int raw_avg = sum / ADC_SAMPLES;
+    uint16_t n = telem_tlv_put_batch(&w, &s_batch, now_s);
+
+    *len = (int)telem_tlv_end(&w);
+    ESP_LOGI(TAG, "Telemetry payload (%u samples): %d bytes TLV", (unsigned)n, *len);
+    return *len ? n : 0;
+#else
+    int hdr = snprintf(s_payload, sizeof(s_payload), "wakeup=%d;awake_ms=%lu;",
+                       (int)cause, (unsigned long)s_last_awake_ms);
+    if (with_phases) {
+        hdr += (int)phase_timing_format(&s_phases, s_payload + hdr, sizeof(s_payload) - hdr);
+    }
+    if (with_energy) {
+        hdr += (int)energy_acct_format(&s_energy, s_payload + hdr, sizeof(s_payload) - hdr);
+    }
+    uint16_t n = telem_batch_encode(&s_batch, NODE_ID, now_s,
+                                    s_payload + hdr, sizeof(s_payload) - hdr);
 
-    int mv = -1;
-    if (cali_ok) {
-        ESP_ERROR_CHECK(adc_cali_raw_to_voltage(cali_handle, raw_avg, &mv));
-        return mv;
+    *len = (int)strlen(s_payload);
+    ESP_LOGI(TAG, "Telemetry payload (%u samples): %s", (unsigned)n, s_payload);
+    return n;
+#endif
+}
+
+/*
+ * Publish all buffered samples, one message per buffer-full.
+ * Samples are only removed once the broker acked them.
+ */
+static void flush_batch(esp_sleep_wakeup_cause_t cause)
+{
+    uint16_t sent = 0;
+    bool with_phases = phase_timing_due(&s_phases, PHASE_REPORT_EVERY_N);
+    bool with_energy = true;
+
+    while (s_batch.count > 0) {
+        int len = 0;
+        uint16_t n = encode_batch_message(cause, with_phases, with_energy, &len);
+        if (n == 0) {
+            break;
+        }
+
+        /* QoS 1, msg_id is tracked (explicit length: binary may contain 0x00) */
+        mqtt_ack_stats_t before, after;
+        mqtt_ack_get_stats(&before);
+        int msg_id = mqtt_ack_publish(s_mqtt_client,
+                                      TELEMETRY_BINARY ? TOPIC_TELEMETRY_BIN : TOPIC_TELEMETRY,
+                                      s_payload, len, 1, 0);
+        mqtt_ack_get_stats(&after);
+
+        /*
+         * Not queued, or queued but not tracked (pending list full): waiting
+         * would return ESP_OK without an ack for this message.
+         */
+        if (msg_id <= 0 || after.dropped != before.dropped) {
+            ESP_LOGW(TAG, "Batch not published (msg_id=%d), %u samples kept for next time",
+                     msg_id, (unsigned)s_batch.count);
+            telem_batch_postpone(&s_batch);
+            break;
+        }
+
+        /* sleep as soon as the broker confirmed it, not after a fixed delay */
+        if (mqtt_ack_wait_all(pdMS_TO_TICKS(MQTT_ACK_TIMEOUT_MS)) != ESP_OK) {
+            ESP_LOGW(TAG, "Batch not acked, %u samples kept for next time",
+                     (unsigned)s_batch.count);
+            telem_batch_postpone(&s_batch);
+            break;
+        }
+        telem_batch_consume(&s_batch, n);
+        energy_acct_delivered(&s_energy, n);
+        sent += n;
+
+        /* statistics only in the first message */
+        if (with_phases) {
+            phase_timing_reported(&s_phases);
+            with_phases = false;
+        }
+        with_energy = false;
     }
 
-    /* return a negative value to indicate "raw only" */
-    return -raw_avg;
+    mqtt_ack_stats_t st;
+    mqtt_ack_get_stats(&st);
+    ESP_LOGI(TAG, "%u samples delivered, last ack after %lu ms",
+             (unsigned)sent, (unsigned long)(st.last_ack_us / 1000));
+}
+
+/* --------------------------------------------------------------------------
+ * Deep sleep (awake time is remembered for the next telemetry message)
+ * -------------------------------------------------------------------------- */
+
+/* clock that keeps running through deep sleep (energy account) */
+static int64_t wall_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
+static void log_cycle_stats(void)
+{
+    char line[256];
+
+    if (phase_timing_format(&s_phases, line, sizeof(line))) {
+        ESP_LOGI(TAG, "Phases avg/max ms: %s", line);
+    }
+    if (energy_acct_format(&s_energy, line, sizeof(line))) {
+        ESP_LOGI(TAG, "Energy ms/uAh: %s", line);
+    }
+}
+
+static void arm_wake_stub(void)
+{
+#if WAKE_STUB_ENABLE
+    wake_stub_config_t cfg = {
+        .channel = ADC_CHANNEL_USED,
+        .atten = ADC_ATTEN,
+        .delta_raw = WAKE_STUB_DELTA_RAW,
+        .heartbeat = WAKE_STUB_HEARTBEAT,
+        .period_us = (uint64_t)s_sleep_sec * 1000000ULL,
+    };
+    if (wake_stub_arm(&cfg) != ESP_OK) {
+        ESP_LOGW(TAG, "Wake stub not armed, next wake boots");
+    }
+#endif
+}
+
+static void enter_deep_sleep(void)
+{
+    s_last_awake_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    ESP_LOGI(TAG, "Entering deep sleep for %lu seconds (awake %lu ms)",
+             (unsigned long)s_sleep_sec, (unsigned long)s_last_awake_ms);
+    esp_sleep_enable_timer_wakeup((uint64_t)s_sleep_sec * 1000000ULL);
+    arm_wake_stub();
+
+    phase_timing_mark(&s_phases, PHASE_SLEEP, esp_timer_get_time());
+    phase_timing_end(&s_phases);
+    energy_acct_end(&s_energy, &s_board, esp_timer_get_time(), wall_us());
+
+    /* after the last mark: the log line itself is not booked to a phase */
+    if (s_radio_wake) {
+        log_cycle_stats();
+    }
+    esp_deep_sleep_start();
 }
 
 /* --------------------------------------------------------------------------
@@ -278,12 +539,42 @@ static int read_adc_mv(void)
 
 void app_main(void)
 {
+    /* startup up to here is the BOOT phase */
+    phase_timing_init(&s_phases);
+    phase_timing_begin(&s_phases);
+    phase_timing_mark(&s_phases, PHASE_BOOT, esp_timer_get_time());
+    energy_acct_init(&s_energy);
+    energy_acct_begin(&s_energy, wall_us(), esp_timer_get_time());
+
     ESP_LOGI(TAG, "Project 20 starting (final node)");
 
     /* show wakeup reason */
     esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
     ESP_LOGI(TAG, "Wakeup cause: %d", cause);
 
+    wake_stub_result_t stub;
+    wake_stub_get_result(&stub);
+    if (stub.valid) {
+        ESP_LOGI(TAG, "Wake stub: boot by %s (raw %u), %lu wakes skipped before",
+                 wake_stub_verdict_name(stub.verdict), (unsigned)stub.raw,
+                 (unsigned long)stub.skipped);
+    }
+
+    /* 1) Sample first: most wakes end right here, radio never powered */
+    telem_batch_init(&s_batch);
+    sleep_sched_init(&s_sched, &s_sched_cfg);
+    int adc_val = 0;
+    bool sampled = sample_to_batch(&adc_val);
+    adc_session_deinit();   /* calibration table stays in RTC */
+    plan_sleep(sampled, adc_val);
+    phase_timing_mark(&s_phases, PHASE_ADC, esp_timer_get_time());
+
+    if (!telem_batch_due(&s_batch, BATCH_EVERY_N_WAKES, BATCH_FLUSH_THRESHOLD)) {
+        enter_deep_sleep();
+    }
+
+    s_radio_wake = true;
+
     /* NVS (required by Wi-Fi) */
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
@@ -292,25 +583,25 @@ void app_main(void)
     } else {
         ESP_ERROR_CHECK(ret);
     }
+    phase_timing_mark(&s_phases, PHASE_NVS, esp_timer_get_time());
 
-    /* 1) Wi-Fi connect */
+    /* 2) Wi-Fi connect: radio on until deep sleep */
+    energy_acct_enter(&s_energy, ENERGY_RADIO_RX, esp_timer_get_time());
     wifi_init_and_connect();
+    phase_timing_mark(&s_phases, PHASE_WIFI_INIT, esp_timer_get_time());
 
-    EventBits_t wbits = xEventGroupWaitBits(
-        s_wifi_event_group,
-        WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-        pdFALSE, pdFALSE,
-        portMAX_DELAY
-    );
-
-    if (!(wbits & WIFI_CONNECTED_BIT)) {
+    /* returns at the latest after WIFI_CONNECT_TIMEOUT_MS */
+    esp_err_t wifi_err = net_conn_wait_ready(portMAX_DELAY);
+    phase_timing_mark(&s_phases, PHASE_WIFI_WAIT, esp_timer_get_time());
+    if (wifi_err != ESP_OK) {
         ESP_LOGE(TAG, "Wi-Fi failed -> going to sleep");
-        esp_sleep_enable_timer_wakeup((uint64_t)SLEEP_TIME_SEC * 1000000ULL);
-        esp_deep_sleep_start();
+        telem_batch_postpone(&s_batch);
+        enter_deep_sleep();
     }
 
-    /* 2) MQTT connect */
+    /* 3) MQTT connect */
     mqtt_start();
+    phase_timing_mark(&s_phases, PHASE_MQTT_START, esp_timer_get_time());
 
     EventBits_t mbits = xEventGroupWaitBits(
         s_mqtt_event_group,
@@ -318,43 +609,23 @@ void app_main(void)
         pdFALSE, pdFALSE,
         pdMS_TO_TICKS(15000)
     );
+    phase_timing_mark(&s_phases, PHASE_MQTT_WAIT, esp_timer_get_time());
 
     if (!(mbits & MQTT_CONNECTED_BIT)) {
         ESP_LOGE(TAG, "MQTT connect timeout -> going to sleep");
-        esp_sleep_enable_timer_wakeup((uint64_t)SLEEP_TIME_SEC * 1000000ULL);
-        esp_deep_sleep_start();
+        /* cached address may be stale: full DHCP next wake */
+        wifi_fast_invalidate();
+        telem_batch_postpone(&s_batch);
+        enter_deep_sleep();
     }
 
-    /* 3) Read sensors (ADC in this band, I2C sensor optional for later) */
-    int adc_val = read_adc_mv();
-
-    char payload[128];
-
-    if (adc_val >= 0) {
-        snprintf(payload, sizeof(payload),
-                 "node=%s;adc_mv=%d;wakeup=%d",
-                 NODE_ID, adc_val, (int)cause);
-    } else {
-        snprintf(payload, sizeof(payload),
-                 "node=%s;adc_raw=%d;wakeup=%d",
-                 NODE_ID, -adc_val, (int)cause);
-    }
-
-    ESP_LOGI(TAG, "Telemetry payload: %s", payload);
-
-    /* 4) Publish telemetry */
-    esp_mqtt_client_publish(s_mqtt_client,
-                            TOPIC_TELEMETRY,
-                            payload,
-                            0,
-                            1,
-                            0);
-
-    /* optional small delay to allow MQTT send before sleep */
-    vTaskDelay(pdMS_TO_TICKS(500));
+    /* 4) Publish the sleep status and the batch */
+    energy_acct_enter(&s_energy, ENERGY_RADIO_TX, esp_timer_get_time());
+    publish_status_sleep();
+    flush_batch(cause);
+    energy_acct_enter(&s_energy, ENERGY_RADIO_RX, esp_timer_get_time());
+    phase_timing_mark(&s_phases, PHASE_PUBLISH, esp_timer_get_time());
 
     /* 5) Deep sleep */
-    ESP_LOGI(TAG, "Entering deep sleep for %d seconds", SLEEP_TIME_SEC);
-    esp_sleep_enable_timer_wakeup((uint64_t)SLEEP_TIME_SEC * 1000000ULL);
-    esp_deep_sleep_start();
+    enter_deep_sleep();
 }
@@ -38,6 +38,8 @@
 
 #include "mdns.h"
 
+#include "net_conn.h"
+
 #define WIFI_SSID   "farswitch"
 #define WIFI_PASS   "Kl79_?Sa13_04_1961Kl79_?Sa"
 
@@ -48,8 +50,6 @@
 #define LINE_BUF_SIZE 256
 
 static const char *TAG = "wifi_telnet";
-static EventGroupHandle_t wifi_event_group;
-#define WIFI_CONNECTED_BIT BIT0
 
 static esp_netif_t *s_netif = NULL;
 
@@ -103,22 +103,6 @@ static int get_rssi(void)
     return 0;
 }
 
-/* ---------- WiFi Events ---------- */
-
-static void wifi_event_handler(void *arg, esp_event_base_t event_base,
-                               int32_t event_id, void *event_data)
-{
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
-
-    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        esp_wifi_connect();
-
-    } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-        xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
-    }
-}
-
 /* ---------- Command Handling ---------- */
 
 static void handle_cmd(int sock, char *cmd)
@@ -174,7 +158,7 @@ static void handle_cmd(int sock, char *cmd)
 static void telnet_task(void *arg)
 {
     // Wait for WiFi + DHCP
-    xEventGroupWaitBits(wifi_event_group, WIFI_CONNECTED_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+    net_conn_wait_ready(portMAX_DELAY);
 
     int listen_sock = socket(AF_INET, SOCK_STREAM, IPPROTO_IP);
     int opt = 1;
@@ -253,31 +237,17 @@ static void telnet_task(void *arg)
 void app_main(void)
 {
     ESP_ERROR_CHECK(nvs_flash_init());
-    ESP_ERROR_CHECK(esp_netif_init());
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-
-    wifi_event_group = xEventGroupCreate();
-
-    // Create STA netif and set hostname BEFORE wifi start
-    s_netif = esp_netif_create_default_wifi_sta();
-    ESP_ERROR_CHECK(esp_netif_set_hostname(s_netif, HOSTNAME));
-
-    // WiFi init
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-
-    ESP_ERROR_CHECK(esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL));
-    ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL));
-
-    wifi_config_t wifi_config = {0};
-    strncpy((char *)wifi_config.sta.ssid, WIFI_SSID, sizeof(wifi_config.sta.ssid));
-    strncpy((char *)wifi_config.sta.password, WIFI_PASS, sizeof(wifi_config.sta.password));
-    wifi_config.sta.pmf_cfg.capable = true;
-    wifi_config.sta.pmf_cfg.required = false;
 
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
+    // WiFi: reconnects forever with backoff, hostname set BEFORE wifi start
+    net_conn_config_t cfg = {
+        .ssid = WIFI_SSID,
+        .password = WIFI_PASS,
+        .hostname = HOSTNAME,
+        .pmf_capable = true,
+        .max_retries = 0,
+    };
+    ESP_ERROR_CHECK(net_conn_start(&cfg));
+    s_netif = net_conn_netif();
 
     // mDNS for hostname.local
     ESP_ERROR_CHECK(mdns_init());
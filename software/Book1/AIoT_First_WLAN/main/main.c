@@ -47,9 +47,10 @@
 #include "esp_netif.h"
 
 #include "nvs_flash.h"
-#include "esp_wifi.h"
 #include "esp_http_client.h"
 
+#include "net_conn.h"
+
 /* -------------------- USER CONFIG -------------------- */
 /* Set your Wi-Fi credentials here. */
 #define WIFI_SSID      "YOUR_SSID_HERE"
@@ -57,10 +58,12 @@
 
 /*
  * How many reconnect attempts before we declare a failure.
- * In a product you would implement a backoff strategy (e.g. exponential),
- * but for a first project a fixed retry count is easier to understand.
+ * Between attempts the pause doubles (0.5 s, 1 s, 2 s, ... up to
+ * WIFI_BACKOFF_MAX_MS) with a random part, so many devices do not hit
+ * the AP at the same moment after a power cut.
  */
 #define WIFI_MAX_RETRY 10
+#define WIFI_BACKOFF_MAX_MS 8000
 
 /*
  * HTTP endpoint for the first test.
@@ -72,22 +75,8 @@
 /* -------------------- INTERNAL STATE -------------------- */
 static const char *TAG = "PROJECT17";
 
-/*
- * We use an Event Group to synchronize "Wi-Fi connected" and "Wi-Fi failed".
- * This allows app_main() to wait until the system is ready (or failed)
- * without busy-wait loops.
- */
-static EventGroupHandle_t wifi_event_group;
-
-/* Event group bits */
-#define WIFI_CONNECTED_BIT BIT0
-#define WIFI_FAIL_BIT      BIT1
-
-/* Retry counter for reconnects */
-static int s_retry_count = 0;
-
 /* -------------------------------------------------------- */
-/* 17.4.1  Wi-Fi + IP event handler                          */
+/* 17.4.1  Wi-Fi + IP events (shared component)              */
 /* -------------------------------------------------------- */
 
 /*
@@ -95,57 +84,14 @@ static int s_retry_count = 0;
  * - Wi-Fi driver emits WIFI_EVENT_xxx
  * - TCP/IP stack emits IP_EVENT_xxx
  *
- * We register ONE handler that reacts to:
+ * The handler for these events is the same in every networked project,
+ * so it lives in components/aiot_net (net_conn.c):
  * - WIFI_EVENT_STA_START          -> start connecting
- * - WIFI_EVENT_STA_DISCONNECTED   -> retry / fail
+ * - WIFI_EVENT_STA_DISCONNECTED   -> log the reason, retry after backoff / fail
  * - IP_EVENT_STA_GOT_IP           -> success (DHCP done)
+ *
+ * app_main() only waits for "ready" or "failed" (net_conn_wait_ready).
  */
-static void wifi_event_handler(void *arg,
-                               esp_event_base_t event_base,
-                               int32_t event_id,
-                               void *event_data)
-{
-    (void)arg;
-
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        ESP_LOGI(TAG, "Wi-Fi started, connecting to AP...");
-        esp_wifi_connect();
-        return;
-    }
-
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        /*
-         * This event means: no link to AP (wrong password, weak signal, AP down, etc.)
-         * For a stable system:
-         * - log the reason
-         * - implement backoff
-         * - possibly reboot after long time
-         */
-        if (s_retry_count < WIFI_MAX_RETRY) {
-            s_retry_count++;
-            ESP_LOGW(TAG, "Disconnected. Retrying %d/%d ...", s_retry_count, WIFI_MAX_RETRY);
-            esp_wifi_connect();
-        } else {
-            ESP_LOGE(TAG, "Wi-Fi connect failed after %d retries", WIFI_MAX_RETRY);
-            xEventGroupSetBits(wifi_event_group, WIFI_FAIL_BIT);
-        }
-        return;
-    }
-
-    if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-        /*
-         * This is the key "network ready" event:
-         * - We have link-level connectivity AND DHCP assigned an IP address.
-         * - Now HTTP/MQTT/OTA can start.
-         */
-        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
-        ESP_LOGI(TAG, "Got IP via DHCP: " IPSTR, IP2STR(&event->ip_info.ip));
-
-        s_retry_count = 0;
-        xEventGroupSetBits(wifi_event_group, WIFI_CONNECTED_BIT);
-        return;
-    }
-}
 
 /* -------------------------------------------------------- */
 /* 17.4.2  Wi-Fi initialization (Station mode)               */
@@ -154,7 +100,7 @@ static void wifi_event_handler(void *arg,
 /*
  * wifi_init_sta()
  * ---------------
- * Sets up:
+ * net_conn_start() sets up:
  * - TCP/IP stack (esp_netif)
  * - default event loop
  * - Wi-Fi driver in STA mode
@@ -166,44 +112,15 @@ static void wifi_event_handler(void *arg,
  */
 static void wifi_init_sta(void)
 {
-    wifi_event_group = xEventGroupCreate();
-
-    /* Initialize TCP/IP network interface (required for DHCP/HTTP/etc.) */
-    ESP_ERROR_CHECK(esp_netif_init());
-
-    /* Create default event loop used by Wi-Fi and other components */
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
-
-    /* Create default Wi-Fi station network interface (DHCP client, etc.) */
-    esp_netif_create_default_wifi_sta();
-
-    /* Initialize Wi-Fi driver */
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
-
-    /* Register event handlers for Wi-Fi and IP events */
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(
-        WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL, NULL));
-
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(
-        IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL, NULL));
-
-    /* Configure the SSID / password */
-    wifi_config_t wifi_config = {0};
-    strncpy((char *)wifi_config.sta.ssid, WIFI_SSID, sizeof(wifi_config.sta.ssid));
-    strncpy((char *)wifi_config.sta.password, WIFI_PASS, sizeof(wifi_config.sta.password));
-
-    /*
-     * Optional robustness settings (kept minimal here):
-     * - threshold.authmode can enforce WPA2, etc.
-     * - pmf_cfg for Protected Management Frames
-     */
-
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    net_conn_config_t cfg = {
+        .ssid = WIFI_SSID,
+        .password = WIFI_PASS,
+        .max_retries = WIFI_MAX_RETRY,
+        .backoff_max_ms = WIFI_BACKOFF_MAX_MS,
+    };
 
     /* Start Wi-Fi: this triggers WIFI_EVENT_STA_START */
-    ESP_ERROR_CHECK(esp_wifi_start());
+    ESP_ERROR_CHECK(net_conn_start(&cfg));
 
     ESP_LOGI(TAG, "wifi_init_sta() finished");
 }
@@ -308,25 +225,20 @@ void app_main(void)
 
     /*
      * Wait until either:
-     * - connected and got IP (WIFI_CONNECTED_BIT), or
-     * - failed after retries (WIFI_FAIL_BIT)
+     * - connected and got IP (ESP_OK), or
+     * - failed after retries (ESP_FAIL)
      */
-    EventBits_t bits = xEventGroupWaitBits(
-        wifi_event_group,
-        WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-        pdFALSE,
-        pdFALSE,
-        portMAX_DELAY
-    );
-
-    if (bits & WIFI_CONNECTED_BIT) {
+    esp_err_t net = net_conn_wait_ready(portMAX_DELAY);
+
+    if (net == ESP_OK) {
         ESP_LOGI(TAG, "Wi-Fi connected. Network is ready.");
         http_get_example();
-    } else if (bits & WIFI_FAIL_BIT) {
-        ESP_LOGE(TAG, "Wi-Fi connection failed. Check SSID/password and signal.");
+    } else if (net == ESP_FAIL) {
+        ESP_LOGE(TAG, "Wi-Fi connection failed (%s). Check SSID/password and signal.",
+                 net_conn_reason_str(net_conn_last_reason()));
     } else {
         /* Should never happen */
-        ESP_LOGE(TAG, "Unexpected event group state");
+        ESP_LOGE(TAG, "Unexpected network state");
     }
 
     /*
@@ -22,40 +22,73 @@
 #include "freertos/task.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "gpio_input.h"
 
 #define GPIO_INPUT_PIN 17
-#define POLL_DELAY_MS 50
+#define DEBOUNCE_US 20000          // contact bounce is over after ~20 ms
+
+#define PULSE_INPUT_PIN 18         // fast pulses (e.g. flow meter), counted by PCNT
+#define PULSE_GLITCH_NS 1000
+#define REPORT_PERIOD_MS 5000
 
 static const char *TAG = "PROJECT12";
 
 void app_main(void)
 {
-    gpio_config_t io_conf = {
-        .pin_bit_mask = (1ULL << GPIO_INPUT_PIN),
-        .mode = GPIO_MODE_INPUT,
-        .pull_up_en = GPIO_PULLUP_ENABLE,
-        .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_DISABLE
+    /* edges arrive by interrupt, the CPU sleeps in between */
+    ESP_ERROR_CHECK(gpio_input_start(5));
+
+    gpio_input_pin_config_t pin_cfg = {
+        .gpio = GPIO_INPUT_PIN,
+        .pull_up = true,
+        .debounce_us = DEBOUNCE_US,
     };
+    uint8_t input_id;
+    ESP_ERROR_CHECK(gpio_input_add_pin(&pin_cfg, &input_id));
 
-    gpio_config(&io_conf);
+    uint8_t counter_id;
+    ESP_ERROR_CHECK(gpio_input_add_counter(PULSE_INPUT_PIN, true, PULSE_GLITCH_NS, &counter_id));
 
-    int last_state = -1;
+    int last_count = 0;
+    int64_t next_report = esp_timer_get_time() + REPORT_PERIOD_MS * 1000LL;
 
     while (1)
     {
-        int state = gpio_get_level(GPIO_INPUT_PIN);
+        gpio_input_event_t ev;
 
-        if (state != last_state)
+        /*
+         * blocks until an edge is stable, at the latest until the report is
+         * due: a steady stream of edges must not push the report out
+         */
+        int64_t now = esp_timer_get_time();
+        if (now < next_report)
         {
-            if (state)
-                ESP_LOGI(TAG, "INPUT HIGH");
-            else
-                ESP_LOGI(TAG, "INPUT LOW");
-
-            last_state = state;
+            TickType_t wait = pdMS_TO_TICKS((next_report - now + 999) / 1000);
+            if (gpio_input_receive(&ev, wait))
+            {
+                if (ev.level)
+                    ESP_LOGI(TAG, "INPUT HIGH  t=%lld us  bounces=%u", ev.timestamp_us, ev.bounces);
+                else
+                    ESP_LOGI(TAG, "INPUT LOW   t=%lld us  bounces=%u", ev.timestamp_us, ev.bounces);
+                continue;
+            }
         }
 
-        vTaskDelay(pdMS_TO_TICKS(POLL_DELAY_MS));
+        /* fixed 5 s grid; after a long stall start a new one instead of catching up */
+        next_report += REPORT_PERIOD_MS * 1000LL;
+        if (next_report <= esp_timer_get_time())
+            next_report = esp_timer_get_time() + REPORT_PERIOD_MS * 1000LL;
+
+        int count = 0;
+        gpio_input_stats_t st;
+        ESP_ERROR_CHECK(gpio_input_get_count(counter_id, &count));
+        ESP_ERROR_CHECK(gpio_input_get_stats(input_id, &st));
+
+        ESP_LOGI(TAG, "Pulses: %d (+%d)  Input: %lu edges, %lu raw, %lu glitches, %lu dropped",
+                 count, count - last_count,
+                 (unsigned long)st.edges, (unsigned long)st.raw_edges,
+                 (unsigned long)st.glitches, (unsigned long)st.dropped);
+        last_count = count;
     }
 }
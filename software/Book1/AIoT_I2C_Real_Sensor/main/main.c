@@ -19,137 +19,473 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "driver/i2c.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_cpu.h"
+
+#include "dsp_filter.h"
+#include "dsp_bench.h"
+#include "mpu6050_fifo.h"
+#include "drdy_sampler.h"
+#include "sample_stats.h"
+#include "esp_timer.h"
+#include "i2c_bus.h"
 
 #define I2C_MASTER_NUM         I2C_NUM_0
 #define I2C_MASTER_SDA_IO      8      // <<< anpassen
 #define I2C_MASTER_SCL_IO      9      // <<< anpassen
-#define I2C_MASTER_FREQ_HZ     100000
+#define I2C_MASTER_FREQ_HZ     400000 // Fast-Mode, siehe IMU_FIFO_BUS_BYTES_PER_S
+
+/* 1 = Bus-Durchsatz bei 100/400 kHz beim Start messen (~2000 Transaktionen) */
+#define I2C_BENCH              0
+#define I2C_BENCH_TXNS         500    // Transaktionen pro Messung
 
 #define MPU6050_ADDR           0x68   // Standardadresse (AD0=0)
 #define MPU6050_WHO_AM_I       0x75
 #define MPU6050_PWR_MGMT_1     0x6B
 #define MPU6050_ACCEL_XOUT_H   0x3B
+#define MPU6050_SMPLRT_DIV     0x19
+#define MPU6050_CONFIG         0x1A
+#define MPU6050_INT_PIN_CFG    0x37
+#define MPU6050_INT_ENABLE     0x38
+#define MPU6050_INT_RD_CLEAR   0x10   // INT_PIN_CFG: jeder Lesezugriff loescht INT_STATUS
+
+#define MPU6050_INT_GPIO       10     // <<< anpassen (MPU6050 INT -> GPIO)
+
+/*
+ * Erfassungsmodus:
+ * IMU_MODE_POLL = Register-Polling alle 200 ms (ursprüngliche Variante)
+ * IMU_MODE_FIFO = FIFO-Burst (1 kHz, ein Blocktransfer pro Batch)
+ * IMU_MODE_DRDY = Data-Ready-Interrupt am INT-Pin, ein Read pro Sample
+ */
+#define IMU_MODE_POLL          0
+#define IMU_MODE_FIFO          1
+#define IMU_MODE_DRDY          2
+#define IMU_MODE               IMU_MODE_FIFO
+
+#define IMU_FIFO_RATE_DIV      0      // 1 kHz / (1 + div)
+#define IMU_DRDY_RATE_DIV      9      // 1 kHz / (1 + 9) = 100 Hz
+#define IMU_FIFO_DLPF_CFG      1      // DLPF 188 Hz -> interne Rate 1 kHz
+#define IMU_BATCH_MS           40     // FIFO (1 KiB) haelt ~85 ms bei 1 kHz
+#define IMU_LOG_MS             1000
+
+/*
+ * Der FIFO muss schneller geleert werden, als er sich fuellt: bei 1 kHz
+ * sind das 12 kB/s. Ein I2C-Byte kostet 9 SCL-Takte, bei 100 kHz passen
+ * also nur ~11 kB/s ueber den Bus -> der FIFO laeuft ueber. Mit 400 kHz
+ * (~44 kB/s) bleibt der Burst bei ~30 % Buslast. Die Pruefung verlangt
+ * mindestens die halbe Busbandbreite als Reserve (Adressen, Register,
+ * FIFO_COUNT, andere Geraete am Bus).
+ */
+#define IMU_FIFO_BUS_BYTES_PER_S  (MPU6050_FIFO_SAMPLE_BYTES * 1000 / (1 + IMU_FIFO_RATE_DIV))
+#if IMU_MODE == IMU_MODE_FIFO && IMU_FIFO_BUS_BYTES_PER_S * 9 * 2 > I2C_MASTER_FREQ_HZ
+#error "IMU_FIFO_RATE_DIV zu klein fuer I2C_MASTER_FREQ_HZ: FIFO wuerde ueberlaufen"
+#endif
+
+/* Filter chain per axis: median-of-3 (spikes) + IIR low-pass */
+#if IMU_MODE == IMU_MODE_FIFO
+#define IMU_SAMPLE_HZ          (1000.0f / (1 + IMU_FIFO_RATE_DIV))
+#elif IMU_MODE == IMU_MODE_DRDY
+#define IMU_SAMPLE_HZ          (1000.0f / (1 + IMU_DRDY_RATE_DIV))
+#else
+#define IMU_SAMPLE_HZ          5.0f   // 200 ms loop
+#endif
+#define IMU_LP_CUTOFF_HZ       1.0f
+#define IMU_AXES               6      // ax ay az gx gy gz
+
+/* LSB -> milli-units without division:
+ * accel: 1000/16384 mg/LSB    = 1000 >> 14
+ * gyro : 1000/131   mdps/LSB  ~ 7817 >> 10  (7.634)
+ */
+#define ACCEL_MG_NUM           1000
+#define ACCEL_MG_SHIFT         14
+#define GYRO_MDPS_NUM          7817
+#define GYRO_MDPS_SHIFT        10
+
+/* 1 = Float/Festkomma-Vergleich beim Start (kostet Bootzeit) */
+#define DSP_BENCH              0
+#define DSP_BENCH_SAMPLES      1000
 
 static const char *TAG = "PROJECT14";
 
+static dsp_chain_t s_axis_filter[IMU_AXES];
+
+static i2c_bus_dev_t s_mpu = NULL;
+
 static esp_err_t i2c_master_init(void)
 {
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_MASTER_SDA_IO,
-        .scl_io_num = I2C_MASTER_SCL_IO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ,
+    i2c_bus_config_t conf = {
+        .port = I2C_MASTER_NUM,
+        .sda_io = I2C_MASTER_SDA_IO,
+        .scl_io = I2C_MASTER_SCL_IO,
+        .internal_pullup = true,
     };
-    ESP_ERROR_CHECK(i2c_param_config(I2C_MASTER_NUM, &conf));
-    return i2c_driver_install(I2C_MASTER_NUM, conf.mode, 0, 0, 0);
+    ESP_ERROR_CHECK(i2c_bus_init(&conf));
+    return i2c_bus_add_device(MPU6050_ADDR, I2C_MASTER_FREQ_HZ, &s_mpu);
 }
 
+/* Bus/Device-Handles: kein Command-Link und kein Heap pro Registerzugriff */
 static esp_err_t mpu6050_write_byte(uint8_t reg, uint8_t data)
 {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (MPU6050_ADDR << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, reg, true);
-    i2c_master_write_byte(cmd, data, true);
-    i2c_master_stop(cmd);
-    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(100));
-    i2c_cmd_link_delete(cmd);
-    return ret;
+    return i2c_bus_write_reg(s_mpu, reg, data);
 }
 
 static esp_err_t mpu6050_read(uint8_t reg, uint8_t *buf, size_t len)
 {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
+    // Register address schreiben, danach lesen (repeated start)
+    return i2c_bus_read_reg(s_mpu, reg, buf, len);
+}
+
+#if I2C_BENCH
+/*
+ * Durchsatz-Messung (Transaktionen/s) fuer 100 kHz und 400 kHz:
+ *  - sync : 14-Byte-Read, Aufrufer blockiert
+ *  - async: ganzer Transaktions-Pool in der Queue, Aufrufer wartet am Ende
+ */
+static void i2c_bus_benchmark(uint32_t scl_hz)
+{
+    static uint8_t rx[I2C_BUS_POOL_SIZE][14];
+    i2c_bus_dev_t dev = NULL;
+
+    if (i2c_bus_add_device(MPU6050_ADDR, scl_hz, &dev) != ESP_OK) {
+        return;
+    }
 
-    // Register address schreiben
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (MPU6050_ADDR << 1) | I2C_MASTER_WRITE, true);
-    i2c_master_write_byte(cmd, reg, true);
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < I2C_BENCH_TXNS; i++) {
+        i2c_bus_read_reg(dev, MPU6050_ACCEL_XOUT_H, rx[0], sizeof(rx[0]));
+    }
+    int64_t t1 = esp_timer_get_time();
 
-    // Danach lesen
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (MPU6050_ADDR << 1) | I2C_MASTER_READ, true);
+    int done = 0;
+    int errors = 0;
+    while (done < I2C_BENCH_TXNS) {
+        i2c_bus_txn_t *txn[I2C_BUS_POOL_SIZE];
+        int n = 0;
 
-    if (len > 1) {
-        i2c_master_read(cmd, buf, len - 1, I2C_MASTER_ACK);
+        while (n < I2C_BUS_POOL_SIZE && done + n < I2C_BENCH_TXNS) {
+            txn[n] = i2c_bus_txn_alloc(dev);
+            if (!txn[n]) {
+                break;
+            }
+            i2c_bus_txn_set_read_reg(txn[n], MPU6050_ACCEL_XOUT_H, rx[n], sizeof(rx[n]));
+            txn[n]->notify_task = xTaskGetCurrentTaskHandle();
+            if (i2c_bus_submit(txn[n]) != ESP_OK) {
+                i2c_bus_txn_free(txn[n]);
+                break;
+            }
+            n++;
+        }
+        if (n == 0) {
+            break;      // nichts angenommen: nicht endlos kreisen
+        }
+        for (int k = 0; k < n; k++) {
+            esp_err_t ret = i2c_bus_wait(txn[k], pdMS_TO_TICKS(1000));
+            // nach Timeout gehoert die Transaktion noch dem Bus-Task:
+            // erst freigeben, wenn sie fertig ist (jeder Transfer hat ein eigenes Timeout)
+            while (ret == ESP_ERR_TIMEOUT) {
+                ret = i2c_bus_wait(txn[k], pdMS_TO_TICKS(1000));
+            }
+            if (ret != ESP_OK) {
+                errors++;
+            }
+            i2c_bus_txn_free(txn[k]);
+        }
+        done += n;
     }
-    i2c_master_read_byte(cmd, buf + len - 1, I2C_MASTER_NACK);
+    int64_t t2 = esp_timer_get_time();
+
+    i2c_bus_remove_device(dev);
 
-    i2c_master_stop(cmd);
+    ESP_LOGI(TAG, "I2C bench @%lu Hz: sync %lu txn/s, async %lu txn/s (14 byte reads, %d errors)",
+             (unsigned long)scl_hz,
+             (unsigned long)(I2C_BENCH_TXNS * 1000000LL / (t1 - t0)),
+             (unsigned long)(done * 1000000LL / (t2 - t1)), errors);
+}
+#endif
 
-    esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(100));
-    i2c_cmd_link_delete(cmd);
-    return ret;
+#if IMU_MODE == IMU_MODE_FIFO
+/* Adapter for the FIFO driver */
+static esp_err_t bus_read(void *ctx, uint8_t reg, uint8_t *buf, size_t len)
+{
+    (void)ctx;
+    return mpu6050_read(reg, buf, len);
 }
 
+static esp_err_t bus_write(void *ctx, uint8_t reg, uint8_t val)
+{
+    (void)ctx;
+    return mpu6050_write_byte(reg, val);
+}
+
+static const mpu6050_bus_t s_mpu_bus = {
+    .read = bus_read,
+    .write = bus_write,
+    .ctx = NULL,
+};
+#endif
+
 static int16_t be16(const uint8_t *p)
 {
     return (int16_t)((p[0] << 8) | p[1]);
 }
 
-void app_main(void)
+#if DSP_BENCH
+static uint32_t bench_cycles(void)
 {
-    ESP_ERROR_CHECK(i2c_master_init());
-    ESP_LOGI(TAG, "I2C init ok (SDA=%d, SCL=%d, %d Hz)", I2C_MASTER_SDA_IO, I2C_MASTER_SCL_IO, I2C_MASTER_FREQ_HZ);
-
-    // WHO_AM_I lesen
-    uint8_t who = 0;
-    ESP_ERROR_CHECK(mpu6050_read(MPU6050_WHO_AM_I, &who, 1));
-    ESP_LOGI(TAG, "MPU6050 WHO_AM_I = 0x%02X (erwartet meist 0x68)", who);
+    return esp_cpu_get_cycle_count();
+}
 
-    // Sensor aus Sleep holen: PWR_MGMT_1 = 0
-    ESP_ERROR_CHECK(mpu6050_write_byte(MPU6050_PWR_MGMT_1, 0x00));
-    vTaskDelay(pdMS_TO_TICKS(50));
+/*
+ * Zyklen pro 6-Achsen-Sample, Float- gegen Festkomma-Pfad mit denselben
+ * Stufen (Median-of-3 + IIR + Skalierung auf mg/mdps), siehe dsp_bench.h
+ */
+static void dsp_benchmark(void)
+{
+    dsp_bench_result_t r;
 
-    ESP_LOGI(TAG, "MPU6050 aktiv. Lese Accel/Gyro...");
+    dsp_bench_run(bench_cycles, DSP_BENCH_SAMPLES, IMU_LP_CUTOFF_HZ, IMU_SAMPLE_HZ, &r);
+    ESP_LOGI(TAG, "DSP bench: float = %lu cycles/sample, fixed-point = %lu cycles/sample "
+             "(max |diff| %ld)",
+             (unsigned long)r.float_ticks, (unsigned long)r.fixed_ticks, (long)r.max_diff);
+}
+#endif
 
-    // Standard-Sensitivitäten (nach Reset):
-    // Accel FS = ±2g  => 16384 LSB/g
-    // Gyro  FS = ±250°/s => 131 LSB/(°/s)
-    const float accel_scale = 16384.0f;
-    const float gyro_scale  = 131.0f;
+#if IMU_MODE == IMU_MODE_POLL
+static void imu_poll_loop(void)
+{
+    // gleiche Statistik wie im Interrupt-Modus, zum direkten Vergleich
+    sample_stats_t stats;
+    sample_stats_reset(&stats, 200 * 1000);
 
     while (1)
     {
         uint8_t raw[14] = {0};
+        int64_t t_wake = esp_timer_get_time();
         esp_err_t ret = mpu6050_read(MPU6050_ACCEL_XOUT_H, raw, sizeof(raw));
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "I2C read error: %s", esp_err_to_name(ret));
             vTaskDelay(pdMS_TO_TICKS(500));
             continue;
         }
+        // Latenz wie im DRDY-Modus: Ausloeser bis Ende des Reads, nur gelungene Reads
+        sample_stats_add(&stats, t_wake, esp_timer_get_time());
 
-        int16_t ax = be16(&raw[0]);
-        int16_t ay = be16(&raw[2]);
-        int16_t az = be16(&raw[4]);
+        int16_t axis[IMU_AXES] = {
+            be16(&raw[0]), be16(&raw[2]), be16(&raw[4]),     // accel
+            be16(&raw[8]), be16(&raw[10]), be16(&raw[12]),   // gyro
+        };
         int16_t temp_raw = be16(&raw[6]);
-        int16_t gx = be16(&raw[8]);
-        int16_t gy = be16(&raw[10]);
-        int16_t gz = be16(&raw[12]);
 
-        // Umrechnungen
-        float ax_g = ax / accel_scale;
-        float ay_g = ay / accel_scale;
-        float az_g = az / accel_scale;
+        // Filtern (Festkomma, keine Heap-Allokation)
+        for (int a = 0; a < IMU_AXES; a++) {
+            dsp_chain_process(&s_axis_filter[a], axis[a], &axis[a]);
+        }
+
+        // Umrechnungen ohne Float-Division
+        int32_t ax_mg = dsp_scale(axis[0], ACCEL_MG_NUM, ACCEL_MG_SHIFT);
+        int32_t ay_mg = dsp_scale(axis[1], ACCEL_MG_NUM, ACCEL_MG_SHIFT);
+        int32_t az_mg = dsp_scale(axis[2], ACCEL_MG_NUM, ACCEL_MG_SHIFT);
 
-        float gx_dps = gx / gyro_scale;
-        float gy_dps = gy / gyro_scale;
-        float gz_dps = gz / gyro_scale;
+        int32_t gx_mdps = dsp_scale(axis[3], GYRO_MDPS_NUM, GYRO_MDPS_SHIFT);
+        int32_t gy_mdps = dsp_scale(axis[4], GYRO_MDPS_NUM, GYRO_MDPS_SHIFT);
+        int32_t gz_mdps = dsp_scale(axis[5], GYRO_MDPS_NUM, GYRO_MDPS_SHIFT);
 
         // Temperatur (MPU-6050 typisch): Temp(°C) = (temp_raw / 340) + 36.53
-        float temp_c = (temp_raw / 340.0f) + 36.53f;
+        // in centi-°C: temp_raw * 100/340 ~ temp_raw * 301 >> 10
+        int32_t temp_cc = dsp_scale(temp_raw, 301, 10) + 3653;
+        // Vorzeichen extra: -0.50 C hat temp_cc / 100 == 0
+        long temp_abs = labs((long)temp_cc);
 
         ESP_LOGI(TAG,
-                 "A[g]=(%+.3f, %+.3f, %+.3f)  G[dps]=(%+.2f, %+.2f, %+.2f)  T=%.2fC",
-                 ax_g, ay_g, az_g, gx_dps, gy_dps, gz_dps, temp_c);
+                 "A[mg]=(%+ld, %+ld, %+ld)  G[mdps]=(%+ld, %+ld, %+ld)  T=%s%ld.%02ldC",
+                 (long)ax_mg, (long)ay_mg, (long)az_mg,
+                 (long)gx_mdps, (long)gy_mdps, (long)gz_mdps,
+                 temp_cc < 0 ? "-" : "", temp_abs / 100, temp_abs % 100);
+
+        if ((stats.count % 25) == 0) {
+            sample_stats_log(TAG, "poll", &stats);
+        }
 
         vTaskDelay(pdMS_TO_TICKS(200));
     }
 }
+#endif
+
+#if IMU_MODE != IMU_MODE_POLL
+static void log_filtered(const int16_t axis[IMU_AXES])
+{
+    // Umrechnungen ohne Float-Division
+    ESP_LOGI(TAG,
+             "A[mg]=(%+ld, %+ld, %+ld)  G[mdps]=(%+ld, %+ld, %+ld)",
+             (long)dsp_scale(axis[0], ACCEL_MG_NUM, ACCEL_MG_SHIFT),
+             (long)dsp_scale(axis[1], ACCEL_MG_NUM, ACCEL_MG_SHIFT),
+             (long)dsp_scale(axis[2], ACCEL_MG_NUM, ACCEL_MG_SHIFT),
+             (long)dsp_scale(axis[3], GYRO_MDPS_NUM, GYRO_MDPS_SHIFT),
+             (long)dsp_scale(axis[4], GYRO_MDPS_NUM, GYRO_MDPS_SHIFT),
+             (long)dsp_scale(axis[5], GYRO_MDPS_NUM, GYRO_MDPS_SHIFT));
+}
+#endif
+
+#if IMU_MODE == IMU_MODE_FIFO
+/*
+ * FIFO-Burst: der Sensor tastet selbst mit 1 kHz ab, wir holen alle
+ * IMU_BATCH_MS einen ganzen Block (ca. 40 Samples) mit einem Transfer.
+ */
+static void imu_fifo_loop(void)
+{
+    static mpu6050_sample_t batch[MPU6050_FIFO_MAX_SAMPLES];
+    mpu6050_fifo_stats_t stats = {0};
+    int16_t axis[IMU_AXES] = {0};
+    TickType_t last_log = xTaskGetTickCount();
+    TickType_t last_wake = xTaskGetTickCount();
+
+    ESP_ERROR_CHECK(mpu6050_fifo_start(&s_mpu_bus, IMU_FIFO_RATE_DIV, IMU_FIFO_DLPF_CFG));
+
+    while (1)
+    {
+        vTaskDelayUntil(&last_wake, pdMS_TO_TICKS(IMU_BATCH_MS));
+
+        size_t n = 0;
+        esp_err_t ret = mpu6050_fifo_read_batch(&s_mpu_bus, batch, MPU6050_FIFO_MAX_SAMPLES,
+                                                &n, &stats);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "FIFO read error: %s", esp_err_to_name(ret));
+            continue;
+        }
+
+        // Filtern (Festkomma, keine Heap-Allokation), Sample fuer Sample
+        for (size_t i = 0; i < n; i++) {
+            const int16_t in[IMU_AXES] = {
+                batch[i].ax, batch[i].ay, batch[i].az,
+                batch[i].gx, batch[i].gy, batch[i].gz,
+            };
+            for (int a = 0; a < IMU_AXES; a++) {
+                dsp_chain_process(&s_axis_filter[a], in[a], &axis[a]);
+            }
+        }
+
+        if ((xTaskGetTickCount() - last_log) >= pdMS_TO_TICKS(IMU_LOG_MS)) {
+            last_log = xTaskGetTickCount();
+            log_filtered(axis);
+            ESP_LOGI(TAG, "FIFO: samples=%lu batches=%lu overflows=%lu misaligned=%lu",
+                     (unsigned long)stats.samples, (unsigned long)stats.batches,
+                     (unsigned long)stats.overflows, (unsigned long)stats.misaligned);
+        }
+    }
+}
+#endif
+
+#if IMU_MODE == IMU_MODE_DRDY
+static int16_t s_drdy_axis[IMU_AXES];
+static volatile uint32_t s_drdy_read_errors;
+
+/* Worker-Task (nicht ISR): Sensor nur lesen, wenn wirklich Daten bereit sind */
+static bool imu_drdy_handler(const sample_event_t *ev, void *ctx)
+{
+    (void)ev; (void)ctx;
+    uint8_t raw[14];
+
+    // Lesen der Daten setzt auch INT_STATUS zurueck (INT_RD_CLEAR)
+    if (mpu6050_read(MPU6050_ACCEL_XOUT_H, raw, sizeof(raw)) != ESP_OK) {
+        s_drdy_read_errors++;
+        return false;
+    }
+
+    const int16_t in[IMU_AXES] = {
+        be16(&raw[0]), be16(&raw[2]), be16(&raw[4]),
+        be16(&raw[8]), be16(&raw[10]), be16(&raw[12]),
+    };
+    for (int a = 0; a < IMU_AXES; a++) {
+        dsp_chain_process(&s_axis_filter[a], in[a], &s_drdy_axis[a]);
+    }
+    return true;
+}
+
+static void imu_drdy_loop(void)
+{
+    // Sample-Rate setzen, INT aktiv-high push-pull (50 us Puls), INT_RD_CLEAR, DATA_RDY_EN
+    ESP_ERROR_CHECK(mpu6050_write_byte(MPU6050_CONFIG, IMU_FIFO_DLPF_CFG));
+    ESP_ERROR_CHECK(mpu6050_write_byte(MPU6050_SMPLRT_DIV, IMU_DRDY_RATE_DIV));
+    ESP_ERROR_CHECK(mpu6050_write_byte(MPU6050_INT_PIN_CFG, MPU6050_INT_RD_CLEAR));
+
+    ESP_ERROR_CHECK(drdy_sampler_start(10));
+
+    drdy_source_config_t src = {
+        .gpio = MPU6050_INT_GPIO,
+        .edge = GPIO_INTR_POSEDGE,
+        .pull_up = false,
+        .expected_period_us = (uint32_t)(1000000.0f / IMU_SAMPLE_HZ),
+        .handler = imu_drdy_handler,
+        .ctx = NULL,
+    };
+    uint8_t id = 0;
+    ESP_ERROR_CHECK(drdy_sampler_add_source(&src, &id));
+
+    ESP_ERROR_CHECK(mpu6050_write_byte(MPU6050_INT_ENABLE, 0x01));
+
+    // Diese Schleife gibt nur noch Werte und Statistik aus
+    while (1)
+    {
+        vTaskDelay(pdMS_TO_TICKS(IMU_LOG_MS));
+
+        sample_stats_t stats;
+        uint32_t dropped = 0;
+        drdy_sampler_get_stats(id, &stats, &dropped);
+
+        log_filtered(s_drdy_axis);
+        sample_stats_log(TAG, "drdy", &stats);
+        ESP_LOGI(TAG, "drdy: dropped=%lu read_errors=%lu",
+                 (unsigned long)dropped, (unsigned long)s_drdy_read_errors);
+    }
+}
+#endif
+
+void app_main(void)
+{
+    ESP_ERROR_CHECK(i2c_master_init());
+    ESP_LOGI(TAG, "I2C init ok (SDA=%d, SCL=%d, %d Hz)", I2C_MASTER_SDA_IO, I2C_MASTER_SCL_IO, I2C_MASTER_FREQ_HZ);
+
+    // WHO_AM_I lesen
+    uint8_t who = 0;
+    ESP_ERROR_CHECK(mpu6050_read(MPU6050_WHO_AM_I, &who, 1));
+    ESP_LOGI(TAG, "MPU6050 WHO_AM_I = 0x%02X (erwartet meist 0x68)", who);
+
+    // Sensor aus Sleep holen: PWR_MGMT_1 = 0
+    ESP_ERROR_CHECK(mpu6050_write_byte(MPU6050_PWR_MGMT_1, 0x00));
+    vTaskDelay(pdMS_TO_TICKS(50));
+
+    ESP_LOGI(TAG, "MPU6050 aktiv. Lese Accel/Gyro...");
+
+#if I2C_BENCH
+    i2c_bus_benchmark(100000);
+    i2c_bus_benchmark(400000);
+#endif
+
+    // Standard-Sensitivitäten (nach Reset):
+    // Accel FS = ±2g  => 16384 LSB/g
+    // Gyro  FS = ±250°/s => 131 LSB/(°/s)
+    // Umrechnung erfolgt in Festkomma (mg, mdps), siehe ACCEL_MG_* / GYRO_MDPS_*
+
+#if DSP_BENCH
+    dsp_benchmark();
+#endif
+
+    int16_t alpha = dsp_iir_alpha_q15(IMU_LP_CUTOFF_HZ, IMU_SAMPLE_HZ);
+    for (int a = 0; a < IMU_AXES; a++) {
+        dsp_chain_init(&s_axis_filter[a]);
+        dsp_chain_add_median(&s_axis_filter[a], 3);
+        dsp_chain_add_iir_lowpass(&s_axis_filter[a], alpha);
+    }
+
+#if IMU_MODE == IMU_MODE_FIFO
+    imu_fifo_loop();
+#elif IMU_MODE == IMU_MODE_DRDY
+    imu_drdy_loop();
+#else
+    imu_poll_loop();
+#endif
+}
@@ -0,0 +1,163 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Project 14: MPU6050 FIFO burst acquisition
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "mpu6050_fifo.h"
+
+static const char *TAG = "MPU6050_FIFO";
+
+/* Registers (MPU-6000/6050 register map rev 4.2) */
+#define REG_SMPLRT_DIV      0x19
+#define REG_CONFIG          0x1A
+#define REG_FIFO_EN         0x23
+#define REG_INT_STATUS      0x3A
+#define REG_USER_CTRL       0x6A
+#define REG_FIFO_COUNT_H    0x72
+#define REG_FIFO_R_W        0x74
+
+#define FIFO_EN_ACCEL       0x08
+#define FIFO_EN_GYRO_XYZ    0x70
+#define USER_CTRL_FIFO_EN   0x40
+#define USER_CTRL_FIFO_RST  0x04
+#define INT_FIFO_OFLOW      0x10
+
+/* one FIFO drain = one block read, buffer lives outside the stack */
+static uint8_t s_fifo_buf[MPU6050_FIFO_MAX_SAMPLES * MPU6050_FIFO_SAMPLE_BYTES];
+
+static int16_t be16(const uint8_t *p)
+{
+    return (int16_t)((p[0] << 8) | p[1]);
+}
+
+static esp_err_t fifo_reset(const mpu6050_bus_t *bus)
+{
+    esp_err_t err = bus->write(bus->ctx, REG_USER_CTRL, USER_CTRL_FIFO_RST);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return bus->write(bus->ctx, REG_USER_CTRL, USER_CTRL_FIFO_EN);
+}
+
+size_t mpu6050_fifo_decode(const uint8_t *raw, size_t len,
+                           mpu6050_sample_t *out, size_t max_samples)
+{
+    size_t n = len / MPU6050_FIFO_SAMPLE_BYTES;
+    if (n > max_samples) {
+        n = max_samples;
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        const uint8_t *p = &raw[i * MPU6050_FIFO_SAMPLE_BYTES];
+        out[i].ax = be16(&p[0]);
+        out[i].ay = be16(&p[2]);
+        out[i].az = be16(&p[4]);
+        out[i].gx = be16(&p[6]);
+        out[i].gy = be16(&p[8]);
+        out[i].gz = be16(&p[10]);
+    }
+    return n;
+}
+
+esp_err_t mpu6050_fifo_start(const mpu6050_bus_t *bus, uint8_t rate_div, uint8_t dlpf_cfg)
+{
+    esp_err_t err;
+
+    /* DLPF 1..6 -> internal rate 1 kHz, so rate = 1 kHz / (1 + div) */
+    err = bus->write(bus->ctx, REG_CONFIG, dlpf_cfg & 0x07);
+    if (err != ESP_OK) return err;
+
+    err = bus->write(bus->ctx, REG_SMPLRT_DIV, rate_div);
+    if (err != ESP_OK) return err;
+
+    err = bus->write(bus->ctx, REG_FIFO_EN, FIFO_EN_ACCEL | FIFO_EN_GYRO_XYZ);
+    if (err != ESP_OK) return err;
+
+    /* clear stale flags, then start with an empty FIFO */
+    uint8_t status = 0;
+    bus->read(bus->ctx, REG_INT_STATUS, &status, 1);
+
+    err = fifo_reset(bus);
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "FIFO enabled: %u Hz, %d bytes/sample",
+                 1000u / (1u + rate_div), MPU6050_FIFO_SAMPLE_BYTES);
+    }
+    return err;
+}
+
+esp_err_t mpu6050_fifo_stop(const mpu6050_bus_t *bus)
+{
+    esp_err_t err = bus->write(bus->ctx, REG_FIFO_EN, 0x00);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return bus->write(bus->ctx, REG_USER_CTRL, USER_CTRL_FIFO_RST);
+}
+
+esp_err_t mpu6050_fifo_read_batch(const mpu6050_bus_t *bus,
+                                  mpu6050_sample_t *out, size_t max_samples,
+                                  size_t *out_count,
+                                  mpu6050_fifo_stats_t *stats)
+{
+    *out_count = 0;
+
+    /* INT_STATUS (clear on read) and FIFO_COUNT */
+    uint8_t status = 0;
+    esp_err_t err = bus->read(bus->ctx, REG_INT_STATUS, &status, 1);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    uint8_t cnt[2];
+    err = bus->read(bus->ctx, REG_FIFO_COUNT_H, cnt, sizeof(cnt));
+    if (err != ESP_OK) {
+        return err;
+    }
+    size_t count = ((size_t)cnt[0] << 8) | cnt[1];
+
+    /*
+     * Overflow: the oldest bytes were overwritten, sample boundaries are lost.
+     * Only a FIFO reset brings us back in sync.
+     */
+    if ((status & INT_FIFO_OFLOW) || count >= MPU6050_FIFO_SIZE) {
+        if (stats) stats->overflows++;
+        ESP_LOGW(TAG, "FIFO overflow (count=%u) -> reset", (unsigned)count);
+        return fifo_reset(bus);
+    }
+
+    if (count % MPU6050_FIFO_SAMPLE_BYTES) {
+        /* a sample is still being written: take only complete samples */
+        if (stats) stats->misaligned++;
+        count -= count % MPU6050_FIFO_SAMPLE_BYTES;
+    }
+
+    if (max_samples > MPU6050_FIFO_MAX_SAMPLES) {
+        max_samples = MPU6050_FIFO_MAX_SAMPLES;
+    }
+    if (count > max_samples * MPU6050_FIFO_SAMPLE_BYTES) {
+        count = max_samples * MPU6050_FIFO_SAMPLE_BYTES;
+    }
+    if (count == 0) {
+        return ESP_OK;
+    }
+
+    /* the whole batch in one block transfer */
+    err = bus->read(bus->ctx, REG_FIFO_R_W, s_fifo_buf, count);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    *out_count = mpu6050_fifo_decode(s_fifo_buf, count, out, max_samples);
+
+    if (stats) {
+        stats->batches++;
+        stats->samples += *out_count;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,69 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Project 14: MPU6050 FIFO burst acquisition
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ ******************************************************************************/
+
+/*
+ * Instead of polling ACCEL_XOUT_H every 200 ms, the MPU6050 samples on its
+ * own at 1 kHz and stores accel + gyro (12 bytes per sample) in its 1 KiB
+ * FIFO. We drain it with one block read per batch and decode the whole
+ * batch at once.
+ *
+ * Register access goes through mpu6050_bus_t, so the same code runs on the
+ * real I2C bus or against a simulated device.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+
+#define MPU6050_FIFO_SIZE           1024
+#define MPU6050_FIFO_SAMPLE_BYTES   12      /* accel xyz + gyro xyz */
+#define MPU6050_FIFO_MAX_SAMPLES    (MPU6050_FIFO_SIZE / MPU6050_FIFO_SAMPLE_BYTES)
+
+/* Register access used by the driver (real bus or mock) */
+typedef struct {
+    esp_err_t (*read)(void *ctx, uint8_t reg, uint8_t *buf, size_t len);
+    esp_err_t (*write)(void *ctx, uint8_t reg, uint8_t val);
+    void *ctx;
+} mpu6050_bus_t;
+
+typedef struct {
+    int16_t ax, ay, az;
+    int16_t gx, gy, gz;
+} mpu6050_sample_t;
+
+typedef struct {
+    uint32_t batches;
+    uint32_t samples;
+    uint32_t overflows;     /* FIFO overflowed, data lost, FIFO was reset */
+    uint32_t misaligned;    /* byte count not a multiple of a sample */
+} mpu6050_fifo_stats_t;
+
+/*
+ * Configure sample rate and enable the FIFO.
+ * Rate = 1 kHz / (1 + rate_div) with DLPF enabled (dlpf_cfg 1..6).
+ */
+esp_err_t mpu6050_fifo_start(const mpu6050_bus_t *bus, uint8_t rate_div, uint8_t dlpf_cfg);
+
+/* Disable and reset the FIFO (back to register polling) */
+esp_err_t mpu6050_fifo_stop(const mpu6050_bus_t *bus);
+
+/*
+ * Drain up to max_samples complete samples from the FIFO.
+ * Returns the number of decoded samples in *out_count (0 if FIFO empty).
+ * On overflow the FIFO is reset, the batch is dropped and stats are updated.
+ */
+esp_err_t mpu6050_fifo_read_batch(const mpu6050_bus_t *bus,
+                                  mpu6050_sample_t *out, size_t max_samples,
+                                  size_t *out_count,
+                                  mpu6050_fifo_stats_t *stats);
+
+/* Decode raw FIFO bytes (big endian, accel then gyro). Pure function. */
+size_t mpu6050_fifo_decode(const uint8_t *raw, size_t len,
+                           mpu6050_sample_t *out, size_t max_samples);
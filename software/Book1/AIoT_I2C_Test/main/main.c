@@ -18,61 +18,108 @@
  ******************************************************************************/
 
 #include <stdio.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "driver/i2c.h"
+#include "i2c_bus.h"
+#include "i2c_scan.h"
 #include "esp_log.h"
+#include "nvs_flash.h"
 
 #define I2C_MASTER_SCL_IO 9
 #define I2C_MASTER_SDA_IO 8
 #define I2C_MASTER_NUM I2C_NUM_0
 #define I2C_MASTER_FREQ_HZ 100000
 
+#define I2C_PROBE_TIMEOUT_MS 2      // fehlende Geraete antworten sofort mit NACK
+#define I2C_CHECK_PERIOD_MS  5000
+#define I2C_FULL_SCAN_EVERY  12     // jede 12. Periode (1 min) Vollscan statt Verify
+
 static const char *TAG = "PROJECT13";
 
 void i2c_master_init()
 {
-    i2c_config_t conf = {
-        .mode = I2C_MODE_MASTER,
-        .sda_io_num = I2C_MASTER_SDA_IO,
-        .scl_io_num = I2C_MASTER_SCL_IO,
-        .sda_pullup_en = GPIO_PULLUP_ENABLE,
-        .scl_pullup_en = GPIO_PULLUP_ENABLE,
-        .master.clk_speed = I2C_MASTER_FREQ_HZ,
+    i2c_bus_config_t conf = {
+        .port = I2C_MASTER_NUM,
+        .sda_io = I2C_MASTER_SDA_IO,
+        .scl_io = I2C_MASTER_SCL_IO,
+        .internal_pullup = true,
     };
 
-    i2c_param_config(I2C_MASTER_NUM, &conf);
-    i2c_driver_install(I2C_MASTER_NUM, conf.mode, 0, 0, 0);
+    ESP_ERROR_CHECK(i2c_bus_init(&conf));
 }
 
-void i2c_scanner()
+static i2c_scan_map_t s_map;
+
+static void print_map(const char *what, const i2c_scan_result_t *res)
 {
-    ESP_LOGI(TAG, "I2C Scan gestartet");
+    ESP_LOGI(TAG, "%s: %u Adressen in %lu us, %u Geraet(e)",
+             what, res->probed, (unsigned long)res->duration_us, s_map.count);
 
-    for (uint8_t addr = 1; addr < 127; addr++)
+    for (uint8_t i = 0; i < s_map.count; i++)
     {
-        i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-        i2c_master_start(cmd);
-        i2c_master_write_byte(cmd, (addr << 1) | I2C_MASTER_WRITE, true);
-        i2c_master_stop(cmd);
+        const i2c_scan_device_t *d = &s_map.dev[i];
+        ESP_LOGI(TAG, "Gerät gefunden bei Adresse: 0x%02X  (%s)",
+                 d->addr, i2c_scan_type_name(d->type));
+    }
+}
 
-        esp_err_t ret = i2c_master_cmd_begin(I2C_MASTER_NUM, cmd, pdMS_TO_TICKS(50));
-        i2c_cmd_link_delete(cmd);
+void i2c_scanner()
+{
+    ESP_LOGI(TAG, "I2C Scan gestartet");
 
-        if (ret == ESP_OK)
-        {
-            ESP_LOGI(TAG, "Gerät gefunden bei Adresse: 0x%02X", addr);
-        }
-    }
+    /* Boot: bekannte Geraete aus RTC/NVS nur verifizieren, sonst Vollscan */
+    i2c_scan_result_t res;
+    ESP_ERROR_CHECK(i2c_scan_cached(&s_map, I2C_PROBE_TIMEOUT_MS, &res));
+    print_map(res.from_cache ? "Cache verifiziert" : "Vollscan", &res);
 }
 
 void app_main(void)
 {
+    /* NVS haelt die Geraeteliste ueber Power-Cycles */
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+        ESP_ERROR_CHECK(nvs_flash_init());
+    } else {
+        ESP_ERROR_CHECK(ret);
+    }
+
     i2c_master_init();
+    i2c_scanner();
 
+    uint32_t periods = 0;
     while (1)
     {
-        i2c_scanner();
-        vTaskDelay(pdMS_TO_TICKS(5000));
+        vTaskDelay(pdMS_TO_TICKS(I2C_CHECK_PERIOD_MS));
+        periods++;
+
+        /*
+         * Verify prueft nur die bekannten Adressen: ein neu angestecktes
+         * Geraet (oder eins an einem leeren Bus) findet nur der Vollscan.
+         */
+        i2c_scan_result_t res;
+        if (s_map.count == 0 || periods >= I2C_FULL_SCAN_EVERY)
+        {
+            static i2c_scan_map_t fresh;
+            periods = 0;
+            ESP_ERROR_CHECK(i2c_scan_full(&fresh, I2C_PROBE_TIMEOUT_MS, &res));
+            if (fresh.count != s_map.count ||
+                memcmp(fresh.dev, s_map.dev, fresh.count * sizeof(fresh.dev[0])) != 0)
+            {
+                ESP_LOGW(TAG, "Vollscan: Bus hat sich geaendert -> Cache neu");
+                i2c_scan_cache_clear();
+                i2c_scanner();
+            }
+            continue;
+        }
+
+        /* sonst nur die bekannten Adressen pruefen (billig) */
+        if (!i2c_scan_verify(&s_map, I2C_PROBE_TIMEOUT_MS, &res))
+        {
+            ESP_LOGW(TAG, "Bus hat sich geaendert -> neuer Scan");
+            i2c_scan_cache_clear();
+            i2c_scanner();
+        }
     }
 }
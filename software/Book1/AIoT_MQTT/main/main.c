@@ -22,7 +22,9 @@
  * 3) Connect to Wi-Fi (Station mode) and wait until an IP is obtained (DHCP)
  * 4) Start MQTT client only AFTER network is ready
  * 5) Publish a status message periodically
- * 6) Subscribe to a command topic and print received messages
+ * 6) Subscribe to a command topic and answer the commands
+ * 7) Stay connected at low power: automatic light sleep + Wi-Fi modem sleep,
+ *    full speed only while an MQTT exchange is running (PM lock)
  *
  * WHY THIS STRUCTURE?
  * -------------------
@@ -30,6 +32,26 @@
  *   tcpip_send_msg_wait_sem ... (Invalid mbox)
  * Therefore we enforce the correct order:
  *   Wi-Fi connected + GOT_IP  -> then MQTT start.
+ *
+ * WHY NOT DEEP SLEEP?
+ * -------------------
+ * A deep sleep node reconnects on every wake (Wi-Fi + DHCP + TCP + MQTT,
+ * about a second at ~100 mA) and only sees commands while it is awake.
+ * This node keeps the session and still sleeps between the packets:
+ *
+ *   esp_pm_configure()       automatic light sleep whenever all tasks block,
+ *                            CPU down to 40 MHz when awake but idle
+ *   WIFI_PS_MAX_MODEM        radio off between beacons, it listens every
+ *                            WIFI_LISTEN_INTERVAL beacons (~102 ms each)
+ *   PM lock (CPU_FREQ_MAX)   held from publish to PUBACK and from command
+ *                            in to reply out, nothing else keeps it awake
+ *
+ * A command waits at the AP until the node listens again, so the listen
+ * interval is the latency knob: 3 -> up to ~0.3 s more, 10 -> ~1 s.
+ * Every status message carries the residency of the last period (held /
+ * awake / light sleep) and the current estimated from it (pm_duty.h);
+ * tools/cmd_latency.py measures the command round trip from a PC.
+ * "ps=<0..3>" switches the modem sleep at runtime to compare both.
  */
 
 #include <stdio.h>
@@ -41,13 +63,20 @@
 
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_attr.h"
+#include "esp_pm.h"
+#include "esp_timer.h"
 #include "nvs_flash.h"
 
 #include "esp_event.h"
 #include "esp_netif.h"
-#include "esp_wifi.h"
 
+#include "sdkconfig.h"
 #include "mqtt_client.h"
+#include "mqtt_ack.h"
+#include "mqtt_cmd.h"
+#include "net_conn.h"
+#include "pm_duty.h"
 
 /* --------------------------------------------------------------------------
  * USER CONFIGURATION
@@ -62,22 +91,28 @@
 /* Topic naming: keep it stable across projects */
 #define MQTT_TOPIC_STATUS  "aiot/node1/status"
 #define MQTT_TOPIC_CMD     "aiot/node1/cmd"
+#define MQTT_TOPIC_EVENT   "aiot/node1/event"
 
-#define WIFI_MAX_RETRY     10
+#define WIFI_BACKOFF_MAX_MS 30000
 #define PUBLISH_PERIOD_MS  5000
+#define ACK_WAIT_MS        3000
 
-static const char *TAG = "PROJECT18";
-
-/* --------------------------------------------------------------------------
- * WIFI STATE (EventGroup)
- * -------------------------------------------------------------------------- */
-
-static EventGroupHandle_t s_wifi_event_group;
+/*
+ * Low-power profile (see WHY NOT DEEP SLEEP above). 0 = CPU and radio
+ * always on, as before; the status still reports the residency, so both
+ * profiles can be compared with the same tools.
+ */
+#define LOW_POWER_PROFILE     1
+#define PM_MAX_FREQ_MHZ       160
+#define PM_MIN_FREQ_MHZ       40        /* XTAL */
+#define WIFI_LISTEN_INTERVAL  3
+#define PM_BOARD              PM_DUTY_BOARD_ESP32S3_DEFAULT
 
-#define WIFI_CONNECTED_BIT BIT0   /* Wi-Fi connected + got IP */
-#define WIFI_FAIL_BIT      BIT1   /* Wi-Fi failed after retries */
+#if LOW_POWER_PROFILE && !(CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE)
+#error "LOW_POWER_PROFILE needs CONFIG_PM_ENABLE and tickless idle (see sdkconfig.defaults)"
+#endif
 
-static int s_retry_count = 0;
+static const char *TAG = "PROJECT18";
 
 /* --------------------------------------------------------------------------
  * MQTT STATE
@@ -86,91 +121,164 @@ static int s_retry_count = 0;
 static esp_mqtt_client_handle_t s_mqtt_client = NULL;
 
 /* --------------------------------------------------------------------------
- * WIFI EVENT HANDLER
+ * POWER MANAGEMENT
  * -------------------------------------------------------------------------- */
 
+static esp_pm_lock_handle_t s_pm_lock = NULL;
+static const pm_duty_board_t s_board = PM_BOARD;
+
 /*
- * Handles:
- * - WIFI_EVENT_STA_START        -> start connect()
- * - WIFI_EVENT_STA_DISCONNECTED -> reconnect with retry count
- * - IP_EVENT_STA_GOT_IP         -> signal "network ready"
+ * s_duty is updated from the MQTT task and the publish loop. s_light_us is
+ * only written while every core is idle (light sleep exit), so a reader
+ * inside the critical section always sees a whole value.
  */
-static void wifi_event_handler(void *arg,
-                               esp_event_base_t event_base,
-                               int32_t event_id,
-                               void *event_data)
+static pm_duty_t s_duty;
+static portMUX_TYPE s_duty_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile uint64_t s_light_us = 0;
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+static esp_err_t IRAM_ATTR on_light_sleep_exit(int64_t sleep_time_us, void *arg)
 {
     (void)arg;
+    s_light_us += (uint64_t)sleep_time_us;
+    return ESP_OK;
+}
+#endif
 
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        ESP_LOGI(TAG, "Wi-Fi started, connecting...");
-        esp_wifi_connect();
-        return;
-    }
-
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        if (s_retry_count < WIFI_MAX_RETRY) {
-            s_retry_count++;
-            ESP_LOGW(TAG, "Disconnected. Retry %d/%d", s_retry_count, WIFI_MAX_RETRY);
-            esp_wifi_connect();
-        } else {
-            ESP_LOGE(TAG, "Wi-Fi connect failed after %d retries", WIFI_MAX_RETRY);
-            xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
-        }
-        return;
-    }
+static void power_init(void)
+{
+#if LOW_POWER_PROFILE
+    esp_pm_config_t pm = {
+        .max_freq_mhz = PM_MAX_FREQ_MHZ,
+        .min_freq_mhz = PM_MIN_FREQ_MHZ,
+        .light_sleep_enable = true,
+    };
+    ESP_ERROR_CHECK(esp_pm_configure(&pm));
+    ESP_ERROR_CHECK(esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "mqtt", &s_pm_lock));
 
-    if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
-        ip_event_got_ip_t *event = (ip_event_got_ip_t *)event_data;
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+    esp_pm_sleep_cbs_register_config_t cbs = {
+        .exit_cb = on_light_sleep_exit,
+    };
+    ESP_ERROR_CHECK(esp_pm_light_sleep_register_cbs(&cbs));
+#else
+    ESP_LOGW(TAG, "No CONFIG_PM_LIGHT_SLEEP_CALLBACKS: light sleep is reported as awake");
+#endif
+    ESP_LOGI(TAG, "Automatic light sleep on (%d..%d MHz)", PM_MIN_FREQ_MHZ, PM_MAX_FREQ_MHZ);
+#endif
+
+    pm_duty_start(&s_duty, esp_timer_get_time(), 0);
+}
 
-        ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
-        s_retry_count = 0;
+/* Full speed, no light sleep: one MQTT exchange starts */
+static void pm_hold(void)
+{
+    if (s_pm_lock) {
+        esp_pm_lock_acquire(s_pm_lock);
+    }
+    taskENTER_CRITICAL(&s_duty_lock);
+    pm_duty_hold(&s_duty, esp_timer_get_time());
+    taskEXIT_CRITICAL(&s_duty_lock);
+}
 
-        /* Network is ready -> allow MQTT start */
-        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
-        return;
+static void pm_release(void)
+{
+    taskENTER_CRITICAL(&s_duty_lock);
+    pm_duty_release(&s_duty, esp_timer_get_time());
+    taskEXIT_CRITICAL(&s_duty_lock);
+    if (s_pm_lock) {
+        esp_pm_lock_release(s_pm_lock);
     }
 }
 
+static void pm_report(pm_duty_report_t *out)
+{
+    taskENTER_CRITICAL(&s_duty_lock);
+    pm_duty_report(&s_duty, &s_board, esp_timer_get_time(), s_light_us, out);
+    taskEXIT_CRITICAL(&s_duty_lock);
+}
+
 /* --------------------------------------------------------------------------
  * WIFI INITIALIZATION
  * -------------------------------------------------------------------------- */
 
+/*
+ * The event handling (connect, retry with backoff, GOT_IP) lives in the
+ * shared component components/aiot_net. This node runs forever, so it
+ * never gives up: retries are unlimited, the pause grows up to 30 s.
+ */
 static void wifi_init_and_connect(void)
 {
-    s_wifi_event_group = xEventGroupCreate();
+    net_conn_config_t cfg = {
+        .ssid = WIFI_SSID,
+        .password = WIFI_PASS,
+        .max_retries = 0,
+        .backoff_max_ms = WIFI_BACKOFF_MAX_MS,
+#if LOW_POWER_PROFILE
+        .power_save = NET_CONN_PS_MAX_MODEM,
+        .listen_interval = WIFI_LISTEN_INTERVAL,
+#endif
+    };
+    ESP_ERROR_CHECK(net_conn_start(&cfg));
 
-    /* 1) TCP/IP stack */
-    ESP_ERROR_CHECK(esp_netif_init());
+    ESP_LOGI(TAG, "Wi-Fi init done");
+}
 
-    /* 2) Default event loop */
-    ESP_ERROR_CHECK(esp_event_loop_create_default());
+/* --------------------------------------------------------------------------
+ * COMMANDS
+ * -------------------------------------------------------------------------- */
 
-    /* 3) Create default station interface */
-    esp_netif_create_default_wifi_sta();
+/*
+ * "ping;req=7" -> "event=pong;req=7" on MQTT_TOPIC_EVENT: the round trip
+ * that tools/cmd_latency.py measures.
+ */
+static void cmd_ping(const mqtt_cmd_t *cmd, char *reply, size_t reply_len, void *ctx)
+{
+    (void)cmd; (void)ctx;
+    snprintf(reply, reply_len, "event=pong");
+}
 
-    /* 4) Init Wi-Fi driver */
-    wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
-    ESP_ERROR_CHECK(esp_wifi_init(&cfg));
+/* ps=<0..3>: Wi-Fi modem sleep, net_conn_ps_t (3 = max_modem) */
+static void cmd_ps(const mqtt_cmd_t *cmd, char *reply, size_t reply_len, void *ctx)
+{
+    (void)ctx;
+    esp_err_t err = net_conn_set_power_save((net_conn_ps_t)cmd->ival);
+    if (err != ESP_OK) {
+        snprintf(reply, reply_len, "event=err;reason=ps;err=%s", esp_err_to_name(err));
+        return;
+    }
+    snprintf(reply, reply_len, "event=ps_set;mode=%s", net_conn_ps_name((net_conn_ps_t)cmd->ival));
+}
 
-    /* 5) Register handlers */
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(
-        WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL, NULL));
+static const mqtt_cmd_def_t s_cmds[] = {
+    { "ping", MQTT_CMD_ARG_NONE, 0, 0,                     cmd_ping, NULL },
+    { "ps",   MQTT_CMD_ARG_INT,  0, NET_CONN_PS_MAX_MODEM, cmd_ps,   "bad_ps" },
+};
 
-    ESP_ERROR_CHECK(esp_event_handler_instance_register(
-        IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL, NULL));
+static void cmd_reply(const char *reply, void *ctx)
+{
+    (void)ctx;
+    mqtt_ack_publish(s_mqtt_client, MQTT_TOPIC_EVENT, reply, 0, 1, 0);
+}
 
-    /* 6) Configure credentials */
-    wifi_config_t wifi_config = {0};
-    strncpy((char *)wifi_config.sta.ssid, WIFI_SSID, sizeof(wifi_config.sta.ssid));
-    strncpy((char *)wifi_config.sta.password, WIFI_PASS, sizeof(wifi_config.sta.password));
+/*
+ * The lock covers parsing, handler and writing the reply to the socket;
+ * its PUBACK is waited for by the publish loop, not here (this is the
+ * MQTT task, which has to process that PUBACK).
+ */
+static void handle_cmd(esp_mqtt_event_handle_t event)
+{
+    int64_t t_in = esp_timer_get_time();
 
-    /* 7) Start station */
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-    ESP_ERROR_CHECK(esp_wifi_start());
+    pm_hold();
+    ESP_LOGI(TAG, "CMD: %.*s", event->data_len, event->data);
+    mqtt_cmd_dispatch(s_cmds, sizeof(s_cmds) / sizeof(s_cmds[0]),
+                      event->data, (size_t)event->data_len, cmd_reply, NULL);
 
-    ESP_LOGI(TAG, "Wi-Fi init done");
+    taskENTER_CRITICAL(&s_duty_lock);
+    pm_duty_cmd(&s_duty, (uint32_t)(esp_timer_get_time() - t_in));
+    taskEXIT_CRITICAL(&s_duty_lock);
+    pm_release();
 }
 
 /* --------------------------------------------------------------------------
@@ -179,7 +287,7 @@ static void wifi_init_and_connect(void)
 
 /*
  * Called by ESP-IDF MQTT stack.
- * We subscribe after connecting, and log incoming messages.
+ * We subscribe after connecting, and answer incoming commands.
  */
 static void mqtt_event_handler(void *handler_args,
                                esp_event_base_t base,
@@ -191,6 +299,8 @@ static void mqtt_event_handler(void *handler_args,
 
     esp_mqtt_event_handle_t event = (esp_mqtt_event_handle_t)event_data;
 
+    mqtt_ack_on_event(event);
+
     switch ((esp_mqtt_event_id_t)event_id)
     {
         case MQTT_EVENT_CONNECTED:
@@ -213,7 +323,7 @@ static void mqtt_event_handler(void *handler_args,
         case MQTT_EVENT_DATA:
             /* Data is not null-terminated: use length printing */
             ESP_LOGI(TAG, "MQTT RX topic: %.*s", event->topic_len, event->topic);
-            ESP_LOGI(TAG, "MQTT RX data : %.*s", event->data_len, event->data);
+            handle_cmd(event);
             break;
 
         default:
@@ -231,6 +341,7 @@ static void mqtt_start(void)
         .broker.address.uri = MQTT_BROKER_URI,
     };
 
+    ESP_ERROR_CHECK(mqtt_ack_init());
     s_mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
 
     esp_mqtt_client_register_event(s_mqtt_client,
@@ -261,19 +372,14 @@ void app_main(void)
         ESP_ERROR_CHECK(ret);
     }
 
+    /* 0) Light sleep + PM lock before the radio starts */
+    power_init();
+
     /* 1) Init Wi-Fi and connect */
     wifi_init_and_connect();
 
-    /* 2) Wait until we either got IP (success) or failed */
-    EventBits_t bits = xEventGroupWaitBits(
-        s_wifi_event_group,
-        WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-        pdFALSE,
-        pdFALSE,
-        portMAX_DELAY
-    );
-
-    if (bits & WIFI_CONNECTED_BIT) {
+    /* 2) Wait until we got IP (success) or gave up */
+    if (net_conn_wait_ready(portMAX_DELAY) == ESP_OK) {
         ESP_LOGI(TAG, "Network ready (Wi-Fi connected + IP). Starting MQTT...");
         mqtt_start();
     } else {
@@ -284,20 +390,35 @@ void app_main(void)
 
     /* 3) Periodic publish loop */
     while (1) {
-        const char *payload = "device alive";
+        /* residency and current of the period since the last publish */
+        pm_duty_report_t duty;
+        char stats[128];
+        char payload[192];
+
+        pm_report(&duty);
+        pm_duty_format(&duty, stats, sizeof(stats));
+        snprintf(payload, sizeof(payload), "device alive;%s", stats);
 
         ESP_LOGI(TAG, "Publishing to %s: %s", MQTT_TOPIC_STATUS, payload);
 
         /*
          * QoS=1 for "at least once" delivery.
          * retain=0 so broker does not retain this as last will.
+         * Full speed until the PUBACK (and command replies) are in, then
+         * the node may light sleep until the next period.
          */
-        esp_mqtt_client_publish(s_mqtt_client,
-                                MQTT_TOPIC_STATUS,
-                                payload,
-                                0,
-                                1,
-                                0);
+        pm_hold();
+        mqtt_ack_publish(s_mqtt_client,
+                         MQTT_TOPIC_STATUS,
+                         payload,
+                         0,
+                         1,
+                         0);
+        esp_err_t ack = mqtt_ack_wait_all(pdMS_TO_TICKS(ACK_WAIT_MS));
+        if (ack != ESP_OK) {
+            ESP_LOGW(TAG, "Status not acked (%s), releasing the PM lock", esp_err_to_name(ack));
+        }
+        pm_release();
 
         vTaskDelay(pdMS_TO_TICKS(PUBLISH_PERIOD_MS));
     }
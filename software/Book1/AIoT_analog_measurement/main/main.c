@@ -21,12 +21,15 @@
  * Analog measurement using ADC1 (GPIO2)
  *
  * Functions:
- *  - initialize ADC1
- *  - configure ADC channel
- *  - perform oversampling
- *  - average samples
+ *  - initialize ADC1 in continuous (DMA) mode
+ *  - sample GPIO2 at a fixed rate without CPU involvement
+ *  - average each DMA frame (oversampling)
  *  - convert raw values to millivolts
  *  - print measurement results periodically
+ *
+ * The acquisition engine lives in components/aiot_adc_stream.
+ * While the DMA fills the next frame, app_main() simply blocks on a queue,
+ * so the CPU is free for other tasks (or idle / light sleep).
  */
 /*
  * Reference measurement setup:
@@ -39,13 +42,16 @@
 #include <stdio.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
 #include "esp_log.h"
 #include "esp_err.h"
 
-#include "esp_adc/adc_oneshot.h"
 #include "esp_adc/adc_cali.h"
 #include "esp_adc/adc_cali_scheme.h"
 
+#include "adc_stream.h"
+#include "dsp_filter.h"
+
 /* ADC configuration */
 #define ADC_UNIT_USED          ADC_UNIT_1
 #define ADC_CHANNEL_USED       ADC_CHANNEL_1      // GPIO2
@@ -53,8 +59,14 @@
 #define ADC_BITWIDTH_CONFIG    ADC_BITWIDTH_DEFAULT
 
 /* measurement configuration */
-#define ADC_SAMPLES            64
-#define ADC_PERIOD_MS          500
+#define ADC_SAMPLE_FREQ_HZ     20000              // DMA sample rate
+#define ADC_SAMPLES            1024               // samples per frame (averaged)
+#define ADC_PERIOD_MS          500                // log interval
+#define ADC_QUEUE_LEN          4
+
+/* post filter on frame averages (~20 Hz): median-of-3 + 2 Hz low-pass */
+#define ADC_FRAME_RATE_HZ      ((float)ADC_SAMPLE_FREQ_HZ / ADC_SAMPLES)
+#define ADC_LP_CUTOFF_HZ       2.0f
 
 static const char *TAG = "PROJECT15";
 
@@ -101,23 +113,7 @@ void app_main(void)
 {
     ESP_LOGI(TAG, "PROJECT 15 - ADC measurement starting");
 
-    /* create ADC unit */
-    adc_oneshot_unit_handle_t adc_handle;
-    adc_oneshot_unit_init_cfg_t init_config = {
-        .unit_id = ADC_UNIT_USED,
-    };
-    ESP_ERROR_CHECK(adc_oneshot_new_unit(&init_config, &adc_handle));
-
-    /* configure ADC channel */
-    adc_oneshot_chan_cfg_t chan_config = {
-        .atten = ADC_ATTENUATION,
-        .bitwidth = ADC_BITWIDTH_CONFIG
-    };
-    ESP_ERROR_CHECK(adc_oneshot_config_channel(adc_handle,
-                                               ADC_CHANNEL_USED,
-                                               &chan_config));
-
-    /* enable calibration */
+    /* enable calibration (owned by us, used by the stream engine) */
     adc_cali_handle_t cali_handle = NULL;
     bool calibration_enabled = adc_create_calibration(ADC_UNIT_USED,
                                                       ADC_ATTENUATION,
@@ -126,38 +122,73 @@ void app_main(void)
     ESP_LOGI(TAG, "ADC calibration: %s",
              calibration_enabled ? "enabled" : "not available");
 
+    /* averaged frames are delivered through this queue */
+    QueueHandle_t results = xQueueCreate(ADC_QUEUE_LEN, sizeof(adc_stream_result_t));
+    if (!results) {
+        ESP_LOGE(TAG, "Out of memory");
+        return;
+    }
+
+    adc_stream_config_t stream_cfg = {
+        .unit = ADC_UNIT_USED,
+        .channel = ADC_CHANNEL_USED,
+        .atten = ADC_ATTENUATION,
+        .sample_freq_hz = ADC_SAMPLE_FREQ_HZ,
+        .frame_samples = ADC_SAMPLES,
+        .cali = NULL,              /* converted after the post filter */
+        .result_queue = results,
+    };
+
+    adc_stream_handle_t stream = NULL;
+    ESP_ERROR_CHECK(adc_stream_new(&stream_cfg, &stream));
+    ESP_ERROR_CHECK(adc_stream_start(stream));
+
+    /* fixed-point post filter, all state is static (no heap) */
+    static dsp_chain_t filter;
+    dsp_chain_init(&filter);
+    dsp_chain_add_median(&filter, 3);
+    dsp_chain_add_iir_lowpass(&filter, dsp_iir_alpha_q15(ADC_LP_CUTOFF_HZ, ADC_FRAME_RATE_HZ));
+
+    int64_t next_log_us = 0;
+
     while (1)
     {
-        int raw_sum = 0;
-
-        /* oversampling loop */
-        for (int i = 0; i < ADC_SAMPLES; i++) {
-            int raw = 0;
-            ESP_ERROR_CHECK(adc_oneshot_read(adc_handle,
-                                             ADC_CHANNEL_USED,
-                                             &raw));
-            raw_sum += raw;
+        adc_stream_result_t r;
+
+        /* CPU is idle here while DMA samples */
+        if (xQueueReceive(results, &r, portMAX_DELAY) != pdTRUE) {
+            continue;
         }
 
-        int raw_avg = raw_sum / ADC_SAMPLES;
+        int16_t filtered = (int16_t)r.raw_avg;
+        dsp_chain_process(&filter, (int16_t)r.raw_avg, &filtered);
+
+        /* frames arrive at ~20 Hz, print only every ADC_PERIOD_MS */
+        if (r.timestamp_us < next_log_us) {
+            continue;
+        }
+        next_log_us = r.timestamp_us + (int64_t)ADC_PERIOD_MS * 1000;
 
         if (calibration_enabled) {
             int voltage_mv = 0;
             ESP_ERROR_CHECK(adc_cali_raw_to_voltage(cali_handle,
-                                                    raw_avg,
+                                                    filtered,
                                                     &voltage_mv));
 
             ESP_LOGI(TAG,
-                     "ADC raw(avg)=%d  ->  %d mV",
-                     raw_avg,
-                     voltage_mv);
+                     "ADC raw(avg of %lu)=%d filtered=%d  ->  %d mV  (overruns=%lu)",
+                     (unsigned long)r.samples,
+                     r.raw_avg,
+                     filtered,
+                     voltage_mv,
+                     (unsigned long)r.overruns);
         }
         else {
             ESP_LOGI(TAG,
-                     "ADC raw(avg)=%d (no calibration)",
-                     raw_avg);
+                     "ADC raw(avg of %lu)=%d filtered=%d (no calibration)",
+                     (unsigned long)r.samples,
+                     r.raw_avg,
+                     filtered);
         }
-
-        vTaskDelay(pdMS_TO_TICKS(ADC_PERIOD_MS));
     }
 }
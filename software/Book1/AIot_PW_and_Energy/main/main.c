@@ -25,31 +25,152 @@
  ******************************************************************************/
 
 #include <stdio.h>
+#include <sys/time.h>
 #include "esp_sleep.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
+#include "sdkconfig.h"
+#include "wake_stub.h"
+#include "energy_acct.h"
+#if CONFIG_ULP_COPROC_TYPE_RISCV
+#include "ulp_monitor.h"
+#endif
+
 #define SLEEP_TIME_SEC 10
 
+/*
+ * Who decides that the main CPU boots?
+ *
+ *   WAKE_MODE_TIMER  every SLEEP_TIME_SEC, the main CPU does everything
+ *   WAKE_MODE_STUB   the wake stub reads ADC1 channel 1 (GPIO2) before the
+ *                    bootloader and only boots when the reading moved or
+ *                    every 6th wake (wake_stub.h)
+ *   WAKE_MODE_ULP    the ULP RISC-V core reads GPIO2 every second and
+ *                    wakes the main CPU on a threshold crossing or after
+ *                    ULP_BATCH readings (ulp_monitor.h, needs the ULP
+ *                    settings in sdkconfig.defaults)
+ *
+ * Compare the log: in the last two modes most wakes print nothing.
+ * tools/ulp_energy.py estimates the current of each mode per hour.
+ */
+#define WAKE_MODE_TIMER     0
+#define WAKE_MODE_STUB      1
+#define WAKE_MODE_ULP       2
+
+#define WAKE_MODE           WAKE_MODE_STUB
+#define WAKE_ADC_CHANNEL    ADC_CHANNEL_1
+
+#define ULP_PERIOD_US       1000000
+#define ULP_BATCH           300         /* readings per window: 5 min */
+#define ULP_LOW_RAW         400         /* ~0.3 V at 12 dB */
+#define ULP_HIGH_RAW        3700        /* ~2.8 V */
+#define ULP_HYST_RAW        50
+
+/*
+ * Energy account (energy_acct.h): every wake books its time per power
+ * state and logs the charge of the previous cycle and the sum since
+ * power-on. Put the currents you measured on your board in the table.
+ * The active phase is a vTaskDelay: with automatic light sleep
+ * (CONFIG_PM_ENABLE + tickless idle) it is booked as light sleep.
+ */
+#define ENERGY_BOARD        ENERGY_BOARD_ESP32S3_DEFAULT
+
+#if CONFIG_PM_ENABLE && CONFIG_FREERTOS_USE_TICKLESS_IDLE
+#define ACTIVE_PHASE_STATE  ENERGY_LIGHT_SLEEP
+#else
+#define ACTIVE_PHASE_STATE  ENERGY_CPU
+#endif
+
+#if WAKE_MODE == WAKE_MODE_ULP && !CONFIG_ULP_COPROC_TYPE_RISCV
+#error "WAKE_MODE_ULP needs CONFIG_ULP_COPROC_TYPE_RISCV (see sdkconfig.defaults)"
+#endif
+
 static const char *TAG = "PROJECT16";
 
+static RTC_DATA_ATTR energy_acct_t s_energy;
+static const energy_board_t s_board = ENERGY_BOARD;
+
+/* clock that keeps running through deep sleep */
+static int64_t wall_us(void)
+{
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return (int64_t)tv.tv_sec * 1000000 + tv.tv_usec;
+}
+
 void app_main(void)
 {
     esp_sleep_wakeup_cause_t cause = esp_sleep_get_wakeup_cause();
 
+    energy_acct_init(&s_energy);
+    energy_acct_begin(&s_energy, wall_us(), esp_timer_get_time());
+
+    char line[160];
+    if (energy_acct_format(&s_energy, line, sizeof(line)))
+        ESP_LOGI(TAG, "Energy ms/uAh: %s", line);
+
     if (cause == ESP_SLEEP_WAKEUP_TIMER)
         ESP_LOGI(TAG, "Wakeup from timer");
     else
         ESP_LOGI(TAG, "Normal startup");
 
+#if WAKE_MODE == WAKE_MODE_STUB
+    wake_stub_result_t stub;
+    wake_stub_get_result(&stub);
+    if (stub.valid)
+        ESP_LOGI(TAG, "Wake stub: boot by %s (raw %u), %lu wakes skipped",
+                 wake_stub_verdict_name(stub.verdict), (unsigned)stub.raw,
+                 (unsigned long)stub.skipped);
+#elif WAKE_MODE == WAKE_MODE_ULP
+    if (ulp_monitor_woke_us()) {
+        ulp_monitor_stats_t st;
+        ulp_monitor_collect(&st);
+        ESP_LOGI(TAG, "ULP wake (%s): n=%lu min=%u max=%u mean=%u last=%u",
+                 ulp_monitor_wake_name(st.wake), (unsigned long)st.n,
+                 (unsigned)st.min, (unsigned)st.max, (unsigned)st.mean, (unsigned)st.last);
+    } else {
+        ulp_monitor_config_t ulp = {
+            .channel = WAKE_ADC_CHANNEL,
+            .atten = ADC_ATTEN_DB_12,
+            .period_us = ULP_PERIOD_US,
+            .low_raw = ULP_LOW_RAW,
+            .high_raw = ULP_HIGH_RAW,
+            .hyst_raw = ULP_HYST_RAW,
+            .batch = ULP_BATCH,
+        };
+        ESP_ERROR_CHECK(ulp_monitor_start(&ulp));
+    }
+#endif
+
     ESP_LOGI(TAG, "Active phase running");
 
+    energy_acct_enter(&s_energy, ACTIVE_PHASE_STATE, esp_timer_get_time());
     vTaskDelay(pdMS_TO_TICKS(3000));
+    energy_acct_enter(&s_energy, ENERGY_CPU, esp_timer_get_time());
 
+#if WAKE_MODE == WAKE_MODE_ULP
+    /* no timer: the ULP decides */
+    ESP_LOGI(TAG, "Entering deep sleep until the ULP wakes us");
+    ulp_monitor_resume();
+#else
     ESP_LOGI(TAG, "Entering deep sleep for %d seconds", SLEEP_TIME_SEC);
-
     esp_sleep_enable_timer_wakeup((uint64_t)SLEEP_TIME_SEC * 1000000ULL);
+#endif
+
+#if WAKE_MODE == WAKE_MODE_STUB
+    wake_stub_config_t cfg = {
+        .channel = WAKE_ADC_CHANNEL,
+        .atten = ADC_ATTEN_DB_12,
+        .heartbeat = 6,                 /* delta: default */
+        .period_us = (uint64_t)SLEEP_TIME_SEC * 1000000ULL,
+    };
+    wake_stub_arm(&cfg);
+#endif
 
+    energy_acct_end(&s_energy, &s_board, esp_timer_get_time(), wall_us());
     esp_deep_sleep_start();
 }
@@ -0,0 +1,332 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: continuous (DMA) ADC acquisition engine
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "soc/soc_caps.h"
+
+#include "adc_stream.h"
+
+static const char *TAG = "ADC_STREAM";
+
+/*
+ * Output format of the DMA result words depends on the chip.
+ * ESP32-S3 / C3 use TYPE2 (channel + 12 bit data in one 32 bit word).
+ */
+#if CONFIG_IDF_TARGET_ESP32 || CONFIG_IDF_TARGET_ESP32S2
+#define ADC_STREAM_OUTPUT_TYPE          ADC_DIGI_OUTPUT_FORMAT_TYPE1
+#define ADC_STREAM_GET_CHANNEL(p)       ((p)->type1.channel)
+#define ADC_STREAM_GET_DATA(p)          ((p)->type1.data)
+#else
+#define ADC_STREAM_OUTPUT_TYPE          ADC_DIGI_OUTPUT_FORMAT_TYPE2
+#define ADC_STREAM_GET_CHANNEL(p)       ((p)->type2.channel)
+#define ADC_STREAM_GET_DATA(p)          ((p)->type2.data)
+#endif
+
+#define ADC_STREAM_TASK_STACK           3072
+#define ADC_STREAM_TASK_PRIO_DEFAULT    5
+
+/* Driver pool holds two frames: one being filled by DMA, one being processed */
+#define ADC_STREAM_POOL_FRAMES          2
+
+struct adc_stream_s {
+    adc_stream_config_t          cfg;
+    adc_continuous_handle_t      adc;
+    TaskHandle_t                 task;
+    SemaphoreHandle_t            done;      /* given by the worker on its way out */
+    uint8_t                     *frame;
+    uint32_t                     frame_bytes;
+    volatile uint32_t            overruns;
+    volatile bool                running;
+    volatile bool                quit;
+};
+
+/* --------------------------------------------------------------------------
+ * Frame reduction (pure, no driver access)
+ * -------------------------------------------------------------------------- */
+
+uint32_t adc_stream_reduce_frame(const uint8_t *frame, uint32_t len,
+                                 adc_channel_t channel, uint32_t *out_sum)
+{
+    uint32_t sum = 0;
+    uint32_t count = 0;
+
+    for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= len; i += SOC_ADC_DIGI_RESULT_BYTES) {
+        const adc_digi_output_data_t *p = (const adc_digi_output_data_t *)&frame[i];
+        if (ADC_STREAM_GET_CHANNEL(p) != (uint32_t)channel) {
+            continue;
+        }
+        sum += ADC_STREAM_GET_DATA(p);
+        count++;
+    }
+
+    if (out_sum) {
+        *out_sum = sum;
+    }
+    return count;
+}
+
+/* --------------------------------------------------------------------------
+ * Driver callbacks (ISR context)
+ * -------------------------------------------------------------------------- */
+
+static bool IRAM_ATTR on_conv_done(adc_continuous_handle_t adc,
+                                   const adc_continuous_evt_data_t *edata,
+                                   void *user_data)
+{
+    (void)adc; (void)edata;
+    struct adc_stream_s *s = (struct adc_stream_s *)user_data;
+    BaseType_t must_yield = pdFALSE;
+
+    vTaskNotifyGiveFromISR(s->task, &must_yield);
+    return (must_yield == pdTRUE);
+}
+
+static bool IRAM_ATTR on_pool_ovf(adc_continuous_handle_t adc,
+                                  const adc_continuous_evt_data_t *edata,
+                                  void *user_data)
+{
+    (void)adc; (void)edata;
+    struct adc_stream_s *s = (struct adc_stream_s *)user_data;
+    s->overruns++;
+    return false;
+}
+
+/* --------------------------------------------------------------------------
+ * Worker task: sleeps until DMA reports a full frame
+ * -------------------------------------------------------------------------- */
+
+static void adc_stream_deliver(struct adc_stream_s *s, uint32_t sum, uint32_t count)
+{
+    adc_stream_result_t r = {
+        .raw_avg = (int)(sum / count),
+        .voltage_mv = -1,
+        .samples = count,
+        .overruns = s->overruns,
+        .timestamp_us = esp_timer_get_time(),
+    };
+
+    if (s->cfg.cali) {
+        int mv = 0;
+        if (adc_cali_raw_to_voltage(s->cfg.cali, r.raw_avg, &mv) == ESP_OK) {
+            r.voltage_mv = mv;
+        }
+    }
+
+    if (s->cfg.on_result) {
+        s->cfg.on_result(&r, s->cfg.user_ctx);
+    }
+    if (s->cfg.result_queue) {
+        /* never block the engine: drop the oldest result if consumer is slow */
+        if (xQueueSend(s->cfg.result_queue, &r, 0) != pdTRUE) {
+            adc_stream_result_t dropped;
+            xQueueReceive(s->cfg.result_queue, &dropped, 0);
+            xQueueSend(s->cfg.result_queue, &r, 0);
+        }
+    }
+}
+
+static void adc_stream_task(void *arg)
+{
+    struct adc_stream_s *s = (struct adc_stream_s *)arg;
+
+    while (!s->quit) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        /* drain everything the driver has buffered so far */
+        while (s->running) {
+            uint32_t got = 0;
+            esp_err_t err = adc_continuous_read(s->adc, s->frame, s->frame_bytes, &got, 0);
+            if (err != ESP_OK) {
+                break;  /* ESP_ERR_TIMEOUT: no complete frame left */
+            }
+
+            uint32_t sum = 0;
+            uint32_t count = adc_stream_reduce_frame(s->frame, got, s->cfg.channel, &sum);
+            if (count > 0) {
+                adc_stream_deliver(s, sum, count);
+            }
+        }
+    }
+
+    /* last access to s: after this the deleter may free it */
+    xSemaphoreGive(s->done);
+    vTaskDelete(NULL);
+}
+
+/* Make the worker leave its loop and wait until it no longer touches s */
+static void adc_stream_join(struct adc_stream_s *s)
+{
+    s->quit = true;
+    xTaskNotifyGive(s->task);
+    xSemaphoreTake(s->done, portMAX_DELAY);
+}
+
+/* --------------------------------------------------------------------------
+ * Public API
+ * -------------------------------------------------------------------------- */
+
+esp_err_t adc_stream_new(const adc_stream_config_t *cfg, adc_stream_handle_t *out_handle)
+{
+    if (!cfg || !out_handle || cfg->frame_samples == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (cfg->sample_freq_hz < SOC_ADC_SAMPLE_FREQ_THRES_LOW ||
+        cfg->sample_freq_hz > SOC_ADC_SAMPLE_FREQ_THRES_HIGH) {
+        ESP_LOGE(TAG, "sample_freq_hz %lu out of range (%d..%d)",
+                 (unsigned long)cfg->sample_freq_hz,
+                 SOC_ADC_SAMPLE_FREQ_THRES_LOW, SOC_ADC_SAMPLE_FREQ_THRES_HIGH);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct adc_stream_s *s = calloc(1, sizeof(*s));
+    if (!s) {
+        return ESP_ERR_NO_MEM;
+    }
+    s->cfg = *cfg;
+    s->frame_bytes = cfg->frame_samples * SOC_ADC_DIGI_RESULT_BYTES;
+
+    /* frame buffer is allocated once, never per sample or per frame */
+    s->frame = malloc(s->frame_bytes);
+    if (!s->frame) {
+        free(s);
+        return ESP_ERR_NO_MEM;
+    }
+
+    adc_continuous_handle_cfg_t handle_cfg = {
+        .max_store_buf_size = s->frame_bytes * ADC_STREAM_POOL_FRAMES,
+        .conv_frame_size = s->frame_bytes,
+    };
+    esp_err_t err = adc_continuous_new_handle(&handle_cfg, &s->adc);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "adc_continuous_new_handle failed: %s", esp_err_to_name(err));
+        free(s->frame);
+        free(s);
+        return err;
+    }
+
+    adc_digi_pattern_config_t pattern = {
+        .atten = cfg->atten,
+        .channel = cfg->channel & 0x7,
+        .unit = cfg->unit,
+        .bit_width = SOC_ADC_DIGI_MAX_BITWIDTH,
+    };
+    adc_continuous_config_t dig_cfg = {
+        .pattern_num = 1,
+        .adc_pattern = &pattern,
+        .sample_freq_hz = cfg->sample_freq_hz,
+        .conv_mode = (cfg->unit == ADC_UNIT_1) ? ADC_CONV_SINGLE_UNIT_1 : ADC_CONV_SINGLE_UNIT_2,
+        .format = ADC_STREAM_OUTPUT_TYPE,
+    };
+    err = adc_continuous_config(s->adc, &dig_cfg);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "adc_continuous_config failed: %s", esp_err_to_name(err));
+        adc_continuous_deinit(s->adc);
+        free(s->frame);
+        free(s);
+        return err;
+    }
+
+    s->done = xSemaphoreCreateBinary();
+    UBaseType_t prio = cfg->task_priority ? cfg->task_priority : ADC_STREAM_TASK_PRIO_DEFAULT;
+    if (!s->done ||
+        xTaskCreate(adc_stream_task, "adc_stream", ADC_STREAM_TASK_STACK, s, prio, &s->task) != pdPASS) {
+        if (s->done) {
+            vSemaphoreDelete(s->done);
+        }
+        adc_continuous_deinit(s->adc);
+        free(s->frame);
+        free(s);
+        return ESP_ERR_NO_MEM;
+    }
+
+    adc_continuous_evt_cbs_t cbs = {
+        .on_conv_done = on_conv_done,
+        .on_pool_ovf = on_pool_ovf,
+    };
+    err = adc_continuous_register_event_callbacks(s->adc, &cbs, s);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "register_event_callbacks failed: %s", esp_err_to_name(err));
+        adc_stream_join(s);
+        vSemaphoreDelete(s->done);
+        adc_continuous_deinit(s->adc);
+        free(s->frame);
+        free(s);
+        return err;
+    }
+
+    ESP_LOGI(TAG, "ADC stream ready: %lu Hz, %lu samples/frame",
+             (unsigned long)cfg->sample_freq_hz, (unsigned long)cfg->frame_samples);
+
+    *out_handle = s;
+    return ESP_OK;
+}
+
+esp_err_t adc_stream_start(adc_stream_handle_t s)
+{
+    if (!s) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s->running) {
+        return ESP_OK;
+    }
+    /* drop stale conversions left over from the previous run */
+    adc_continuous_flush_pool(s->adc);
+
+    s->overruns = 0;
+    s->running = true;
+    esp_err_t err = adc_continuous_start(s->adc);
+    if (err != ESP_OK) {
+        s->running = false;
+    }
+    return err;
+}
+
+esp_err_t adc_stream_stop(adc_stream_handle_t s)
+{
+    if (!s) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s->running) {
+        return ESP_OK;
+    }
+    s->running = false;
+    return adc_continuous_stop(s->adc);
+}
+
+esp_err_t adc_stream_delete(adc_stream_handle_t s)
+{
+    if (!s) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    adc_stream_stop(s);
+
+    /* the worker may still be inside adc_continuous_read(): wait for it */
+    adc_stream_join(s);
+    vSemaphoreDelete(s->done);
+
+    esp_err_t err = adc_continuous_deinit(s->adc);
+    free(s->frame);
+    free(s);
+    return err;
+}
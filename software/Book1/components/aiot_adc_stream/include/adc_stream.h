@@ -0,0 +1,96 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: continuous (DMA) ADC acquisition engine
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY CONTINUOUS MODE?
+ * --------------------
+ * adc_oneshot_read() in a loop keeps the CPU busy for the whole burst.
+ * In continuous mode the ADC digital controller samples at a fixed rate and
+ * the DMA fills conversion frames on its own. The CPU only wakes up when a
+ * frame is complete, averages it and hands the result to the application.
+ *
+ * The driver keeps two frames in its internal pool (double buffering):
+ * while we process one frame, DMA already fills the next one.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#include "esp_err.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* One averaged measurement (one complete frame) */
+typedef struct {
+    int      raw_avg;        /* averaged raw value of the frame */
+    int      voltage_mv;     /* calibrated value, -1 if no calibration */
+    uint32_t samples;        /* number of samples that went into raw_avg */
+    uint32_t overruns;       /* DMA pool overflows since start */
+    int64_t  timestamp_us;   /* esp_timer_get_time() when frame was processed */
+} adc_stream_result_t;
+
+typedef void (*adc_stream_cb_t)(const adc_stream_result_t *result, void *user_ctx);
+
+typedef struct {
+    adc_unit_t        unit;
+    adc_channel_t     channel;
+    adc_atten_t       atten;
+
+    uint32_t          sample_freq_hz;  /* SOC_ADC_SAMPLE_FREQ_THRES_LOW..HIGH */
+    uint32_t          frame_samples;   /* samples per frame = averaging window */
+
+    adc_cali_handle_t cali;            /* optional, owned by caller */
+
+    /* Result delivery: callback and/or queue of adc_stream_result_t */
+    adc_stream_cb_t   on_result;       /* runs in the engine task */
+    void             *user_ctx;
+    QueueHandle_t     result_queue;    /* xQueueCreate(n, sizeof(adc_stream_result_t)) */
+
+    UBaseType_t       task_priority;   /* 0 -> default (5) */
+} adc_stream_config_t;
+
+typedef struct adc_stream_s *adc_stream_handle_t;
+
+/* Create engine (driver + worker task). Sampling does not start yet. */
+esp_err_t adc_stream_new(const adc_stream_config_t *cfg, adc_stream_handle_t *out_handle);
+
+/* Start/stop the DMA conversion. Can be called repeatedly. */
+esp_err_t adc_stream_start(adc_stream_handle_t handle);
+esp_err_t adc_stream_stop(adc_stream_handle_t handle);
+
+/* Stop (if running), delete worker task and driver, free memory. */
+esp_err_t adc_stream_delete(adc_stream_handle_t handle);
+
+/*
+ * Sum up all samples of 'channel' in a raw DMA frame.
+ * Pure function without driver access (can be fed with synthetic frames).
+ * Returns the number of matching samples, the sum is written to *out_sum.
+ */
+uint32_t adc_stream_reduce_frame(const uint8_t *frame, uint32_t len,
+                                 adc_channel_t channel, uint32_t *out_sum);
+
+#ifdef __cplusplus
+}
+#endif
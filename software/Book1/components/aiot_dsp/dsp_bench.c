@@ -0,0 +1,179 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: float vs. fixed-point filter benchmark (IMU path)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "dsp_bench.h"
+#include "dsp_filter.h"
+
+/* default full scale after reset: +-2 g, +-250 dps */
+#define ACCEL_LSB_PER_MG        16.384f
+#define GYRO_LSB_PER_MDPS       0.131f
+#define ACCEL_MG_NUM            1000        /* 1000 / 16384 = 1000 >> 14 */
+#define ACCEL_MG_SHIFT          14
+#define GYRO_MDPS_NUM           7817        /* 1000 / 131 ~ 7817 >> 10 */
+#define GYRO_MDPS_SHIFT         10
+
+/* a slow ramp with noise and a spike every 16th sample, cycled */
+#define INPUT_LEN               64
+
+static int16_t s_input[INPUT_LEN][DSP_BENCH_AXES];
+
+static void make_input(void)
+{
+    uint32_t seed = 1;
+
+    for (int i = 0; i < INPUT_LEN; i++) {
+        for (int a = 0; a < DSP_BENCH_AXES; a++) {
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            int32_t v = (a == 2 ? 16384 : 0) + i * 40 * (a + 1) + (int32_t)(seed % 257) - 128;
+            if (i % 16 == 5) {
+                v += 8000;
+            }
+            s_input[i][a] = (int16_t)v;
+        }
+    }
+}
+
+/* ---- float path ---- */
+
+typedef struct {
+    float   hist[DSP_BENCH_AXES][3];
+    float   y[DSP_BENCH_AXES];
+    float   alpha;
+    uint8_t idx;
+    uint8_t fill;
+} float_path_t;
+
+/* the same insertion sort as median_process(), only on floats */
+static float medianf(const float *h, uint8_t n)
+{
+    float tmp[3];
+
+    for (uint8_t i = 0; i < n; i++) {
+        float v = h[i];
+        int j = i - 1;
+        while (j >= 0 && tmp[j] > v) {
+            tmp[j + 1] = tmp[j];
+            j--;
+        }
+        tmp[j + 1] = v;
+    }
+    return tmp[n / 2];
+}
+
+static void float_step(float_path_t *p, const int16_t raw[DSP_BENCH_AXES],
+                       float out[DSP_BENCH_AXES])
+{
+    bool first = p->fill == 0;
+
+    if (p->fill < 3) {
+        p->fill++;
+    }
+    for (int a = 0; a < DSP_BENCH_AXES; a++) {
+        p->hist[a][p->idx] = raw[a];
+        float x = medianf(p->hist[a], p->fill);
+        p->y[a] = first ? x : p->y[a] + p->alpha * (x - p->y[a]);
+        out[a] = p->y[a] / (a < 3 ? ACCEL_LSB_PER_MG : GYRO_LSB_PER_MDPS);
+    }
+    p->idx = (uint8_t)((p->idx + 1) % 3);
+}
+
+/* ---- fixed-point path ---- */
+
+static void fixed_init(dsp_chain_t chain[DSP_BENCH_AXES], int16_t alpha_q15)
+{
+    for (int a = 0; a < DSP_BENCH_AXES; a++) {
+        dsp_chain_init(&chain[a]);
+        dsp_chain_add_median(&chain[a], 3);
+        dsp_chain_add_iir_lowpass(&chain[a], alpha_q15);
+    }
+}
+
+static void fixed_step(dsp_chain_t chain[DSP_BENCH_AXES], const int16_t raw[DSP_BENCH_AXES],
+                       int32_t out[DSP_BENCH_AXES])
+{
+    for (int a = 0; a < DSP_BENCH_AXES; a++) {
+        int16_t y = raw[a];
+        dsp_chain_process(&chain[a], raw[a], &y);
+        out[a] = (a < 3) ? dsp_scale(y, ACCEL_MG_NUM, ACCEL_MG_SHIFT)
+                         : dsp_scale(y, GYRO_MDPS_NUM, GYRO_MDPS_SHIFT);
+    }
+}
+
+/* ---- driver ---- */
+
+static void float_init(float_path_t *p, float cutoff_hz, float sample_hz)
+{
+    *p = (float_path_t){0};
+    p->alpha = (cutoff_hz > 0.0f && sample_hz > 0.0f)
+             ? 1.0f - expf(-2.0f * (float)M_PI * cutoff_hz / sample_hz) : 1.0f;
+}
+
+void dsp_bench_run(dsp_bench_clock_t clock, uint32_t samples,
+                   float cutoff_hz, float sample_hz, dsp_bench_result_t *res)
+{
+    static dsp_chain_t chain[DSP_BENCH_AXES];
+    static float_path_t fp;
+    const int16_t alpha_q15 = dsp_iir_alpha_q15(cutoff_hz, sample_hz);
+    float out_f[DSP_BENCH_AXES];
+    int32_t out_i[DSP_BENCH_AXES];
+    /* keeps the compiler from dropping the timed loops */
+    volatile float sink_f = 0.0f;
+    volatile int32_t sink_i = 0;
+
+    make_input();
+
+    float_init(&fp, cutoff_hz, sample_hz);
+    uint32_t t0 = clock();
+    for (uint32_t i = 0; i < samples; i++) {
+        float_step(&fp, s_input[i % INPUT_LEN], out_f);
+        sink_f += out_f[0] + out_f[DSP_BENCH_AXES - 1];
+    }
+    uint32_t t1 = clock();
+
+    fixed_init(chain, alpha_q15);
+    uint32_t t2 = clock();
+    for (uint32_t i = 0; i < samples; i++) {
+        fixed_step(chain, s_input[i % INPUT_LEN], out_i);
+        sink_i += out_i[0] + out_i[DSP_BENCH_AXES - 1];
+    }
+    uint32_t t3 = clock();
+
+    /* untimed: both paths side by side on the same samples */
+    float_init(&fp, cutoff_hz, sample_hz);
+    fixed_init(chain, alpha_q15);
+    res->max_diff = 0;
+    for (uint32_t i = 0; i < samples; i++) {
+        float_step(&fp, s_input[i % INPUT_LEN], out_f);
+        fixed_step(chain, s_input[i % INPUT_LEN], out_i);
+        for (int a = 0; a < DSP_BENCH_AXES; a++) {
+            int32_t d = abs((int32_t)lroundf(out_f[a]) - out_i[a]);
+            if (d > res->max_diff) {
+                res->max_diff = d;
+            }
+        }
+    }
+
+    res->float_ticks = (t1 - t0) / samples;
+    res->fixed_ticks = (t3 - t2) / samples;
+    (void)sink_f; (void)sink_i;
+}
@@ -0,0 +1,240 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: fixed-point streaming filters (ADC / IMU)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <string.h>
+#include <math.h>
+
+#include "dsp_filter.h"
+
+/* --------------------------------------------------------------------------
+ * Single stages
+ * -------------------------------------------------------------------------- */
+
+/* nearest, halves away from zero: a constant input comes back unchanged */
+static int16_t div_round(int32_t sum, int32_t n)
+{
+    return (int16_t)((sum >= 0 ? sum + n / 2 : sum - n / 2) / n);
+}
+
+static int16_t mavg_process(dsp_stage_t *st, int16_t x)
+{
+    /* running sum: one add, one subtract, one integer division per sample */
+    if (st->mavg.fill == st->mavg.len) {
+        st->mavg.sum -= st->mavg.buf[st->mavg.idx];
+    } else {
+        st->mavg.fill++;
+    }
+    st->mavg.buf[st->mavg.idx] = x;
+    st->mavg.sum += x;
+    st->mavg.idx = (uint8_t)((st->mavg.idx + 1) % st->mavg.len);
+
+    /* during warm-up: average over what we have so far */
+    return div_round(st->mavg.sum, st->mavg.fill);
+}
+
+static int16_t iir_process(dsp_stage_t *st, int16_t x)
+{
+    int32_t x_q31 = (int32_t)x * 65536;
+
+    if (!st->iir.primed) {
+        /* start at the first sample instead of ramping up from zero */
+        st->iir.state_q31 = x_q31;
+        st->iir.primed = true;
+    } else {
+        /* a full-scale step does not fit int32; the new state lies between
+         * old state and x, so it does */
+        int64_t delta = (int64_t)x_q31 - st->iir.state_q31;
+        st->iir.state_q31 = (int32_t)(st->iir.state_q31 + ((delta * st->iir.alpha_q15) >> 15));
+    }
+
+    /* round to nearest */
+    return (int16_t)((st->iir.state_q31 + (1 << 15)) >> 16);
+}
+
+static int16_t median_process(dsp_stage_t *st, int16_t x)
+{
+    st->median.buf[st->median.idx] = x;
+    st->median.idx = (uint8_t)((st->median.idx + 1) % st->median.len);
+    if (st->median.fill < st->median.len) {
+        st->median.fill++;
+    }
+
+    /* insertion sort of a tiny copy (N <= 9) */
+    int16_t tmp[DSP_MEDIAN_MAX_LEN];
+    uint8_t n = st->median.fill;
+    for (uint8_t i = 0; i < n; i++) {
+        int16_t v = st->median.buf[i];
+        int j = i - 1;
+        while (j >= 0 && tmp[j] > v) {
+            tmp[j + 1] = tmp[j];
+            j--;
+        }
+        tmp[j + 1] = v;
+    }
+    return tmp[n / 2];
+}
+
+static bool decim_process(dsp_stage_t *st)
+{
+    if (++st->decim.count < st->decim.factor) {
+        return false;
+    }
+    st->decim.count = 0;
+    return true;
+}
+
+/* --------------------------------------------------------------------------
+ * Chain setup
+ * -------------------------------------------------------------------------- */
+
+void dsp_chain_init(dsp_chain_t *chain)
+{
+    memset(chain, 0, sizeof(*chain));
+}
+
+static dsp_stage_t *chain_append(dsp_chain_t *chain, dsp_stage_type_t type)
+{
+    if (chain->count >= DSP_CHAIN_MAX_STAGES) {
+        return NULL;
+    }
+    dsp_stage_t *st = &chain->stages[chain->count++];
+    memset(st, 0, sizeof(*st));
+    st->type = type;
+    return st;
+}
+
+bool dsp_chain_add_moving_avg(dsp_chain_t *chain, uint8_t len)
+{
+    if (len == 0 || len > DSP_MAVG_MAX_LEN) {
+        return false;
+    }
+    dsp_stage_t *st = chain_append(chain, DSP_STAGE_MOVING_AVG);
+    if (!st) {
+        return false;
+    }
+    st->mavg.len = len;
+    return true;
+}
+
+bool dsp_chain_add_iir_lowpass(dsp_chain_t *chain, int16_t alpha_q15)
+{
+    if (alpha_q15 <= 0) {
+        return false;
+    }
+    dsp_stage_t *st = chain_append(chain, DSP_STAGE_IIR_LOWPASS);
+    if (!st) {
+        return false;
+    }
+    st->iir.alpha_q15 = alpha_q15;
+    return true;
+}
+
+bool dsp_chain_add_median(dsp_chain_t *chain, uint8_t len)
+{
+    if (len == 0 || len > DSP_MEDIAN_MAX_LEN || (len % 2) == 0) {
+        return false;
+    }
+    dsp_stage_t *st = chain_append(chain, DSP_STAGE_MEDIAN);
+    if (!st) {
+        return false;
+    }
+    st->median.len = len;
+    return true;
+}
+
+bool dsp_chain_add_decimate(dsp_chain_t *chain, uint16_t factor)
+{
+    if (factor == 0) {
+        return false;
+    }
+    dsp_stage_t *st = chain_append(chain, DSP_STAGE_DECIMATE);
+    if (!st) {
+        return false;
+    }
+    st->decim.factor = factor;
+    return true;
+}
+
+void dsp_chain_reset(dsp_chain_t *chain)
+{
+    for (uint8_t i = 0; i < chain->count; i++) {
+        dsp_stage_t *st = &chain->stages[i];
+        switch (st->type) {
+            case DSP_STAGE_MOVING_AVG:
+                st->mavg.sum = 0;
+                st->mavg.idx = 0;
+                st->mavg.fill = 0;
+                break;
+            case DSP_STAGE_IIR_LOWPASS:
+                st->iir.primed = false;
+                break;
+            case DSP_STAGE_MEDIAN:
+                st->median.idx = 0;
+                st->median.fill = 0;
+                break;
+            case DSP_STAGE_DECIMATE:
+                st->decim.count = 0;
+                break;
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Processing
+ * -------------------------------------------------------------------------- */
+
+bool dsp_chain_process(dsp_chain_t *chain, int16_t in, int16_t *out)
+{
+    int16_t x = in;
+
+    for (uint8_t i = 0; i < chain->count; i++) {
+        dsp_stage_t *st = &chain->stages[i];
+        switch (st->type) {
+            case DSP_STAGE_MOVING_AVG:
+                x = mavg_process(st, x);
+                break;
+            case DSP_STAGE_IIR_LOWPASS:
+                x = iir_process(st, x);
+                break;
+            case DSP_STAGE_MEDIAN:
+                x = median_process(st, x);
+                break;
+            case DSP_STAGE_DECIMATE:
+                if (!decim_process(st)) {
+                    return false;
+                }
+                break;
+        }
+    }
+
+    if (out) {
+        *out = x;
+    }
+    return true;
+}
+
+int16_t dsp_iir_alpha_q15(float cutoff_hz, float sample_hz)
+{
+    if (cutoff_hz <= 0.0f || sample_hz <= 0.0f) {
+        return DSP_Q15_ONE;
+    }
+    /* a = 1 - exp(-2*pi*fc/fs) */
+    float a = 1.0f - expf(-2.0f * (float)M_PI * cutoff_hz / sample_hz);
+    int32_t q = (int32_t)(a * 32768.0f + 0.5f);
+    if (q < 1) q = 1;
+    if (q > DSP_Q15_ONE) q = DSP_Q15_ONE;
+    return (int16_t)q;
+}
@@ -0,0 +1,57 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: float vs. fixed-point filter benchmark (IMU path)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+
+/*
+ * The same work twice: per 6-axis IMU sample median-of-3 + 1st order IIR
+ * low-pass + scaling to mg / mdps, once in float (scaling by division, as
+ * the original read loop did it) and once with dsp_chain_t + dsp_scale().
+ * Both paths see the same input and keep the same warm-up behaviour, so
+ * their outputs agree to a few milli-units; dsp_bench_run() reports that
+ * difference next to the timing. The float median sorts like the Q15 one,
+ * so the comparison is about the number format, not the algorithm.
+ *
+ * The clock is passed in: esp_cpu_get_cycle_count() on the target, a
+ * nanosecond or TSC counter on the host (host_test: make bench). Only
+ * differences are used, so a wrapping 32 bit counter is fine as long as
+ * one path takes less than one wrap.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DSP_BENCH_AXES          6      /* ax ay az gx gy gz */
+
+typedef uint32_t (*dsp_bench_clock_t)(void);
+
+typedef struct {
+    uint32_t float_ticks;       /* per 6-axis sample */
+    uint32_t fixed_ticks;
+    int32_t  max_diff;          /* largest |float - fixed| output, mg or mdps */
+} dsp_bench_result_t;
+
+/* samples > 0; cutoff / rate as for dsp_iir_alpha_q15() */
+void dsp_bench_run(dsp_bench_clock_t clock, uint32_t samples,
+                   float cutoff_hz, float sample_hz, dsp_bench_result_t *res);
+
+#ifdef __cplusplus
+}
+#endif
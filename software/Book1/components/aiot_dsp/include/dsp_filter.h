@@ -0,0 +1,118 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: fixed-point streaming filters (ADC / IMU)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY FIXED POINT?
+ * ----------------
+ * The ESP32-C3 has no FPU and even on the S3 a float division costs far more
+ * than an integer multiply + shift. All filters here work on int16 samples
+ * (raw ADC counts or raw IMU LSB, interpreted as Q15) and keep their internal
+ * state in Q31. Floats are only used once, when a stage is configured.
+ *
+ * Stages:
+ *  - moving average  (window 1..DSP_MAVG_MAX_LEN, running sum, rounded)
+ *  - IIR low-pass    (1st order, y += a * (x - y), a in Q15)
+ *  - median-of-N     (N odd, 1..DSP_MEDIAN_MAX_LEN, spike removal)
+ *  - decimation      (pass every M-th sample)
+ *
+ * Stages are chained per channel. All memory lives inside dsp_chain_t,
+ * so there is no heap allocation at all (neither per sample nor at setup).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define DSP_MAVG_MAX_LEN        32
+#define DSP_MEDIAN_MAX_LEN      9
+#define DSP_CHAIN_MAX_STAGES    4
+
+#define DSP_Q15_ONE             32767
+
+typedef enum {
+    DSP_STAGE_MOVING_AVG = 0,
+    DSP_STAGE_IIR_LOWPASS,
+    DSP_STAGE_MEDIAN,
+    DSP_STAGE_DECIMATE,
+} dsp_stage_type_t;
+
+typedef struct {
+    dsp_stage_type_t type;
+    union {
+        struct {
+            int16_t  buf[DSP_MAVG_MAX_LEN];
+            int32_t  sum;
+            uint8_t  len, idx, fill;
+        } mavg;
+        struct {
+            int32_t  state_q31;     /* sample * 65536 */
+            int16_t  alpha_q15;
+            bool     primed;
+        } iir;
+        struct {
+            int16_t  buf[DSP_MEDIAN_MAX_LEN];
+            uint8_t  len, idx, fill;
+        } median;
+        struct {
+            uint16_t factor, count;
+        } decim;
+    };
+} dsp_stage_t;
+
+typedef struct {
+    dsp_stage_t stages[DSP_CHAIN_MAX_STAGES];
+    uint8_t     count;
+} dsp_chain_t;
+
+/* Chain setup (false = invalid parameter or chain full) */
+void dsp_chain_init(dsp_chain_t *chain);
+bool dsp_chain_add_moving_avg(dsp_chain_t *chain, uint8_t len);
+bool dsp_chain_add_iir_lowpass(dsp_chain_t *chain, int16_t alpha_q15);
+bool dsp_chain_add_median(dsp_chain_t *chain, uint8_t len);
+bool dsp_chain_add_decimate(dsp_chain_t *chain, uint16_t factor);
+
+/* Clear filter history, keep configuration */
+void dsp_chain_reset(dsp_chain_t *chain);
+
+/*
+ * Push one sample through all stages.
+ * Returns true if a sample came out (decimation may swallow samples).
+ */
+bool dsp_chain_process(dsp_chain_t *chain, int16_t in, int16_t *out);
+
+/* Helper (setup time only): alpha for a 1st order low-pass at cutoff_hz */
+int16_t dsp_iir_alpha_q15(float cutoff_hz, float sample_hz);
+
+/* Q15 helpers */
+static inline int16_t dsp_q15_mul(int16_t a, int16_t b)
+{
+    return (int16_t)(((int32_t)a * b) >> 15);
+}
+
+/* Scale raw value by (num / 2^shift) without division, e.g. LSB -> mg */
+static inline int32_t dsp_scale(int32_t raw, int32_t num, uint8_t shift)
+{
+    return (int32_t)(((int64_t)raw * num) >> shift);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,377 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: I2C bus with device handles and async transaction queue
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "i2c_bus.h"
+
+static const char *TAG = "I2C_BUS";
+
+#define I2C_BUS_TIMEOUT_MS      100
+#define I2C_BUS_TASK_STACK      3072
+#define I2C_BUS_TASK_PRIO       6
+
+struct i2c_bus_dev_s {
+    bool                     used;
+    uint8_t                  addr;
+    i2c_master_dev_handle_t  handle;    /* NULL with a fake backend */
+};
+
+static i2c_master_bus_handle_t s_bus = NULL;
+static struct i2c_bus_dev_s    s_devs[I2C_BUS_MAX_DEVICES];
+static SemaphoreHandle_t       s_lock = NULL;   /* sync access vs. bus task */
+static TaskHandle_t            s_task = NULL;
+static volatile uint32_t       s_completed = 0;
+
+/* transaction pool: storage + free list + pending queue, all static */
+static i2c_bus_txn_t           s_pool[I2C_BUS_POOL_SIZE];
+static StaticQueue_t           s_free_q_buf;
+static StaticQueue_t           s_pend_q_buf;
+static uint8_t                 s_free_q_store[I2C_BUS_POOL_SIZE * sizeof(i2c_bus_txn_t *)];
+static uint8_t                 s_pend_q_store[I2C_BUS_POOL_SIZE * sizeof(i2c_bus_txn_t *)];
+static QueueHandle_t           s_free_q = NULL;
+static QueueHandle_t           s_pend_q = NULL;
+
+/* --------------------------------------------------------------------------
+ * Default backend: IDF i2c_master driver
+ * -------------------------------------------------------------------------- */
+
+static esp_err_t hw_xfer(void *ctx, i2c_bus_dev_t dev,
+                         const uint8_t *tx, size_t tx_len,
+                         uint8_t *rx, size_t rx_len, int timeout_ms)
+{
+    (void)ctx;
+
+    if (tx_len && rx_len) {
+        return i2c_master_transmit_receive(dev->handle, tx, tx_len, rx, rx_len, timeout_ms);
+    }
+    if (tx_len) {
+        return i2c_master_transmit(dev->handle, tx, tx_len, timeout_ms);
+    }
+    return i2c_master_receive(dev->handle, rx, rx_len, timeout_ms);
+}
+
+static esp_err_t hw_probe(void *ctx, uint8_t addr, int timeout_ms)
+{
+    (void)ctx;
+    return i2c_master_probe(s_bus, addr, timeout_ms);
+}
+
+static i2c_bus_backend_t s_backend = {
+    .xfer = hw_xfer,
+    .probe = hw_probe,
+    .ctx = NULL,
+};
+static bool s_fake_backend = false;
+
+void i2c_bus_set_backend(const i2c_bus_backend_t *backend)
+{
+    if (backend) {
+        s_backend = *backend;
+        s_fake_backend = true;
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Bus task: executes queued transactions one after another
+ * -------------------------------------------------------------------------- */
+
+static void i2c_bus_task(void *arg)
+{
+    (void)arg;
+    i2c_bus_txn_t *txn;
+
+    while (1) {
+        if (xQueueReceive(s_pend_q, &txn, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        txn->result = s_backend.xfer(s_backend.ctx, txn->dev,
+                                     txn->tx, txn->tx_len,
+                                     txn->rx, txn->rx_len, I2C_BUS_TIMEOUT_MS);
+        xSemaphoreGive(s_lock);
+
+        txn->done_us = esp_timer_get_time();
+        txn->done = true;
+        s_completed++;
+
+        if (txn->on_done) {
+            txn->on_done(txn, txn->user_ctx);
+        }
+        if (txn->notify_task) {
+            xTaskNotifyGive(txn->notify_task);
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Setup
+ * -------------------------------------------------------------------------- */
+
+/* undo a half-done i2c_bus_init(), so a later call can start over */
+static void bus_release(void)
+{
+    if (s_pend_q) {
+        vQueueDelete(s_pend_q);
+        s_pend_q = NULL;
+    }
+    if (s_free_q) {
+        vQueueDelete(s_free_q);
+        s_free_q = NULL;
+    }
+    if (s_lock) {
+        vSemaphoreDelete(s_lock);
+        s_lock = NULL;
+    }
+    if (s_bus) {
+        i2c_del_master_bus(s_bus);
+        s_bus = NULL;
+    }
+}
+
+esp_err_t i2c_bus_init(const i2c_bus_config_t *cfg)
+{
+    if (s_task) {
+        return ESP_OK;
+    }
+    if (!cfg) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!s_fake_backend) {
+        i2c_master_bus_config_t bus_cfg = {
+            .i2c_port = cfg->port,
+            .sda_io_num = cfg->sda_io,
+            .scl_io_num = cfg->scl_io,
+            .clk_source = I2C_CLK_SRC_DEFAULT,
+            .glitch_ignore_cnt = 7,
+            .flags.enable_internal_pullup = cfg->internal_pullup,
+        };
+        esp_err_t err = i2c_new_master_bus(&bus_cfg, &s_bus);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "i2c_new_master_bus failed: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+
+    s_lock = xSemaphoreCreateMutex();
+    s_free_q = xQueueCreateStatic(I2C_BUS_POOL_SIZE, sizeof(i2c_bus_txn_t *),
+                                  s_free_q_store, &s_free_q_buf);
+    s_pend_q = xQueueCreateStatic(I2C_BUS_POOL_SIZE, sizeof(i2c_bus_txn_t *),
+                                  s_pend_q_store, &s_pend_q_buf);
+    if (!s_lock || !s_free_q || !s_pend_q) {
+        bus_release();
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < I2C_BUS_POOL_SIZE; i++) {
+        i2c_bus_txn_t *txn = &s_pool[i];
+        xQueueSend(s_free_q, &txn, 0);
+    }
+
+    UBaseType_t prio = cfg->task_priority ? cfg->task_priority : I2C_BUS_TASK_PRIO;
+    if (xTaskCreate(i2c_bus_task, "i2c_bus", I2C_BUS_TASK_STACK, NULL, prio, &s_task) != pdPASS) {
+        s_task = NULL;
+        bus_release();
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "I2C bus ready (port=%d, SDA=%d, SCL=%d%s)",
+             cfg->port, cfg->sda_io, cfg->scl_io, s_fake_backend ? ", simulated" : "");
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_add_device(uint8_t addr, uint32_t scl_speed_hz, i2c_bus_dev_t *out_dev)
+{
+    if (!s_task || !out_dev) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    for (int i = 0; i < I2C_BUS_MAX_DEVICES; i++) {
+        struct i2c_bus_dev_s *d = &s_devs[i];
+        if (d->used) {
+            continue;
+        }
+
+        d->handle = NULL;
+        if (!s_fake_backend) {
+            i2c_device_config_t dev_cfg = {
+                .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+                .device_address = addr,
+                .scl_speed_hz = scl_speed_hz,
+            };
+            esp_err_t err = i2c_master_bus_add_device(s_bus, &dev_cfg, &d->handle);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+
+        d->addr = addr;
+        d->used = true;
+        *out_dev = d;
+        return ESP_OK;
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t i2c_bus_remove_device(i2c_bus_dev_t dev)
+{
+    if (!dev || !dev->used) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = ESP_OK;
+    if (dev->handle) {
+        err = i2c_master_bus_rm_device(dev->handle);
+    }
+    dev->handle = NULL;
+    dev->used = false;
+    return err;
+}
+
+esp_err_t i2c_bus_probe(uint8_t addr, int timeout_ms)
+{
+    if (!s_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = s_backend.probe(s_backend.ctx, addr, timeout_ms);
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+uint8_t i2c_bus_dev_addr(i2c_bus_dev_t dev)
+{
+    return dev ? dev->addr : 0;
+}
+
+esp_err_t i2c_bus_dev_set_addr(i2c_bus_dev_t dev, uint8_t addr)
+{
+    if (!dev || !dev->used) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (dev->addr == addr) {
+        return ESP_OK;
+    }
+    if (dev->handle) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        esp_err_t err = i2c_master_device_change_address(dev->handle, addr, I2C_BUS_TIMEOUT_MS);
+        xSemaphoreGive(s_lock);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    dev->addr = addr;
+    return ESP_OK;
+}
+
+i2c_master_bus_handle_t i2c_bus_get_handle(void)
+{
+    return s_bus;
+}
+
+/* --------------------------------------------------------------------------
+ * Synchronous access
+ * -------------------------------------------------------------------------- */
+
+esp_err_t i2c_bus_read_reg(i2c_bus_dev_t dev, uint8_t reg, uint8_t *buf, size_t len)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = s_backend.xfer(s_backend.ctx, dev, &reg, 1, buf, len, I2C_BUS_TIMEOUT_MS);
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+esp_err_t i2c_bus_write_reg(i2c_bus_dev_t dev, uint8_t reg, uint8_t val)
+{
+    uint8_t tx[2] = { reg, val };
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t err = s_backend.xfer(s_backend.ctx, dev, tx, sizeof(tx), NULL, 0, I2C_BUS_TIMEOUT_MS);
+    xSemaphoreGive(s_lock);
+    return err;
+}
+
+/* --------------------------------------------------------------------------
+ * Asynchronous access
+ * -------------------------------------------------------------------------- */
+
+i2c_bus_txn_t *i2c_bus_txn_alloc(i2c_bus_dev_t dev)
+{
+    i2c_bus_txn_t *txn = NULL;
+    if (!s_free_q || xQueueReceive(s_free_q, &txn, 0) != pdTRUE) {
+        return NULL;
+    }
+    memset(txn, 0, sizeof(*txn));
+    txn->dev = dev;
+    return txn;
+}
+
+void i2c_bus_txn_free(i2c_bus_txn_t *txn)
+{
+    if (txn) {
+        xQueueSend(s_free_q, &txn, 0);
+    }
+}
+
+void i2c_bus_txn_set_read_reg(i2c_bus_txn_t *txn, uint8_t reg, uint8_t *buf, size_t len)
+{
+    txn->tx[0] = reg;
+    txn->tx_len = 1;
+    txn->rx = buf;
+    txn->rx_len = len;
+}
+
+esp_err_t i2c_bus_submit(i2c_bus_txn_t *txn)
+{
+    if (!txn || !txn->dev || txn->tx_len > I2C_BUS_TXN_MAX_TX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    txn->done = false;
+    txn->submitted_us = esp_timer_get_time();
+
+    /* pending queue has one slot per pool entry, so this never blocks */
+    if (xQueueSend(s_pend_q, &txn, 0) != pdTRUE) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t i2c_bus_wait(i2c_bus_txn_t *txn, TickType_t timeout)
+{
+    TickType_t start = xTaskGetTickCount();
+
+    while (!txn->done) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            return ESP_ERR_TIMEOUT;
+        }
+        ulTaskNotifyTake(pdTRUE, timeout - elapsed);
+    }
+    return txn->result;
+}
+
+uint32_t i2c_bus_completed_count(void)
+{
+    return s_completed;
+}
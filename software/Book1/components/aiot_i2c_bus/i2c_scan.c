@@ -0,0 +1,273 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: fast I2C scanner with device fingerprints and cache
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "nvs.h"
+
+#include "i2c_bus.h"
+#include "i2c_scan.h"
+
+static const char *TAG = "I2C_SCAN";
+
+#define SCAN_ADDR_FIRST     0x08
+#define SCAN_ADDR_LAST      0x77
+#define SCAN_TYPE_UNKNOWN   0xFF
+#define SCAN_SPEED_HZ       100000
+
+#define SCAN_CACHE_MAGIC    0x12C5CA01u
+#define SCAN_NVS_NS         "i2c_scan"
+#define SCAN_NVS_KEY        "map"
+
+/* --------------------------------------------------------------------------
+ * Fingerprint table: address -> ID register -> expected value
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    const char *name;
+    uint8_t     addr_a;
+    uint8_t     addr_b;     /* alternative address (e.g. AD0 = 1) */
+    uint8_t     id_reg;
+    uint8_t     id_val;
+} fingerprint_t;
+
+static const fingerprint_t s_fingerprints[] = {
+    { "MPU6050",  0x68, 0x69, 0x75, 0x68 },
+    { "MPU6500",  0x68, 0x69, 0x75, 0x70 },
+    { "MPU9250",  0x68, 0x69, 0x75, 0x71 },
+    { "BMP280",   0x76, 0x77, 0xD0, 0x58 },
+    { "BME280",   0x76, 0x77, 0xD0, 0x60 },
+    { "BME680",   0x76, 0x77, 0xD0, 0x61 },
+    { "ADXL345",  0x53, 0x1D, 0x00, 0xE5 },
+    { "HMC5883L", 0x1E, 0x1E, 0x0A, 0x48 },
+    { "VL53L0X",  0x29, 0x29, 0xC0, 0xEE },
+};
+
+#define FINGERPRINT_COUNT   (sizeof(s_fingerprints) / sizeof(s_fingerprints[0]))
+
+typedef struct {
+    uint32_t       magic;
+    i2c_scan_map_t map;
+} scan_cache_t;
+
+/* survives deep sleep, cleared on power-on */
+static RTC_DATA_ATTR scan_cache_t s_rtc_cache;
+
+/* one device handle for all ID reads, re-targeted per address */
+static i2c_bus_dev_t s_scan_dev = NULL;
+
+const char *i2c_scan_type_name(uint8_t type)
+{
+    if (type < FINGERPRINT_COUNT) {
+        return s_fingerprints[type].name;
+    }
+    return "?";
+}
+
+static esp_err_t scan_dev_get(uint8_t addr, i2c_bus_dev_t *out)
+{
+    if (!s_scan_dev) {
+        esp_err_t err = i2c_bus_add_device(addr, SCAN_SPEED_HZ, &s_scan_dev);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    *out = s_scan_dev;
+    return i2c_bus_dev_set_addr(s_scan_dev, addr);
+}
+
+/* Read ID registers known for this address, first match wins */
+static void fingerprint(i2c_scan_device_t *d)
+{
+    d->id_reg = 0;
+    d->id_val = 0;
+    d->type = SCAN_TYPE_UNKNOWN;
+
+    i2c_bus_dev_t dev;
+    if (scan_dev_get(d->addr, &dev) != ESP_OK) {
+        return;
+    }
+
+    uint8_t last_reg = 0;
+    uint8_t last_val = 0;
+    bool have_val = false;
+
+    for (uint8_t i = 0; i < FINGERPRINT_COUNT; i++) {
+        const fingerprint_t *fp = &s_fingerprints[i];
+        if (fp->addr_a != d->addr && fp->addr_b != d->addr) {
+            continue;
+        }
+
+        /* same register as the previous candidate: no second bus read */
+        if (!have_val || fp->id_reg != last_reg) {
+            if (i2c_bus_read_reg(dev, fp->id_reg, &last_val, 1) != ESP_OK) {
+                have_val = false;
+                continue;
+            }
+            last_reg = fp->id_reg;
+            have_val = true;
+        }
+
+        if (last_val == fp->id_val) {
+            d->id_reg = fp->id_reg;
+            d->id_val = last_val;
+            d->type = i;
+            return;
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Scan / verify
+ * -------------------------------------------------------------------------- */
+
+esp_err_t i2c_scan_full(i2c_scan_map_t *map, int probe_timeout_ms, i2c_scan_result_t *res)
+{
+    int64_t t0 = esp_timer_get_time();
+    uint8_t probed = 0;
+
+    memset(map, 0, sizeof(*map));
+
+    for (uint8_t addr = SCAN_ADDR_FIRST; addr <= SCAN_ADDR_LAST; addr++) {
+        probed++;
+        if (i2c_bus_probe(addr, probe_timeout_ms) != ESP_OK) {
+            continue;
+        }
+        if (map->count >= I2C_SCAN_MAX_DEVICES) {
+            ESP_LOGW(TAG, "Device map full, ignoring 0x%02X", addr);
+            continue;
+        }
+
+        i2c_scan_device_t *d = &map->dev[map->count++];
+        d->addr = addr;
+        fingerprint(d);
+    }
+
+    if (res) {
+        res->duration_us = (uint32_t)(esp_timer_get_time() - t0);
+        res->probed = probed;
+        res->from_cache = false;
+    }
+    return ESP_OK;
+}
+
+bool i2c_scan_verify(const i2c_scan_map_t *map, int probe_timeout_ms, i2c_scan_result_t *res)
+{
+    int64_t t0 = esp_timer_get_time();
+    bool ok = true;
+    uint8_t probed = 0;
+
+    for (uint8_t i = 0; i < map->count && ok; i++) {
+        const i2c_scan_device_t *d = &map->dev[i];
+        probed++;
+
+        if (i2c_bus_probe(d->addr, probe_timeout_ms) != ESP_OK) {
+            ok = false;
+            break;
+        }
+        if (d->id_reg || d->type != SCAN_TYPE_UNKNOWN) {
+            i2c_bus_dev_t dev;
+            uint8_t val = 0;
+            if (scan_dev_get(d->addr, &dev) != ESP_OK ||
+                i2c_bus_read_reg(dev, d->id_reg, &val, 1) != ESP_OK ||
+                val != d->id_val) {
+                ok = false;
+            }
+        }
+    }
+
+    if (res) {
+        res->duration_us = (uint32_t)(esp_timer_get_time() - t0);
+        res->probed = probed;
+        res->from_cache = ok;
+    }
+    return ok;
+}
+
+/* --------------------------------------------------------------------------
+ * Cache (RTC + NVS)
+ * -------------------------------------------------------------------------- */
+
+static bool nvs_cache_load(i2c_scan_map_t *map)
+{
+    nvs_handle_t h;
+    if (nvs_open(SCAN_NVS_NS, NVS_READONLY, &h) != ESP_OK) {
+        return false;
+    }
+    size_t len = sizeof(*map);
+    esp_err_t err = nvs_get_blob(h, SCAN_NVS_KEY, map, &len);
+    nvs_close(h);
+    return (err == ESP_OK && len == sizeof(*map) && map->count <= I2C_SCAN_MAX_DEVICES);
+}
+
+static void nvs_cache_store(const i2c_scan_map_t *map)
+{
+    nvs_handle_t h;
+    if (nvs_open(SCAN_NVS_NS, NVS_READWRITE, &h) != ESP_OK) {
+        return;
+    }
+    if (nvs_set_blob(h, SCAN_NVS_KEY, map, sizeof(*map)) == ESP_OK) {
+        nvs_commit(h);
+    }
+    nvs_close(h);
+}
+
+void i2c_scan_cache_clear(void)
+{
+    s_rtc_cache.magic = 0;
+
+    nvs_handle_t h;
+    if (nvs_open(SCAN_NVS_NS, NVS_READWRITE, &h) == ESP_OK) {
+        nvs_erase_key(h, SCAN_NVS_KEY);
+        nvs_commit(h);
+        nvs_close(h);
+    }
+}
+
+esp_err_t i2c_scan_cached(i2c_scan_map_t *map, int probe_timeout_ms, i2c_scan_result_t *res)
+{
+    bool have_cache = false;
+
+    if (s_rtc_cache.magic == SCAN_CACHE_MAGIC) {
+        *map = s_rtc_cache.map;
+        have_cache = true;
+    } else if (nvs_cache_load(map)) {
+        have_cache = true;
+    }
+
+    if (have_cache && map->count > 0 && i2c_scan_verify(map, probe_timeout_ms, res)) {
+        s_rtc_cache.map = *map;
+        s_rtc_cache.magic = SCAN_CACHE_MAGIC;
+        return ESP_OK;
+    }
+
+    if (have_cache) {
+        ESP_LOGI(TAG, "Bus changed, cached map invalid -> full scan");
+    }
+
+    esp_err_t err = i2c_scan_full(map, probe_timeout_ms, res);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    s_rtc_cache.map = *map;
+    s_rtc_cache.magic = SCAN_CACHE_MAGIC;
+    nvs_cache_store(map);
+    return ESP_OK;
+}
@@ -0,0 +1,154 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: I2C bus with device handles and async transaction queue
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY A BUS COMPONENT?
+ * --------------------
+ * The legacy driver (driver/i2c.h) builds a command link per access and
+ * blocks the caller. This component uses the newer master API
+ * (i2c_master_bus / i2c_master_dev handles) and adds:
+ *
+ *  - one bus per port, several sensors as devices on it
+ *  - a preallocated transaction pool (no malloc per transfer)
+ *  - an async submit/complete queue served by one bus task, so several
+ *    sensor tasks can share the bus without blocking each other
+ *  - a replaceable transfer backend (real bus or simulated devices)
+ *
+ * Note: the legacy and the new I2C driver must not be linked together.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_err.h"
+#include "driver/i2c_master.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define I2C_BUS_MAX_DEVICES     8
+#define I2C_BUS_POOL_SIZE       16      /* preallocated transactions */
+#define I2C_BUS_TXN_MAX_TX      8       /* register address + small writes */
+
+typedef struct {
+    i2c_port_num_t port;
+    gpio_num_t     sda_io;
+    gpio_num_t     scl_io;
+    bool           internal_pullup;
+    UBaseType_t    task_priority;       /* bus task, 0 -> default (6) */
+} i2c_bus_config_t;
+
+typedef struct i2c_bus_dev_s *i2c_bus_dev_t;
+
+/* --------------------------------------------------------------------------
+ * Transfer backend (real driver by default, replaceable by a fake bus)
+ * -------------------------------------------------------------------------- */
+
+typedef struct {
+    /* write tx (may be 0 bytes), then read rx (may be 0 bytes) */
+    esp_err_t (*xfer)(void *ctx, i2c_bus_dev_t dev,
+                      const uint8_t *tx, size_t tx_len,
+                      uint8_t *rx, size_t rx_len, int timeout_ms);
+    /* address ACK check */
+    esp_err_t (*probe)(void *ctx, uint8_t addr, int timeout_ms);
+    void *ctx;
+} i2c_bus_backend_t;
+
+/* Use a simulated bus instead of the hardware. Call before i2c_bus_init(). */
+void i2c_bus_set_backend(const i2c_bus_backend_t *backend);
+
+/* --------------------------------------------------------------------------
+ * Bus / device setup
+ * -------------------------------------------------------------------------- */
+
+esp_err_t i2c_bus_init(const i2c_bus_config_t *cfg);
+esp_err_t i2c_bus_add_device(uint8_t addr, uint32_t scl_speed_hz, i2c_bus_dev_t *out_dev);
+esp_err_t i2c_bus_remove_device(i2c_bus_dev_t dev);
+esp_err_t i2c_bus_probe(uint8_t addr, int timeout_ms);
+uint8_t   i2c_bus_dev_addr(i2c_bus_dev_t dev);
+
+/* Re-target an existing device handle (no new allocation), e.g. for scanning */
+esp_err_t i2c_bus_dev_set_addr(i2c_bus_dev_t dev, uint8_t addr);
+
+/* underlying IDF bus handle (NULL with a fake backend) */
+i2c_master_bus_handle_t i2c_bus_get_handle(void);
+
+/* --------------------------------------------------------------------------
+ * Synchronous register access (caller blocks, no heap)
+ * -------------------------------------------------------------------------- */
+
+esp_err_t i2c_bus_read_reg(i2c_bus_dev_t dev, uint8_t reg, uint8_t *buf, size_t len);
+esp_err_t i2c_bus_write_reg(i2c_bus_dev_t dev, uint8_t reg, uint8_t val);
+
+/* --------------------------------------------------------------------------
+ * Asynchronous transactions
+ * -------------------------------------------------------------------------- */
+
+typedef struct i2c_bus_txn_s i2c_bus_txn_t;
+typedef void (*i2c_bus_done_cb_t)(i2c_bus_txn_t *txn, void *user_ctx);
+
+struct i2c_bus_txn_s {
+    i2c_bus_dev_t     dev;
+    uint8_t           tx[I2C_BUS_TXN_MAX_TX];
+    size_t            tx_len;
+    uint8_t          *rx;               /* caller buffer, must stay valid */
+    size_t            rx_len;
+
+    i2c_bus_done_cb_t on_done;          /* runs in bus task, may be NULL */
+    void             *user_ctx;
+    TaskHandle_t      notify_task;      /* notified on completion, may be NULL */
+
+    volatile bool     done;
+    esp_err_t         result;           /* valid after completion */
+    int64_t           submitted_us;
+    int64_t           done_us;
+};
+
+/* Take a transaction from the pool (NULL if all are in flight) */
+i2c_bus_txn_t *i2c_bus_txn_alloc(i2c_bus_dev_t dev);
+
+/* Return a transaction to the pool; only once it is done (see i2c_bus_wait) */
+void i2c_bus_txn_free(i2c_bus_txn_t *txn);
+
+/* Fill as register read: tx = reg, rx = buf */
+void i2c_bus_txn_set_read_reg(i2c_bus_txn_t *txn, uint8_t reg, uint8_t *buf, size_t len);
+
+/* Queue for the bus task; returns immediately */
+esp_err_t i2c_bus_submit(i2c_bus_txn_t *txn);
+
+/*
+ * Wait for a transaction that was submitted with notify_task = this task.
+ * Returns txn->result, or ESP_ERR_TIMEOUT if it is not done yet. After a
+ * timeout the transaction is still queued or on the bus: the bus task will
+ * write rx and txn, so neither may be freed or reused until it is done.
+ * Wait again (each transfer gives up after the bus timeout) or check
+ * txn->done later.
+ */
+esp_err_t i2c_bus_wait(i2c_bus_txn_t *txn, TickType_t timeout);
+
+/* Completed transactions since init (for throughput measurements) */
+uint32_t i2c_bus_completed_count(void);
+
+#ifdef __cplusplus
+}
+#endif
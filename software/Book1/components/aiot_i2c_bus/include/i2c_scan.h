@@ -0,0 +1,79 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: fast I2C scanner with device fingerprints and cache
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * FAST SCAN
+ * ---------
+ * - only valid 7 bit addresses 0x08..0x77 (reserved ranges skipped)
+ * - short probe timeout: a missing device NACKs within ~100 us,
+ *   the timeout only matters for a stuck bus
+ * - one preallocated scan device is re-targeted for every ID read
+ *
+ * FINGERPRINT
+ * -----------
+ * For known addresses an ID register is read (e.g. MPU6050 WHO_AM_I).
+ *
+ * CACHE
+ * -----
+ * The resulting device map is kept in RTC memory (deep sleep) and in NVS
+ * (power-on). Later boots only re-verify the cached addresses; a full scan
+ * runs only if the bus has changed.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+
+#define I2C_SCAN_MAX_DEVICES    16
+
+typedef struct {
+    uint8_t     addr;
+    uint8_t     id_reg;     /* 0 if no ID register known */
+    uint8_t     id_val;
+    uint8_t     type;       /* index into fingerprint table, 0xFF = unknown */
+} i2c_scan_device_t;
+
+typedef struct {
+    uint8_t           count;
+    i2c_scan_device_t dev[I2C_SCAN_MAX_DEVICES];
+} i2c_scan_map_t;
+
+typedef struct {
+    uint32_t duration_us;
+    uint8_t  probed;        /* number of addresses probed */
+    bool     from_cache;    /* cached map verified, no full scan needed */
+} i2c_scan_result_t;
+
+/* Full bus scan with fingerprinting. Requires i2c_bus_init(). */
+esp_err_t i2c_scan_full(i2c_scan_map_t *map, int probe_timeout_ms, i2c_scan_result_t *res);
+
+/* Re-check the devices of a map: true if all are still present with same ID */
+bool i2c_scan_verify(const i2c_scan_map_t *map, int probe_timeout_ms, i2c_scan_result_t *res);
+
+/*
+ * Boot helper: verify cached map (RTC, then NVS); full scan + cache update
+ * if there is no cache or the bus changed.
+ */
+esp_err_t i2c_scan_cached(i2c_scan_map_t *map, int probe_timeout_ms, i2c_scan_result_t *res);
+
+/* Human readable name of a fingerprint type ("MPU6050", "BME280", "?") */
+const char *i2c_scan_type_name(uint8_t type);
+
+/* Drop RTC and NVS cache (forces a full scan next time) */
+void i2c_scan_cache_clear(void);
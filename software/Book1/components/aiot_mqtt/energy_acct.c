@@ -0,0 +1,151 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: per-cycle energy accounting in RTC memory (pure logic)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "energy_acct.h"
+
+#define ENERGY_ACCT_MAGIC   0x454E4143u     /* "ENAC" */
+#define NAS_PER_UAH         3600000ull      /* 1 uAh = 3600 uAs = 3.6e6 nAs */
+#define MAX_SLEEP_US        ((int64_t)UINT32_MAX * 1000)    /* last_ms range, ~49 days */
+
+static const char *const s_names[ENERGY_STATE_COUNT] = {
+    [ENERGY_CPU]         = "cpu",
+    [ENERGY_RADIO_RX]    = "rx",
+    [ENERGY_RADIO_TX]    = "tx",
+    [ENERGY_LIGHT_SLEEP] = "light",
+    [ENERGY_DEEP_SLEEP]  = "deep",
+};
+
+static uint32_t sat32(uint64_t v)
+{
+    return v > UINT32_MAX ? UINT32_MAX : (uint32_t)v;
+}
+
+void energy_acct_init(energy_acct_t *ea)
+{
+    if (ea->magic == ENERGY_ACCT_MAGIC) {
+        return;
+    }
+    memset(ea, 0, sizeof(*ea));
+    ea->magic = ENERGY_ACCT_MAGIC;
+}
+
+void energy_acct_begin(energy_acct_t *ea, int64_t wall_us, int64_t now_us)
+{
+    memset(ea->cur_us, 0, sizeof(ea->cur_us));
+    ea->state = ENERGY_CPU;
+    ea->t_mark_us = 0;
+
+    /* nothing before power-on, and a clock that went back books nothing */
+    if (ea->wall_end_us != 0) {
+        int64_t slept = wall_us - ea->wall_end_us - (now_us > 0 ? now_us : 0);
+        if (slept > MAX_SLEEP_US) {
+            slept = MAX_SLEEP_US;           /* clock was set: keep the sums sane */
+        }
+        if (slept > 0) {
+            ea->cur_us[ENERGY_DEEP_SLEEP] = (uint64_t)slept;
+        }
+    }
+}
+
+void energy_acct_enter(energy_acct_t *ea, energy_state_t st, int64_t now_us)
+{
+    if ((unsigned)st >= ENERGY_STATE_COUNT) {
+        return;
+    }
+    if (now_us > ea->t_mark_us) {
+        ea->cur_us[ea->state] += (uint64_t)(now_us - ea->t_mark_us);
+        ea->t_mark_us = now_us;
+    }
+    ea->state = (uint8_t)st;
+}
+
+void energy_acct_delivered(energy_acct_t *ea, uint32_t samples)
+{
+    ea->delivered = samples > UINT32_MAX - ea->delivered ? UINT32_MAX
+                                                          : ea->delivered + samples;
+}
+
+void energy_acct_end(energy_acct_t *ea, const energy_board_t *board,
+                     int64_t now_us, int64_t wall_us)
+{
+    uint64_t cycle_nas = 0;
+
+    energy_acct_enter(ea, (energy_state_t)ea->state, now_us);
+
+    for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+        /* us x uA / 1000 = nAs; MAX_SLEEP_US at 500 mA still fits in 64 bit */
+        uint64_t nas = ea->cur_us[i] * board->ua[i] / 1000u;
+        ea->total_nas[i] += nas;
+        ea->last_ms[i] = sat32(ea->cur_us[i] / 1000u);
+        cycle_nas += nas;
+    }
+    ea->last_uas = sat32(cycle_nas / 1000u);
+    ea->wall_end_us = wall_us;
+    if (ea->cycles < UINT32_MAX) {
+        ea->cycles++;
+    }
+    memset(ea->cur_us, 0, sizeof(ea->cur_us));
+}
+
+uint32_t energy_acct_state_uah(const energy_acct_t *ea, energy_state_t st)
+{
+    return (unsigned)st < ENERGY_STATE_COUNT ? sat32(ea->total_nas[st] / NAS_PER_UAH) : 0;
+}
+
+uint32_t energy_acct_total_uah(const energy_acct_t *ea)
+{
+    uint64_t nas = 0;
+
+    for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+        nas += ea->total_nas[i];
+    }
+    return sat32(nas / NAS_PER_UAH);
+}
+
+const char *energy_acct_state_name(energy_state_t st)
+{
+    return (unsigned)st < ENERGY_STATE_COUNT ? s_names[st] : "?";
+}
+
+size_t energy_acct_format(const energy_acct_t *ea, char *buf, size_t buf_len)
+{
+    if (buf_len == 0) {
+        return 0;
+    }
+
+    int n = snprintf(buf, buf_len, "e_n=%lu;e_smp=%lu;e_uah=%lu;e_cyc_uas=%lu;",
+                     (unsigned long)ea->cycles, (unsigned long)ea->delivered,
+                     (unsigned long)energy_acct_total_uah(ea), (unsigned long)ea->last_uas);
+    size_t pos = n > 0 ? (size_t)n : 0;
+
+    for (int i = 0; i < ENERGY_STATE_COUNT && pos < buf_len; i++) {
+        if (ea->last_ms[i] == 0 && ea->total_nas[i] == 0) {
+            continue;
+        }
+        n = snprintf(buf + pos, buf_len - pos, "e_%s=%lu/%lu;", s_names[i],
+                     (unsigned long)ea->last_ms[i],
+                     (unsigned long)energy_acct_state_uah(ea, (energy_state_t)i));
+        pos += n > 0 ? (size_t)n : 0;
+    }
+    if (pos >= buf_len) {
+        buf[0] = '\0';
+        return 0;
+    }
+    return pos;
+}
@@ -0,0 +1,129 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: per-cycle energy accounting in RTC memory (pure logic)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY ENERGY ACCOUNTING?
+ * ----------------------
+ * "awake_ms=812" does not say what a wake cost: 800 ms with the radio on
+ * cost several times more than 800 ms of CPU. The node knows which power
+ * state it is in - it switched the radio on itself - so it books the time
+ * per state and multiplies with a current table of the board:
+ *
+ *   energy_acct_begin()            previous deep sleep booked, CPU from boot
+ *   enter(RADIO_RX)                Wi-Fi start, association, waiting
+ *   enter(RADIO_TX)                publish until PUBACK
+ *   enter(LIGHT_SLEEP) ...         only where the app knows it light sleeps
+ *   energy_acct_end()              cycle folded in, right before deep sleep
+ *
+ * A cycle is the deep sleep before a wake plus the wake itself. The deep
+ * sleep comes from a clock that keeps running (gettimeofday), minus the
+ * time esp_timer counted since startup; ROM, bootloader and skipped wake
+ * stub runs end up as deep sleep.
+ *
+ * The table holds the AVERAGE current per state on your board, not the
+ * datasheet peak (TX includes the waiting for the PUBACK). Measure it once
+ * with a shunt or power profiler; the defaults are a rough ESP32-S3 module.
+ *
+ * Kept in RTC memory since power-on: charge per state, cycles, samples the
+ * broker acked. Charge per delivered sample = e_uah / e_smp is the number
+ * to compare firmware versions with.
+ *
+ * Both clocks come in as arguments (wall_us from gettimeofday(), now_us
+ * from esp_timer). SNTP setting the clock back or a node that slept for
+ * weeks are inputs of host_test/test_energy_acct.c, not a week of waiting.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef enum {
+    ENERGY_CPU = 0,         /* CPU running, radio off */
+    ENERGY_RADIO_RX,        /* Wi-Fi on: association, DHCP, waiting for answers */
+    ENERGY_RADIO_TX,        /* Wi-Fi on: sending (publish until PUBACK) */
+    ENERGY_LIGHT_SLEEP,
+    ENERGY_DEEP_SLEEP,
+    ENERGY_STATE_COUNT
+} energy_state_t;
+
+/* Average current per state in uA */
+typedef struct {
+    uint32_t ua[ENERGY_STATE_COUNT];
+} energy_board_t;
+
+/* ESP32-S3 module at 3.3 V, 160 MHz, no LEDs - replace with measured values */
+#define ENERGY_BOARD_ESP32S3_DEFAULT {  \
+    .ua = {                             \
+        [ENERGY_CPU]         = 35000,   \
+        [ENERGY_RADIO_RX]    = 95000,   \
+        [ENERGY_RADIO_TX]    = 150000,  \
+        [ENERGY_LIGHT_SLEEP] = 250,     \
+        [ENERGY_DEEP_SLEEP]  = 10,      \
+    },                                  \
+}
+
+typedef struct {
+    uint32_t magic;
+    uint32_t cycles;                        /* complete cycles since power-on */
+    uint32_t delivered;                     /* acked samples since power-on */
+    uint64_t total_nas[ENERGY_STATE_COUNT]; /* charge since power-on, nAs (uA x ms) */
+    uint32_t last_ms[ENERGY_STATE_COUNT];   /* previous complete cycle */
+    uint32_t last_uas;                      /* its charge */
+    int64_t  wall_end_us;                   /* clock at the last end(), 0 = none */
+
+    /* current cycle, rebuilt by energy_acct_begin() */
+    int64_t  t_mark_us;
+    uint8_t  state;
+    uint64_t cur_us[ENERGY_STATE_COUNT];
+} energy_acct_t;
+
+/* Keep the account if the RTC copy is valid, reset it otherwise */
+void energy_acct_init(energy_acct_t *ea);
+
+/*
+ * New cycle, state CPU. wall_us: clock that runs through deep sleep,
+ * now_us: esp_timer_get_time() (time since startup, booked as CPU).
+ */
+void energy_acct_begin(energy_acct_t *ea, int64_t wall_us, int64_t now_us);
+
+/* Switch to 'st' at now_us; the time since the last switch goes to the old state */
+void energy_acct_enter(energy_acct_t *ea, energy_state_t st, int64_t now_us);
+
+/* Samples the broker confirmed in this cycle */
+void energy_acct_delivered(energy_acct_t *ea, uint32_t samples);
+
+/* Fold the cycle in with the board's current table (call once, before sleep) */
+void energy_acct_end(energy_acct_t *ea, const energy_board_t *board,
+                     int64_t now_us, int64_t wall_us);
+
+/* Charge since power-on in uAh, all states or one */
+uint32_t energy_acct_total_uah(const energy_acct_t *ea);
+uint32_t energy_acct_state_uah(const energy_acct_t *ea, energy_state_t st);
+
+/* Short name ("rx"), "?" for an unknown state */
+const char *energy_acct_state_name(energy_state_t st);
+
+/*
+ * Text form, states without time in the last cycle and no charge skipped:
+ *
+ *   e_n=<cycles>;e_smp=<delivered>;e_uah=<total>;e_cyc_uas=<last cycle>;
+ *   e_cpu=<last_ms>/<uah>;e_rx=...;
+ *
+ * Returns the length, 0 (and buf "") if it did not fit.
+ */
+size_t energy_acct_format(const energy_acct_t *ea, char *buf, size_t buf_len);
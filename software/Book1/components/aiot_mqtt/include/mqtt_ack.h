@@ -0,0 +1,76 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: MQTT publish acknowledgement tracking
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY NOT vTaskDelay(500) BEFORE DEEP SLEEP?
+ * ------------------------------------------
+ * A fixed wait is either too long (radio on for nothing) or too short
+ * (QoS 1 message still in the outbox when we power down). The broker
+ * tells us when a QoS 1/2 message arrived: MQTT_EVENT_PUBLISHED with the
+ * msg_id that esp_mqtt_client_publish() returned.
+ *
+ *   mqtt_ack_publish(...)          instead of esp_mqtt_client_publish()
+ *   mqtt_ack_on_event(event)       in the MQTT event handler
+ *   mqtt_ack_wait_all(deadline)    sleep as soon as everything is acked
+ *
+ * QoS 0 messages are not tracked (there is no ack). A message the client
+ * gives up on (outbox expired, MQTT_EVENT_DELETED) is not waited for any
+ * longer, but the wait reports it as not delivered.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_err.h"
+#include "mqtt_client.h"
+
+#define MQTT_ACK_MAX_PENDING    16
+
+typedef struct {
+    uint32_t published;         /* tracked publishes (QoS > 0) */
+    uint32_t acked;
+    uint32_t dropped;           /* pending list full, not tracked */
+    uint32_t expired;           /* deleted from the outbox unacked (MQTT_EVENT_DELETED) */
+    uint32_t last_ack_us;       /* publish -> ack of the last message */
+    uint32_t max_ack_us;
+} mqtt_ack_stats_t;
+
+/* Create the sync objects (once, before the first publish) */
+esp_err_t mqtt_ack_init(void);
+
+/* esp_mqtt_client_publish() + remember the msg_id. Returns the msg_id (< 0 on error). */
+int mqtt_ack_publish(esp_mqtt_client_handle_t client, const char *topic,
+                     const char *data, int len, int qos, int retain);
+
+/* Feed every MQTT event here (MQTT_EVENT_PUBLISHED and MQTT_EVENT_DELETED are used) */
+void mqtt_ack_on_event(esp_mqtt_event_handle_t event);
+
+/*
+ * ESP_OK when all tracked messages are acked.
+ * ESP_ERR_TIMEOUT if some are still pending at the timeout.
+ * ESP_FAIL if none is pending, but a message expired unacked since the
+ * previous call (also between publish and this wait). Any result but
+ * ESP_OK means: not all of it reached the broker. Either way the expiries
+ * are reported once; the next call starts counting anew.
+ */
+esp_err_t mqtt_ack_wait_all(TickType_t timeout);
+
+uint32_t mqtt_ack_pending(void);
+
+void mqtt_ack_get_stats(mqtt_ack_stats_t *out);
@@ -0,0 +1,97 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: table-driven command dispatcher (pure logic)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY A TABLE?
+ * ------------
+ * A chain of strcmp/strncmp branches grows with every command, and each
+ * branch re-does the same argument checks. Here a command is one line:
+ *
+ *   { "sleep", MQTT_CMD_ARG_INT, 1, 86400, cmd_sleep, "bad_sleep_range" },
+ *
+ * The dispatcher checks name, argument type and bounds, and only calls the
+ * handler with a valid value. Errors are answered with the same event
+ * format for all commands.
+ *
+ * Payload format (parsed in place on event->data / data_len, no copy):
+ *
+ *   <name>[=<arg>][;req=<id>]        e.g.  "sleep=60;req=17"
+ *
+ * Leading/trailing whitespace is ignored. If a req id is present, it is
+ * appended to the reply ("event=sleep_set;sec=60;req=17"), so a backend
+ * can match answers to requests.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define MQTT_CMD_REPLY_MAX      128
+
+typedef enum {
+    MQTT_CMD_ARG_NONE,          /* "ping" */
+    MQTT_CMD_ARG_INT,           /* "sleep=60", min..max inclusive */
+    MQTT_CMD_ARG_STR,           /* "ota=http://..", length min..max, no control chars */
+} mqtt_cmd_arg_t;
+
+typedef enum {
+    MQTT_CMD_OK,
+    MQTT_CMD_UNKNOWN,
+    MQTT_CMD_BAD_ARG,
+    MQTT_CMD_MALFORMED,         /* empty, no name, bad or empty req field */
+} mqtt_cmd_result_t;
+
+typedef struct mqtt_cmd_def mqtt_cmd_def_t;
+
+/* One parsed command. str/req point INTO the payload (not terminated). */
+typedef struct {
+    const mqtt_cmd_def_t *def;
+    int32_t     ival;
+    const char *str;
+    size_t      str_len;
+    const char *req;
+    size_t      req_len;
+} mqtt_cmd_t;
+
+/* Write the reply ("event=...") into reply, leave it empty for no reply */
+typedef void (*mqtt_cmd_handler_t)(const mqtt_cmd_t *cmd, char *reply, size_t reply_len,
+                                   void *ctx);
+
+/* Sends a finished reply (req id already appended) */
+typedef void (*mqtt_cmd_reply_t)(const char *reply, void *ctx);
+
+struct mqtt_cmd_def {
+    const char        *name;
+    mqtt_cmd_arg_t     arg;
+    int32_t            min;         /* value (INT) or length (STR) */
+    int32_t            max;
+    mqtt_cmd_handler_t handler;
+    const char        *err_reason;  /* NULL -> "bad_arg" */
+};
+
+/* Parse only (no handler call). def is set for MQTT_CMD_OK and MQTT_CMD_BAD_ARG. */
+mqtt_cmd_result_t mqtt_cmd_parse(const mqtt_cmd_def_t *table, size_t count,
+                                 const char *data, size_t len, mqtt_cmd_t *out);
+
+/*
+ * Parse, call the handler and send its reply; on errors send
+ * "event=err;reason=<unknown_cmd|err_reason|malformed>[;req=<id>]".
+ */
+mqtt_cmd_result_t mqtt_cmd_dispatch(const mqtt_cmd_def_t *table, size_t count,
+                                    const char *data, size_t len,
+                                    mqtt_cmd_reply_t reply, void *ctx);
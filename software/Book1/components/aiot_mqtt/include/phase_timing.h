@@ -0,0 +1,115 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: boot-to-sleep phase timing in RTC memory (pure logic)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY PHASE TIMING?
+ * -----------------
+ * "awake_ms=812" says how long the radio wake took, not where the time
+ * went. Was it DHCP, the broker handshake or the PUBACK? The node marks the
+ * end of every phase with esp_timer_get_time() and the time since the
+ * previous mark is booked to that phase:
+ *
+ *   phase_timing_begin()                    cycle starts at esp_timer 0
+ *   ... startup ...  mark(BOOT)             = time to app_main
+ *   read_adc_mv()    mark(ADC)
+ *   nvs_flash_init() mark(NVS)
+ *   ...
+ *   before sleep     mark(SLEEP), end()     cycle folded into the stats
+ *
+ * Per phase the RTC copy keeps the last value, a rolling average (EWMA,
+ * 1/8 weight, survives any number of wakes in constant memory) and the
+ * maximum since the last report. A phase that is marked several times in
+ * one wake (e.g. one publish per batch message) adds up. Phases not reached
+ * in a wake (no radio, connect failed) keep their old statistics.
+ *
+ * Every N wakes the statistics ride along with the telemetry
+ * (TELEM_TLV_PHASES) - they describe the wakes BEFORE the one that sends
+ * them, the current wake is folded in only just before it sleeps.
+ *
+ * mark() takes the time as an argument instead of reading esp_timer: a
+ * DHCP phase of 71 minutes or a mark that goes back in time is just a
+ * number in host_test/test_phase_timing.c.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Awake phases of a sensor node, in the order they normally happen */
+typedef enum {
+    PHASE_BOOT = 0,         /* reset -> app_main (ROM + bootloader not included) */
+    PHASE_ADC,              /* read_adc_mv() + store the sample */
+    PHASE_NVS,              /* nvs_flash_init() */
+    PHASE_WIFI_INIT,        /* driver + netif start */
+    PHASE_WIFI_WAIT,        /* association + DHCP (WIFI_CONNECTED_BIT) */
+    PHASE_MQTT_START,       /* client init + start */
+    PHASE_MQTT_WAIT,        /* TCP + CONNACK (MQTT_CONNECTED_BIT) */
+    PHASE_PUBLISH,          /* encode + publish + PUBACK */
+    PHASE_SLEEP,            /* last mark -> esp_deep_sleep_start() */
+    PHASE_COUNT
+} phase_id_t;
+
+typedef struct {
+    uint32_t n;             /* wakes that reached this phase */
+    uint32_t last_us;
+    uint32_t avg_us;        /* EWMA, first value taken as is */
+    uint32_t max_us;        /* since the last report */
+} phase_stat_t;
+
+typedef struct {
+    uint32_t     magic;
+    uint32_t     cycles;        /* wakes folded in since power-on */
+    uint32_t     since_report;  /* wakes folded in since the last report */
+    phase_stat_t stat[PHASE_COUNT];
+
+    /* current wake, rebuilt by phase_timing_begin() */
+    int64_t      t_mark_us;
+    uint32_t     seen;          /* bit per phase marked this wake */
+    uint32_t     cur_us[PHASE_COUNT];
+} phase_timing_t;
+
+/* Keep the statistics if the RTC copy is valid, reset them otherwise */
+void phase_timing_init(phase_timing_t *pt);
+
+/* New wake; esp_timer counts from 0 at startup, so that is the first mark */
+void phase_timing_begin(phase_timing_t *pt);
+
+/* Phase 'id' ended at now_us: book the time since the previous mark to it */
+void phase_timing_mark(phase_timing_t *pt, phase_id_t id, int64_t now_us);
+
+/* Fold this wake into the statistics (call once, right before sleep) */
+void phase_timing_end(phase_timing_t *pt);
+
+/* Report due? every_n wakes since the last one, and something to report */
+bool phase_timing_due(const phase_timing_t *pt, uint32_t every_n);
+
+/* The report was delivered: restart the report interval and the maxima */
+void phase_timing_reported(phase_timing_t *pt);
+
+/* Short name ("wifi_wait"), "?" for an unknown id */
+const char *phase_timing_name(phase_id_t id);
+
+/*
+ * Text form of the statistics, phases that were never reached skipped:
+ *
+ *   ph_n=<wakes>;t_boot=<avg_ms>/<max_ms>;t_adc=...;
+ *
+ * (wakes since the last report, milliseconds with one decimal).
+ * Returns the length, 0 (and buf "") if it did not fit.
+ */
+size_t phase_timing_format(const phase_timing_t *pt, char *buf, size_t buf_len);
@@ -0,0 +1,116 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: power-state residency of an always-on node (pure logic)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY RESIDENCY?
+ * --------------
+ * A node that stays connected (automatic light sleep + Wi-Fi modem sleep)
+ * has no wake cycle to account like energy_acct.h does. Its current is
+ * decided by how the time splits up:
+ *
+ *   held     the app holds its PM lock (publish until PUBACK, a command
+ *            until the reply is sent): CPU at full speed, radio busy
+ *   awake    nobody holds a lock, but the chip is up anyway: beacon
+ *            reception, TCP retransmits, keepalive, idle at min frequency
+ *   light    automatic light sleep (time from the PM exit callback)
+ *
+ *   pm_duty_start()                      window starts
+ *   pm_duty_hold() / pm_duty_release()   around each MQTT exchange (nested)
+ *   pm_duty_cmd(us)                      one command: payload in -> reply out
+ *   pm_duty_report()                     window closed, next one started
+ *
+ * The average current is the residency times a current table of the board;
+ * like ENERGY_BOARD_ESP32S3_DEFAULT the defaults are rough, measure them.
+ * The latency the node sees (pm_duty_cmd) is its own part only; the round
+ * trip from a backend comes from tools/cmd_latency.py.
+ *
+ * The app passes the time and its light sleep sum in and calls these
+ * from one task (or under its own mutex); nothing here locks or reads a
+ * clock. host_test/test_pm_duty.c checks how a window splits up.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Average current per state in uA */
+typedef struct {
+    uint32_t held_ua;
+    uint32_t awake_ua;
+    uint32_t light_ua;
+} pm_duty_board_t;
+
+/* ESP32-S3 module at 3.3 V, 160/40 MHz, DTIM 1 AP - replace with measured values */
+#define PM_DUTY_BOARD_ESP32S3_DEFAULT { \
+    .held_ua  = 95000,                  \
+    .awake_ua = 30000,                  \
+    .light_ua = 250,                    \
+}
+
+typedef struct {
+    int64_t  t_start_us;        /* window start */
+    uint64_t light_start_us;    /* light sleep total at the window start */
+    uint64_t held_us;           /* closed holds in this window */
+    int64_t  t_hold_us;         /* first hold of the current nest */
+    uint32_t holders;           /* 0 = not held */
+    uint32_t cmd_n;
+    uint64_t cmd_sum_us;
+    uint32_t cmd_max_us;
+} pm_duty_t;
+
+typedef struct {
+    uint32_t window_ms;
+    uint32_t held_ms;
+    uint32_t awake_ms;
+    uint32_t light_ms;
+    uint32_t avg_ua;
+    uint32_t cmd_n;
+    uint32_t cmd_avg_us;
+    uint32_t cmd_max_us;
+} pm_duty_report_t;
+
+/*
+ * First window. now_us: esp_timer_get_time(), light_us: light sleep time
+ * since boot (sum of the PM exit callback, 0 if the app has none).
+ */
+void pm_duty_start(pm_duty_t *d, int64_t now_us, uint64_t light_us);
+
+void pm_duty_hold(pm_duty_t *d, int64_t now_us);
+
+/* A release without a hold is ignored */
+void pm_duty_release(pm_duty_t *d, int64_t now_us);
+
+/* One command handled in 'us' */
+void pm_duty_cmd(pm_duty_t *d, uint32_t us);
+
+/*
+ * Close the window and start the next one. A hold that is still open is
+ * split: the part so far counts here, the rest in the next window.
+ * Light sleep beyond the window length (clock mix-up) is clamped.
+ */
+void pm_duty_report(pm_duty_t *d, const pm_duty_board_t *board,
+                    int64_t now_us, uint64_t light_us, pm_duty_report_t *out);
+
+/*
+ * Text form:
+ *
+ *   win_ms=<n>;held_pct=<n>;light_pct=<n>;avg_ua=<n>;cmd_n=<n>;cmd_avg_us=<n>;cmd_max_us=<n>
+ *
+ * Returns the length, 0 (and buf "") if it did not fit.
+ */
+size_t pm_duty_format(const pm_duty_report_t *r, char *buf, size_t buf_len);
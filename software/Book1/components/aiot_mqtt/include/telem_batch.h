@@ -0,0 +1,87 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: telemetry batching in RTC memory (pure logic)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY BATCH?
+ * ----------
+ * Reading the ADC costs a few milliseconds. Bringing up Wi-Fi + MQTT for
+ * one 40 byte message costs hundreds of milliseconds at ~100 mA. So most
+ * wakes only sample and store the reading in RTC memory (survives deep
+ * sleep), and every Nth wake the radio sends all of them in one message:
+ *
+ *   wake 1..N-1:  sample -> telem_batch_push() -> deep sleep (radio off)
+ *   wake N:       sample -> push -> connect -> encode -> publish -> consume
+ *
+ * The ring overwrites the oldest sample when the network is away for
+ * longer than TELEM_BATCH_CAPACITY wakes (counted in 'dropped').
+ *
+ * The ring is RTC_DATA_ATTR in the node; telem_batch_init() tells a kept
+ * copy from power-on garbage by its magic, count and head.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TELEM_BATCH_CAPACITY    64
+
+#define TELEM_SAMPLE_RAW        0x0001  /* value is a raw count, not mV */
+
+typedef struct {
+    uint32_t t_s;           /* device clock, seconds */
+    uint16_t value;
+    uint16_t flags;         /* TELEM_SAMPLE_xxx */
+} telem_sample_t;
+
+typedef struct {
+    uint32_t       magic;
+    uint16_t       head;    /* index of the oldest sample */
+    uint16_t       count;
+    uint32_t       wakes;   /* wakes since the last successful flush */
+    uint32_t       dropped; /* samples overwritten before they were sent */
+    telem_sample_t samples[TELEM_BATCH_CAPACITY];
+} telem_batch_t;
+
+/* Keep the content if the RTC copy is valid, reset it otherwise (power-on) */
+void telem_batch_init(telem_batch_t *b);
+
+/* Append a sample (overwrites the oldest when full), counts one wake */
+void telem_batch_push(telem_batch_t *b, const telem_sample_t *s);
+
+/* Radio needed this wake? every_n wakes, or count >= threshold */
+bool telem_batch_due(const telem_batch_t *b, uint32_t every_n, uint16_t threshold);
+
+/* i-th oldest sample (i < count) */
+const telem_sample_t *telem_batch_at(const telem_batch_t *b, uint16_t i);
+
+/*
+ * Encode the oldest samples as one text message:
+ *
+ *   node=<id>;now=<t_s>;n=<k>;dropped=<d>;s=<value>@<t_s>,<value>r@<t_s>,...
+ *
+ * ('r' marks a raw value). Stops before the buffer would overflow.
+ * Returns the number of samples encoded (0 if not even the header fits).
+ */
+uint16_t telem_batch_encode(const telem_batch_t *b, const char *node_id, uint32_t now_s,
+                            char *buf, size_t buf_len);
+
+/* Remove the n oldest samples after the broker confirmed them */
+void telem_batch_consume(telem_batch_t *b, uint16_t n);
+
+/* Flush failed (no network): keep the samples, retry in every_n wakes */
+void telem_batch_postpone(telem_batch_t *b);
@@ -0,0 +1,153 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: compact binary telemetry (TLV, encoder + decoder)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY BINARY?
+ * -----------
+ * "node=node1;adc_mv=1234;wakeup=4;awake_ms=812" is 44 bytes, built with
+ * snprintf and parsed by string splitting on the server. The same content
+ * as TLV is 19 bytes and needs no formatting at all; a full 64 sample batch
+ * shrinks from ~1.1 kB of text to ~370 bytes.
+ *
+ * Message layout (schema version 1):
+ *
+ *   [version]  then fields:  [type][length varint][value]
+ *
+ * Integers are LEB128 varints (small numbers = 1 byte), signed values are
+ * zigzag coded first. Unknown types are skipped by their length, so a new
+ * field never breaks an old decoder. Bump TELEM_TLV_VERSION only when the
+ * meaning of an existing type changes.
+ *
+ * Encoder and decoder are plain C without IDF calls: the same file is the
+ * host-side decoder (tools/telem_decode.py is the Python twin).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "telem_batch.h"
+#include "phase_timing.h"
+#include "energy_acct.h"
+
+#define TELEM_TLV_VERSION       1
+
+typedef enum {
+    TELEM_TLV_NODE_ID     = 0x01,   /* string */
+    TELEM_TLV_FW_VERSION  = 0x02,   /* string */
+    TELEM_TLV_WAKE_REASON = 0x03,   /* uint (esp_sleep_wakeup_cause_t) */
+    TELEM_TLV_AWAKE_MS    = 0x04,   /* uint, previous cycle */
+
+    TELEM_TLV_ADC_MV      = 0x10,   /* uint */
+    TELEM_TLV_ADC_RAW     = 0x11,   /* uint */
+    TELEM_TLV_IMU         = 0x12,   /* 6 x sint: ax ay az [mg], gx gy gz [mdps] */
+
+    TELEM_TLV_BATCH       = 0x20,   /* uint now_s, uint dropped, uint n,
+                                       n x (uint age_s, uint value << 1 | raw) */
+
+    TELEM_TLV_PHASES      = 0x30,   /* uint wakes, uint phase mask, per set bit
+                                       (uint last_us, uint avg_us, uint max_us) */
+    TELEM_TLV_ENERGY      = 0x31,   /* uint cycles, uint delivered, uint total_uah,
+                                       uint cycle_uas, uint state mask, per set bit
+                                       (uint last_ms, uint uah) */
+} telem_tlv_type_t;
+
+typedef struct {
+    int32_t accel_mg[3];
+    int32_t gyro_mdps[3];
+} telem_imu_t;
+
+/* ---- Encoder ---- */
+
+typedef struct {
+    uint8_t *buf;
+    size_t   cap;
+    size_t   len;
+    bool     overflow;      /* sticky: something did not fit */
+} telem_tlv_writer_t;
+
+void telem_tlv_begin(telem_tlv_writer_t *w, uint8_t *buf, size_t cap);
+
+void telem_tlv_put_str(telem_tlv_writer_t *w, telem_tlv_type_t type, const char *str);
+void telem_tlv_put_uint(telem_tlv_writer_t *w, telem_tlv_type_t type, uint32_t value);
+void telem_tlv_put_imu(telem_tlv_writer_t *w, const telem_imu_t *imu);
+
+/* Oldest samples of the ring, as many as fit. Returns the number encoded. */
+uint16_t telem_tlv_put_batch(telem_tlv_writer_t *w, const telem_batch_t *b, uint32_t now_s);
+
+/* Phase statistics (see phase_timing.h), phases never reached left out */
+void telem_tlv_put_phases(telem_tlv_writer_t *w, const phase_timing_t *pt);
+
+/* Energy account (see energy_acct.h), states without time or charge left out */
+void telem_tlv_put_energy(telem_tlv_writer_t *w, const energy_acct_t *ea);
+
+/* Message length, 0 if anything overflowed */
+size_t telem_tlv_end(const telem_tlv_writer_t *w);
+
+/* ---- Decoder ---- */
+
+typedef struct {
+    uint8_t        type;
+    const uint8_t *value;
+    size_t         len;
+} telem_tlv_field_t;
+
+typedef struct {
+    const uint8_t *p;
+    const uint8_t *end;
+    uint8_t        version;
+} telem_tlv_reader_t;
+
+/* false if empty or a newer schema version */
+bool telem_tlv_reader_init(telem_tlv_reader_t *r, const uint8_t *buf, size_t len);
+
+/* 1 = field read, 0 = end of message, -1 = malformed */
+int telem_tlv_next(telem_tlv_reader_t *r, telem_tlv_field_t *f);
+
+/* Whole message into a struct (unknown fields skipped) */
+typedef struct {
+    char           node_id[32];
+    char           fw_version[16];
+    bool           has_wake_reason, has_awake_ms, has_adc_mv, has_adc_raw, has_imu;
+    uint32_t       wake_reason;
+    uint32_t       awake_ms;
+    uint32_t       adc_mv;
+    uint32_t       adc_raw;
+    telem_imu_t    imu;
+
+    bool           has_phases;
+    uint32_t       phase_wakes;     /* wakes the statistics cover */
+    uint32_t       phase_mask;      /* bit i: phases[i] valid */
+    phase_stat_t   phases[PHASE_COUNT];     /* n not sent (0) */
+
+    bool           has_energy;
+    uint32_t       energy_cycles;
+    uint32_t       energy_delivered;
+    uint32_t       energy_uah;          /* since power-on */
+    uint32_t       energy_cycle_uas;    /* previous complete cycle */
+    uint32_t       energy_mask;         /* bit i: energy_ms/uah[i] valid */
+    uint32_t       energy_ms[ENERGY_STATE_COUNT];
+    uint32_t       energy_state_uah[ENERGY_STATE_COUNT];
+
+    uint32_t       now_s;
+    uint32_t       dropped;
+    uint16_t       n_samples;
+    telem_sample_t samples[TELEM_BATCH_CAPACITY];
+} telem_msg_t;
+
+bool telem_tlv_decode(const uint8_t *buf, size_t len, telem_msg_t *out);
@@ -0,0 +1,230 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: MQTT publish acknowledgement tracking
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "mqtt_ack.h"
+
+static const char *TAG = "MQTT_ACK";
+
+#define MQTT_ACK_EARLY_MAX  8
+#define MQTT_ACK_BIT        BIT0
+
+typedef struct {
+    int     msg_id;
+    int64_t sent_us;
+} mqtt_ack_entry_t;
+
+/*
+ * The PUBACK can be handled by the MQTT task before esp_mqtt_client_publish()
+ * has even returned to us. Such "early" acks are parked until the publisher
+ * records its msg_id.
+ */
+static mqtt_ack_entry_t   s_pending[MQTT_ACK_MAX_PENDING];
+static uint8_t            s_pending_count = 0;
+static int                s_early[MQTT_ACK_EARLY_MAX];
+static uint8_t            s_early_count = 0;
+static mqtt_ack_stats_t   s_stats;
+static uint32_t           s_expired_unreported;  /* since the last mqtt_ack_wait_all() */
+
+static portMUX_TYPE       s_lock = portMUX_INITIALIZER_UNLOCKED;
+static EventGroupHandle_t s_events = NULL;
+
+esp_err_t mqtt_ack_init(void)
+{
+    if (s_events) {
+        return ESP_OK;
+    }
+    s_events = xEventGroupCreate();
+    return s_events ? ESP_OK : ESP_ERR_NO_MEM;
+}
+
+/* lock held */
+static void ack_account(int64_t sent_us, int64_t now_us)
+{
+    s_stats.acked++;
+    if (sent_us) {
+        uint32_t dt = (uint32_t)(now_us - sent_us);
+        s_stats.last_ack_us = dt;
+        if (dt > s_stats.max_ack_us) {
+            s_stats.max_ack_us = dt;
+        }
+    }
+}
+
+int mqtt_ack_publish(esp_mqtt_client_handle_t client, const char *topic,
+                     const char *data, int len, int qos, int retain)
+{
+    int64_t sent_us = esp_timer_get_time();
+    int msg_id = esp_mqtt_client_publish(client, topic, data, len, qos, retain);
+
+    if (msg_id <= 0 || qos == 0) {
+        return msg_id;      /* error, or QoS 0: nothing to wait for */
+    }
+
+    bool dropped = false;
+
+    taskENTER_CRITICAL(&s_lock);
+    s_stats.published++;
+
+    bool early = false;
+    for (uint8_t i = 0; i < s_early_count; i++) {
+        if (s_early[i] == msg_id) {
+            s_early[i] = s_early[--s_early_count];
+            early = true;
+            break;
+        }
+    }
+
+    if (early) {
+        ack_account(sent_us, esp_timer_get_time());
+    } else if (s_pending_count < MQTT_ACK_MAX_PENDING) {
+        s_pending[s_pending_count].msg_id = msg_id;
+        s_pending[s_pending_count].sent_us = sent_us;
+        s_pending_count++;
+    } else {
+        s_stats.dropped++;
+        dropped = true;
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (dropped) {
+        ESP_LOGW(TAG, "Pending list full, msg_id=%d not tracked", msg_id);
+    }
+    return msg_id;
+}
+
+/* The client gave up on the message (outbox expired): nothing to wait for */
+static void ack_forget(int msg_id)
+{
+    taskENTER_CRITICAL(&s_lock);
+    for (uint8_t i = 0; i < s_pending_count; i++) {
+        if (s_pending[i].msg_id == msg_id) {
+            s_pending[i] = s_pending[--s_pending_count];
+            s_stats.expired++;
+            s_expired_unreported++;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+}
+
+void mqtt_ack_on_event(esp_mqtt_event_handle_t event)
+{
+    if (event->event_id == MQTT_EVENT_DELETED) {
+        ack_forget(event->msg_id);
+        if (s_events) {
+            xEventGroupSetBits(s_events, MQTT_ACK_BIT);
+        }
+        return;
+    }
+    if (event->event_id != MQTT_EVENT_PUBLISHED) {
+        return;
+    }
+
+    int64_t now = esp_timer_get_time();
+    bool found = false;
+
+    taskENTER_CRITICAL(&s_lock);
+    for (uint8_t i = 0; i < s_pending_count; i++) {
+        if (s_pending[i].msg_id == event->msg_id) {
+            ack_account(s_pending[i].sent_us, now);
+            s_pending[i] = s_pending[--s_pending_count];
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        /* publisher has not recorded it yet: park it (oldest is overwritten) */
+        if (s_early_count < MQTT_ACK_EARLY_MAX) {
+            s_early[s_early_count++] = event->msg_id;
+        } else {
+            memmove(&s_early[0], &s_early[1], (MQTT_ACK_EARLY_MAX - 1) * sizeof(s_early[0]));
+            s_early[MQTT_ACK_EARLY_MAX - 1] = event->msg_id;
+        }
+    }
+    taskEXIT_CRITICAL(&s_lock);
+
+    if (s_events) {
+        xEventGroupSetBits(s_events, MQTT_ACK_BIT);
+    }
+}
+
+uint32_t mqtt_ack_pending(void)
+{
+    taskENTER_CRITICAL(&s_lock);
+    uint32_t n = s_pending_count;
+    taskEXIT_CRITICAL(&s_lock);
+    return n;
+}
+
+/* expired since the last wait, and start counting anew */
+static uint32_t expired_take(void)
+{
+    taskENTER_CRITICAL(&s_lock);
+    uint32_t n = s_expired_unreported;
+    s_expired_unreported = 0;
+    taskEXIT_CRITICAL(&s_lock);
+    return n;
+}
+
+esp_err_t mqtt_ack_wait_all(TickType_t timeout)
+{
+    if (!s_events) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+
+    /*
+     * Check first, then wait for "some ack arrived". An ack between the
+     * check and the wait leaves the bit set, so no wakeup is lost.
+     */
+    while (mqtt_ack_pending() > 0) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (elapsed >= timeout) {
+            ESP_LOGW(TAG, "%lu message(s) not acked in time", (unsigned long)mqtt_ack_pending());
+            expired_take();             /* covered by this failure, not the next one */
+            return ESP_ERR_TIMEOUT;
+        }
+        xEventGroupWaitBits(s_events, MQTT_ACK_BIT, pdTRUE, pdFALSE, timeout - elapsed);
+    }
+
+    /*
+     * Nothing pending any more, but not everything reached the broker. Also
+     * counts messages that expired before this wait started.
+     */
+    uint32_t lost = expired_take();
+    if (lost) {
+        ESP_LOGW(TAG, "%lu message(s) expired in the outbox unacked", (unsigned long)lost);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void mqtt_ack_get_stats(mqtt_ack_stats_t *out)
+{
+    taskENTER_CRITICAL(&s_lock);
+    *out = s_stats;
+    taskEXIT_CRITICAL(&s_lock);
+}
@@ -0,0 +1,216 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: table-driven command dispatcher (pure logic)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "mqtt_cmd.h"
+
+#define REQ_PREFIX      ";req="
+#define REQ_PREFIX_LEN  5
+#define REQ_MAX_LEN     32
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/* req ids are echoed into replies: keep them to a safe alphabet */
+static bool is_req_char(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') ||
+           (c >= 'A' && c <= 'Z') || c == '-' || c == '_';
+}
+
+/* Decimal int32 with optional sign, the whole span must be consumed */
+static bool parse_int(const char *p, size_t len, int32_t *out)
+{
+    bool neg = false;
+    int64_t v = 0;
+
+    if (len && (*p == '-' || *p == '+')) {
+        neg = (*p == '-');
+        p++;
+        len--;
+    }
+    if (len == 0 || len > 10) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (p[i] < '0' || p[i] > '9') {
+            return false;
+        }
+        v = v * 10 + (p[i] - '0');
+    }
+    if (neg) {
+        v = -v;
+    }
+    if (v < INT32_MIN || v > INT32_MAX) {
+        return false;
+    }
+    *out = (int32_t)v;
+    return true;
+}
+
+mqtt_cmd_result_t mqtt_cmd_parse(const mqtt_cmd_def_t *table, size_t count,
+                                 const char *data, size_t len, mqtt_cmd_t *out)
+{
+    memset(out, 0, sizeof(*out));
+
+    /* trim */
+    while (len && is_space(*data)) {
+        data++;
+        len--;
+    }
+    while (len && is_space(data[len - 1])) {
+        len--;
+    }
+
+    /*
+     * Optional trailing ";req=<id>". Only the LAST segment is looked at,
+     * so string arguments (URLs) may contain ';' themselves.
+     */
+    for (size_t i = len; i-- > 0;) {
+        if (data[i] != ';') {
+            continue;
+        }
+        if (len - i >= REQ_PREFIX_LEN && memcmp(&data[i], REQ_PREFIX, REQ_PREFIX_LEN) == 0) {
+            const char *req = &data[i + REQ_PREFIX_LEN];
+            size_t req_len = len - i - REQ_PREFIX_LEN;
+
+            if (req_len == 0 || req_len > REQ_MAX_LEN) {
+                return MQTT_CMD_MALFORMED;
+            }
+            for (size_t k = 0; k < req_len; k++) {
+                if (!is_req_char(req[k])) {
+                    return MQTT_CMD_MALFORMED;
+                }
+            }
+            out->req = req;
+            out->req_len = req_len;
+            len = i;
+        }
+        break;
+    }
+
+    if (len == 0) {
+        return MQTT_CMD_MALFORMED;
+    }
+
+    /* name[=arg] */
+    const char *eq = memchr(data, '=', len);
+    size_t name_len = eq ? (size_t)(eq - data) : len;
+    const char *arg = eq ? eq + 1 : NULL;
+    size_t arg_len = eq ? len - name_len - 1 : 0;
+
+    if (name_len == 0) {
+        return MQTT_CMD_MALFORMED;      /* "=60" */
+    }
+
+    const mqtt_cmd_def_t *def = NULL;
+    for (size_t i = 0; i < count; i++) {
+        if (strlen(table[i].name) == name_len &&
+            memcmp(table[i].name, data, name_len) == 0) {
+            def = &table[i];
+            break;
+        }
+    }
+    if (!def) {
+        return MQTT_CMD_UNKNOWN;
+    }
+    out->def = def;
+
+    switch (def->arg) {
+        case MQTT_CMD_ARG_NONE:
+            if (arg) {
+                return MQTT_CMD_BAD_ARG;
+            }
+            break;
+
+        case MQTT_CMD_ARG_INT:
+            if (!arg || !parse_int(arg, arg_len, &out->ival) ||
+                out->ival < def->min || out->ival > def->max) {
+                return MQTT_CMD_BAD_ARG;
+            }
+            break;
+
+        case MQTT_CMD_ARG_STR:
+            if (!arg || arg_len < (size_t)def->min || arg_len > (size_t)def->max) {
+                return MQTT_CMD_BAD_ARG;
+            }
+            for (size_t i = 0; i < arg_len; i++) {
+                if ((unsigned char)arg[i] < 0x20 || arg[i] == 0x7F) {
+                    return MQTT_CMD_BAD_ARG;
+                }
+            }
+            out->str = arg;
+            out->str_len = arg_len;
+            break;
+
+        default:
+            return MQTT_CMD_BAD_ARG;
+    }
+
+    return MQTT_CMD_OK;
+}
+
+/* reply + ";req=<id>" (if any) -> reply callback */
+static void send_reply(char *buf, size_t buf_len, const mqtt_cmd_t *cmd,
+                       mqtt_cmd_reply_t reply, void *ctx)
+{
+    if (buf[0] == '\0' || !reply) {
+        return;
+    }
+    if (cmd->req) {
+        size_t n = strlen(buf);
+        snprintf(buf + n, buf_len - n, REQ_PREFIX "%.*s", (int)cmd->req_len, cmd->req);
+    }
+    reply(buf, ctx);
+}
+
+mqtt_cmd_result_t mqtt_cmd_dispatch(const mqtt_cmd_def_t *table, size_t count,
+                                    const char *data, size_t len,
+                                    mqtt_cmd_reply_t reply, void *ctx)
+{
+    /* room for the handler's reply plus the req suffix */
+    char buf[MQTT_CMD_REPLY_MAX + REQ_PREFIX_LEN + REQ_MAX_LEN + 1];
+    mqtt_cmd_t cmd;
+
+    mqtt_cmd_result_t rc = mqtt_cmd_parse(table, count, data, len, &cmd);
+    buf[0] = '\0';
+
+    switch (rc) {
+        case MQTT_CMD_OK:
+            cmd.def->handler(&cmd, buf, MQTT_CMD_REPLY_MAX, ctx);
+            break;
+
+        case MQTT_CMD_UNKNOWN:
+            snprintf(buf, MQTT_CMD_REPLY_MAX, "event=err;reason=unknown_cmd");
+            break;
+
+        case MQTT_CMD_BAD_ARG:
+            snprintf(buf, MQTT_CMD_REPLY_MAX, "event=err;reason=%s",
+                     cmd.def->err_reason ? cmd.def->err_reason : "bad_arg");
+            break;
+
+        default:
+            snprintf(buf, MQTT_CMD_REPLY_MAX, "event=err;reason=malformed");
+            break;
+    }
+
+    send_reply(buf, sizeof(buf), &cmd, reply, ctx);
+    return rc;
+}
@@ -0,0 +1,141 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: boot-to-sleep phase timing in RTC memory (pure logic)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "phase_timing.h"
+
+#define PHASE_TIMING_MAGIC  0x50484154u     /* "PHAT" */
+#define EWMA_SHIFT          3               /* new value weighs 1/8 */
+
+static const char *const s_names[PHASE_COUNT] = {
+    [PHASE_BOOT]       = "boot",
+    [PHASE_ADC]        = "adc",
+    [PHASE_NVS]        = "nvs",
+    [PHASE_WIFI_INIT]  = "wifi_init",
+    [PHASE_WIFI_WAIT]  = "wifi_wait",
+    [PHASE_MQTT_START] = "mqtt_start",
+    [PHASE_MQTT_WAIT]  = "mqtt_wait",
+    [PHASE_PUBLISH]    = "publish",
+    [PHASE_SLEEP]      = "sleep",
+};
+
+void phase_timing_init(phase_timing_t *pt)
+{
+    if (pt->magic == PHASE_TIMING_MAGIC) {
+        return;
+    }
+    memset(pt, 0, sizeof(*pt));
+    pt->magic = PHASE_TIMING_MAGIC;
+}
+
+void phase_timing_begin(phase_timing_t *pt)
+{
+    pt->t_mark_us = 0;
+    pt->seen = 0;
+    memset(pt->cur_us, 0, sizeof(pt->cur_us));
+}
+
+void phase_timing_mark(phase_timing_t *pt, phase_id_t id, int64_t now_us)
+{
+    if ((unsigned)id >= PHASE_COUNT) {
+        return;
+    }
+    int64_t d = now_us - pt->t_mark_us;
+    if (d < 0) {
+        d = 0;
+    } else if (d > UINT32_MAX - pt->cur_us[id]) {
+        d = UINT32_MAX - pt->cur_us[id];    /* > 71 min awake: saturate */
+    }
+    pt->cur_us[id] += (uint32_t)d;
+    pt->seen |= 1u << id;
+    pt->t_mark_us = now_us;
+}
+
+static void stat_add(phase_stat_t *s, uint32_t us)
+{
+    if (s->n == 0) {
+        s->avg_us = us;
+    } else if (us >= s->avg_us) {
+        s->avg_us += (us - s->avg_us) >> EWMA_SHIFT;
+    } else {
+        s->avg_us -= (s->avg_us - us) >> EWMA_SHIFT;
+    }
+    if (us > s->max_us) {
+        s->max_us = us;
+    }
+    s->last_us = us;
+    s->n++;
+}
+
+void phase_timing_end(phase_timing_t *pt)
+{
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        if (pt->seen & (1u << i)) {
+            stat_add(&pt->stat[i], pt->cur_us[i]);
+        }
+    }
+    pt->seen = 0;
+    pt->cycles++;
+    pt->since_report++;
+}
+
+bool phase_timing_due(const phase_timing_t *pt, uint32_t every_n)
+{
+    return every_n && pt->since_report >= every_n;
+}
+
+void phase_timing_reported(phase_timing_t *pt)
+{
+    pt->since_report = 0;
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        pt->stat[i].max_us = 0;
+    }
+}
+
+const char *phase_timing_name(phase_id_t id)
+{
+    return (unsigned)id < PHASE_COUNT ? s_names[id] : "?";
+}
+
+size_t phase_timing_format(const phase_timing_t *pt, char *buf, size_t buf_len)
+{
+    if (buf_len == 0) {
+        return 0;
+    }
+
+    int n = snprintf(buf, buf_len, "ph_n=%lu;", (unsigned long)pt->since_report);
+    size_t pos = n > 0 ? (size_t)n : 0;
+
+    for (int i = 0; i < PHASE_COUNT && pos < buf_len; i++) {
+        const phase_stat_t *s = &pt->stat[i];
+        if (s->n == 0) {
+            continue;
+        }
+        /* 100 us resolution: ms with one decimal */
+        uint32_t avg = s->avg_us / 100, max = s->max_us / 100;
+        n = snprintf(buf + pos, buf_len - pos, "t_%s=%lu.%lu/%lu.%lu;", s_names[i],
+                     (unsigned long)(avg / 10), (unsigned long)(avg % 10),
+                     (unsigned long)(max / 10), (unsigned long)(max % 10));
+        pos += n > 0 ? (size_t)n : 0;
+    }
+    if (pos >= buf_len) {
+        buf[0] = '\0';
+        return 0;
+    }
+    return pos;
+}
@@ -0,0 +1,128 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: power-state residency of an always-on node (pure logic)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "pm_duty.h"
+
+static uint32_t sat32(uint64_t v)
+{
+    return v > UINT32_MAX ? UINT32_MAX : (uint32_t)v;
+}
+
+static uint32_t pct(uint64_t part, uint64_t whole)
+{
+    return whole ? (uint32_t)((part * 100u + whole / 2) / whole) : 0;
+}
+
+void pm_duty_start(pm_duty_t *d, int64_t now_us, uint64_t light_us)
+{
+    memset(d, 0, sizeof(*d));
+    d->t_start_us = now_us;
+    d->light_start_us = light_us;
+}
+
+void pm_duty_hold(pm_duty_t *d, int64_t now_us)
+{
+    if (d->holders++ == 0) {
+        d->t_hold_us = now_us;
+    }
+}
+
+void pm_duty_release(pm_duty_t *d, int64_t now_us)
+{
+    if (d->holders == 0) {
+        return;
+    }
+    if (--d->holders == 0 && now_us > d->t_hold_us) {
+        d->held_us += (uint64_t)(now_us - d->t_hold_us);
+    }
+}
+
+void pm_duty_cmd(pm_duty_t *d, uint32_t us)
+{
+    if (d->cmd_n < UINT32_MAX) {
+        d->cmd_n++;
+        d->cmd_sum_us += us;
+    }
+    if (us > d->cmd_max_us) {
+        d->cmd_max_us = us;
+    }
+}
+
+void pm_duty_report(pm_duty_t *d, const pm_duty_board_t *board,
+                    int64_t now_us, uint64_t light_us, pm_duty_report_t *out)
+{
+    uint64_t window = now_us > d->t_start_us ? (uint64_t)(now_us - d->t_start_us) : 0;
+    uint64_t light = light_us > d->light_start_us ? light_us - d->light_start_us : 0;
+    uint64_t held = d->held_us;
+
+    if (d->holders && now_us > d->t_hold_us) {
+        held += (uint64_t)(now_us - d->t_hold_us);
+    }
+
+    /* no light sleep while a lock is held: the three parts never overlap */
+    if (light > window) {
+        light = window;
+    }
+    if (held > window - light) {
+        held = window - light;
+    }
+    uint64_t awake = window - light - held;
+
+    memset(out, 0, sizeof(*out));
+    out->window_ms = sat32(window / 1000u);
+    out->held_ms = sat32(held / 1000u);
+    out->awake_ms = sat32(awake / 1000u);
+    out->light_ms = sat32(light / 1000u);
+    if (window) {
+        /* us x uA fits in 64 bit for windows of years */
+        uint64_t uas = held * board->held_ua + awake * board->awake_ua + light * board->light_ua;
+        out->avg_ua = sat32(uas / window);
+    }
+    out->cmd_n = d->cmd_n;
+    out->cmd_avg_us = d->cmd_n ? sat32(d->cmd_sum_us / d->cmd_n) : 0;
+    out->cmd_max_us = d->cmd_max_us;
+
+    /* next window, an open hold continues from here */
+    uint32_t holders = d->holders;
+    pm_duty_start(d, now_us, light_us);
+    d->holders = holders;
+    d->t_hold_us = now_us;
+}
+
+size_t pm_duty_format(const pm_duty_report_t *r, char *buf, size_t buf_len)
+{
+    if (buf_len == 0) {
+        return 0;
+    }
+
+    uint64_t window = r->window_ms;
+    int n = snprintf(buf, buf_len,
+                     "win_ms=%lu;held_pct=%lu;light_pct=%lu;avg_ua=%lu;"
+                     "cmd_n=%lu;cmd_avg_us=%lu;cmd_max_us=%lu",
+                     (unsigned long)r->window_ms,
+                     (unsigned long)pct(r->held_ms, window),
+                     (unsigned long)pct(r->light_ms, window),
+                     (unsigned long)r->avg_ua, (unsigned long)r->cmd_n,
+                     (unsigned long)r->cmd_avg_us, (unsigned long)r->cmd_max_us);
+    if (n < 0 || (size_t)n >= buf_len) {
+        buf[0] = '\0';
+        return 0;
+    }
+    return (size_t)n;
+}
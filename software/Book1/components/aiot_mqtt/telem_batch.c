@@ -0,0 +1,131 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: telemetry batching in RTC memory (pure logic)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "telem_batch.h"
+
+#define TELEM_BATCH_MAGIC   0x54424154u     /* "TBAT" */
+
+void telem_batch_init(telem_batch_t *b)
+{
+    if (b->magic == TELEM_BATCH_MAGIC &&
+        b->head < TELEM_BATCH_CAPACITY &&
+        b->count <= TELEM_BATCH_CAPACITY) {
+        return;
+    }
+    memset(b, 0, sizeof(*b));
+    b->magic = TELEM_BATCH_MAGIC;
+}
+
+void telem_batch_push(telem_batch_t *b, const telem_sample_t *s)
+{
+    uint16_t tail = (uint16_t)((b->head + b->count) % TELEM_BATCH_CAPACITY);
+
+    b->samples[tail] = *s;
+    if (b->count < TELEM_BATCH_CAPACITY) {
+        b->count++;
+    } else {
+        /* full: the slot we just wrote was the oldest one */
+        b->head = (uint16_t)((b->head + 1) % TELEM_BATCH_CAPACITY);
+        b->dropped++;
+    }
+    b->wakes++;
+}
+
+bool telem_batch_due(const telem_batch_t *b, uint32_t every_n, uint16_t threshold)
+{
+    if (b->count == 0) {
+        return false;
+    }
+    return (every_n && b->wakes >= every_n) || b->count >= threshold;
+}
+
+const telem_sample_t *telem_batch_at(const telem_batch_t *b, uint16_t i)
+{
+    return &b->samples[(b->head + i) % TELEM_BATCH_CAPACITY];
+}
+
+static int encode_sample(char *buf, size_t len, const telem_sample_t *s, bool first)
+{
+    return snprintf(buf, len, "%s%u%s@%lu",
+                    first ? "" : ",",
+                    (unsigned)s->value,
+                    (s->flags & TELEM_SAMPLE_RAW) ? "r" : "",
+                    (unsigned long)s->t_s);
+}
+
+static int encode_header(char *buf, size_t len, const telem_batch_t *b,
+                         const char *node_id, uint32_t now_s, uint16_t n)
+{
+    return snprintf(buf, len, "node=%s;now=%lu;n=%u;dropped=%lu;s=",
+                    node_id, (unsigned long)now_s, (unsigned)n,
+                    (unsigned long)b->dropped);
+}
+
+uint16_t telem_batch_encode(const telem_batch_t *b, const char *node_id, uint32_t now_s,
+                            char *buf, size_t buf_len)
+{
+    if (buf_len == 0) {
+        return 0;
+    }
+    buf[0] = '\0';
+
+    /*
+     * Pass 1: how many samples fit? The header is sized for n = count,
+     * which is never shorter than the header for the final n.
+     */
+    size_t used = (size_t)encode_header(NULL, 0, b, node_id, now_s, b->count);
+    uint16_t n = 0;
+
+    while (n < b->count) {
+        size_t len = (size_t)encode_sample(NULL, 0, telem_batch_at(b, n), n == 0);
+        if (used + len >= buf_len) {
+            break;
+        }
+        used += len;
+        n++;
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    /* Pass 2: write it */
+    size_t pos = (size_t)encode_header(buf, buf_len, b, node_id, now_s, n);
+    for (uint16_t i = 0; i < n; i++) {
+        pos += (size_t)encode_sample(buf + pos, buf_len - pos, telem_batch_at(b, i), i == 0);
+    }
+    return n;
+}
+
+void telem_batch_consume(telem_batch_t *b, uint16_t n)
+{
+    if (n > b->count) {
+        n = b->count;
+    }
+    b->head = (uint16_t)((b->head + n) % TELEM_BATCH_CAPACITY);
+    b->count = (uint16_t)(b->count - n);
+
+    /* delivered: the next batch starts counting again */
+    b->wakes = 0;
+    b->dropped = 0;
+}
+
+void telem_batch_postpone(telem_batch_t *b)
+{
+    b->wakes = 0;
+}
@@ -0,0 +1,470 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: compact binary telemetry (TLV, encoder + decoder)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "telem_tlv.h"
+
+/* ---- varints ---- */
+
+static size_t varint_len(uint32_t v)
+{
+    size_t n = 1;
+    while (v >= 0x80) {
+        v >>= 7;
+        n++;
+    }
+    return n;
+}
+
+static size_t varint_write(uint8_t *p, uint32_t v)
+{
+    size_t n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+/* false on truncation or more than 32 bits */
+static bool varint_read(const uint8_t **p, const uint8_t *end, uint32_t *out)
+{
+    uint32_t v = 0;
+    for (unsigned shift = 0; shift < 35; shift += 7) {
+        if (*p >= end) {
+            return false;
+        }
+        uint8_t b = *(*p)++;
+        if (shift == 28 && (b & 0x70)) {
+            return false;
+        }
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            *out = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t zigzag(int32_t v)
+{
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static int32_t unzigzag(uint32_t v)
+{
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+/* ---- Encoder ---- */
+
+void telem_tlv_begin(telem_tlv_writer_t *w, uint8_t *buf, size_t cap)
+{
+    w->buf = buf;
+    w->cap = cap;
+    w->len = 0;
+    w->overflow = (cap == 0);
+    if (!w->overflow) {
+        w->buf[w->len++] = TELEM_TLV_VERSION;
+    }
+}
+
+/* type + length header, false (and overflow) if the field does not fit */
+static bool put_header(telem_tlv_writer_t *w, telem_tlv_type_t type, size_t value_len)
+{
+    if (w->overflow ||
+        w->len + 1 + varint_len((uint32_t)value_len) + value_len > w->cap) {
+        w->overflow = true;
+        return false;
+    }
+    w->buf[w->len++] = (uint8_t)type;
+    w->len += varint_write(&w->buf[w->len], (uint32_t)value_len);
+    return true;
+}
+
+void telem_tlv_put_str(telem_tlv_writer_t *w, telem_tlv_type_t type, const char *str)
+{
+    size_t n = strlen(str);
+    if (put_header(w, type, n)) {
+        memcpy(&w->buf[w->len], str, n);
+        w->len += n;
+    }
+}
+
+void telem_tlv_put_uint(telem_tlv_writer_t *w, telem_tlv_type_t type, uint32_t value)
+{
+    if (put_header(w, type, varint_len(value))) {
+        w->len += varint_write(&w->buf[w->len], value);
+    }
+}
+
+void telem_tlv_put_imu(telem_tlv_writer_t *w, const telem_imu_t *imu)
+{
+    uint32_t zz[6];
+    size_t n = 0;
+
+    for (int i = 0; i < 3; i++) {
+        zz[i] = zigzag(imu->accel_mg[i]);
+        zz[i + 3] = zigzag(imu->gyro_mdps[i]);
+    }
+    for (int i = 0; i < 6; i++) {
+        n += varint_len(zz[i]);
+    }
+    if (put_header(w, TELEM_TLV_IMU, n)) {
+        for (int i = 0; i < 6; i++) {
+            w->len += varint_write(&w->buf[w->len], zz[i]);
+        }
+    }
+}
+
+static uint32_t sample_word(const telem_sample_t *s)
+{
+    return ((uint32_t)s->value << 1) | ((s->flags & TELEM_SAMPLE_RAW) ? 1u : 0u);
+}
+
+static uint32_t sample_age(const telem_sample_t *s, uint32_t now_s)
+{
+    return now_s >= s->t_s ? now_s - s->t_s : 0;    /* clock reset: "now" */
+}
+
+uint16_t telem_tlv_put_batch(telem_tlv_writer_t *w, const telem_batch_t *b, uint32_t now_s)
+{
+    if (w->overflow || b->count == 0) {
+        return 0;
+    }
+
+    /*
+     * Size first: header fields are sized for n = count (never shorter than
+     * for the final n), then samples are added while they fit.
+     */
+    size_t fixed = varint_len(now_s) + varint_len(b->dropped) + varint_len(b->count);
+    size_t body = fixed;
+    uint16_t n = 0;
+
+    while (n < b->count) {
+        const telem_sample_t *s = telem_batch_at(b, n);
+        size_t len = varint_len(sample_age(s, now_s)) + varint_len(sample_word(s));
+        if (w->len + 1 + varint_len((uint32_t)(body + len)) + body + len > w->cap) {
+            break;
+        }
+        body += len;
+        n++;
+    }
+    if (n == 0) {
+        return 0;   /* not an error: the caller may send the batch alone */
+    }
+
+    body += varint_len(n) - varint_len(b->count);
+    if (!put_header(w, TELEM_TLV_BATCH, body)) {
+        return 0;
+    }
+    w->len += varint_write(&w->buf[w->len], now_s);
+    w->len += varint_write(&w->buf[w->len], b->dropped);
+    w->len += varint_write(&w->buf[w->len], n);
+    for (uint16_t i = 0; i < n; i++) {
+        const telem_sample_t *s = telem_batch_at(b, i);
+        w->len += varint_write(&w->buf[w->len], sample_age(s, now_s));
+        w->len += varint_write(&w->buf[w->len], sample_word(s));
+    }
+    return n;
+}
+
+void telem_tlv_put_phases(telem_tlv_writer_t *w, const phase_timing_t *pt)
+{
+    uint32_t mask = 0;
+    size_t n;
+
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        if (pt->stat[i].n) {
+            mask |= 1u << i;
+        }
+    }
+    n = varint_len(pt->since_report) + varint_len(mask);
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        if (mask & (1u << i)) {
+            const phase_stat_t *s = &pt->stat[i];
+            n += varint_len(s->last_us) + varint_len(s->avg_us) + varint_len(s->max_us);
+        }
+    }
+    if (!put_header(w, TELEM_TLV_PHASES, n)) {
+        return;
+    }
+    w->len += varint_write(&w->buf[w->len], pt->since_report);
+    w->len += varint_write(&w->buf[w->len], mask);
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        if (mask & (1u << i)) {
+            const phase_stat_t *s = &pt->stat[i];
+            w->len += varint_write(&w->buf[w->len], s->last_us);
+            w->len += varint_write(&w->buf[w->len], s->avg_us);
+            w->len += varint_write(&w->buf[w->len], s->max_us);
+        }
+    }
+}
+
+static uint32_t energy_mask(const energy_acct_t *ea)
+{
+    uint32_t mask = 0;
+
+    for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+        if (ea->last_ms[i] || ea->total_nas[i]) {
+            mask |= 1u << i;
+        }
+    }
+    return mask;
+}
+
+void telem_tlv_put_energy(telem_tlv_writer_t *w, const energy_acct_t *ea)
+{
+    uint32_t mask = energy_mask(ea);
+    uint32_t total = energy_acct_total_uah(ea);
+    size_t n;
+
+    n = varint_len(ea->cycles) + varint_len(ea->delivered) + varint_len(total) +
+        varint_len(ea->last_uas) + varint_len(mask);
+    for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+        if (mask & (1u << i)) {
+            n += varint_len(ea->last_ms[i]) +
+                 varint_len(energy_acct_state_uah(ea, (energy_state_t)i));
+        }
+    }
+    if (!put_header(w, TELEM_TLV_ENERGY, n)) {
+        return;
+    }
+    w->len += varint_write(&w->buf[w->len], ea->cycles);
+    w->len += varint_write(&w->buf[w->len], ea->delivered);
+    w->len += varint_write(&w->buf[w->len], total);
+    w->len += varint_write(&w->buf[w->len], ea->last_uas);
+    w->len += varint_write(&w->buf[w->len], mask);
+    for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+        if (mask & (1u << i)) {
+            w->len += varint_write(&w->buf[w->len], ea->last_ms[i]);
+            w->len += varint_write(&w->buf[w->len],
+                                   energy_acct_state_uah(ea, (energy_state_t)i));
+        }
+    }
+}
+
+size_t telem_tlv_end(const telem_tlv_writer_t *w)
+{
+    return w->overflow ? 0 : w->len;
+}
+
+/* ---- Decoder ---- */
+
+bool telem_tlv_reader_init(telem_tlv_reader_t *r, const uint8_t *buf, size_t len)
+{
+    if (len == 0 || buf[0] == 0 || buf[0] > TELEM_TLV_VERSION) {
+        return false;
+    }
+    r->version = buf[0];
+    r->p = buf + 1;
+    r->end = buf + len;
+    return true;
+}
+
+int telem_tlv_next(telem_tlv_reader_t *r, telem_tlv_field_t *f)
+{
+    if (r->p >= r->end) {
+        return 0;
+    }
+
+    f->type = *r->p++;
+
+    uint32_t len;
+    if (!varint_read(&r->p, r->end, &len) || len > (size_t)(r->end - r->p)) {
+        r->p = r->end;
+        return -1;
+    }
+    f->value = r->p;
+    f->len = len;
+    r->p += len;
+    return 1;
+}
+
+/* Field holding exactly one varint */
+static bool field_uint(const telem_tlv_field_t *f, uint32_t *out)
+{
+    const uint8_t *p = f->value;
+    return varint_read(&p, f->value + f->len, out) && p == f->value + f->len;
+}
+
+static bool field_str(const telem_tlv_field_t *f, char *out, size_t out_len)
+{
+    if (f->len >= out_len || memchr(f->value, '\0', f->len)) {
+        return false;
+    }
+    memcpy(out, f->value, f->len);
+    out[f->len] = '\0';
+    return true;
+}
+
+static bool field_imu(const telem_tlv_field_t *f, telem_imu_t *imu)
+{
+    const uint8_t *p = f->value, *end = f->value + f->len;
+    uint32_t v;
+
+    for (int i = 0; i < 6; i++) {
+        if (!varint_read(&p, end, &v)) {
+            return false;
+        }
+        if (i < 3) {
+            imu->accel_mg[i] = unzigzag(v);
+        } else {
+            imu->gyro_mdps[i - 3] = unzigzag(v);
+        }
+    }
+    return p == end;
+}
+
+static bool field_batch(const telem_tlv_field_t *f, telem_msg_t *m)
+{
+    const uint8_t *p = f->value, *end = f->value + f->len;
+    uint32_t n;
+
+    if (!varint_read(&p, end, &m->now_s) ||
+        !varint_read(&p, end, &m->dropped) ||
+        !varint_read(&p, end, &n) ||
+        n > TELEM_BATCH_CAPACITY) {
+        return false;
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t age, word;
+        if (!varint_read(&p, end, &age) || !varint_read(&p, end, &word) ||
+            (word >> 1) > UINT16_MAX) {
+            return false;
+        }
+        m->samples[i].t_s = m->now_s - age;
+        m->samples[i].value = (uint16_t)(word >> 1);
+        m->samples[i].flags = (word & 1) ? TELEM_SAMPLE_RAW : 0;
+    }
+    m->n_samples = (uint16_t)n;
+    return p == end;
+}
+
+/* Phases this decoder does not know (newer firmware) are read and dropped */
+static bool field_phases(const telem_tlv_field_t *f, telem_msg_t *m)
+{
+    const uint8_t *p = f->value, *end = f->value + f->len;
+    uint32_t mask;
+
+    if (!varint_read(&p, end, &m->phase_wakes) || !varint_read(&p, end, &mask)) {
+        return false;
+    }
+    for (int i = 0; i < 32; i++) {
+        phase_stat_t s = { 0 };
+        if (!(mask & (1u << i))) {
+            continue;
+        }
+        if (!varint_read(&p, end, &s.last_us) || !varint_read(&p, end, &s.avg_us) ||
+            !varint_read(&p, end, &s.max_us)) {
+            return false;
+        }
+        if (i < PHASE_COUNT) {
+            m->phases[i] = s;
+        }
+    }
+    m->phase_mask = mask & ((1u << PHASE_COUNT) - 1);
+    return p == end;
+}
+
+/* States this decoder does not know (newer firmware) are read and dropped */
+static bool field_energy(const telem_tlv_field_t *f, telem_msg_t *m)
+{
+    const uint8_t *p = f->value, *end = f->value + f->len;
+    uint32_t mask;
+
+    if (!varint_read(&p, end, &m->energy_cycles) ||
+        !varint_read(&p, end, &m->energy_delivered) ||
+        !varint_read(&p, end, &m->energy_uah) ||
+        !varint_read(&p, end, &m->energy_cycle_uas) ||
+        !varint_read(&p, end, &mask)) {
+        return false;
+    }
+    for (int i = 0; i < 32; i++) {
+        uint32_t ms, uah;
+        if (!(mask & (1u << i))) {
+            continue;
+        }
+        if (!varint_read(&p, end, &ms) || !varint_read(&p, end, &uah)) {
+            return false;
+        }
+        if (i < ENERGY_STATE_COUNT) {
+            m->energy_ms[i] = ms;
+            m->energy_state_uah[i] = uah;
+        }
+    }
+    m->energy_mask = mask & ((1u << ENERGY_STATE_COUNT) - 1);
+    return p == end;
+}
+
+bool telem_tlv_decode(const uint8_t *buf, size_t len, telem_msg_t *out)
+{
+    telem_tlv_reader_t r;
+    telem_tlv_field_t f;
+    int rc;
+
+    memset(out, 0, sizeof(*out));
+    if (!telem_tlv_reader_init(&r, buf, len)) {
+        return false;
+    }
+
+    while ((rc = telem_tlv_next(&r, &f)) == 1) {
+        bool ok = true;
+
+        switch (f.type) {
+            case TELEM_TLV_NODE_ID:
+                ok = field_str(&f, out->node_id, sizeof(out->node_id));
+                break;
+            case TELEM_TLV_FW_VERSION:
+                ok = field_str(&f, out->fw_version, sizeof(out->fw_version));
+                break;
+            case TELEM_TLV_WAKE_REASON:
+                ok = out->has_wake_reason = field_uint(&f, &out->wake_reason);
+                break;
+            case TELEM_TLV_AWAKE_MS:
+                ok = out->has_awake_ms = field_uint(&f, &out->awake_ms);
+                break;
+            case TELEM_TLV_ADC_MV:
+                ok = out->has_adc_mv = field_uint(&f, &out->adc_mv);
+                break;
+            case TELEM_TLV_ADC_RAW:
+                ok = out->has_adc_raw = field_uint(&f, &out->adc_raw);
+                break;
+            case TELEM_TLV_IMU:
+                ok = out->has_imu = field_imu(&f, &out->imu);
+                break;
+            case TELEM_TLV_BATCH:
+                ok = field_batch(&f, out);
+                break;
+            case TELEM_TLV_PHASES:
+                ok = out->has_phases = field_phases(&f, out);
+                break;
+            case TELEM_TLV_ENERGY:
+                ok = out->has_energy = field_energy(&f, out);
+                break;
+            default:
+                break;      /* newer field: skip */
+        }
+        if (!ok) {
+            return false;
+        }
+    }
+    return rc == 0;
+}
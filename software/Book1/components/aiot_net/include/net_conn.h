@@ -0,0 +1,113 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: Wi-Fi station bring-up with backoff and readiness API
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * One network bring-up for all projects (replaces the per-project
+ * wifi_event_handler / wifi_init_and_connect copies):
+ *
+ *   net_conn_start(&cfg);                      non-blocking
+ *   if (net_conn_wait_ready(timeout) == ESP_OK) mqtt_start();
+ *
+ * Inside: net_sm (state machine, see net_sm.h), jittered exponential
+ * backoff, an optional connect deadline, disconnect reasons in clear text,
+ * and optionally the RTC fast reconnect (wifi_fast.h).
+ *
+ * State changes are also posted as NET_CONN_EVENT to the default event
+ * loop, so MQTT/HTTP code can react without polling.
+ *
+ * Always-on nodes choose the Wi-Fi modem sleep here: MAX_MODEM sleeps
+ * 'listen_interval' beacons (about 102 ms each) between two wakes of the
+ * radio, so a message from the broker waits up to that long at the AP.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_netif.h"
+
+#include "net_sm.h"
+
+ESP_EVENT_DECLARE_BASE(NET_CONN_EVENT);
+
+typedef enum {
+    NET_CONN_EVENT_READY,           /* got IP */
+    NET_CONN_EVENT_LOST,            /* was ready, link or address lost */
+    NET_CONN_EVENT_FAILED,          /* retries used up or deadline passed */
+} net_conn_event_id_t;
+
+/* Wi-Fi modem sleep (esp_wifi_set_ps), DEFAULT leaves the IDF setting alone */
+typedef enum {
+    NET_CONN_PS_DEFAULT = 0,        /* IDF default: MIN_MODEM */
+    NET_CONN_PS_NONE,               /* radio always on: lowest latency, ~100 mA */
+    NET_CONN_PS_MIN_MODEM,          /* wake every DTIM */
+    NET_CONN_PS_MAX_MODEM,          /* wake every listen_interval beacons */
+} net_conn_ps_t;
+
+/* Bits in net_conn_event_group() */
+#define NET_CONN_READY_BIT      BIT0
+#define NET_CONN_FAIL_BIT       BIT1
+
+typedef struct {
+    const char *ssid;
+    const char *password;
+    const char *hostname;           /* NULL = IDF default */
+    bool        pmf_capable;
+
+    uint16_t    max_retries;        /* per outage, 0 = forever */
+    uint32_t    backoff_base_ms;    /* 0 -> 500 ms */
+    uint32_t    backoff_max_ms;     /* 0 -> 30 s */
+    uint32_t    connect_timeout_ms; /* first READY must happen within, 0 = none */
+
+    bool        fast_reconnect;     /* RTC cache of AP + lease (deep sleep nodes) */
+
+    net_conn_ps_t power_save;
+    uint8_t     listen_interval;    /* beacons, MAX_MODEM only, 0 -> IDF default (3) */
+} net_conn_config_t;
+
+/*
+ * Init netif, default event loop (if not yet created) and Wi-Fi driver,
+ * then start connecting. Returns immediately.
+ */
+esp_err_t net_conn_start(const net_conn_config_t *cfg);
+
+/* ESP_OK = ready, ESP_FAIL = gave up, ESP_ERR_TIMEOUT = still trying */
+esp_err_t net_conn_wait_ready(TickType_t timeout);
+
+bool net_conn_is_ready(void);
+
+/* Switch the modem sleep at runtime (after net_conn_start) */
+esp_err_t net_conn_set_power_save(net_conn_ps_t ps);
+
+/* "none", "min_modem", ... for logs and status messages */
+const char *net_conn_ps_name(net_conn_ps_t ps);
+
+net_state_t net_conn_state(void);
+
+/* Last WIFI_REASON_xxx seen on disconnect (0 = none) */
+uint16_t net_conn_last_reason(void);
+
+const char *net_conn_reason_str(uint16_t reason);
+
+EventGroupHandle_t net_conn_event_group(void);
+
+esp_netif_t *net_conn_netif(void);
@@ -0,0 +1,99 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: network connection state machine (pure logic)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * The state machine only decides WHAT to do. It never calls the Wi-Fi
+ * driver or a timer itself: net_conn.c translates Wi-Fi/IP events into
+ * net_sm_event_t and executes the returned action. Any other event source
+ * (a test, a simulator) can drive it the same way.
+ *
+ *            START                  CONNECTED             GOT_IP
+ *   IDLE ---------> CONNECTING ---------------> ASSOCIATED -------> READY
+ *                     ^    |                        |                 |
+ *      BACKOFF_EXPIRED|    | DISCONNECTED           | DISCONNECTED    | DISCONNECTED
+ *                     |    v                        v                 v
+ *                    BACKOFF <-----------------------------------------
+ *                       |
+ *                       | retries used up / DEADLINE
+ *                       v
+ *                     FAILED
+ *
+ * Backoff: base * 2^attempt, capped at max, with "equal jitter"
+ * (half fixed, half random) so a fleet does not reconnect in lockstep
+ * after an AP reboot.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef enum {
+    NET_STATE_IDLE = 0,
+    NET_STATE_CONNECTING,       /* esp_wifi_connect() issued */
+    NET_STATE_ASSOCIATED,       /* link up, waiting for an address */
+    NET_STATE_READY,            /* got IP: MQTT/HTTP may start */
+    NET_STATE_BACKOFF,          /* waiting before the next attempt */
+    NET_STATE_FAILED,           /* retries used up or deadline passed */
+} net_state_t;
+
+typedef enum {
+    NET_EV_START = 0,           /* driver started (WIFI_EVENT_STA_START) */
+    NET_EV_CONNECTED,
+    NET_EV_GOT_IP,
+    NET_EV_LOST_IP,
+    NET_EV_DISCONNECTED,
+    NET_EV_BACKOFF_EXPIRED,
+    NET_EV_DEADLINE,            /* connect deadline passed */
+} net_sm_event_t;
+
+typedef enum {
+    NET_ACT_NONE = 0,
+    NET_ACT_CONNECT,            /* call esp_wifi_connect() now */
+    NET_ACT_BACKOFF,            /* arm the backoff timer with delay_ms */
+    NET_ACT_READY,              /* signal "network ready" */
+    NET_ACT_FAIL,               /* signal "failed", stop trying */
+} net_sm_action_type_t;
+
+typedef struct {
+    net_sm_action_type_t type;
+    uint32_t             delay_ms;
+    bool                 ready_lost;    /* was READY before this event */
+} net_sm_action_t;
+
+typedef struct {
+    uint16_t max_retries;       /* per outage, 0 = retry forever */
+    uint32_t backoff_base_ms;
+    uint32_t backoff_max_ms;
+} net_sm_config_t;
+
+typedef struct {
+    net_sm_config_t cfg;
+    net_state_t     state;
+    uint16_t        attempt;    /* failed attempts since the last READY */
+    uint16_t        last_reason;
+    uint32_t        rng;        /* xorshift32 state for the jitter */
+} net_sm_t;
+
+void net_sm_init(net_sm_t *sm, const net_sm_config_t *cfg, uint32_t seed);
+
+/* Feed one event. reason is only used for NET_EV_DISCONNECTED. */
+net_sm_action_t net_sm_handle(net_sm_t *sm, net_sm_event_t ev, uint16_t reason);
+
+/* Backoff before attempt n (0 = first retry), jitter included */
+uint32_t net_sm_backoff_ms(net_sm_t *sm, uint16_t attempt);
+
+const char *net_sm_state_name(net_state_t state);
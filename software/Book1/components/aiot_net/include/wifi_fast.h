@@ -0,0 +1,101 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: Wi-Fi fast reconnect from RTC memory
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY A FAST RECONNECT?
+ * ---------------------
+ * A sensor node that wakes every 30 s spends most of its awake time in
+ * Wi-Fi: scanning all channels, associating, then waiting for DHCP.
+ * The AP and the address rarely change between two wakes, so we keep in
+ * RTC memory (survives deep sleep):
+ *
+ *   - BSSID + channel of the AP   -> connect without a full scan
+ *   - IP / mask / gateway / DNS   -> skip DHCP while the lease is valid
+ *
+ * If the fast attempt fails (AP moved, lease gone), the cache is dropped
+ * and the normal scan + DHCP path runs in the same wake.
+ *
+ * Usage from a Wi-Fi event handler:
+ *
+ *   wifi_fast_apply(netif, &wifi_config);     before esp_wifi_set_config()
+ *   WIFI_EVENT_STA_CONNECTED    -> wifi_fast_on_connected()
+ *   WIFI_EVENT_STA_DISCONNECTED -> if (wifi_fast_on_disconnected()) reconnect
+ *   IP_EVENT_STA_GOT_IP         -> wifi_fast_on_got_ip(event)
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+#include "esp_netif.h"
+#include "esp_wifi.h"
+
+/*
+ * A cached DHCP address is reused until T1 (half the lease), the point where
+ * a DHCP client would renew anyway. Used if the server lease is unknown:
+ */
+#define WIFI_FAST_LEASE_DEFAULT_SEC  3600
+
+typedef enum {
+    WIFI_FAST_PATH_FULL = 0,        /* scan + DHCP (cold boot or no cache) */
+    WIFI_FAST_PATH_FAST,            /* known channel/BSSID, cached IP */
+    WIFI_FAST_PATH_FAST_DHCP,       /* known channel/BSSID, lease expired */
+    WIFI_FAST_PATH_FALLBACK,        /* fast attempt failed, full path */
+} wifi_fast_path_t;
+
+typedef struct {
+    wifi_fast_path_t path;          /* path of the current wake */
+    uint32_t wake_to_ip_ms;         /* this wake, 0 until GOT_IP */
+    uint32_t last_fast_ms;          /* last wake that used the fast path */
+    uint32_t last_full_ms;          /* last wake that used scan + DHCP */
+    uint32_t fast_ok;
+    uint32_t fast_fail;
+} wifi_fast_stats_t;
+
+/*
+ * Optional: static address used when no valid lease is cached.
+ * Call before wifi_fast_apply(). dns may be 0.
+ */
+void wifi_fast_set_static_ip(const esp_netif_ip_info_t *ip, uint32_t dns);
+
+/*
+ * Patch wifi_config for the fast path (channel, BSSID) and, if a lease or
+ * static address is available, stop the DHCP client and set the address.
+ * Returns true if the fast path is used for this wake.
+ */
+bool wifi_fast_apply(esp_netif_t *netif, wifi_config_t *wifi_config);
+
+/* Remember BSSID and channel of the AP we are associated with */
+void wifi_fast_on_connected(void);
+
+/*
+ * Call on every disconnect. Returns true if the fast attempt just failed and
+ * the normal path has been restored: the caller should call esp_wifi_connect()
+ * without counting it as a retry.
+ */
+bool wifi_fast_on_disconnected(void);
+
+/* Store the address and lease, log wake -> IP time */
+void wifi_fast_on_got_ip(const ip_event_got_ip_t *event);
+
+/* Forget everything (e.g. MQTT broker unreachable with the cached address) */
+void wifi_fast_invalidate(void);
+
+void wifi_fast_get_stats(wifi_fast_stats_t *out);
+
+const char *wifi_fast_path_name(wifi_fast_path_t path);
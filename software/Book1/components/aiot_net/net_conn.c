@@ -0,0 +1,350 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: Wi-Fi station bring-up with backoff and readiness API
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_wifi.h"
+
+#include "net_conn.h"
+#include "wifi_fast.h"
+
+static const char *TAG = "NET";
+
+#define NET_BACKOFF_BASE_DEFAULT_MS 500
+#define NET_BACKOFF_MAX_DEFAULT_MS  30000
+
+ESP_EVENT_DEFINE_BASE(NET_CONN_EVENT);
+
+/* timers post here, so the state machine only runs in the event loop task */
+ESP_EVENT_DEFINE_BASE(NET_CONN_TIMER_EVENT);
+enum { NET_TIMER_BACKOFF, NET_TIMER_DEADLINE };
+
+static net_conn_config_t   s_cfg;
+static net_sm_t            s_sm;
+static EventGroupHandle_t  s_events = NULL;
+static esp_netif_t        *s_netif = NULL;
+static esp_timer_handle_t  s_backoff_timer = NULL;
+static esp_timer_handle_t  s_deadline_timer = NULL;
+
+/* --------------------------------------------------------------------------
+ * Disconnect reasons (the common ones, see esp_wifi_types.h)
+ * -------------------------------------------------------------------------- */
+
+const char *net_conn_reason_str(uint16_t reason)
+{
+    switch (reason) {
+        case 0:                                     return "none";
+        case WIFI_REASON_AUTH_EXPIRE:               return "auth expired";
+        case WIFI_REASON_ASSOC_LEAVE:               return "left (assoc leave)";
+        case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:    return "4-way handshake timeout (password?)";
+        case WIFI_REASON_BEACON_TIMEOUT:            return "beacon timeout (AP gone / weak signal)";
+        case WIFI_REASON_NO_AP_FOUND:               return "no AP found (SSID / channel)";
+        case WIFI_REASON_AUTH_FAIL:                 return "auth failed (password?)";
+        case WIFI_REASON_ASSOC_FAIL:                return "assoc failed";
+        case WIFI_REASON_HANDSHAKE_TIMEOUT:         return "handshake timeout";
+        case WIFI_REASON_CONNECTION_FAIL:           return "connection failed";
+        default:                                    return "other";
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Modem sleep
+ * -------------------------------------------------------------------------- */
+
+static wifi_ps_type_t net_conn_ps_type(net_conn_ps_t ps)
+{
+    switch (ps) {
+        case NET_CONN_PS_NONE:      return WIFI_PS_NONE;
+        case NET_CONN_PS_MAX_MODEM: return WIFI_PS_MAX_MODEM;
+        default:                    return WIFI_PS_MIN_MODEM;
+    }
+}
+
+const char *net_conn_ps_name(net_conn_ps_t ps)
+{
+    switch (ps) {
+        case NET_CONN_PS_DEFAULT:   return "default";
+        case NET_CONN_PS_NONE:      return "none";
+        case NET_CONN_PS_MIN_MODEM: return "min_modem";
+        case NET_CONN_PS_MAX_MODEM: return "max_modem";
+        default:                    return "?";
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Execute what the state machine decided
+ * -------------------------------------------------------------------------- */
+
+static void net_conn_execute(net_sm_action_t act)
+{
+    if (act.ready_lost) {
+        xEventGroupClearBits(s_events, NET_CONN_READY_BIT);
+        ESP_LOGW(TAG, "Network lost (reason %u: %s)",
+                 s_sm.last_reason, net_conn_reason_str(s_sm.last_reason));
+        esp_event_post(NET_CONN_EVENT, NET_CONN_EVENT_LOST, NULL, 0, 0);
+    }
+
+    switch (act.type) {
+        case NET_ACT_CONNECT:
+            esp_wifi_connect();
+            break;
+
+        case NET_ACT_BACKOFF:
+            ESP_LOGW(TAG, "Disconnected (reason %u: %s). Retry %u in %lu ms",
+                     s_sm.last_reason, net_conn_reason_str(s_sm.last_reason),
+                     s_sm.attempt, (unsigned long)act.delay_ms);
+            esp_timer_stop(s_backoff_timer);
+            esp_timer_start_once(s_backoff_timer, (uint64_t)act.delay_ms * 1000ULL);
+            break;
+
+        case NET_ACT_READY:
+            esp_timer_stop(s_deadline_timer);
+            xEventGroupClearBits(s_events, NET_CONN_FAIL_BIT);
+            xEventGroupSetBits(s_events, NET_CONN_READY_BIT);
+            esp_event_post(NET_CONN_EVENT, NET_CONN_EVENT_READY, NULL, 0, 0);
+            break;
+
+        case NET_ACT_FAIL:
+            esp_timer_stop(s_backoff_timer);
+            esp_timer_stop(s_deadline_timer);
+            ESP_LOGE(TAG, "Wi-Fi failed (state %s, last reason %u: %s)",
+                     net_sm_state_name(s_sm.state),
+                     s_sm.last_reason, net_conn_reason_str(s_sm.last_reason));
+            xEventGroupSetBits(s_events, NET_CONN_FAIL_BIT);
+            esp_event_post(NET_CONN_EVENT, NET_CONN_EVENT_FAILED, NULL, 0, 0);
+            break;
+
+        default:
+            break;
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Event source -> state machine events
+ * -------------------------------------------------------------------------- */
+
+static void net_conn_event_handler(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    (void)arg;
+
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_START) {
+        ESP_LOGI(TAG, "Wi-Fi started, connecting to %s...", s_cfg.ssid);
+        net_conn_execute(net_sm_handle(&s_sm, NET_EV_START, 0));
+        return;
+    }
+
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_CONNECTED) {
+        if (s_cfg.fast_reconnect) {
+            wifi_fast_on_connected();
+        }
+        net_conn_execute(net_sm_handle(&s_sm, NET_EV_CONNECTED, 0));
+        return;
+    }
+
+    if (base == WIFI_EVENT && id == WIFI_EVENT_STA_DISCONNECTED) {
+        wifi_event_sta_disconnected_t *ev = (wifi_event_sta_disconnected_t *)data;
+
+        /* cached AP/lease did not work: retry at once on the normal path */
+        if (s_cfg.fast_reconnect && wifi_fast_on_disconnected()) {
+            esp_wifi_connect();
+            return;
+        }
+        net_conn_execute(net_sm_handle(&s_sm, NET_EV_DISCONNECTED, ev->reason));
+        return;
+    }
+
+    if (base == IP_EVENT && id == IP_EVENT_STA_GOT_IP) {
+        ip_event_got_ip_t *event = (ip_event_got_ip_t *)data;
+        ESP_LOGI(TAG, "Got IP: " IPSTR, IP2STR(&event->ip_info.ip));
+        if (s_cfg.fast_reconnect) {
+            wifi_fast_on_got_ip(event);
+        }
+        net_conn_execute(net_sm_handle(&s_sm, NET_EV_GOT_IP, 0));
+        return;
+    }
+
+    if (base == IP_EVENT && id == IP_EVENT_STA_LOST_IP) {
+        net_conn_execute(net_sm_handle(&s_sm, NET_EV_LOST_IP, 0));
+        return;
+    }
+
+    if (base == NET_CONN_TIMER_EVENT) {
+        net_sm_event_t ev = (id == NET_TIMER_BACKOFF) ? NET_EV_BACKOFF_EXPIRED : NET_EV_DEADLINE;
+        net_conn_execute(net_sm_handle(&s_sm, ev, 0));
+        return;
+    }
+}
+
+/* esp_timer task context */
+static void net_conn_timer_cb(void *arg)
+{
+    esp_event_post(NET_CONN_TIMER_EVENT, (int32_t)(intptr_t)arg, NULL, 0, 0);
+}
+
+/* --------------------------------------------------------------------------
+ * Public API
+ * -------------------------------------------------------------------------- */
+
+esp_err_t net_conn_start(const net_conn_config_t *cfg)
+{
+    if (!cfg || !cfg->ssid) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_events) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_cfg = *cfg;
+    net_sm_config_t sm_cfg = {
+        .max_retries = cfg->max_retries,
+        .backoff_base_ms = cfg->backoff_base_ms ? cfg->backoff_base_ms : NET_BACKOFF_BASE_DEFAULT_MS,
+        .backoff_max_ms = cfg->backoff_max_ms ? cfg->backoff_max_ms : NET_BACKOFF_MAX_DEFAULT_MS,
+    };
+    net_sm_init(&s_sm, &sm_cfg, esp_random());
+
+    s_events = xEventGroupCreate();
+    if (!s_events) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_ERROR_CHECK(esp_netif_init());
+
+    /* INVALID_STATE = the application already created it, that's fine */
+    esp_err_t err = esp_event_loop_create_default();
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        return err;
+    }
+
+    s_netif = esp_netif_create_default_wifi_sta();
+    if (cfg->hostname) {
+        ESP_ERROR_CHECK(esp_netif_set_hostname(s_netif, cfg->hostname));
+    }
+
+    wifi_init_config_t init_cfg = WIFI_INIT_CONFIG_DEFAULT();
+    ESP_ERROR_CHECK(esp_wifi_init(&init_cfg));
+
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        WIFI_EVENT, ESP_EVENT_ANY_ID, &net_conn_event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        IP_EVENT, IP_EVENT_STA_GOT_IP, &net_conn_event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        IP_EVENT, IP_EVENT_STA_LOST_IP, &net_conn_event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        NET_CONN_TIMER_EVENT, ESP_EVENT_ANY_ID, &net_conn_event_handler, NULL, NULL));
+
+    const esp_timer_create_args_t backoff_args = {
+        .callback = net_conn_timer_cb,
+        .arg = (void *)(intptr_t)NET_TIMER_BACKOFF,
+        .name = "net_backoff",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&backoff_args, &s_backoff_timer));
+
+    const esp_timer_create_args_t deadline_args = {
+        .callback = net_conn_timer_cb,
+        .arg = (void *)(intptr_t)NET_TIMER_DEADLINE,
+        .name = "net_deadline",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&deadline_args, &s_deadline_timer));
+
+    wifi_config_t wifi_config = {0};
+    strncpy((char *)wifi_config.sta.ssid, cfg->ssid, sizeof(wifi_config.sta.ssid));
+    if (cfg->password) {
+        strncpy((char *)wifi_config.sta.password, cfg->password, sizeof(wifi_config.sta.password));
+    }
+    wifi_config.sta.pmf_cfg.capable = cfg->pmf_capable;
+    wifi_config.sta.pmf_cfg.required = false;
+    wifi_config.sta.listen_interval = cfg->listen_interval;
+
+    /* known AP/lease from the last wake: skip channel scan and DHCP */
+    if (cfg->fast_reconnect) {
+        wifi_fast_apply(s_netif, &wifi_config);
+    }
+
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
+    if (cfg->power_save != NET_CONN_PS_DEFAULT) {
+        ESP_ERROR_CHECK(esp_wifi_set_ps(net_conn_ps_type(cfg->power_save)));
+    }
+
+    if (cfg->connect_timeout_ms) {
+        esp_timer_start_once(s_deadline_timer, (uint64_t)cfg->connect_timeout_ms * 1000ULL);
+    }
+
+    /* triggers WIFI_EVENT_STA_START -> state machine takes over */
+    return esp_wifi_start();
+}
+
+esp_err_t net_conn_wait_ready(TickType_t timeout)
+{
+    if (!s_events) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    EventBits_t bits = xEventGroupWaitBits(s_events,
+                                           NET_CONN_READY_BIT | NET_CONN_FAIL_BIT,
+                                           pdFALSE, pdFALSE, timeout);
+    if (bits & NET_CONN_READY_BIT) {
+        return ESP_OK;
+    }
+    if (bits & NET_CONN_FAIL_BIT) {
+        return ESP_FAIL;
+    }
+    return ESP_ERR_TIMEOUT;
+}
+
+bool net_conn_is_ready(void)
+{
+    return s_events && (xEventGroupGetBits(s_events) & NET_CONN_READY_BIT);
+}
+
+esp_err_t net_conn_set_power_save(net_conn_ps_t ps)
+{
+    if (!s_events) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if ((unsigned)ps > NET_CONN_PS_MAX_MODEM) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = esp_wifi_set_ps(net_conn_ps_type(ps));
+    if (err == ESP_OK) {
+        s_cfg.power_save = ps;
+        ESP_LOGI(TAG, "Wi-Fi power save: %s", net_conn_ps_name(ps));
+    }
+    return err;
+}
+
+net_state_t net_conn_state(void)
+{
+    return s_sm.state;
+}
+
+uint16_t net_conn_last_reason(void)
+{
+    return s_sm.last_reason;
+}
+
+EventGroupHandle_t net_conn_event_group(void)
+{
+    return s_events;
+}
+
+esp_netif_t *net_conn_netif(void)
+{
+    return s_netif;
+}
@@ -0,0 +1,159 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: network connection state machine (pure logic)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "net_sm.h"
+
+static uint32_t sm_rand(net_sm_t *sm)
+{
+    uint32_t x = sm->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    sm->rng = x;
+    return x;
+}
+
+void net_sm_init(net_sm_t *sm, const net_sm_config_t *cfg, uint32_t seed)
+{
+    memset(sm, 0, sizeof(*sm));
+    sm->cfg = *cfg;
+    sm->state = NET_STATE_IDLE;
+    sm->rng = seed ? seed : 0x2545F491u;    /* xorshift must not start at 0 */
+}
+
+uint32_t net_sm_backoff_ms(net_sm_t *sm, uint16_t attempt)
+{
+    uint32_t delay = sm->cfg.backoff_base_ms;
+
+    for (uint16_t i = 0; i < attempt && delay < sm->cfg.backoff_max_ms; i++) {
+        if (delay > sm->cfg.backoff_max_ms / 2) {
+            delay = sm->cfg.backoff_max_ms;     /* doubling could wrap around */
+            break;
+        }
+        delay *= 2;
+    }
+    if (delay > sm->cfg.backoff_max_ms) {
+        delay = sm->cfg.backoff_max_ms;
+    }
+
+    /* equal jitter: [delay/2, delay] */
+    uint32_t half = delay / 2;
+    return half + (half ? sm_rand(sm) % (half + 1) : 0);
+}
+
+/* A connect attempt failed: wait, or give up */
+static net_sm_action_t sm_attempt_failed(net_sm_t *sm)
+{
+    net_sm_action_t act = { .type = NET_ACT_NONE };
+
+    if (sm->cfg.max_retries && sm->attempt >= sm->cfg.max_retries) {
+        sm->state = NET_STATE_FAILED;
+        act.type = NET_ACT_FAIL;
+        return act;
+    }
+
+    act.type = NET_ACT_BACKOFF;
+    act.delay_ms = net_sm_backoff_ms(sm, sm->attempt);
+    sm->attempt++;
+    sm->state = NET_STATE_BACKOFF;
+    return act;
+}
+
+net_sm_action_t net_sm_handle(net_sm_t *sm, net_sm_event_t ev, uint16_t reason)
+{
+    net_sm_action_t act = { .type = NET_ACT_NONE };
+
+    /* terminal until net_sm_init() */
+    if (sm->state == NET_STATE_FAILED) {
+        return act;
+    }
+
+    switch (ev) {
+        case NET_EV_START:
+            if (sm->state == NET_STATE_IDLE) {
+                sm->state = NET_STATE_CONNECTING;
+                act.type = NET_ACT_CONNECT;
+            }
+            break;
+
+        case NET_EV_CONNECTED:
+            if (sm->state == NET_STATE_CONNECTING) {
+                sm->state = NET_STATE_ASSOCIATED;
+            }
+            break;
+
+        case NET_EV_GOT_IP:
+            if (sm->state != NET_STATE_IDLE) {
+                sm->state = NET_STATE_READY;
+                sm->attempt = 0;
+                act.type = NET_ACT_READY;
+            }
+            break;
+
+        case NET_EV_LOST_IP:
+            if (sm->state == NET_STATE_READY) {
+                /* link still up, DHCP will try again */
+                sm->state = NET_STATE_ASSOCIATED;
+                act.ready_lost = true;
+            }
+            break;
+
+        case NET_EV_DISCONNECTED: {
+            sm->last_reason = reason;
+            if (sm->state == NET_STATE_IDLE || sm->state == NET_STATE_BACKOFF) {
+                break;      /* late event of an attempt we already handled */
+            }
+            bool lost = (sm->state == NET_STATE_READY);
+            act = sm_attempt_failed(sm);
+            act.ready_lost = lost;
+            break;
+        }
+
+        case NET_EV_BACKOFF_EXPIRED:
+            if (sm->state == NET_STATE_BACKOFF) {
+                sm->state = NET_STATE_CONNECTING;
+                act.type = NET_ACT_CONNECT;
+            }
+            break;
+
+        case NET_EV_DEADLINE:
+            if (sm->state != NET_STATE_READY) {
+                sm->state = NET_STATE_FAILED;
+                act.type = NET_ACT_FAIL;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    return act;
+}
+
+const char *net_sm_state_name(net_state_t state)
+{
+    switch (state) {
+        case NET_STATE_IDLE:       return "idle";
+        case NET_STATE_CONNECTING: return "connecting";
+        case NET_STATE_ASSOCIATED: return "associated";
+        case NET_STATE_READY:      return "ready";
+        case NET_STATE_BACKOFF:    return "backoff";
+        case NET_STATE_FAILED:     return "failed";
+        default:                   return "?";
+    }
+}
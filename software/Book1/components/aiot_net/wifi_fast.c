@@ -0,0 +1,288 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: Wi-Fi fast reconnect from RTC memory
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <string.h>
+#include <time.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+#include "esp_netif_net_stack.h"
+#include "lwip/dhcp.h"
+
+#include "wifi_fast.h"
+
+static const char *TAG = "WIFI_FAST";
+
+#define WIFI_FAST_MAGIC     0xFA57C0DEu
+
+typedef struct {
+    uint32_t magic;
+
+    /* AP (valid after the first association) */
+    bool     have_ap;
+    char     ssid[33];
+    uint8_t  bssid[6];
+    uint8_t  channel;
+
+    /* DHCP lease (valid after the first GOT_IP on the DHCP path) */
+    bool     have_lease;
+    uint32_t ip;
+    uint32_t netmask;
+    uint32_t gw;
+    uint32_t dns;
+    int64_t  lease_from_s;      /* time(): RTC keeps counting in deep sleep */
+    int64_t  reuse_until_s;
+
+    wifi_fast_stats_t stats;
+} wifi_fast_cache_t;
+
+/* survives deep sleep, cleared on power-on */
+static RTC_DATA_ATTR wifi_fast_cache_t s_rtc;
+
+static esp_netif_t         *s_netif = NULL;
+static wifi_fast_path_t     s_path = WIFI_FAST_PATH_FULL;
+static bool                 s_dhcp_stopped = false;
+static bool                 s_got_ip = false;
+
+static bool                 s_have_static = false;
+static esp_netif_ip_info_t  s_static_ip;
+static uint32_t             s_static_dns;
+
+static void cache_check(void)
+{
+    if (s_rtc.magic != WIFI_FAST_MAGIC) {
+        memset(&s_rtc, 0, sizeof(s_rtc));
+        s_rtc.magic = WIFI_FAST_MAGIC;
+    }
+}
+
+static bool lease_valid(void)
+{
+    int64_t now = (int64_t)time(NULL);
+    return s_rtc.have_lease && now >= s_rtc.lease_from_s && now < s_rtc.reuse_until_s;
+}
+
+typedef struct {
+    esp_netif_t *netif;
+    uint32_t     lease_s;
+} lease_query_t;
+
+/*
+ * Runs in the tcpip thread (esp_netif_tcpip_exec): the lwIP DHCP client
+ * owns struct dhcp there and may be updating it while the event task runs.
+ */
+static esp_err_t lease_query_tcpip(void *ctx)
+{
+    lease_query_t *q = (lease_query_t *)ctx;
+    struct netif *lwip_netif = esp_netif_get_netif_impl(q->netif);
+    struct dhcp *dhcp = lwip_netif ? netif_dhcp_data(lwip_netif) : NULL;
+    if (dhcp && dhcp->offered_t0_lease) {
+        q->lease_s = dhcp->offered_t0_lease;
+    }
+    return ESP_OK;
+}
+
+static void set_dns(uint32_t dns)
+{
+    if (!dns) {
+        return;
+    }
+    esp_netif_dns_info_t info = {
+        .ip.type = ESP_IPADDR_TYPE_V4,
+        .ip.u_addr.ip4.addr = dns,
+    };
+    esp_netif_set_dns_info(s_netif, ESP_NETIF_DNS_MAIN, &info);
+}
+
+/* --------------------------------------------------------------------------
+ * Public API
+ * -------------------------------------------------------------------------- */
+
+void wifi_fast_set_static_ip(const esp_netif_ip_info_t *ip, uint32_t dns)
+{
+    s_static_ip = *ip;
+    s_static_dns = dns;
+    s_have_static = true;
+}
+
+bool wifi_fast_apply(esp_netif_t *netif, wifi_config_t *wifi_config)
+{
+    cache_check();
+    s_netif = netif;
+    s_got_ip = false;
+    s_path = WIFI_FAST_PATH_FULL;
+
+    if (!s_rtc.have_ap ||
+        strncmp(s_rtc.ssid, (const char *)wifi_config->sta.ssid, sizeof(s_rtc.ssid)) != 0) {
+        ESP_LOGI(TAG, "No cached AP -> scan + DHCP");
+        return false;
+    }
+
+    /* known AP: no channel sweep */
+    wifi_config->sta.channel = s_rtc.channel;
+    wifi_config->sta.bssid_set = true;
+    memcpy(wifi_config->sta.bssid, s_rtc.bssid, sizeof(s_rtc.bssid));
+    wifi_config->sta.scan_method = WIFI_FAST_SCAN;
+
+    esp_netif_ip_info_t ip = { 0 };
+    uint32_t dns = 0;
+
+    if (lease_valid()) {
+        ip.ip.addr = s_rtc.ip;
+        ip.netmask.addr = s_rtc.netmask;
+        ip.gw.addr = s_rtc.gw;
+        dns = s_rtc.dns;
+    } else if (s_have_static) {
+        ip = s_static_ip;
+        dns = s_static_dns;
+    }
+
+    if (ip.ip.addr) {
+        /* no DHCP: GOT_IP is posted as soon as the link is up */
+        esp_netif_dhcpc_stop(netif);
+        s_dhcp_stopped = true;
+        ESP_ERROR_CHECK(esp_netif_set_ip_info(netif, &ip));
+        set_dns(dns);
+        s_path = WIFI_FAST_PATH_FAST;
+    } else {
+        s_path = WIFI_FAST_PATH_FAST_DHCP;
+    }
+
+    ESP_LOGI(TAG, "Fast connect: ch %u, BSSID %02x:%02x:%02x:%02x:%02x:%02x, %s",
+             s_rtc.channel,
+             s_rtc.bssid[0], s_rtc.bssid[1], s_rtc.bssid[2],
+             s_rtc.bssid[3], s_rtc.bssid[4], s_rtc.bssid[5],
+             (s_path == WIFI_FAST_PATH_FAST) ? "cached IP" : "DHCP");
+    return true;
+}
+
+void wifi_fast_on_connected(void)
+{
+    wifi_ap_record_t ap;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK) {
+        return;
+    }
+
+    cache_check();
+    memcpy(s_rtc.bssid, ap.bssid, sizeof(s_rtc.bssid));
+    s_rtc.channel = ap.primary;
+    strncpy(s_rtc.ssid, (const char *)ap.ssid, sizeof(s_rtc.ssid) - 1);
+    s_rtc.ssid[sizeof(s_rtc.ssid) - 1] = '\0';
+    s_rtc.have_ap = true;
+}
+
+bool wifi_fast_on_disconnected(void)
+{
+    if (s_got_ip || s_path == WIFI_FAST_PATH_FULL || s_path == WIFI_FAST_PATH_FALLBACK) {
+        return false;
+    }
+
+    ESP_LOGW(TAG, "Fast connect failed -> scan + DHCP");
+    s_rtc.stats.fast_fail++;
+    s_rtc.have_ap = false;
+    s_rtc.have_lease = false;
+    s_path = WIFI_FAST_PATH_FALLBACK;
+
+    /* back to the normal configuration: any BSSID, all channels */
+    wifi_config_t cfg;
+    if (esp_wifi_get_config(WIFI_IF_STA, &cfg) == ESP_OK) {
+        cfg.sta.channel = 0;
+        cfg.sta.bssid_set = false;
+        esp_wifi_set_config(WIFI_IF_STA, &cfg);
+    }
+
+    if (s_dhcp_stopped && s_netif) {
+        esp_netif_ip_info_t none = { 0 };
+        esp_netif_set_ip_info(s_netif, &none);
+        esp_netif_dhcpc_start(s_netif);
+        s_dhcp_stopped = false;
+    }
+    return true;
+}
+
+void wifi_fast_on_got_ip(const ip_event_got_ip_t *event)
+{
+    cache_check();
+    s_got_ip = true;
+
+    uint32_t ms = (uint32_t)(esp_timer_get_time() / 1000);
+    wifi_fast_stats_t *st = &s_rtc.stats;
+    st->path = s_path;
+    st->wake_to_ip_ms = ms;
+
+    if (s_path == WIFI_FAST_PATH_FAST || s_path == WIFI_FAST_PATH_FAST_DHCP) {
+        st->last_fast_ms = ms;
+        st->fast_ok++;
+    } else {
+        st->last_full_ms = ms;
+    }
+
+    ESP_LOGI(TAG, "Wake -> IP: %lu ms (%s), last fast %lu ms / full %lu ms, fast ok/fail %lu/%lu",
+             (unsigned long)ms, wifi_fast_path_name(s_path),
+             (unsigned long)st->last_fast_ms, (unsigned long)st->last_full_ms,
+             (unsigned long)st->fast_ok, (unsigned long)st->fast_fail);
+
+    if (s_dhcp_stopped) {
+        return;     /* cached/static address: nothing new to learn */
+    }
+
+    /* DHCP path: remember the lease, reuse it until T1 */
+    lease_query_t q = {
+        .netif = event->esp_netif,
+        .lease_s = WIFI_FAST_LEASE_DEFAULT_SEC,
+    };
+    if (esp_netif_tcpip_exec(lease_query_tcpip, &q) != ESP_OK) {
+        q.lease_s = WIFI_FAST_LEASE_DEFAULT_SEC;
+    }
+    uint32_t lease_s = q.lease_s;
+
+    esp_netif_dns_info_t dns = { 0 };
+    esp_netif_get_dns_info(event->esp_netif, ESP_NETIF_DNS_MAIN, &dns);
+
+    int64_t now = (int64_t)time(NULL);
+    s_rtc.ip = event->ip_info.ip.addr;
+    s_rtc.netmask = event->ip_info.netmask.addr;
+    s_rtc.gw = event->ip_info.gw.addr;
+    s_rtc.dns = dns.ip.u_addr.ip4.addr;
+    s_rtc.lease_from_s = now;
+    s_rtc.reuse_until_s = now + lease_s / 2;
+    s_rtc.have_lease = true;
+}
+
+void wifi_fast_invalidate(void)
+{
+    cache_check();
+    s_rtc.have_ap = false;
+    s_rtc.have_lease = false;
+}
+
+void wifi_fast_get_stats(wifi_fast_stats_t *out)
+{
+    cache_check();
+    *out = s_rtc.stats;
+}
+
+const char *wifi_fast_path_name(wifi_fast_path_t path)
+{
+    switch (path) {
+        case WIFI_FAST_PATH_FULL:      return "full";
+        case WIFI_FAST_PATH_FAST:      return "fast";
+        case WIFI_FAST_PATH_FAST_DHCP: return "fast+dhcp";
+        case WIFI_FAST_PATH_FALLBACK:  return "fallback";
+        default:                       return "?";
+    }
+}
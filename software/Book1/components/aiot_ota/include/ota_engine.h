@@ -0,0 +1,142 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: streaming HTTP OTA engine
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * The OTA flow of Project 19 (HTTP -> esp_ota_write -> boot partition) as a
+ * component, with the URL as a parameter instead of a #define:
+ *
+ *   ota_engine_start(&cfg);            own task, returns immediately
+ *   ...node keeps serving MQTT...
+ *   ota_engine_wait(timeout, &res);    ESP_OK -> new image is boot target
+ *
+ * or ota_engine_run(&cfg, &res) when blocking is fine (Project 19).
+ *
+ * Progress is posted as OTA_ENGINE_EVENT to the default event loop
+ * (event data = ota_progress_t), so the application decides where it goes
+ * (log, MQTT event topic, display).
+ *
+ * Timing: download_us is the time spent waiting for HTTP data, flash_us the
+ * time in esp_ota_begin (erase) / esp_ota_write / esp_ota_end (verify).
+ * Both are sums over the whole image, so "where does the time go" can be
+ * answered from one DONE event, e.g. against a local server:
+ *
+ *   python3 -m http.server 8000      (in the build/ directory)
+ *
+ * PIPELINE
+ * --------
+ * With pipeline_depth >= 2 (default) a writer task programs one buffer
+ * while the next one is downloaded, so the total time approaches
+ * max(download, flash) instead of download + flash. The flash erase is
+ * done sector by sector in the writer and overlaps as well. stall_us is the
+ * time the download waited for a free buffer: high stall = flash is the
+ * bottleneck, ~0 = network is. RAM: pipeline_depth * buf_size.
+ * pipeline_depth = 1 is the plain read/write loop of Project 19.
+ *
+ * RESUME
+ * ------
+ * After a network error (read error, connection closed early) the engine
+ * reconnects and asks only for the rest: "Range: bytes=<offset>-" plus
+ * "If-Range: <ETag>". The OTA handle stays open, writing continues at the
+ * same offset. With resume = true the offset is also kept in NVS
+ * (namespace "ota_resume", with URL, ETag, length and partition), so a
+ * reset or a later ota= command continues via esp_ota_resume() instead of
+ * starting at byte 0. If the server answers 200 (image changed, no Range
+ * support) the download simply starts over. A wrong resume cannot boot:
+ * esp_ota_end() checks the SHA-256 of the whole image in flash.
+ * rx_bytes vs. total shows how much was transferred twice.
+ * Test server with connection drops: tools/ota_server.py.
+ *
+ * COMPRESSED / DELTA
+ * ------------------
+ * If the body starts with the patch magic (ota_patch.h, built with
+ * tools/ota_pack.py), it is decoded on the fly: compressed images expand
+ * in the writer, delta images copy unchanged parts from the running
+ * partition. Only the download shrinks, flash writes stay the same.
+ * Checks: SHA-256 of the base before the first byte is written, SHA-256
+ * of the output at the end, then esp_ota_end() as usual. A patch can be
+ * resumed after a drop inside one run, not across a reset (the decoder
+ * state lives in RAM).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "esp_err.h"
+#include "esp_event.h"
+
+ESP_EVENT_DECLARE_BASE(OTA_ENGINE_EVENT);
+
+typedef enum {
+    OTA_ENGINE_EVENT_STARTED,
+    OTA_ENGINE_EVENT_PROGRESS,      /* every progress_interval_ms */
+    OTA_ENGINE_EVENT_DONE,          /* image verified, boot partition set */
+    OTA_ENGINE_EVENT_FAILED,
+} ota_engine_event_id_t;
+
+typedef enum {
+    OTA_STAGE_IDLE,
+    OTA_STAGE_CONNECT,
+    OTA_STAGE_DOWNLOAD,
+    OTA_STAGE_VERIFY,
+    OTA_STAGE_DONE,
+    OTA_STAGE_FAILED,
+} ota_stage_t;
+
+/* Event data of every OTA_ENGINE_EVENT, also the final result */
+typedef struct {
+    ota_stage_t stage;
+    esp_err_t   err;                /* ESP_OK unless FAILED */
+    uint32_t    bytes;              /* body bytes written (the download offset) */
+    uint32_t    total;              /* Content-Length, 0 = unknown */
+    uint32_t    image_bytes;        /* written to flash, > bytes for a patch */
+    uint32_t    kbps;               /* average so far, kB/s */
+    uint32_t    elapsed_ms;
+    uint32_t    download_us;
+    uint32_t    flash_us;
+    uint32_t    stall_us;           /* download blocked on a full pipeline */
+    uint32_t    rx_bytes;           /* body bytes received, incl. re-sent ones */
+    uint32_t    resumed_from;       /* offset taken from NVS, 0 = fresh start */
+    uint32_t    retries;            /* reconnects in this run */
+} ota_progress_t;
+
+typedef struct {
+    const char *url;                /* copied, may be freed after start */
+    uint32_t    timeout_ms;         /* HTTP, 0 -> 10000 */
+    uint32_t    buf_size;           /* per buffer, 0 -> 8192 */
+    uint32_t    pipeline_depth;     /* buffers in flight, 0 -> 2, 1 = sequential, max 8 */
+    uint32_t    progress_interval_ms; /* 0 -> 1000 */
+    bool        reboot;             /* esp_restart() after DONE */
+    bool        resume;             /* keep progress in NVS (nvs_flash_init() first) */
+    uint32_t    max_retries;        /* reconnects without progress, 0 -> 5 */
+    UBaseType_t task_prio;          /* ota_engine_start() only, 0 -> 5 */
+} ota_engine_config_t;
+
+/* ESP_ERR_INVALID_STATE if an update is already running */
+esp_err_t ota_engine_start(const ota_engine_config_t *cfg);
+
+/* ESP_ERR_TIMEOUT while running, otherwise the result of the update */
+esp_err_t ota_engine_wait(TickType_t timeout, ota_progress_t *result);
+
+/* Same flow in the calling task */
+esp_err_t ota_engine_run(const ota_engine_config_t *cfg, ota_progress_t *result);
+
+bool ota_engine_busy(void);
+
+const char *ota_engine_stage_name(ota_stage_t stage);
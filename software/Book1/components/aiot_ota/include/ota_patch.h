@@ -0,0 +1,128 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: streaming decoder for compressed / delta OTA images
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY A PATCH FORMAT?
+ * -------------------
+ * Between two releases most of a firmware image stays the same, and the
+ * rest still contains runs of zeros, strings and repeated code. Sending
+ * the raw .bin transfers all of it again. A patch describes the new image
+ * with three operations:
+ *
+ *   LIT  n <bytes>      n new bytes, sent as they are
+ *   NEW  n dist         copy n bytes from dist bytes back in the NEW image
+ *                       (compression, last OTA_PATCH_WINDOW bytes)
+ *   OLD  n off          copy n bytes from the OLD (running) image
+ *                       (delta, off relative to the end of the last OLD)
+ *
+ * Without a base image the result is a plain LZ77 compressed image; with a
+ * base it is a delta that only carries what changed. tools/ota_pack.py
+ * builds both and is the host twin of this decoder.
+ *
+ * File layout (version 1, little endian):
+ *
+ *   0   "AIPK"               magic (a raw ESP image starts with 0xE9)
+ *   4   u8  version
+ *   5   u8  flags            bit 0: delta (needs the base image)
+ *   6   u16 reserved
+ *   8   u32 new_size
+ *   12  u32 old_size         bytes of the base image that are referenced
+ *   16  u8  old_sha256[32]   of those old_size bytes
+ *   48  u8  new_sha256[32]   of the whole output
+ *   80  ops... END
+ *
+ * Op byte: [op:2][n:6], n < 63 -> length n + 1, n == 63 -> 64 + varint.
+ * Arguments are LEB128 varints, OLD offsets zigzag coded.
+ *
+ * The decoder is fed with arbitrary chunks (whatever HTTP delivers) and
+ * keeps only OTA_PATCH_WINDOW + OTA_PATCH_OUT_BUF bytes of state. The old
+ * image is read through a callback (esp_partition_read on the device), the
+ * output goes through a callback (esp_ota_write). Plain C, no IDF calls.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define OTA_PATCH_VERSION       1
+#define OTA_PATCH_HDR_SIZE      80
+#define OTA_PATCH_WINDOW        16384       /* max NEW distance, power of 2 */
+#define OTA_PATCH_OUT_BUF       1024        /* output is written in these steps */
+
+#define OTA_PATCH_FLAG_DELTA    0x01
+
+typedef struct {
+    uint8_t  version;
+    uint8_t  flags;
+    uint32_t new_size;
+    uint32_t old_size;
+    uint8_t  old_sha256[32];
+    uint8_t  new_sha256[32];
+} ota_patch_hdr_t;
+
+typedef struct {
+    /* delta only: is the running image the one the patch was made for? */
+    bool (*base_ok)(void *ctx, const ota_patch_hdr_t *hdr);
+    bool (*read_old)(void *ctx, uint32_t off, uint8_t *buf, size_t len);
+    bool (*write)(void *ctx, const uint8_t *buf, size_t len);
+    void *ctx;
+} ota_patch_io_t;
+
+typedef enum {
+    OTA_PATCH_MORE = 0,         /* all input consumed, send more */
+    OTA_PATCH_DONE,             /* END reached, output complete and flushed */
+    OTA_PATCH_ERR_FORMAT,       /* bad magic/version/op, data after END */
+    OTA_PATCH_ERR_BASE,         /* base_ok() said no */
+    OTA_PATCH_ERR_RANGE,        /* copy outside the window / old image / new_size */
+    OTA_PATCH_ERR_IO,           /* read_old() or write() failed */
+} ota_patch_result_t;
+
+/* ~17.5 kB: allocate it, do not put it on a task stack */
+typedef struct {
+    ota_patch_io_t  io;
+    ota_patch_hdr_t hdr;
+    ota_patch_result_t result;  /* sticky once != MORE */
+
+    uint8_t  hdr_buf[OTA_PATCH_HDR_SIZE];
+    uint32_t hdr_len;
+
+    int      state;
+    uint8_t  op;
+    uint32_t len;               /* bytes left in the current op */
+    uint32_t varint;
+    uint32_t shift;
+
+    uint32_t out_pos;           /* bytes produced so far */
+    uint32_t old_pos;           /* end of the last OLD copy */
+    uint32_t out_len;
+    uint8_t  out[OTA_PATCH_OUT_BUF];
+    uint8_t  window[OTA_PATCH_WINDOW];
+} ota_patch_t;
+
+/* True if buf starts like a patch (use on the first bytes of a download) */
+bool ota_patch_detect(const uint8_t *buf, size_t len);
+
+void ota_patch_init(ota_patch_t *p, const ota_patch_io_t *io);
+
+/* Consume len bytes; returns MORE, DONE or an error (then stays there) */
+ota_patch_result_t ota_patch_feed(ota_patch_t *p, const uint8_t *data, size_t len);
+
+/* Header, valid once the first OTA_PATCH_HDR_SIZE bytes were fed */
+const ota_patch_hdr_t *ota_patch_header(const ota_patch_t *p);
+
+const char *ota_patch_result_name(ota_patch_result_t r);
@@ -0,0 +1,998 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: streaming HTTP OTA engine
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_http_client.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "nvs.h"
+#include "mbedtls/sha256.h"
+
+#include "ota_engine.h"
+#include "ota_patch.h"
+
+static const char *TAG = "OTA";
+
+ESP_EVENT_DEFINE_BASE(OTA_ENGINE_EVENT);
+
+#define OTA_TIMEOUT_DEFAULT_MS      10000
+#define OTA_BUF_SIZE_DEFAULT        8192
+#define OTA_DEPTH_DEFAULT           2
+#define OTA_DEPTH_MAX               8
+#define OTA_HTTP_RX_BUF             4096
+#define OTA_WRITER_STACK            4096
+#define OTA_PROGRESS_DEFAULT_MS     1000
+#define OTA_TASK_PRIO_DEFAULT       5
+#define OTA_TASK_STACK              6144
+#define OTA_URL_MAX                 256
+#define OTA_ETAG_MAX                64
+#define OTA_RETRIES_DEFAULT         5
+#define OTA_RETRY_DELAY_MS          1000        /* x consecutive failures */
+
+/* resume record: saved every OTA_RESUME_SAVE_BYTES, sector aligned */
+#define OTA_SECTOR_SIZE             4096
+#define OTA_RESUME_SAVE_BYTES       (64 * 1024)
+#define OTA_NVS_NAMESPACE           "ota_resume"
+#define OTA_NVS_KEY                 "state"
+#define OTA_RESUME_VERSION          1
+
+#define OTA_DONE_BIT                BIT0
+
+static ota_engine_config_t s_cfg;
+static char                s_url[OTA_URL_MAX];
+static ota_progress_t      s_result;
+static bool                s_busy = false;
+static portMUX_TYPE        s_lock = portMUX_INITIALIZER_UNLOCKED;
+static EventGroupHandle_t  s_events = NULL;
+
+const char *ota_engine_stage_name(ota_stage_t stage)
+{
+    switch (stage) {
+        case OTA_STAGE_IDLE:     return "idle";
+        case OTA_STAGE_CONNECT:  return "connect";
+        case OTA_STAGE_DOWNLOAD: return "download";
+        case OTA_STAGE_VERIFY:   return "verify";
+        case OTA_STAGE_DONE:     return "done";
+        case OTA_STAGE_FAILED:   return "failed";
+        default:                 return "?";
+    }
+}
+
+/* ---- progress ---- */
+
+typedef struct ota_delta ota_delta_t;
+
+typedef struct {
+    ota_progress_t   p;                 /* p.bytes = body offset written so far */
+    int64_t          start_us;
+    int64_t          last_post_us;
+    const esp_partition_t *part;
+    esp_ota_handle_t ota;               /* stays open across reconnects */
+    bool             ota_open;
+    bool             net_fail;          /* last error is worth a reconnect */
+    uint32_t         saved;             /* offset in the NVS record */
+    char             etag[OTA_ETAG_MAX];
+    ota_delta_t     *patch;             /* compressed/delta body, NULL = raw */
+    uint32_t         sink_off;          /* body bytes given to ota_sink() */
+} ota_run_t;
+
+static void ota_post(ota_run_t *run, ota_engine_event_id_t id)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t ms = (uint32_t)((now - run->start_us) / 1000);
+
+    run->p.elapsed_ms = ms;
+    run->p.kbps = ms ? (uint32_t)((uint64_t)run->p.rx_bytes / ms) : 0;    /* B/ms == kB/s */
+    run->last_post_us = now;
+
+    /* no default loop (or it is full): progress is optional, the update is not */
+    esp_event_post(OTA_ENGINE_EVENT, id, &run->p, sizeof(run->p), pdMS_TO_TICKS(10));
+}
+
+static esp_err_t ota_fail(ota_run_t *run, esp_err_t err, const char *what)
+{
+    ESP_LOGE(TAG, "%s failed in stage %s: %s", what,
+             ota_engine_stage_name(run->p.stage), esp_err_to_name(err));
+    run->p.stage = OTA_STAGE_FAILED;
+    run->p.err = err;
+    ota_post(run, OTA_ENGINE_EVENT_FAILED);
+    return err;
+}
+
+/* ---- resume state (NVS) ---- */
+
+typedef struct {
+    uint32_t version;
+    uint32_t part_addr;             /* partition the bytes were written to */
+    uint32_t total;                 /* image identity: length + ETag + URL */
+    uint32_t offset;                /* bytes in flash, sector aligned */
+    char     etag[OTA_ETAG_MAX];
+    char     url[OTA_URL_MAX];
+} ota_resume_rec_t;
+
+static void ota_resume_clear(ota_run_t *run)
+{
+    nvs_handle_t nvs;
+
+    run->saved = 0;
+    if (nvs_open(OTA_NVS_NAMESPACE, NVS_READWRITE, &nvs) == ESP_OK) {
+        nvs_erase_key(nvs, OTA_NVS_KEY);
+        nvs_commit(nvs);
+        nvs_close(nvs);
+    }
+}
+
+static void ota_resume_save(const ota_engine_config_t *cfg, ota_run_t *run, uint32_t offset)
+{
+    ota_resume_rec_t rec = {
+        .version = OTA_RESUME_VERSION,
+        .part_addr = run->part->address,
+        .total = run->p.total,
+        .offset = offset,
+    };
+    nvs_handle_t nvs;
+
+    strlcpy(rec.etag, run->etag, sizeof(rec.etag));
+    strlcpy(rec.url, cfg->url, sizeof(rec.url));
+
+    if (nvs_open(OTA_NVS_NAMESPACE, NVS_READWRITE, &nvs) != ESP_OK) {
+        return;                     /* no NVS: resume inside this run only */
+    }
+    if (nvs_set_blob(nvs, OTA_NVS_KEY, &rec, sizeof(rec)) == ESP_OK &&
+        nvs_commit(nvs) == ESP_OK) {
+        run->saved = offset;
+    }
+    nvs_close(nvs);
+}
+
+/* Continue where a previous run (or boot) stopped, if it was the same image */
+static void ota_resume_load(const ota_engine_config_t *cfg, ota_run_t *run)
+{
+    ota_resume_rec_t rec;
+    size_t len = sizeof(rec);
+    nvs_handle_t nvs;
+
+    if (nvs_open(OTA_NVS_NAMESPACE, NVS_READONLY, &nvs) != ESP_OK) {
+        return;
+    }
+    esp_err_t err = nvs_get_blob(nvs, OTA_NVS_KEY, &rec, &len);
+    nvs_close(nvs);
+    if (err != ESP_OK) {
+        return;
+    }
+
+    if (len != sizeof(rec) || rec.version != OTA_RESUME_VERSION ||
+        rec.part_addr != run->part->address || strcmp(rec.url, cfg->url) != 0 ||
+        rec.offset == 0 || rec.offset >= rec.total) {
+        ESP_LOGI(TAG, "Discarding resume record (other image or partition)");
+        ota_resume_clear(run);
+        return;
+    }
+
+    rec.etag[sizeof(rec.etag) - 1] = '\0';
+    run->p.bytes = rec.offset;
+    run->p.total = rec.total;
+    run->p.resumed_from = rec.offset;
+    run->p.image_bytes = rec.offset;
+    run->sink_off = rec.offset;
+    run->saved = rec.offset;
+    strlcpy(run->etag, rec.etag, sizeof(run->etag));
+    ESP_LOGI(TAG, "Resume record: %lu of %lu bytes, ETag %s", (unsigned long)rec.offset,
+             (unsigned long)rec.total, rec.etag[0] ? rec.etag : "-");
+}
+
+/*
+ * Called with the number of bytes that are really in flash. Saves at most
+ * every OTA_RESUME_SAVE_BYTES (NVS wear), force after a failed session.
+ * Only whole sectors count: esp_ota_resume() erases the sector at the
+ * offset again before writing, a partial sector could not be rewritten.
+ */
+static void ota_checkpoint(const ota_engine_config_t *cfg, ota_run_t *run,
+                           uint32_t written, bool force)
+{
+    uint32_t offset = written & ~(uint32_t)(OTA_SECTOR_SIZE - 1);
+
+    if (!cfg->resume || !run->p.total || run->patch || offset <= run->saved) {
+        return;                     /* chunked or patch bodies: only inside this run */
+    }
+    if (force || offset - run->saved >= OTA_RESUME_SAVE_BYTES) {
+        ota_resume_save(cfg, run, offset);
+    }
+}
+
+/* ---- compressed / delta images (ota_patch.h) ---- */
+
+struct ota_delta {
+    ota_patch_t            dec;
+    esp_ota_handle_t       ota;
+    const esp_partition_t *base;    /* running image = OLD of a delta */
+    mbedtls_sha256_context sha;     /* of the output, against new_sha256 */
+    uint32_t              *image_bytes;
+    esp_err_t              err;     /* of the last esp_ota_write */
+    uint8_t                buf[512];
+};
+
+static bool ota_delta_base_ok(void *ctx, const ota_patch_hdr_t *hdr)
+{
+    ota_delta_t *d = ctx;
+    mbedtls_sha256_context sha;
+    uint8_t digest[32];
+    bool ok = d->base && hdr->old_size <= d->base->size;
+
+    mbedtls_sha256_init(&sha);
+    mbedtls_sha256_starts(&sha, 0);
+    for (uint32_t off = 0; ok && off < hdr->old_size; off += sizeof(d->buf)) {
+        uint32_t n = hdr->old_size - off;
+        if (n > sizeof(d->buf)) {
+            n = sizeof(d->buf);
+        }
+        ok = esp_partition_read(d->base, off, d->buf, n) == ESP_OK;
+        mbedtls_sha256_update(&sha, d->buf, n);
+    }
+    mbedtls_sha256_finish(&sha, digest);
+    mbedtls_sha256_free(&sha);
+
+    if (ok && memcmp(digest, hdr->old_sha256, sizeof(digest)) != 0) {
+        ESP_LOGE(TAG, "Delta was made for another base image than %s", d->base->label);
+        ok = false;
+    }
+    return ok;
+}
+
+static bool ota_delta_read_old(void *ctx, uint32_t off, uint8_t *buf, size_t len)
+{
+    ota_delta_t *d = ctx;
+    return esp_partition_read(d->base, off, buf, len) == ESP_OK;
+}
+
+static bool ota_delta_write(void *ctx, const uint8_t *buf, size_t len)
+{
+    ota_delta_t *d = ctx;
+
+    mbedtls_sha256_update(&d->sha, buf, len);
+    d->err = esp_ota_write(d->ota, buf, len);
+    if (d->err == ESP_OK) {
+        *d->image_bytes += len;
+    }
+    return d->err == ESP_OK;
+}
+
+static esp_err_t ota_delta_open(ota_run_t *run, esp_ota_handle_t ota)
+{
+    ota_delta_t *d = malloc(sizeof(*d));
+    if (!d) {
+        return ESP_ERR_NO_MEM;
+    }
+    ota_patch_io_t io = {
+        .base_ok = ota_delta_base_ok,
+        .read_old = ota_delta_read_old,
+        .write = ota_delta_write,
+        .ctx = d,
+    };
+
+    d->ota = ota;
+    d->base = esp_ota_get_running_partition();
+    d->image_bytes = &run->p.image_bytes;
+    d->err = ESP_OK;
+    mbedtls_sha256_init(&d->sha);
+    mbedtls_sha256_starts(&d->sha, 0);
+    ota_patch_init(&d->dec, &io);
+
+    run->patch = d;
+    ESP_LOGI(TAG, "Patch image (compressed/delta), decoding while writing");
+    return ESP_OK;
+}
+
+static void ota_delta_free(ota_run_t *run)
+{
+    if (run->patch) {
+        mbedtls_sha256_free(&run->patch->sha);
+        free(run->patch);
+        run->patch = NULL;
+    }
+}
+
+static esp_err_t ota_delta_feed(ota_delta_t *d, const uint8_t *buf, uint32_t len)
+{
+    ota_patch_result_t rc = ota_patch_feed(&d->dec, buf, len);
+
+    switch (rc) {
+        case OTA_PATCH_MORE:
+        case OTA_PATCH_DONE:
+            return ESP_OK;
+        case OTA_PATCH_ERR_BASE:
+            return ESP_ERR_INVALID_VERSION;
+        case OTA_PATCH_ERR_IO:
+            return d->err != ESP_OK ? d->err : ESP_FAIL;
+        default:
+            ESP_LOGE(TAG, "Patch decode error: %s", ota_patch_result_name(rc));
+            return ESP_ERR_INVALID_RESPONSE;
+    }
+}
+
+/* After the last byte: END seen and the output is what the patch promised */
+static esp_err_t ota_delta_finish(ota_delta_t *d)
+{
+    uint8_t digest[32];
+
+    if (d->dec.result != OTA_PATCH_DONE) {
+        ESP_LOGE(TAG, "Patch ended early (%lu bytes decoded)", (unsigned long)d->dec.out_pos);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    mbedtls_sha256_finish(&d->sha, digest);
+    if (memcmp(digest, ota_patch_header(&d->dec)->new_sha256, sizeof(digest)) != 0) {
+        ESP_LOGE(TAG, "Patch output does not match its SHA-256");
+        return ESP_ERR_INVALID_CRC;
+    }
+    return ESP_OK;
+}
+
+/*
+ * Every body byte goes through here, in order (seq loop or writer task).
+ * The first bytes decide: "AIPK" -> patch decoder, anything else is a raw
+ * image for esp_ota_write() (which checks the 0xE9 image magic itself).
+ */
+static esp_err_t ota_sink(ota_run_t *run, esp_ota_handle_t ota, const uint8_t *buf, uint32_t len)
+{
+    esp_err_t err = ESP_OK;
+
+    if (run->sink_off == 0 && ota_patch_detect(buf, len)) {
+        err = ota_delta_open(run, ota);
+    }
+    run->sink_off += len;
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (run->patch) {
+        return ota_delta_feed(run->patch, buf, len);
+    }
+
+    err = esp_ota_write(ota, buf, len);
+    if (err == ESP_OK) {
+        run->p.image_bytes += len;
+    }
+    return err;
+}
+
+/* ---- HTTP -> flash ---- */
+
+/* Sequential: read one buffer, write it, read the next (depth 1) */
+static esp_err_t ota_stream_seq(ota_run_t *run, const ota_engine_config_t *cfg,
+                            esp_http_client_handle_t client, esp_ota_handle_t ota)
+{
+    uint8_t *buf = malloc(cfg->buf_size);
+    if (!buf) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t err = ESP_OK;
+    uint64_t interval_us = (uint64_t)cfg->progress_interval_ms * 1000;
+
+    run->p.stage = OTA_STAGE_DOWNLOAD;
+    ota_post(run, OTA_ENGINE_EVENT_PROGRESS);
+
+    while (1) {
+        int64_t t0 = esp_timer_get_time();
+        int n = esp_http_client_read(client, (char *)buf, cfg->buf_size);
+        int64_t t1 = esp_timer_get_time();
+        run->p.download_us += (uint32_t)(t1 - t0);
+
+        if (n < 0) {
+            run->net_fail = true;
+            err = ESP_ERR_INVALID_RESPONSE;
+            break;
+        }
+        if (n == 0) {
+            if (!esp_http_client_is_complete_data_received(client)) {
+                run->net_fail = true;
+                err = ESP_ERR_INVALID_SIZE;     /* connection closed early */
+            }
+            break;
+        }
+        run->p.rx_bytes += n;
+
+        err = ota_sink(run, ota, buf, n);
+        run->p.flash_us += (uint32_t)(esp_timer_get_time() - t1);
+        if (err != ESP_OK) {
+            break;
+        }
+        run->p.bytes += n;
+        ota_checkpoint(cfg, run, run->p.bytes, false);
+
+        if ((uint64_t)(esp_timer_get_time() - run->last_post_us) >= interval_us) {
+            ota_post(run, OTA_ENGINE_EVENT_PROGRESS);
+        }
+    }
+
+    free(buf);
+    return err;
+}
+
+/*
+ * Pipelined (depth >= 2):
+ *
+ *   download (this task)            writer task
+ *   free_q -> fill buffer -> full_q -> erase + program -> free_q
+ *
+ * While one buffer is programmed, the next one is downloaded. When all
+ * buffers are waiting for flash, the download blocks on free_q
+ * (back-pressure, counted as stall_us), so RAM use is depth * buf_size.
+ */
+typedef struct {
+    uint8_t *buf;
+    uint32_t len;                   /* buf == NULL: end of stream */
+} ota_chunk_t;
+
+typedef struct {
+    ota_run_t        *run;              /* sink state, used by the writer only */
+    esp_ota_handle_t  ota;
+    QueueHandle_t     free_q;
+    QueueHandle_t     full_q;
+    SemaphoreHandle_t done;
+    volatile esp_err_t err;         /* first write error, set by the writer */
+    volatile uint32_t flash_us;
+    volatile uint32_t written;      /* image offset programmed so far */
+} ota_pipe_t;
+
+static void ota_writer_task(void *arg)
+{
+    ota_pipe_t *pipe = arg;
+    ota_chunk_t c;
+
+    while (xQueueReceive(pipe->full_q, &c, portMAX_DELAY) == pdTRUE && c.buf) {
+        /* after an error keep draining, so the download never blocks forever */
+        if (pipe->err == ESP_OK) {
+            int64_t t0 = esp_timer_get_time();
+            esp_err_t err = ota_sink(pipe->run, pipe->ota, c.buf, c.len);
+            pipe->flash_us += (uint32_t)(esp_timer_get_time() - t0);
+            if (err != ESP_OK) {
+                pipe->err = err;
+            } else {
+                pipe->written += c.len;
+            }
+        }
+        xQueueSend(pipe->free_q, &c.buf, portMAX_DELAY);
+    }
+
+    xSemaphoreGive(pipe->done);
+    vTaskDelete(NULL);
+}
+
+/* Fill one buffer completely (or up to the end of the body) */
+static esp_err_t ota_fill(ota_run_t *run, esp_http_client_handle_t client,
+                          uint8_t *buf, uint32_t size, uint32_t *len, bool *eof)
+{
+    *len = 0;
+    while (*len < size) {
+        int64_t t0 = esp_timer_get_time();
+        int n = esp_http_client_read(client, (char *)buf + *len, size - *len);
+        run->p.download_us += (uint32_t)(esp_timer_get_time() - t0);
+
+        if (n < 0) {
+            run->net_fail = true;
+            return ESP_ERR_INVALID_RESPONSE;
+        }
+        if (n == 0) {
+            *eof = true;
+            if (esp_http_client_is_complete_data_received(client)) {
+                return ESP_OK;
+            }
+            run->net_fail = true;
+            return ESP_ERR_INVALID_SIZE;
+        }
+        *len += n;
+        run->p.rx_bytes += n;
+    }
+    return ESP_OK;
+}
+
+static esp_err_t ota_stream_pipelined(ota_run_t *run, const ota_engine_config_t *cfg,
+                                      esp_http_client_handle_t client, esp_ota_handle_t ota)
+{
+    uint8_t *bufs[OTA_DEPTH_MAX] = { 0 };
+    uint32_t depth = cfg->pipeline_depth;
+    ota_pipe_t pipe = { .run = run, .ota = ota, .err = ESP_OK, .written = run->p.bytes };
+    esp_err_t err = ESP_OK;
+
+    pipe.free_q = xQueueCreate(depth, sizeof(uint8_t *));
+    pipe.full_q = xQueueCreate(depth + 1, sizeof(ota_chunk_t));     /* + end marker */
+    pipe.done = xSemaphoreCreateBinary();
+    for (uint32_t i = 0; i < depth; i++) {
+        bufs[i] = malloc(cfg->buf_size);
+        if (!bufs[i]) {
+            err = ESP_ERR_NO_MEM;
+            break;
+        }
+    }
+    if (err != ESP_OK || !pipe.free_q || !pipe.full_q || !pipe.done ||
+        xTaskCreate(ota_writer_task, "ota_wr", OTA_WRITER_STACK, &pipe,
+                    cfg->task_prio, NULL) != pdPASS) {
+        for (uint32_t i = 0; i < depth; i++) {
+            free(bufs[i]);
+        }
+        if (pipe.free_q) vQueueDelete(pipe.free_q);
+        if (pipe.full_q) vQueueDelete(pipe.full_q);
+        if (pipe.done)   vSemaphoreDelete(pipe.done);
+        return ESP_ERR_NO_MEM;
+    }
+    for (uint32_t i = 0; i < depth; i++) {
+        xQueueSend(pipe.free_q, &bufs[i], 0);
+    }
+
+    uint64_t interval_us = (uint64_t)cfg->progress_interval_ms * 1000;
+    uint32_t flash_base_us = run->p.flash_us;       /* esp_ota_begin */
+    bool eof = false;
+
+    run->p.stage = OTA_STAGE_DOWNLOAD;
+    ota_post(run, OTA_ENGINE_EVENT_PROGRESS);
+
+    while (!eof && err == ESP_OK && pipe.err == ESP_OK) {
+        ota_chunk_t c;
+
+        /* back-pressure: wait until the writer returns a buffer */
+        int64_t t0 = esp_timer_get_time();
+        xQueueReceive(pipe.free_q, &c.buf, portMAX_DELAY);
+        run->p.stall_us += (uint32_t)(esp_timer_get_time() - t0);
+
+        /* a partial buffer before a drop is still written (less to resend) */
+        err = ota_fill(run, client, c.buf, cfg->buf_size, &c.len, &eof);
+        if (c.len) {
+            xQueueSend(pipe.full_q, &c, portMAX_DELAY);
+            run->p.bytes += c.len;
+        }
+        if (err != ESP_OK) {
+            break;
+        }
+        ota_checkpoint(cfg, run, pipe.written, false);
+
+        if ((uint64_t)(esp_timer_get_time() - run->last_post_us) >= interval_us) {
+            run->p.flash_us = flash_base_us + pipe.flash_us;
+            ota_post(run, OTA_ENGINE_EVENT_PROGRESS);
+        }
+    }
+
+    /* end marker, then wait until the writer has programmed everything */
+    ota_chunk_t end = { .buf = NULL, .len = 0 };
+    xQueueSend(pipe.full_q, &end, portMAX_DELAY);
+    xSemaphoreTake(pipe.done, portMAX_DELAY);
+
+    run->p.flash_us = flash_base_us + pipe.flash_us;
+    if (pipe.err != ESP_OK) {
+        err = pipe.err;             /* a flash error wins over a network error */
+        run->net_fail = false;
+    }
+
+    for (uint32_t i = 0; i < depth; i++) {
+        free(bufs[i]);
+    }
+    vQueueDelete(pipe.free_q);
+    vQueueDelete(pipe.full_q);
+    vSemaphoreDelete(pipe.done);
+    return err;
+}
+
+/* ---- one HTTP request ---- */
+
+/* Response headers needed for resuming, collected by the client callback */
+typedef struct {
+    int      status;
+    int64_t  len;                   /* Content-Length of this response */
+    uint32_t range_start;           /* Content-Range: bytes <start>-<end>/<total> */
+    uint32_t range_total;
+    char     etag[OTA_ETAG_MAX];
+} ota_hdr_t;
+
+static bool ota_parse_content_range(const char *v, uint32_t *start, uint32_t *total)
+{
+    unsigned long s, e, t;
+
+    if (sscanf(v, "bytes %lu-%lu/%lu", &s, &e, &t) != 3 || s > e || e >= t) {
+        return false;
+    }
+    *start = (uint32_t)s;
+    *total = (uint32_t)t;
+    return true;
+}
+
+static esp_err_t ota_http_event(esp_http_client_event_t *evt)
+{
+    ota_hdr_t *hdr = evt->user_data;
+
+    if (evt->event_id != HTTP_EVENT_ON_HEADER || !hdr) {
+        return ESP_OK;
+    }
+    if (strcasecmp(evt->header_key, "ETag") == 0) {
+        strlcpy(hdr->etag, evt->header_value, sizeof(hdr->etag));
+    } else if (strcasecmp(evt->header_key, "Content-Range") == 0) {
+        ota_parse_content_range(evt->header_value, &hdr->range_start, &hdr->range_total);
+    }
+    return ESP_OK;
+}
+
+/* GET the image, from run->p.bytes on if something is already in flash */
+static esp_err_t ota_request(const ota_engine_config_t *cfg, ota_run_t *run, ota_hdr_t *hdr,
+                             esp_http_client_handle_t *out)
+{
+    esp_http_client_config_t http_cfg = {
+        .url = cfg->url,
+        .timeout_ms = cfg->timeout_ms,
+        .buffer_size = OTA_HTTP_RX_BUF,
+        .event_handler = ota_http_event,
+        .user_data = hdr,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&http_cfg);
+    if (!client) {
+        return ESP_ERR_NO_MEM;
+    }
+    *out = client;
+
+    if (run->p.bytes) {
+        char range[32];
+        snprintf(range, sizeof(range), "bytes=%lu-", (unsigned long)run->p.bytes);
+        esp_http_client_set_header(client, "Range", range);
+        if (run->etag[0]) {
+            /* image changed on the server -> it answers 200 with the new one */
+            esp_http_client_set_header(client, "If-Range", run->etag);
+        }
+    }
+
+    esp_err_t err = esp_http_client_open(client, 0);
+    if (err == ESP_OK) {
+        /* fetch headers BEFORE reading the status code (see Project 19) */
+        hdr->len = esp_http_client_fetch_headers(client);
+        hdr->status = esp_http_client_get_status_code(client);
+        ESP_LOGI(TAG, "HTTP status=%d, content_length=%lld, from=%lu", hdr->status,
+                 (long long)hdr->len, (unsigned long)run->p.bytes);
+        if (hdr->len < 0) {
+            err = ESP_ERR_INVALID_RESPONSE;
+        }
+    }
+    run->net_fail = (err != ESP_OK);
+    return err;
+}
+
+/* Start the image from byte 0 (first request, or the resume was refused) */
+static void ota_restart_image(const ota_engine_config_t *cfg, ota_run_t *run)
+{
+    if (run->ota_open) {
+        esp_ota_abort(run->ota);
+        run->ota_open = false;
+    }
+    if (cfg->resume && run->saved) {
+        ota_resume_clear(run);
+    }
+    ota_delta_free(run);
+    run->sink_off = 0;
+    run->p.bytes = 0;
+    run->p.total = 0;
+    run->p.image_bytes = 0;
+    run->p.resumed_from = 0;
+    run->etag[0] = '\0';
+}
+
+/* Match the answer to what is in flash and open the OTA handle for it */
+static esp_err_t ota_accept(const ota_engine_config_t *cfg, ota_run_t *run, const ota_hdr_t *hdr)
+{
+    esp_err_t err;
+    int64_t t0;
+
+    if (hdr->status == 206 && run->p.bytes &&
+        hdr->range_start == run->p.bytes && hdr->range_total == run->p.total) {
+        if (run->ota_open) {
+            return ESP_OK;          /* reconnect inside this run */
+        }
+        ESP_LOGI(TAG, "Resuming at %lu of %lu bytes", (unsigned long)run->p.bytes,
+                 (unsigned long)run->p.total);
+        t0 = esp_timer_get_time();
+        err = esp_ota_resume(run->part, OTA_WITH_SEQUENTIAL_WRITES, run->p.bytes, &run->ota);
+        run->p.flash_us += (uint32_t)(esp_timer_get_time() - t0);
+        run->ota_open = (err == ESP_OK);
+        return err;
+    }
+
+    if (hdr->status != 200) {
+        if (hdr->status == 416 && run->p.bytes) {
+            ota_restart_image(cfg, run);    /* range refused: next try from 0 */
+            run->net_fail = true;
+        }
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+
+    if (run->p.bytes) {
+        ESP_LOGW(TAG, "Server sent the whole image, starting again at 0");
+    }
+    ota_restart_image(cfg, run);
+    if (hdr->len > (int64_t)run->part->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    run->p.total = (uint32_t)hdr->len;
+    strlcpy(run->etag, hdr->etag, sizeof(run->etag));
+
+    /*
+     * Erase sector by sector while writing: in the pipeline the erase
+     * overlaps with the download, and for a compressed/delta body the
+     * Content-Length says nothing about the image size anyway.
+     */
+    t0 = esp_timer_get_time();
+    err = esp_ota_begin(run->part, OTA_WITH_SEQUENTIAL_WRITES, &run->ota);
+    run->p.flash_us += (uint32_t)(esp_timer_get_time() - t0);
+    run->ota_open = (err == ESP_OK);
+    return err;
+}
+
+/* One connection: request, accept, stream until the end or an error */
+static esp_err_t ota_session(const ota_engine_config_t *cfg, ota_run_t *run)
+{
+    ota_hdr_t hdr = { 0 };
+    esp_http_client_handle_t client = NULL;
+
+    esp_err_t err = ota_request(cfg, run, &hdr, &client);
+    if (err == ESP_OK) {
+        err = ota_accept(cfg, run, &hdr);
+    }
+    if (err == ESP_OK) {
+        err = cfg->pipeline_depth >= 2 ? ota_stream_pipelined(run, cfg, client, run->ota)
+                                       : ota_stream_seq(run, cfg, client, run->ota);
+    }
+    if (client) {
+        esp_http_client_close(client);
+        esp_http_client_cleanup(client);
+    }
+    return err;
+}
+
+static esp_err_t ota_flow(const ota_engine_config_t *cfg, ota_run_t *run)
+{
+    run->start_us = esp_timer_get_time();
+    run->p.stage = OTA_STAGE_CONNECT;
+
+    ESP_LOGI(TAG, "Starting OTA from URL: %s", cfg->url);
+    ota_post(run, OTA_ENGINE_EVENT_STARTED);
+
+    run->part = esp_ota_get_next_update_partition(NULL);
+    if (!run->part) {
+        return ota_fail(run, ESP_ERR_NOT_FOUND, "No OTA partition (partition table?)");
+    }
+    ESP_LOGI(TAG, "Writing to partition: %s (0x%lx, size=%lu)", run->part->label,
+             (unsigned long)run->part->address, (unsigned long)run->part->size);
+
+    if (cfg->resume) {
+        ota_resume_load(cfg, run);
+    }
+
+    /*
+     * Reconnect with a Range request after network errors. The limit counts
+     * failures without a new high-water mark: a link that drops every few
+     * hundred kB still finishes, a dead server (or one that ignores Range
+     * and always drops at the same point) gives up after max_retries.
+     */
+    uint32_t failures = 0;
+    uint32_t best = run->p.bytes;
+    esp_err_t err;
+
+    while (1) {
+        err = ota_session(cfg, run);
+        if (err == ESP_OK || !run->net_fail) {
+            break;
+        }
+        if (run->ota_open) {
+            ota_checkpoint(cfg, run, run->p.bytes, true);   /* all sent bytes are in flash */
+        }
+        failures = (run->p.bytes > best) ? 1 : failures + 1;
+        if (run->p.bytes > best) {
+            best = run->p.bytes;
+        }
+        if (failures > cfg->max_retries) {
+            break;
+        }
+        run->p.retries++;
+        ESP_LOGW(TAG, "%s at %lu bytes, retry %lu in %lu ms", esp_err_to_name(err),
+                 (unsigned long)run->p.bytes, (unsigned long)run->p.retries,
+                 (unsigned long)(OTA_RETRY_DELAY_MS * failures));
+        vTaskDelay(pdMS_TO_TICKS(OTA_RETRY_DELAY_MS * failures));
+    }
+
+    if (err == ESP_OK && run->patch) {
+        err = ota_delta_finish(run->patch);
+    }
+    if (err != ESP_OK) {
+        if (run->ota_open) {
+            esp_ota_abort(run->ota);
+        }
+        if (!run->net_fail && cfg->resume) {
+            ota_resume_clear(run);      /* flash/image error: do not resume into it */
+        }
+        return ota_fail(run, err, "Download/write");
+    }
+
+    /* image check (esp_ota_end validates the app image and its SHA-256) */
+    run->p.stage = OTA_STAGE_VERIFY;
+    ota_post(run, OTA_ENGINE_EVENT_PROGRESS);
+
+    int64_t t0 = esp_timer_get_time();
+    err = esp_ota_end(run->ota);
+    run->p.flash_us += (uint32_t)(esp_timer_get_time() - t0);
+    if (err == ESP_OK) {
+        err = esp_ota_set_boot_partition(run->part);
+    }
+    if (cfg->resume) {
+        ota_resume_clear(run);
+    }
+    if (err != ESP_OK) {
+        return ota_fail(run, err, "Verify/boot partition");
+    }
+
+    run->p.stage = OTA_STAGE_DONE;
+    ota_post(run, OTA_ENGINE_EVENT_DONE);
+
+    ESP_LOGI(TAG, "OTA done: %lu bytes in %lu ms (%lu kB/s), download %lu ms, flash %lu ms, "
+             "stalled %lu ms (depth %lu x %lu B)",
+             (unsigned long)run->p.bytes, (unsigned long)run->p.elapsed_ms,
+             (unsigned long)run->p.kbps, (unsigned long)(run->p.download_us / 1000),
+             (unsigned long)(run->p.flash_us / 1000), (unsigned long)(run->p.stall_us / 1000),
+             (unsigned long)cfg->pipeline_depth, (unsigned long)cfg->buf_size);
+    ESP_LOGI(TAG, "Received %lu bytes for a %lu byte image%s (resumed at %lu, %lu retries)",
+             (unsigned long)run->p.rx_bytes, (unsigned long)run->p.image_bytes,
+             run->patch ? " (patch)" : "", (unsigned long)run->p.resumed_from,
+             (unsigned long)run->p.retries);
+    return ESP_OK;
+}
+
+/* ---- public API ---- */
+
+static bool ota_claim(const ota_engine_config_t *cfg)
+{
+    taskENTER_CRITICAL(&s_lock);
+    bool busy = s_busy;
+    s_busy = true;
+    taskEXIT_CRITICAL(&s_lock);
+    if (busy) {
+        return false;
+    }
+
+    s_cfg = *cfg;
+    strlcpy(s_url, cfg->url, sizeof(s_url));
+    s_cfg.url = s_url;
+    if (!s_cfg.timeout_ms)           s_cfg.timeout_ms = OTA_TIMEOUT_DEFAULT_MS;
+    if (!s_cfg.buf_size)             s_cfg.buf_size = OTA_BUF_SIZE_DEFAULT;
+    if (!s_cfg.progress_interval_ms) s_cfg.progress_interval_ms = OTA_PROGRESS_DEFAULT_MS;
+    if (!s_cfg.task_prio)            s_cfg.task_prio = OTA_TASK_PRIO_DEFAULT;
+    if (!s_cfg.pipeline_depth)       s_cfg.pipeline_depth = OTA_DEPTH_DEFAULT;
+    if (s_cfg.pipeline_depth > OTA_DEPTH_MAX) s_cfg.pipeline_depth = OTA_DEPTH_MAX;
+    if (!s_cfg.max_retries)          s_cfg.max_retries = OTA_RETRIES_DEFAULT;
+
+    memset(&s_result, 0, sizeof(s_result));
+    s_result.stage = OTA_STAGE_CONNECT;
+    xEventGroupClearBits(s_events, OTA_DONE_BIT);
+    return true;
+}
+
+static esp_err_t ota_finish(esp_err_t err)
+{
+    if (err == ESP_OK && s_cfg.reboot) {
+        ESP_LOGI(TAG, "Rebooting into the new image...");
+        vTaskDelay(pdMS_TO_TICKS(500));     /* let the DONE event go out */
+        esp_restart();
+    }
+
+    taskENTER_CRITICAL(&s_lock);
+    s_busy = false;
+    taskEXIT_CRITICAL(&s_lock);
+    xEventGroupSetBits(s_events, OTA_DONE_BIT);
+    return err;
+}
+
+static esp_err_t ota_check_args(const ota_engine_config_t *cfg)
+{
+    if (!cfg || !cfg->url || strlen(cfg->url) >= OTA_URL_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_events) {
+        s_events = xEventGroupCreate();
+        if (!s_events) {
+            return ESP_ERR_NO_MEM;
+        }
+        xEventGroupSetBits(s_events, OTA_DONE_BIT);     /* nothing running */
+    }
+    return ESP_OK;
+}
+
+/* run the flow, keep the last progress as result */
+static esp_err_t ota_execute(void)
+{
+    ota_run_t run = { 0 };
+    esp_err_t err = ota_flow(&s_cfg, &run);
+    ota_delta_free(&run);
+    s_result = run.p;
+    return ota_finish(err);
+}
+
+static void ota_task(void *arg)
+{
+    (void)arg;
+    ota_execute();
+    vTaskDelete(NULL);
+}
+
+esp_err_t ota_engine_start(const ota_engine_config_t *cfg)
+{
+    esp_err_t err = ota_check_args(cfg);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (!ota_claim(cfg)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    if (xTaskCreate(ota_task, "ota", OTA_TASK_STACK, NULL, s_cfg.task_prio, NULL) != pdPASS) {
+        s_result.stage = OTA_STAGE_FAILED;
+        s_result.err = ESP_ERR_NO_MEM;
+        return ota_finish(ESP_ERR_NO_MEM);
+    }
+    return ESP_OK;
+}
+
+esp_err_t ota_engine_run(const ota_engine_config_t *cfg, ota_progress_t *result)
+{
+    esp_err_t err = ota_check_args(cfg);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (!ota_claim(cfg)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    err = ota_execute();
+    if (result) {
+        *result = s_result;
+    }
+    return err;
+}
+
+esp_err_t ota_engine_wait(TickType_t timeout, ota_progress_t *result)
+{
+    if (!s_events) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!(xEventGroupWaitBits(s_events, OTA_DONE_BIT, pdFALSE, pdFALSE, timeout) & OTA_DONE_BIT)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (result) {
+        *result = s_result;
+    }
+    return s_result.err;
+}
+
+bool ota_engine_busy(void)
+{
+    taskENTER_CRITICAL(&s_lock);
+    bool busy = s_busy;
+    taskEXIT_CRITICAL(&s_lock);
+    return busy;
+}
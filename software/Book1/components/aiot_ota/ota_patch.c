@@ -0,0 +1,300 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: streaming decoder for compressed / delta OTA images
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "ota_patch.h"
+
+#define PATCH_MAGIC     "AIPK"
+
+#define OP_LIT          0
+#define OP_NEW          1
+#define OP_OLD          2
+#define OP_END          3
+
+#define LEN_EXT         63              /* n == 63: length = 64 + varint */
+
+enum {
+    ST_HEADER,
+    ST_OP,
+    ST_LEN,                             /* varint length extension */
+    ST_ARG,                             /* varint dist / offset */
+    ST_LIT,                             /* literal bytes */
+    ST_END,
+};
+
+static uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+bool ota_patch_detect(const uint8_t *buf, size_t len)
+{
+    return len >= 4 && memcmp(buf, PATCH_MAGIC, 4) == 0;
+}
+
+void ota_patch_init(ota_patch_t *p, const ota_patch_io_t *io)
+{
+    memset(p, 0, sizeof(*p));
+    p->io = *io;
+    p->state = ST_HEADER;
+    p->result = OTA_PATCH_MORE;
+}
+
+const ota_patch_hdr_t *ota_patch_header(const ota_patch_t *p)
+{
+    return p->state == ST_HEADER ? NULL : &p->hdr;
+}
+
+const char *ota_patch_result_name(ota_patch_result_t r)
+{
+    switch (r) {
+        case OTA_PATCH_MORE:       return "more";
+        case OTA_PATCH_DONE:       return "done";
+        case OTA_PATCH_ERR_FORMAT: return "format";
+        case OTA_PATCH_ERR_BASE:   return "base";
+        case OTA_PATCH_ERR_RANGE:  return "range";
+        case OTA_PATCH_ERR_IO:     return "io";
+        default:                   return "?";
+    }
+}
+
+/* ---- output ---- */
+
+static bool flush_out(ota_patch_t *p)
+{
+    if (p->out_len && !p->io.write(p->io.ctx, p->out, p->out_len)) {
+        return false;
+    }
+    p->out_len = 0;
+    return true;
+}
+
+/* n bytes that are already in out[out_len..] -> window, commit */
+static void commit_out(ota_patch_t *p, uint32_t n)
+{
+    for (uint32_t i = 0; i < n; i++) {
+        p->window[(p->out_pos + i) & (OTA_PATCH_WINDOW - 1)] = p->out[p->out_len + i];
+    }
+    p->out_len += n;
+    p->out_pos += n;
+}
+
+/* room in out, flushing first if it is full */
+static uint32_t out_room(ota_patch_t *p, uint32_t want)
+{
+    if (p->out_len == OTA_PATCH_OUT_BUF && !flush_out(p)) {
+        return 0;
+    }
+    uint32_t room = OTA_PATCH_OUT_BUF - p->out_len;
+    return want < room ? want : room;
+}
+
+/* ---- ops ---- */
+
+static ota_patch_result_t copy_new(ota_patch_t *p, uint32_t dist)
+{
+    if (dist == 0 || dist > OTA_PATCH_WINDOW || dist > p->out_pos) {
+        return OTA_PATCH_ERR_RANGE;
+    }
+    while (p->len) {
+        uint32_t n = out_room(p, p->len);
+        if (!n) {
+            return OTA_PATCH_ERR_IO;
+        }
+        /* byte by byte: dist < n overlaps on purpose (runs) */
+        for (uint32_t i = 0; i < n; i++) {
+            uint8_t b = p->window[(p->out_pos - dist) & (OTA_PATCH_WINDOW - 1)];
+            p->out[p->out_len] = b;
+            commit_out(p, 1);
+        }
+        p->len -= n;
+    }
+    return OTA_PATCH_MORE;
+}
+
+static ota_patch_result_t copy_old(ota_patch_t *p, int32_t delta)
+{
+    int64_t off = (int64_t)p->old_pos + delta;
+
+    if (!(p->hdr.flags & OTA_PATCH_FLAG_DELTA) ||
+        off < 0 || off + p->len > p->hdr.old_size) {
+        return OTA_PATCH_ERR_RANGE;
+    }
+    p->old_pos = (uint32_t)off;
+    while (p->len) {
+        uint32_t n = out_room(p, p->len);
+        if (!n || !p->io.read_old(p->io.ctx, p->old_pos, &p->out[p->out_len], n)) {
+            return OTA_PATCH_ERR_IO;
+        }
+        commit_out(p, n);
+        p->old_pos += n;
+        p->len -= n;
+    }
+    return OTA_PATCH_MORE;
+}
+
+static ota_patch_result_t parse_header(ota_patch_t *p)
+{
+    const uint8_t *h = p->hdr_buf;
+
+    if (memcmp(h, PATCH_MAGIC, 4) != 0 || h[4] != OTA_PATCH_VERSION) {
+        return OTA_PATCH_ERR_FORMAT;
+    }
+    p->hdr.version = h[4];
+    p->hdr.flags = h[5];
+    p->hdr.new_size = get_u32(&h[8]);
+    p->hdr.old_size = get_u32(&h[12]);
+    memcpy(p->hdr.old_sha256, &h[16], 32);
+    memcpy(p->hdr.new_sha256, &h[48], 32);
+
+    if ((p->hdr.flags & OTA_PATCH_FLAG_DELTA) && p->io.base_ok &&
+        !p->io.base_ok(p->io.ctx, &p->hdr)) {
+        return OTA_PATCH_ERR_BASE;
+    }
+    return OTA_PATCH_MORE;
+}
+
+/* op with its length complete: LIT reads data, NEW/OLD need their argument */
+static ota_patch_result_t op_ready(ota_patch_t *p)
+{
+    if (p->len > p->hdr.new_size - p->out_pos) {
+        return OTA_PATCH_ERR_RANGE;
+    }
+    p->varint = 0;
+    p->shift = 0;
+    p->state = (p->op == OP_LIT) ? ST_LIT : ST_ARG;
+    return OTA_PATCH_MORE;
+}
+
+static ota_patch_result_t run_op(ota_patch_t *p)
+{
+    if (p->op == OP_NEW) {
+        return copy_new(p, p->varint);
+    }
+    /* zigzag -> signed offset relative to the end of the last OLD copy */
+    return copy_old(p, (int32_t)((p->varint >> 1) ^ (0u - (p->varint & 1))));
+}
+
+/* one varint byte; true when the value is complete */
+static bool varint_byte(ota_patch_t *p, uint8_t b, ota_patch_result_t *err)
+{
+    if (p->shift > 28 || (p->shift == 28 && (b & 0x70))) {
+        *err = OTA_PATCH_ERR_FORMAT;    /* more than 32 bits */
+        return false;
+    }
+    p->varint |= (uint32_t)(b & 0x7f) << p->shift;
+    p->shift += 7;
+    return !(b & 0x80);
+}
+
+ota_patch_result_t ota_patch_feed(ota_patch_t *p, const uint8_t *data, size_t len)
+{
+    ota_patch_result_t rc = OTA_PATCH_MORE;
+    size_t i = 0;
+
+    if (p->result != OTA_PATCH_MORE) {
+        return (p->result == OTA_PATCH_DONE && len) ? OTA_PATCH_ERR_FORMAT : p->result;
+    }
+
+    while (i < len && rc == OTA_PATCH_MORE) {
+        uint8_t b;
+
+        switch (p->state) {
+            case ST_HEADER: {
+                uint32_t n = OTA_PATCH_HDR_SIZE - p->hdr_len;
+                if (n > len - i) {
+                    n = (uint32_t)(len - i);
+                }
+                memcpy(&p->hdr_buf[p->hdr_len], &data[i], n);
+                p->hdr_len += n;
+                i += n;
+                if (p->hdr_len == OTA_PATCH_HDR_SIZE) {
+                    rc = parse_header(p);
+                    p->state = ST_OP;
+                }
+                break;
+            }
+
+            case ST_OP:
+                b = data[i++];
+                p->op = b >> 6;
+                if (p->op == OP_END) {
+                    if (b != (OP_END << 6)) {
+                        rc = OTA_PATCH_ERR_FORMAT;
+                    } else if (p->out_pos != p->hdr.new_size) {
+                        rc = OTA_PATCH_ERR_RANGE;
+                    } else {
+                        rc = flush_out(p) ? OTA_PATCH_DONE : OTA_PATCH_ERR_IO;
+                        p->state = ST_END;
+                    }
+                } else if ((b & 0x3f) == LEN_EXT) {
+                    p->varint = 0;
+                    p->shift = 0;
+                    p->state = ST_LEN;
+                } else {
+                    p->len = (b & 0x3f) + 1u;
+                    rc = op_ready(p);
+                }
+                break;
+
+            case ST_LEN:
+                if (varint_byte(p, data[i++], &rc)) {
+                    if (p->varint > UINT32_MAX - 64) {
+                        rc = OTA_PATCH_ERR_RANGE;
+                        break;
+                    }
+                    p->len = 64 + p->varint;
+                    rc = op_ready(p);
+                }
+                break;
+
+            case ST_ARG:
+                if (varint_byte(p, data[i++], &rc)) {
+                    rc = run_op(p);
+                    p->state = ST_OP;
+                }
+                break;
+
+            case ST_LIT: {
+                uint32_t avail = (uint32_t)((len - i) < p->len ? (len - i) : p->len);
+                uint32_t n = out_room(p, avail);
+                if (!n) {
+                    rc = OTA_PATCH_ERR_IO;
+                    break;
+                }
+                memcpy(&p->out[p->out_len], &data[i], n);
+                commit_out(p, n);
+                i += n;
+                p->len -= n;
+                if (p->len == 0) {
+                    p->state = ST_OP;
+                }
+                break;
+            }
+
+            default:                /* ST_END: nothing may follow */
+                rc = OTA_PATCH_ERR_FORMAT;
+                break;
+        }
+    }
+
+    if (rc == OTA_PATCH_DONE && i < len) {
+        rc = OTA_PATCH_ERR_FORMAT;
+    }
+    p->result = rc;
+    return rc;
+}
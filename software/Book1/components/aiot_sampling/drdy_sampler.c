@@ -0,0 +1,189 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: interrupt driven (data-ready) sampling
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+
+#include "drdy_sampler.h"
+
+static const char *TAG = "DRDY";
+
+#define DRDY_TASK_STACK     4096
+
+typedef struct {
+    drdy_source_config_t cfg;
+    uint8_t              id;
+    volatile uint32_t    dropped;
+    sample_stats_t       stats;
+} drdy_source_t;
+
+/*
+ * All GPIO handlers run from the one GPIO ISR service on one core,
+ * so the ring always has exactly one producer.
+ */
+static event_ring_t   s_ring;
+static drdy_source_t  s_sources[DRDY_MAX_SOURCES];
+static uint8_t        s_source_count = 0;
+static TaskHandle_t   s_worker = NULL;
+static portMUX_TYPE   s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* --------------------------------------------------------------------------
+ * ISR: timestamp + push, nothing else
+ * -------------------------------------------------------------------------- */
+
+static void IRAM_ATTR drdy_isr(void *arg)
+{
+    drdy_source_t *src = (drdy_source_t *)arg;
+    BaseType_t must_yield = pdFALSE;
+
+    sample_event_t ev = {
+        .timestamp_us = esp_timer_get_time(),
+        .source = src->id,
+        .level = (uint8_t)gpio_get_level(src->cfg.gpio),
+    };
+
+    if (!event_ring_push(&s_ring, &ev)) {
+        src->dropped++;
+        return;
+    }
+
+    vTaskNotifyGiveFromISR(s_worker, &must_yield);
+    if (must_yield) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Worker: only runs when there is something to read
+ * -------------------------------------------------------------------------- */
+
+static void drdy_worker(void *arg)
+{
+    (void)arg;
+    sample_event_t ev;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (event_ring_pop(&s_ring, &ev)) {
+            if (ev.source >= s_source_count) {
+                continue;
+            }
+            drdy_source_t *src = &s_sources[ev.source];
+
+            /* latency up to the end of the read, like the poll loop */
+            if (src->cfg.handler && !src->cfg.handler(&ev, src->cfg.ctx)) {
+                continue;
+            }
+            int64_t handled_us = esp_timer_get_time();
+
+            taskENTER_CRITICAL(&s_stats_lock);
+            sample_stats_add(&src->stats, ev.timestamp_us, handled_us);
+            taskEXIT_CRITICAL(&s_stats_lock);
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Public API
+ * -------------------------------------------------------------------------- */
+
+esp_err_t drdy_sampler_start(UBaseType_t priority)
+{
+    if (s_worker) {
+        return ESP_OK;
+    }
+
+    event_ring_init(&s_ring);
+
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        /* INVALID_STATE = already installed by someone else, that's fine */
+        return err;
+    }
+
+    if (xTaskCreate(drdy_worker, "drdy", DRDY_TASK_STACK, NULL, priority, &s_worker) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t drdy_sampler_add_source(const drdy_source_config_t *cfg, uint8_t *out_id)
+{
+    if (!cfg || !s_worker) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_source_count >= DRDY_MAX_SOURCES) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    drdy_source_t *src = &s_sources[s_source_count];
+    memset(src, 0, sizeof(*src));
+    src->cfg = *cfg;
+    src->id = s_source_count;
+    sample_stats_reset(&src->stats, cfg->expected_period_us);
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << cfg->gpio),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = cfg->pull_up ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = cfg->edge,
+    };
+    esp_err_t err = gpio_config(&io_conf);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    /* count the source before the first interrupt can arrive */
+    s_source_count++;
+
+    err = gpio_isr_handler_add(cfg->gpio, drdy_isr, src);
+    if (err != ESP_OK) {
+        s_source_count--;
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Source %u on GPIO%d registered", src->id, cfg->gpio);
+
+    if (out_id) {
+        *out_id = src->id;
+    }
+    return ESP_OK;
+}
+
+esp_err_t drdy_sampler_get_stats(uint8_t id, sample_stats_t *out, uint32_t *dropped)
+{
+    if (id >= s_source_count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    taskENTER_CRITICAL(&s_stats_lock);
+    if (out) {
+        *out = s_sources[id].stats;
+    }
+    if (dropped) {
+        *dropped = s_sources[id].dropped;
+    }
+    taskEXIT_CRITICAL(&s_stats_lock);
+    return ESP_OK;
+}
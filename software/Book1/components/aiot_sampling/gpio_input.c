@@ -0,0 +1,392 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: interrupt driven GPIO inputs and pulse counters
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+#include "driver/pulse_cnt.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_attr.h"
+
+#include "event_ring.h"
+#include "gpio_input.h"
+
+static const char *TAG = "GPIO_IN";
+
+#define GPIO_INPUT_TASK_STACK   3072
+#define PCNT_HIGH_LIMIT         32767
+#define PCNT_LOW_LIMIT          (-1)
+
+typedef struct {
+    gpio_input_pin_config_t cfg;
+    uint8_t                 id;
+    gpio_debounce_t         deb;
+    volatile uint32_t       ring_dropped;
+    gpio_input_stats_t      stats;
+} gpio_input_pin_t;
+
+/*
+ * One ISR function serves every pin (arg = pin slot). All GPIO handlers run
+ * from the one GPIO ISR service on one core, so the ring has one producer.
+ */
+static event_ring_t       s_ring;
+static gpio_input_pin_t   s_pins[GPIO_INPUT_MAX_PINS];
+static uint8_t            s_pin_count = 0;
+static TaskHandle_t       s_worker = NULL;
+static esp_timer_handle_t s_debounce_timer = NULL;
+static portMUX_TYPE       s_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* debounced events, storage is static */
+static StaticQueue_t      s_queue_buf;
+static uint8_t            s_queue_storage[GPIO_INPUT_QUEUE_LEN * sizeof(gpio_input_event_t)];
+static QueueHandle_t      s_queue = NULL;
+
+static pcnt_unit_handle_t s_counters[GPIO_INPUT_MAX_COUNTERS];
+static uint8_t            s_counter_count = 0;
+
+/* --------------------------------------------------------------------------
+ * ISR: timestamp + push, nothing else
+ * -------------------------------------------------------------------------- */
+
+static void IRAM_ATTR gpio_input_isr(void *arg)
+{
+    gpio_input_pin_t *pin = (gpio_input_pin_t *)arg;
+    BaseType_t must_yield = pdFALSE;
+
+    sample_event_t ev = {
+        .timestamp_us = esp_timer_get_time(),
+        .source = pin->id,
+    };
+
+    if (!event_ring_push(&s_ring, &ev)) {
+        pin->ring_dropped++;
+        return;
+    }
+
+    vTaskNotifyGiveFromISR(s_worker, &must_yield);
+    if (must_yield) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+/* esp_timer task context: the quiet window of some pin is over */
+static void debounce_timer_cb(void *arg)
+{
+    (void)arg;
+    xTaskNotifyGive(s_worker);
+}
+
+/* --------------------------------------------------------------------------
+ * Worker: feeds the debouncers, arms the timer for the next deadline
+ * -------------------------------------------------------------------------- */
+
+static void gpio_input_worker(void *arg)
+{
+    (void)arg;
+    sample_event_t ev;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (event_ring_pop(&s_ring, &ev)) {
+            if (ev.source >= s_pin_count) {
+                continue;
+            }
+            gpio_input_pin_t *pin = &s_pins[ev.source];
+            gpio_debounce_feed(&pin->deb, ev.timestamp_us);
+
+            taskENTER_CRITICAL(&s_stats_lock);
+            pin->stats.raw_edges++;
+            taskEXIT_CRITICAL(&s_stats_lock);
+        }
+
+        int64_t now = esp_timer_get_time();
+        int64_t next = INT64_MAX;
+
+        for (uint8_t i = 0; i < s_pin_count; i++) {
+            gpio_input_pin_t *pin = &s_pins[i];
+            gpio_debounce_edge_t edge;
+
+            if (gpio_debounce_poll(&pin->deb, now, pin->cfg.debounce_us,
+                                   (uint8_t)gpio_get_level(pin->cfg.gpio), &edge)) {
+                gpio_input_event_t out = {
+                    .timestamp_us = edge.timestamp_us,
+                    .gpio = pin->cfg.gpio,
+                    .id = pin->id,
+                    .level = edge.level,
+                    .bounces = edge.bounces,
+                };
+
+                bool sent = (xQueueSend(s_queue, &out, 0) == pdTRUE);
+
+                taskENTER_CRITICAL(&s_stats_lock);
+                if (sent) {
+                    pin->stats.edges++;
+                } else {
+                    pin->stats.dropped++;
+                }
+                taskEXIT_CRITICAL(&s_stats_lock);
+            }
+
+            int64_t deadline = gpio_debounce_deadline(&pin->deb, pin->cfg.debounce_us);
+            if (deadline < next) {
+                next = deadline;
+            }
+        }
+
+        if (next != INT64_MAX) {
+            esp_timer_stop(s_debounce_timer);   /* ESP_ERR_INVALID_STATE if idle: fine */
+            uint64_t delay = (next > now) ? (uint64_t)(next - now) : 1;
+            esp_timer_start_once(s_debounce_timer, delay);
+        }
+    }
+}
+
+/* --------------------------------------------------------------------------
+ * Public API: debounced inputs
+ * -------------------------------------------------------------------------- */
+
+/* undo gpio_input_start() after a failed step (the ISR service stays, it is shared) */
+static void start_release(void)
+{
+    if (s_debounce_timer) {
+        esp_timer_delete(s_debounce_timer);
+        s_debounce_timer = NULL;
+    }
+    if (s_queue) {
+        vQueueDelete(s_queue);
+        s_queue = NULL;
+    }
+}
+
+esp_err_t gpio_input_start(UBaseType_t priority)
+{
+    if (s_worker) {
+        return ESP_OK;
+    }
+
+    event_ring_init(&s_ring);
+    s_queue = xQueueCreateStatic(GPIO_INPUT_QUEUE_LEN, sizeof(gpio_input_event_t),
+                                 s_queue_storage, &s_queue_buf);
+
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        /* INVALID_STATE = already installed by someone else, that's fine */
+        start_release();
+        return err;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = debounce_timer_cb,
+        .name = "gpio_debounce",
+    };
+    err = esp_timer_create(&timer_args, &s_debounce_timer);
+    if (err != ESP_OK) {
+        s_debounce_timer = NULL;
+        start_release();
+        return err;
+    }
+
+    if (xTaskCreate(gpio_input_worker, "gpio_in", GPIO_INPUT_TASK_STACK, NULL, priority, &s_worker) != pdPASS) {
+        s_worker = NULL;
+        start_release();
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_input_add_pin(const gpio_input_pin_config_t *cfg, uint8_t *out_id)
+{
+    if (!cfg || !s_worker) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_pin_count >= GPIO_INPUT_MAX_PINS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    gpio_input_pin_t *pin = &s_pins[s_pin_count];
+    memset(pin, 0, sizeof(*pin));
+    pin->cfg = *cfg;
+    pin->id = s_pin_count;
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = (1ULL << cfg->gpio),
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = cfg->pull_up ? GPIO_PULLUP_ENABLE : GPIO_PULLUP_DISABLE,
+        .pull_down_en = GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
+    };
+    esp_err_t err = gpio_config(&io_conf);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    gpio_debounce_init(&pin->deb, (uint8_t)gpio_get_level(cfg->gpio));
+
+    /* count the pin before the first interrupt can arrive */
+    s_pin_count++;
+
+    err = gpio_isr_handler_add(cfg->gpio, gpio_input_isr, pin);
+    if (err != ESP_OK) {
+        s_pin_count--;
+        return err;
+    }
+
+    ESP_LOGI(TAG, "Input %u on GPIO%d, debounce %lu us", pin->id, cfg->gpio,
+             (unsigned long)cfg->debounce_us);
+
+    if (out_id) {
+        *out_id = pin->id;
+    }
+    return ESP_OK;
+}
+
+bool gpio_input_receive(gpio_input_event_t *out, TickType_t timeout)
+{
+    if (!s_queue) {
+        return false;
+    }
+    return xQueueReceive(s_queue, out, timeout) == pdTRUE;
+}
+
+esp_err_t gpio_input_get_stats(uint8_t id, gpio_input_stats_t *out)
+{
+    if (id >= s_pin_count || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    taskENTER_CRITICAL(&s_stats_lock);
+    *out = s_pins[id].stats;
+    out->glitches = s_pins[id].deb.glitches;
+    out->dropped += s_pins[id].ring_dropped;
+    taskEXIT_CRITICAL(&s_stats_lock);
+    return ESP_OK;
+}
+
+/* --------------------------------------------------------------------------
+ * Public API: hardware pulse counters
+ * -------------------------------------------------------------------------- */
+
+/* undo a half set up counter, in reverse order (chan NULL = not created yet) */
+static void counter_release(pcnt_unit_handle_t unit, pcnt_channel_handle_t chan, bool enabled)
+{
+    if (enabled) {
+        pcnt_unit_disable(unit);
+    }
+    if (chan) {
+        pcnt_del_channel(chan);
+    }
+    pcnt_del_unit(unit);
+}
+
+esp_err_t gpio_input_add_counter(gpio_num_t gpio, bool pull_up, uint32_t glitch_ns, uint8_t *out_id)
+{
+    if (s_counter_count >= GPIO_INPUT_MAX_COUNTERS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    /* accum_count: the driver adds the 16 bit overflows at the watch point */
+    pcnt_unit_config_t unit_cfg = {
+        .low_limit = PCNT_LOW_LIMIT,
+        .high_limit = PCNT_HIGH_LIMIT,
+        .flags.accum_count = true,
+    };
+    pcnt_unit_handle_t unit = NULL;
+    esp_err_t err = pcnt_new_unit(&unit_cfg, &unit);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    if (glitch_ns) {
+        pcnt_glitch_filter_config_t filter_cfg = {
+            .max_glitch_ns = glitch_ns,
+        };
+        err = pcnt_unit_set_glitch_filter(unit, &filter_cfg);
+        if (err != ESP_OK) {
+            counter_release(unit, NULL, false);
+            return err;
+        }
+    }
+
+    pcnt_chan_config_t chan_cfg = {
+        .edge_gpio_num = gpio,
+        .level_gpio_num = -1,
+    };
+    pcnt_channel_handle_t chan = NULL;
+    err = pcnt_new_channel(unit, &chan_cfg, &chan);
+    if (err != ESP_OK) {
+        counter_release(unit, NULL, false);
+        return err;
+    }
+
+    /* count rising edges only */
+    err = pcnt_channel_set_edge_action(chan, PCNT_CHANNEL_EDGE_ACTION_INCREASE,
+                                       PCNT_CHANNEL_EDGE_ACTION_HOLD);
+    if (err == ESP_OK) {
+        err = pcnt_unit_add_watch_point(unit, PCNT_HIGH_LIMIT);
+    }
+    if (err != ESP_OK) {
+        counter_release(unit, chan, false);
+        return err;
+    }
+
+    if (pull_up) {
+        gpio_set_pull_mode(gpio, GPIO_PULLUP_ONLY);
+    }
+
+    err = pcnt_unit_enable(unit);
+    if (err != ESP_OK) {
+        counter_release(unit, chan, false);
+        return err;
+    }
+    err = pcnt_unit_clear_count(unit);
+    if (err == ESP_OK) {
+        err = pcnt_unit_start(unit);
+    }
+    if (err != ESP_OK) {
+        counter_release(unit, chan, true);
+        return err;
+    }
+
+    s_counters[s_counter_count] = unit;
+    ESP_LOGI(TAG, "Counter %u on GPIO%d", s_counter_count, gpio);
+
+    if (out_id) {
+        *out_id = s_counter_count;
+    }
+    s_counter_count++;
+    return ESP_OK;
+}
+
+esp_err_t gpio_input_get_count(uint8_t id, int *out_count)
+{
+    if (id >= s_counter_count || !out_count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return pcnt_unit_get_count(s_counters[id], out_count);
+}
+
+esp_err_t gpio_input_clear_count(uint8_t id)
+{
+    if (id >= s_counter_count) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return pcnt_unit_clear_count(s_counters[id]);
+}
@@ -0,0 +1,68 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: interrupt driven (data-ready) sampling
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY INTERRUPTS INSTEAD OF vTaskDelay()?
+ * ---------------------------------------
+ * A delay loop drifts (read time adds to the period) and wakes the CPU even
+ * if the sensor has nothing new. Here the sensor tells us when data is
+ * ready (e.g. MPU6050 INT pin):
+ *
+ *   GPIO edge -> ISR: timestamp (esp_timer_get_time) + push to ring
+ *             -> worker task wakes, pops the event, calls the handler
+ *
+ * The ISR does not touch the sensor (no I2C in interrupt context).
+ * Each source gets interval/jitter/latency statistics for free.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+#include "esp_err.h"
+
+#include "event_ring.h"
+#include "sample_stats.h"
+
+#define DRDY_MAX_SOURCES    4
+
+/*
+ * Called in the worker task for every event of the source; reads the sensor.
+ * Return false if the read failed: the event is then left out of the
+ * statistics (see sample_stats_add).
+ */
+typedef bool (*drdy_handler_t)(const sample_event_t *ev, void *ctx);
+
+typedef struct {
+    gpio_num_t      gpio;
+    gpio_int_type_t edge;               /* e.g. GPIO_INTR_POSEDGE */
+    bool            pull_up;
+    uint32_t        expected_period_us; /* for jitter statistics, 0 = unknown */
+    drdy_handler_t  handler;            /* NULL = statistics only */
+    void           *ctx;
+} drdy_source_config_t;
+
+/* Start the worker task (once). */
+esp_err_t drdy_sampler_start(UBaseType_t priority);
+
+/* Register a GPIO source. *out_id is used in events and for statistics. */
+esp_err_t drdy_sampler_add_source(const drdy_source_config_t *cfg, uint8_t *out_id);
+
+/* Copy statistics of one source; dropped = events lost because ring was full */
+esp_err_t drdy_sampler_get_stats(uint8_t id, sample_stats_t *out, uint32_t *dropped);
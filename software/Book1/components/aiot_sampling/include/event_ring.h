@@ -0,0 +1,79 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: lock-free single-producer/single-consumer event ring
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * Producer: an ISR (writes head only)
+ * Consumer: one task (writes tail only)
+ *
+ * No locks, no critical sections: head and tail are free-running counters,
+ * the index is counter & (SIZE - 1). Acquire/release ordering makes sure the
+ * consumer never sees a slot before its content is written.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#define EVENT_RING_SIZE     64      /* must be a power of two */
+#define EVENT_RING_MASK     (EVENT_RING_SIZE - 1)
+
+typedef struct {
+    int64_t  timestamp_us;  /* esp_timer_get_time() in the ISR */
+    uint8_t  source;        /* source id (one per GPIO) */
+    uint8_t  level;         /* GPIO level seen in the ISR */
+} sample_event_t;
+
+typedef struct {
+    sample_event_t  buf[EVENT_RING_SIZE];
+    atomic_uint     head;
+    atomic_uint     tail;
+} event_ring_t;
+
+static inline void event_ring_init(event_ring_t *r)
+{
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+}
+
+/* Producer side (ISR). Returns false if the ring is full (event dropped). */
+static inline bool event_ring_push(event_ring_t *r, const sample_event_t *ev)
+{
+    unsigned head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+
+    if (head - tail >= EVENT_RING_SIZE) {
+        return false;
+    }
+    r->buf[head & EVENT_RING_MASK] = *ev;
+    atomic_store_explicit(&r->head, head + 1, memory_order_release);
+    return true;
+}
+
+/* Consumer side (task). Returns false if the ring is empty. */
+static inline bool event_ring_pop(event_ring_t *r, sample_event_t *out)
+{
+    unsigned tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    unsigned head = atomic_load_explicit(&r->head, memory_order_acquire);
+
+    if (head == tail) {
+        return false;
+    }
+    *out = r->buf[tail & EVENT_RING_MASK];
+    atomic_store_explicit(&r->tail, tail + 1, memory_order_release);
+    return true;
+}
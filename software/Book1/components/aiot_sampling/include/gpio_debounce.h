@@ -0,0 +1,103 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: edge debouncer (pure logic, no driver access)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * A mechanical contact bounces for a few milliseconds:
+ *
+ *   raw:     ___|‾|_|‾‾|_|‾‾‾‾‾‾‾‾‾‾‾‾‾
+ *               ^ first edge   ^ quiet for debounce_us -> commit HIGH
+ *
+ * Every raw edge (from the ISR) restarts the quiet window. When the window
+ * expires, the pin level is read once and committed if it differs from the
+ * last stable level. The reported timestamp is the FIRST edge of the burst,
+ * so the event time is not delayed by the bounce itself.
+ *
+ * Only timestamps go in, so the logic can be driven with synthetic edge
+ * patterns without hardware.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+typedef struct {
+    uint8_t  stable_level;
+    bool     pending;
+    int64_t  first_edge_us;
+    int64_t  last_edge_us;
+    uint16_t bounces;       /* raw edges after the first one in this burst */
+    uint32_t glitches;      /* bursts that ended at the old level */
+} gpio_debounce_t;
+
+typedef struct {
+    int64_t  timestamp_us;  /* first raw edge of the burst */
+    uint8_t  level;         /* new stable level */
+    uint16_t bounces;
+} gpio_debounce_edge_t;
+
+static inline void gpio_debounce_init(gpio_debounce_t *d, uint8_t level)
+{
+    d->stable_level = level;
+    d->pending = false;
+    d->first_edge_us = 0;
+    d->last_edge_us = 0;
+    d->bounces = 0;
+    d->glitches = 0;
+}
+
+/* One raw edge seen by the ISR */
+static inline void gpio_debounce_feed(gpio_debounce_t *d, int64_t edge_us)
+{
+    if (!d->pending) {
+        d->pending = true;
+        d->first_edge_us = edge_us;
+        d->bounces = 0;
+    } else if (d->bounces < UINT16_MAX) {
+        d->bounces++;
+    }
+    d->last_edge_us = edge_us;
+}
+
+/* When the current burst may be committed, INT64_MAX if nothing is pending */
+static inline int64_t gpio_debounce_deadline(const gpio_debounce_t *d, uint32_t debounce_us)
+{
+    return d->pending ? d->last_edge_us + debounce_us : INT64_MAX;
+}
+
+/*
+ * Call when the quiet window may have expired. level_now is the pin level
+ * read at that moment. Returns true and fills *out if the stable level changed.
+ */
+static inline bool gpio_debounce_poll(gpio_debounce_t *d, int64_t now_us, uint32_t debounce_us,
+                                      uint8_t level_now, gpio_debounce_edge_t *out)
+{
+    if (!d->pending || now_us < d->last_edge_us + (int64_t)debounce_us) {
+        return false;
+    }
+    d->pending = false;
+
+    if (level_now == d->stable_level) {
+        d->glitches++;
+        return false;
+    }
+
+    d->stable_level = level_now;
+    out->timestamp_us = d->first_edge_us;
+    out->level = level_now;
+    out->bounces = d->bounces;
+    return true;
+}
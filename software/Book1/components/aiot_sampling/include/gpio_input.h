@@ -0,0 +1,89 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: interrupt driven GPIO inputs and pulse counters
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY NOT POLL gpio_get_level()?
+ * ------------------------------
+ * Polling every 50 ms wakes the CPU 20 times per second and still misses
+ * pulses shorter than the poll period. Here:
+ *
+ *   any edge -> one shared ISR: timestamp + pin id into the event ring
+ *            -> worker task feeds the debouncer, an esp_timer fires
+ *               when the quiet window is over
+ *            -> stable edge goes into a queue (gpio_input_receive)
+ *
+ * All storage is static, nothing is allocated per event. Fast signals
+ * (flow meters, encoders, anemometers) should not raise one interrupt per
+ * pulse: gpio_input_add_counter() lets the PCNT peripheral count them.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "driver/gpio.h"
+#include "esp_err.h"
+
+#include "gpio_debounce.h"
+
+#define GPIO_INPUT_MAX_PINS     8
+#define GPIO_INPUT_MAX_COUNTERS 4
+#define GPIO_INPUT_QUEUE_LEN    32
+
+typedef struct {
+    gpio_num_t gpio;
+    bool       pull_up;
+    uint32_t   debounce_us;     /* quiet time before an edge counts, e.g. 20000 */
+} gpio_input_pin_config_t;
+
+typedef struct {
+    int64_t    timestamp_us;    /* first raw edge, esp_timer_get_time() */
+    gpio_num_t gpio;
+    uint8_t    id;              /* pin id from gpio_input_add_pin() */
+    uint8_t    level;           /* new stable level */
+    uint16_t   bounces;         /* raw edges swallowed by the debouncer */
+} gpio_input_event_t;
+
+typedef struct {
+    uint32_t edges;             /* debounced edges delivered */
+    uint32_t raw_edges;         /* interrupts seen */
+    uint32_t glitches;          /* bursts that ended at the old level */
+    uint32_t dropped;           /* ring or queue full */
+} gpio_input_stats_t;
+
+/* Start the worker task and debounce timer (once). */
+esp_err_t gpio_input_start(UBaseType_t priority);
+
+/* Register an any-edge input. *out_id is used in events and for statistics. */
+esp_err_t gpio_input_add_pin(const gpio_input_pin_config_t *cfg, uint8_t *out_id);
+
+/* Wait for the next debounced edge of any pin */
+bool gpio_input_receive(gpio_input_event_t *out, TickType_t timeout);
+
+esp_err_t gpio_input_get_stats(uint8_t id, gpio_input_stats_t *out);
+
+/*
+ * Count rising edges in hardware (PCNT). glitch_ns filters spikes shorter
+ * than the given time (0 = off, hardware limit ~12 us).
+ */
+esp_err_t gpio_input_add_counter(gpio_num_t gpio, bool pull_up, uint32_t glitch_ns, uint8_t *out_id);
+
+/* Accumulated count since start, overflows of the 16 bit unit are handled */
+esp_err_t gpio_input_get_count(uint8_t id, int *out_count);
+
+esp_err_t gpio_input_clear_count(uint8_t id);
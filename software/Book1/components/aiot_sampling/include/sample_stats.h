@@ -0,0 +1,48 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: sampling jitter / latency statistics
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ ******************************************************************************/
+
+/*
+ * interval : time between two consecutive events (should be the period)
+ * jitter   : |interval - expected period|, max and mean
+ * latency  : time from event (ISR timestamp) until the worker handles it
+ *
+ * Used for the interrupt driven sampler and for the old vTaskDelay loop,
+ * so both modes can be compared with the same numbers.
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef struct {
+    uint32_t count;
+    int64_t  last_event_us;
+    uint32_t expected_us;
+
+    uint32_t interval_min_us;
+    uint32_t interval_max_us;
+    uint32_t jitter_max_us;
+    uint64_t jitter_sum_us;
+
+    uint32_t latency_min_us;
+    uint32_t latency_max_us;
+    uint64_t latency_sum_us;
+} sample_stats_t;
+
+void sample_stats_reset(sample_stats_t *st, uint32_t expected_us);
+
+/*
+ * One successfully read sample (failed reads are not added, so count,
+ * interval and latency describe data that actually arrived).
+ *  event_us  : the trigger - DRDY edge in the ISR, or the wake-up of a poll loop
+ *  handled_us: after the sensor read returned, i.e. the data is in RAM
+ * Latency = handled_us - event_us, the same definition for every mode.
+ */
+void sample_stats_add(sample_stats_t *st, int64_t event_us, int64_t handled_us);
+
+/* One log line: "<label>: n=.. int=min/max jitter=mean/max lat=min/mean/max us" */
+void sample_stats_log(const char *tag, const char *label, const sample_stats_t *st);
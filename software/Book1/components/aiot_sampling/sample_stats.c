@@ -0,0 +1,63 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: sampling jitter / latency statistics
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "esp_log.h"
+
+#include "sample_stats.h"
+
+void sample_stats_reset(sample_stats_t *st, uint32_t expected_us)
+{
+    memset(st, 0, sizeof(*st));
+    st->expected_us = expected_us;
+    st->interval_min_us = UINT32_MAX;
+    st->latency_min_us = UINT32_MAX;
+}
+
+void sample_stats_add(sample_stats_t *st, int64_t event_us, int64_t handled_us)
+{
+    uint32_t latency = (handled_us > event_us) ? (uint32_t)(handled_us - event_us) : 0;
+    if (latency < st->latency_min_us) st->latency_min_us = latency;
+    if (latency > st->latency_max_us) st->latency_max_us = latency;
+    st->latency_sum_us += latency;
+
+    if (st->count > 0) {
+        uint32_t interval = (uint32_t)(event_us - st->last_event_us);
+        if (interval < st->interval_min_us) st->interval_min_us = interval;
+        if (interval > st->interval_max_us) st->interval_max_us = interval;
+
+        if (st->expected_us) {
+            uint32_t jitter = (interval > st->expected_us) ? interval - st->expected_us
+                                                           : st->expected_us - interval;
+            if (jitter > st->jitter_max_us) st->jitter_max_us = jitter;
+            st->jitter_sum_us += jitter;
+        }
+    }
+
+    st->last_event_us = event_us;
+    st->count++;
+}
+
+void sample_stats_log(const char *tag, const char *label, const sample_stats_t *st)
+{
+    if (st->count < 2) {
+        ESP_LOGI(tag, "%s: not enough samples", label);
+        return;
+    }
+
+    ESP_LOGI(tag, "%s: n=%lu int=%lu/%lu us jitter=%lu/%lu us lat=%lu/%lu/%lu us",
+             label,
+             (unsigned long)st->count,
+             (unsigned long)st->interval_min_us,
+             (unsigned long)st->interval_max_us,
+             (unsigned long)(st->jitter_sum_us / (st->count - 1)),
+             (unsigned long)st->jitter_max_us,
+             (unsigned long)st->latency_min_us,
+             (unsigned long)(st->latency_sum_us / st->count),
+             (unsigned long)st->latency_max_us);
+}
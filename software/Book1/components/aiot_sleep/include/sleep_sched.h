@@ -0,0 +1,125 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: adaptive deep sleep interval (pure logic)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY AN ADAPTIVE INTERVAL?
+ * -------------------------
+ * A fixed SLEEP_TIME_SEC is always wrong: too short while the reading sits
+ * still for hours (every wake costs a boot), too long when it moves (the
+ * change is seen late). The scheduler picks the next interval once per
+ * wake from what the node knows anyway:
+ *
+ *   signal    rate of change of the reading, |dv| / dt. The interval is
+ *             chosen so that the reading moves by about 'change' units
+ *             between two wakes:  t = change / rate
+ *             The rate follows a jump at once and decays slowly (1/4 per
+ *             wake), so a calm phase has to prove itself first. Growth is
+ *             limited to grow_pct per wake, shrinking happens at once.
+ *   cost      measured awake time (EWMA) x awake current must fit into the
+ *             average current budget:
+ *             t >= awake_ms * awake_ma / (budget_ua - sleep_ua)
+ *             A slow Wi-Fi link makes every wake dearer -> sleep longer.
+ *   battery   below batt_ok_mv the interval is stretched linearly up to
+ *             4x at batt_low_mv; at or below batt_low_mv -> max_s.
+ *
+ * The result is clamped to [min_s, max_s]. A manual interval (sleep=<sec>
+ * command) pins it until it is released again; the signal statistics keep
+ * running underneath. sleep_sched_limit() tells which rule decided, so the
+ * status message can say why the node sleeps that long.
+ *
+ * The decision depends on the inputs and the RTC copy only, so a recorded
+ * trace gives the same intervals on the PC: tools/sleep_sched_replay.py
+ * is the Python twin, and host_test/test_sleep_sched.c runs random traces
+ * through both and compares every interval and rule.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SLEEP_SCHED_MIN_DEFAULT_S    10
+#define SLEEP_SCHED_MAX_DEFAULT_S    900
+#define SLEEP_SCHED_GROW_DEFAULT_PCT 150
+#define SLEEP_SCHED_BATT_STRETCH     4      /* interval factor at batt_low_mv */
+
+typedef struct {
+    uint32_t min_s;             /* 0 -> SLEEP_SCHED_MIN_DEFAULT_S */
+    uint32_t max_s;             /* 0 -> SLEEP_SCHED_MAX_DEFAULT_S */
+    uint32_t start_s;           /* after power-on and without readings, 0 -> min_s */
+    uint32_t change;            /* allowed change between two wakes (reading units),
+                                   0 -> signal rule off */
+    uint32_t grow_pct;          /* max growth per wake, 0 -> SLEEP_SCHED_GROW_DEFAULT_PCT */
+
+    uint32_t awake_ma;          /* average current awake, 0 -> cost rule off */
+    uint32_t sleep_ua;          /* deep sleep floor */
+    uint32_t budget_ua;         /* average current allowed */
+
+    uint32_t batt_ok_mv;        /* 0 -> battery rule off */
+    uint32_t batt_low_mv;
+} sleep_sched_config_t;
+
+/* Which rule set the interval */
+typedef enum {
+    SLEEP_SCHED_START = 0,      /* no rate known yet */
+    SLEEP_SCHED_SIGNAL,
+    SLEEP_SCHED_RAMP,           /* signal wants longer, growth limited */
+    SLEEP_SCHED_COST,
+    SLEEP_SCHED_BATTERY,
+    SLEEP_SCHED_MIN,
+    SLEEP_SCHED_MAX,
+    SLEEP_SCHED_PINNED,
+} sleep_sched_limit_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t interval_s;        /* last decision */
+    uint32_t signal_s;          /* signal rule alone (ramp base), 0 = none yet */
+    uint32_t pinned_s;          /* manual interval, 0 = adaptive */
+    uint32_t wakes;
+    uint32_t readings;          /* values seen since power-on */
+    int32_t  last_value;
+    uint32_t t_last_s;          /* caller clock at last_value */
+    uint32_t rate_k;            /* |change| per 1000 s, jump up, decay 1/4 */
+    uint32_t awake_ms;          /* EWMA 1/4 of the reported awake times */
+    uint8_t  limit;             /* sleep_sched_limit_t */
+} sleep_sched_t;
+
+typedef struct {
+    uint32_t now_s;             /* clock that keeps running in deep sleep */
+    bool     has_value;
+    int32_t  value;             /* sensor reading (mV, raw, ...) */
+    uint32_t awake_ms;          /* last wake boot -> sleep, 0 = unknown */
+    uint32_t batt_mv;           /* 0 = unknown */
+} sleep_sched_input_t;
+
+/* Keep the state if the RTC copy is valid, start over otherwise */
+void sleep_sched_init(sleep_sched_t *s, const sleep_sched_config_t *cfg);
+
+/* One wake: fold in the inputs, return the next interval in seconds */
+uint32_t sleep_sched_update(sleep_sched_t *s, const sleep_sched_config_t *cfg,
+                            const sleep_sched_input_t *in);
+
+/* Manual interval (applies from the next update), 0 = back to adaptive */
+void sleep_sched_pin(sleep_sched_t *s, uint32_t sec);
+
+static inline sleep_sched_limit_t sleep_sched_limit(const sleep_sched_t *s)
+{
+    return (sleep_sched_limit_t)s->limit;
+}
+
+/* Short name ("signal"), "?" for an unknown value */
+const char *sleep_sched_limit_name(sleep_sched_limit_t l);
@@ -0,0 +1,92 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: ADC sampling on the ULP core, main CPU side
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY THE ULP?
+ * ------------
+ * A timer wake boots the main CPU just to take one ADC reading. The ULP
+ * RISC-V core takes the reading instead, from RTC memory, at a fraction of
+ * the current, and wakes the main CPU only when there is something to do
+ * (threshold crossed, window full - see ulp_sampler.h).
+ *
+ *   cold boot:  ulp_monitor_start(&cfg)          load + start the ULP
+ *   ULP wake:   ulp_monitor_collect(&stats)      window summary, new window
+ *   any boot:   ulp_monitor_resume()             before esp_deep_sleep_start()
+ *
+ * The ULP keeps sampling while the main CPU runs; collect() stops its timer
+ * until resume(), so the window is not changed while it is read.
+ *
+ * Needs CONFIG_ULP_COPROC_ENABLED, CONFIG_ULP_COPROC_TYPE_RISCV and
+ * CONFIG_ULP_COPROC_RESERVE_MEM (4096 is plenty) in sdkconfig.defaults.
+ * tools/ulp_energy.py estimates the energy against plain timer wakes.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+#include "hal/adc_types.h"
+
+#include "ulp_sampler.h"
+
+#define ULP_MONITOR_PERIOD_DEFAULT_US   1000000
+#define ULP_MONITOR_BATCH_DEFAULT       300         /* 5 min at 1 s */
+
+/*
+ * Thresholds only, no batch wake. The window then ends at a threshold wake
+ * only; its 32-bit sum holds 2^20 readings of 12 bits (12 days at 1 s),
+ * after that the mean is wrong.
+ */
+#define ULP_MONITOR_BATCH_OFF           UINT16_MAX
+
+typedef struct {
+    adc_channel_t channel;          /* ADC1 channel */
+    adc_atten_t   atten;
+    uint32_t      period_us;        /* 0 -> ULP_MONITOR_PERIOD_DEFAULT_US */
+    uint16_t      low_raw;          /* 0 = no lower threshold */
+    uint16_t      high_raw;         /* 0 = no upper threshold */
+    uint16_t      hyst_raw;
+    uint16_t      batch;            /* 0 -> ULP_MONITOR_BATCH_DEFAULT,
+                                       ULP_MONITOR_BATCH_OFF = no batch wake */
+} ulp_monitor_config_t;
+
+typedef struct {
+    uint32_t wake;                  /* ULP_SAMPLER_WAKE_xxx */
+    uint32_t zone;                  /* ULP_SAMPLER_ZONE_xxx now */
+    uint32_t n;                     /* readings in the window */
+    uint16_t min, max, mean, last;  /* raw counts */
+    uint32_t runs;                  /* readings since start */
+} ulp_monitor_stats_t;
+
+/*
+ * Load the program and start the ULP timer (cold boot).
+ * ESP_ERR_INVALID_ARG if nothing would ever wake the main CPU (no
+ * threshold and ULP_MONITOR_BATCH_OFF).
+ */
+esp_err_t ulp_monitor_start(const ulp_monitor_config_t *cfg);
+
+/* True if this boot was requested by the ULP */
+bool ulp_monitor_woke_us(void);
+
+/* Stop the ULP timer, copy the window and start a new one */
+esp_err_t ulp_monitor_collect(ulp_monitor_stats_t *out);
+
+/* Let the ULP sample again and wake us (right before deep sleep) */
+esp_err_t ulp_monitor_resume(void);
+
+const char *ulp_monitor_wake_name(uint32_t wake);
@@ -0,0 +1,134 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: ULP sampling state machine (pure logic)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * The ULP RISC-V core runs ulp/ulp_sampler_main.c every period: one ADC
+ * reading, one ulp_sampler_step(). The main CPU stays in deep sleep until
+ * the step asks for it:
+ *
+ *   reading leaves [low, high]          -> WAKE_LOW / WAKE_HIGH
+ *   reading is back inside (hysteresis) -> WAKE_NORMAL
+ *   'batch' readings in the window      -> WAKE_BATCH
+ *
+ * Meanwhile min / max / sum of the window build up in RTC memory, so the
+ * main CPU gets a summary of every reading, not just the last one.
+ *
+ * This header is compiled three times: into the ULP program, into the main
+ * firmware (ulp_monitor.c) and on the host. tools/ulp_energy.py is its
+ * Python twin; host_test/test_ulp_sampler.c feeds both the same readings.
+ * Only 32-bit integer code, no IDF headers.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define ULP_SAMPLER_WAKE_NONE   0
+#define ULP_SAMPLER_WAKE_LOW    1
+#define ULP_SAMPLER_WAKE_HIGH   2
+#define ULP_SAMPLER_WAKE_NORMAL 3
+#define ULP_SAMPLER_WAKE_BATCH  4
+
+#define ULP_SAMPLER_ZONE_NORMAL 0
+#define ULP_SAMPLER_ZONE_LOW    1
+#define ULP_SAMPLER_ZONE_HIGH   2
+
+/* Shared between the cores: 32-bit words only */
+typedef struct {
+    /* set by the main CPU before the ULP starts */
+    uint32_t channel;       /* ADC1 channel */
+    uint32_t low;           /* raw counts, 0 = no lower threshold */
+    uint32_t high;          /* raw counts, UINT32_MAX = no upper threshold */
+    uint32_t hyst;          /* counts back inside before NORMAL */
+    uint32_t batch;         /* readings per window, 0 = no batch wake */
+
+    /* window since the main CPU collected it */
+    uint32_t n;
+    uint32_t min;
+    uint32_t max;
+    uint32_t sum;
+    uint32_t last;
+
+    uint32_t zone;          /* ULP_SAMPLER_ZONE_xxx of the last reading */
+    uint32_t wake;          /* pending ULP_SAMPLER_WAKE_xxx, first reason wins */
+    uint32_t busy;          /* ULP is inside its main() */
+    uint32_t runs;          /* readings since the ULP was started */
+} ulp_sampler_t;
+
+static inline uint32_t ulp_sampler_zone(const ulp_sampler_t *s, uint32_t v)
+{
+    if (v < s->low) {
+        return ULP_SAMPLER_ZONE_LOW;
+    }
+    if (v > s->high) {
+        return ULP_SAMPLER_ZONE_HIGH;
+    }
+    /* leaving LOW / HIGH needs 'hyst' counts of margin */
+    if (s->zone == ULP_SAMPLER_ZONE_LOW && v - s->low < s->hyst) {
+        return ULP_SAMPLER_ZONE_LOW;
+    }
+    if (s->zone == ULP_SAMPLER_ZONE_HIGH && s->high - v < s->hyst) {
+        return ULP_SAMPLER_ZONE_HIGH;
+    }
+    return ULP_SAMPLER_ZONE_NORMAL;
+}
+
+/* One reading; true when the main CPU has to be woken now */
+static inline bool ulp_sampler_step(ulp_sampler_t *s, uint32_t v)
+{
+    uint32_t reason = ULP_SAMPLER_WAKE_NONE;
+    uint32_t z = ulp_sampler_zone(s, v);
+
+    if (s->n == 0) {
+        s->min = v;
+        s->max = v;
+        s->sum = 0;
+    }
+    if (v < s->min) {
+        s->min = v;
+    }
+    if (v > s->max) {
+        s->max = v;
+    }
+    s->sum += v;
+    s->n++;
+    s->last = v;
+    s->runs++;
+
+    if (z != s->zone) {
+        reason = (z == ULP_SAMPLER_ZONE_LOW)  ? ULP_SAMPLER_WAKE_LOW :
+                 (z == ULP_SAMPLER_ZONE_HIGH) ? ULP_SAMPLER_WAKE_HIGH :
+                                                ULP_SAMPLER_WAKE_NORMAL;
+        s->zone = z;
+    } else if (s->batch && s->n >= s->batch) {
+        reason = ULP_SAMPLER_WAKE_BATCH;
+    }
+
+    if (reason == ULP_SAMPLER_WAKE_NONE || s->wake != ULP_SAMPLER_WAKE_NONE) {
+        return false;       /* nothing new, or the CPU is already on its way */
+    }
+    s->wake = reason;
+    return true;
+}
+
+/* Main CPU took the window: start a new one (zone is kept) */
+static inline void ulp_sampler_reset(ulp_sampler_t *s)
+{
+    s->n = 0;
+    s->sum = 0;
+    s->wake = ULP_SAMPLER_WAKE_NONE;
+}
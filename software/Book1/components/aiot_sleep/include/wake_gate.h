@@ -0,0 +1,70 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: boot-or-sleep decision of the wake stub (pure logic)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * The decision is made in the wake stub, which runs from RTC fast memory
+ * before flash is mapped. A normal function would be placed in flash, so
+ * the check is a forced inline: it ends up inside the stub's RTC code, and
+ * the same header can be compiled and checked on the host:
+ * host_test/test_wake_gate.c, cross-checked against WakeGate in
+ * tools/ulp_energy.py (which folds the re-arm of wake_stub_arm() into
+ * boot()).
+ */
+
+#pragma once
+
+#include <stdint.h>
+
+typedef enum {
+    WAKE_GATE_SLEEP = 0,        /* reading unchanged: straight back to sleep */
+    WAKE_GATE_BOOT_FIRST,       /* no reference yet (first stub wake) */
+    WAKE_GATE_BOOT_DELTA,       /* reading moved by >= delta */
+    WAKE_GATE_BOOT_HEARTBEAT,   /* heartbeat wakes without a boot */
+} wake_gate_verdict_t;
+
+typedef struct {
+    uint16_t delta;             /* raw counts */
+    uint16_t heartbeat;         /* boot at least every heartbeat-th wake, 0 = never */
+} wake_gate_config_t;
+
+typedef struct {
+    uint16_t ref;               /* reading that caused the last boot */
+    uint16_t have_ref;
+    uint32_t skipped;           /* wakes back to sleep since then */
+} wake_gate_state_t;
+
+/* One wake: SLEEP counts a skipped wake, any BOOT takes raw as new reference */
+static inline __attribute__((always_inline))
+wake_gate_verdict_t wake_gate_check(wake_gate_state_t *st, const wake_gate_config_t *cfg,
+                                    uint16_t raw)
+{
+    wake_gate_verdict_t v;
+    uint16_t diff = raw > st->ref ? (uint16_t)(raw - st->ref) : (uint16_t)(st->ref - raw);
+
+    if (!st->have_ref) {
+        v = WAKE_GATE_BOOT_FIRST;
+    } else if (diff >= cfg->delta) {
+        v = WAKE_GATE_BOOT_DELTA;
+    } else if (cfg->heartbeat && st->skipped + 1 >= cfg->heartbeat) {
+        v = WAKE_GATE_BOOT_HEARTBEAT;
+    } else {
+        st->skipped++;
+        return WAKE_GATE_SLEEP;
+    }
+    st->ref = raw;
+    st->have_ref = 1;
+    return v;
+}
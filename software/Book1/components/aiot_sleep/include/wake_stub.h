@@ -0,0 +1,88 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: deep sleep wake stub that samples the ADC
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * WHY A WAKE STUB?
+ * ----------------
+ * A timer wake from deep sleep is a reset: bootloader, loading the app
+ * image from flash, FreeRTOS start, app_main - a few hundred milliseconds
+ * before the first line of our code, and often only to find out that the
+ * sensor still reads the same value.
+ *
+ * The ROM runs a "wake stub" from RTC fast memory before all of that. This
+ * one reads ADC1 with a few register writes and compares the reading with
+ * the one that caused the last boot:
+ *
+ *   |raw - ref| <  delta, fewer than heartbeat wakes  -> re-arm timer, sleep
+ *   otherwise                                         -> normal boot
+ *
+ * A skipped wake costs about a millisecond instead of a boot plus a radio
+ * cycle. app_main learns through wake_stub_get_result() why it runs and
+ * how many wakes were skipped before.
+ *
+ * Limits of running before the app:
+ *  - Only RTC memory and ROM functions are available, no drivers, no log.
+ *  - The reading is an uncalibrated raw count of the RTC ADC controller.
+ *    It is only compared with other stub readings; 'delta' is in counts
+ *    (about 0.8 mV per count at 12 dB attenuation).
+ *  - The RTC peripheral power domain stays on in deep sleep, so the pad
+ *    configuration from wake_stub_arm() is still there (a few uA).
+ *  - Only timer wakes are gated, any other wake cause boots normally.
+ *
+ * Usage:
+ *
+ *   app_main:     wake_stub_get_result(&r)     r.valid: the stub decided
+ *   before sleep: wake_stub_arm(&cfg); esp_sleep_enable_timer_wakeup(...);
+ *                 esp_deep_sleep_start();
+ *
+ * ESP32-S3 only (SENS register layout of the RTC ADC controller).
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_err.h"
+#include "hal/adc_types.h"
+
+#include "wake_gate.h"
+
+#define WAKE_STUB_DELTA_DEFAULT      25     /* raw counts, ~20 mV at 12 dB */
+#define WAKE_STUB_HEARTBEAT_DEFAULT  10
+
+typedef struct {
+    adc_channel_t channel;          /* ADC1 channel */
+    adc_atten_t   atten;
+    uint16_t      delta_raw;        /* 0 -> WAKE_STUB_DELTA_DEFAULT */
+    uint16_t      heartbeat;        /* 0 -> WAKE_STUB_HEARTBEAT_DEFAULT, 1 = always boot */
+    uint64_t      period_us;        /* timer for a skipped wake (the app's sleep time) */
+} wake_stub_config_t;
+
+typedef struct {
+    bool                valid;      /* false: power-on, other wake cause, not armed */
+    wake_gate_verdict_t verdict;
+    uint16_t            raw;        /* stub reading that caused this boot */
+    uint32_t            skipped;    /* wakes that went back to sleep before it */
+} wake_stub_result_t;
+
+/* Why this boot happened (call early in app_main, before wake_stub_arm) */
+void wake_stub_get_result(wake_stub_result_t *out);
+
+/* Install the stub for the next deep sleep (right before esp_deep_sleep_start) */
+esp_err_t wake_stub_arm(const wake_stub_config_t *cfg);
+
+const char *wake_stub_verdict_name(wake_gate_verdict_t v);
@@ -0,0 +1,198 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: adaptive deep sleep interval (pure logic)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "sleep_sched.h"
+
+#define SLEEP_SCHED_MAGIC   0x53434844u     /* "SCHD" */
+#define EWMA_SHIFT          2               /* new value weighs 1/4 */
+
+/* config with the 0 -> default rules applied */
+typedef struct {
+    uint32_t min_s, max_s, start_s, grow_pct;
+} bounds_t;
+
+static bounds_t resolve(const sleep_sched_config_t *cfg)
+{
+    bounds_t b = {
+        .min_s = cfg->min_s ? cfg->min_s : SLEEP_SCHED_MIN_DEFAULT_S,
+        .max_s = cfg->max_s ? cfg->max_s : SLEEP_SCHED_MAX_DEFAULT_S,
+        .grow_pct = cfg->grow_pct ? cfg->grow_pct : SLEEP_SCHED_GROW_DEFAULT_PCT,
+    };
+    if (b.max_s < b.min_s) {
+        b.max_s = b.min_s;
+    }
+    b.start_s = cfg->start_s ? cfg->start_s : b.min_s;
+    if (b.start_s < b.min_s) {
+        b.start_s = b.min_s;
+    } else if (b.start_s > b.max_s) {
+        b.start_s = b.max_s;
+    }
+    return b;
+}
+
+static uint32_t sat32(uint64_t v)
+{
+    return v > UINT32_MAX ? UINT32_MAX : (uint32_t)v;
+}
+
+static uint32_t ewma(uint32_t avg, uint32_t v)
+{
+    if (v >= avg) {
+        return avg + ((v - avg) >> EWMA_SHIFT);
+    }
+    return avg - ((avg - v) >> EWMA_SHIFT);
+}
+
+void sleep_sched_init(sleep_sched_t *s, const sleep_sched_config_t *cfg)
+{
+    if (s->magic == SLEEP_SCHED_MAGIC) {
+        return;
+    }
+    memset(s, 0, sizeof(*s));
+    s->magic = SLEEP_SCHED_MAGIC;
+    s->interval_s = resolve(cfg).start_s;
+    s->limit = SLEEP_SCHED_START;
+}
+
+void sleep_sched_pin(sleep_sched_t *s, uint32_t sec)
+{
+    s->pinned_s = sec;
+    s->signal_s = 0;                    /* adaptive again: ramp from start_s */
+}
+
+/* ---- inputs ---- */
+
+static void fold_value(sleep_sched_t *s, const sleep_sched_input_t *in)
+{
+    if (s->readings > 0) {
+        /* clock did not move (not set, or same second): assume one interval */
+        uint32_t dt = in->now_s > s->t_last_s ? in->now_s - s->t_last_s : s->interval_s;
+        uint32_t d = (uint32_t)(in->value >= s->last_value
+                                ? (int64_t)in->value - s->last_value
+                                : (int64_t)s->last_value - in->value);
+        uint32_t r = sat32((uint64_t)d * 1000u / (dt ? dt : 1));
+
+        /* a jump counts at once, calm has to prove itself */
+        s->rate_k = (s->readings == 1 || r > s->rate_k) ? r : ewma(s->rate_k, r);
+    }
+    s->last_value = in->value;
+    s->t_last_s = in->now_s;
+    if (s->readings < UINT32_MAX) {
+        s->readings++;
+    }
+}
+
+static void fold_awake(sleep_sched_t *s, uint32_t awake_ms)
+{
+    s->awake_ms = s->awake_ms ? ewma(s->awake_ms, awake_ms) : awake_ms;
+}
+
+/* ---- rules ---- */
+
+uint32_t sleep_sched_update(sleep_sched_t *s, const sleep_sched_config_t *cfg,
+                            const sleep_sched_input_t *in)
+{
+    bounds_t b = resolve(cfg);
+    uint32_t t = b.start_s;
+    sleep_sched_limit_t lim = SLEEP_SCHED_START;
+
+    s->wakes++;
+    if (in->has_value) {
+        fold_value(s, in);
+    }
+    if (in->awake_ms) {
+        fold_awake(s, in->awake_ms);
+    }
+
+    /* signal: time for the reading to move by 'change' */
+    if (cfg->change && s->readings >= 2) {
+        uint32_t prev = s->signal_s ? s->signal_s : b.start_s;
+        uint32_t want = s->rate_k ? sat32((uint64_t)cfg->change * 1000u / s->rate_k) : b.max_s;
+        uint32_t cap = sat32((uint64_t)prev * b.grow_pct / 100u);
+
+        if (cap <= prev) {
+            cap = prev + 1;             /* grow_pct <= 100 still creeps up */
+        }
+        if (want > cap && cap < b.max_s) {
+            t = cap;
+            lim = SLEEP_SCHED_RAMP;
+        } else {
+            t = want;
+            lim = SLEEP_SCHED_SIGNAL;
+        }
+        s->signal_s = t < b.min_s ? b.min_s : (t > b.max_s ? b.max_s : t);
+    }
+
+    if (s->pinned_s) {
+        s->interval_s = s->pinned_s;
+        s->limit = SLEEP_SCHED_PINNED;
+        return s->interval_s;
+    }
+
+    /* cost: one wake's charge (mA x ms = uAs) spread over the interval */
+    if (cfg->awake_ma && s->awake_ms) {
+        uint32_t t_cost = b.max_s;
+        if (cfg->budget_ua > cfg->sleep_ua) {
+            t_cost = sat32((uint64_t)s->awake_ms * cfg->awake_ma /
+                           (cfg->budget_ua - cfg->sleep_ua));
+        }
+        if (t_cost > t) {
+            t = t_cost;
+            lim = SLEEP_SCHED_COST;
+        }
+    }
+
+    /* battery: stretch below ok, longest interval at low */
+    if (cfg->batt_ok_mv && in->batt_mv && in->batt_mv < cfg->batt_ok_mv) {
+        if (in->batt_mv <= cfg->batt_low_mv || cfg->batt_ok_mv <= cfg->batt_low_mv) {
+            t = b.max_s;
+        } else {
+            uint32_t span = cfg->batt_ok_mv - cfg->batt_low_mv;
+            uint32_t drop = cfg->batt_ok_mv - in->batt_mv;
+            t = sat32((uint64_t)t * (span + (SLEEP_SCHED_BATT_STRETCH - 1) * drop) / span);
+        }
+        lim = SLEEP_SCHED_BATTERY;
+    }
+
+    if (t < b.min_s) {
+        t = b.min_s;
+        lim = SLEEP_SCHED_MIN;
+    } else if (t > b.max_s) {
+        t = b.max_s;
+        lim = SLEEP_SCHED_MAX;
+    }
+
+    s->interval_s = t;
+    s->limit = (uint8_t)lim;
+    return t;
+}
+
+const char *sleep_sched_limit_name(sleep_sched_limit_t l)
+{
+    switch (l) {
+        case SLEEP_SCHED_START:   return "start";
+        case SLEEP_SCHED_SIGNAL:  return "signal";
+        case SLEEP_SCHED_RAMP:    return "ramp";
+        case SLEEP_SCHED_COST:    return "cost";
+        case SLEEP_SCHED_BATTERY: return "battery";
+        case SLEEP_SCHED_MIN:     return "min";
+        case SLEEP_SCHED_MAX:     return "max";
+        case SLEEP_SCHED_PINNED:  return "pinned";
+        default:                  return "?";
+    }
+}
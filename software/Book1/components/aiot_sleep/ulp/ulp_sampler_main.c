@@ -0,0 +1,43 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: ULP RISC-V program, one ADC reading per period
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * Runs on the ULP core, started by the ULP timer every period. Returning
+ * from main() halts the core until the next period. The main CPU sees
+ * 'shared' as ulp_shared (ulp_sampler_app.h).
+ */
+
+#include <stdint.h>
+
+#include "ulp_riscv_utils.h"
+#include "ulp_riscv_adc_ulp_core.h"
+
+#include "ulp_sampler.h"
+
+volatile ulp_sampler_t shared;
+
+int main(void)
+{
+    shared.busy = 1;
+
+    int32_t raw = ulp_riscv_adc_read_channel(ADC_UNIT_1, (int)shared.channel);
+    if (raw >= 0 && ulp_sampler_step((ulp_sampler_t *)&shared, (uint32_t)raw)) {
+        ulp_riscv_wakeup_main_processor();
+    }
+
+    shared.busy = 0;
+    return 0;
+}
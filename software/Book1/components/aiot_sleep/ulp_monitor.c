@@ -0,0 +1,149 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: ADC sampling on the ULP core, main CPU side
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "esp_rom_sys.h"
+#include "ulp_common.h"
+#include "ulp_riscv.h"
+#include "ulp_riscv_adc.h"
+
+#include "ulp_monitor.h"
+#include "ulp_sampler_app.h"        /* generated: ulp_shared */
+
+static const char *TAG = "ULP_MON";
+
+#define ULP_IDLE_WAIT_US    5000    /* one ULP run is ~100s of us */
+
+extern const uint8_t ulp_bin_start[] asm("_binary_ulp_sampler_app_bin_start");
+extern const uint8_t ulp_bin_end[]   asm("_binary_ulp_sampler_app_bin_end");
+
+static volatile ulp_sampler_t *shared(void)
+{
+    return (volatile ulp_sampler_t *)&ulp_shared;
+}
+
+/* config -> ulp_sampler_t.batch, where 0 means no batch wake */
+static uint32_t sampler_batch(const ulp_monitor_config_t *cfg)
+{
+    if (cfg->batch == ULP_MONITOR_BATCH_OFF) {
+        return 0;
+    }
+    return cfg->batch ? cfg->batch : ULP_MONITOR_BATCH_DEFAULT;
+}
+
+esp_err_t ulp_monitor_start(const ulp_monitor_config_t *cfg)
+{
+    esp_err_t err;
+
+    if (!cfg) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!sampler_batch(cfg) && !cfg->low_raw && !cfg->high_raw) {
+        ESP_LOGE(TAG, "no threshold and no batch: the ULP would never wake us");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    ulp_riscv_adc_cfg_t adc = {
+        .adc_n = ADC_UNIT_1,
+        .channel = cfg->channel,
+        .atten = cfg->atten,
+        .width = ADC_BITWIDTH_12,
+        .ulp_mode = ADC_ULP_MODE_RISCV,
+    };
+    err = ulp_riscv_adc_init(&adc);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ULP ADC init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    err = ulp_riscv_load_binary(ulp_bin_start, ulp_bin_end - ulp_bin_start);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "ULP load failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    /* program loaded: its .bss is zero, fill in the configuration */
+    volatile ulp_sampler_t *s = shared();
+    s->channel = (uint32_t)cfg->channel;
+    s->low = cfg->low_raw;
+    s->high = cfg->high_raw ? cfg->high_raw : UINT32_MAX;
+    s->hyst = cfg->hyst_raw;
+    s->batch = sampler_batch(cfg);
+
+    ulp_set_wakeup_period(0, cfg->period_us ? cfg->period_us : ULP_MONITOR_PERIOD_DEFAULT_US);
+    err = ulp_riscv_run();
+    if (err != ESP_OK) {
+        return err;
+    }
+    ESP_LOGI(TAG, "ULP sampling ADC1 ch %d, window %lu%s, thresholds %u..%u",
+             (int)cfg->channel, (unsigned long)s->batch, s->batch ? "" : " (no batch wake)",
+             (unsigned)cfg->low_raw, (unsigned)cfg->high_raw);
+    return esp_sleep_enable_ulp_wakeup();
+}
+
+bool ulp_monitor_woke_us(void)
+{
+    return esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_ULP;
+}
+
+esp_err_t ulp_monitor_collect(ulp_monitor_stats_t *out)
+{
+    volatile ulp_sampler_t *s = shared();
+
+    /* no new run starts; let a running one finish */
+    ulp_riscv_timer_stop();
+    for (int t = 0; s->busy && t < ULP_IDLE_WAIT_US; t += 10) {
+        esp_rom_delay_us(10);
+    }
+    if (s->busy) {
+        ESP_LOGW(TAG, "ULP still busy, window may be torn");
+    }
+
+    memset(out, 0, sizeof(*out));
+    out->wake = s->wake;
+    out->zone = s->zone;
+    out->n = s->n;
+    out->runs = s->runs;
+    if (s->n) {
+        out->min = (uint16_t)s->min;
+        out->max = (uint16_t)s->max;
+        out->mean = (uint16_t)(s->sum / s->n);
+        out->last = (uint16_t)s->last;
+    }
+    ulp_sampler_reset((ulp_sampler_t *)s);
+    return ESP_OK;
+}
+
+esp_err_t ulp_monitor_resume(void)
+{
+    ulp_riscv_timer_resume();
+    return esp_sleep_enable_ulp_wakeup();
+}
+
+const char *ulp_monitor_wake_name(uint32_t wake)
+{
+    switch (wake) {
+        case ULP_SAMPLER_WAKE_NONE:   return "none";
+        case ULP_SAMPLER_WAKE_LOW:    return "low";
+        case ULP_SAMPLER_WAKE_HIGH:   return "high";
+        case ULP_SAMPLER_WAKE_NORMAL: return "normal";
+        case ULP_SAMPLER_WAKE_BATCH:  return "batch";
+        default:                      return "?";
+    }
+}
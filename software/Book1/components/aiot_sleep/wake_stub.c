@@ -0,0 +1,188 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Shared component: deep sleep wake stub that samples the ADC
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <string.h>
+#include <stdbool.h>
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_attr.h"
+#include "esp_sleep.h"
+#include "esp_wake_stub.h"
+#include "esp_rom_sys.h"
+#include "soc/soc.h"
+#include "soc/rtc.h"
+#include "soc/sens_reg.h"
+#include "driver/rtc_io.h"
+#include "esp_adc/adc_oneshot.h"
+
+#include "wake_stub.h"
+
+#if !CONFIG_IDF_TARGET_ESP32S3
+#error "wake_stub.c drives the ESP32-S3 RTC ADC registers directly"
+#endif
+
+static const char *TAG = "WAKE_STUB";
+
+#define WAKE_STUB_MAGIC     0x57535442u     /* "WSTB" */
+
+#define STUB_ADC_SAMPLES    8               /* averaged per wake (power of 2) */
+#define STUB_ADC_SETTLE_US  40              /* SAR power-up before the first sample */
+#define STUB_ADC_SPIN_MAX   10000           /* done-bit polls before giving up */
+#define STUB_FORCE_XPD_PU   3               /* SENS_FORCE_XPD_SAR: forced on */
+
+typedef struct {
+    uint32_t           magic;
+    uint8_t            channel;
+    uint8_t            atten;
+    wake_gate_config_t gate;
+    uint64_t           period_us;
+    wake_gate_state_t  state;
+    uint8_t            verdict;     /* decision before the last boot, SLEEP = none */
+    uint16_t           raw;
+} wake_stub_rtc_t;
+
+/* everything the stub touches must be in RTC memory */
+static RTC_DATA_ATTR wake_stub_rtc_t s_rtc;
+
+/* ---- runs before the bootloader: RTC code, RTC data and ROM only ---- */
+
+/* UINT16_MAX if a conversion never finished */
+static uint16_t RTC_IRAM_ATTR stub_adc_read(uint32_t channel, uint32_t atten)
+{
+    uint32_t sum = 0;
+    bool ok = true;
+
+    /* SAR1 clock and power on, RTC controller owns it, one pad, attenuation */
+    SET_PERI_REG_MASK(SENS_SAR_PERI_CLK_GATE_CONF_REG, SENS_SARADC_CLK_EN);
+    REG_SET_FIELD(SENS_SAR_POWER_XPD_SAR_REG, SENS_FORCE_XPD_SAR, STUB_FORCE_XPD_PU);
+    CLEAR_PERI_REG_MASK(SENS_SAR_MEAS1_MUX_REG, SENS_SAR1_DIG_FORCE);
+    SET_PERI_REG_MASK(SENS_SAR_MEAS1_CTRL2_REG, SENS_MEAS1_START_FORCE | SENS_SAR1_EN_PAD_FORCE);
+    REG_SET_FIELD(SENS_SAR_MEAS1_CTRL2_REG, SENS_SAR1_EN_PAD, 1u << channel);
+    REG_WRITE(SENS_SAR_ATTEN1_REG,
+              (REG_READ(SENS_SAR_ATTEN1_REG) & ~(3u << (channel * 2))) | (atten << (channel * 2)));
+    esp_rom_delay_us(STUB_ADC_SETTLE_US);
+
+    for (int i = 0; i < STUB_ADC_SAMPLES && ok; i++) {
+        uint32_t spin = 0;
+
+        CLEAR_PERI_REG_MASK(SENS_SAR_MEAS1_CTRL2_REG, SENS_MEAS1_START_SAR);
+        SET_PERI_REG_MASK(SENS_SAR_MEAS1_CTRL2_REG, SENS_MEAS1_START_SAR);
+        while (!REG_GET_FIELD(SENS_SAR_MEAS1_CTRL2_REG, SENS_MEAS1_DONE_SAR)) {
+            if (++spin == STUB_ADC_SPIN_MAX) {
+                ok = false;
+                break;
+            }
+        }
+        sum += REG_GET_FIELD(SENS_SAR_MEAS1_CTRL2_REG, SENS_MEAS1_DATA_SAR);
+    }
+
+    /* SAR off again: it must not stay powered through the next sleep */
+    REG_SET_FIELD(SENS_SAR_POWER_XPD_SAR_REG, SENS_FORCE_XPD_SAR, 0);
+    CLEAR_PERI_REG_MASK(SENS_SAR_PERI_CLK_GATE_CONF_REG, SENS_SARADC_CLK_EN);
+
+    return ok ? (uint16_t)(sum / STUB_ADC_SAMPLES) : UINT16_MAX;
+}
+
+static void RTC_IRAM_ATTR wake_stub(void)
+{
+    esp_default_wake_deep_sleep();
+
+    if (s_rtc.magic != WAKE_STUB_MAGIC ||
+        !(esp_wake_stub_get_wakeup_cause() & RTC_TIMER_TRIG_EN)) {
+        return;                                 /* boot, app_main sorts it out */
+    }
+
+    uint16_t raw = stub_adc_read(s_rtc.channel, s_rtc.atten);
+    if (raw == UINT16_MAX) {
+        return;                                 /* ADC did not answer: let the app try */
+    }
+
+    wake_gate_verdict_t v = wake_gate_check(&s_rtc.state, &s_rtc.gate, raw);
+    s_rtc.raw = raw;
+    if (v == WAKE_GATE_SLEEP) {
+        esp_wake_stub_set_wakeup_time(s_rtc.period_us);
+        esp_wake_stub_sleep(&wake_stub);        /* does not return */
+    }
+    s_rtc.verdict = (uint8_t)v;
+}
+
+/* ---- app side ---- */
+
+void wake_stub_get_result(wake_stub_result_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (s_rtc.magic != WAKE_STUB_MAGIC ||
+        esp_sleep_get_wakeup_cause() != ESP_SLEEP_WAKEUP_TIMER ||
+        s_rtc.verdict == WAKE_GATE_SLEEP) {
+        return;
+    }
+    out->valid = true;
+    out->verdict = (wake_gate_verdict_t)s_rtc.verdict;
+    out->raw = s_rtc.raw;
+    out->skipped = s_rtc.state.skipped;
+}
+
+esp_err_t wake_stub_arm(const wake_stub_config_t *cfg)
+{
+    int io = -1;
+
+    if (!cfg || cfg->period_us == 0 ||
+        adc_oneshot_channel_to_io(ADC_UNIT_1, cfg->channel, &io) != ESP_OK) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    /* pad stays analog through deep sleep: RTC peripherals keep power */
+    esp_err_t err = rtc_gpio_init(io);
+    if (err == ESP_OK) {
+        rtc_gpio_set_direction(io, RTC_GPIO_MODE_DISABLED);
+        rtc_gpio_pullup_dis(io);
+        rtc_gpio_pulldown_dis(io);
+        err = esp_sleep_pd_config(ESP_PD_DOMAIN_RTC_PERIPH, ESP_PD_OPTION_ON);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Pad / power domain setup failed: %s", esp_err_to_name(err));
+        return err;
+    }
+
+    if (s_rtc.magic != WAKE_STUB_MAGIC) {
+        memset(&s_rtc, 0, sizeof(s_rtc));       /* power-on: first stub wake boots */
+        s_rtc.magic = WAKE_STUB_MAGIC;
+    }
+    s_rtc.channel = (uint8_t)cfg->channel;
+    s_rtc.atten = (uint8_t)cfg->atten;
+    s_rtc.gate.delta = cfg->delta_raw ? cfg->delta_raw : WAKE_STUB_DELTA_DEFAULT;
+    s_rtc.gate.heartbeat = cfg->heartbeat ? cfg->heartbeat : WAKE_STUB_HEARTBEAT_DEFAULT;
+    s_rtc.period_us = cfg->period_us;
+    s_rtc.state.skipped = 0;
+    s_rtc.verdict = WAKE_GATE_SLEEP;
+
+    esp_set_deep_sleep_wake_stub(&wake_stub);
+    ESP_LOGI(TAG, "Armed: ADC1 ch %d, delta %u, heartbeat %u",
+             (int)cfg->channel, (unsigned)s_rtc.gate.delta, (unsigned)s_rtc.gate.heartbeat);
+    return ESP_OK;
+}
+
+const char *wake_stub_verdict_name(wake_gate_verdict_t v)
+{
+    switch (v) {
+        case WAKE_GATE_SLEEP:          return "sleep";
+        case WAKE_GATE_BOOT_FIRST:     return "first";
+        case WAKE_GATE_BOOT_DELTA:     return "delta";
+        case WAKE_GATE_BOOT_HEARTBEAT: return "heartbeat";
+        default:                       return "?";
+    }
+}
@@ -0,0 +1,75 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host benchmark: float vs. fixed-point IMU filter path (make bench)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "dsp_bench.h"
+
+/* same settings as AIoT_I2C_Real_Sensor in FIFO mode */
+#define BENCH_SAMPLES   100000
+#define BENCH_CUTOFF_HZ 1.0f
+#define BENCH_RATE_HZ   1000.0f
+
+static uint32_t clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/* TSC: reference cycles, close to core cycles without frequency scaling */
+static uint32_t clock_tsc(void)
+{
+    return (uint32_t)__rdtsc();
+}
+#endif
+
+static void report(const char *unit, const dsp_bench_result_t *r)
+{
+    printf("  float %6lu %s/sample   fixed %6lu %s/sample   max |diff| %ld\n",
+           (unsigned long)r->float_ticks, unit, (unsigned long)r->fixed_ticks, unit,
+           (long)r->max_diff);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t samples = argc > 1 ? (uint32_t)strtoul(argv[1], NULL, 0) : BENCH_SAMPLES;
+    dsp_bench_result_t r;
+
+    if (samples == 0) {
+        fprintf(stderr, "usage: %s [samples]\n", argv[0]);
+        return 2;
+    }
+    printf("DSP bench: %lu 6-axis samples, median-of-3 + IIR %.1f Hz @ %.0f Hz + scaling\n",
+           (unsigned long)samples, BENCH_CUTOFF_HZ, BENCH_RATE_HZ);
+
+    /* warm-up run: caches, page faults, CPU clock ramp */
+    dsp_bench_run(clock_ns, samples, BENCH_CUTOFF_HZ, BENCH_RATE_HZ, &r);
+
+    dsp_bench_run(clock_ns, samples, BENCH_CUTOFF_HZ, BENCH_RATE_HZ, &r);
+    report("ns", &r);
+#if defined(__x86_64__) || defined(__i386__)
+    dsp_bench_run(clock_tsc, samples, BENCH_CUTOFF_HZ, BENCH_RATE_HZ, &r);
+    report("tsc", &r);
+#endif
+    return 0;
+}
@@ -0,0 +1,85 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host tests: minimal check macros
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * One test program per component, every test a function:
+ *
+ *   static void test_wraps(void) { CHECK_EQ(ring_count(&r), 3); }
+ *   int main(void) { RUN(test_wraps); return check_done(); }
+ *
+ * A failed check prints file:line and the values, the test goes on so one
+ * run shows all failures. Exit code != 0 if anything failed.
+ */
+
+#pragma once
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int s_check_failed;
+static int s_check_count;
+
+#define CHECK(cond) do {                                                    \
+    s_check_count++;                                                        \
+    if (!(cond)) {                                                          \
+        s_check_failed++;                                                   \
+        fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+    }                                                                       \
+} while (0)
+
+#define CHECK_EQ(a, b) do {                                                 \
+    long long _a = (long long)(a), _b = (long long)(b);                     \
+    s_check_count++;                                                        \
+    if (_a != _b) {                                                         \
+        s_check_failed++;                                                   \
+        fprintf(stderr, "%s:%d: %s == %s failed (%lld != %lld)\n",          \
+                __FILE__, __LINE__, #a, #b, _a, _b);                        \
+    }                                                                       \
+} while (0)
+
+#define CHECK_STR(a, b) do {                                                \
+    const char *_a = (a), *_b = (b);                                        \
+    s_check_count++;                                                        \
+    if (strcmp(_a, _b) != 0) {                                              \
+        s_check_failed++;                                                   \
+        fprintf(stderr, "%s:%d: \"%s\" != \"%s\"\n", __FILE__, __LINE__, _a, _b); \
+    }                                                                       \
+} while (0)
+
+#define RUN(fn) do {                                                        \
+    int _before = s_check_failed;                                           \
+    fn();                                                                   \
+    printf("  %-40s %s\n", #fn, s_check_failed == _before ? "ok" : "FAILED"); \
+} while (0)
+
+static inline int check_done(void)
+{
+    printf("%d checks, %d failed\n", s_check_count, s_check_failed);
+    return s_check_failed ? 1 : 0;
+}
+
+/* Reproducible pseudo random numbers for fuzz loops (xorshift32) */
+static inline uint32_t check_rand(uint32_t *state)
+{
+    uint32_t x = *state ? *state : 0x12345678u;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
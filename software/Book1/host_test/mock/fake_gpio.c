@@ -0,0 +1,354 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host tests: simulated GPIO pins and PCNT units
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "fake_gpio.h"
+
+typedef struct {
+    int             level;          /* read by other threads: atomics */
+    gpio_int_type_t intr;
+    gpio_isr_t      isr;
+    void           *arg;
+} fake_pin_t;
+
+struct pcnt_unit_t {
+    bool used;
+    bool enabled;
+    bool running;
+    bool accum;
+    int  high_limit;
+    int  count;
+};
+
+struct pcnt_chan_t {
+    bool                used;
+    struct pcnt_unit_t *unit;
+    int                 gpio;
+    bool                count_rising;
+};
+
+fake_gpio_t g_fake_gpio;
+static fake_pin_t         s_pins[FAKE_GPIO_PINS];
+static bool               s_isr_service;
+static struct pcnt_unit_t s_units[FAKE_PCNT_UNITS];
+static struct pcnt_chan_t s_chans[FAKE_PCNT_UNITS];
+
+void fake_gpio_reset(void)
+{
+    memset(&g_fake_gpio, 0, sizeof(g_fake_gpio));
+    for (int i = 0; i < FAKE_PCNT_UNITS; i++) {
+        g_fake_gpio.live_units += s_units[i].used;
+        g_fake_gpio.enabled_units += s_units[i].enabled;
+        g_fake_gpio.live_channels += s_chans[i].used;
+    }
+}
+
+static bool valid(gpio_num_t gpio)
+{
+    return gpio >= 0 && gpio < FAKE_GPIO_PINS;
+}
+
+/* ---- pins ---- */
+
+esp_err_t gpio_config(const gpio_config_t *cfg)
+{
+    if (!cfg || !cfg->pin_bit_mask || (cfg->pin_bit_mask >> FAKE_GPIO_PINS)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < FAKE_GPIO_PINS; i++) {
+        if (cfg->pin_bit_mask & (1ULL << i)) {
+            s_pins[i].intr = cfg->intr_type;
+        }
+    }
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio)
+{
+    return valid(gpio) ? __atomic_load_n(&s_pins[gpio].level, __ATOMIC_ACQUIRE) : 0;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio, uint32_t level)
+{
+    if (!valid(gpio)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    fake_gpio_set(gpio, level ? 1 : 0);
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t gpio, gpio_pull_mode_t pull)
+{
+    (void)pull;
+    return valid(gpio) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_install_isr_service(int intr_alloc_flags)
+{
+    (void)intr_alloc_flags;
+    if (s_isr_service) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_isr_service = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t gpio, gpio_isr_t isr, void *arg)
+{
+    if (!s_isr_service) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!valid(gpio) || !isr) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (g_fake_gpio.fail_isr_add != ESP_OK) {
+        return g_fake_gpio.fail_isr_add;
+    }
+    s_pins[gpio].arg = arg;
+    s_pins[gpio].isr = isr;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t gpio)
+{
+    if (!valid(gpio)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_pins[gpio].isr = NULL;
+    return ESP_OK;
+}
+
+void fake_gpio_set(gpio_num_t gpio, int level)
+{
+    if (!valid(gpio)) {
+        return;
+    }
+    fake_pin_t *p = &s_pins[gpio];
+    int old = __atomic_exchange_n(&p->level, level ? 1 : 0, __ATOMIC_ACQ_REL);
+    if (old == (level ? 1 : 0) || !p->isr) {
+        return;
+    }
+
+    bool fire = p->intr == GPIO_INTR_ANYEDGE ||
+                (p->intr == GPIO_INTR_POSEDGE && level) ||
+                (p->intr == GPIO_INTR_NEGEDGE && !level);
+    if (fire) {
+        p->isr(p->arg);
+    }
+}
+
+/* ---- PCNT ---- */
+
+static esp_err_t pcnt_step(void)
+{
+    host_critical_enter();
+    uint32_t n = ++g_fake_gpio.pcnt_calls;
+    host_critical_exit();
+    return n == g_fake_gpio.fail_pcnt_call ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t pcnt_new_unit(const pcnt_unit_config_t *cfg, pcnt_unit_handle_t *out)
+{
+    if (!cfg || !out || cfg->low_limit >= 0 || cfg->high_limit <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (pcnt_step() != ESP_OK) {
+        return ESP_FAIL;
+    }
+    for (int i = 0; i < FAKE_PCNT_UNITS; i++) {
+        struct pcnt_unit_t *u = &s_units[i];
+        if (!u->used) {
+            *u = (struct pcnt_unit_t){
+                .used = true,
+                .accum = cfg->flags.accum_count,
+                .high_limit = cfg->high_limit,
+            };
+            g_fake_gpio.live_units++;
+            *out = u;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;           /* all units in use, as on the target */
+}
+
+esp_err_t pcnt_del_unit(pcnt_unit_handle_t unit)
+{
+    if (!unit || !unit->used) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < FAKE_PCNT_UNITS; i++) {
+        if (s_chans[i].used && s_chans[i].unit == unit) {
+            return ESP_ERR_INVALID_STATE;   /* channels first */
+        }
+    }
+    if (unit->enabled) {
+        return ESP_ERR_INVALID_STATE;       /* disable first */
+    }
+    unit->used = false;
+    g_fake_gpio.live_units--;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_set_glitch_filter(pcnt_unit_handle_t unit, const pcnt_glitch_filter_config_t *cfg)
+{
+    if (!unit || unit->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (cfg && cfg->max_glitch_ns > 12787) {  /* 1023 APB cycles */
+        return ESP_ERR_INVALID_ARG;
+    }
+    return pcnt_step();
+}
+
+esp_err_t pcnt_new_channel(pcnt_unit_handle_t unit, const pcnt_chan_config_t *cfg,
+                           pcnt_channel_handle_t *out)
+{
+    if (!unit || !cfg || !out || unit->enabled) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (pcnt_step() != ESP_OK) {
+        return ESP_FAIL;
+    }
+    for (int i = 0; i < FAKE_PCNT_UNITS; i++) {
+        struct pcnt_chan_t *c = &s_chans[i];
+        if (!c->used) {
+            *c = (struct pcnt_chan_t){ .used = true, .unit = unit, .gpio = cfg->edge_gpio_num };
+            g_fake_gpio.live_channels++;
+            *out = c;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t pcnt_del_channel(pcnt_channel_handle_t chan)
+{
+    if (!chan || !chan->used || chan->unit->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    chan->used = false;
+    g_fake_gpio.live_channels--;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_channel_set_edge_action(pcnt_channel_handle_t chan,
+                                       pcnt_channel_edge_action_t pos_act,
+                                       pcnt_channel_edge_action_t neg_act)
+{
+    (void)neg_act;
+    if (!chan) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = pcnt_step();
+    if (err == ESP_OK) {
+        chan->count_rising = pos_act == PCNT_CHANNEL_EDGE_ACTION_INCREASE;
+    }
+    return err;
+}
+
+esp_err_t pcnt_unit_add_watch_point(pcnt_unit_handle_t unit, int watch_point)
+{
+    if (!unit || watch_point > unit->high_limit) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return pcnt_step();
+}
+
+esp_err_t pcnt_unit_enable(pcnt_unit_handle_t unit)
+{
+    if (!unit || unit->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = pcnt_step();
+    if (err == ESP_OK) {
+        unit->enabled = true;
+        g_fake_gpio.enabled_units++;
+    }
+    return err;
+}
+
+esp_err_t pcnt_unit_disable(pcnt_unit_handle_t unit)
+{
+    if (!unit || !unit->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    unit->enabled = false;
+    unit->running = false;
+    g_fake_gpio.enabled_units--;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_start(pcnt_unit_handle_t unit)
+{
+    if (!unit || !unit->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t err = pcnt_step();
+    if (err == ESP_OK) {
+        unit->running = true;
+    }
+    return err;
+}
+
+esp_err_t pcnt_unit_stop(pcnt_unit_handle_t unit)
+{
+    if (!unit || !unit->enabled) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    unit->running = false;
+    return ESP_OK;
+}
+
+esp_err_t pcnt_unit_clear_count(pcnt_unit_handle_t unit)
+{
+    if (!unit) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t err = pcnt_step();
+    if (err == ESP_OK) {
+        host_critical_enter();
+        unit->count = 0;
+        host_critical_exit();
+    }
+    return err;
+}
+
+esp_err_t pcnt_unit_get_count(pcnt_unit_handle_t unit, int *value)
+{
+    if (!unit || !value) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    host_critical_enter();
+    *value = unit->count;
+    host_critical_exit();
+    return ESP_OK;
+}
+
+/* without accum_count the 16 bit counter starts over at the high limit */
+void fake_gpio_pulses(gpio_num_t gpio, int n)
+{
+    host_critical_enter();
+    for (int i = 0; i < FAKE_PCNT_UNITS; i++) {
+        struct pcnt_chan_t *c = &s_chans[i];
+        if (c->used && c->gpio == gpio && c->count_rising && c->unit->running) {
+            struct pcnt_unit_t *u = c->unit;
+            u->count = u->accum ? u->count + n : (u->count + n) % u->high_limit;
+        }
+    }
+    host_critical_exit();
+}
@@ -0,0 +1,60 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host tests: simulated GPIO pins and PCNT units
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * The driver/gpio.h and driver/pulse_cnt.h functions for the host:
+ *  - fake_gpio_set() changes a pin level and runs its ISR handler right in
+ *    the calling thread, the way the GPIO ISR service would
+ *  - fake_gpio_pulses() feeds rising edges to the PCNT unit watching a pin
+ *
+ * Every PCNT call that can fail is numbered, fail_pcnt_call makes the n-th
+ * one fail, so each step of a setup sequence can be broken in turn. The
+ * live counters show what was not deleted/disabled again.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "driver/gpio.h"
+#include "driver/pulse_cnt.h"
+
+#define FAKE_GPIO_PINS      49      /* ESP32-S3 GPIO0..48 */
+#define FAKE_PCNT_UNITS     4
+
+typedef struct {
+    /* error injection (0 / ESP_OK = off) */
+    uint32_t  pcnt_calls;           /* failable PCNT calls so far */
+    uint32_t  fail_pcnt_call;       /* 1-based number of the call that fails */
+    esp_err_t fail_isr_add;
+
+    /* driver objects not yet deleted */
+    int       live_units;
+    int       live_channels;
+    int       enabled_units;
+} fake_gpio_t;
+
+extern fake_gpio_t g_fake_gpio;
+
+/* clear counters and error injection (pins and units stay) */
+void fake_gpio_reset(void);
+
+/* new level; an edge runs the ISR handler of the pin (if any) */
+void fake_gpio_set(gpio_num_t gpio, int level);
+
+/* n rising edges for the PCNT channels on this pin */
+void fake_gpio_pulses(gpio_num_t gpio, int n);
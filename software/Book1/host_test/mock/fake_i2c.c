@@ -0,0 +1,247 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host tests: simulated I2C bus (i2c_bus backend and i2c_master driver)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fake_i2c.h"
+
+typedef struct {
+    bool             used;
+    uint8_t          addr;
+    uint8_t          regs[256];
+    uint8_t          reg_ptr;
+    mock_mpu6050_t  *mpu;
+} fake_dev_t;
+
+fake_i2c_t g_fake_i2c;
+static fake_dev_t s_devs[FAKE_I2C_MAX_DEVICES];
+
+void fake_i2c_reset(void)
+{
+    memset(&g_fake_i2c, 0, sizeof(g_fake_i2c));
+    memset(s_devs, 0, sizeof(s_devs));
+}
+
+static fake_dev_t *find(uint8_t addr)
+{
+    for (int i = 0; i < FAKE_I2C_MAX_DEVICES; i++) {
+        if (s_devs[i].used && s_devs[i].addr == addr) {
+            return &s_devs[i];
+        }
+    }
+    return NULL;
+}
+
+static fake_dev_t *plug(uint8_t addr)
+{
+    fake_dev_t *d = find(addr);
+    for (int i = 0; !d && i < FAKE_I2C_MAX_DEVICES; i++) {
+        if (!s_devs[i].used) {
+            d = &s_devs[i];
+        }
+    }
+    if (!d) {
+        abort();        /* more devices than the test can need */
+    }
+    memset(d, 0, sizeof(*d));
+    d->used = true;
+    d->addr = addr;
+    return d;
+}
+
+void fake_i2c_add(uint8_t addr, uint8_t id_reg, uint8_t id_val)
+{
+    plug(addr)->regs[id_reg] = id_val;
+}
+
+void fake_i2c_add_mpu(uint8_t addr, mock_mpu6050_t *m)
+{
+    plug(addr)->mpu = m;
+}
+
+void fake_i2c_remove(uint8_t addr)
+{
+    fake_dev_t *d = find(addr);
+    if (d) {
+        d->used = false;
+    }
+}
+
+/* ---- one transfer: write tx (register pointer + data), then read rx ---- */
+
+static esp_err_t xfer(uint8_t addr, const uint8_t *tx, size_t tx_len, uint8_t *rx, size_t rx_len)
+{
+    g_fake_i2c.xfers++;
+    if (g_fake_i2c.xfer_delay_ms) {
+        usleep(g_fake_i2c.xfer_delay_ms * 1000u);
+    }
+    if (g_fake_i2c.fail_xfer != ESP_OK) {
+        return g_fake_i2c.fail_xfer;
+    }
+    fake_dev_t *d = find(addr);
+    if (!d) {
+        g_fake_i2c.nacks++;
+        return ESP_FAIL;
+    }
+
+    if (d->mpu) {
+        if (tx_len == 1 && rx_len) {
+            return mock_mpu6050_read(d->mpu, tx[0], rx, rx_len);
+        }
+        for (size_t i = 1; i < tx_len; i++) {
+            esp_err_t err = mock_mpu6050_write(d->mpu, (uint8_t)(tx[0] + i - 1), tx[i]);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        return ESP_OK;
+    }
+
+    if (tx_len) {
+        d->reg_ptr = tx[0];
+        for (size_t i = 1; i < tx_len; i++) {
+            d->regs[d->reg_ptr++] = tx[i];
+        }
+    }
+    for (size_t i = 0; i < rx_len; i++) {
+        rx[i] = d->regs[d->reg_ptr++];
+    }
+    return ESP_OK;
+}
+
+static esp_err_t probe(uint8_t addr)
+{
+    g_fake_i2c.probes++;
+    if (g_fake_i2c.fail_xfer != ESP_OK) {
+        return g_fake_i2c.fail_xfer;
+    }
+    if (!find(addr)) {
+        g_fake_i2c.nacks++;
+        return ESP_ERR_NOT_FOUND;   /* like i2c_master_probe() on NACK */
+    }
+    return ESP_OK;
+}
+
+/* ---- i2c_bus backend ---- */
+
+static esp_err_t backend_xfer(void *ctx, i2c_bus_dev_t dev,
+                              const uint8_t *tx, size_t tx_len,
+                              uint8_t *rx, size_t rx_len, int timeout_ms)
+{
+    (void)ctx; (void)timeout_ms;
+    return xfer(i2c_bus_dev_addr(dev), tx, tx_len, rx, rx_len);
+}
+
+static esp_err_t backend_probe(void *ctx, uint8_t addr, int timeout_ms)
+{
+    (void)ctx; (void)timeout_ms;
+    return probe(addr);
+}
+
+const i2c_bus_backend_t fake_i2c_backend = {
+    .xfer = backend_xfer,
+    .probe = backend_probe,
+    .ctx = NULL,
+};
+
+/* ---- i2c_master driver ---- */
+
+struct i2c_master_bus_t {
+    i2c_port_num_t port;
+};
+
+struct i2c_master_dev_t {
+    uint16_t addr;
+    uint32_t scl_hz;
+};
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *cfg, i2c_master_bus_handle_t *ret)
+{
+    if (g_fake_i2c.fail_new_bus != ESP_OK) {
+        return g_fake_i2c.fail_new_bus;
+    }
+    struct i2c_master_bus_t *b = calloc(1, sizeof(*b));
+    b->port = cfg->i2c_port;
+    g_fake_i2c.live_buses++;
+    *ret = b;
+    return ESP_OK;
+}
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus)
+{
+    free(bus);
+    g_fake_i2c.live_buses--;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t *cfg,
+                                    i2c_master_dev_handle_t *ret)
+{
+    (void)bus;
+    if (g_fake_i2c.fail_add_device != ESP_OK) {
+        return g_fake_i2c.fail_add_device;
+    }
+    struct i2c_master_dev_t *d = calloc(1, sizeof(*d));
+    d->addr = cfg->device_address;
+    d->scl_hz = cfg->scl_speed_hz;
+    g_fake_i2c.live_devices++;
+    *ret = d;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t dev)
+{
+    free(dev);
+    g_fake_i2c.live_devices--;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t *tx, size_t tx_len,
+                              int timeout_ms)
+{
+    (void)timeout_ms;
+    return xfer((uint8_t)dev->addr, tx, tx_len, NULL, 0);
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t dev, uint8_t *rx, size_t rx_len,
+                             int timeout_ms)
+{
+    (void)timeout_ms;
+    return xfer((uint8_t)dev->addr, NULL, 0, rx, rx_len);
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t dev, const uint8_t *tx,
+                                      size_t tx_len, uint8_t *rx, size_t rx_len, int timeout_ms)
+{
+    (void)timeout_ms;
+    return xfer((uint8_t)dev->addr, tx, tx_len, rx, rx_len);
+}
+
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t bus, uint16_t addr, int timeout_ms)
+{
+    (void)bus; (void)timeout_ms;
+    return probe((uint8_t)addr);
+}
+
+esp_err_t i2c_master_device_change_address(i2c_master_dev_handle_t dev, uint16_t addr,
+                                           int timeout_ms)
+{
+    (void)timeout_ms;
+    dev->addr = addr;
+    return ESP_OK;
+}
@@ -0,0 +1,69 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host tests: simulated I2C bus (i2c_bus backend and i2c_master driver)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * A bus with devices that can be plugged in and out at runtime:
+ *  - plain register devices (an ID register is enough for the scanner)
+ *  - a mock_mpu6050_t at its address
+ *
+ * Two ways in:
+ *  - fake_i2c_backend for i2c_bus_set_backend() (the component's own hook)
+ *  - the i2c_master driver functions themselves (i2c_new_master_bus, ...)
+ *    for the hardware path of i2c_bus.c, with error injection and a count
+ *    of buses/devices not yet deleted, so error unwinding can be checked
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "i2c_bus.h"
+#include "mock_mpu6050.h"
+
+#define FAKE_I2C_MAX_DEVICES    24      /* more than I2C_SCAN_MAX_DEVICES */
+
+typedef struct {
+    /* traffic */
+    uint32_t  probes;
+    uint32_t  xfers;
+    uint32_t  nacks;
+
+    /* error injection (ESP_OK = off) */
+    esp_err_t fail_new_bus;
+    esp_err_t fail_add_device;
+    esp_err_t fail_xfer;        /* every transfer and probe, e.g. a stuck bus */
+    uint32_t  xfer_delay_ms;    /* each transfer takes this long (clock stretching) */
+
+    /* driver objects not yet deleted */
+    int       live_buses;
+    int       live_devices;
+} fake_i2c_t;
+
+extern fake_i2c_t g_fake_i2c;
+extern const i2c_bus_backend_t fake_i2c_backend;
+
+/* remove all devices, clear counters and error injection */
+void fake_i2c_reset(void);
+
+/* register device: every register reads 0 except id_reg = id_val */
+void fake_i2c_add(uint8_t addr, uint8_t id_reg, uint8_t id_val);
+
+/* MPU6050 model at addr (register access goes to the mock) */
+void fake_i2c_add_mpu(uint8_t addr, mock_mpu6050_t *m);
+
+/* unplug */
+void fake_i2c_remove(uint8_t addr);
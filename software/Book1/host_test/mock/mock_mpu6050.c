@@ -0,0 +1,200 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host tests: simulated MPU6050 (registers, FIFO, bus time)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <string.h>
+
+#include "mock_mpu6050.h"
+
+#define REG_SMPLRT_DIV      0x19
+#define REG_CONFIG          0x1A
+#define REG_FIFO_EN         0x23
+#define REG_INT_STATUS      0x3A
+#define REG_USER_CTRL       0x6A
+#define REG_PWR_MGMT_1      0x6B
+#define REG_FIFO_COUNT_H    0x72
+#define REG_FIFO_COUNT_L    0x73
+#define REG_FIFO_R_W        0x74
+#define REG_WHO_AM_I        0x75
+
+#define FIFO_EN_ACCEL       0x08
+#define FIFO_EN_XG          0x40
+#define FIFO_EN_YG          0x20
+#define FIFO_EN_ZG          0x10
+#define USER_CTRL_FIFO_EN   0x40
+#define USER_CTRL_FIFO_RST  0x04
+#define INT_FIFO_OFLOW      0x10
+
+void mock_mpu6050_sample_values(uint32_t k, int16_t out[6])
+{
+    out[0] = (int16_t)k;
+    out[1] = (int16_t)(0u - k);
+    out[2] = 16384;
+    out[3] = (int16_t)(3u * k);
+    out[4] = (int16_t)(k ^ 0x5555u);
+    out[5] = 7;
+}
+
+void mock_mpu6050_init(mock_mpu6050_t *m, uint32_t scl_hz)
+{
+    memset(m, 0, sizeof(*m));
+    m->scl_hz = scl_hz;
+    m->regs[REG_PWR_MGMT_1] = 0x40;     /* SLEEP after power-on */
+    m->regs[REG_WHO_AM_I] = 0x68;
+}
+
+static void fifo_put(mock_mpu6050_t *m, uint8_t b)
+{
+    if (m->fifo_count == MOCK_MPU6050_FIFO_SIZE) {
+        /* full: the oldest byte is lost */
+        m->fifo_head = (m->fifo_head + 1) % MOCK_MPU6050_FIFO_SIZE;
+        m->fifo_count--;
+        m->regs[REG_INT_STATUS] |= INT_FIFO_OFLOW;
+    }
+    m->fifo[(m->fifo_head + m->fifo_count) % MOCK_MPU6050_FIFO_SIZE] = b;
+    m->fifo_count++;
+}
+
+void mock_mpu6050_push_raw(mock_mpu6050_t *m, const uint8_t *bytes, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        fifo_put(m, bytes[i]);
+    }
+}
+
+static int64_t sample_period_us(const mock_mpu6050_t *m)
+{
+    uint8_t dlpf = m->regs[REG_CONFIG] & 0x07;
+    int64_t base_hz = (dlpf == 0 || dlpf == 7) ? 8000 : 1000;
+    return 1000000 * (1 + (int64_t)m->regs[REG_SMPLRT_DIV]) / base_hz;
+}
+
+static void produce_sample(mock_mpu6050_t *m)
+{
+    uint8_t en = m->regs[REG_FIFO_EN];
+    int16_t v[6];
+    mock_mpu6050_sample_values(m->next_k++, v);
+
+    if (!(m->regs[REG_USER_CTRL] & USER_CTRL_FIFO_EN)) {
+        return;
+    }
+    /* FIFO order as in the register map: accel xyz, then gyro x, y, z */
+    const uint8_t mask[6] = { FIFO_EN_ACCEL, FIFO_EN_ACCEL, FIFO_EN_ACCEL,
+                              FIFO_EN_XG, FIFO_EN_YG, FIFO_EN_ZG };
+    for (int i = 0; i < 6; i++) {
+        if (en & mask[i]) {
+            fifo_put(m, (uint8_t)((uint16_t)v[i] >> 8));
+            fifo_put(m, (uint8_t)v[i]);
+        }
+    }
+}
+
+void mock_mpu6050_advance(mock_mpu6050_t *m, int64_t us)
+{
+    int64_t end = m->now_us + us;
+    bool awake = !(m->regs[REG_PWR_MGMT_1] & 0x40);
+
+    while (awake && m->next_sample_us < end) {
+        m->now_us = m->next_sample_us;
+        produce_sample(m);
+        m->next_sample_us += sample_period_us(m);
+    }
+    m->now_us = end;
+    if (!awake) {
+        m->next_sample_us = end;
+    }
+}
+
+/* START, address, register, (restart, address,) data: 9 clocks per byte */
+static void bus_time(mock_mpu6050_t *m, size_t bytes)
+{
+    m->transfers++;
+    m->bus_bytes += bytes;
+    if (m->scl_hz) {
+        mock_mpu6050_advance(m, (int64_t)bytes * 9 * 1000000 / m->scl_hz);
+    }
+}
+
+static uint8_t read_one(mock_mpu6050_t *m, uint8_t reg)
+{
+    switch (reg) {
+    case REG_INT_STATUS: {
+        uint8_t v = m->regs[REG_INT_STATUS];
+        m->regs[REG_INT_STATUS] = 0;        /* clear on read */
+        return v;
+    }
+    case REG_FIFO_COUNT_H:
+        return (uint8_t)(m->fifo_count >> 8);
+    case REG_FIFO_COUNT_L:
+        return (uint8_t)m->fifo_count;
+    case REG_FIFO_R_W: {
+        if (m->fifo_count == 0) {
+            return 0xFF;
+        }
+        uint8_t v = m->fifo[m->fifo_head];
+        m->fifo_head = (m->fifo_head + 1) % MOCK_MPU6050_FIFO_SIZE;
+        m->fifo_count--;
+        return v;
+    }
+    default:
+        return m->regs[reg & 0x7F];
+    }
+}
+
+esp_err_t mock_mpu6050_read(void *ctx, uint8_t reg, uint8_t *buf, size_t len)
+{
+    mock_mpu6050_t *m = ctx;
+    if (m->fail != ESP_OK) {
+        return m->fail;
+    }
+
+    /* FIFO_R_W does not auto-increment: a burst keeps draining the FIFO */
+    for (size_t i = 0; i < len; i++) {
+        uint8_t r = (reg == REG_FIFO_R_W) ? reg : (uint8_t)(reg + i);
+        buf[i] = read_one(m, r);
+    }
+    bus_time(m, 4 + len);
+    return ESP_OK;
+}
+
+esp_err_t mock_mpu6050_write(void *ctx, uint8_t reg, uint8_t val)
+{
+    mock_mpu6050_t *m = ctx;
+    if (m->fail != ESP_OK) {
+        return m->fail;
+    }
+
+    switch (reg) {
+    case REG_USER_CTRL:
+        if (val & USER_CTRL_FIFO_RST) {
+            m->fifo_head = m->fifo_count = 0;
+        }
+        m->regs[reg] = val & ~USER_CTRL_FIFO_RST;   /* reset bit clears itself */
+        break;
+    case REG_INT_STATUS:
+    case REG_FIFO_COUNT_H:
+    case REG_FIFO_COUNT_L:
+    case REG_WHO_AM_I:
+        break;                                      /* read only */
+    case REG_FIFO_R_W:
+        fifo_put(m, val);
+        break;
+    default:
+        m->regs[reg & 0x7F] = val;
+        break;
+    }
+    bus_time(m, 3);
+    return ESP_OK;
+}
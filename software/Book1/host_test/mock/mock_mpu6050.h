@@ -0,0 +1,72 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host tests: simulated MPU6050 (registers, FIFO, bus time)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * Register-level model of the parts of the MPU6050 the book uses:
+ * WHO_AM_I, PWR_MGMT_1, CONFIG/SMPLRT_DIV, FIFO_EN, USER_CTRL (FIFO enable
+ * and reset), INT_STATUS (FIFO_OFLOW, clear on read), FIFO_COUNT and
+ * FIFO_R_W. Like the real chip a full FIFO drops its oldest bytes and sets
+ * FIFO_OFLOW.
+ *
+ * Time is simulated: the sensor produces a sample every 1000 * (1 + div) us
+ * of mock time, and every bus transfer moves mock time on by its length at
+ * scl_hz (9 clocks per byte). That makes "does the FIFO drain keep up at
+ * 100 kHz?" a question the host can answer.
+ *
+ * Sample k carries ax = k, ay = -k, az = 16384, gx = 3k, gy = k ^ 0x5555,
+ * gz = 7 (int16 wrap), so a reader can check order and gaps.
+ */
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+#define MOCK_MPU6050_FIFO_SIZE  1024
+
+typedef struct {
+    uint8_t   regs[128];
+    uint8_t   fifo[MOCK_MPU6050_FIFO_SIZE];
+    size_t    fifo_head;
+    size_t    fifo_count;
+
+    uint32_t  scl_hz;           /* 0: transfers take no mock time */
+    int64_t   now_us;
+    int64_t   next_sample_us;
+    uint32_t  next_k;           /* index of the next produced sample */
+
+    esp_err_t fail;             /* != ESP_OK: every transfer returns this */
+    uint32_t  transfers;
+    uint64_t  bus_bytes;
+} mock_mpu6050_t;
+
+void mock_mpu6050_init(mock_mpu6050_t *m, uint32_t scl_hz);
+
+/* let the sensor run for us microseconds */
+void mock_mpu6050_advance(mock_mpu6050_t *m, int64_t us);
+
+/* append raw bytes to the FIFO (e.g. half a sample) */
+void mock_mpu6050_push_raw(mock_mpu6050_t *m, const uint8_t *bytes, size_t n);
+
+/* register read/write with auto-increment; ctx = mock_mpu6050_t */
+esp_err_t mock_mpu6050_read(void *ctx, uint8_t reg, uint8_t *buf, size_t len);
+esp_err_t mock_mpu6050_write(void *ctx, uint8_t reg, uint8_t val);
+
+/* the values sample k carries */
+void mock_mpu6050_sample_values(uint32_t k, int16_t out[6]);
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+###############################################################################
+# AIoT Workshop – Band 1
+# Host test: C patch decoder against tools/ota_pack.py
+#
+# Copyright (c) 2026 Friedrich Riedhammer
+#
+# This source code is provided as part of the book "AIoT Workshop – Band 1".
+# Permission is granted to use, modify and compile this code for educational,
+# research and product development purposes.
+#
+# Redistribution as part of other publications or commercial training material
+# requires written permission of the author.
+#
+# The software is provided "as is", without warranty of any kind.
+###############################################################################
+"""
+Two steps around test_ota_patch:
+
+  ./ota_patch_crosscheck.py gen build/ota_patch
+      firmware-like old/new images and their patches, made by ota_pack.py
+      (compressed and delta, a large and a small pair)
+  ./build/test_ota_patch build/ota_patch
+      decodes them in C and writes mutated patches with its verdict to
+      build/ota_patch/mutations.txt ("<hex> ok|err")
+  ./ota_patch_crosscheck.py check build/ota_patch
+      decodes every mutation again with ota_pack.decode(); both must agree
+"""
+
+import os
+import random
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tools"))
+from ota_pack import PatchError, decode, encode  # noqa: E402
+
+
+def firmware(rng, size):
+    """Code-like tokens, strings, zero runs and a few incompressible blocks."""
+    tokens = [rng.randbytes(rng.randrange(2, 9)) for _ in range(300)]
+    strings = [("msg_%d: value=%%d state=%%s\n" % i).encode() for i in range(60)]
+    out = bytearray([0xE9])             # ESP image magic
+    while len(out) < size:
+        k = rng.random()
+        if k < 0.6:
+            out += rng.choice(tokens)
+        elif k < 0.7:
+            out += rng.choice(strings)
+        elif k < 0.75:
+            out += bytes(rng.randrange(16, 300))
+        elif k < 0.76:
+            out += rng.randbytes(rng.randrange(200, 3000))
+        else:
+            out.append(rng.randrange(256))
+    return bytes(out[:size])
+
+
+def next_release(rng, old):
+    """Patched constants, an inserted and a removed block, a new section."""
+    new = bytearray(old)
+    for _ in range(max(4, len(old) // 2000)):
+        p = rng.randrange(1, len(new) - 4)
+        new[p:p + 4] = rng.randbytes(4)
+    at = len(new) // 3
+    new[at:at] = rng.randbytes(len(old) // 150)
+    at = len(new) * 2 // 3
+    del new[at:at + len(old) // 300]
+    new += firmware(rng, len(old) // 30)[1:]
+    return bytes(new)
+
+
+def write(path, data):
+    with open(path, "wb") as f:
+        f.write(data)
+
+
+def gen(out_dir):
+    rng = random.Random(19)
+    os.makedirs(out_dir, exist_ok=True)
+    for prefix, size in (("", 40 * 1024 + 77), ("small_", 3000)):
+        old = firmware(rng, size)
+        new = next_release(rng, old)
+        comp, _ = encode(new)
+        delta, _ = encode(new, old)
+        if decode(comp) != new or decode(delta, old) != new:
+            sys.exit("ota_pack.py does not decode its own output")
+        write(os.path.join(out_dir, prefix + "old.bin"), old)
+        write(os.path.join(out_dir, prefix + "new.bin"), new)
+        write(os.path.join(out_dir, prefix + "comp.aip"), comp)
+        write(os.path.join(out_dir, prefix + "delta.aip"), delta)
+        print("  %snew.bin %d bytes: compressed %d, delta %d"
+              % (prefix, len(new), len(comp), len(delta)))
+
+
+def check(out_dir):
+    with open(os.path.join(out_dir, "small_old.bin"), "rb") as f:
+        old = f.read()
+
+    total = accepted = failed = 0
+    with open(os.path.join(out_dir, "mutations.txt")) as f:
+        for line in f:
+            hex_patch, want = line.split()
+            try:
+                decode(b"" if hex_patch == "-" else bytes.fromhex(hex_patch), old)
+                got = "ok"
+            except PatchError:
+                got = "err"
+            total += 1
+            accepted += want == "ok"
+            if got != want:
+                failed += 1
+                if failed <= 10:
+                    print("  %s\n    C: %s  Python: %s" % (hex_patch, want, got))
+
+    print("  %d patches (%d valid) cross-checked, %d differ" % (total, accepted, failed))
+    sys.exit(1 if failed or total == 0 else 0)
+
+
+def main():
+    if len(sys.argv) != 3 or sys.argv[1] not in ("gen", "check"):
+        sys.exit("usage: %s gen|check <dir>" % sys.argv[0])
+    (gen if sys.argv[1] == "gen" else check)(sys.argv[2])
+
+
+if __name__ == "__main__":
+    main()
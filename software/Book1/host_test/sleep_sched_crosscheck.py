@@ -0,0 +1,72 @@
+#!/usr/bin/env python3
+###############################################################################
+# AIoT Workshop – Band 1
+# Host test: replay the sleep_sched traces through tools/sleep_sched_replay.py
+#
+# Copyright (c) 2026 Friedrich Riedhammer
+#
+# This source code is provided as part of the book "AIoT Workshop – Band 1".
+# Permission is granted to use, modify and compile this code for educational,
+# research and product development purposes.
+#
+# Redistribution as part of other publications or commercial training material
+# requires written permission of the author.
+#
+# The software is provided "as is", without warranty of any kind.
+###############################################################################
+"""
+Read the traces test_sleep_sched writes and run every wake through the
+Scheduler of tools/sleep_sched_replay.py. Interval and rule must be the
+same as in sleep_sched.c.
+
+  ./build/test_sleep_sched build/sleep_sched_corpus.txt
+  ./sleep_sched_crosscheck.py build/sleep_sched_corpus.txt
+
+  cfg <min_s max_s start_s change grow_pct awake_ma sleep_ua budget_ua batt_ok_mv batt_low_mv>
+  wake <now_s> <value|-> <awake_ms> <batt_mv> <pin|-> <interval_s> <rule>
+"""
+
+import os
+import sys
+from types import SimpleNamespace
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tools"))
+from sleep_sched_replay import LIMIT_NAMES, Scheduler  # noqa: E402
+
+CFG_KEYS = ("min_s", "max_s", "start_s", "change", "grow_pct",
+            "awake_ma", "sleep_ua", "budget_ua", "batt_ok_mv", "batt_low_mv")
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit("usage: %s <corpus>" % sys.argv[0])
+
+    sched = None
+    traces = wakes = failed = 0
+    with open(sys.argv[1]) as f:
+        for n, line in enumerate(f, 1):
+            cols = line.split()
+            if cols[0] == "cfg":
+                sched = Scheduler(SimpleNamespace(**dict(zip(CFG_KEYS, map(int, cols[1:])))))
+                traces += 1
+                continue
+
+            now_s, value, awake_ms, batt_mv, pin, want_s, want_rule = cols[1:]
+            if pin != "-":
+                sched.pin(int(pin))
+            got_s = sched.update(int(now_s), None if value == "-" else int(value),
+                                 int(awake_ms), int(batt_mv))
+            got_rule = LIMIT_NAMES[sched.limit]
+            wakes += 1
+            if (got_s, got_rule) != (int(want_s), want_rule):
+                failed += 1
+                if failed <= 10:
+                    print("  line %d: %s\n    C: %s %s  Python: %d %s"
+                          % (n, line.strip(), want_s, want_rule, got_s, got_rule))
+
+    print("  %d traces, %d wakes cross-checked, %d differ" % (traces, wakes, failed))
+    sys.exit(1 if failed or wakes == 0 else 0)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,8 @@
+/* Host stub of esp_attr.h: placement attributes have no meaning here */
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define RTC_IRAM_ATTR
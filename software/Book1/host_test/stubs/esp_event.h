@@ -0,0 +1,20 @@
+/* Host stub of esp_event.h: esp_event_post() goes to a test hook (stubs/esp_host.c) */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+typedef const char *esp_event_base_t;
+
+#define ESP_EVENT_DECLARE_BASE(id)  extern esp_event_base_t const id
+#define ESP_EVENT_DEFINE_BASE(id)   esp_event_base_t const id = #id
+
+esp_err_t esp_event_post(esp_event_base_t base, int32_t id, const void *data, size_t size,
+                         TickType_t wait);
+
+/* Test hook: receives every post; NULL (default) = no default loop, posts fail */
+extern esp_err_t (*host_event_hook)(esp_event_base_t base, int32_t id,
+                                    const void *data, size_t size);
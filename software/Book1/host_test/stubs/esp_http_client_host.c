@@ -0,0 +1,276 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host tests: HTTP client over POSIX sockets
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+
+/*
+ * Just enough HTTP/1.1 for a GET with extra headers and a Content-Length
+ * body: no TLS, no chunked encoding, no redirects, one request per
+ * connection. Reads return what recv() delivers, so the caller sees short
+ * reads like on the chip.
+ */
+
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#include "esp_http_client.h"
+
+#define HDR_MAX     4096
+#define EXTRA_MAX   512
+
+struct esp_http_client {
+    esp_http_client_config_t cfg;
+    char     host[64];
+    char     port[8];
+    char     path[256];
+    char     extra[EXTRA_MAX];      /* "Key: value\r\n"... */
+    int      fd;
+    int      status;
+    int64_t  content_len;
+    int64_t  received;
+    char     hdr[HDR_MAX];
+    size_t   pending_off, pending_len;  /* body bytes read along with the headers */
+};
+
+static int64_t  s_link_budget = -1;     /* body bytes until the link drops, -1 = up */
+static uint32_t s_requests;
+static uint64_t s_body_bytes;
+static int      s_clients;
+
+void host_http_link_down_after(int64_t bytes)
+{
+    s_link_budget = bytes;
+}
+
+uint32_t host_http_requests(void)
+{
+    return s_requests;
+}
+
+uint64_t host_http_body_bytes(void)
+{
+    return s_body_bytes;
+}
+
+int host_http_clients(void)
+{
+    return s_clients;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *cfg)
+{
+    struct esp_http_client *c = calloc(1, sizeof(*c));
+    int used = 0;
+
+    if (!c || !cfg->url) {
+        free(c);
+        return NULL;
+    }
+    c->cfg = *cfg;
+    c->fd = -1;
+    strcpy(c->port, "80");
+    strcpy(c->path, "/");
+    if (sscanf(cfg->url, "http://%63[^:/]%n", c->host, &used) != 1) {
+        free(c);
+        return NULL;
+    }
+    const char *p = cfg->url + used;
+    if (*p == ':') {
+        sscanf(p + 1, "%7[0-9]%n", c->port, &used);
+        p += 1 + used;
+    }
+    if (*p == '/') {
+        snprintf(c->path, sizeof(c->path), "%s", p);
+    }
+    s_clients++;
+    return c;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t c, const char *key,
+                                     const char *value)
+{
+    size_t n = strlen(c->extra);
+    int k = snprintf(c->extra + n, sizeof(c->extra) - n, "%s: %s\r\n", key, value);
+    return (k < 0 || (size_t)k >= sizeof(c->extra) - n) ? ESP_ERR_NO_MEM : ESP_OK;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t c, int write_len)
+{
+    struct addrinfo hints = { .ai_family = AF_INET, .ai_socktype = SOCK_STREAM }, *ai;
+    char req[HDR_MAX];
+
+    (void)write_len;
+    s_requests++;
+    if (s_link_budget == 0 || getaddrinfo(c->host, c->port, &hints, &ai) != 0) {
+        return ESP_FAIL;
+    }
+    c->fd = socket(ai->ai_family, ai->ai_socktype, 0);
+    struct timeval tv = {
+        .tv_sec = c->cfg.timeout_ms / 1000,
+        .tv_usec = (c->cfg.timeout_ms % 1000) * 1000,
+    };
+    setsockopt(c->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(c->fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    int rc = connect(c->fd, ai->ai_addr, ai->ai_addrlen);
+    freeaddrinfo(ai);
+    if (rc != 0) {
+        close(c->fd);
+        c->fd = -1;
+        return ESP_FAIL;
+    }
+
+    int n = snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: %s:%s\r\n%s\r\n",
+                     c->path, c->host, c->port, c->extra);
+    if (n <= 0 || (size_t)n >= sizeof(req) || send(c->fd, req, (size_t)n, MSG_NOSIGNAL) != n) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+/* one "Key: value" line -> HTTP_EVENT_ON_HEADER */
+static void header_line(esp_http_client_handle_t c, char *line)
+{
+    char *colon = strchr(line, ':');
+    if (!colon) {
+        return;
+    }
+    *colon = '\0';
+    char *value = colon + 1;
+    while (*value == ' ') {
+        value++;
+    }
+    if (strcasecmp(line, "Content-Length") == 0) {
+        c->content_len = strtoll(value, NULL, 10);
+    }
+    if (c->cfg.event_handler) {
+        esp_http_client_event_t evt = {
+            .event_id = HTTP_EVENT_ON_HEADER,
+            .client = c,
+            .user_data = c->cfg.user_data,
+            .header_key = line,
+            .header_value = value,
+        };
+        c->cfg.event_handler(&evt);
+    }
+}
+
+int64_t esp_http_client_fetch_headers(esp_http_client_handle_t c)
+{
+    size_t len = 0;
+    char *end = NULL;
+
+    if (c->fd < 0) {
+        return ESP_FAIL;
+    }
+    while (!end) {
+        if (len == sizeof(c->hdr) - 1) {
+            return ESP_FAIL;
+        }
+        ssize_t n = recv(c->fd, c->hdr + len, sizeof(c->hdr) - 1 - len, 0);
+        if (n <= 0) {
+            return ESP_FAIL;
+        }
+        len += (size_t)n;
+        c->hdr[len] = '\0';
+        end = strstr(c->hdr, "\r\n\r\n");
+    }
+    c->pending_off = (size_t)(end + 4 - c->hdr);
+    c->pending_len = len - c->pending_off;
+    *end = '\0';
+
+    c->content_len = 0;
+    char *save = NULL;
+    char *line = strtok_r(c->hdr, "\r\n", &save);
+    if (!line || sscanf(line, "HTTP/1.%*d %d", &c->status) != 1) {
+        return ESP_FAIL;
+    }
+    while ((line = strtok_r(NULL, "\r\n", &save)) != NULL) {
+        header_line(c, line);
+    }
+    return c->content_len;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t c)
+{
+    return c->status;
+}
+
+int esp_http_client_read(esp_http_client_handle_t c, char *buf, int len)
+{
+    int64_t left = c->content_len - c->received;
+    int n;
+
+    if (left <= 0 || len <= 0) {
+        return 0;
+    }
+    if (s_link_budget == 0) {
+        return -1;
+    }
+    if (len > left) {
+        len = (int)left;
+    }
+    if (s_link_budget > 0 && len > s_link_budget) {
+        len = (int)s_link_budget;
+    }
+
+    if (c->pending_len) {
+        n = (int)(c->pending_len < (size_t)len ? c->pending_len : (size_t)len);
+        memcpy(buf, c->hdr + c->pending_off, (size_t)n);
+        c->pending_off += (size_t)n;
+        c->pending_len -= (size_t)n;
+    } else {
+        ssize_t r = recv(c->fd, buf, (size_t)len, 0);
+        if (r < 0) {
+            return -1;      /* timeout or reset */
+        }
+        n = (int)r;         /* 0: server closed early */
+    }
+
+    c->received += n;
+    s_body_bytes += (uint64_t)n;
+    if (s_link_budget > 0) {
+        s_link_budget -= n;
+    }
+    return n;
+}
+
+bool esp_http_client_is_complete_data_received(esp_http_client_handle_t c)
+{
+    return c->received >= c->content_len;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t c)
+{
+    if (c->fd >= 0) {
+        close(c->fd);
+        c->fd = -1;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t c)
+{
+    esp_http_client_close(c);
+    free(c);
+    s_clients--;
+    return ESP_OK;
+}
@@ -0,0 +1,224 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host tests: OTA slots and partition reads in RAM
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+
+/*
+ * Flash is NOR: erased bytes are 0xFF, a write can only clear bits. With
+ * OTA_WITH_SEQUENTIAL_WRITES a sector is erased when the first write
+ * reaches it, esp_ota_resume() starts erasing again at the sector of the
+ * offset. Writing into a sector that was not erased in this session ANDs
+ * with the old content, so a resume at the wrong offset shows up as a
+ * corrupt image in esp_ota_end(), as on the chip.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_ota_ops.h"
+
+#define SLOTS   2
+
+static const esp_partition_t s_parts[SLOTS] = {
+    { .address = 0x10000,  .size = HOST_OTA_SLOT_SIZE, .label = "ota_0" },
+    { .address = 0x110000, .size = HOST_OTA_SLOT_SIZE, .label = "ota_1" },
+};
+static uint8_t s_flash[SLOTS][HOST_OTA_SLOT_SIZE];
+static int     s_running;
+static int     s_boot;
+
+static struct {
+    esp_ota_handle_t id;            /* 0 = none open */
+    int              slot;
+    uint32_t         pos;
+    uint32_t         erased_to;     /* sectors below were erased in this session */
+} s_h;
+static esp_ota_handle_t s_next_id = 1;
+
+static const uint8_t *s_expect;
+static size_t         s_expect_len;
+
+static int slot_of(const esp_partition_t *part)
+{
+    for (int i = 0; i < SLOTS; i++) {
+        if (part == &s_parts[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void host_ota_reset(void)
+{
+    for (int i = 0; i < SLOTS; i++) {
+        for (size_t k = 0; k < HOST_OTA_SLOT_SIZE; k++) {
+            s_flash[i][k] = (uint8_t)(k * 131 + i * 7);
+        }
+    }
+    s_running = 0;
+    s_boot = 0;
+    s_h.id = 0;
+    s_expect = NULL;
+    s_expect_len = 0;
+}
+
+uint8_t *host_ota_slot(const esp_partition_t *part)
+{
+    int i = slot_of(part);
+    return i < 0 ? NULL : s_flash[i];
+}
+
+void host_ota_expect(const uint8_t *image, size_t len)
+{
+    s_expect = image;
+    s_expect_len = len;
+}
+
+const esp_partition_t *host_ota_boot_partition(void)
+{
+    return &s_parts[s_boot];
+}
+
+bool host_ota_handle_open(void)
+{
+    return s_h.id != 0;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size)
+{
+    int i = slot_of(part);
+    if (i < 0 || offset > part->size || size > part->size - offset) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(dst, &s_flash[i][offset], size);
+    return ESP_OK;
+}
+
+const esp_partition_t *esp_ota_get_running_partition(void)
+{
+    return &s_parts[s_running];
+}
+
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start)
+{
+    int i = start ? slot_of(start) : s_running;
+    return i < 0 ? NULL : &s_parts[(i + 1) % SLOTS];
+}
+
+static esp_err_t open_session(const esp_partition_t *part, uint32_t pos, esp_ota_handle_t *out)
+{
+    int i = slot_of(part);
+    if (i < 0 || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (i == s_running) {
+        return ESP_ERR_OTA_PARTITION_CONFLICT;
+    }
+    if (s_h.id) {
+        abort();        /* the engine never opens two; a leak is a test bug */
+    }
+    s_h.id = s_next_id++;
+    s_h.slot = i;
+    s_h.pos = pos;
+    s_h.erased_to = pos & ~(uint32_t)(HOST_OTA_SECTOR - 1);
+    *out = s_h.id;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_begin(const esp_partition_t *part, size_t image_size, esp_ota_handle_t *out)
+{
+    esp_err_t err = open_session(part, 0, out);
+    if (err == ESP_OK && image_size != OTA_WITH_SEQUENTIAL_WRITES) {
+        size_t n = image_size == OTA_SIZE_UNKNOWN ? HOST_OTA_SLOT_SIZE : image_size;
+        n = (n + HOST_OTA_SECTOR - 1) & ~(size_t)(HOST_OTA_SECTOR - 1);
+        if (n > HOST_OTA_SLOT_SIZE) {
+            s_h.id = 0;
+            return ESP_ERR_INVALID_SIZE;
+        }
+        memset(s_flash[s_h.slot], 0xFF, n);
+        s_h.erased_to = (uint32_t)n;
+    }
+    return err;
+}
+
+esp_err_t esp_ota_resume(const esp_partition_t *part, size_t erase_size, size_t image_offset,
+                         esp_ota_handle_t *out)
+{
+    (void)erase_size;
+    if (image_offset >= HOST_OTA_SLOT_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return open_session(part, (uint32_t)image_offset, out);
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size)
+{
+    const uint8_t *p = data;
+
+    if (!handle || handle != s_h.id) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_h.pos == 0 && size && p[0] != 0xE9) {
+        return ESP_ERR_OTA_VALIDATE_FAILED;         /* image magic, like IDF */
+    }
+    if (size > HOST_OTA_SLOT_SIZE - s_h.pos) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    uint8_t *flash = s_flash[s_h.slot];
+    for (size_t i = 0; i < size; i++, s_h.pos++) {
+        while (s_h.pos >= s_h.erased_to) {
+            memset(&flash[s_h.erased_to], 0xFF, HOST_OTA_SECTOR);
+            s_h.erased_to += HOST_OTA_SECTOR;
+        }
+        flash[s_h.pos] &= p[i];
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t handle)
+{
+    if (!handle || handle != s_h.id) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_h.id = 0;
+
+    const uint8_t *flash = s_flash[s_h.slot];
+    if (s_h.pos == 0 || flash[0] != 0xE9) {
+        return ESP_ERR_OTA_VALIDATE_FAILED;
+    }
+    if (s_expect && (s_h.pos != s_expect_len || memcmp(flash, s_expect, s_expect_len) != 0)) {
+        return ESP_ERR_OTA_VALIDATE_FAILED;         /* the SHA-256 would not match */
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_abort(esp_ota_handle_t handle)
+{
+    if (!handle || handle != s_h.id) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_h.id = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *part)
+{
+    int i = slot_of(part);
+    if (i < 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_boot = i;
+    return ESP_OK;
+}
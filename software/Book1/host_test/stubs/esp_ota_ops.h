@@ -0,0 +1,38 @@
+/* Host stub of esp_ota_ops.h: NOR flash semantics in RAM (stubs/esp_ota_host.c) */
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_partition.h"
+
+typedef uint32_t esp_ota_handle_t;
+
+#define OTA_SIZE_UNKNOWN            0xffffffff
+#define OTA_WITH_SEQUENTIAL_WRITES  0xfffffffe
+
+#define HOST_OTA_SLOT_SIZE          (1024 * 1024)
+#define HOST_OTA_SECTOR             4096
+
+esp_err_t esp_ota_begin(const esp_partition_t *part, size_t image_size, esp_ota_handle_t *out);
+esp_err_t esp_ota_resume(const esp_partition_t *part, size_t erase_size, size_t image_offset,
+                         esp_ota_handle_t *out);
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void *data, size_t size);
+esp_err_t esp_ota_end(esp_ota_handle_t handle);
+esp_err_t esp_ota_abort(esp_ota_handle_t handle);
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t *part);
+const esp_partition_t *esp_ota_get_running_partition(void);
+const esp_partition_t *esp_ota_get_next_update_partition(const esp_partition_t *start);
+
+/*
+ * Test hooks. host_ota_reset(): slot 0 running and boot target, both
+ * slots filled with garbage, no handle open. host_ota_expect(): the image
+ * esp_ota_end() must find in flash (stands in for its SHA-256 check).
+ */
+void     host_ota_reset(void);
+uint8_t *host_ota_slot(const esp_partition_t *part);
+void     host_ota_expect(const uint8_t *image, size_t len);
+const esp_partition_t *host_ota_boot_partition(void);
+bool     host_ota_handle_open(void);
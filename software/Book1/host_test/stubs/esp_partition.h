@@ -0,0 +1,15 @@
+/* Host stub of esp_partition.h: two OTA slots in RAM (stubs/esp_ota_host.c) */
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+
+typedef struct {
+    uint32_t address;
+    uint32_t size;
+    char     label[17];
+} esp_partition_t;
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t offset, void *dst, size_t size);
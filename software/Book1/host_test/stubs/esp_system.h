@@ -0,0 +1,4 @@
+/* Host stub of esp_system.h: a restart ends the test (stubs/esp_host.c) */
+#pragma once
+
+void esp_restart(void) __attribute__((noreturn));
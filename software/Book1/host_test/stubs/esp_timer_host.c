@@ -0,0 +1,191 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host tests: esp_timer callbacks on a dispatch thread
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * Like the esp_timer task: one thread, callbacks one after the other, a
+ * slow callback delays the next. Time is esp_timer_get_time() (monotonic,
+ * real time), the thread starts with the first esp_timer_create().
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "esp_timer.h"
+
+#define HOST_TIMERS_MAX 16
+
+struct esp_timer {
+    bool           used;
+    esp_timer_cb_t cb;
+    void          *arg;
+    int64_t        due_us;      /* 0 = not armed */
+    uint64_t       period_us;   /* 0 = one-shot */
+};
+
+esp_err_t host_fail_timer_create = ESP_OK;
+
+static struct esp_timer s_timers[HOST_TIMERS_MAX];
+static pthread_mutex_t  s_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   s_cond;
+static pthread_t        s_thread;
+static bool             s_running;
+
+static struct esp_timer *next_due(void)
+{
+    struct esp_timer *next = NULL;
+    for (int i = 0; i < HOST_TIMERS_MAX; i++) {
+        struct esp_timer *t = &s_timers[i];
+        if (t->used && t->due_us && (!next || t->due_us < next->due_us)) {
+            next = t;
+        }
+    }
+    return next;
+}
+
+static void *dispatch(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&s_lock);
+    while (1) {
+        struct esp_timer *t = next_due();
+        int64_t now = esp_timer_get_time();
+
+        if (!t) {
+            pthread_cond_wait(&s_cond, &s_lock);
+            continue;
+        }
+        if (t->due_us > now) {
+            struct timespec ts = {
+                .tv_sec = t->due_us / 1000000,
+                .tv_nsec = (long)(t->due_us % 1000000) * 1000,
+            };
+            pthread_cond_timedwait(&s_cond, &s_lock, &ts);
+            continue;
+        }
+
+        t->due_us = t->period_us ? t->due_us + (int64_t)t->period_us : 0;
+        esp_timer_cb_t cb = t->cb;
+        void *cb_arg = t->arg;
+        pthread_mutex_unlock(&s_lock);
+        cb(cb_arg);
+        pthread_mutex_lock(&s_lock);
+    }
+    return NULL;
+}
+
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    if (!args || !args->callback || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&s_lock);
+    if (host_fail_timer_create != ESP_OK) {
+        esp_err_t err = host_fail_timer_create;
+        host_fail_timer_create = ESP_OK;
+        pthread_mutex_unlock(&s_lock);
+        return err;
+    }
+    if (!s_running) {
+        pthread_condattr_t attr;
+        pthread_condattr_init(&attr);
+        pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+        pthread_cond_init(&s_cond, &attr);
+        pthread_condattr_destroy(&attr);
+        if (pthread_create(&s_thread, NULL, dispatch, NULL) != 0) {
+            abort();
+        }
+        pthread_detach(s_thread);
+        s_running = true;
+    }
+
+    for (int i = 0; i < HOST_TIMERS_MAX; i++) {
+        struct esp_timer *t = &s_timers[i];
+        if (!t->used) {
+            *t = (struct esp_timer){ .used = true, .cb = args->callback, .arg = args->arg };
+            *out = t;
+            pthread_mutex_unlock(&s_lock);
+            return ESP_OK;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ESP_ERR_NO_MEM;
+}
+
+static esp_err_t arm(esp_timer_handle_t t, uint64_t timeout_us, uint64_t period_us)
+{
+    if (!t) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    if (t->due_us) {
+        pthread_mutex_unlock(&s_lock);
+        return ESP_ERR_INVALID_STATE;       /* as on the target: stop first */
+    }
+    t->due_us = esp_timer_get_time() + (int64_t)(timeout_us ? timeout_us : 1);
+    t->period_us = period_us;
+    pthread_cond_signal(&s_cond);
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeout_us)
+{
+    return arm(t, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t t, uint64_t period_us)
+{
+    return arm(t, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t)
+{
+    if (!t) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    esp_err_t err = t->due_us ? ESP_OK : ESP_ERR_INVALID_STATE;
+    t->due_us = 0;
+    pthread_mutex_unlock(&s_lock);
+    return err;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t t)
+{
+    if (!t) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    esp_err_t err = t->due_us ? ESP_ERR_INVALID_STATE : ESP_OK;
+    if (err == ESP_OK) {
+        t->used = false;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return err;
+}
+
+int host_live_timers(void)
+{
+    int n = 0;
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < HOST_TIMERS_MAX; i++) {
+        n += s_timers[i].used;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return n;
+}
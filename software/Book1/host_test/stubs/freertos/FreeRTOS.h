@@ -0,0 +1,65 @@
+/*
+ * Host stub of FreeRTOS on pthreads (host_test/stubs/freertos_host.c).
+ * One tick is one millisecond, critical sections are one global recursive
+ * mutex, ISR variants run in the calling thread.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "sdkconfig.h"
+#include "esp_attr.h"
+
+typedef uint32_t TickType_t;
+typedef int      BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define pdTRUE              1
+#define pdFALSE             0
+#define pdPASS              1
+#define pdFAIL              0
+#define errQUEUE_FULL       0
+#define portMAX_DELAY       ((TickType_t)0xFFFFFFFFu)
+#define configTICK_RATE_HZ  1000
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(ms)   ((TickType_t)(ms))
+#define pdTICKS_TO_MS(t)    ((uint32_t)(t))
+
+#ifndef BIT0
+#define BIT0    (1u << 0)
+#define BIT1    (1u << 1)
+#define BIT2    (1u << 2)
+#define BIT3    (1u << 3)
+#define BIT4    (1u << 4)
+#define BIT5    (1u << 5)
+#define BIT6    (1u << 6)
+#define BIT7    (1u << 7)
+#endif
+
+typedef struct { int unused; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    { 0 }
+
+void host_critical_enter(void);
+void host_critical_exit(void);
+
+#define taskENTER_CRITICAL(mux)         ((void)(mux), host_critical_enter())
+#define taskEXIT_CRITICAL(mux)          ((void)(mux), host_critical_exit())
+#define taskENTER_CRITICAL_ISR(mux)     taskENTER_CRITICAL(mux)
+#define taskEXIT_CRITICAL_ISR(mux)      taskEXIT_CRITICAL(mux)
+#define portENTER_CRITICAL(mux)         taskENTER_CRITICAL(mux)
+#define portEXIT_CRITICAL(mux)          taskEXIT_CRITICAL(mux)
+#define portYIELD_FROM_ISR(...)         ((void)0)
+
+/*
+ * Test hooks (host only): host_fail_create_after = n makes the n-th next
+ * create call (xQueueCreate*, xSemaphoreCreate*, xTaskCreate*,
+ * xEventGroupCreate; 0 = the very next one) fail; -1 = never.
+ * host_live_objects() counts queues, semaphores and event groups not deleted.
+ * host_delay_cap_ms > 0 shortens every vTaskDelay() to at most that (retry
+ * back-offs of seconds in tests that only care about the order of events).
+ */
+extern int host_fail_create_after;
+extern uint32_t host_delay_cap_ms;
+int host_live_objects(void);
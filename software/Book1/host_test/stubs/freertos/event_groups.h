@@ -0,0 +1,15 @@
+/* Host stub of freertos/event_groups.h */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_event_group *EventGroupHandle_t;
+typedef uint32_t EventBits_t;
+
+EventGroupHandle_t xEventGroupCreate(void);
+void vEventGroupDelete(EventGroupHandle_t eg);
+EventBits_t xEventGroupSetBits(EventGroupHandle_t eg, EventBits_t bits);
+EventBits_t xEventGroupClearBits(EventGroupHandle_t eg, EventBits_t bits);
+EventBits_t xEventGroupGetBits(EventGroupHandle_t eg);
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t eg, EventBits_t bits, BaseType_t clear,
+                                BaseType_t all, TickType_t wait);
@@ -0,0 +1,23 @@
+/* Host stub of freertos/queue.h (mutex + condition variable) */
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_queue *QueueHandle_t;
+
+/* Storage for xQueueCreateStatic: the host queue lives in here */
+typedef struct { uint8_t opaque[160]; } StaticQueue_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size,
+                                 uint8_t *storage, StaticQueue_t *buffer);
+void vQueueDelete(QueueHandle_t q);
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait);
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void *item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait);
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item, BaseType_t *woken);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q);
+BaseType_t xQueueReset(QueueHandle_t q);
+
+#define xQueueSendToBack(q, item, wait) xQueueSend((q), (item), (wait))
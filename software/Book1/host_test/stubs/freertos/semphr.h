@@ -0,0 +1,15 @@
+/* Host stub of freertos/semphr.h: semaphores are queues of zero-size items */
+#pragma once
+
+#include "freertos/queue.h"
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+SemaphoreHandle_t xSemaphoreCreateMutex(void);
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial);
+
+#define xSemaphoreGive(s)           xQueueSend((s), NULL, 0)
+#define xSemaphoreTake(s, wait)     xQueueReceive((s), NULL, (wait))
+#define xSemaphoreGiveFromISR(s, w) xQueueSendFromISR((s), NULL, (w))
+#define vSemaphoreDelete(s)         vQueueDelete(s)
@@ -0,0 +1,515 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host tests: the FreeRTOS calls the components use, on pthreads
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * Enough of the kernel to run a component's task, queue and notification
+ * logic on a PC. Not a scheduler: tasks are real threads, so priorities
+ * mean nothing and races show up for real (run the tests a few times, or
+ * under -fsanitize=thread).
+ */
+
+#define _GNU_SOURCE     /* PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+
+#define HOST_TASKS_MAX  256
+
+/* ---- test hooks ---- */
+
+int host_fail_create_after = -1;
+uint32_t host_delay_cap_ms;
+static int s_live_objects;
+
+static bool create_fails(void)
+{
+    host_critical_enter();
+    bool fail = host_fail_create_after == 0;
+    if (host_fail_create_after >= 0) {
+        host_fail_create_after--;
+    }
+    host_critical_exit();
+    return fail;
+}
+
+static void live_add(int n)
+{
+    host_critical_enter();
+    s_live_objects += n;
+    host_critical_exit();
+}
+
+int host_live_objects(void)
+{
+    host_critical_enter();
+    int n = s_live_objects;
+    host_critical_exit();
+    return n;
+}
+
+/* ---- time ---- */
+
+static struct timespec deadline_after(TickType_t ticks)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += ticks / 1000;
+    ts.tv_nsec += (long)(ticks % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+static void cond_init(pthread_cond_t *cv)
+{
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(cv, &attr);
+    pthread_condattr_destroy(&attr);
+}
+
+/* wait on cv until pred() or the timeout; mutex held by the caller */
+#define WAIT_UNTIL(cv, m, wait, pred) ({                                    \
+    bool _ok = true;                                                        \
+    if (!(pred)) {                                                          \
+        if ((wait) == 0) {                                                  \
+            _ok = false;                                                    \
+        } else if ((wait) == portMAX_DELAY) {                               \
+            while (!(pred)) pthread_cond_wait((cv), (m));                   \
+        } else {                                                            \
+            struct timespec _dl = deadline_after(wait);                     \
+            while (!(pred)) {                                               \
+                if (pthread_cond_timedwait((cv), (m), &_dl) == ETIMEDOUT) { \
+                    _ok = (pred);                                           \
+                    break;                                                  \
+                }                                                           \
+            }                                                               \
+        }                                                                   \
+    }                                                                       \
+    _ok;                                                                    \
+})
+
+static struct timespec s_t0;
+static pthread_once_t s_t0_once = PTHREAD_ONCE_INIT;
+
+static void t0_init(void)
+{
+    clock_gettime(CLOCK_MONOTONIC, &s_t0);
+}
+
+TickType_t xTaskGetTickCount(void)
+{
+    struct timespec now;
+
+    pthread_once(&s_t0_once, t0_init);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (TickType_t)((now.tv_sec - s_t0.tv_sec) * 1000 + (now.tv_nsec - s_t0.tv_nsec) / 1000000);
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if (host_delay_cap_ms && ticks > host_delay_cap_ms) {
+        ticks = host_delay_cap_ms;
+    }
+    usleep((useconds_t)ticks * 1000u);
+}
+
+/* ---- critical sections ---- */
+
+static pthread_mutex_t s_critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+
+void host_critical_enter(void)
+{
+    pthread_mutex_lock(&s_critical);
+}
+
+void host_critical_exit(void)
+{
+    pthread_mutex_unlock(&s_critical);
+}
+
+/* ---- tasks and notifications ---- */
+
+struct host_task {
+    pthread_t       thread;
+    pthread_mutex_t m;
+    pthread_cond_t  cv;
+    uint32_t        notify;
+    TaskFunction_t  fn;
+    void           *arg;
+};
+
+/* never freed: a handle stays valid after its task ended, like a zombie TCB */
+static struct host_task s_tasks[HOST_TASKS_MAX];
+static int s_task_count;
+static __thread struct host_task *t_self;
+
+static struct host_task *task_alloc(void)
+{
+    host_critical_enter();
+    struct host_task *t = s_task_count < HOST_TASKS_MAX ? &s_tasks[s_task_count++] : NULL;
+    host_critical_exit();
+    if (t) {
+        pthread_mutex_init(&t->m, NULL);
+        cond_init(&t->cv);
+    }
+    return t;
+}
+
+static void *task_entry(void *arg)
+{
+    struct host_task *t = arg;
+    t_self = t;
+    t->fn(t->arg);
+    return NULL;        /* returning from a task is an error in FreeRTOS, harmless here */
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack,
+                                   void *arg, UBaseType_t prio, TaskHandle_t *out,
+                                   BaseType_t core)
+{
+    (void)name; (void)stack; (void)prio; (void)core;
+    if (create_fails()) {
+        return pdFAIL;      /* like FreeRTOS: *out is left alone */
+    }
+    struct host_task *t = task_alloc();
+    if (!t) {
+        return pdFAIL;
+    }
+    t->fn = fn;
+    t->arg = arg;
+    if (out) {
+        *out = t;       /* before the thread runs, like xTaskCreate */
+    }
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int rc = pthread_create(&t->thread, &attr, task_entry, t);
+    pthread_attr_destroy(&attr);
+    if (rc != 0 && out) {
+        *out = NULL;
+    }
+    return rc == 0 ? pdPASS : pdFAIL;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack,
+                       void *arg, UBaseType_t prio, TaskHandle_t *out)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, out, 0);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task && task != xTaskGetCurrentTaskHandle()) {
+        abort();        /* deleting another task is not modelled */
+    }
+    pthread_exit(NULL);
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    if (!t_self) {
+        t_self = task_alloc();      /* main thread or a foreign thread */
+    }
+    return t_self;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t wait)
+{
+    struct host_task *t = xTaskGetCurrentTaskHandle();
+    uint32_t v = 0;
+
+    pthread_mutex_lock(&t->m);
+    if (WAIT_UNTIL(&t->cv, &t->m, wait, t->notify != 0)) {
+        v = t->notify;
+        t->notify = clear_on_exit ? 0 : t->notify - 1;
+    }
+    pthread_mutex_unlock(&t->m);
+    return v;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t task)
+{
+    pthread_mutex_lock(&task->m);
+    task->notify++;
+    pthread_cond_broadcast(&task->cv);
+    pthread_mutex_unlock(&task->m);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t *woken)
+{
+    xTaskNotifyGive(task);
+    if (woken) {
+        *woken = pdTRUE;
+    }
+}
+
+/* ---- queues and semaphores ---- */
+
+struct host_queue {
+    pthread_mutex_t m;
+    pthread_cond_t  cv;
+    uint8_t        *buf;
+    UBaseType_t     length;
+    UBaseType_t     item_size;
+    UBaseType_t     head;
+    UBaseType_t     count;
+    bool            owns_memory;
+};
+
+_Static_assert(sizeof(struct host_queue) <= sizeof(StaticQueue_t), "StaticQueue_t too small");
+
+static void queue_init(struct host_queue *q, UBaseType_t length, UBaseType_t item_size,
+                       uint8_t *storage)
+{
+    memset(q, 0, sizeof(*q));
+    pthread_mutex_init(&q->m, NULL);
+    cond_init(&q->cv);
+    q->buf = storage;
+    q->length = length;
+    q->item_size = item_size;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    if (create_fails()) {
+        return NULL;
+    }
+    struct host_queue *q = malloc(sizeof(*q));
+    uint8_t *buf = item_size ? malloc((size_t)length * item_size) : NULL;
+    if (!q || (item_size && !buf)) {
+        free(q);
+        free(buf);
+        return NULL;
+    }
+    queue_init(q, length, item_size, buf);
+    q->owns_memory = true;
+    live_add(1);
+    return q;
+}
+
+QueueHandle_t xQueueCreateStatic(UBaseType_t length, UBaseType_t item_size,
+                                 uint8_t *storage, StaticQueue_t *buffer)
+{
+    if (create_fails()) {
+        return NULL;
+    }
+    struct host_queue *q = (struct host_queue *)buffer;
+    queue_init(q, length, item_size, storage);
+    live_add(1);
+    return q;
+}
+
+void vQueueDelete(QueueHandle_t q)
+{
+    if (!q) {
+        return;
+    }
+    live_add(-1);
+    pthread_mutex_destroy(&q->m);
+    pthread_cond_destroy(&q->cv);
+    if (q->owns_memory) {
+        free(q->buf);
+        free(q);
+    }
+}
+
+static BaseType_t queue_put(QueueHandle_t q, const void *item, TickType_t wait, bool front)
+{
+    pthread_mutex_lock(&q->m);
+    if (!WAIT_UNTIL(&q->cv, &q->m, wait, q->count < q->length)) {
+        pthread_mutex_unlock(&q->m);
+        return errQUEUE_FULL;
+    }
+    if (q->item_size) {
+        UBaseType_t slot;
+        if (front) {
+            q->head = (q->head + q->length - 1) % q->length;
+            slot = q->head;
+        } else {
+            slot = (q->head + q->count) % q->length;
+        }
+        memcpy(q->buf + (size_t)slot * q->item_size, item, q->item_size);
+    }
+    q->count++;
+    pthread_cond_broadcast(&q->cv);
+    pthread_mutex_unlock(&q->m);
+    return pdPASS;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait)
+{
+    return queue_put(q, item, wait, false);
+}
+
+BaseType_t xQueueSendToFront(QueueHandle_t q, const void *item, TickType_t wait)
+{
+    return queue_put(q, item, wait, true);
+}
+
+BaseType_t xQueueSendFromISR(QueueHandle_t q, const void *item, BaseType_t *woken)
+{
+    if (woken) {
+        *woken = pdFALSE;
+    }
+    return queue_put(q, item, 0, false);
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait)
+{
+    pthread_mutex_lock(&q->m);
+    if (!WAIT_UNTIL(&q->cv, &q->m, wait, q->count > 0)) {
+        pthread_mutex_unlock(&q->m);
+        return pdFALSE;
+    }
+    if (q->item_size) {
+        memcpy(item, q->buf + (size_t)q->head * q->item_size, q->item_size);
+        q->head = (q->head + 1) % q->length;
+    }
+    q->count--;
+    pthread_cond_broadcast(&q->cv);
+    pthread_mutex_unlock(&q->m);
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->m);
+    UBaseType_t n = q->count;
+    pthread_mutex_unlock(&q->m);
+    return n;
+}
+
+BaseType_t xQueueReset(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->m);
+    q->head = q->count = 0;
+    pthread_cond_broadcast(&q->cv);
+    pthread_mutex_unlock(&q->m);
+    return pdPASS;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+    return xQueueCreate(1, 0);
+}
+
+/* not recursive and without priority inheritance, which the components don't need */
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    SemaphoreHandle_t s = xQueueCreate(1, 0);
+    if (s) {
+        xSemaphoreGive(s);
+    }
+    return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial)
+{
+    SemaphoreHandle_t s = xQueueCreate(max, 0);
+    for (UBaseType_t i = 0; s && i < initial; i++) {
+        xSemaphoreGive(s);
+    }
+    return s;
+}
+
+/* ---- event groups ---- */
+
+struct host_event_group {
+    pthread_mutex_t m;
+    pthread_cond_t  cv;
+    EventBits_t     bits;
+};
+
+EventGroupHandle_t xEventGroupCreate(void)
+{
+    if (create_fails()) {
+        return NULL;
+    }
+    struct host_event_group *eg = calloc(1, sizeof(*eg));
+    if (eg) {
+        pthread_mutex_init(&eg->m, NULL);
+        cond_init(&eg->cv);
+        live_add(1);
+    }
+    return eg;
+}
+
+void vEventGroupDelete(EventGroupHandle_t eg)
+{
+    if (eg) {
+        live_add(-1);
+        pthread_mutex_destroy(&eg->m);
+        pthread_cond_destroy(&eg->cv);
+        free(eg);
+    }
+}
+
+EventBits_t xEventGroupSetBits(EventGroupHandle_t eg, EventBits_t bits)
+{
+    pthread_mutex_lock(&eg->m);
+    eg->bits |= bits;
+    EventBits_t v = eg->bits;
+    pthread_cond_broadcast(&eg->cv);
+    pthread_mutex_unlock(&eg->m);
+    return v;
+}
+
+EventBits_t xEventGroupClearBits(EventGroupHandle_t eg, EventBits_t bits)
+{
+    pthread_mutex_lock(&eg->m);
+    EventBits_t v = eg->bits;
+    eg->bits &= ~bits;
+    pthread_mutex_unlock(&eg->m);
+    return v;
+}
+
+EventBits_t xEventGroupGetBits(EventGroupHandle_t eg)
+{
+    pthread_mutex_lock(&eg->m);
+    EventBits_t v = eg->bits;
+    pthread_mutex_unlock(&eg->m);
+    return v;
+}
+
+EventBits_t xEventGroupWaitBits(EventGroupHandle_t eg, EventBits_t bits, BaseType_t clear,
+                                BaseType_t all, TickType_t wait)
+{
+    pthread_mutex_lock(&eg->m);
+    bool ok = WAIT_UNTIL(&eg->cv, &eg->m, wait,
+                         all ? (eg->bits & bits) == bits : (eg->bits & bits) != 0);
+    EventBits_t v = eg->bits;
+    if (ok && clear) {
+        eg->bits &= ~bits;
+    }
+    pthread_mutex_unlock(&eg->m);
+    return v;
+}
@@ -0,0 +1,18 @@
+/* BSD string functions newlib has and older glibc does not (-include'd by the Makefile) */
+#pragma once
+
+#define _GNU_SOURCE     /* comes first in every file: keep the glibc extensions on */
+#include <string.h>
+
+#if defined(__GLIBC__) && !__GLIBC_PREREQ(2, 38)
+static inline size_t strlcpy(char *dst, const char *src, size_t size)
+{
+    size_t len = strlen(src);
+    if (size) {
+        size_t n = len < size - 1 ? len : size - 1;
+        memcpy(dst, src, n);
+        dst[n] = '\0';
+    }
+    return len;
+}
+#endif
@@ -0,0 +1,38 @@
+/* Host stub of mqtt_client.h: the event types and the publish call
+ * mqtt_ack.c uses (stubs/mqtt_client_host.c), no broker */
+#pragma once
+
+#include "esp_err.h"
+
+typedef struct esp_mqtt_client *esp_mqtt_client_handle_t;
+
+typedef enum {
+    MQTT_EVENT_ERROR,
+    MQTT_EVENT_CONNECTED,
+    MQTT_EVENT_DISCONNECTED,
+    MQTT_EVENT_SUBSCRIBED,
+    MQTT_EVENT_UNSUBSCRIBED,
+    MQTT_EVENT_PUBLISHED,
+    MQTT_EVENT_DATA,
+    MQTT_EVENT_BEFORE_CONNECT,
+    MQTT_EVENT_DELETED,
+} esp_mqtt_event_id_t;
+
+typedef struct {
+    esp_mqtt_event_id_t      event_id;
+    esp_mqtt_client_handle_t client;
+    int                      msg_id;
+} esp_mqtt_event_t;
+
+typedef esp_mqtt_event_t *esp_mqtt_event_handle_t;
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic,
+                            const char *data, int len, int qos, int retain);
+
+/* ---- host side ---- */
+
+/* msg_id of the next publish, counting up from there; <= 0 makes publish fail */
+void host_mqtt_next_msg_id(int msg_id);
+
+/* Runs inside publish before it returns, as an MQTT task that acks early would */
+void host_mqtt_on_publish(void (*hook)(int msg_id));
@@ -0,0 +1,51 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host tests: esp_mqtt_client_publish() that only hands out msg_ids
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <stddef.h>
+
+#include "mqtt_client.h"
+
+static int  s_next_id = 1;
+static void (*s_hook)(int msg_id);
+
+void host_mqtt_next_msg_id(int msg_id)
+{
+    s_next_id = msg_id;
+}
+
+void host_mqtt_on_publish(void (*hook)(int msg_id))
+{
+    s_hook = hook;
+}
+
+int esp_mqtt_client_publish(esp_mqtt_client_handle_t client, const char *topic,
+                            const char *data, int len, int qos, int retain)
+{
+    (void)client;
+    (void)topic;
+    (void)data;
+    (void)len;
+    (void)retain;
+
+    if (s_next_id <= 0) {
+        return -1;
+    }
+    int id = s_next_id++;
+    if (s_hook && qos > 0) {
+        s_hook(id);
+    }
+    return id;
+}
@@ -0,0 +1,195 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host tests: NVS blobs in memory
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * Same return codes as the real NVS for the calls the components make:
+ * READONLY open of a namespace that was never written is NOT_FOUND, a
+ * too small buffer in nvs_get_blob is INVALID_LENGTH. Writes count only
+ * after nvs_commit().
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nvs.h"
+
+#define NVS_HOST_ENTRIES    32
+#define NVS_HOST_HANDLES    8
+#define NVS_HOST_NAME       16      /* NVS_KEY_NAME_MAX_SIZE */
+
+typedef struct {
+    bool     used;
+    char     ns[NVS_HOST_NAME];
+    char     key[NVS_HOST_NAME];
+    uint8_t *val;
+    size_t   len;
+} entry_t;
+
+typedef struct {
+    bool            used;
+    char            ns[NVS_HOST_NAME];
+    nvs_open_mode_t mode;
+    uint32_t        pending;        /* writes since the last commit */
+} handle_t;
+
+static entry_t  s_entries[NVS_HOST_ENTRIES];
+static handle_t s_handles[NVS_HOST_HANDLES];
+static uint32_t s_writes;
+
+static handle_t *get(nvs_handle_t h)
+{
+    return (h >= 1 && h <= NVS_HOST_HANDLES && s_handles[h - 1].used) ? &s_handles[h - 1] : NULL;
+}
+
+static entry_t *find(const char *ns, const char *key)
+{
+    for (int i = 0; i < NVS_HOST_ENTRIES; i++) {
+        entry_t *e = &s_entries[i];
+        if (e->used && strcmp(e->ns, ns) == 0 && (!key || strcmp(e->key, key) == 0)) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+void host_nvs_erase_all(void)
+{
+    for (int i = 0; i < NVS_HOST_ENTRIES; i++) {
+        free(s_entries[i].val);
+    }
+    memset(s_entries, 0, sizeof(s_entries));
+    s_writes = 0;
+}
+
+uint32_t host_nvs_writes(void)
+{
+    return s_writes;
+}
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out)
+{
+    if (strlen(ns) >= NVS_HOST_NAME) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (mode == NVS_READONLY && !find(ns, NULL)) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    for (int i = 0; i < NVS_HOST_HANDLES; i++) {
+        if (!s_handles[i].used) {
+            memset(&s_handles[i], 0, sizeof(s_handles[i]));
+            s_handles[i].used = true;
+            strcpy(s_handles[i].ns, ns);
+            s_handles[i].mode = mode;
+            *out = (nvs_handle_t)(i + 1);
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t h)
+{
+    handle_t *hd = get(h);
+    if (hd) {
+        hd->used = false;
+    }
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t h, const char *key, void *out, size_t *len)
+{
+    handle_t *hd = get(h);
+    if (!hd) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    entry_t *e = find(hd->ns, key);
+    if (!e) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (!out) {
+        *len = e->len;
+        return ESP_OK;
+    }
+    if (*len < e->len) {
+        *len = e->len;
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(out, e->val, e->len);
+    *len = e->len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t h, const char *key, const void *val, size_t len)
+{
+    handle_t *hd = get(h);
+    if (!hd) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (hd->mode != NVS_READWRITE) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    if (strlen(key) >= NVS_HOST_NAME) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+    entry_t *e = find(hd->ns, key);
+    for (int i = 0; !e && i < NVS_HOST_ENTRIES; i++) {
+        if (!s_entries[i].used) {
+            e = &s_entries[i];
+            e->used = true;
+            strcpy(e->ns, hd->ns);
+            strcpy(e->key, key);
+        }
+    }
+    if (!e) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    free(e->val);
+    e->val = malloc(len ? len : 1);
+    memcpy(e->val, val, len);
+    e->len = len;
+    hd->pending++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t h, const char *key)
+{
+    handle_t *hd = get(h);
+    if (!hd) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (hd->mode != NVS_READWRITE) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    entry_t *e = find(hd->ns, key);
+    if (!e) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    free(e->val);
+    memset(e, 0, sizeof(*e));
+    hd->pending++;
+    return ESP_OK;
+}
+
+esp_err_t nvs_commit(nvs_handle_t h)
+{
+    handle_t *hd = get(h);
+    if (!hd) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    s_writes += hd->pending;
+    hd->pending = 0;
+    return ESP_OK;
+}
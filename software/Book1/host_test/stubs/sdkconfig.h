@@ -0,0 +1,4 @@
+/* Host stub of the generated sdkconfig.h: ESP32-S3 defaults used by the tests */
+#pragma once
+
+#define CONFIG_IDF_TARGET_ESP32S3   1
@@ -0,0 +1,7 @@
+/* Host stub of soc/soc_caps.h: the ESP32-S3 values the components use */
+#pragma once
+
+#define SOC_ADC_DIGI_RESULT_BYTES       4
+#define SOC_ADC_DIGI_MAX_BITWIDTH       12
+#define SOC_ADC_SAMPLE_FREQ_THRES_LOW   611
+#define SOC_ADC_SAMPLE_FREQ_THRES_HIGH  83333
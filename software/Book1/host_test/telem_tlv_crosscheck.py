@@ -0,0 +1,93 @@
+#!/usr/bin/env python3
+###############################################################################
+# AIoT Workshop – Band 1
+# Host test: C TLV decoder against tools/telem_decode.py
+#
+# Copyright (c) 2026 Friedrich Riedhammer
+#
+# This source code is provided as part of the book "AIoT Workshop – Band 1".
+# Permission is granted to use, modify and compile this code for educational,
+# research and product development purposes.
+#
+# Redistribution as part of other publications or commercial training material
+# requires written permission of the author.
+#
+# The software is provided "as is", without warranty of any kind.
+###############################################################################
+"""
+Read the corpus test_telem_tlv writes (one "<hex> <json | malformed>" per
+line) and decode every message again in Python. Both decoders must agree on
+accept/reject and on every value.
+
+  ./build/test_telem_tlv build/telem_tlv_corpus.txt
+  ./telem_tlv_crosscheck.py build/telem_tlv_corpus.txt
+"""
+
+import json
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tools"))
+from telem_decode import DecodeError, PHASE_NAMES, ENERGY_NAMES, decode  # noqa: E402
+
+
+def python_view(buf):
+    """decode() reduced to what telem_msg_t can hold, None if malformed."""
+    try:
+        msg = decode(buf)
+    except DecodeError:
+        return None
+
+    msg.pop("version", None)
+    msg.pop("energy_uas_per_sample", None)      # derived, not in the struct
+    for key in ("node_id", "fw_version"):
+        value = msg.pop(key, "")
+        if value:
+            # the C side writes the raw bytes; compare in the same decoding
+            msg[key + "_hex"] = value
+    # fields of a newer firmware: read by both, kept only by Python
+    if "phases" in msg:
+        msg["phases"] = {k: v for k, v in msg["phases"].items() if k in PHASE_NAMES}
+    if "energy_states" in msg:
+        msg["energy_states"] = {k: v for k, v in msg["energy_states"].items()
+                                if k in ENERGY_NAMES}
+    # an empty batch at t=0 looks like no batch in telem_msg_t
+    if "samples" in msg and not (msg["samples"] or msg["now_s"] or msg["dropped"]):
+        for key in ("now_s", "dropped", "samples"):
+            del msg[key]
+    return msg
+
+
+def c_view(text):
+    if text == "malformed":
+        return None
+    msg = json.loads(text)
+    for key in ("node_id_hex", "fw_version_hex"):
+        if key in msg:
+            msg[key] = bytes.fromhex(msg[key]).decode("utf-8", "replace")
+    return msg
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit("usage: %s <corpus>" % sys.argv[0])
+
+    total = accepted = failed = 0
+    with open(sys.argv[1]) as f:
+        for line in f:
+            hex_msg, c_text = line.rstrip("\n").split(" ", 1)
+            buf = b"" if hex_msg == "-" else bytes.fromhex(hex_msg)
+            want, got = c_view(c_text), python_view(buf)
+            total += 1
+            accepted += want is not None
+            if want != got:
+                failed += 1
+                if failed <= 10:
+                    print("  %s\n    C:      %s\n    Python: %s" % (hex_msg, want, got))
+
+    print("  %d messages (%d valid) cross-checked, %d differ" % (total, accepted, failed))
+    sys.exit(1 if failed or total == 0 else 0)
+
+
+if __name__ == "__main__":
+    main()
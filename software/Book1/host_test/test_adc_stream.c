@@ -0,0 +1,461 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: aiot_adc_stream with synthetic DMA frames
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * The adc_continuous driver is replaced by a fake with the same contract:
+ * a pool of max_store_buf_size / conv_frame_size frames, on_conv_done per
+ * frame, on_pool_ovf when the pool is full, read() with timeout 0 returns
+ * one frame or ESP_ERR_TIMEOUT. fake_convert() plays the DMA ISR.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include "check.h"
+#include "adc_stream.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "soc/soc_caps.h"
+
+#define FAKE_POOL_MAX   4
+#define FRAME_SAMPLES   8
+#define FRAME_BYTES     (FRAME_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES)
+
+/* ---- fake driver ---- */
+
+struct adc_continuous_ctx_t {
+    pthread_mutex_t             m;
+    uint32_t                    frame_size;
+    uint32_t                    pool_frames;
+    uint8_t                     pool[FAKE_POOL_MAX][FRAME_BYTES];
+    uint32_t                    head, count;
+    bool                        started;
+    adc_continuous_evt_cbs_t    cbs;
+    void                       *user;
+};
+
+static struct {
+    esp_err_t   fail_new_handle;
+    esp_err_t   fail_register;
+    int         read_delay_ms;      /* worker stays inside read() this long */
+    volatile int reading;           /* worker is inside read() right now */
+    int         live;               /* handles not yet deinit'ed */
+    int         flushes;
+} g_fake;
+
+/* driver handle of the engine created last, for fake_convert() */
+static adc_continuous_handle_t s_last_handle;
+
+esp_err_t adc_continuous_new_handle(const adc_continuous_handle_cfg_t *cfg,
+                                    adc_continuous_handle_t *ret)
+{
+    if (g_fake.fail_new_handle) {
+        return g_fake.fail_new_handle;
+    }
+    CHECK_EQ(cfg->conv_frame_size, FRAME_BYTES);
+    struct adc_continuous_ctx_t *h = calloc(1, sizeof(*h));
+    pthread_mutex_init(&h->m, NULL);
+    h->frame_size = cfg->conv_frame_size;
+    h->pool_frames = cfg->max_store_buf_size / cfg->conv_frame_size;
+    CHECK(h->pool_frames >= 1 && h->pool_frames <= FAKE_POOL_MAX);
+    g_fake.live++;
+    s_last_handle = h;
+    *ret = h;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_config(adc_continuous_handle_t h, const adc_continuous_config_t *cfg)
+{
+    (void)h;
+    CHECK_EQ(cfg->format, ADC_DIGI_OUTPUT_FORMAT_TYPE2);
+    CHECK_EQ(cfg->pattern_num, 1);
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_register_event_callbacks(adc_continuous_handle_t h,
+                                                  const adc_continuous_evt_cbs_t *cbs,
+                                                  void *user_data)
+{
+    if (g_fake.fail_register) {
+        return g_fake.fail_register;
+    }
+    h->cbs = *cbs;
+    h->user = user_data;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_start(adc_continuous_handle_t h)
+{
+    h->started = true;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_stop(adc_continuous_handle_t h)
+{
+    h->started = false;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_flush_pool(adc_continuous_handle_t h)
+{
+    pthread_mutex_lock(&h->m);
+    h->count = 0;
+    pthread_mutex_unlock(&h->m);
+    g_fake.flushes++;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_read(adc_continuous_handle_t h, uint8_t *buf, uint32_t length_max,
+                              uint32_t *out_length, uint32_t timeout_ms)
+{
+    CHECK_EQ(timeout_ms, 0);
+    pthread_mutex_lock(&h->m);
+    if (h->count == 0) {
+        pthread_mutex_unlock(&h->m);
+        return ESP_ERR_TIMEOUT;
+    }
+    uint8_t frame[FRAME_BYTES];
+    memcpy(frame, h->pool[h->head], h->frame_size);
+    h->head = (h->head + 1) % h->pool_frames;
+    h->count--;
+    pthread_mutex_unlock(&h->m);
+
+    /* a slow copy: the frame lands in buf only at the end */
+    g_fake.reading = 1;
+    if (g_fake.read_delay_ms) {
+        usleep(g_fake.read_delay_ms * 1000);
+    }
+    uint32_t n = h->frame_size < length_max ? h->frame_size : length_max;
+    memcpy(buf, frame, n);
+    *out_length = n;
+    g_fake.reading = 0;
+    return ESP_OK;
+}
+
+esp_err_t adc_continuous_deinit(adc_continuous_handle_t h)
+{
+    pthread_mutex_destroy(&h->m);
+    free(h);
+    g_fake.live--;
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int *voltage)
+{
+    (void)handle;
+    *voltage = raw * 3300 / 4095;
+    return ESP_OK;
+}
+
+/* one conversion frame done: into the pool (or overflow), then the ISR callback */
+static void fake_convert(adc_continuous_handle_t h, const uint8_t *frame)
+{
+    bool ovf = false;
+
+    pthread_mutex_lock(&h->m);
+    if (!h->started) {
+        pthread_mutex_unlock(&h->m);
+        return;
+    }
+    if (h->count == h->pool_frames) {
+        ovf = true;
+    } else {
+        memcpy(h->pool[(h->head + h->count) % h->pool_frames], frame, h->frame_size);
+        h->count++;
+    }
+    pthread_mutex_unlock(&h->m);
+
+    adc_continuous_callback_t cb = ovf ? h->cbs.on_pool_ovf : h->cbs.on_conv_done;
+    if (cb) {
+        cb(h, NULL, h->user);
+    }
+}
+
+/* ---- helpers ---- */
+
+static void put_sample(uint8_t *frame, int i, int channel, int data)
+{
+    adc_digi_output_data_t w = { .val = 0 };
+    w.type2.channel = channel;
+    w.type2.data = data;
+    memcpy(&frame[i * SOC_ADC_DIGI_RESULT_BYTES], &w, sizeof(w));
+}
+
+/* all samples 'value' on channel 3 */
+static void make_frame(uint8_t *frame, int value)
+{
+    for (int i = 0; i < FRAME_SAMPLES; i++) {
+        put_sample(frame, i, ADC_CHANNEL_3, value);
+    }
+}
+
+static adc_stream_config_t base_config(QueueHandle_t q)
+{
+    return (adc_stream_config_t) {
+        .unit = ADC_UNIT_1,
+        .channel = ADC_CHANNEL_3,
+        .atten = ADC_ATTEN_DB_12,
+        .sample_freq_hz = 20000,
+        .frame_samples = FRAME_SAMPLES,
+        .result_queue = q,
+    };
+}
+
+static adc_stream_handle_t new_stream(const adc_stream_config_t *cfg)
+{
+    adc_stream_handle_t s = NULL;
+    CHECK_EQ(adc_stream_new(cfg, &s), ESP_OK);
+    return s;
+}
+
+static void wait_reading(void)
+{
+    for (int i = 0; i < 1000 && !g_fake.reading; i++) {
+        usleep(1000);
+    }
+    CHECK(g_fake.reading);
+}
+
+/* ---- tests ---- */
+
+static void test_reduce_mixed_channels(void)
+{
+    uint8_t frame[FRAME_BYTES + 2];
+    for (int i = 0; i < FRAME_SAMPLES; i++) {
+        put_sample(frame, i, (i & 1) ? ADC_CHANNEL_3 : ADC_CHANNEL_5, 100 * i);
+    }
+    uint32_t sum = 0;
+    CHECK_EQ(adc_stream_reduce_frame(frame, FRAME_BYTES, ADC_CHANNEL_3, &sum), 4);
+    CHECK_EQ(sum, 100 + 300 + 500 + 700);
+    CHECK_EQ(adc_stream_reduce_frame(frame, FRAME_BYTES, ADC_CHANNEL_5, &sum), 4);
+    CHECK_EQ(sum, 0 + 200 + 400 + 600);
+    CHECK_EQ(adc_stream_reduce_frame(frame, FRAME_BYTES, ADC_CHANNEL_0, &sum), 0);
+    CHECK_EQ(sum, 0);
+
+    /* a trailing partial word is not a sample */
+    CHECK_EQ(adc_stream_reduce_frame(frame, FRAME_BYTES - 1, ADC_CHANNEL_3, NULL), 3);
+    CHECK_EQ(adc_stream_reduce_frame(frame, 0, ADC_CHANNEL_3, NULL), 0);
+}
+
+static void test_reduce_full_scale(void)
+{
+    uint8_t frame[FRAME_BYTES];
+    for (int i = 0; i < FRAME_SAMPLES; i++) {
+        put_sample(frame, i, ADC_CHANNEL_9, 4095);
+    }
+    uint32_t sum = 0;
+    CHECK_EQ(adc_stream_reduce_frame(frame, FRAME_BYTES, ADC_CHANNEL_9, &sum), FRAME_SAMPLES);
+    CHECK_EQ(sum, 4095 * FRAME_SAMPLES);
+}
+
+static void test_rejects_bad_config(void)
+{
+    adc_stream_config_t cfg = base_config(NULL);
+    adc_stream_handle_t s = NULL;
+
+    cfg.frame_samples = 0;
+    CHECK_EQ(adc_stream_new(&cfg, &s), ESP_ERR_INVALID_ARG);
+    cfg = base_config(NULL);
+    cfg.sample_freq_hz = SOC_ADC_SAMPLE_FREQ_THRES_HIGH + 1;
+    CHECK_EQ(adc_stream_new(&cfg, &s), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(adc_stream_new(NULL, &s), ESP_ERR_INVALID_ARG);
+    CHECK(s == NULL);
+    CHECK_EQ(g_fake.live, 0);
+}
+
+static void on_result(const adc_stream_result_t *r, void *ctx)
+{
+    adc_stream_result_t *last = ctx;
+    *last = *r;
+}
+
+static void test_delivers_frame_averages(void)
+{
+    QueueHandle_t q = xQueueCreate(4, sizeof(adc_stream_result_t));
+    adc_stream_result_t last = { 0 };
+    adc_stream_config_t cfg = base_config(q);
+    cfg.cali = (adc_cali_handle_t)&cfg;     /* any non-NULL handle for the fake */
+    cfg.on_result = on_result;
+    cfg.user_ctx = &last;
+
+    adc_stream_handle_t s = new_stream(&cfg);
+    CHECK_EQ(adc_stream_start(s), ESP_OK);
+    CHECK_EQ(g_fake.flushes, 1);
+
+    uint8_t frame[FRAME_BYTES];
+    for (int v = 1000; v <= 3000; v += 1000) {
+        make_frame(frame, v);
+        fake_convert(s_last_handle, frame);
+
+        adc_stream_result_t r;
+        CHECK(xQueueReceive(q, &r, pdMS_TO_TICKS(1000)) == pdTRUE);
+        CHECK_EQ(r.raw_avg, v);
+        CHECK_EQ(r.samples, FRAME_SAMPLES);
+        CHECK_EQ(r.voltage_mv, v * 3300 / 4095);
+        CHECK_EQ(r.overruns, 0);
+    }
+    CHECK_EQ(last.raw_avg, 3000);
+
+    /* stopped: nothing converts, nothing arrives */
+    CHECK_EQ(adc_stream_stop(s), ESP_OK);
+    fake_convert(s_last_handle, frame);
+    adc_stream_result_t r;
+    CHECK(xQueueReceive(q, &r, pdMS_TO_TICKS(50)) == pdFALSE);
+
+    CHECK_EQ(adc_stream_delete(s), ESP_OK);
+    CHECK_EQ(g_fake.live, 0);
+    vQueueDelete(q);
+}
+
+static void test_full_queue_keeps_newest(void)
+{
+    QueueHandle_t q = xQueueCreate(2, sizeof(adc_stream_result_t));
+    adc_stream_config_t cfg = base_config(q);
+    adc_stream_handle_t s = new_stream(&cfg);
+    CHECK_EQ(adc_stream_start(s), ESP_OK);
+
+    uint8_t frame[FRAME_BYTES];
+    for (int v = 1; v <= 5; v++) {
+        make_frame(frame, v * 100);
+        fake_convert(s_last_handle, frame);
+        /* let the worker take it before the next one (pool of two) */
+        for (int i = 0; i < 1000 && uxQueueMessagesWaiting(q) < (UBaseType_t)(v < 2 ? v : 2); i++) {
+            usleep(1000);
+        }
+        usleep(5000);
+    }
+
+    adc_stream_result_t r;
+    CHECK(xQueueReceive(q, &r, 0) == pdTRUE);
+    CHECK_EQ(r.raw_avg, 400);
+    CHECK(xQueueReceive(q, &r, 0) == pdTRUE);
+    CHECK_EQ(r.raw_avg, 500);
+
+    CHECK_EQ(adc_stream_delete(s), ESP_OK);
+    vQueueDelete(q);
+}
+
+static void test_pool_overflow_counts_overruns(void)
+{
+    QueueHandle_t q = xQueueCreate(8, sizeof(adc_stream_result_t));
+    adc_stream_config_t cfg = base_config(q);
+    adc_stream_handle_t s = new_stream(&cfg);
+    CHECK_EQ(adc_stream_start(s), ESP_OK);
+
+    /* the worker sits in read() while DMA delivers three more frames */
+    g_fake.read_delay_ms = 50;
+    uint8_t frame[FRAME_BYTES];
+    make_frame(frame, 1234);
+    fake_convert(s_last_handle, frame);
+    wait_reading();
+    for (int i = 0; i < 3; i++) {
+        fake_convert(s_last_handle, frame);     /* pool of two: third is lost */
+    }
+
+    adc_stream_result_t r = { 0 };
+    int got = 0;
+    while (xQueueReceive(q, &r, pdMS_TO_TICKS(500)) == pdTRUE) {
+        got++;
+        CHECK_EQ(r.raw_avg, 1234);
+        if (got == 3) {
+            break;
+        }
+    }
+    CHECK_EQ(got, 3);
+    CHECK_EQ(r.overruns, 1);
+    g_fake.read_delay_ms = 0;
+
+    /* a new run starts from zero */
+    CHECK_EQ(adc_stream_stop(s), ESP_OK);
+    CHECK_EQ(adc_stream_start(s), ESP_OK);
+    fake_convert(s_last_handle, frame);
+    CHECK(xQueueReceive(q, &r, pdMS_TO_TICKS(1000)) == pdTRUE);
+    CHECK_EQ(r.overruns, 0);
+
+    CHECK_EQ(adc_stream_delete(s), ESP_OK);
+    vQueueDelete(q);
+}
+
+/*
+ * Delete while the worker is inside adc_continuous_read(): the engine must
+ * not free the frame buffer under it. With ASan a premature free shows up as
+ * heap-use-after-free in the fake's final memcpy.
+ */
+static void test_delete_waits_for_worker(void)
+{
+    adc_stream_config_t cfg = base_config(NULL);
+    adc_stream_handle_t s = new_stream(&cfg);
+    CHECK_EQ(adc_stream_start(s), ESP_OK);
+
+    g_fake.read_delay_ms = 40;
+    uint8_t frame[FRAME_BYTES];
+    make_frame(frame, 42);
+    fake_convert(s_last_handle, frame);
+    wait_reading();
+
+    int64_t t0 = esp_timer_get_time();
+    CHECK_EQ(adc_stream_delete(s), ESP_OK);
+    CHECK(!g_fake.reading);
+    CHECK(esp_timer_get_time() - t0 >= 20000);
+    CHECK_EQ(g_fake.live, 0);
+    g_fake.read_delay_ms = 0;
+}
+
+static void test_repeated_new_delete(void)
+{
+    adc_stream_config_t cfg = base_config(NULL);
+    for (int i = 0; i < 20; i++) {
+        adc_stream_handle_t s = new_stream(&cfg);
+        if (i & 1) {
+            CHECK_EQ(adc_stream_start(s), ESP_OK);
+        }
+        CHECK_EQ(adc_stream_delete(s), ESP_OK);
+    }
+    CHECK_EQ(g_fake.live, 0);
+}
+
+static void test_driver_errors_unwind(void)
+{
+    adc_stream_config_t cfg = base_config(NULL);
+    adc_stream_handle_t s = NULL;
+
+    g_fake.fail_new_handle = ESP_ERR_NO_MEM;
+    CHECK_EQ(adc_stream_new(&cfg, &s), ESP_ERR_NO_MEM);
+    g_fake.fail_new_handle = ESP_OK;
+
+    /* used to be ESP_ERROR_CHECK: abort() instead of an error */
+    g_fake.fail_register = ESP_ERR_INVALID_STATE;
+    CHECK_EQ(adc_stream_new(&cfg, &s), ESP_ERR_INVALID_STATE);
+    g_fake.fail_register = ESP_OK;
+
+    CHECK(s == NULL);
+    CHECK_EQ(g_fake.live, 0);
+    CHECK_EQ(adc_stream_delete(NULL), ESP_ERR_INVALID_ARG);
+}
+
+int main(void)
+{
+    RUN(test_reduce_mixed_channels);
+    RUN(test_reduce_full_scale);
+    RUN(test_rejects_bad_config);
+    RUN(test_delivers_frame_averages);
+    RUN(test_full_queue_keeps_newest);
+    RUN(test_pool_overflow_counts_overruns);
+    RUN(test_delete_waits_for_worker);
+    RUN(test_repeated_new_delete);
+    RUN(test_driver_errors_unwind);
+    return check_done();
+}
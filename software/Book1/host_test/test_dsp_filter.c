@@ -0,0 +1,378 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: fixed-point filter stages and chains
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "check.h"
+#include "dsp_bench.h"
+#include "dsp_filter.h"
+
+static const int16_t s_levels[] = { 0, 1, -1, 1000, -1000, 12345, -12345, 32767, -32768 };
+#define LEVELS  (sizeof(s_levels) / sizeof(s_levels[0]))
+
+static int16_t push(dsp_chain_t *c, int16_t x)
+{
+    int16_t y = 0x5A5A;
+    CHECK(dsp_chain_process(c, x, &y));
+    return y;
+}
+
+/* ---- moving average ---- */
+
+/* a constant comes back unchanged, for every window and during warm-up */
+static void test_mavg_constant(void)
+{
+    dsp_chain_t c;
+    int bad = 0;
+
+    for (uint8_t len = 1; len <= DSP_MAVG_MAX_LEN; len++) {
+        for (size_t l = 0; l < LEVELS; l++) {
+            dsp_chain_init(&c);
+            CHECK(dsp_chain_add_moving_avg(&c, len));
+            for (int i = 0; i < 3 * len; i++) {
+                bad += push(&c, s_levels[l]) != s_levels[l];
+            }
+        }
+    }
+    CHECK_EQ(bad, 0);
+}
+
+static void test_mavg_step_and_warmup(void)
+{
+    dsp_chain_t c;
+
+    dsp_chain_init(&c);
+    dsp_chain_add_moving_avg(&c, 4);
+    CHECK_EQ(push(&c, 10), 10);                 /* warm-up: mean so far */
+    CHECK_EQ(push(&c, 20), 15);
+    CHECK_EQ(push(&c, 30), 20);
+    CHECK_EQ(push(&c, 40), 25);
+    CHECK_EQ(push(&c, 50), 35);                 /* 10 has left the window */
+
+    /* rounded to nearest, halves away from zero, the same both ways */
+    dsp_chain_init(&c);
+    dsp_chain_add_moving_avg(&c, 3);
+    for (int i = 0; i < 3; i++) {
+        push(&c, 0);
+    }
+    CHECK_EQ(push(&c, 100), 33);
+    CHECK_EQ(push(&c, 100), 67);
+    CHECK_EQ(push(&c, 100), 100);
+    CHECK_EQ(push(&c, -100), 33);
+    CHECK_EQ(push(&c, -100), -33);
+    CHECK_EQ(push(&c, -100), -100);
+    CHECK_EQ(push(&c, -101), -100);
+    CHECK_EQ(push(&c, -101), -101);
+
+    dsp_chain_init(&c);
+    dsp_chain_add_moving_avg(&c, 2);
+    CHECK_EQ(push(&c, 1), 1);
+    CHECK_EQ(push(&c, 2), 2);                   /* 1.5 */
+    CHECK_EQ(push(&c, -2), 0);
+    CHECK_EQ(push(&c, -1), -2);                 /* -1.5 */
+
+    /* the extremes: 32 x full scale fits the running sum */
+    dsp_chain_init(&c);
+    dsp_chain_add_moving_avg(&c, DSP_MAVG_MAX_LEN);
+    for (int i = 0; i < DSP_MAVG_MAX_LEN - 1; i++) {
+        CHECK_EQ(push(&c, INT16_MAX), INT16_MAX);
+    }
+    CHECK_EQ(push(&c, INT16_MIN), 30719);       /* 30719.03 */
+    for (int i = 0; i < DSP_MAVG_MAX_LEN / 2 - 2; i++) {
+        push(&c, INT16_MIN);
+    }
+    CHECK_EQ(push(&c, INT16_MIN), -1);          /* 16 of each: -0.5 */
+    for (int i = 0; i < DSP_MAVG_MAX_LEN / 2; i++) {
+        push(&c, INT16_MIN);
+    }
+    CHECK_EQ(push(&c, INT16_MIN), INT16_MIN);
+
+    CHECK(!dsp_chain_add_moving_avg(&c, 0));
+    CHECK(!dsp_chain_add_moving_avg(&c, DSP_MAVG_MAX_LEN + 1));
+}
+
+/* random input against a double reference with the same rounding */
+static void test_mavg_random(void)
+{
+    uint32_t seed = 3;
+    int bad = 0;
+
+    for (uint8_t len = 1; len <= DSP_MAVG_MAX_LEN; len++) {
+        dsp_chain_t c;
+        int16_t hist[2000];
+
+        dsp_chain_init(&c);
+        dsp_chain_add_moving_avg(&c, len);
+        for (int i = 0; i < 2000; i++) {
+            hist[i] = (int16_t)check_rand(&seed);
+            int n = i + 1 < len ? i + 1 : len;
+            double sum = 0;
+            for (int k = 0; k < n; k++) {
+                sum += hist[i - k];
+            }
+            bad += push(&c, hist[i]) != (int16_t)lround(sum / n);
+        }
+    }
+    CHECK_EQ(bad, 0);
+}
+
+/* ---- IIR ---- */
+
+static void test_iir_constant_and_prime(void)
+{
+    static const int16_t alphas[] = { 1, 205, 16384, DSP_Q15_ONE };
+    int bad = 0;
+
+    for (size_t a = 0; a < sizeof(alphas) / sizeof(alphas[0]); a++) {
+        for (size_t l = 0; l < LEVELS; l++) {
+            dsp_chain_t c;
+            dsp_chain_init(&c);
+            CHECK(dsp_chain_add_iir_lowpass(&c, alphas[a]));
+            for (int i = 0; i < 50; i++) {
+                bad += push(&c, s_levels[l]) != s_levels[l];   /* primed at once */
+            }
+        }
+    }
+    CHECK_EQ(bad, 0);
+
+    dsp_chain_t c;
+    dsp_chain_init(&c);
+    CHECK(!dsp_chain_add_iir_lowpass(&c, 0));
+    CHECK(!dsp_chain_add_iir_lowpass(&c, -5));
+}
+
+static void test_iir_step(void)
+{
+    dsp_chain_t c;
+
+    /* a = 0.5: half the way per sample */
+    dsp_chain_init(&c);
+    dsp_chain_add_iir_lowpass(&c, 16384);
+    push(&c, 0);
+    CHECK_EQ(push(&c, 1000), 500);
+    CHECK_EQ(push(&c, 1000), 750);
+    CHECK_EQ(push(&c, 1000), 875);
+    for (int i = 0; i < 40; i++) {
+        push(&c, 1000);
+    }
+    CHECK_EQ(push(&c, 1000), 1000);             /* settles on the step, no offset */
+    CHECK_EQ(push(&c, -1000), 0);
+    for (int i = 0; i < 40; i++) {
+        push(&c, -1000);
+    }
+    CHECK_EQ(push(&c, -1000), -1000);
+
+    /* slow filter: settles too, from both sides */
+    int16_t alpha = dsp_iir_alpha_q15(1.0f, 1000.0f);
+    CHECK_EQ(alpha, 205);
+    dsp_chain_init(&c);
+    dsp_chain_add_iir_lowpass(&c, alpha);
+    push(&c, -3000);
+    int16_t prev = -3000, y = 0;
+    bool monotonic = true;
+    for (int i = 0; i < 5000; i++) {
+        y = push(&c, 3000);
+        monotonic &= y >= prev;
+        prev = y;
+    }
+    CHECK(monotonic);
+    CHECK_EQ(y, 3000);
+
+    /* full-scale steps at the fastest alpha: no overflow, a = 32767/32768
+     * leaves at most two LSB behind */
+    dsp_chain_init(&c);
+    dsp_chain_add_iir_lowpass(&c, DSP_Q15_ONE);
+    for (int i = 0; i < 10; i++) {
+        int16_t x = (i & 1) ? INT16_MIN : INT16_MAX;
+        y = push(&c, x);
+        CHECK(abs(y - x) <= 2);
+    }
+
+    CHECK_EQ(dsp_iir_alpha_q15(0.0f, 1000.0f), DSP_Q15_ONE);
+    CHECK_EQ(dsp_iir_alpha_q15(1.0f, 0.0f), DSP_Q15_ONE);
+    CHECK_EQ(dsp_iir_alpha_q15(1e6f, 1000.0f), DSP_Q15_ONE);
+    CHECK_EQ(dsp_iir_alpha_q15(1e-6f, 1000.0f), 1);
+}
+
+/* ---- median ---- */
+
+static int cmp16(const void *a, const void *b)
+{
+    return *(const int16_t *)a - *(const int16_t *)b;
+}
+
+static void test_median(void)
+{
+    dsp_chain_t c;
+
+    dsp_chain_init(&c);
+    dsp_chain_add_median(&c, 3);
+    static const int16_t in[]  = { 5, 1, 9, 0, 0, 1000, 0, 0, INT16_MIN, 7, INT16_MAX, 7 };
+    static const int16_t out[] = { 5, 5, 5, 1, 0, 0,    0, 0, 0,         0, 7,         7 };
+    for (size_t i = 0; i < sizeof(in) / sizeof(in[0]); i++) {
+        CHECK_EQ(push(&c, in[i]), out[i]);      /* warm-up: upper median of 2 */
+    }
+
+    CHECK(!dsp_chain_add_median(&c, 0));
+    CHECK(!dsp_chain_add_median(&c, 4));
+    CHECK(!dsp_chain_add_median(&c, DSP_MEDIAN_MAX_LEN + 2));
+
+    /* random input against qsort of the window */
+    uint32_t seed = 9;
+    int bad = 0;
+    for (uint8_t len = 1; len <= DSP_MEDIAN_MAX_LEN; len += 2) {
+        int16_t hist[1000];
+        dsp_chain_init(&c);
+        CHECK(dsp_chain_add_median(&c, len));
+        for (int i = 0; i < 1000; i++) {
+            hist[i] = (int16_t)(check_rand(&seed) % 8 == 0 ? check_rand(&seed)
+                                                            : check_rand(&seed) % 64);
+            int n = i + 1 < len ? i + 1 : len;
+            int16_t w[DSP_MEDIAN_MAX_LEN];
+            memcpy(w, &hist[i + 1 - n], n * sizeof(w[0]));
+            qsort(w, n, sizeof(w[0]), cmp16);
+            bad += push(&c, hist[i]) != w[n / 2];
+        }
+    }
+    CHECK_EQ(bad, 0);
+}
+
+/* ---- decimation and chains ---- */
+
+static void test_decimate(void)
+{
+    dsp_chain_t c;
+    int16_t y = 0;
+
+    dsp_chain_init(&c);
+    CHECK(dsp_chain_add_decimate(&c, 3));
+    for (int i = 1; i <= 9; i++) {
+        bool got = dsp_chain_process(&c, (int16_t)i, &y);
+        CHECK_EQ(got, i % 3 == 0);
+        if (got) {
+            CHECK_EQ(y, i);                     /* the sample that passes, not a mean */
+        }
+    }
+
+    dsp_chain_init(&c);
+    CHECK(dsp_chain_add_decimate(&c, 1));
+    CHECK(dsp_chain_process(&c, 1, NULL));      /* out may be NULL */
+    CHECK(!dsp_chain_add_decimate(&c, 0));
+
+    /* stages behind a decimator only see the samples that pass */
+    dsp_chain_init(&c);
+    dsp_chain_add_decimate(&c, 2);
+    dsp_chain_add_moving_avg(&c, 2);
+    CHECK(!dsp_chain_process(&c, 100, &y));
+    CHECK(dsp_chain_process(&c, 200, &y));
+    CHECK_EQ(y, 200);
+    CHECK(!dsp_chain_process(&c, 300, &y));
+    CHECK(dsp_chain_process(&c, 400, &y));
+    CHECK_EQ(y, 300);
+}
+
+static void test_chain_full_and_reset(void)
+{
+    dsp_chain_t c;
+
+    dsp_chain_init(&c);
+    CHECK(dsp_chain_add_median(&c, 3));
+    CHECK(dsp_chain_add_iir_lowpass(&c, 8192));
+    CHECK(dsp_chain_add_decimate(&c, 2));
+    CHECK(dsp_chain_add_moving_avg(&c, 5));
+    CHECK(!dsp_chain_add_moving_avg(&c, 5));    /* DSP_CHAIN_MAX_STAGES */
+    CHECK(!dsp_chain_add_decimate(&c, 1));
+    CHECK_EQ(c.count, DSP_CHAIN_MAX_STAGES);
+
+    /* the whole chain passes a constant through unchanged */
+    int16_t y = 0;
+    int passed = 0;
+    for (size_t l = 0; l < LEVELS; l++) {
+        dsp_chain_reset(&c);
+        for (int i = 0; i < 20; i++) {
+            if (dsp_chain_process(&c, s_levels[l], &y)) {
+                CHECK_EQ(y, s_levels[l]);
+                passed++;
+            }
+        }
+    }
+    CHECK_EQ(passed, 10 * (int)LEVELS);
+
+    /* reset: history gone, configuration kept */
+    for (int i = 0; i < 20; i++) {
+        dsp_chain_process(&c, 1000, &y);
+    }
+    dsp_chain_reset(&c);
+    CHECK(!dsp_chain_process(&c, -500, &y));    /* decimator counts from 0 again */
+    CHECK(dsp_chain_process(&c, -500, &y));
+    CHECK_EQ(y, -500);                          /* no trace of the 1000s */
+    CHECK_EQ(c.count, DSP_CHAIN_MAX_STAGES);
+    CHECK_EQ(c.stages[3].mavg.len, 5);
+    CHECK_EQ(c.stages[1].iir.alpha_q15, 8192);
+
+    /* an empty chain passes the input */
+    dsp_chain_init(&c);
+    CHECK_EQ(push(&c, -7), -7);
+}
+
+static void test_scale(void)
+{
+    /* 1 g = 16384 LSB -> 1000 mg, 250 dps = 32750 LSB -> 250006 mdps */
+    CHECK_EQ(dsp_scale(16384, 1000, 14), 1000);
+    CHECK_EQ(dsp_scale(-16384, 1000, 14), -1000);
+    CHECK_EQ(dsp_scale(32750, 7817, 10), 250006);
+    CHECK_EQ(dsp_q15_mul(16384, 16384), 8192);
+    CHECK_EQ(dsp_q15_mul(INT16_MIN, DSP_Q15_ONE), -32767);
+}
+
+/* ---- benchmark: float and fixed path do the same work ---- */
+
+static uint32_t s_ticks;
+
+static uint32_t fake_clock(void)
+{
+    return s_ticks += 1000;
+}
+
+static void test_bench_paths_agree(void)
+{
+    dsp_bench_result_t r;
+
+    s_ticks = 0xFFFFF000u;                      /* wraps during the run */
+    dsp_bench_run(fake_clock, 500, 1.0f, 1000.0f, &r);
+    CHECK_EQ(r.float_ticks, 2);                 /* one tick pair per path */
+    CHECK_EQ(r.fixed_ticks, 2);
+    CHECK(r.max_diff <= 40);                    /* ~5 gyro LSB of rounding */
+
+    dsp_bench_run(fake_clock, 500, 20.0f, 100.0f, &r);
+    CHECK(r.max_diff <= 40);
+}
+
+int main(void)
+{
+    RUN(test_mavg_constant);
+    RUN(test_mavg_step_and_warmup);
+    RUN(test_mavg_random);
+    RUN(test_iir_constant_and_prime);
+    RUN(test_iir_step);
+    RUN(test_median);
+    RUN(test_decimate);
+    RUN(test_chain_full_and_reset);
+    RUN(test_scale);
+    RUN(test_bench_paths_agree);
+    return check_done();
+}
@@ -0,0 +1,202 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: per-state energy accounting over deep sleep cycles
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include "check.h"
+#include "energy_acct.h"
+
+#define S   1000000LL               /* us */
+
+static energy_acct_t s_ea;          /* RTC_DATA_ATTR on the target */
+
+/* round numbers instead of a real board */
+static const energy_board_t s_board = {
+    .ua = {
+        [ENERGY_CPU]         = 1000,
+        [ENERGY_RADIO_RX]    = 10000,
+        [ENERGY_RADIO_TX]    = 100000,
+        [ENERGY_LIGHT_SLEEP] = 100,
+        [ENERGY_DEEP_SLEEP]  = 10,
+    },
+};
+
+static void fresh(void)
+{
+    memset(&s_ea, 0xA5, sizeof(s_ea));      /* power-on: RTC memory is garbage */
+    energy_acct_init(&s_ea);
+}
+
+/*
+ * One wake at wall clock wall_s: 0.5 s CPU, 0.5 s RX, 0.1 s TX, 0.1 s CPU.
+ * Charge: 600 ms x 1 mA + 500 ms x 10 mA + 100 ms x 100 mA = 15600 uAs.
+ */
+static void wake(int64_t wall_s)
+{
+    energy_acct_begin(&s_ea, wall_s * S, S / 4);
+    energy_acct_enter(&s_ea, ENERGY_RADIO_RX, S / 2);
+    energy_acct_enter(&s_ea, ENERGY_RADIO_TX, S);
+    energy_acct_enter(&s_ea, ENERGY_CPU, S + S / 10);
+    energy_acct_end(&s_ea, &s_board, S + S / 5, wall_s * S + S + S / 5 - S / 4);
+}
+
+static void test_init_keeps_valid_rtc_copy(void)
+{
+    fresh();
+    CHECK_EQ(s_ea.cycles, 0);
+    CHECK_EQ(s_ea.wall_end_us, 0);
+
+    wake(1000);
+    energy_acct_init(&s_ea);
+    CHECK_EQ(s_ea.cycles, 1);
+
+    s_ea.magic = 0;
+    energy_acct_init(&s_ea);
+    CHECK_EQ(s_ea.cycles, 0);
+    CHECK_EQ(s_ea.total_nas[ENERGY_RADIO_TX], 0);
+}
+
+/* after power-on there is no previous end: nothing is booked as deep sleep */
+static void test_first_cycle(void)
+{
+    fresh();
+    wake(1000);
+
+    CHECK_EQ(s_ea.last_ms[ENERGY_CPU], 600);
+    CHECK_EQ(s_ea.last_ms[ENERGY_RADIO_RX], 500);
+    CHECK_EQ(s_ea.last_ms[ENERGY_RADIO_TX], 100);
+    CHECK_EQ(s_ea.last_ms[ENERGY_DEEP_SLEEP], 0);
+    CHECK_EQ(s_ea.last_uas, 15600);
+    CHECK_EQ(s_ea.total_nas[ENERGY_RADIO_TX], 10000000);
+    CHECK_EQ(s_ea.wall_end_us, 1000 * S + S - S / 20);
+    CHECK_EQ(s_ea.cycles, 1);
+}
+
+/*
+ * The deep sleep is the wall clock since the last end minus what esp_timer
+ * counted since startup (that part is booked as CPU).
+ */
+static void test_deep_sleep_between_wakes(void)
+{
+    fresh();
+    wake(1000);
+    int64_t end = s_ea.wall_end_us;
+
+    energy_acct_begin(&s_ea, end + 60 * S + S / 4, S / 4);
+    CHECK_EQ(s_ea.cur_us[ENERGY_DEEP_SLEEP], 60 * S);
+    CHECK_EQ(s_ea.state, ENERGY_CPU);
+    energy_acct_end(&s_ea, &s_board, S / 4, end + 61 * S);
+    CHECK_EQ(s_ea.last_ms[ENERGY_DEEP_SLEEP], 60000);
+    CHECK_EQ(s_ea.last_ms[ENERGY_CPU], 250);
+    CHECK_EQ(s_ea.last_uas, 600 + 250);     /* 60 s x 10 uA + 250 ms x 1 mA */
+
+    /* a day of 10 uA sleep and a 15.6 mAs wake, 100 times */
+    for (int i = 0; i < 100; i++) {
+        wake(1000 + (i + 1) * 86400);
+    }
+    CHECK_EQ(s_ea.cycles, 102);
+    CHECK(s_ea.last_ms[ENERGY_DEEP_SLEEP] > 86398 * 1000u);
+    /* 86399.04 s x 10 uA = 23999.7 uAh, TX 101 x 2.78 uAh: truncated, not rounded */
+    CHECK_EQ(energy_acct_state_uah(&s_ea, ENERGY_DEEP_SLEEP), 23999);
+    CHECK_EQ(energy_acct_state_uah(&s_ea, ENERGY_RADIO_TX), 280);
+    CHECK_EQ(energy_acct_total_uah(&s_ea), 24437);
+}
+
+/* SNTP set the clock back, or forward by years: no negative or absurd sleep */
+static void test_clock_jumps(void)
+{
+    static const energy_board_t hungry = { .ua = { [ENERGY_DEEP_SLEEP] = 500000 } };
+
+    fresh();
+    wake(1000);
+    energy_acct_begin(&s_ea, 10 * S, S / 4);                /* back */
+    CHECK_EQ(s_ea.cur_us[ENERGY_DEEP_SLEEP], 0);
+    energy_acct_end(&s_ea, &s_board, S / 2, 11 * S);
+
+    energy_acct_begin(&s_ea, 11 * S + 20LL * 365 * 86400 * S, S / 4);   /* 20 years */
+    CHECK_EQ(s_ea.cur_us[ENERGY_DEEP_SLEEP], (uint64_t)UINT32_MAX * 1000);
+    energy_acct_end(&s_ea, &hungry, S / 2, 12 * S);
+    CHECK_EQ(s_ea.last_ms[ENERGY_DEEP_SLEEP], UINT32_MAX);
+    CHECK_EQ(s_ea.total_nas[ENERGY_DEEP_SLEEP], (uint64_t)UINT32_MAX * 1000 * 500000 / 1000);
+    CHECK_EQ(s_ea.last_uas, UINT32_MAX);                    /* saturated, not wrapped */
+
+    /* esp_timer later than the wall clock difference: nothing slept */
+    fresh();
+    wake(1000);
+    energy_acct_begin(&s_ea, s_ea.wall_end_us + S, 2 * S);
+    CHECK_EQ(s_ea.cur_us[ENERGY_DEEP_SLEEP], 0);
+}
+
+static void test_enter_edge_cases(void)
+{
+    fresh();
+    energy_acct_begin(&s_ea, 0, 0);
+    energy_acct_enter(&s_ea, ENERGY_RADIO_RX, 1000);
+    energy_acct_enter(&s_ea, ENERGY_RADIO_TX, 500);          /* earlier: no time */
+    CHECK_EQ(s_ea.cur_us[ENERGY_RADIO_RX], 0);
+    CHECK_EQ(s_ea.state, ENERGY_RADIO_TX);
+    energy_acct_enter(&s_ea, ENERGY_STATE_COUNT, 5000);      /* unknown: ignored */
+    energy_acct_enter(&s_ea, (energy_state_t)-1, 5000);
+    CHECK_EQ(s_ea.state, ENERGY_RADIO_TX);
+    CHECK_EQ(s_ea.t_mark_us, 1000);
+    energy_acct_enter(&s_ea, ENERGY_LIGHT_SLEEP, 3000);
+    CHECK_EQ(s_ea.cur_us[ENERGY_RADIO_TX], 2000);
+    energy_acct_enter(&s_ea, ENERGY_LIGHT_SLEEP, 4000);      /* same state: adds up */
+    energy_acct_end(&s_ea, &s_board, 6000, 0);
+    CHECK_EQ(s_ea.cur_us[ENERGY_LIGHT_SLEEP], 0);           /* cleared for the next */
+    CHECK_EQ(s_ea.last_ms[ENERGY_LIGHT_SLEEP], 3);
+    CHECK_EQ(s_ea.last_ms[ENERGY_CPU], 1);
+
+    energy_acct_delivered(&s_ea, 10);
+    energy_acct_delivered(&s_ea, UINT32_MAX - 5);
+    CHECK_EQ(s_ea.delivered, UINT32_MAX);
+    CHECK_EQ(energy_acct_state_uah(&s_ea, ENERGY_STATE_COUNT), 0);
+}
+
+static void test_format(void)
+{
+    char buf[160];
+
+    fresh();
+    wake(1000);
+    energy_acct_delivered(&s_ea, 12);
+    size_t n = energy_acct_format(&s_ea, buf, sizeof(buf));
+    CHECK_STR(buf, "e_n=1;e_smp=12;e_uah=4;e_cyc_uas=15600;e_cpu=600/0;e_rx=500/1;e_tx=100/2;");
+    CHECK_EQ(n, strlen(buf));
+
+    CHECK_STR(energy_acct_state_name(ENERGY_LIGHT_SLEEP), "light");
+    CHECK_STR(energy_acct_state_name(ENERGY_STATE_COUNT), "?");
+
+    /* every buffer size: all or nothing, never past the end */
+    CHECK_EQ(energy_acct_format(&s_ea, NULL, 0), 0);
+    for (size_t len = 1; len <= n + 1; len++) {
+        char out[160];
+        memset(out, 'X', sizeof(out));
+        size_t got = energy_acct_format(&s_ea, out, len);
+        CHECK_EQ(out[len], 'X');
+        CHECK_EQ(got, len > n ? n : 0);
+        CHECK_STR(out, len > n ? buf : "");
+    }
+}
+
+int main(void)
+{
+    RUN(test_init_keeps_valid_rtc_copy);
+    RUN(test_first_cycle);
+    RUN(test_deep_sleep_between_wakes);
+    RUN(test_clock_jumps);
+    RUN(test_enter_edge_cases);
+    RUN(test_format);
+    return check_done();
+}
@@ -0,0 +1,412 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: GPIO debouncer, event ring and gpio_input with synthetic edges
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <unistd.h>
+
+#include "check.h"
+#include "esp_timer.h"
+#include "event_ring.h"
+#include "gpio_debounce.h"
+#include "gpio_input.h"
+#include "mock/fake_gpio.h"
+
+#define DEB_US      20000       /* DEBOUNCE_US in AIoT_GPIO_Input */
+#define PIN_BUTTON  17
+#define PIN_DOOR    21
+#define PIN_PULSE   18
+
+/* ---- debouncer alone: timestamps in, no clock ---- */
+
+/* raw edges at the given times, the pin ends at 'level' */
+static bool burst(gpio_debounce_t *d, const int64_t *t, int n, uint8_t level,
+                  gpio_debounce_edge_t *out)
+{
+    for (int i = 0; i < n; i++) {
+        gpio_debounce_feed(d, t[i]);
+        /* polling inside the window never commits */
+        CHECK(!gpio_debounce_poll(d, t[i] + DEB_US - 1, DEB_US, level, out));
+    }
+    CHECK_EQ(gpio_debounce_deadline(d, DEB_US), t[n - 1] + DEB_US);
+    return gpio_debounce_poll(d, t[n - 1] + DEB_US, DEB_US, level, out);
+}
+
+static void test_clean_edge(void)
+{
+    gpio_debounce_t d;
+    gpio_debounce_edge_t e;
+    const int64_t t[] = { 1000 };
+
+    gpio_debounce_init(&d, 1);
+    CHECK_EQ(gpio_debounce_deadline(&d, DEB_US), INT64_MAX);
+    CHECK(!gpio_debounce_poll(&d, 1000000, DEB_US, 0, &e));     /* nothing pending */
+
+    CHECK(burst(&d, t, 1, 0, &e));
+    CHECK_EQ(e.timestamp_us, 1000);
+    CHECK_EQ(e.level, 0);
+    CHECK_EQ(e.bounces, 0);
+    CHECK_EQ(gpio_debounce_deadline(&d, DEB_US), INT64_MAX);
+}
+
+/* a pressed button: five raw edges within 3 ms, one event at the first */
+static void test_bouncing_contact(void)
+{
+    gpio_debounce_t d;
+    gpio_debounce_edge_t e;
+    const int64_t press[] = { 50000, 50300, 50700, 51500, 52600 };
+    const int64_t release[] = { 400000, 400150, 401900 };
+
+    gpio_debounce_init(&d, 1);
+    CHECK(burst(&d, press, 5, 0, &e));
+    CHECK_EQ(e.timestamp_us, 50000);
+    CHECK_EQ(e.level, 0);
+    CHECK_EQ(e.bounces, 4);
+
+    CHECK(burst(&d, release, 3, 1, &e));
+    CHECK_EQ(e.timestamp_us, 400000);
+    CHECK_EQ(e.level, 1);
+    CHECK_EQ(e.bounces, 2);
+    CHECK_EQ(d.glitches, 0);
+}
+
+/* a spike that ends at the old level is no edge */
+static void test_glitch(void)
+{
+    gpio_debounce_t d;
+    gpio_debounce_edge_t e;
+    const int64_t spike[] = { 7000, 7002 };
+
+    gpio_debounce_init(&d, 0);
+    CHECK(!burst(&d, spike, 2, 0, &e));
+    CHECK_EQ(d.glitches, 1);
+    CHECK_EQ(d.stable_level, 0);
+    CHECK_EQ(gpio_debounce_deadline(&d, DEB_US), INT64_MAX);
+}
+
+/* edges closer than the window never settle: the deadline keeps moving */
+static void test_chatter_never_settles(void)
+{
+    gpio_debounce_t d;
+    gpio_debounce_edge_t e;
+
+    gpio_debounce_init(&d, 0);
+    for (int64_t t = 0; t < 1000000; t += DEB_US / 2) {
+        gpio_debounce_feed(&d, t);
+        CHECK(!gpio_debounce_poll(&d, t + DEB_US / 2 - 1, DEB_US, 1, &e));
+        CHECK_EQ(gpio_debounce_deadline(&d, DEB_US), t + DEB_US);
+    }
+    CHECK(gpio_debounce_poll(&d, 1000000 + DEB_US, DEB_US, 1, &e));
+    CHECK_EQ(e.timestamp_us, 0);
+    CHECK_EQ(e.bounces, 1000000 / (DEB_US / 2) - 1);
+}
+
+static void test_bounce_count_saturates(void)
+{
+    gpio_debounce_t d;
+    gpio_debounce_edge_t e;
+
+    gpio_debounce_init(&d, 0);
+    for (int64_t t = 0; t < 70000; t++) {
+        gpio_debounce_feed(&d, t);
+    }
+    CHECK(gpio_debounce_poll(&d, 70000 + DEB_US, DEB_US, 1, &e));
+    CHECK_EQ(e.bounces, UINT16_MAX);
+}
+
+/* ---- event ring ---- */
+
+static void test_event_ring(void)
+{
+    static event_ring_t r;
+    sample_event_t ev;
+
+    event_ring_init(&r);
+    CHECK(!event_ring_pop(&r, &ev));
+
+    /* counters close to the wrap of unsigned */
+    atomic_store(&r.head, UINT32_MAX - 10);
+    atomic_store(&r.tail, UINT32_MAX - 10);
+
+    for (int i = 0; i < EVENT_RING_SIZE; i++) {
+        ev = (sample_event_t){ .timestamp_us = i, .source = (uint8_t)i };
+        CHECK(event_ring_push(&r, &ev));
+    }
+    ev.timestamp_us = -1;
+    CHECK(!event_ring_push(&r, &ev));       /* full */
+
+    for (int i = 0; i < EVENT_RING_SIZE; i++) {
+        CHECK(event_ring_pop(&r, &ev));
+        CHECK_EQ(ev.timestamp_us, i);
+        CHECK_EQ(ev.source, i);
+    }
+    CHECK(!event_ring_pop(&r, &ev));
+}
+
+/* ---- gpio_input: ISR, worker, timer and queue, in real time ---- */
+
+static uint8_t s_button, s_door;
+
+static void test_start_unwinds(void)
+{
+    int objects = host_live_objects();
+    int timers = host_live_timers();
+
+    host_fail_timer_create = ESP_ERR_NO_MEM;
+    CHECK_EQ(gpio_input_start(5), ESP_ERR_NO_MEM);
+    CHECK_EQ(host_live_objects(), objects);
+
+    host_fail_create_after = 1;             /* queue ok, worker task fails */
+    CHECK_EQ(gpio_input_start(5), ESP_ERR_NO_MEM);
+    host_fail_create_after = -1;
+    CHECK_EQ(host_live_objects(), objects);
+    CHECK_EQ(host_live_timers(), timers);
+
+    gpio_input_pin_config_t cfg = { .gpio = PIN_BUTTON, .debounce_us = DEB_US };
+    CHECK_EQ(gpio_input_add_pin(&cfg, &s_button), ESP_ERR_INVALID_STATE);
+
+    CHECK_EQ(gpio_input_start(5), ESP_OK);
+    CHECK_EQ(gpio_input_start(5), ESP_OK);  /* once */
+    CHECK_EQ(host_live_timers(), timers + 1);
+}
+
+static void test_add_pins(void)
+{
+    gpio_input_pin_config_t button = { .gpio = PIN_BUTTON, .pull_up = true, .debounce_us = DEB_US };
+    gpio_input_pin_config_t door = { .gpio = PIN_DOOR, .debounce_us = DEB_US / 2 };
+    uint8_t id = 99;
+
+    fake_gpio_reset();
+    fake_gpio_set(PIN_BUTTON, 1);           /* pull-up: idle high */
+    fake_gpio_set(PIN_DOOR, 0);
+
+    g_fake_gpio.fail_isr_add = ESP_ERR_INVALID_STATE;
+    CHECK_EQ(gpio_input_add_pin(&button, &id), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(id, 99);
+    g_fake_gpio.fail_isr_add = ESP_OK;
+
+    CHECK_EQ(gpio_input_add_pin(&button, &s_button), ESP_OK);
+    CHECK_EQ(gpio_input_add_pin(&door, &s_door), ESP_OK);
+    CHECK_EQ(s_button, 0);                  /* failed add took no slot */
+    CHECK_EQ(s_door, 1);
+
+    gpio_input_stats_t st;
+    CHECK_EQ(gpio_input_get_stats(2, &st), ESP_ERR_INVALID_ARG);
+}
+
+/* raw edges 'gap_us' apart, alternating, starting from the current level */
+static int64_t bounce(gpio_num_t gpio, int edges, useconds_t gap_us)
+{
+    int64_t first = esp_timer_get_time();
+    for (int i = 0; i < edges; i++) {
+        fake_gpio_set(gpio, !gpio_get_level(gpio));
+        if (i + 1 < edges) {
+            usleep(gap_us);
+        }
+    }
+    return first;
+}
+
+static void test_bouncy_press_is_one_event(void)
+{
+    gpio_input_event_t ev;
+    gpio_input_stats_t st;
+
+    int64_t first = bounce(PIN_BUTTON, 5, 300);     /* 1 -> ... -> 0 */
+    int64_t last = esp_timer_get_time();
+
+    CHECK(gpio_input_receive(&ev, pdMS_TO_TICKS(500)));
+    int64_t got = esp_timer_get_time();
+    CHECK_EQ(ev.gpio, PIN_BUTTON);
+    CHECK_EQ(ev.id, s_button);
+    CHECK_EQ(ev.level, 0);
+    CHECK_EQ(ev.bounces, 4);
+    CHECK(ev.timestamp_us >= first && ev.timestamp_us < last);
+    CHECK(got - last >= DEB_US - 1000);     /* not before the quiet window */
+
+    CHECK(!gpio_input_receive(&ev, pdMS_TO_TICKS(3 * DEB_US / 1000)));
+
+    CHECK_EQ(gpio_input_get_stats(s_button, &st), ESP_OK);
+    CHECK_EQ(st.edges, 1);
+    CHECK_EQ(st.raw_edges, 5);
+    CHECK_EQ(st.glitches, 0);
+    CHECK_EQ(st.dropped, 0);
+}
+
+static void test_spike_is_a_glitch(void)
+{
+    gpio_input_event_t ev;
+    gpio_input_stats_t st;
+
+    bounce(PIN_BUTTON, 2, 100);             /* 0 -> 1 -> 0 */
+    CHECK(!gpio_input_receive(&ev, pdMS_TO_TICKS(3 * DEB_US / 1000)));
+
+    CHECK_EQ(gpio_input_get_stats(s_button, &st), ESP_OK);
+    CHECK_EQ(st.edges, 1);
+    CHECK_EQ(st.raw_edges, 7);
+    CHECK_EQ(st.glitches, 1);
+}
+
+/* two pins with different windows, the timer serves the earlier deadline */
+static void test_two_pins_interleaved(void)
+{
+    gpio_input_event_t ev;
+
+    bounce(PIN_BUTTON, 3, 200);             /* 0 -> 1, 20 ms window */
+    bounce(PIN_DOOR, 1, 0);                 /* 0 -> 1, 10 ms window */
+
+    CHECK(gpio_input_receive(&ev, pdMS_TO_TICKS(500)));
+    CHECK_EQ(ev.id, s_door);
+    CHECK_EQ(ev.level, 1);
+    CHECK_EQ(ev.bounces, 0);
+
+    CHECK(gpio_input_receive(&ev, pdMS_TO_TICKS(500)));
+    CHECK_EQ(ev.id, s_button);
+    CHECK_EQ(ev.level, 1);
+    CHECK_EQ(ev.bounces, 2);
+}
+
+/* nobody reads: the queue holds GPIO_INPUT_QUEUE_LEN, the rest is counted */
+static void test_queue_full_counts_dropped(void)
+{
+    gpio_input_event_t ev;
+    gpio_input_stats_t before, after;
+    const int extra = 4;
+
+    CHECK_EQ(gpio_input_get_stats(s_door, &before), ESP_OK);
+    for (int i = 0; i < GPIO_INPUT_QUEUE_LEN + extra; i++) {
+        bounce(PIN_DOOR, 1, 0);
+        /* next edge only once this one was queued or dropped (a late timer would merge them) */
+        for (int t = 0; t < 100; t++) {
+            usleep(DEB_US / 4);
+            gpio_input_get_stats(s_door, &after);
+            if (after.edges + after.dropped - before.edges - before.dropped > (uint32_t)i) {
+                break;
+            }
+        }
+    }
+
+    CHECK_EQ(gpio_input_get_stats(s_door, &after), ESP_OK);
+    CHECK_EQ(after.edges - before.edges, GPIO_INPUT_QUEUE_LEN);
+    CHECK_EQ(after.dropped - before.dropped, extra);
+
+    int n = 0;
+    uint8_t level = 0;                      /* door was high: first event is low */
+    while (gpio_input_receive(&ev, 0)) {
+        CHECK_EQ(ev.level, level);
+        level = !level;
+        n++;
+    }
+    CHECK_EQ(n, GPIO_INPUT_QUEUE_LEN);
+}
+
+/* ---- pulse counters (PCNT) ---- */
+
+static void test_counter_setup_unwinds(void)
+{
+    uint8_t id = 99;
+
+    /*
+     * with a glitch filter there are 8 failable PCNT calls: unit, filter,
+     * channel, edge action, watch point, enable, clear, start
+     */
+    for (uint32_t step = 1; step <= 8; step++) {
+        fake_gpio_reset();
+        g_fake_gpio.fail_pcnt_call = step;
+        CHECK_EQ(gpio_input_add_counter(PIN_PULSE, true, 1000, &id), ESP_FAIL);
+        CHECK_EQ(g_fake_gpio.pcnt_calls, step);
+        CHECK_EQ(g_fake_gpio.live_units, 0);
+        CHECK_EQ(g_fake_gpio.live_channels, 0);
+        CHECK_EQ(g_fake_gpio.enabled_units, 0);
+        CHECK_EQ(id, 99);
+    }
+
+    /* the filter is optional */
+    fake_gpio_reset();
+    g_fake_gpio.fail_pcnt_call = 2;
+    CHECK_EQ(gpio_input_add_counter(PIN_PULSE, false, 0, &id), ESP_FAIL);
+    CHECK_EQ(g_fake_gpio.live_units, 0);
+    CHECK_EQ(g_fake_gpio.pcnt_calls, 2);
+
+    /* above the hardware limit */
+    fake_gpio_reset();
+    CHECK_EQ(gpio_input_add_counter(PIN_PULSE, false, 20000, &id), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(g_fake_gpio.live_units, 0);
+}
+
+static void test_counter_counts(void)
+{
+    uint8_t id, id2;
+    int count = -1;
+
+    fake_gpio_reset();
+    CHECK_EQ(gpio_input_add_counter(PIN_PULSE, true, 1000, &id), ESP_OK);
+    CHECK_EQ(id, 0);
+    CHECK_EQ(g_fake_gpio.live_units, 1);
+    CHECK_EQ(g_fake_gpio.enabled_units, 1);
+
+    CHECK_EQ(gpio_input_get_count(id, &count), ESP_OK);
+    CHECK_EQ(count, 0);
+    fake_gpio_pulses(PIN_PULSE, 100);
+    fake_gpio_pulses(PIN_PULSE, 40000);     /* beyond the 16 bit unit */
+    CHECK_EQ(gpio_input_get_count(id, &count), ESP_OK);
+    CHECK_EQ(count, 40100);
+
+    CHECK_EQ(gpio_input_clear_count(id), ESP_OK);
+    CHECK_EQ(gpio_input_get_count(id, &count), ESP_OK);
+    CHECK_EQ(count, 0);
+
+    CHECK_EQ(gpio_input_add_counter(PIN_PULSE + 1, false, 0, &id2), ESP_OK);
+    CHECK_EQ(id2, 1);
+    fake_gpio_pulses(PIN_PULSE + 1, 7);
+    CHECK_EQ(gpio_input_get_count(id2, &count), ESP_OK);
+    CHECK_EQ(count, 7);
+    CHECK_EQ(gpio_input_get_count(id, &count), ESP_OK);
+    CHECK_EQ(count, 0);
+
+    CHECK_EQ(gpio_input_get_count(2, &count), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(gpio_input_clear_count(2), ESP_ERR_INVALID_ARG);
+}
+
+static void test_counter_limit(void)
+{
+    uint8_t id;
+
+    for (int i = 2; i < GPIO_INPUT_MAX_COUNTERS; i++) {
+        CHECK_EQ(gpio_input_add_counter(PIN_PULSE + i, false, 0, &id), ESP_OK);
+    }
+    CHECK_EQ(gpio_input_add_counter(PIN_PULSE + 9, false, 0, &id), ESP_ERR_NO_MEM);
+}
+
+int main(void)
+{
+    RUN(test_clean_edge);
+    RUN(test_bouncing_contact);
+    RUN(test_glitch);
+    RUN(test_chatter_never_settles);
+    RUN(test_bounce_count_saturates);
+    RUN(test_event_ring);
+
+    RUN(test_start_unwinds);
+    RUN(test_add_pins);
+    RUN(test_bouncy_press_is_one_event);
+    RUN(test_spike_is_a_glitch);
+    RUN(test_two_pins_interleaved);
+    RUN(test_queue_full_counts_dropped);
+
+    RUN(test_counter_setup_unwinds);
+    RUN(test_counter_counts);
+    RUN(test_counter_limit);
+    return check_done();
+}
@@ -0,0 +1,311 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: aiot_i2c_bus on the simulated bus
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * The component is a singleton without deinit, so the order matters: first
+ * every init error path (each must leave nothing behind and allow a retry),
+ * then one successful init through the i2c_master driver path, then the
+ * device and transaction API against the simulated devices.
+ */
+
+#include "check.h"
+#include "i2c_bus.h"
+#include "mock/fake_i2c.h"
+#include "freertos/task.h"
+
+#define MPU_ADDR    0x68
+#define BMP_ADDR    0x76
+
+static mock_mpu6050_t s_mpu;
+
+static const i2c_bus_config_t s_cfg = {
+    .port = I2C_NUM_0,
+    .sda_io = 8,
+    .scl_io = 9,
+    .internal_pullup = true,
+};
+
+static void check_nothing_left(void)
+{
+    CHECK_EQ(g_fake_i2c.live_buses, 0);
+    CHECK_EQ(host_live_objects(), 0);
+}
+
+static void test_not_initialised(void)
+{
+    i2c_bus_dev_t dev = NULL;
+    CHECK_EQ(i2c_bus_add_device(MPU_ADDR, 400000, &dev), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(i2c_bus_probe(MPU_ADDR, 10), ESP_ERR_INVALID_STATE);
+    CHECK(i2c_bus_txn_alloc(NULL) == NULL);
+    CHECK_EQ(i2c_bus_init(NULL), ESP_ERR_INVALID_ARG);
+    check_nothing_left();
+}
+
+static void test_init_driver_error(void)
+{
+    g_fake_i2c.fail_new_bus = ESP_ERR_INVALID_ARG;
+    CHECK_EQ(i2c_bus_init(&s_cfg), ESP_ERR_INVALID_ARG);
+    g_fake_i2c.fail_new_bus = ESP_OK;
+    check_nothing_left();
+}
+
+/* mutex, free queue, pending queue, task: each failure unwinds the rest */
+static void test_init_unwinds_every_step(void)
+{
+    for (int step = 0; step < 4; step++) {
+        host_fail_create_after = step;
+        CHECK_EQ(i2c_bus_init(&s_cfg), ESP_ERR_NO_MEM);
+        host_fail_create_after = -1;
+        check_nothing_left();
+        CHECK(i2c_bus_get_handle() == NULL);
+    }
+}
+
+static void test_init_after_failures(void)
+{
+    CHECK_EQ(i2c_bus_init(&s_cfg), ESP_OK);
+    CHECK_EQ(g_fake_i2c.live_buses, 1);
+    CHECK(i2c_bus_get_handle() != NULL);
+
+    /* a second init is a no-op */
+    CHECK_EQ(i2c_bus_init(&s_cfg), ESP_OK);
+    CHECK_EQ(g_fake_i2c.live_buses, 1);
+}
+
+static void test_sync_register_access(void)
+{
+    i2c_bus_dev_t mpu = NULL;
+    uint8_t v = 0;
+
+    CHECK_EQ(i2c_bus_add_device(MPU_ADDR, 400000, &mpu), ESP_OK);
+    CHECK_EQ(i2c_bus_dev_addr(mpu), MPU_ADDR);
+    CHECK_EQ(i2c_bus_read_reg(mpu, 0x75, &v, 1), ESP_OK);
+    CHECK_EQ(v, 0x68);
+
+    CHECK_EQ(i2c_bus_write_reg(mpu, 0x6B, 0x00), ESP_OK);
+    CHECK_EQ(s_mpu.regs[0x6B], 0x00);
+    CHECK_EQ(i2c_bus_write_reg(mpu, 0x19, 9), ESP_OK);
+    CHECK_EQ(i2c_bus_read_reg(mpu, 0x19, &v, 1), ESP_OK);
+    CHECK_EQ(v, 9);
+
+    /* re-target the same handle */
+    CHECK_EQ(i2c_bus_dev_set_addr(mpu, BMP_ADDR), ESP_OK);
+    CHECK_EQ(i2c_bus_read_reg(mpu, 0xD0, &v, 1), ESP_OK);
+    CHECK_EQ(v, 0x58);
+    CHECK_EQ(i2c_bus_dev_set_addr(mpu, 0x50), ESP_OK);
+    CHECK(i2c_bus_read_reg(mpu, 0xD0, &v, 1) != ESP_OK);    /* NACK */
+
+    CHECK_EQ(i2c_bus_remove_device(mpu), ESP_OK);
+    CHECK_EQ(i2c_bus_remove_device(mpu), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(g_fake_i2c.live_devices, 0);
+}
+
+static void test_probe(void)
+{
+    CHECK_EQ(i2c_bus_probe(MPU_ADDR, 10), ESP_OK);
+    CHECK_EQ(i2c_bus_probe(BMP_ADDR, 10), ESP_OK);
+    CHECK(i2c_bus_probe(0x3C, 10) != ESP_OK);
+
+    fake_i2c_remove(BMP_ADDR);
+    CHECK(i2c_bus_probe(BMP_ADDR, 10) != ESP_OK);
+    fake_i2c_add(BMP_ADDR, 0xD0, 0x58);
+}
+
+static void test_device_table(void)
+{
+    i2c_bus_dev_t dev[I2C_BUS_MAX_DEVICES];
+    i2c_bus_dev_t extra = NULL;
+
+    /* driver refuses: slot stays free, nothing allocated */
+    g_fake_i2c.fail_add_device = ESP_ERR_NO_MEM;
+    CHECK_EQ(i2c_bus_add_device(MPU_ADDR, 400000, &extra), ESP_ERR_NO_MEM);
+    g_fake_i2c.fail_add_device = ESP_OK;
+    CHECK_EQ(g_fake_i2c.live_devices, 0);
+
+    for (int i = 0; i < I2C_BUS_MAX_DEVICES; i++) {
+        CHECK_EQ(i2c_bus_add_device((uint8_t)(0x10 + i), 100000, &dev[i]), ESP_OK);
+    }
+    CHECK_EQ(i2c_bus_add_device(0x30, 100000, &extra), ESP_ERR_NO_MEM);
+    CHECK_EQ(i2c_bus_remove_device(dev[3]), ESP_OK);
+    CHECK_EQ(i2c_bus_add_device(0x30, 100000, &dev[3]), ESP_OK);
+    CHECK_EQ(i2c_bus_dev_addr(dev[3]), 0x30);
+
+    for (int i = 0; i < I2C_BUS_MAX_DEVICES; i++) {
+        CHECK_EQ(i2c_bus_remove_device(dev[i]), ESP_OK);
+    }
+    CHECK_EQ(g_fake_i2c.live_devices, 0);
+}
+
+static int s_cb_count;
+
+static void on_done(i2c_bus_txn_t *txn, void *ctx)
+{
+    (void)txn;
+    CHECK(ctx == &s_cb_count);
+    s_cb_count++;
+}
+
+static void test_async_pool(void)
+{
+    static uint8_t rx[I2C_BUS_POOL_SIZE][14];
+    i2c_bus_txn_t *txn[I2C_BUS_POOL_SIZE];
+    i2c_bus_dev_t mpu = NULL;
+    uint32_t before = i2c_bus_completed_count();
+
+    CHECK_EQ(i2c_bus_add_device(MPU_ADDR, 400000, &mpu), ESP_OK);
+    for (int i = 0; i < I2C_BUS_POOL_SIZE; i++) {
+        txn[i] = i2c_bus_txn_alloc(mpu);
+        CHECK(txn[i] != NULL);
+    }
+    CHECK(i2c_bus_txn_alloc(mpu) == NULL);      /* pool empty, no malloc */
+
+    s_cb_count = 0;
+    for (int i = 0; i < I2C_BUS_POOL_SIZE; i++) {
+        i2c_bus_txn_set_read_reg(txn[i], 0x75, rx[i], 1);
+        txn[i]->notify_task = xTaskGetCurrentTaskHandle();
+        txn[i]->on_done = on_done;
+        txn[i]->user_ctx = &s_cb_count;
+        CHECK_EQ(i2c_bus_submit(txn[i]), ESP_OK);
+    }
+    for (int i = 0; i < I2C_BUS_POOL_SIZE; i++) {
+        CHECK_EQ(i2c_bus_wait(txn[i], pdMS_TO_TICKS(1000)), ESP_OK);
+        CHECK_EQ(rx[i][0], 0x68);
+        CHECK(txn[i]->done_us >= txn[i]->submitted_us);
+        i2c_bus_txn_free(txn[i]);
+    }
+    CHECK_EQ(s_cb_count, I2C_BUS_POOL_SIZE);
+    CHECK_EQ(i2c_bus_completed_count() - before, I2C_BUS_POOL_SIZE);
+
+    /* errors come back in the transaction */
+    i2c_bus_txn_t *t = i2c_bus_txn_alloc(mpu);
+    CHECK_EQ(i2c_bus_dev_set_addr(mpu, 0x50), ESP_OK);
+    i2c_bus_txn_set_read_reg(t, 0x75, rx[0], 1);
+    t->notify_task = xTaskGetCurrentTaskHandle();
+    CHECK_EQ(i2c_bus_submit(t), ESP_OK);
+    CHECK(i2c_bus_wait(t, pdMS_TO_TICKS(1000)) != ESP_OK);
+
+    t->tx_len = I2C_BUS_TXN_MAX_TX + 1;
+    CHECK_EQ(i2c_bus_submit(t), ESP_ERR_INVALID_ARG);
+    t->dev = NULL;
+    CHECK_EQ(i2c_bus_submit(t), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(i2c_bus_submit(NULL), ESP_ERR_INVALID_ARG);
+    i2c_bus_txn_free(t);
+
+    CHECK_EQ(i2c_bus_remove_device(mpu), ESP_OK);
+}
+
+/* a wait that times out leaves the transaction to the bus task */
+static void test_wait_timeout_keeps_txn(void)
+{
+    static uint8_t rx[2];
+    i2c_bus_dev_t mpu = NULL;
+
+    CHECK_EQ(i2c_bus_add_device(MPU_ADDR, 400000, &mpu), ESP_OK);
+    i2c_bus_txn_t *t = i2c_bus_txn_alloc(mpu);
+    i2c_bus_txn_set_read_reg(t, 0x75, rx, 1);
+    t->notify_task = xTaskGetCurrentTaskHandle();
+
+    rx[0] = 0;
+    g_fake_i2c.xfer_delay_ms = 50;
+    CHECK_EQ(i2c_bus_submit(t), ESP_OK);
+    CHECK_EQ(i2c_bus_wait(t, pdMS_TO_TICKS(5)), ESP_ERR_TIMEOUT);
+    CHECK(!t->done);
+    CHECK_EQ(rx[0], 0);                         /* not written yet */
+
+    /* waiting again collects the result; only now may it be freed */
+    CHECK_EQ(i2c_bus_wait(t, pdMS_TO_TICKS(1000)), ESP_OK);
+    CHECK(t->done);
+    CHECK_EQ(rx[0], 0x68);
+    g_fake_i2c.xfer_delay_ms = 0;
+    i2c_bus_txn_free(t);
+
+    CHECK_EQ(i2c_bus_remove_device(mpu), ESP_OK);
+}
+
+/* a sync reader and the bus task share the bus: every answer must fit */
+static volatile int s_reader_errors;
+static volatile bool s_reader_done;
+
+static void sync_reader(void *arg)
+{
+    i2c_bus_dev_t dev = arg;
+    for (int i = 0; i < 500; i++) {
+        uint8_t v = 0;
+        if (i2c_bus_read_reg(dev, 0xD0, &v, 1) != ESP_OK || v != 0x58) {
+            s_reader_errors++;
+        }
+    }
+    s_reader_done = true;
+    vTaskDelete(NULL);
+}
+
+static void test_sync_and_async_share_the_bus(void)
+{
+    i2c_bus_dev_t mpu = NULL;
+    i2c_bus_dev_t bmp = NULL;
+    CHECK_EQ(i2c_bus_add_device(MPU_ADDR, 400000, &mpu), ESP_OK);
+    CHECK_EQ(i2c_bus_add_device(BMP_ADDR, 400000, &bmp), ESP_OK);
+
+    s_reader_done = false;
+    CHECK(xTaskCreate(sync_reader, "reader", 4096, bmp, 5, NULL) == pdPASS);
+
+    int errors = 0;
+    for (int round = 0; round < 100; round++) {
+        uint8_t rx[4][1];
+        i2c_bus_txn_t *t[4];
+        for (int i = 0; i < 4; i++) {
+            t[i] = i2c_bus_txn_alloc(mpu);
+            i2c_bus_txn_set_read_reg(t[i], 0x75, rx[i], 1);
+            t[i]->notify_task = xTaskGetCurrentTaskHandle();
+            i2c_bus_submit(t[i]);
+        }
+        for (int i = 0; i < 4; i++) {
+            if (i2c_bus_wait(t[i], pdMS_TO_TICKS(1000)) != ESP_OK || rx[i][0] != 0x68) {
+                errors++;
+            }
+            i2c_bus_txn_free(t[i]);
+        }
+    }
+    for (int i = 0; i < 2000 && !s_reader_done; i++) {
+        vTaskDelay(1);
+    }
+    CHECK(s_reader_done);
+    CHECK_EQ(errors, 0);
+    CHECK_EQ(s_reader_errors, 0);
+
+    CHECK_EQ(i2c_bus_remove_device(mpu), ESP_OK);
+    CHECK_EQ(i2c_bus_remove_device(bmp), ESP_OK);
+}
+
+int main(void)
+{
+    fake_i2c_reset();
+    mock_mpu6050_init(&s_mpu, 0);
+    fake_i2c_add_mpu(MPU_ADDR, &s_mpu);
+    fake_i2c_add(BMP_ADDR, 0xD0, 0x58);
+
+    RUN(test_not_initialised);
+    RUN(test_init_driver_error);
+    RUN(test_init_unwinds_every_step);
+    RUN(test_init_after_failures);
+    RUN(test_sync_register_access);
+    RUN(test_probe);
+    RUN(test_device_table);
+    RUN(test_async_pool);
+    RUN(test_wait_timeout_keeps_txn);
+    RUN(test_sync_and_async_share_the_bus);
+    return check_done();
+}
@@ -0,0 +1,225 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: I2C scanner, fingerprints and cache on the simulated bus
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include "check.h"
+#include "i2c_bus.h"
+#include "i2c_scan.h"
+#include "nvs.h"
+#include "mock/fake_i2c.h"
+
+#define ADDR_COUNT  (0x77 - 0x08 + 1)   /* valid 7 bit addresses */
+#define TIMEOUT_MS  2
+
+static mock_mpu6050_t s_mpu;
+
+/* the book's bench: MPU6050, BME280, an OLED without ID register */
+static void bench_bus(void)
+{
+    fake_i2c_reset();
+    mock_mpu6050_init(&s_mpu, 0);
+    fake_i2c_add_mpu(0x68, &s_mpu);
+    fake_i2c_add(0x76, 0xD0, 0x60);
+    fake_i2c_add(0x3C, 0x00, 0x00);
+}
+
+static const i2c_scan_device_t *find(const i2c_scan_map_t *m, uint8_t addr)
+{
+    for (int i = 0; i < m->count; i++) {
+        if (m->dev[i].addr == addr) {
+            return &m->dev[i];
+        }
+    }
+    return NULL;
+}
+
+static void test_full_scan_fingerprints(void)
+{
+    i2c_scan_map_t map;
+    i2c_scan_result_t res;
+
+    bench_bus();
+    CHECK_EQ(i2c_scan_full(&map, TIMEOUT_MS, &res), ESP_OK);
+    CHECK_EQ(res.probed, ADDR_COUNT);
+    CHECK_EQ(g_fake_i2c.probes, ADDR_COUNT);
+    CHECK(!res.from_cache);
+    CHECK_EQ(map.count, 3);
+
+    /* ascending address order */
+    CHECK_EQ(map.dev[0].addr, 0x3C);
+    CHECK_EQ(map.dev[1].addr, 0x68);
+    CHECK_EQ(map.dev[2].addr, 0x76);
+
+    CHECK_STR(i2c_scan_type_name(find(&map, 0x68)->type), "MPU6050");
+    CHECK_EQ(find(&map, 0x68)->id_reg, 0x75);
+    CHECK_EQ(find(&map, 0x68)->id_val, 0x68);
+    CHECK_STR(i2c_scan_type_name(find(&map, 0x76)->type), "BME280");
+    CHECK_STR(i2c_scan_type_name(find(&map, 0x3C)->type), "?");
+    CHECK_EQ(find(&map, 0x3C)->id_reg, 0);
+}
+
+/* MPU6050/6500/9250 share WHO_AM_I: one read decides between them */
+static void test_same_id_register_read_once(void)
+{
+    i2c_scan_map_t map;
+
+    fake_i2c_reset();
+    fake_i2c_add(0x69, 0x75, 0x71);
+    CHECK_EQ(i2c_scan_full(&map, TIMEOUT_MS, NULL), ESP_OK);
+    CHECK_EQ(map.count, 1);
+    CHECK_STR(i2c_scan_type_name(map.dev[0].type), "MPU9250");
+    CHECK_EQ(g_fake_i2c.xfers, 1);
+
+    /* wrong ID at a known address: present, but unknown */
+    fake_i2c_reset();
+    fake_i2c_add(0x77, 0xD0, 0x12);
+    CHECK_EQ(i2c_scan_full(&map, TIMEOUT_MS, NULL), ESP_OK);
+    CHECK_EQ(map.count, 1);
+    CHECK_STR(i2c_scan_type_name(map.dev[0].type), "?");
+}
+
+static void test_map_limit(void)
+{
+    i2c_scan_map_t map;
+
+    fake_i2c_reset();
+    for (int i = 0; i < I2C_SCAN_MAX_DEVICES; i++) {
+        fake_i2c_add((uint8_t)(0x40 + i), 0, 0);
+    }
+    fake_i2c_add(0x08, 0, 0);       /* first valid address, one too many */
+    CHECK_EQ(i2c_scan_full(&map, TIMEOUT_MS, NULL), ESP_OK);
+    CHECK_EQ(map.count, I2C_SCAN_MAX_DEVICES);
+    CHECK_EQ(map.dev[0].addr, 0x08);
+    CHECK_EQ(map.dev[I2C_SCAN_MAX_DEVICES - 1].addr, 0x40 + I2C_SCAN_MAX_DEVICES - 2);
+}
+
+static void test_stuck_bus_finds_nothing(void)
+{
+    i2c_scan_map_t map;
+
+    bench_bus();
+    g_fake_i2c.fail_xfer = ESP_ERR_TIMEOUT;
+    CHECK_EQ(i2c_scan_full(&map, TIMEOUT_MS, NULL), ESP_OK);
+    CHECK_EQ(map.count, 0);
+    g_fake_i2c.fail_xfer = ESP_OK;
+}
+
+static void test_verify(void)
+{
+    i2c_scan_map_t map;
+    i2c_scan_result_t res;
+
+    bench_bus();
+    CHECK_EQ(i2c_scan_full(&map, TIMEOUT_MS, NULL), ESP_OK);
+
+    g_fake_i2c.probes = 0;
+    CHECK(i2c_scan_verify(&map, TIMEOUT_MS, &res));
+    CHECK(res.from_cache);
+    CHECK_EQ(res.probed, 3);
+    CHECK_EQ(g_fake_i2c.probes, 3);     /* cheap: known addresses only */
+
+    /* unplugged */
+    fake_i2c_remove(0x3C);
+    CHECK(!i2c_scan_verify(&map, TIMEOUT_MS, &res));
+    CHECK(!res.from_cache);
+    fake_i2c_add(0x3C, 0, 0);
+
+    /* swapped for another chip at the same address */
+    fake_i2c_add(0x76, 0xD0, 0x58);
+    CHECK(!i2c_scan_verify(&map, TIMEOUT_MS, NULL));
+    fake_i2c_add(0x76, 0xD0, 0x60);
+    CHECK(i2c_scan_verify(&map, TIMEOUT_MS, NULL));
+}
+
+/*
+ * Why AIoT_I2C_Test needs a periodic full scan: verify only looks at the
+ * known addresses, a device plugged in later (or any device on a bus that
+ * was empty at boot) goes unnoticed.
+ */
+static void test_verify_misses_new_devices(void)
+{
+    i2c_scan_map_t map;
+
+    fake_i2c_reset();
+    CHECK_EQ(i2c_scan_full(&map, TIMEOUT_MS, NULL), ESP_OK);
+    CHECK_EQ(map.count, 0);
+
+    fake_i2c_add(0x76, 0xD0, 0x60);
+    CHECK(i2c_scan_verify(&map, TIMEOUT_MS, NULL));     /* empty map: always "ok" */
+
+    CHECK_EQ(i2c_scan_full(&map, TIMEOUT_MS, NULL), ESP_OK);
+    CHECK_EQ(map.count, 1);
+
+    fake_i2c_add(0x68, 0x75, 0x68);
+    CHECK(i2c_scan_verify(&map, TIMEOUT_MS, NULL));     /* new 0x68 not seen */
+    CHECK_EQ(i2c_scan_full(&map, TIMEOUT_MS, NULL), ESP_OK);
+    CHECK_EQ(map.count, 2);
+}
+
+static void test_cache(void)
+{
+    i2c_scan_map_t map;
+    i2c_scan_result_t res;
+
+    bench_bus();
+    host_nvs_erase_all();
+    i2c_scan_cache_clear();
+
+    /* first boot: full scan, stored in RTC and NVS */
+    CHECK_EQ(i2c_scan_cached(&map, TIMEOUT_MS, &res), ESP_OK);
+    CHECK(!res.from_cache);
+    CHECK_EQ(res.probed, ADDR_COUNT);
+    CHECK_EQ(map.count, 3);
+    CHECK_EQ(host_nvs_writes(), 1);
+
+    /* next wake: only the three known addresses */
+    memset(&map, 0, sizeof(map));
+    CHECK_EQ(i2c_scan_cached(&map, TIMEOUT_MS, &res), ESP_OK);
+    CHECK(res.from_cache);
+    CHECK_EQ(res.probed, 3);
+    CHECK_EQ(map.count, 3);
+    CHECK_EQ(host_nvs_writes(), 1);     /* no flash write when nothing changed */
+
+    /* bus changed: full scan, new map stored */
+    fake_i2c_remove(0x68);
+    CHECK_EQ(i2c_scan_cached(&map, TIMEOUT_MS, &res), ESP_OK);
+    CHECK(!res.from_cache);
+    CHECK_EQ(map.count, 2);
+    CHECK(find(&map, 0x68) == NULL);
+    CHECK_EQ(host_nvs_writes(), 2);
+
+    /* cleared cache forces a full scan */
+    i2c_scan_cache_clear();
+    CHECK_EQ(i2c_scan_cached(&map, TIMEOUT_MS, &res), ESP_OK);
+    CHECK(!res.from_cache);
+}
+
+int main(void)
+{
+    i2c_bus_config_t cfg = { .port = I2C_NUM_0, .sda_io = 8, .scl_io = 9 };
+    i2c_bus_set_backend(&fake_i2c_backend);
+    if (i2c_bus_init(&cfg) != ESP_OK) {
+        return 1;
+    }
+
+    RUN(test_full_scan_fingerprints);
+    RUN(test_same_id_register_read_once);
+    RUN(test_map_limit);
+    RUN(test_stuck_bus_finds_nothing);
+    RUN(test_verify);
+    RUN(test_verify_misses_new_devices);
+    RUN(test_cache);
+    return check_done();
+}
@@ -0,0 +1,262 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: MPU6050 FIFO driver (Project 14) against the simulated sensor
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include "check.h"
+#include "mock/mock_mpu6050.h"
+#include "mpu6050_fifo.h"
+
+#define BATCH_MS    40      /* IMU_BATCH_MS in main.c */
+
+static mock_mpu6050_t s_dev;
+
+static const mpu6050_bus_t s_bus = {
+    .read = mock_mpu6050_read,
+    .write = mock_mpu6050_write,
+    .ctx = &s_dev,
+};
+
+static void dev_on(uint32_t scl_hz, uint8_t rate_div)
+{
+    mock_mpu6050_init(&s_dev, scl_hz);
+    CHECK_EQ(mock_mpu6050_write(&s_dev, 0x6B, 0x00), ESP_OK);   /* wake up */
+    CHECK_EQ(mpu6050_fifo_start(&s_bus, rate_div, 1), ESP_OK);
+}
+
+/* samples must follow each other without gaps, starting at sample k0 */
+static void check_run(const mpu6050_sample_t *s, size_t n, uint32_t k0)
+{
+    for (size_t i = 0; i < n; i++) {
+        int16_t v[6];
+        mock_mpu6050_sample_values(k0 + (uint32_t)i, v);
+        CHECK_EQ(s[i].ax, v[0]);
+        CHECK_EQ(s[i].ay, v[1]);
+        CHECK_EQ(s[i].az, v[2]);
+        CHECK_EQ(s[i].gx, v[3]);
+        CHECK_EQ(s[i].gy, v[4]);
+        CHECK_EQ(s[i].gz, v[5]);
+    }
+}
+
+static void test_decode_big_endian(void)
+{
+    const uint8_t raw[MPU6050_FIFO_SAMPLE_BYTES * 2 + 5] = {
+        0x12, 0x34, 0xFF, 0xFE, 0x40, 0x00, 0x80, 0x00, 0x7F, 0xFF, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x01, 0xFF, 0xFF, 0x01, 0x00, 0x00, 0x80, 0xC0, 0x00,
+        0xAA, 0xAA, 0xAA, 0xAA, 0xAA,
+    };
+    mpu6050_sample_t out[3];
+
+    CHECK_EQ(mpu6050_fifo_decode(raw, sizeof(raw), out, 3), 2);   /* tail ignored */
+    CHECK_EQ(out[0].ax, 0x1234);
+    CHECK_EQ(out[0].ay, -2);
+    CHECK_EQ(out[0].az, 16384);
+    CHECK_EQ(out[0].gx, -32768);
+    CHECK_EQ(out[0].gy, 32767);
+    CHECK_EQ(out[0].gz, 1);
+    CHECK_EQ(out[1].az, -1);
+    CHECK_EQ(out[1].gz, -16384);
+
+    CHECK_EQ(mpu6050_fifo_decode(raw, sizeof(raw), out, 1), 1);
+    CHECK_EQ(mpu6050_fifo_decode(raw, MPU6050_FIFO_SAMPLE_BYTES - 1, out, 3), 0);
+}
+
+static void test_start_configures_sensor(void)
+{
+    dev_on(0, 4);
+    CHECK_EQ(s_dev.regs[0x1A], 1);          /* DLPF */
+    CHECK_EQ(s_dev.regs[0x19], 4);          /* 200 Hz */
+    CHECK_EQ(s_dev.regs[0x23], 0x78);       /* accel + gyro xyz */
+    CHECK_EQ(s_dev.regs[0x6A], 0x40);       /* FIFO on, reset done */
+    CHECK_EQ(s_dev.fifo_count, 0);
+
+    mock_mpu6050_advance(&s_dev, 100000);
+    CHECK_EQ(s_dev.fifo_count, 20 * MPU6050_FIFO_SAMPLE_BYTES);
+
+    CHECK_EQ(mpu6050_fifo_stop(&s_bus), ESP_OK);
+    CHECK_EQ(s_dev.fifo_count, 0);
+    mock_mpu6050_advance(&s_dev, 100000);
+    CHECK_EQ(s_dev.fifo_count, 0);
+}
+
+static void test_batch_in_order(void)
+{
+    static mpu6050_sample_t batch[MPU6050_FIFO_MAX_SAMPLES];
+    mpu6050_fifo_stats_t st = {0};
+    size_t n = 0;
+
+    dev_on(0, 0);
+    uint32_t k = s_dev.next_k;
+    CHECK_EQ(mpu6050_fifo_read_batch(&s_bus, batch, MPU6050_FIFO_MAX_SAMPLES, &n, &st), ESP_OK);
+    CHECK_EQ(n, 0);                         /* empty FIFO: no block read */
+    CHECK_EQ(st.batches, 0);
+
+    for (int b = 0; b < 5; b++) {
+        mock_mpu6050_advance(&s_dev, BATCH_MS * 1000);
+        CHECK_EQ(mpu6050_fifo_read_batch(&s_bus, batch, MPU6050_FIFO_MAX_SAMPLES, &n, &st), ESP_OK);
+        CHECK_EQ(n, BATCH_MS);
+        check_run(batch, n, k);
+        k += (uint32_t)n;
+    }
+    CHECK_EQ(st.batches, 5);
+    CHECK_EQ(st.samples, 5 * BATCH_MS);
+    CHECK_EQ(st.overflows, 0);
+    CHECK_EQ(st.misaligned, 0);
+}
+
+static void test_max_samples_leaves_rest(void)
+{
+    mpu6050_sample_t batch[16];
+    size_t n = 0;
+
+    dev_on(0, 0);
+    uint32_t k = s_dev.next_k;
+    mock_mpu6050_advance(&s_dev, 40000);
+    CHECK_EQ(mpu6050_fifo_read_batch(&s_bus, batch, 16, &n, NULL), ESP_OK);
+    CHECK_EQ(n, 16);
+    check_run(batch, n, k);
+    CHECK_EQ(s_dev.fifo_count, 24 * MPU6050_FIFO_SAMPLE_BYTES);
+    CHECK_EQ(mpu6050_fifo_read_batch(&s_bus, batch, 16, &n, NULL), ESP_OK);
+    check_run(batch, n, k + 16);
+}
+
+static void test_partial_sample_is_left_in_fifo(void)
+{
+    mpu6050_sample_t batch[8];
+    mpu6050_fifo_stats_t st = {0};
+    size_t n = 0;
+
+    dev_on(0, 0);
+    uint32_t k = s_dev.next_k;
+    mock_mpu6050_advance(&s_dev, 3000);
+    const uint8_t half[5] = { 1, 2, 3, 4, 5 };
+    mock_mpu6050_push_raw(&s_dev, half, sizeof(half));
+
+    CHECK_EQ(mpu6050_fifo_read_batch(&s_bus, batch, 8, &n, &st), ESP_OK);
+    CHECK_EQ(n, 3);
+    check_run(batch, n, k);
+    CHECK_EQ(st.misaligned, 1);
+    CHECK_EQ(s_dev.fifo_count, sizeof(half));
+}
+
+/* FIFO full: sample boundaries are gone, the driver must reset and resync */
+static void test_overflow_resets_and_resyncs(void)
+{
+    static mpu6050_sample_t batch[MPU6050_FIFO_MAX_SAMPLES];
+    mpu6050_fifo_stats_t st = {0};
+    size_t n = 0;
+
+    dev_on(0, 0);
+    mock_mpu6050_advance(&s_dev, 100000);   /* 1200 bytes into 1024 */
+    CHECK_EQ(s_dev.fifo_count, MOCK_MPU6050_FIFO_SIZE);
+
+    CHECK_EQ(mpu6050_fifo_read_batch(&s_bus, batch, MPU6050_FIFO_MAX_SAMPLES, &n, &st), ESP_OK);
+    CHECK_EQ(n, 0);
+    CHECK_EQ(st.overflows, 1);
+    CHECK_EQ(s_dev.fifo_count, 0);
+    CHECK_EQ(s_dev.regs[0x6A], 0x40);       /* FIFO enabled again */
+
+    uint32_t k = s_dev.next_k;
+    mock_mpu6050_advance(&s_dev, 10000);
+    CHECK_EQ(mpu6050_fifo_read_batch(&s_bus, batch, MPU6050_FIFO_MAX_SAMPLES, &n, &st), ESP_OK);
+    CHECK_EQ(n, 10);
+    check_run(batch, n, k);
+    CHECK_EQ(st.overflows, 1);
+}
+
+/* the flag alone (count already drained below 1024) also means lost data */
+static void test_overflow_flag_alone(void)
+{
+    mpu6050_sample_t batch[8];
+    mpu6050_fifo_stats_t st = {0};
+    size_t n = 0;
+
+    dev_on(0, 0);
+    s_dev.regs[0x3A] = 0x10;
+    mock_mpu6050_advance(&s_dev, 5000);
+    CHECK_EQ(mpu6050_fifo_read_batch(&s_bus, batch, 8, &n, &st), ESP_OK);
+    CHECK_EQ(n, 0);
+    CHECK_EQ(st.overflows, 1);
+    CHECK_EQ(s_dev.regs[0x3A], 0);          /* cleared by the read */
+}
+
+static void test_bus_error_is_returned(void)
+{
+    mpu6050_sample_t batch[8];
+    size_t n = 99;
+
+    dev_on(0, 0);
+    mock_mpu6050_advance(&s_dev, 5000);
+    s_dev.fail = ESP_ERR_TIMEOUT;
+    CHECK_EQ(mpu6050_fifo_read_batch(&s_bus, batch, 8, &n, NULL), ESP_ERR_TIMEOUT);
+    CHECK_EQ(n, 0);
+    CHECK_EQ(mpu6050_fifo_start(&s_bus, 0, 1), ESP_ERR_TIMEOUT);
+    s_dev.fail = ESP_OK;
+}
+
+/*
+ * imu_fifo_loop() for 'ms' of mock time: a batch every BATCH_MS
+ * (vTaskDelayUntil: no wait if the last drain took longer), the bus
+ * transfers themselves take time at scl_hz.
+ */
+static mpu6050_fifo_stats_t run_loop(uint32_t scl_hz, uint8_t rate_div, int ms)
+{
+    static mpu6050_sample_t batch[MPU6050_FIFO_MAX_SAMPLES];
+    mpu6050_fifo_stats_t st = {0};
+    dev_on(scl_hz, rate_div);
+
+    int64_t wake = s_dev.now_us;
+    int64_t end = s_dev.now_us + (int64_t)ms * 1000;
+    while (s_dev.now_us < end) {
+        wake += BATCH_MS * 1000;
+        if (s_dev.now_us < wake) {
+            mock_mpu6050_advance(&s_dev, wake - s_dev.now_us);
+        }
+        size_t n = 0;
+        CHECK_EQ(mpu6050_fifo_read_batch(&s_bus, batch, MPU6050_FIFO_MAX_SAMPLES, &n, &st),
+                 ESP_OK);
+    }
+    return st;
+}
+
+/* main.c: 1 kHz FIFO needs the 400 kHz bus, 100 kHz only with a divider */
+static void test_bus_rate_budget(void)
+{
+    mpu6050_fifo_stats_t slow = run_loop(100000, 0, 2000);
+    CHECK(slow.overflows > 0);
+
+    mpu6050_fifo_stats_t fast = run_loop(400000, 0, 2000);
+    CHECK_EQ(fast.overflows, 0);
+    CHECK(fast.samples >= 1950);
+
+    /* the smallest divider main.c's #error check accepts at 100 kHz */
+    mpu6050_fifo_stats_t div2 = run_loop(100000, 2, 2000);
+    CHECK_EQ(div2.overflows, 0);
+    CHECK(div2.samples >= 600);
+}
+
+int main(void)
+{
+    RUN(test_decode_big_endian);
+    RUN(test_start_configures_sensor);
+    RUN(test_batch_in_order);
+    RUN(test_max_samples_leaves_rest);
+    RUN(test_partial_sample_is_left_in_fifo);
+    RUN(test_overflow_resets_and_resyncs);
+    RUN(test_overflow_flag_alone);
+    RUN(test_bus_error_is_returned);
+    RUN(test_bus_rate_budget);
+    return check_done();
+}
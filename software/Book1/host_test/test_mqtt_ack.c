@@ -0,0 +1,240 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: wait for PUBACKs, expired messages are not delivered
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include "check.h"
+#include "freertos/task.h"
+#include "mqtt_ack.h"
+
+#define MSG(id)     MQTT_EVENT_PUBLISHED, (id)
+
+static esp_mqtt_client_handle_t s_client;
+
+static void event(esp_mqtt_event_id_t id, int msg_id)
+{
+    esp_mqtt_event_t e = { .event_id = id, .msg_id = msg_id };
+    mqtt_ack_on_event(&e);
+}
+
+static int publish(int qos)
+{
+    return mqtt_ack_publish(s_client, "t", "x", 0, qos, 0);
+}
+
+/* the MQTT task: events a while after the caller started to wait */
+typedef struct {
+    int                 delay_ms;
+    int                 n;
+    esp_mqtt_event_id_t id[4];
+    int                 msg_id[4];
+} later_t;
+
+static void later_task(void *arg)
+{
+    const later_t *l = arg;
+    vTaskDelay(pdMS_TO_TICKS(l->delay_ms));
+    for (int i = 0; i < l->n; i++) {
+        event(l->id[i], l->msg_id[i]);
+    }
+    vTaskDelete(NULL);
+}
+
+static void later(later_t *l)
+{
+    CHECK(xTaskCreate(later_task, "mqtt", 4096, l, 5, NULL) == pdPASS);
+}
+
+static void stats(mqtt_ack_stats_t *st)
+{
+    mqtt_ack_get_stats(st);
+}
+
+static void test_before_init(void)
+{
+    CHECK_EQ(mqtt_ack_wait_all(pdMS_TO_TICKS(10)), ESP_ERR_INVALID_STATE);
+    CHECK_EQ(mqtt_ack_init(), ESP_OK);
+    CHECK_EQ(mqtt_ack_init(), ESP_OK);
+    CHECK_EQ(mqtt_ack_wait_all(pdMS_TO_TICKS(10)), ESP_OK);    /* nothing pending */
+}
+
+static void test_untracked(void)
+{
+    mqtt_ack_stats_t st;
+
+    host_mqtt_next_msg_id(100);
+    CHECK_EQ(publish(0), 100);                  /* QoS 0: no ack to wait for */
+    host_mqtt_next_msg_id(0);
+    CHECK(publish(1) < 0);                      /* not queued */
+    stats(&st);
+    CHECK_EQ(st.published, 0);
+    CHECK_EQ(mqtt_ack_pending(), 0);
+}
+
+static void test_acked_while_waiting(void)
+{
+    mqtt_ack_stats_t st;
+
+    host_mqtt_next_msg_id(1);
+    CHECK_EQ(publish(1), 1);
+    CHECK_EQ(publish(1), 2);
+    CHECK_EQ(mqtt_ack_pending(), 2);
+
+    static later_t l = {
+        .delay_ms = 30, .n = 2,
+        .id = { MQTT_EVENT_PUBLISHED, MQTT_EVENT_PUBLISHED }, .msg_id = { 2, 1 },
+    };
+    later(&l);
+    CHECK_EQ(mqtt_ack_wait_all(pdMS_TO_TICKS(2000)), ESP_OK);
+    stats(&st);
+    CHECK_EQ(st.published, 2);
+    CHECK_EQ(st.acked, 2);
+    CHECK_EQ(st.expired, 0);
+    CHECK(st.last_ack_us >= 20000);
+    CHECK(st.max_ack_us >= st.last_ack_us);
+}
+
+static void ack_early(int msg_id)
+{
+    event(MSG(msg_id));
+}
+
+/* the PUBACK is handled before publish() returns the msg_id */
+static void test_early_ack(void)
+{
+    mqtt_ack_stats_t before, after;
+
+    stats(&before);
+    host_mqtt_on_publish(ack_early);
+    CHECK_EQ(publish(1), 3);
+    host_mqtt_on_publish(NULL);
+    CHECK_EQ(mqtt_ack_pending(), 0);
+    stats(&after);
+    CHECK_EQ(after.acked, before.acked + 1);
+    CHECK_EQ(mqtt_ack_wait_all(0), ESP_OK);
+
+    /* an ack for a msg_id nobody published is parked, not counted */
+    event(MSG(999));
+    stats(&after);
+    CHECK_EQ(after.acked, before.acked + 1);
+}
+
+static void test_timeout(void)
+{
+    CHECK_EQ(publish(1), 4);
+    TickType_t t0 = xTaskGetTickCount();
+    CHECK_EQ(mqtt_ack_wait_all(pdMS_TO_TICKS(50)), ESP_ERR_TIMEOUT);
+    CHECK(xTaskGetTickCount() - t0 >= pdMS_TO_TICKS(50));
+    CHECK_EQ(mqtt_ack_pending(), 1);
+
+    event(MSG(4));
+    CHECK_EQ(mqtt_ack_wait_all(0), ESP_OK);
+}
+
+/*
+ * MQTT_EVENT_DELETED: the client gave up on the message. The wait ends
+ * at once instead of at the timeout, but it must not report success.
+ */
+static void test_expired(void)
+{
+    mqtt_ack_stats_t before, after;
+
+    stats(&before);
+    CHECK_EQ(publish(1), 5);
+    static later_t l = { .delay_ms = 30, .n = 1, .id = { MQTT_EVENT_DELETED }, .msg_id = { 5 } };
+    later(&l);
+    TickType_t t0 = xTaskGetTickCount();
+    CHECK_EQ(mqtt_ack_wait_all(pdMS_TO_TICKS(5000)), ESP_FAIL);
+    CHECK(xTaskGetTickCount() - t0 < pdMS_TO_TICKS(2000));
+    CHECK_EQ(mqtt_ack_pending(), 0);
+    stats(&after);
+    CHECK_EQ(after.expired, before.expired + 1);
+    CHECK_EQ(after.acked, before.acked);
+
+    /* one acked, one expired: still not all delivered */
+    CHECK_EQ(publish(1), 6);
+    CHECK_EQ(publish(1), 7);
+    static later_t l2 = {
+        .delay_ms = 30, .n = 2,
+        .id = { MQTT_EVENT_PUBLISHED, MQTT_EVENT_DELETED }, .msg_id = { 6, 7 },
+    };
+    later(&l2);
+    CHECK_EQ(mqtt_ack_wait_all(pdMS_TO_TICKS(5000)), ESP_FAIL);
+
+    /* the next wait is about its own messages only */
+    CHECK_EQ(publish(1), 8);
+    static later_t l3 = { .delay_ms = 10, .n = 1, .id = { MQTT_EVENT_PUBLISHED }, .msg_id = { 8 } };
+    later(&l3);
+    CHECK_EQ(mqtt_ack_wait_all(pdMS_TO_TICKS(5000)), ESP_OK);
+
+    /* expired and still something pending: the timeout wins */
+    CHECK_EQ(publish(1), 9);
+    CHECK_EQ(publish(1), 10);
+    static later_t l4 = { .delay_ms = 10, .n = 1, .id = { MQTT_EVENT_DELETED }, .msg_id = { 9 } };
+    later(&l4);
+    CHECK_EQ(mqtt_ack_wait_all(pdMS_TO_TICKS(100)), ESP_ERR_TIMEOUT);
+    event(MSG(10));
+
+    /* expired before the wait started: still reported */
+    CHECK_EQ(publish(1), 11);
+    event(MQTT_EVENT_DELETED, 11);
+    CHECK_EQ(mqtt_ack_pending(), 0);
+    CHECK_EQ(mqtt_ack_wait_all(pdMS_TO_TICKS(100)), ESP_FAIL);
+    CHECK_EQ(mqtt_ack_wait_all(0), ESP_OK);     /* reported once */
+
+    /* the expiry behind a timeout is not reported again */
+    CHECK_EQ(publish(1), 12);
+    CHECK_EQ(publish(1), 13);
+    event(MQTT_EVENT_DELETED, 12);
+    CHECK_EQ(mqtt_ack_wait_all(pdMS_TO_TICKS(20)), ESP_ERR_TIMEOUT);
+    event(MSG(13));
+    CHECK_EQ(mqtt_ack_wait_all(0), ESP_OK);
+
+    /* a DELETED for a message that is not pending changes nothing */
+    stats(&before);
+    event(MQTT_EVENT_DELETED, 4242);
+    stats(&after);
+    CHECK_EQ(after.expired, before.expired);
+    CHECK_EQ(mqtt_ack_wait_all(0), ESP_OK);
+}
+
+static void test_pending_list_full(void)
+{
+    mqtt_ack_stats_t before, after;
+
+    stats(&before);
+    host_mqtt_next_msg_id(1000);
+    for (int i = 0; i < MQTT_ACK_MAX_PENDING + 3; i++) {
+        CHECK_EQ(publish(1), 1000 + i);
+    }
+    stats(&after);
+    CHECK_EQ(mqtt_ack_pending(), MQTT_ACK_MAX_PENDING);
+    CHECK_EQ(after.dropped, before.dropped + 3);
+    for (int i = 0; i < MQTT_ACK_MAX_PENDING; i++) {
+        event(MSG(1000 + i));
+    }
+    CHECK_EQ(mqtt_ack_wait_all(0), ESP_OK);
+}
+
+int main(void)
+{
+    RUN(test_before_init);
+    RUN(test_untracked);
+    RUN(test_acked_while_waiting);
+    RUN(test_early_ack);
+    RUN(test_timeout);
+    RUN(test_expired);
+    RUN(test_pending_list_full);
+    return check_done();
+}
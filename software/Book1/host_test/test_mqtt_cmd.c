@@ -0,0 +1,439 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: table-driven MQTT command parser and dispatcher
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <ctype.h>
+
+#include "check.h"
+#include "mqtt_cmd.h"
+
+static int  s_calls;
+static char s_sent[256];
+static int  s_sent_count;
+
+static void cmd_echo(const mqtt_cmd_t *cmd, char *reply, size_t reply_len, void *ctx)
+{
+    (void)ctx;
+    s_calls++;
+    if (cmd->def->arg == MQTT_CMD_ARG_INT) {
+        snprintf(reply, reply_len, "event=%s;v=%ld", cmd->def->name, (long)cmd->ival);
+    } else if (cmd->def->arg == MQTT_CMD_ARG_STR) {
+        snprintf(reply, reply_len, "event=%s;len=%u", cmd->def->name, (unsigned)cmd->str_len);
+    } else {
+        snprintf(reply, reply_len, "event=%s", cmd->def->name);
+    }
+}
+
+/* a handler that fills the whole reply buffer */
+static void cmd_long(const mqtt_cmd_t *cmd, char *reply, size_t reply_len, void *ctx)
+{
+    (void)cmd;
+    (void)ctx;
+    s_calls++;
+    memset(reply, 'x', reply_len - 1);
+    reply[reply_len - 1] = '\0';
+}
+
+static void sent(const char *reply, void *ctx)
+{
+    (void)ctx;
+    snprintf(s_sent, sizeof(s_sent), "%s", reply);
+    s_sent_count++;
+}
+
+/* the tables of AIoT_MQTT and AIoT Final Node Prof, plus the extremes */
+static const mqtt_cmd_def_t s_table[] = {
+    { "ping",   MQTT_CMD_ARG_NONE, 0, 0,                 cmd_echo, NULL },
+    { "ps",     MQTT_CMD_ARG_INT,  0, 2,                 cmd_echo, "bad_ps" },
+    { "sleep",  MQTT_CMD_ARG_INT,  0, 86400,             cmd_echo, "bad_sleep_range" },
+    { "ota",    MQTT_CMD_ARG_STR,  8, 63,                cmd_echo, "bad_ota_url" },
+    { "offset", MQTT_CMD_ARG_INT,  INT32_MIN, INT32_MAX, cmd_echo, NULL },
+    { "long",   MQTT_CMD_ARG_NONE, 0, 0,                 cmd_long, NULL },
+};
+#define TABLE_LEN   (sizeof(s_table) / sizeof(s_table[0]))
+
+/* Parse from an exact-size heap copy: ASan catches any read past len */
+static mqtt_cmd_result_t parse_n(const char *data, size_t len, mqtt_cmd_t *out)
+{
+    char *p = malloc(len ? len : 1);
+    memcpy(p, data, len);
+    mqtt_cmd_result_t rc = mqtt_cmd_parse(s_table, TABLE_LEN, p, len, out);
+
+    /* pointers into the copy, rebased onto data for the caller */
+    if (out->str) {
+        CHECK(out->str >= p && out->str + out->str_len <= p + len);
+        out->str = data + (out->str - p);
+    }
+    if (out->req) {
+        CHECK(out->req >= p && out->req + out->req_len <= p + len);
+        out->req = data + (out->req - p);
+    }
+    free(p);
+    return rc;
+}
+
+static mqtt_cmd_result_t parse(const char *s, mqtt_cmd_t *out)
+{
+    return parse_n(s, strlen(s), out);
+}
+
+static mqtt_cmd_result_t dispatch(const char *s)
+{
+    s_sent[0] = '\0';
+    s_sent_count = 0;
+    return mqtt_cmd_dispatch(s_table, TABLE_LEN, s, strlen(s), sent, NULL);
+}
+
+/* ---- fixed cases ---- */
+
+static void test_valid_commands(void)
+{
+    mqtt_cmd_t c;
+
+    CHECK_EQ(parse("ping", &c), MQTT_CMD_OK);
+    CHECK_STR(c.def->name, "ping");
+    CHECK(c.req == NULL);
+
+    CHECK_EQ(parse("  sleep=60\r\n", &c), MQTT_CMD_OK);
+    CHECK_EQ(c.ival, 60);
+
+    CHECK_EQ(parse("sleep=60;req=17", &c), MQTT_CMD_OK);
+    CHECK_EQ(c.ival, 60);
+    CHECK_EQ(c.req_len, 2);
+    CHECK(memcmp(c.req, "17", 2) == 0);
+
+    /* ';' inside a string argument, only the last segment is the req id */
+    const char *url = "ota=http://h/fw.bin;v=2;req=a-B_9";
+    CHECK_EQ(parse(url, &c), MQTT_CMD_OK);
+    CHECK_EQ(c.str_len, strlen("http://h/fw.bin;v=2"));
+    CHECK(memcmp(c.str, "http://h/fw.bin;v=2", c.str_len) == 0);
+    CHECK_EQ(c.req_len, 5);
+
+    /* looks like a req segment, but is not the last one */
+    CHECK_EQ(parse("ota=http://h/?;req=1;x", &c), MQTT_CMD_OK);
+    CHECK(c.req == NULL);
+
+    /* 32 characters is the longest req id */
+    CHECK_EQ(parse("ping;req=0123456789abcdefghijklmnopqrstuv", &c), MQTT_CMD_OK);
+    CHECK_EQ(c.req_len, 32);
+}
+
+static void test_int_range_and_overflow(void)
+{
+    static const struct {
+        const char *arg;
+        mqtt_cmd_result_t rc;
+        int32_t val;
+    } cases[] = {
+        { "0", MQTT_CMD_OK, 0 },
+        { "-0", MQTT_CMD_OK, 0 },
+        { "+7", MQTT_CMD_OK, 7 },
+        { "2147483647", MQTT_CMD_OK, INT32_MAX },
+        { "-2147483648", MQTT_CMD_OK, INT32_MIN },
+        { "0002147483", MQTT_CMD_OK, 2147483 },
+        { "2147483648", MQTT_CMD_BAD_ARG, 0 },
+        { "-2147483649", MQTT_CMD_BAD_ARG, 0 },
+        { "9999999999", MQTT_CMD_BAD_ARG, 0 },
+        { "4294967296", MQTT_CMD_BAD_ARG, 0 },       /* 2^32: wraps to 0 in 32 bit */
+        { "4294967297", MQTT_CMD_BAD_ARG, 0 },
+        { "18446744073709551617", MQTT_CMD_BAD_ARG, 0 },
+        { "00000000001", MQTT_CMD_BAD_ARG, 0 },      /* 11 digits */
+        { "", MQTT_CMD_BAD_ARG, 0 },
+        { "-", MQTT_CMD_BAD_ARG, 0 },
+        { "+", MQTT_CMD_BAD_ARG, 0 },
+        { "--1", MQTT_CMD_BAD_ARG, 0 },
+        { "1-", MQTT_CMD_BAD_ARG, 0 },
+        { " 1", MQTT_CMD_BAD_ARG, 0 },
+        { "1 ", MQTT_CMD_BAD_ARG, 0 },
+        { "0x10", MQTT_CMD_BAD_ARG, 0 },
+        { "1e3", MQTT_CMD_BAD_ARG, 0 },
+        { "12\t", MQTT_CMD_BAD_ARG, 0 },
+    };
+    char buf[64];
+    mqtt_cmd_t c;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        snprintf(buf, sizeof(buf), "offset=%s;req=1", cases[i].arg);
+        mqtt_cmd_result_t rc = parse(buf, &c);
+        if (rc != cases[i].rc) {
+            fprintf(stderr, "  \"%s\"\n", buf);
+        }
+        CHECK_EQ(rc, cases[i].rc);
+        if (rc == MQTT_CMD_OK) {
+            CHECK_EQ(c.ival, cases[i].val);
+        }
+    }
+
+    /* bounds are inclusive */
+    CHECK_EQ(parse("sleep=86400", &c), MQTT_CMD_OK);
+    CHECK_EQ(parse("sleep=86401", &c), MQTT_CMD_BAD_ARG);
+    CHECK_EQ(parse("sleep=-1", &c), MQTT_CMD_BAD_ARG);
+    CHECK_EQ(parse("sleep", &c), MQTT_CMD_BAD_ARG);
+    CHECK_STR(c.def->name, "sleep");
+}
+
+static void test_malformed(void)
+{
+    static const struct {
+        const char *in;
+        mqtt_cmd_result_t rc;
+    } cases[] = {
+        { "", MQTT_CMD_MALFORMED },
+        { " \t\r\n", MQTT_CMD_MALFORMED },
+        { ";req=17", MQTT_CMD_MALFORMED },           /* req only */
+        { "=60", MQTT_CMD_MALFORMED },               /* empty name */
+        { "=", MQTT_CMD_MALFORMED },
+        { "=;req=1", MQTT_CMD_MALFORMED },
+        { "ping;req=", MQTT_CMD_MALFORMED },         /* empty req id */
+        { "ping;req=a b", MQTT_CMD_MALFORMED },
+        { "ping;req=a;b", MQTT_CMD_UNKNOWN },        /* last segment is ";b" */
+        { "ping;req=\x01", MQTT_CMD_MALFORMED },
+        { "ping;req=0123456789abcdefghijklmnopqrstuvw", MQTT_CMD_MALFORMED },  /* 33 */
+        { "ping;req=1;req=2", MQTT_CMD_UNKNOWN },    /* name "ping;req=1" */
+        { "Ping", MQTT_CMD_UNKNOWN },
+        { "pin", MQTT_CMD_UNKNOWN },
+        { "pingg", MQTT_CMD_UNKNOWN },
+        { "ping=", MQTT_CMD_BAD_ARG },
+        { "ping=1", MQTT_CMD_BAD_ARG },
+        { "ps=3", MQTT_CMD_BAD_ARG },
+        { "ota=http://", MQTT_CMD_BAD_ARG },         /* 7 < min 8 */
+        { "ota=http://h/\x1b[2J", MQTT_CMD_BAD_ARG },    /* control characters */
+        { "ota=http://h/a\tb", MQTT_CMD_BAD_ARG },
+        { "ota=http://h/a\x7f", MQTT_CMD_BAD_ARG },
+        { "ota=http://h/\xc3\xa4", MQTT_CMD_OK },    /* UTF-8 is not a control char */
+    };
+    mqtt_cmd_t c;
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        mqtt_cmd_result_t rc = parse(cases[i].in, &c);
+        if (rc != cases[i].rc) {
+            fprintf(stderr, "  case %zu\n", i);
+        }
+        CHECK_EQ(rc, cases[i].rc);
+    }
+
+    /* a NUL inside the payload is data, not the end of it */
+    CHECK_EQ(parse_n("ping\0", 5, &c), MQTT_CMD_UNKNOWN);
+    CHECK_EQ(parse_n("ota=http://h/\0x", 15, &c), MQTT_CMD_BAD_ARG);
+    CHECK_EQ(parse_n("ping;req=1\0", 11, &c), MQTT_CMD_MALFORMED);
+
+    /* the string argument's length limit is on the argument, not the payload */
+    char url[80] = "ota=";
+    memset(url + 4, 'u', 63);
+    url[4 + 63] = '\0';
+    CHECK_EQ(parse(url, &c), MQTT_CMD_OK);
+    strcat(url, "u");
+    CHECK_EQ(parse(url, &c), MQTT_CMD_BAD_ARG);
+}
+
+/* ---- dispatcher ---- */
+
+static void test_dispatch_replies(void)
+{
+    s_calls = 0;
+    CHECK_EQ(dispatch("sleep=60;req=17"), MQTT_CMD_OK);
+    CHECK_STR(s_sent, "event=sleep;v=60;req=17");
+
+    CHECK_EQ(dispatch("sleep=99999;req=x"), MQTT_CMD_BAD_ARG);
+    CHECK_STR(s_sent, "event=err;reason=bad_sleep_range;req=x");
+
+    CHECK_EQ(dispatch("ping=1"), MQTT_CMD_BAD_ARG);
+    CHECK_STR(s_sent, "event=err;reason=bad_arg");
+
+    CHECK_EQ(dispatch("nope;req=9"), MQTT_CMD_UNKNOWN);
+    CHECK_STR(s_sent, "event=err;reason=unknown_cmd;req=9");
+
+    /* a bad req id is never echoed */
+    CHECK_EQ(dispatch("ping;req=a\"b"), MQTT_CMD_MALFORMED);
+    CHECK_STR(s_sent, "event=err;reason=malformed");
+    CHECK_EQ(s_calls, 1);
+
+    /* a full reply still gets the whole req id */
+    CHECK_EQ(dispatch("long;req=0123456789abcdefghijklmnopqrstuv"), MQTT_CMD_OK);
+    CHECK_EQ(strlen(s_sent), MQTT_CMD_REPLY_MAX - 1 + 5 + 32);
+    CHECK(strstr(s_sent, ";req=0123456789abcdefghijklmnopqrstuv") != NULL);
+
+    /* no reply callback: still parsed and handled */
+    CHECK_EQ(mqtt_cmd_dispatch(s_table, TABLE_LEN, "ping", 4, NULL, NULL), MQTT_CMD_OK);
+}
+
+/* ---- properties on random payloads ---- */
+
+/* Reference for one argument: strtoll on a terminated copy */
+static bool ref_int(const char *p, size_t len, int32_t *out)
+{
+    char buf[32];
+    char *end;
+
+    if (len == 0 || len >= sizeof(buf) || !(isdigit((unsigned char)p[len - 1]))) {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++) {
+        if (!isdigit((unsigned char)p[i]) && !(i == 0 && (p[i] == '-' || p[i] == '+'))) {
+            return false;
+        }
+    }
+    memcpy(buf, p, len);
+    buf[len] = '\0';
+    long long v = strtoll(buf, &end, 10);
+    if (*end || v < INT32_MIN || v > INT32_MAX) {
+        return false;
+    }
+    *out = (int32_t)v;
+    return true;
+}
+
+/*
+ * Random payloads from the characters the parser cares about, mixed with
+ * table names and ";req=": the result must agree with a simple reference,
+ * pointers stay inside the payload, and parsing never reads past len.
+ */
+static void test_random_payloads(void)
+{
+    static const char *pieces[] = {
+        "ping", "ps", "sleep", "ota", "offset", "=", ";", ";req=", "req", " ", "\t",
+        "-", "+", "0", "1", "9", "2147483647", "2147483648", "-2147483648", "4294967296",
+        "http://h/x", "a", "_", "\x01", "\x7f", "\xff", "\r\n", "\"",
+    };
+    uint32_t rng = 0xC0FFEE;
+    int ok = 0, unknown = 0, bad = 0, malformed = 0;
+
+    for (int round = 0; round < 200000; round++) {
+        char buf[96];
+        size_t len = 0;
+        int parts = (int)(check_rand(&rng) % 7);
+
+        for (int i = 0; i < parts; i++) {
+            const char *pc = pieces[check_rand(&rng) % (sizeof(pieces) / sizeof(pieces[0]))];
+            size_t n = strlen(pc);
+            if (len + n > sizeof(buf)) {
+                break;
+            }
+            memcpy(buf + len, pc, n);
+            len += n;
+        }
+        if (check_rand(&rng) % 8 == 0 && len > 0) {
+            buf[check_rand(&rng) % len] = (char)check_rand(&rng);      /* any byte */
+        }
+
+        mqtt_cmd_t c;
+        mqtt_cmd_result_t rc = parse_n(buf, len, &c);
+
+        /* reference: trim, split off a valid trailing ";req=<id>", split name=arg */
+        size_t b = 0, e = len;
+        while (b < e && strchr(" \t\r\n", buf[b]) && buf[b]) {
+            b++;
+        }
+        while (e > b && strchr(" \t\r\n", buf[e - 1]) && buf[e - 1]) {
+            e--;
+        }
+        const char *req = NULL;
+        size_t req_len = 0;
+        bool req_bad = false;
+        for (size_t i = e; i-- > b;) {
+            if (buf[i] != ';') {
+                continue;
+            }
+            if (e - i >= 5 && memcmp(buf + i, ";req=", 5) == 0) {
+                req = buf + i + 5;
+                req_len = e - i - 5;
+                req_bad = req_len == 0 || req_len > 32;
+                for (size_t k = 0; k < req_len; k++) {
+                    char ch = req[k];
+                    req_bad |= !(isalnum((unsigned char)ch) || ch == '-' || ch == '_') ||
+                               (unsigned char)ch >= 0x80;
+                }
+                e = i;
+            }
+            break;
+        }
+
+        if (req_bad || b == e) {
+            CHECK_EQ(rc, MQTT_CMD_MALFORMED);
+            malformed++;
+            continue;
+        }
+        const char *eq = memchr(buf + b, '=', e - b);
+        size_t name_len = eq ? (size_t)(eq - (buf + b)) : e - b;
+        if (name_len == 0) {
+            CHECK_EQ(rc, MQTT_CMD_MALFORMED);
+            malformed++;
+            continue;
+        }
+        const mqtt_cmd_def_t *def = NULL;
+        for (size_t i = 0; i < TABLE_LEN; i++) {
+            if (strlen(s_table[i].name) == name_len &&
+                memcmp(s_table[i].name, buf + b, name_len) == 0) {
+                def = &s_table[i];
+            }
+        }
+        if (!def) {
+            CHECK_EQ(rc, MQTT_CMD_UNKNOWN);
+            unknown++;
+            continue;
+        }
+        CHECK(c.def == def);
+
+        const char *arg = eq ? eq + 1 : NULL;
+        size_t arg_len = eq ? (size_t)(buf + e - arg) : 0;
+        bool valid;
+        int32_t v = 0;
+        switch (def->arg) {
+            case MQTT_CMD_ARG_NONE:
+                valid = !arg;
+                break;
+            case MQTT_CMD_ARG_INT:
+                valid = arg && ref_int(arg, arg_len, &v) && v >= def->min && v <= def->max;
+                break;
+            default:
+                valid = arg && arg_len >= (size_t)def->min && arg_len <= (size_t)def->max;
+                for (size_t i = 0; valid && i < arg_len; i++) {
+                    valid = (unsigned char)arg[i] >= 0x20 && arg[i] != 0x7F;
+                }
+                break;
+        }
+        if (!valid) {
+            CHECK_EQ(rc, MQTT_CMD_BAD_ARG);
+            bad++;
+            continue;
+        }
+
+        CHECK_EQ(rc, MQTT_CMD_OK);
+        ok++;
+        if (def->arg == MQTT_CMD_ARG_INT) {
+            CHECK_EQ(c.ival, v);
+        }
+        if (def->arg == MQTT_CMD_ARG_STR) {
+            CHECK(c.str == arg && c.str_len == arg_len);
+        }
+        CHECK(c.req == req && c.req_len == req_len);
+    }
+
+    /* every outcome came up often enough to mean something */
+    CHECK(ok > 1000);
+    CHECK(unknown > 1000);
+    CHECK(bad > 1000);
+    CHECK(malformed > 1000);
+}
+
+int main(void)
+{
+    RUN(test_valid_commands);
+    RUN(test_int_range_and_overflow);
+    RUN(test_malformed);
+    RUN(test_dispatch_replies);
+    RUN(test_random_payloads);
+    return check_done();
+}
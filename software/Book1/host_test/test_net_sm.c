@@ -0,0 +1,430 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: network state machine, driven by a simulated AP and timers
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include "check.h"
+#include "net_sm.h"
+
+#define REASON_NO_AP    201     /* WIFI_REASON_NO_AP_FOUND */
+#define REASON_BEACON   200     /* WIFI_REASON_BEACON_TIMEOUT */
+#define NEVER           UINT32_MAX
+
+static const net_sm_config_t s_cfg = {       /* net_conn.c defaults */
+    .max_retries = 0,
+    .backoff_base_ms = 500,
+    .backoff_max_ms = 30000,
+};
+
+/* ---- backoff ---- */
+
+static uint32_t cap(const net_sm_config_t *cfg, uint16_t attempt)
+{
+    uint64_t d = cfg->backoff_base_ms;
+    for (uint16_t i = 0; i < attempt && d < cfg->backoff_max_ms; i++) {
+        d *= 2;
+    }
+    return d > cfg->backoff_max_ms ? cfg->backoff_max_ms : (uint32_t)d;
+}
+
+/* equal jitter: always within [cap/2, cap], and both ends are reached */
+static void test_backoff_bounds(void)
+{
+    net_sm_t sm;
+    net_sm_init(&sm, &s_cfg, 1);
+
+    for (uint16_t attempt = 0; attempt < 12; attempt++) {
+        uint32_t d = cap(&s_cfg, attempt);
+        uint32_t lo = UINT32_MAX, hi = 0;
+        for (int i = 0; i < 4000; i++) {
+            uint32_t b = net_sm_backoff_ms(&sm, attempt);
+            lo = b < lo ? b : lo;
+            hi = b > hi ? b : hi;
+        }
+        CHECK(lo >= d / 2);
+        CHECK(hi <= d);
+        CHECK(lo < d / 2 + d / 20);         /* spread over the whole range */
+        CHECK(hi > d - d / 20);
+    }
+    CHECK_EQ(cap(&s_cfg, 0), 500);
+    CHECK_EQ(cap(&s_cfg, 5), 16000);
+    CHECK_EQ(cap(&s_cfg, 6), 30000);
+}
+
+static void test_backoff_extremes(void)
+{
+    net_sm_t sm;
+
+    /* many attempts: capped, no endless doubling */
+    net_sm_init(&sm, &s_cfg, 7);
+    uint32_t b = net_sm_backoff_ms(&sm, UINT16_MAX);
+    CHECK(b >= 15000 && b <= 30000);
+
+    /* doubling must not wrap around 32 bit */
+    net_sm_config_t big = { .backoff_base_ms = 0x90000000u, .backoff_max_ms = UINT32_MAX };
+    net_sm_init(&sm, &big, 7);
+    for (int i = 0; i < 100; i++) {
+        b = net_sm_backoff_ms(&sm, 1);
+        CHECK(b >= UINT32_MAX / 2);
+    }
+
+    /* no delay configured: no jitter either */
+    net_sm_config_t zero = { .backoff_base_ms = 0, .backoff_max_ms = 0 };
+    net_sm_init(&sm, &zero, 7);
+    CHECK_EQ(net_sm_backoff_ms(&sm, 3), 0);
+
+    /* seed 0 still gives random numbers */
+    net_sm_init(&sm, &s_cfg, 0);
+    CHECK(sm.rng != 0);
+    uint32_t first = net_sm_backoff_ms(&sm, 4);
+    bool varies = false;
+    for (int i = 0; i < 10; i++) {
+        varies |= net_sm_backoff_ms(&sm, 4) != first;
+    }
+    CHECK(varies);
+}
+
+/* a fleet after an AP reboot: different seeds, different retry times */
+static void test_fleet_not_in_lockstep(void)
+{
+    uint32_t seen[50];
+    int distinct = 0;
+
+    for (uint32_t node = 0; node < 50; node++) {
+        net_sm_t sm;
+        net_sm_init(&sm, &s_cfg, 0x1000 + node * 7919);
+        uint32_t b = net_sm_backoff_ms(&sm, 3);
+        bool dup = false;
+        for (int i = 0; i < distinct; i++) {
+            dup |= seen[i] == b;
+        }
+        if (!dup) {
+            seen[distinct++] = b;
+        }
+    }
+    CHECK(distinct > 40);
+}
+
+/* ---- every state x event ---- */
+
+static void force(net_sm_t *sm, net_state_t st)
+{
+    net_sm_init(sm, &s_cfg, 3);
+    sm->state = st;
+}
+
+static void test_transition_table(void)
+{
+    static const struct {
+        net_state_t          from;
+        net_sm_event_t       ev;
+        net_state_t          to;
+        net_sm_action_type_t act;
+        bool                 lost;
+    } t[] = {
+        { NET_STATE_IDLE, NET_EV_START, NET_STATE_CONNECTING, NET_ACT_CONNECT, false },
+        { NET_STATE_IDLE, NET_EV_CONNECTED, NET_STATE_IDLE, NET_ACT_NONE, false },
+        { NET_STATE_IDLE, NET_EV_GOT_IP, NET_STATE_IDLE, NET_ACT_NONE, false },
+        { NET_STATE_IDLE, NET_EV_DISCONNECTED, NET_STATE_IDLE, NET_ACT_NONE, false },
+        { NET_STATE_IDLE, NET_EV_BACKOFF_EXPIRED, NET_STATE_IDLE, NET_ACT_NONE, false },
+        { NET_STATE_IDLE, NET_EV_DEADLINE, NET_STATE_FAILED, NET_ACT_FAIL, false },
+
+        { NET_STATE_CONNECTING, NET_EV_START, NET_STATE_CONNECTING, NET_ACT_NONE, false },
+        { NET_STATE_CONNECTING, NET_EV_CONNECTED, NET_STATE_ASSOCIATED, NET_ACT_NONE, false },
+        { NET_STATE_CONNECTING, NET_EV_GOT_IP, NET_STATE_READY, NET_ACT_READY, false },
+        { NET_STATE_CONNECTING, NET_EV_LOST_IP, NET_STATE_CONNECTING, NET_ACT_NONE, false },
+        { NET_STATE_CONNECTING, NET_EV_DISCONNECTED, NET_STATE_BACKOFF, NET_ACT_BACKOFF, false },
+        { NET_STATE_CONNECTING, NET_EV_BACKOFF_EXPIRED, NET_STATE_CONNECTING, NET_ACT_NONE, false },
+        { NET_STATE_CONNECTING, NET_EV_DEADLINE, NET_STATE_FAILED, NET_ACT_FAIL, false },
+
+        { NET_STATE_ASSOCIATED, NET_EV_CONNECTED, NET_STATE_ASSOCIATED, NET_ACT_NONE, false },
+        { NET_STATE_ASSOCIATED, NET_EV_GOT_IP, NET_STATE_READY, NET_ACT_READY, false },
+        { NET_STATE_ASSOCIATED, NET_EV_DISCONNECTED, NET_STATE_BACKOFF, NET_ACT_BACKOFF, false },
+        { NET_STATE_ASSOCIATED, NET_EV_DEADLINE, NET_STATE_FAILED, NET_ACT_FAIL, false },
+
+        { NET_STATE_READY, NET_EV_START, NET_STATE_READY, NET_ACT_NONE, false },
+        { NET_STATE_READY, NET_EV_GOT_IP, NET_STATE_READY, NET_ACT_READY, false },
+        { NET_STATE_READY, NET_EV_LOST_IP, NET_STATE_ASSOCIATED, NET_ACT_NONE, true },
+        { NET_STATE_READY, NET_EV_DISCONNECTED, NET_STATE_BACKOFF, NET_ACT_BACKOFF, true },
+        { NET_STATE_READY, NET_EV_BACKOFF_EXPIRED, NET_STATE_READY, NET_ACT_NONE, false },
+        { NET_STATE_READY, NET_EV_DEADLINE, NET_STATE_READY, NET_ACT_NONE, false },
+
+        { NET_STATE_BACKOFF, NET_EV_CONNECTED, NET_STATE_BACKOFF, NET_ACT_NONE, false },
+        { NET_STATE_BACKOFF, NET_EV_DISCONNECTED, NET_STATE_BACKOFF, NET_ACT_NONE, false },
+        { NET_STATE_BACKOFF, NET_EV_BACKOFF_EXPIRED, NET_STATE_CONNECTING, NET_ACT_CONNECT, false },
+        { NET_STATE_BACKOFF, NET_EV_DEADLINE, NET_STATE_FAILED, NET_ACT_FAIL, false },
+
+        { NET_STATE_FAILED, NET_EV_START, NET_STATE_FAILED, NET_ACT_NONE, false },
+        { NET_STATE_FAILED, NET_EV_GOT_IP, NET_STATE_FAILED, NET_ACT_NONE, false },
+        { NET_STATE_FAILED, NET_EV_DISCONNECTED, NET_STATE_FAILED, NET_ACT_NONE, false },
+        { NET_STATE_FAILED, NET_EV_BACKOFF_EXPIRED, NET_STATE_FAILED, NET_ACT_NONE, false },
+        { NET_STATE_FAILED, NET_EV_DEADLINE, NET_STATE_FAILED, NET_ACT_NONE, false },
+    };
+
+    for (size_t i = 0; i < sizeof(t) / sizeof(t[0]); i++) {
+        net_sm_t sm;
+        force(&sm, t[i].from);
+        net_sm_action_t a = net_sm_handle(&sm, t[i].ev, REASON_BEACON);
+        if (sm.state != t[i].to || a.type != t[i].act || a.ready_lost != t[i].lost) {
+            fprintf(stderr, "  row %zu: %s + ev %d -> %s, act %d\n", i,
+                    net_sm_state_name(t[i].from), t[i].ev, net_sm_state_name(sm.state), a.type);
+        }
+        CHECK_EQ(sm.state, t[i].to);
+        CHECK_EQ(a.type, t[i].act);
+        CHECK_EQ(a.ready_lost, t[i].lost);
+    }
+
+    CHECK_STR(net_sm_state_name(NET_STATE_BACKOFF), "backoff");
+    CHECK_STR(net_sm_state_name((net_state_t)42), "?");
+}
+
+/* ---- simulated event source: what net_conn.c does on the target ---- */
+
+typedef struct {
+    net_sm_t sm;
+    uint32_t now_ms;
+
+    /* the world */
+    uint32_t ap_up_from_ms;     /* AP answers from then on (NEVER = not at all) */
+    uint32_t ap_down_from_ms;   /* and until then */
+    uint32_t assoc_ms;          /* time of one connect attempt */
+
+    /* timers and the attempt in flight (NEVER = not armed) */
+    uint32_t result_at_ms;
+    uint32_t backoff_at_ms;
+    uint32_t deadline_at_ms;
+
+    /* what happened */
+    uint32_t connects;
+    uint32_t readies;
+    uint32_t fails;
+    uint32_t lost;
+    uint32_t ready_at_ms;
+    uint32_t fail_at_ms;
+    uint32_t backoffs[64];
+    uint32_t n_backoffs;
+} sim_t;
+
+static void sim_execute(sim_t *s, net_sm_action_t a)
+{
+    s->lost += a.ready_lost;
+
+    switch (a.type) {
+        case NET_ACT_CONNECT:
+            s->connects++;
+            s->result_at_ms = s->now_ms + s->assoc_ms;
+            break;
+        case NET_ACT_BACKOFF:
+            if (s->n_backoffs < 64) {
+                s->backoffs[s->n_backoffs++] = a.delay_ms;
+            }
+            s->backoff_at_ms = s->now_ms + a.delay_ms;
+            break;
+        case NET_ACT_READY:
+            s->readies++;
+            s->ready_at_ms = s->now_ms;
+            s->deadline_at_ms = NEVER;
+            break;
+        case NET_ACT_FAIL:
+            s->fails++;
+            s->fail_at_ms = s->now_ms;
+            s->deadline_at_ms = NEVER;
+            s->backoff_at_ms = NEVER;
+            break;
+        default:
+            break;
+    }
+}
+
+static void sim_event(sim_t *s, net_sm_event_t ev, uint16_t reason)
+{
+    sim_execute(s, net_sm_handle(&s->sm, ev, reason));
+}
+
+static void sim_start(sim_t *s, const net_sm_config_t *cfg, uint32_t deadline_ms)
+{
+    memset(s, 0, sizeof(*s));
+    net_sm_init(&s->sm, cfg, 0xC0FFEE);
+    s->ap_down_from_ms = NEVER;
+    s->assoc_ms = 300;
+    s->result_at_ms = NEVER;
+    s->backoff_at_ms = NEVER;
+    s->deadline_at_ms = deadline_ms ? deadline_ms : NEVER;
+    sim_event(s, NET_EV_START, 0);
+}
+
+static bool ap_up(const sim_t *s)
+{
+    return s->now_ms >= s->ap_up_from_ms && s->now_ms < s->ap_down_from_ms;
+}
+
+/* run the timers and the AP until 'until_ms' */
+static void sim_run(sim_t *s, uint32_t until_ms)
+{
+    while (1) {
+        uint32_t next = s->result_at_ms;
+        next = s->backoff_at_ms < next ? s->backoff_at_ms : next;
+        next = s->deadline_at_ms < next ? s->deadline_at_ms : next;
+        if (next == NEVER || next > until_ms) {
+            break;
+        }
+        s->now_ms = next;
+
+        if (next == s->deadline_at_ms) {
+            s->deadline_at_ms = NEVER;
+            sim_event(s, NET_EV_DEADLINE, 0);
+        } else if (next == s->result_at_ms) {
+            s->result_at_ms = NEVER;
+            if (ap_up(s)) {
+                sim_event(s, NET_EV_CONNECTED, 0);
+                sim_event(s, NET_EV_GOT_IP, 0);
+            } else {
+                sim_event(s, NET_EV_DISCONNECTED, REASON_NO_AP);
+            }
+        } else {
+            s->backoff_at_ms = NEVER;
+            sim_event(s, NET_EV_BACKOFF_EXPIRED, 0);
+        }
+    }
+    s->now_ms = until_ms;
+}
+
+static void test_sim_ap_up(void)
+{
+    sim_t s;
+    sim_start(&s, &s_cfg, 30000);
+    sim_run(&s, 60000);
+    CHECK_EQ(s.connects, 1);
+    CHECK_EQ(s.readies, 1);
+    CHECK_EQ(s.ready_at_ms, 300);
+    CHECK_EQ(s.fails, 0);                   /* deadline disarmed by READY */
+    CHECK_EQ(s.sm.state, NET_STATE_READY);
+}
+
+/* AP boots 20 s late: retries with growing, jittered backoff, then READY */
+static void test_sim_retry_backoff(void)
+{
+    sim_t s;
+    sim_start(&s, &s_cfg, 0);
+    s.ap_up_from_ms = 20000;
+    sim_run(&s, 120000);
+
+    CHECK_EQ(s.readies, 1);
+    CHECK(s.ready_at_ms >= 20000);
+    CHECK_EQ(s.connects, s.n_backoffs + 1);
+    for (uint32_t i = 0; i < s.n_backoffs; i++) {
+        uint32_t d = cap(&s_cfg, (uint16_t)i);
+        CHECK(s.backoffs[i] >= d / 2 && s.backoffs[i] <= d);
+    }
+    CHECK(s.n_backoffs >= 4);
+    CHECK_EQ(s.sm.attempt, 0);              /* READY resets the count */
+
+    /* at worst one full backoff step after the AP came up */
+    CHECK(s.ready_at_ms <= 20000 + cap(&s_cfg, (uint16_t)s.n_backoffs) + s.assoc_ms);
+}
+
+static void test_sim_max_retries(void)
+{
+    net_sm_config_t cfg = s_cfg;
+    cfg.max_retries = 5;
+
+    sim_t s;
+    sim_start(&s, &cfg, 0);
+    s.ap_up_from_ms = NEVER;
+    sim_run(&s, 600000);
+
+    CHECK_EQ(s.connects, 6);                /* first try + 5 retries */
+    CHECK_EQ(s.n_backoffs, 5);
+    CHECK_EQ(s.fails, 1);
+    CHECK_EQ(s.sm.state, NET_STATE_FAILED);
+    CHECK_EQ(s.sm.last_reason, REASON_NO_AP);
+
+    /* terminal: a late AP does not bring it back */
+    s.ap_up_from_ms = 0;
+    sim_event(&s, NET_EV_GOT_IP, 0);
+    sim_event(&s, NET_EV_START, 0);
+    CHECK_EQ(s.sm.state, NET_STATE_FAILED);
+    CHECK_EQ(s.readies, 0);
+}
+
+/* retry forever, but the deadline ends it, even with an attempt in flight */
+static void test_sim_deadline(void)
+{
+    sim_t s;
+    sim_start(&s, &s_cfg, 30000);
+    s.ap_up_from_ms = NEVER;
+    sim_run(&s, 200000);
+
+    CHECK_EQ(s.fails, 1);
+    CHECK_EQ(s.fail_at_ms, 30000);
+    CHECK_EQ(s.sm.state, NET_STATE_FAILED);
+    uint32_t connects = s.connects;
+    CHECK(connects >= 3);
+
+    /* the attempt that was running when the deadline hit reports later */
+    s.result_at_ms = s.now_ms;
+    sim_run(&s, s.now_ms);
+    CHECK_EQ(s.connects, connects);
+    CHECK_EQ(s.fails, 1);
+}
+
+/* READY, the AP goes away for a while, comes back: lost once, READY again */
+static void test_sim_outage(void)
+{
+    sim_t s;
+    sim_start(&s, &s_cfg, 30000);
+    s.ap_down_from_ms = 10000;
+    sim_run(&s, 10000);
+    CHECK_EQ(s.readies, 1);
+
+    sim_event(&s, NET_EV_DISCONNECTED, REASON_BEACON);
+    CHECK_EQ(s.lost, 1);
+    CHECK_EQ(s.n_backoffs, 1);
+    CHECK(s.backoffs[0] <= s_cfg.backoff_base_ms);  /* fresh outage: attempt 0 */
+
+    /* a second disconnect event for the same loss is ignored */
+    sim_event(&s, NET_EV_DISCONNECTED, REASON_BEACON);
+    CHECK_EQ(s.n_backoffs, 1);
+
+    sim_run(&s, 25000);
+    CHECK_EQ(s.readies, 1);
+    s.ap_up_from_ms = 25000;
+    s.ap_down_from_ms = NEVER;
+    sim_run(&s, 120000);
+    CHECK_EQ(s.readies, 2);
+    CHECK_EQ(s.lost, 1);
+    CHECK_EQ(s.fails, 0);                   /* deadline only covers the first connect */
+    CHECK_EQ(s.sm.attempt, 0);
+
+    /* DHCP renew failed, link still up */
+    sim_event(&s, NET_EV_LOST_IP, 0);
+    CHECK_EQ(s.lost, 2);
+    CHECK_EQ(s.sm.state, NET_STATE_ASSOCIATED);
+    sim_event(&s, NET_EV_GOT_IP, 0);
+    CHECK_EQ(s.readies, 3);
+}
+
+int main(void)
+{
+    RUN(test_backoff_bounds);
+    RUN(test_backoff_extremes);
+    RUN(test_fleet_not_in_lockstep);
+    RUN(test_transition_table);
+    RUN(test_sim_ap_up);
+    RUN(test_sim_retry_backoff);
+    RUN(test_sim_max_retries);
+    RUN(test_sim_deadline);
+    RUN(test_sim_outage);
+    return check_done();
+}
@@ -0,0 +1,511 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: OTA engine against tools/ota_server.py (Range, drops, resume)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * The engine runs unchanged: HTTP over real sockets to ota_server.py on
+ * 127.0.0.1, flash and NVS in RAM (stubs/esp_ota_host.c, nvs_host.c). A
+ * "reset" is the end of one ota_engine_run() with the link down
+ * (host_http_link_down_after); the next run starts with the flash and
+ * NVS as they were, like after a reboot.
+ */
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdarg.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "check.h"
+#include "esp_event.h"
+#include "esp_http_client.h"
+#include "esp_ota_ops.h"
+#include "freertos/FreeRTOS.h"
+#include "nvs.h"
+#include "ota_engine.h"
+
+extern char **environ;
+
+#define WWW         "build/ota_www"
+#define IMG_SIZE    (300 * 1024 + 123)      /* not sector aligned */
+
+static uint8_t s_img_a[IMG_SIZE];
+static uint8_t s_img_b[IMG_SIZE];
+static pid_t   s_server;
+static int     s_port;
+static char    s_url_a[64], s_url_b[64];
+
+static int s_done_events, s_failed_events;
+
+static esp_err_t on_event(esp_event_base_t base, int32_t id, const void *data, size_t size)
+{
+    CHECK(base == OTA_ENGINE_EVENT);
+    CHECK_EQ(size, sizeof(ota_progress_t));
+    (void)data;
+    s_done_events += (id == OTA_ENGINE_EVENT_DONE);
+    s_failed_events += (id == OTA_ENGINE_EVENT_FAILED);
+    return ESP_OK;
+}
+
+/* ---- images and server ---- */
+
+static void make_image(uint8_t *img, uint32_t seed)
+{
+    for (size_t i = 0; i < IMG_SIZE; i++) {
+        img[i] = (i % 512 < 384) ? (uint8_t)check_rand(&seed) : (uint8_t)(i >> 9);
+    }
+    img[0] = 0xE9;                  /* ESP image magic */
+}
+
+/* the release after img: a few constants and one block changed */
+static void next_release(uint8_t *next, const uint8_t *img, uint32_t seed)
+{
+    memcpy(next, img, IMG_SIZE);
+    for (int i = 0; i < 40; i++) {
+        next[1 + check_rand(&seed) % (IMG_SIZE - 1)] ^= 0x5A;
+    }
+    for (size_t i = 100000; i < 104000; i++) {
+        next[i] = (uint8_t)check_rand(&seed);
+    }
+}
+
+static void write_file(const char *name, const uint8_t *data, size_t len)
+{
+    char path[128];
+    snprintf(path, sizeof(path), WWW "/%s", name);
+    FILE *f = fopen(path, "wb");
+    CHECK(f != NULL);
+    if (f) {
+        CHECK_EQ(fwrite(data, 1, len, f), len);
+        fclose(f);
+    }
+}
+
+static int free_port(void)
+{
+    struct sockaddr_in a = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t len = sizeof(a);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+
+    bind(fd, (struct sockaddr *)&a, sizeof(a));
+    getsockname(fd, (struct sockaddr *)&a, &len);
+    close(fd);
+    return ntohs(a.sin_port);
+}
+
+static bool port_open(int port)
+{
+    struct sockaddr_in a = {
+        .sin_family = AF_INET, .sin_port = htons((uint16_t)port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    bool ok = connect(fd, (struct sockaddr *)&a, sizeof(a)) == 0;
+    close(fd);
+    return ok;
+}
+
+/* tools/ota_pack.py pack WWW/<in> [--base WWW/<base>] -o WWW/<out>, patch size */
+static long pack(const char *in, const char *base, const char *out)
+{
+    char in_path[64], base_path[64], out_path[64];
+    const char *argv[] = {
+        "python3", "../tools/ota_pack.py", "pack", in_path, "-o", out_path,
+        base ? "--base" : NULL, base_path, NULL,
+    };
+    struct stat st;
+    pid_t pid;
+    int status = -1;
+
+    snprintf(in_path, sizeof(in_path), WWW "/%s", in);
+    snprintf(base_path, sizeof(base_path), WWW "/%s", base ? base : "");
+    snprintf(out_path, sizeof(out_path), WWW "/%s", out);
+
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_addopen(&fa, 1, "/dev/null", O_WRONLY, 0);
+    if (posix_spawnp(&pid, "python3", &fa, NULL, (char *const *)argv, environ) == 0) {
+        waitpid(pid, &status, 0);
+    }
+    posix_spawn_file_actions_destroy(&fa);
+    if (status != 0 || stat(out_path, &st) != 0) {
+        fprintf(stderr, "ota_pack.py pack %s failed\n", in);
+        return -1;
+    }
+    return (long)st.st_size;
+}
+
+/* ota_server.py with extra options (NULL terminated), same port every time */
+static bool server_start(const char *opt, ...)
+{
+    char port[8];
+    const char *argv[16] = {
+        "python3", "../tools/ota_server.py", "--bind", "127.0.0.1", "--port", port,
+        "--dir", WWW, "--quiet",
+    };
+    int argc = 9;
+    va_list ap;
+
+    snprintf(port, sizeof(port), "%d", s_port);
+    va_start(ap, opt);
+    for (const char *o = opt; o && argc < 15; o = va_arg(ap, const char *)) {
+        argv[argc++] = o;
+    }
+    va_end(ap);
+    argv[argc] = NULL;
+
+    posix_spawn_file_actions_t fa;
+    posix_spawn_file_actions_init(&fa);
+    posix_spawn_file_actions_addopen(&fa, 1, "/dev/null", O_WRONLY, 0);    /* stats lines */
+    int rc = posix_spawnp(&s_server, "python3", &fa, NULL, (char *const *)argv, environ);
+    posix_spawn_file_actions_destroy(&fa);
+    if (rc != 0) {
+        fprintf(stderr, "cannot start python3 ../tools/ota_server.py\n");
+        return false;
+    }
+    for (int i = 0; i < 500; i++) {
+        if (port_open(s_port)) {
+            return true;
+        }
+        usleep(10 * 1000);
+    }
+    fprintf(stderr, "ota_server.py did not come up on port %d\n", s_port);
+    return false;
+}
+
+static void server_stop(void)
+{
+    if (s_server > 0) {
+        kill(s_server, SIGTERM);
+        waitpid(s_server, NULL, 0);
+        s_server = 0;
+    }
+}
+
+/* ---- engine runs ---- */
+
+static ota_engine_config_t config(const char *url, uint32_t depth, bool resume)
+{
+    return (ota_engine_config_t){
+        .url = url,
+        .timeout_ms = 3000,
+        .buf_size = 4096,
+        .pipeline_depth = depth,
+        .progress_interval_ms = 5,
+        .resume = resume,
+        .max_retries = 1,
+    };
+}
+
+static esp_err_t run(const ota_engine_config_t *cfg, ota_progress_t *res)
+{
+    s_done_events = s_failed_events = 0;
+    esp_err_t err = ota_engine_run(cfg, res);
+
+    CHECK(!ota_engine_busy());
+    CHECK(!host_ota_handle_open());
+    CHECK_EQ(host_http_clients(), 0);
+    CHECK_EQ(s_done_events, err == ESP_OK);
+    CHECK_EQ(s_failed_events, err != ESP_OK);
+    return err;
+}
+
+static const esp_partition_t *update_slot(void)
+{
+    return esp_ota_get_next_update_partition(NULL);
+}
+
+static bool flash_holds(const uint8_t *img)
+{
+    return memcmp(host_ota_slot(update_slot()), img, IMG_SIZE) == 0;
+}
+
+/* a new device: empty NVS, old image running, garbage in the update slot */
+static void fresh_device(const uint8_t *expect)
+{
+    host_ota_reset();
+    host_nvs_erase_all();
+    host_ota_expect(expect, IMG_SIZE);
+    host_http_link_down_after(-1);
+}
+
+/* the image the device runs now, base of a delta */
+static void running_image(const uint8_t *img)
+{
+    memcpy(host_ota_slot(esp_ota_get_running_partition()), img, IMG_SIZE);
+}
+
+/* ---- tests ---- */
+
+static void test_clean_download(void)
+{
+    static const uint32_t depths[] = { 1, 2, 8 };
+    ota_progress_t res;
+
+    for (size_t i = 0; i < sizeof(depths) / sizeof(depths[0]); i++) {
+        fresh_device(s_img_a);
+        ota_engine_config_t cfg = config(s_url_a, depths[i], true);
+        CHECK_EQ(run(&cfg, &res), ESP_OK);
+        CHECK_EQ(res.stage, OTA_STAGE_DONE);
+        CHECK_EQ(res.total, IMG_SIZE);
+        CHECK_EQ(res.bytes, IMG_SIZE);
+        CHECK_EQ(res.image_bytes, IMG_SIZE);
+        CHECK_EQ(res.rx_bytes, IMG_SIZE);
+        CHECK_EQ(res.retries, 0);
+        CHECK_EQ(res.resumed_from, 0);
+        CHECK(flash_holds(s_img_a));
+        CHECK(host_ota_boot_partition() == update_slot());
+    }
+}
+
+/* drops inside one run: reconnect with Range, nothing is received twice */
+static void test_reconnect_with_range(void)
+{
+    static const uint32_t depths[] = { 1, 3 };
+    ota_progress_t res;
+
+    CHECK(server_start("--drop-kb", "64", NULL));
+    for (size_t i = 0; i < sizeof(depths) / sizeof(depths[0]); i++) {
+        fresh_device(s_img_a);
+        uint32_t req0 = host_http_requests();
+        ota_engine_config_t cfg = config(s_url_a, depths[i], false);
+
+        CHECK_EQ(run(&cfg, &res), ESP_OK);
+        CHECK_EQ(res.retries, IMG_SIZE / (64 * 1024));        /* one per drop */
+        CHECK_EQ(host_http_requests() - req0, res.retries + 1);
+        CHECK_EQ(res.rx_bytes, IMG_SIZE);
+        CHECK(flash_holds(s_img_a));
+        CHECK(host_ota_boot_partition() == update_slot());
+    }
+    server_stop();
+}
+
+/*
+ * Link lost at 150000 bytes, the run gives up (a reset in the field).
+ * The next run continues at the last saved sector; the flash behind it is
+ * scribbled over first, so every byte from there on must be written again.
+ */
+static void test_resume_after_reset(void)
+{
+    static const uint32_t depths[] = { 1, 2 };
+    ota_progress_t res;
+
+    CHECK(server_start(NULL));
+    for (size_t i = 0; i < sizeof(depths) / sizeof(depths[0]); i++) {
+        fresh_device(s_img_a);
+        ota_engine_config_t cfg = config(s_url_a, depths[i], true);
+
+        host_http_link_down_after(150000);
+        CHECK(run(&cfg, &res) != ESP_OK);
+        CHECK_EQ(res.bytes, 150000);
+        CHECK(host_ota_boot_partition() != update_slot());
+
+        uint32_t saved = 150000 & ~(uint32_t)(HOST_OTA_SECTOR - 1);
+        memset(host_ota_slot(update_slot()) + saved, 0x00, IMG_SIZE - saved);
+        host_http_link_down_after(-1);
+
+        CHECK_EQ(run(&cfg, &res), ESP_OK);
+        CHECK_EQ(res.resumed_from, saved);
+        CHECK_EQ(res.rx_bytes, IMG_SIZE - saved);
+        CHECK_EQ(res.bytes, IMG_SIZE);
+        CHECK(flash_holds(s_img_a));
+        CHECK(host_ota_boot_partition() == update_slot());
+
+        /* the record is gone: the next update starts at 0 */
+        CHECK_EQ(run(&cfg, &res), ESP_OK);
+        CHECK_EQ(res.resumed_from, 0);
+    }
+    server_stop();
+}
+
+/* resume with drops on the way: reset, then a link that keeps dropping */
+static void test_resume_on_a_bad_link(void)
+{
+    ota_progress_t res;
+
+    CHECK(server_start("--drop-kb", "40", NULL));
+    fresh_device(s_img_a);
+    ota_engine_config_t cfg = config(s_url_a, 2, true);
+
+    host_http_link_down_after(100000);
+    CHECK(run(&cfg, &res) != ESP_OK);
+    host_http_link_down_after(-1);
+
+    CHECK_EQ(run(&cfg, &res), ESP_OK);
+    CHECK(res.resumed_from > 0);
+    CHECK(res.retries >= 4);
+    CHECK(flash_holds(s_img_a));
+    server_stop();
+}
+
+/* the file changed between the runs: If-Range fails, start over at 0 */
+static void test_resume_image_changed(void)
+{
+    ota_progress_t res;
+
+    CHECK(server_start(NULL));
+    fresh_device(s_img_a);
+    ota_engine_config_t cfg = config(s_url_a, 2, true);
+
+    host_http_link_down_after(200000);
+    CHECK(run(&cfg, &res) != ESP_OK);
+    host_http_link_down_after(-1);
+
+    write_file("a.bin", s_img_b, IMG_SIZE);         /* new release, same name and size */
+    host_ota_expect(s_img_b, IMG_SIZE);
+    CHECK_EQ(run(&cfg, &res), ESP_OK);
+    CHECK_EQ(res.resumed_from, 0);
+    CHECK_EQ(res.rx_bytes, IMG_SIZE);
+    CHECK(flash_holds(s_img_b));
+
+    write_file("a.bin", s_img_a, IMG_SIZE);
+    server_stop();
+}
+
+/* a record for another URL is not used */
+static void test_resume_other_url(void)
+{
+    ota_progress_t res;
+
+    CHECK(server_start(NULL));
+    fresh_device(s_img_a);
+    ota_engine_config_t cfg = config(s_url_a, 1, true);
+
+    host_http_link_down_after(120000);
+    CHECK(run(&cfg, &res) != ESP_OK);
+    host_http_link_down_after(-1);
+
+    cfg.url = s_url_b;
+    host_ota_expect(s_img_b, IMG_SIZE);
+    CHECK_EQ(run(&cfg, &res), ESP_OK);
+    CHECK_EQ(res.resumed_from, 0);
+    CHECK(flash_holds(s_img_b));
+    server_stop();
+}
+
+/* no Range support and a drop at the same point every time: give up, old image stays */
+static void test_no_range_gives_up(void)
+{
+    ota_progress_t res;
+
+    CHECK(server_start("--no-range", "--drop-kb", "64", NULL));
+    fresh_device(s_img_a);
+    ota_engine_config_t cfg = config(s_url_a, 2, true);
+    cfg.max_retries = 3;
+
+    uint32_t req0 = host_http_requests();
+    CHECK(run(&cfg, &res) != ESP_OK);
+    CHECK_EQ(res.stage, OTA_STAGE_FAILED);
+    CHECK_EQ(host_http_requests() - req0, 1 + cfg.max_retries);
+    CHECK(host_ota_boot_partition() == esp_ota_get_running_partition());
+
+    /* the record it left is refused by the server (200): start over at 0 */
+    CHECK(run(&cfg, &res) != ESP_OK);
+    CHECK_EQ(res.resumed_from, 0);
+    CHECK(host_ota_boot_partition() == esp_ota_get_running_partition());
+    server_stop();
+}
+
+/*
+ * .aip bodies from ota_pack.py: decoded while writing, a reconnect
+ * continues the decoder, a reset starts the patch over (it is not
+ * checkpointed) and a delta needs the image it was made for.
+ */
+static void test_patch_bodies(void)
+{
+    char url[80];
+    ota_progress_t res;
+    long comp = pack("a.bin", NULL, "a.aip");
+    long delta = pack("a.bin", "b.bin", "a_delta.aip");
+
+    CHECK(comp > 0 && delta > 0 && delta < IMG_SIZE / 20);
+    CHECK(server_start("--drop-kb", "64", NULL));
+
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/a.aip", s_port);
+    fresh_device(s_img_a);
+    running_image(s_img_b);
+    ota_engine_config_t cfg = config(url, 2, true);
+    CHECK_EQ(run(&cfg, &res), ESP_OK);
+    CHECK_EQ(res.rx_bytes, comp);
+    CHECK_EQ(res.image_bytes, IMG_SIZE);
+    CHECK_EQ(res.retries, comp / (64 * 1024));
+    CHECK(flash_holds(s_img_a));
+
+    fresh_device(s_img_a);
+    running_image(s_img_b);
+    host_http_link_down_after(100000);
+    CHECK(run(&cfg, &res) != ESP_OK);
+    host_http_link_down_after(-1);
+    CHECK_EQ(run(&cfg, &res), ESP_OK);
+    CHECK_EQ(res.resumed_from, 0);
+    CHECK_EQ(res.rx_bytes, comp);
+    CHECK(flash_holds(s_img_a));
+
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d/a_delta.aip", s_port);
+    fresh_device(s_img_a);
+    running_image(s_img_b);
+    cfg = config(url, 1, false);
+    CHECK_EQ(run(&cfg, &res), ESP_OK);
+    CHECK_EQ(res.rx_bytes, delta);
+    CHECK_EQ(res.image_bytes, IMG_SIZE);
+    CHECK(flash_holds(s_img_a));
+
+    /* running something else: refused before a byte is written */
+    fresh_device(s_img_a);
+    running_image(s_img_a);
+    CHECK(run(&cfg, &res) != ESP_OK);
+    CHECK_EQ(res.err, ESP_ERR_INVALID_VERSION);
+    CHECK_EQ(res.image_bytes, 0);
+    CHECK(host_ota_boot_partition() == esp_ota_get_running_partition());
+    server_stop();
+}
+
+int main(void)
+{
+    host_event_hook = on_event;
+    host_delay_cap_ms = 10;         /* retry back-off: seconds on the chip */
+
+    setenv("PYTHONDONTWRITEBYTECODE", "1", 1);
+    mkdir("build", 0755);
+    mkdir(WWW, 0755);
+    make_image(s_img_a, 1);
+    next_release(s_img_b, s_img_a, 2);
+    write_file("a.bin", s_img_a, IMG_SIZE);
+    write_file("b.bin", s_img_b, IMG_SIZE);
+
+    s_port = free_port();
+    snprintf(s_url_a, sizeof(s_url_a), "http://127.0.0.1:%d/a.bin", s_port);
+    snprintf(s_url_b, sizeof(s_url_b), "http://127.0.0.1:%d/b.bin", s_port);
+
+    if (!server_start(NULL)) {
+        return 1;
+    }
+    RUN(test_clean_download);
+    server_stop();
+
+    RUN(test_reconnect_with_range);
+    RUN(test_resume_after_reset);
+    RUN(test_resume_on_a_bad_link);
+    RUN(test_resume_image_changed);
+    RUN(test_resume_other_url);
+    RUN(test_no_range_gives_up);
+    RUN(test_patch_bodies);
+    return check_done();
+}
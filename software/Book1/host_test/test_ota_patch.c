@@ -0,0 +1,625 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: streaming patch decoder against the output of tools/ota_pack.py
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * argv[1] is the directory ota_patch_crosscheck.py gen filled: old/new
+ * images and their compressed and delta patches, made by ota_pack.py.
+ * The mutated patches go to <dir>/mutations.txt for the Python side.
+ */
+
+#include <stdbool.h>
+
+#include "check.h"
+#include "mbedtls/sha256.h"
+#include "ota_patch.h"
+
+#define OUT_MAX         (256 * 1024)
+#define CHUNK_MAX       1093            /* prime, > OTA_PATCH_OUT_BUF */
+
+typedef struct {
+    uint8_t *data;
+    size_t   len;
+} blob_t;
+
+/* the callbacks: base image in, output collected, failures on request */
+typedef struct {
+    const uint8_t *base;
+    size_t   base_len;
+    uint8_t  out[OUT_MAX];
+    size_t   out_len;
+    uint32_t base_checks;
+    uint32_t writes;
+    uint32_t last_write;
+    uint32_t bad_writes;        /* empty, too long, or short but not the last */
+    uint32_t bad_reads;         /* outside the base image */
+    uint32_t fail_write;        /* fail the n-th write, 0 = never */
+    bool     fail_read;
+} sink_t;
+
+static sink_t      s_sink;
+static ota_patch_t s_p;         /* malloc'ed on the target, never on a stack */
+
+static blob_t s_old, s_new, s_comp, s_delta;
+static blob_t s_small_old, s_small_new, s_small_comp, s_small_delta;
+
+static void sha256(const uint8_t *data, size_t len, uint8_t digest[32])
+{
+    mbedtls_sha256_context c;
+    mbedtls_sha256_init(&c);
+    mbedtls_sha256_starts(&c, 0);
+    mbedtls_sha256_update(&c, data, len);
+    mbedtls_sha256_finish(&c, digest);
+    mbedtls_sha256_free(&c);
+}
+
+static bool base_ok(void *ctx, const ota_patch_hdr_t *hdr)
+{
+    sink_t *s = ctx;
+    uint8_t digest[32];
+
+    s->base_checks++;
+    if (hdr->old_size > s->base_len) {
+        return false;
+    }
+    sha256(s->base, hdr->old_size, digest);
+    return memcmp(digest, hdr->old_sha256, 32) == 0;
+}
+
+static bool read_old(void *ctx, uint32_t off, uint8_t *buf, size_t len)
+{
+    sink_t *s = ctx;
+
+    if (off > s->base_len || len > s->base_len - off) {
+        s->bad_reads++;
+        return false;
+    }
+    memcpy(buf, s->base + off, len);
+    return !s->fail_read;
+}
+
+static bool write_out(void *ctx, const uint8_t *buf, size_t len)
+{
+    sink_t *s = ctx;
+
+    if (len == 0 || len > OTA_PATCH_OUT_BUF ||
+        (s->writes && s->last_write != OTA_PATCH_OUT_BUF)) {
+        s->bad_writes++;
+    }
+    s->writes++;
+    s->last_write = (uint32_t)len;
+    if (s->writes == s->fail_write || len > OUT_MAX - s->out_len) {
+        return false;
+    }
+    memcpy(s->out + s->out_len, buf, len);
+    s->out_len += len;
+    return true;
+}
+
+/* the whole patch in chunks of `chunk` bytes, result of the last feed */
+static ota_patch_result_t decode(const blob_t *base, const uint8_t *patch, size_t len,
+                                 size_t chunk)
+{
+    const ota_patch_io_t io = {
+        .base_ok = base_ok, .read_old = read_old, .write = write_out, .ctx = &s_sink,
+    };
+    ota_patch_result_t rc = OTA_PATCH_MORE;
+
+    s_sink.base = base ? base->data : NULL;
+    s_sink.base_len = base ? base->len : 0;
+    s_sink.out_len = 0;
+    s_sink.base_checks = s_sink.writes = s_sink.last_write = 0;
+    ota_patch_init(&s_p, &io);
+    for (size_t i = 0; i < len; i += chunk) {
+        rc = ota_patch_feed(&s_p, patch + i, len - i < chunk ? len - i : chunk);
+    }
+    return rc;
+}
+
+/* what the engine accepts: END reached and the output hashes to new_sha256 */
+static bool accepted(ota_patch_result_t rc)
+{
+    uint8_t digest[32];
+
+    if (rc != OTA_PATCH_DONE) {
+        return false;
+    }
+    sha256(s_sink.out, s_sink.out_len, digest);
+    return memcmp(digest, ota_patch_header(&s_p)->new_sha256, 32) == 0;
+}
+
+static blob_t load(const char *dir, const char *name)
+{
+    char path[256];
+    blob_t b = { 0 };
+
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "%s missing (ota_patch_crosscheck.py gen %s)\n", path, dir);
+        exit(1);
+    }
+    fseek(f, 0, SEEK_END);
+    b.len = (size_t)ftell(f);
+    rewind(f);
+    b.data = malloc(b.len ? b.len : 1);
+    if (!b.data || fread(b.data, 1, b.len, f) != b.len) {
+        fprintf(stderr, "cannot read %s\n", path);
+        exit(1);
+    }
+    fclose(f);
+    return b;
+}
+
+/* ---- patches built by hand ---- */
+
+static uint8_t s_base[4096];
+static const blob_t s_base_blob = { s_base, sizeof(s_base) };
+
+static struct {
+    uint8_t b[32 * 1024];
+    size_t  len;
+} s_pk;
+
+static void pk_byte(uint8_t v)
+{
+    s_pk.b[s_pk.len++] = v;
+}
+
+static void pk_varint(uint32_t v)
+{
+    while (v >= 0x80) {
+        pk_byte((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    pk_byte((uint8_t)v);
+}
+
+static void pk_u32(uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        pk_byte((uint8_t)(v >> (8 * i)));
+    }
+}
+
+/* header; old_sha256 of the first old_size bytes of s_base, new_sha256 zero */
+static void pk_begin(uint8_t flags, uint32_t new_size, uint32_t old_size)
+{
+    s_pk.len = 0;
+    memcpy(s_pk.b, "AIPK", 4);
+    s_pk.len = 4;
+    pk_byte(OTA_PATCH_VERSION);
+    pk_byte(flags);
+    pk_byte(0);
+    pk_byte(0);
+    pk_u32(new_size);
+    pk_u32(old_size);
+    sha256(s_base, old_size, &s_pk.b[s_pk.len]);
+    s_pk.len += 32;
+    memset(&s_pk.b[s_pk.len], 0, 32);
+    s_pk.len += 32;
+}
+
+/* op byte: 0 LIT, 1 NEW, 2 OLD; the argument follows */
+static void pk_op(int op, uint32_t n)
+{
+    if (n <= 63) {
+        pk_byte((uint8_t)((op << 6) | (n - 1)));
+    } else {
+        pk_byte((uint8_t)((op << 6) | 63));
+        pk_varint(n - 64);
+    }
+}
+
+static void pk_old(uint32_t n, int32_t delta)
+{
+    pk_op(2, n);
+    pk_varint(delta >= 0 ? (uint32_t)delta << 1 : ((uint32_t)-delta << 1) - 1);
+}
+
+static void pk_end(void)
+{
+    pk_byte(0xC0);
+}
+
+/* in one piece and byte by byte, same answer (CHECK reports the caller's line) */
+#define EXPECT(base, want) do {                                             \
+    CHECK_EQ(decode(base, s_pk.b, s_pk.len, s_pk.len), want);               \
+    CHECK_EQ(decode(base, s_pk.b, s_pk.len, 1), want);                      \
+} while (0)
+
+/* ---- tests ---- */
+
+static void test_detect_and_header(void)
+{
+    CHECK(ota_patch_detect(s_comp.data, s_comp.len));
+    CHECK(ota_patch_detect(s_delta.data, 4));
+    CHECK(!ota_patch_detect(s_delta.data, 3));
+    CHECK(!ota_patch_detect(s_new.data, s_new.len));        /* 0xE9... raw image */
+
+    CHECK_EQ(decode(&s_old, s_delta.data, OTA_PATCH_HDR_SIZE - 1, 1), OTA_PATCH_MORE);
+    CHECK(ota_patch_header(&s_p) == NULL);
+    CHECK_EQ(decode(&s_old, s_delta.data, OTA_PATCH_HDR_SIZE, 7), OTA_PATCH_MORE);
+
+    const ota_patch_hdr_t *h = ota_patch_header(&s_p);
+    CHECK(h != NULL);
+    if (h) {
+        uint8_t digest[32];
+        CHECK_EQ(h->version, OTA_PATCH_VERSION);
+        CHECK_EQ(h->flags, OTA_PATCH_FLAG_DELTA);
+        CHECK_EQ(h->new_size, s_new.len);
+        CHECK_EQ(h->old_size, s_old.len);
+        sha256(s_new.data, s_new.len, digest);
+        CHECK(memcmp(h->new_sha256, digest, 32) == 0);
+    }
+    CHECK_EQ(s_sink.base_checks, 1);
+    CHECK_EQ(s_sink.writes, 0);
+}
+
+/* ota_pack.py output, every chunk size from 1 to CHUNK_MAX */
+static void round_trip(const char *name, const blob_t *base, const blob_t *patch,
+                       const blob_t *want)
+{
+    int shown = 0;
+
+    for (size_t chunk = 1; chunk <= CHUNK_MAX; chunk++) {
+        s_sink.bad_writes = s_sink.bad_reads = 0;
+        ota_patch_result_t rc = decode(base, patch->data, patch->len, chunk);
+        bool ok = rc == OTA_PATCH_DONE && (chunk > 1 || accepted(rc)) &&
+                  s_sink.out_len == want->len &&
+                  memcmp(s_sink.out, want->data, want->len) == 0 &&
+                  !s_sink.bad_writes && !s_sink.bad_reads &&
+                  s_sink.base_checks == (base ? 1u : 0u);
+
+        CHECK(ok);
+        if (!ok && shown++ < 3) {
+            fprintf(stderr, "  %s, chunk %zu: %s, %zu of %zu bytes\n", name, chunk,
+                    ota_patch_result_name(rc), s_sink.out_len, want->len);
+        }
+    }
+}
+
+static void test_round_trip_compressed(void)
+{
+    round_trip("comp.aip", NULL, &s_comp, &s_new);
+    round_trip("small_comp.aip", NULL, &s_small_comp, &s_small_new);
+}
+
+static void test_round_trip_delta(void)
+{
+    round_trip("delta.aip", &s_old, &s_delta, &s_new);
+    round_trip("small_delta.aip", &s_small_old, &s_small_delta, &s_small_new);
+}
+
+/* LIT, overlapping NEW (a run), OLD forwards, OLD continuing, OLD backwards */
+static void test_hand_built_ops(void)
+{
+    uint8_t want[200];
+    size_t n = 0;
+
+    memcpy(want, "abc", 3);
+    n = 3;
+    for (int i = 0; i < 70; i++, n++) {
+        want[n] = want[n - 3];
+    }
+    memcpy(&want[n], &s_base[1000], 105);       /* 100 + 5 continuing */
+    n += 105;
+    memcpy(&want[n], &s_base[10], 20);
+    n += 20;
+    memcpy(&want[n], &s_base[4086], 2);         /* ends exactly at old_size */
+    n += 2;
+
+    pk_begin(OTA_PATCH_FLAG_DELTA, (uint32_t)n, 4088);
+    pk_op(0, 3);
+    memcpy(&s_pk.b[s_pk.len], "abc", 3);
+    s_pk.len += 3;
+    pk_op(1, 70);                               /* 64 + varint */
+    pk_varint(3);
+    pk_old(100, 1000);
+    pk_old(5, 0);
+    pk_old(20, 10 - 1105);
+    pk_old(2, 4086 - 30);
+    pk_end();
+
+    EXPECT(&s_base_blob, OTA_PATCH_DONE);
+    CHECK_EQ(s_sink.out_len, n);
+    CHECK(memcmp(s_sink.out, want, n) == 0);
+    CHECK_EQ(s_sink.bad_reads, 0);
+
+    /* every shorter prefix just wants more */
+    int early = 0;
+    for (size_t len = 0; len < s_pk.len; len++) {
+        early += decode(&s_base_blob, s_pk.b, len, 1) != OTA_PATCH_MORE;
+    }
+    CHECK_EQ(early, 0);
+}
+
+/* NEW reaches back exactly OTA_PATCH_WINDOW bytes, not one more */
+static void test_window_edge(void)
+{
+    static uint8_t lit[OTA_PATCH_WINDOW + 100];
+    uint32_t seed = 7;
+
+    for (size_t i = 0; i < sizeof(lit); i++) {
+        lit[i] = (uint8_t)check_rand(&seed);
+    }
+    for (uint32_t dist = OTA_PATCH_WINDOW - 1; dist <= OTA_PATCH_WINDOW + 1; dist++) {
+        pk_begin(0, sizeof(lit) + 10, 0);
+        pk_op(0, sizeof(lit));
+        memcpy(&s_pk.b[s_pk.len], lit, sizeof(lit));
+        s_pk.len += sizeof(lit);
+        pk_op(1, 10);
+        pk_varint(dist);
+        pk_end();
+
+        EXPECT(NULL, dist <= OTA_PATCH_WINDOW ? OTA_PATCH_DONE : OTA_PATCH_ERR_RANGE);
+        if (dist <= OTA_PATCH_WINDOW) {
+            CHECK(memcmp(&s_sink.out[sizeof(lit)], &lit[sizeof(lit) - dist], 10) == 0);
+        }
+    }
+}
+
+static void test_malformed(void)
+{
+    /* header */
+    pk_begin(0, 1, 0);
+    s_pk.b[0] = 'X';
+    pk_op(0, 1);
+    pk_byte(0xE9);
+    pk_end();
+    EXPECT(NULL, OTA_PATCH_ERR_FORMAT);
+    s_pk.b[0] = 'A';
+    s_pk.b[4] = OTA_PATCH_VERSION + 1;
+    EXPECT(NULL, OTA_PATCH_ERR_FORMAT);
+    s_pk.b[4] = OTA_PATCH_VERSION;
+    EXPECT(NULL, OTA_PATCH_DONE);
+
+    /* END: low bits set, too early, data behind it */
+    s_pk.b[s_pk.len - 1] = 0xC1;
+    EXPECT(NULL, OTA_PATCH_ERR_FORMAT);
+    pk_begin(0, 5, 0);
+    pk_op(0, 3);
+    s_pk.len += 3;
+    pk_end();
+    EXPECT(NULL, OTA_PATCH_ERR_RANGE);
+    pk_begin(0, 3, 0);
+    pk_op(0, 3);
+    s_pk.len += 3;
+    pk_end();
+    pk_byte(0);
+    EXPECT(NULL, OTA_PATCH_ERR_FORMAT);
+    CHECK_EQ(decode(NULL, s_pk.b, s_pk.len, s_pk.len - 1), OTA_PATCH_ERR_FORMAT);
+    CHECK_EQ(decode(NULL, s_pk.b, s_pk.len - 1, s_pk.len), OTA_PATCH_DONE);
+    CHECK_EQ(ota_patch_feed(&s_p, NULL, 0), OTA_PATCH_DONE);
+    CHECK_EQ(ota_patch_feed(&s_p, s_pk.b, 1), OTA_PATCH_ERR_FORMAT);
+
+    /* lengths past new_size, short and extended */
+    pk_begin(0, 3, 0);
+    pk_op(0, 4);
+    s_pk.len += 4;
+    pk_end();
+    EXPECT(NULL, OTA_PATCH_ERR_RANGE);
+    pk_begin(0, 100, 0);
+    pk_op(0, 200);
+    EXPECT(NULL, OTA_PATCH_ERR_RANGE);
+    pk_begin(0, 100, 0);
+    pk_byte(0x3F);
+    pk_varint(UINT32_MAX);                      /* 64 + that overflows */
+    EXPECT(NULL, OTA_PATCH_ERR_RANGE);
+
+    /* varints longer than 32 bits */
+    pk_begin(0, 100, 0);
+    pk_byte(0x3F);
+    for (int i = 0; i < 5; i++) {
+        pk_byte(0x80);
+    }
+    pk_byte(0x01);
+    EXPECT(NULL, OTA_PATCH_ERR_FORMAT);
+    pk_begin(0, 100, 0);
+    pk_op(0, 1);
+    s_pk.len++;
+    pk_op(1, 1);
+    for (int i = 0; i < 4; i++) {
+        pk_byte(0xFF);
+    }
+    pk_byte(0x1F);
+    EXPECT(NULL, OTA_PATCH_ERR_FORMAT);
+
+    /* NEW before the start of the output, distance 0 */
+    pk_begin(0, 10, 0);
+    pk_op(0, 3);
+    s_pk.len += 3;
+    pk_op(1, 4);
+    pk_varint(4);
+    EXPECT(NULL, OTA_PATCH_ERR_RANGE);
+    s_pk.b[s_pk.len - 1] = 0;
+    EXPECT(NULL, OTA_PATCH_ERR_RANGE);
+
+    /* OLD without a base, before it, behind old_size */
+    pk_begin(0, 10, 0);
+    pk_old(4, 0);
+    EXPECT(&s_base_blob, OTA_PATCH_ERR_RANGE);
+    pk_begin(OTA_PATCH_FLAG_DELTA, 10, 4096);
+    pk_old(4, -1);
+    EXPECT(&s_base_blob, OTA_PATCH_ERR_RANGE);
+    pk_begin(OTA_PATCH_FLAG_DELTA, 10, 4000);
+    pk_old(10, 3991);
+    EXPECT(&s_base_blob, OTA_PATCH_ERR_RANGE);
+    CHECK_EQ(s_sink.bad_reads, 0);
+
+    /* an error sticks */
+    CHECK_EQ(ota_patch_feed(&s_p, s_delta.data, s_delta.len), OTA_PATCH_ERR_RANGE);
+}
+
+/* every cut of a real patch: the decoder waits for more, never finishes early */
+static void test_every_truncation(void)
+{
+    const blob_t *patches[] = { &s_small_comp, &s_small_delta };
+    int early = 0, header = 0;
+
+    for (size_t k = 0; k < 2; k++) {
+        const blob_t *p = patches[k];
+        for (size_t len = 0; len < p->len; len++) {
+            early += decode(&s_small_old, p->data, len, len ? len : 1) != OTA_PATCH_MORE;
+            header += (ota_patch_header(&s_p) != NULL) != (len >= OTA_PATCH_HDR_SIZE);
+        }
+    }
+    CHECK_EQ(early, 0);
+    CHECK_EQ(header, 0);
+}
+
+static void test_base_and_io_errors(void)
+{
+    /* another base image: refused before anything is written */
+    s_old.data[1000] ^= 1;
+    CHECK_EQ(decode(&s_old, s_delta.data, s_delta.len, 512), OTA_PATCH_ERR_BASE);
+    CHECK_EQ(s_sink.writes, 0);
+    s_old.data[1000] ^= 1;
+    blob_t shorter = { s_old.data, s_old.len - 1 };
+    CHECK_EQ(decode(&shorter, s_delta.data, s_delta.len, 512), OTA_PATCH_ERR_BASE);
+
+    /* a patch whose old_sha256 was damaged on the way */
+    pk_begin(OTA_PATCH_FLAG_DELTA, 4, 4096);
+    s_pk.b[20] ^= 1;
+    pk_old(4, 0);
+    pk_end();
+    EXPECT(&s_base_blob, OTA_PATCH_ERR_BASE);
+
+    s_sink.fail_write = 1;
+    CHECK_EQ(decode(NULL, s_comp.data, s_comp.len, 4096), OTA_PATCH_ERR_IO);
+    s_sink.fail_write = 17;
+    CHECK_EQ(decode(&s_old, s_delta.data, s_delta.len, 333), OTA_PATCH_ERR_IO);
+    CHECK_EQ(s_sink.writes, 17);
+    CHECK_EQ(ota_patch_feed(&s_p, s_delta.data, 1), OTA_PATCH_ERR_IO);
+    s_sink.fail_write = 0;
+
+    s_sink.fail_read = true;
+    CHECK_EQ(decode(&s_old, s_delta.data, s_delta.len, 1), OTA_PATCH_ERR_IO);
+    s_sink.fail_read = false;
+}
+
+/* ---- mutations, cross-checked with ota_pack.decode() ---- */
+
+static void mutate(blob_t *m, const blob_t *src, uint32_t *seed)
+{
+    size_t len = src->len;
+    memcpy(m->data, src->data, len);
+
+    int edits = 1 + (int)(check_rand(seed) % 3);
+    for (int e = 0; e < edits && len > 1; e++) {
+        size_t at = check_rand(seed) % len;
+        switch (check_rand(seed) % 7) {
+            case 0: m->data[at] ^= (uint8_t)(1u << (check_rand(seed) % 8)); break;
+            case 1: m->data[at] = (uint8_t)check_rand(seed); break;
+            case 2: len = at; break;
+            case 3:
+                memmove(&m->data[at + 1], &m->data[at], len - at);
+                m->data[at] = (uint8_t)check_rand(seed);
+                len++;
+                break;
+            case 4:
+                memmove(&m->data[at], &m->data[at + 1], len - at - 1);
+                len--;
+                break;
+            case 5: {
+                size_t from = check_rand(seed) % len;
+                size_t n = 1 + check_rand(seed) % 16;
+                n = n < len - at ? n : len - at;
+                n = n < len - from ? n : len - from;
+                memmove(&m->data[at], &m->data[from], n);
+                break;
+            }
+            default:
+                m->data[len++] = (uint8_t)check_rand(seed);
+                break;
+        }
+    }
+    m->len = len;
+}
+
+static FILE *s_corpus;
+
+static void test_mutations(void)
+{
+    const blob_t *patches[] = { &s_small_comp, &s_small_delta };
+    blob_t m = { malloc(s_small_comp.len + s_small_delta.len + 16), 0 };
+    uint32_t seed = 19;
+    int valid = 0, wrong = 0;
+
+    for (int k = 0; k < 6000; k++) {
+        mutate(&m, patches[k % 2], &seed);
+        /* a huge new_size would let the Python twin expand gigabytes */
+        if (m.len >= 12 && (m.data[10] | m.data[11])) {
+            continue;
+        }
+        s_sink.bad_writes = s_sink.bad_reads = 0;
+        bool ok = accepted(decode(&s_small_old, m.data, m.len, 1 + k % 97));
+        if (ok) {
+            valid++;
+            wrong += s_sink.out_len != s_small_new.len ||
+                     memcmp(s_sink.out, s_small_new.data, s_small_new.len) != 0;
+        }
+        CHECK_EQ(s_sink.bad_reads, 0);
+
+        if (s_corpus) {
+            for (size_t i = 0; i < m.len; i++) {
+                fprintf(s_corpus, "%02x", m.data[i]);
+            }
+            fprintf(s_corpus, "%s %s\n", m.len ? "" : "-", ok ? "ok" : "err");
+        }
+    }
+    CHECK_EQ(wrong, 0);
+    CHECK(valid < 6000 / 10);
+    free(m.data);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: %s <dir from ota_patch_crosscheck.py gen>\n", argv[0]);
+        return 1;
+    }
+    s_old = load(argv[1], "old.bin");
+    s_new = load(argv[1], "new.bin");
+    s_comp = load(argv[1], "comp.aip");
+    s_delta = load(argv[1], "delta.aip");
+    s_small_old = load(argv[1], "small_old.bin");
+    s_small_new = load(argv[1], "small_new.bin");
+    s_small_comp = load(argv[1], "small_comp.aip");
+    s_small_delta = load(argv[1], "small_delta.aip");
+    for (size_t i = 0; i < sizeof(s_base); i++) {
+        s_base[i] = (uint8_t)(i * 7 + (i >> 8));
+    }
+
+    char path[256];
+    snprintf(path, sizeof(path), "%s/mutations.txt", argv[1]);
+    s_corpus = fopen(path, "w");
+    CHECK(s_corpus != NULL);
+
+    RUN(test_detect_and_header);
+    RUN(test_round_trip_compressed);
+    RUN(test_round_trip_delta);
+    RUN(test_hand_built_ops);
+    RUN(test_window_edge);
+    RUN(test_malformed);
+    RUN(test_every_truncation);
+    RUN(test_base_and_io_errors);
+    RUN(test_mutations);
+
+    if (s_corpus) {
+        fclose(s_corpus);
+    }
+    return check_done();
+}
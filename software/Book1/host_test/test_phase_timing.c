@@ -0,0 +1,241 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: boot-to-sleep phase timing (marks, EWMA, report text)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include "check.h"
+#include "phase_timing.h"
+
+static phase_timing_t s_pt;     /* RTC_DATA_ATTR on the target */
+
+static void fresh(void)
+{
+    memset(&s_pt, 0xA5, sizeof(s_pt));      /* power-on: RTC memory is garbage */
+    phase_timing_init(&s_pt);
+}
+
+/* one wake: BOOT after boot_us, ADC adc_us later, SLEEP right after */
+static void wake(uint32_t boot_us, uint32_t adc_us)
+{
+    phase_timing_begin(&s_pt);
+    phase_timing_mark(&s_pt, PHASE_BOOT, boot_us);
+    phase_timing_mark(&s_pt, PHASE_ADC, (int64_t)boot_us + adc_us);
+    phase_timing_end(&s_pt);
+}
+
+static uint32_t ewma(uint32_t avg, uint32_t v)
+{
+    return v >= avg ? avg + ((v - avg) >> 3) : avg - ((avg - v) >> 3);
+}
+
+static void test_init_keeps_valid_rtc_copy(void)
+{
+    fresh();
+    CHECK_EQ(s_pt.cycles, 0);
+    CHECK_EQ(s_pt.stat[PHASE_BOOT].n, 0);
+
+    wake(100000, 5000);
+    phase_timing_init(&s_pt);               /* deep sleep wake: statistics stay */
+    CHECK_EQ(s_pt.cycles, 1);
+    CHECK_EQ(s_pt.stat[PHASE_BOOT].last_us, 100000);
+
+    s_pt.magic ^= 1;                        /* corrupted */
+    phase_timing_init(&s_pt);
+    CHECK_EQ(s_pt.cycles, 0);
+    CHECK_EQ(s_pt.stat[PHASE_BOOT].n, 0);
+}
+
+/* the time since the previous mark goes to the phase, repeated marks add up */
+static void test_marks_book_the_gap(void)
+{
+    fresh();
+    phase_timing_begin(&s_pt);
+    phase_timing_mark(&s_pt, PHASE_BOOT, 120000);
+    phase_timing_mark(&s_pt, PHASE_WIFI_INIT, 150000);
+    phase_timing_mark(&s_pt, PHASE_PUBLISH, 200000);
+    phase_timing_mark(&s_pt, PHASE_PUBLISH, 260000);   /* second batch message */
+    phase_timing_mark(&s_pt, PHASE_SLEEP, 261000);
+    CHECK_EQ(s_pt.seen, (1u << PHASE_BOOT) | (1u << PHASE_WIFI_INIT) |
+                        (1u << PHASE_PUBLISH) | (1u << PHASE_SLEEP));
+    phase_timing_end(&s_pt);
+
+    CHECK_EQ(s_pt.stat[PHASE_BOOT].last_us, 120000);
+    CHECK_EQ(s_pt.stat[PHASE_WIFI_INIT].last_us, 30000);
+    CHECK_EQ(s_pt.stat[PHASE_PUBLISH].last_us, 110000);
+    CHECK_EQ(s_pt.stat[PHASE_SLEEP].last_us, 1000);
+    CHECK_EQ(s_pt.stat[PHASE_PUBLISH].n, 1);
+    CHECK_EQ(s_pt.stat[PHASE_ADC].n, 0);               /* not reached */
+    CHECK_EQ(s_pt.seen, 0);
+    CHECK_EQ(s_pt.cycles, 1);
+    CHECK_EQ(s_pt.since_report, 1);
+}
+
+/* first value as is, then 1/8 steps in both directions */
+static void test_ewma_and_max(void)
+{
+    static const uint32_t boot[] = { 100000, 180000, 90000, 90000, 400000, 7, 100000 };
+    uint32_t avg = 0, max = 0;
+
+    fresh();
+    for (size_t i = 0; i < sizeof(boot) / sizeof(boot[0]); i++) {
+        wake(boot[i], 5000);
+        avg = i ? ewma(avg, boot[i]) : boot[i];
+        max = boot[i] > max ? boot[i] : max;
+        CHECK_EQ(s_pt.stat[PHASE_BOOT].avg_us, avg);
+        CHECK_EQ(s_pt.stat[PHASE_BOOT].max_us, max);
+        CHECK_EQ(s_pt.stat[PHASE_BOOT].last_us, boot[i]);
+    }
+    CHECK_EQ(s_pt.stat[PHASE_BOOT].avg_us, 121334);     /* by hand: 100000, 110000, 107500, ... */
+
+    /* constant input: converges to within the 1/8 rounding step */
+    for (int i = 0; i < 200; i++) {
+        wake(50000, 5000);
+    }
+    CHECK(s_pt.stat[PHASE_BOOT].avg_us >= 50000);
+    CHECK(s_pt.stat[PHASE_BOOT].avg_us <= 50000 + 7);
+    CHECK_EQ(s_pt.stat[PHASE_ADC].avg_us, 5000);
+}
+
+/* a wake without radio keeps the radio phases as they were */
+static void test_phases_not_reached_keep_stats(void)
+{
+    fresh();
+    phase_timing_begin(&s_pt);
+    phase_timing_mark(&s_pt, PHASE_BOOT, 100000);
+    phase_timing_mark(&s_pt, PHASE_WIFI_WAIT, 900000);
+    phase_timing_end(&s_pt);
+
+    for (int i = 0; i < 5; i++) {
+        wake(100000, 5000);
+    }
+    CHECK_EQ(s_pt.stat[PHASE_WIFI_WAIT].n, 1);
+    CHECK_EQ(s_pt.stat[PHASE_WIFI_WAIT].last_us, 800000);
+    CHECK_EQ(s_pt.stat[PHASE_WIFI_WAIT].avg_us, 800000);
+    CHECK_EQ(s_pt.stat[PHASE_BOOT].n, 6);
+    CHECK_EQ(s_pt.stat[PHASE_ADC].n, 5);
+}
+
+/* > 71 minutes saturates, going back books nothing, unknown ids are ignored */
+static void test_odd_clocks(void)
+{
+    fresh();
+    phase_timing_begin(&s_pt);
+    phase_timing_mark(&s_pt, PHASE_WIFI_WAIT, 5000000000LL);
+    CHECK_EQ(s_pt.cur_us[PHASE_WIFI_WAIT], UINT32_MAX);
+    phase_timing_mark(&s_pt, PHASE_WIFI_WAIT, 6000000000LL);
+    CHECK_EQ(s_pt.cur_us[PHASE_WIFI_WAIT], UINT32_MAX);
+
+    phase_timing_mark(&s_pt, PHASE_MQTT_WAIT, 1000);        /* clock went back */
+    CHECK_EQ(s_pt.cur_us[PHASE_MQTT_WAIT], 0);
+    CHECK(s_pt.seen & (1u << PHASE_MQTT_WAIT));
+    phase_timing_mark(&s_pt, PHASE_PUBLISH, 3000);          /* counts from there */
+    CHECK_EQ(s_pt.cur_us[PHASE_PUBLISH], 2000);
+
+    uint32_t seen = s_pt.seen;
+    phase_timing_mark(&s_pt, PHASE_COUNT, 9000);
+    phase_timing_mark(&s_pt, (phase_id_t)-1, 9000);
+    CHECK_EQ(s_pt.seen, seen);
+    CHECK_EQ(s_pt.t_mark_us, 3000);
+
+    phase_timing_end(&s_pt);
+    CHECK_EQ(s_pt.stat[PHASE_WIFI_WAIT].max_us, UINT32_MAX);
+}
+
+static void test_due_and_reported(void)
+{
+    fresh();
+    CHECK(!phase_timing_due(&s_pt, 3));
+    wake(100000, 5000);
+    wake(300000, 5000);
+    CHECK(!phase_timing_due(&s_pt, 3));
+    CHECK(!phase_timing_due(&s_pt, 0));     /* 0 = never */
+    wake(100000, 5000);
+    CHECK(phase_timing_due(&s_pt, 3));
+    CHECK(phase_timing_due(&s_pt, 1));
+
+    uint32_t avg = s_pt.stat[PHASE_BOOT].avg_us;
+    phase_timing_reported(&s_pt);
+    CHECK(!phase_timing_due(&s_pt, 1));
+    CHECK_EQ(s_pt.since_report, 0);
+    CHECK_EQ(s_pt.stat[PHASE_BOOT].max_us, 0);
+    CHECK_EQ(s_pt.stat[PHASE_BOOT].avg_us, avg);            /* the average goes on */
+    CHECK_EQ(s_pt.cycles, 3);
+
+    wake(150000, 5000);
+    CHECK_EQ(s_pt.stat[PHASE_BOOT].max_us, 150000);         /* max of the new interval */
+}
+
+static void test_format(void)
+{
+    char buf[128];
+
+    fresh();
+    CHECK_EQ(phase_timing_format(&s_pt, buf, sizeof(buf)), strlen("ph_n=0;"));
+    CHECK_STR(buf, "ph_n=0;");
+
+    wake(123456, 5049);
+    wake(123456, 5049);
+    size_t len = phase_timing_format(&s_pt, buf, sizeof(buf));
+    CHECK_STR(buf, "ph_n=2;t_boot=123.4/123.4;t_adc=5.0/5.0;");
+    CHECK_EQ(len, strlen(buf));
+
+    CHECK_STR(phase_timing_name(PHASE_WIFI_WAIT), "wifi_wait");
+    CHECK_STR(phase_timing_name(PHASE_SLEEP), "sleep");
+    CHECK_STR(phase_timing_name(PHASE_COUNT), "?");
+}
+
+/* all or nothing: every buffer too short gives 0 and "", never an overrun */
+static void test_format_every_buffer_size(void)
+{
+    char full[256], buf[256];
+
+    fresh();
+    for (int i = 0; i < 3; i++) {
+        phase_timing_begin(&s_pt);
+        for (int p = 0; p < PHASE_COUNT; p++) {
+            phase_timing_mark(&s_pt, (phase_id_t)p, (p + 1) * 987654LL);
+        }
+        phase_timing_end(&s_pt);
+    }
+    size_t n = phase_timing_format(&s_pt, full, sizeof(full));
+    CHECK(n > 100);
+    CHECK(strstr(full, "t_wifi_wait=") != NULL);
+
+    CHECK_EQ(phase_timing_format(&s_pt, NULL, 0), 0);
+    for (size_t len = 1; len <= n + 1; len++) {
+        memset(buf, 'X', sizeof(buf));
+        size_t got = phase_timing_format(&s_pt, buf, len);
+        CHECK_EQ(buf[len], 'X');
+        if (len <= n) {
+            CHECK_EQ(got, 0);
+            CHECK_EQ(buf[0], '\0');
+        } else {
+            CHECK_EQ(got, n);
+            CHECK_STR(buf, full);
+        }
+    }
+}
+
+int main(void)
+{
+    RUN(test_init_keeps_valid_rtc_copy);
+    RUN(test_marks_book_the_gap);
+    RUN(test_ewma_and_max);
+    RUN(test_phases_not_reached_keep_stats);
+    RUN(test_odd_clocks);
+    RUN(test_due_and_reported);
+    RUN(test_format);
+    RUN(test_format_every_buffer_size);
+    return check_done();
+}
@@ -0,0 +1,180 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: PM lock residency and average current per window
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include "check.h"
+#include "pm_duty.h"
+
+#define MS  1000LL                  /* us */
+
+static const pm_duty_board_t s_board = { .held_ua = 100000, .awake_ua = 10000, .light_ua = 100 };
+
+/*
+ * 10 s window: held 1 s (two nested holds), light sleep 7 s, awake the rest.
+ * avg = (1 s x 100 mA + 2 s x 10 mA + 7 s x 0.1 mA) / 10 s = 12070 uA
+ */
+static void test_window_split(void)
+{
+    pm_duty_t d;
+    pm_duty_report_t r;
+
+    pm_duty_start(&d, 5000 * MS, 123 * MS);
+    pm_duty_hold(&d, 5100 * MS);
+    pm_duty_hold(&d, 5200 * MS);
+    pm_duty_release(&d, 5300 * MS);     /* inner: still held */
+    CHECK_EQ(d.held_us, 0);
+    pm_duty_release(&d, 5600 * MS);
+    CHECK_EQ(d.held_us, 500 * MS);
+    pm_duty_hold(&d, 8000 * MS);
+    pm_duty_release(&d, 8500 * MS);
+    pm_duty_release(&d, 9000 * MS);     /* without a hold: ignored */
+    CHECK_EQ(d.holders, 0);
+
+    pm_duty_report(&d, &s_board, 15000 * MS, 7123 * MS, &r);
+    CHECK_EQ(r.window_ms, 10000);
+    CHECK_EQ(r.held_ms, 1000);
+    CHECK_EQ(r.light_ms, 7000);
+    CHECK_EQ(r.awake_ms, 2000);
+    CHECK_EQ(r.avg_ua, 12070);
+
+    /* the next window starts at the report */
+    CHECK_EQ(d.t_start_us, 15000 * MS);
+    CHECK_EQ(d.light_start_us, 7123 * MS);
+    CHECK_EQ(d.held_us, 0);
+    pm_duty_report(&d, &s_board, 16000 * MS, 7123 * MS, &r);
+    CHECK_EQ(r.window_ms, 1000);
+    CHECK_EQ(r.awake_ms, 1000);
+    CHECK_EQ(r.avg_ua, 10000);
+}
+
+/* a hold across the report counts in both windows, split at the report */
+static void test_open_hold_carries_over(void)
+{
+    pm_duty_t d;
+    pm_duty_report_t r;
+
+    pm_duty_start(&d, 0, 0);
+    pm_duty_hold(&d, 4000 * MS);
+    pm_duty_hold(&d, 4500 * MS);
+    pm_duty_report(&d, &s_board, 5000 * MS, 0, &r);
+    CHECK_EQ(r.held_ms, 1000);
+    CHECK_EQ(d.holders, 2);
+    CHECK_EQ(d.t_hold_us, 5000 * MS);
+
+    pm_duty_release(&d, 5500 * MS);
+    pm_duty_release(&d, 6000 * MS);
+    pm_duty_report(&d, &s_board, 10000 * MS, 0, &r);
+    CHECK_EQ(r.held_ms, 1000);
+    CHECK_EQ(r.awake_ms, 4000);
+}
+
+/* a mixed-up light sleep sum or clock: parts clamped, never negative */
+static void test_clamps(void)
+{
+    pm_duty_t d;
+    pm_duty_report_t r;
+
+    pm_duty_start(&d, 0, 0);
+    pm_duty_hold(&d, 0);
+    pm_duty_release(&d, 3000 * MS);
+    pm_duty_report(&d, &s_board, 4000 * MS, 9000 * MS, &r);    /* light > window */
+    CHECK_EQ(r.light_ms, 4000);
+    CHECK_EQ(r.held_ms, 0);
+    CHECK_EQ(r.awake_ms, 0);
+    CHECK_EQ(r.avg_ua, 100);
+
+    pm_duty_start(&d, 0, 2000 * MS);
+    pm_duty_hold(&d, 0);
+    pm_duty_release(&d, 3000 * MS);
+    pm_duty_report(&d, &s_board, 4000 * MS, 5000 * MS, &r);    /* held + light > window */
+    CHECK_EQ(r.light_ms, 3000);
+    CHECK_EQ(r.held_ms, 1000);
+    CHECK_EQ(r.awake_ms, 0);
+
+    pm_duty_start(&d, 4000 * MS, 5000 * MS);
+    pm_duty_hold(&d, 4000 * MS);
+    pm_duty_release(&d, 3000 * MS);                             /* release before hold */
+    pm_duty_report(&d, &s_board, 3000 * MS, 1000 * MS, &r);    /* time and light back */
+    CHECK_EQ(r.window_ms, 0);
+    CHECK_EQ(r.held_ms, 0);
+    CHECK_EQ(r.light_ms, 0);
+    CHECK_EQ(r.avg_ua, 0);
+}
+
+static void test_cmd_stats(void)
+{
+    pm_duty_t d;
+    pm_duty_report_t r;
+
+    pm_duty_start(&d, 0, 0);
+    pm_duty_cmd(&d, 100);
+    pm_duty_cmd(&d, 300);
+    pm_duty_cmd(&d, 201);
+    pm_duty_report(&d, &s_board, 1000 * MS, 0, &r);
+    CHECK_EQ(r.cmd_n, 3);
+    CHECK_EQ(r.cmd_avg_us, 200);
+    CHECK_EQ(r.cmd_max_us, 300);
+
+    pm_duty_report(&d, &s_board, 2000 * MS, 0, &r);     /* reset with the window */
+    CHECK_EQ(r.cmd_n, 0);
+    CHECK_EQ(r.cmd_avg_us, 0);
+    CHECK_EQ(r.cmd_max_us, 0);
+
+    d.cmd_n = UINT32_MAX;                               /* saturates, avg stays sane */
+    d.cmd_sum_us = (uint64_t)UINT32_MAX * 50;
+    pm_duty_cmd(&d, 5000);
+    CHECK_EQ(d.cmd_n, UINT32_MAX);
+    CHECK_EQ(d.cmd_max_us, 5000);
+    pm_duty_report(&d, &s_board, 3000 * MS, 0, &r);
+    CHECK_EQ(r.cmd_avg_us, 50);
+}
+
+static void test_format(void)
+{
+    pm_duty_report_t r = {
+        .window_ms = 60000, .held_ms = 1234, .awake_ms = 8766, .light_ms = 50000,
+        .avg_ua = 7012, .cmd_n = 4, .cmd_avg_us = 850, .cmd_max_us = 2100,
+    };
+    char buf[128];
+
+    size_t n = pm_duty_format(&r, buf, sizeof(buf));
+    CHECK_STR(buf, "win_ms=60000;held_pct=2;light_pct=83;avg_ua=7012;cmd_n=4;cmd_avg_us=850;cmd_max_us=2100");
+    CHECK_EQ(n, strlen(buf));
+
+    pm_duty_report_t empty = { 0 };
+    char small[96];
+    pm_duty_format(&empty, small, sizeof(small));
+    CHECK_STR(small, "win_ms=0;held_pct=0;light_pct=0;avg_ua=0;cmd_n=0;cmd_avg_us=0;cmd_max_us=0");
+
+    CHECK_EQ(pm_duty_format(&r, NULL, 0), 0);
+    for (size_t len = 1; len <= n + 1; len++) {
+        char out[128];
+        memset(out, 'X', sizeof(out));
+        size_t got = pm_duty_format(&r, out, len);
+        CHECK_EQ(out[len], 'X');
+        CHECK_EQ(got, len > n ? n : 0);
+        CHECK_STR(out, len > n ? buf : "");
+    }
+}
+
+int main(void)
+{
+    RUN(test_window_split);
+    RUN(test_open_hold_carries_over);
+    RUN(test_clamps);
+    RUN(test_cmd_stats);
+    RUN(test_format);
+    return check_done();
+}
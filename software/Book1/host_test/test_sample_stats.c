@@ -0,0 +1,282 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: event ring, sample statistics and the DRDY sampler
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#include "check.h"
+#include "drdy_sampler.h"
+#include "event_ring.h"
+#include "sample_stats.h"
+#include "mock/fake_gpio.h"
+#include "freertos/task.h"
+
+/* ---- event ring ---- */
+
+static sample_event_t ev_n(unsigned n)
+{
+    return (sample_event_t){ .timestamp_us = n, .source = (uint8_t)n, .level = 1 };
+}
+
+static void test_ring_empty_full(void)
+{
+    static event_ring_t r;
+    sample_event_t ev;
+
+    event_ring_init(&r);
+    CHECK(!event_ring_pop(&r, &ev));
+
+    for (unsigned i = 0; i < EVENT_RING_SIZE; i++) {
+        ev = ev_n(i);
+        CHECK(event_ring_push(&r, &ev));
+    }
+    ev = ev_n(999);
+    CHECK(!event_ring_push(&r, &ev));           /* full: dropped, nothing overwritten */
+
+    CHECK(event_ring_pop(&r, &ev));
+    CHECK_EQ(ev.timestamp_us, 0);
+    ev = ev_n(EVENT_RING_SIZE);
+    CHECK(event_ring_push(&r, &ev));            /* one slot free again */
+    CHECK(!event_ring_push(&r, &ev));
+
+    for (unsigned i = 1; i <= EVENT_RING_SIZE; i++) {
+        CHECK(event_ring_pop(&r, &ev));
+        CHECK_EQ(ev.timestamp_us, i);
+    }
+    CHECK(!event_ring_pop(&r, &ev));
+}
+
+/* head and tail are free-running: the unsigned wrap must not matter */
+static void test_ring_counter_wrap(void)
+{
+    static event_ring_t r;
+    sample_event_t ev;
+    unsigned start = UINT_MAX - 5;
+
+    atomic_init(&r.head, start);
+    atomic_init(&r.tail, start);
+    CHECK(!event_ring_pop(&r, &ev));
+
+    for (unsigned i = 0; i < EVENT_RING_SIZE; i++) {
+        ev = ev_n(i);
+        CHECK(event_ring_push(&r, &ev));
+    }
+    CHECK(!event_ring_push(&r, &ev));
+    CHECK(atomic_load(&r.head) < start);        /* wrapped */
+
+    int bad = 0;
+    for (unsigned i = 0; i < 1000; i++) {
+        CHECK(event_ring_pop(&r, &ev));
+        bad += ev.timestamp_us != i;
+        ev = ev_n(i + EVENT_RING_SIZE);
+        CHECK(event_ring_push(&r, &ev));
+    }
+    CHECK_EQ(bad, 0);
+}
+
+/* one producer thread, one consumer: order kept, nothing lost or doubled */
+#define SPSC_EVENTS     200000
+
+static event_ring_t s_spsc;
+
+static void *spsc_producer(void *arg)
+{
+    (void)arg;
+    for (unsigned i = 0; i < SPSC_EVENTS; i++) {
+        sample_event_t ev = ev_n(i);
+        while (!event_ring_push(&s_spsc, &ev)) {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+static void test_ring_spsc_threads(void)
+{
+    pthread_t prod;
+    sample_event_t ev;
+    unsigned next = 0;
+    int bad = 0;
+
+    event_ring_init(&s_spsc);
+    CHECK_EQ(pthread_create(&prod, NULL, spsc_producer, NULL), 0);
+    while (next < SPSC_EVENTS) {
+        if (!event_ring_pop(&s_spsc, &ev)) {
+            sched_yield();
+            continue;
+        }
+        bad += ev.timestamp_us != next || ev.source != (uint8_t)next;
+        next++;
+    }
+    pthread_join(prod, NULL);
+    CHECK_EQ(bad, 0);
+    CHECK(!event_ring_pop(&s_spsc, &ev));
+}
+
+/* ---- statistics ---- */
+
+static void test_stats_aggregates(void)
+{
+    sample_stats_t st;
+
+    sample_stats_reset(&st, 1000);
+    CHECK_EQ(st.count, 0);
+    CHECK_EQ(st.interval_min_us, UINT32_MAX);
+    CHECK_EQ(st.latency_min_us, UINT32_MAX);
+    sample_stats_log("test", "empty", &st);     /* "not enough samples" */
+
+    /* the first sample has a latency but no interval yet */
+    sample_stats_add(&st, 10000, 10050);
+    CHECK_EQ(st.count, 1);
+    CHECK_EQ(st.interval_min_us, UINT32_MAX);
+    CHECK_EQ(st.interval_max_us, 0);
+    CHECK_EQ(st.latency_min_us, 50);
+    CHECK_EQ(st.latency_max_us, 50);
+
+    sample_stats_add(&st, 11000, 11020);        /* 1000: on time */
+    sample_stats_add(&st, 12100, 12400);        /* 1100: +100 */
+    sample_stats_add(&st, 13000, 13030);        /*  900: -100 */
+    sample_stats_add(&st, 14030, 14000);        /* 1030: +30, handled "before" event */
+
+    CHECK_EQ(st.count, 5);
+    CHECK_EQ(st.last_event_us, 14030);
+    CHECK_EQ(st.interval_min_us, 900);
+    CHECK_EQ(st.interval_max_us, 1100);
+    CHECK_EQ(st.jitter_max_us, 100);
+    CHECK_EQ(st.jitter_sum_us, 230);
+    CHECK_EQ(st.latency_min_us, 0);             /* clamped, never negative */
+    CHECK_EQ(st.latency_max_us, 300);
+    CHECK_EQ(st.latency_sum_us, 50 + 20 + 300 + 30 + 0);
+    sample_stats_log("test", "five", &st);
+
+    /* unknown period: intervals yes, jitter no */
+    sample_stats_reset(&st, 0);
+    sample_stats_add(&st, 0, 1);
+    sample_stats_add(&st, 5000, 5001);
+    CHECK_EQ(st.interval_max_us, 5000);
+    CHECK_EQ(st.jitter_max_us, 0);
+    CHECK_EQ(st.jitter_sum_us, 0);
+
+    /* 64 bit sums do not wrap over a long run */
+    sample_stats_reset(&st, 1);
+    for (int i = 0; i < 3; i++) {
+        sample_stats_add(&st, (int64_t)i * 4000000000LL, (int64_t)i * 4000000000LL + 4000000000LL);
+    }
+    CHECK_EQ(st.latency_sum_us, 3ULL * 4000000000ULL);
+    CHECK_EQ(st.jitter_sum_us, 2ULL * (4000000000ULL - 1));
+}
+
+/* ---- DRDY sampler: same latency rule as the poll loop ---- */
+
+#define DRDY_PIN        5
+#define READ_US         2000        /* simulated sensor read */
+
+static volatile int  s_calls;
+static volatile bool s_fail_odd;
+static volatile bool s_block;
+static volatile bool s_in_read;
+
+static bool read_sensor(const sample_event_t *ev, void *ctx)
+{
+    (void)ev; (void)ctx;
+    s_in_read = true;
+    while (s_block) {
+        usleep(100);
+    }
+    usleep(READ_US);
+    int n = s_calls++;
+    return !(s_fail_odd && (n & 1));
+}
+
+static void wait_calls(int n)
+{
+    for (int i = 0; i < 2000 && s_calls < n; i++) {
+        vTaskDelay(1);
+    }
+}
+
+static void edge(void)
+{
+    fake_gpio_set(DRDY_PIN, 1);
+    fake_gpio_set(DRDY_PIN, 0);
+}
+
+static void test_drdy_stats(void)
+{
+    sample_stats_t st;
+    uint32_t dropped = 99;
+    uint8_t id = 0xFF;
+
+    CHECK_EQ(drdy_sampler_get_stats(0, &st, &dropped), ESP_ERR_INVALID_ARG);
+    CHECK_EQ(drdy_sampler_start(5), ESP_OK);
+    drdy_source_config_t src = {
+        .gpio = DRDY_PIN,
+        .edge = GPIO_INTR_POSEDGE,
+        .expected_period_us = 5000,
+        .handler = read_sensor,
+    };
+    CHECK_EQ(drdy_sampler_add_source(&src, &id), ESP_OK);
+    CHECK_EQ(id, 0);
+
+    /* every second read fails: those are not samples */
+    s_calls = 0;
+    s_fail_odd = true;
+    for (int i = 0; i < 10; i++) {
+        edge();
+        usleep(5000);
+    }
+    wait_calls(10);
+    vTaskDelay(5);
+    CHECK_EQ(s_calls, 10);
+    CHECK_EQ(drdy_sampler_get_stats(id, &st, &dropped), ESP_OK);
+    CHECK_EQ(st.count, 5);
+    CHECK_EQ(dropped, 0);
+    CHECK(st.latency_min_us >= READ_US);        /* stamped after the read */
+    CHECK(st.interval_min_us >= 2 * 5000);      /* failed ones left gaps */
+
+    /* worker stuck in a read: the ring takes EVENT_RING_SIZE more, the rest drops */
+    s_fail_odd = false;
+    s_block = true;
+    s_calls = 0;
+    s_in_read = false;
+    edge();
+    for (int i = 0; i < 2000 && !s_in_read; i++) {
+        vTaskDelay(1);
+    }
+    CHECK(s_in_read);                           /* first event popped, worker waits */
+    for (int i = 0; i < EVENT_RING_SIZE + 10; i++) {
+        edge();
+    }
+    s_block = false;
+    wait_calls(1 + EVENT_RING_SIZE);
+    vTaskDelay(5);
+    CHECK_EQ(s_calls, 1 + EVENT_RING_SIZE);
+    CHECK_EQ(drdy_sampler_get_stats(id, &st, &dropped), ESP_OK);
+    CHECK_EQ(dropped, 10);
+    CHECK_EQ(st.count, 5 + 1 + EVENT_RING_SIZE);
+}
+
+int main(void)
+{
+    RUN(test_ring_empty_full);
+    RUN(test_ring_counter_wrap);
+    RUN(test_ring_spsc_threads);
+    RUN(test_stats_aggregates);
+    RUN(test_drdy_stats);
+    return check_done();
+}
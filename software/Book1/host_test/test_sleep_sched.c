@@ -0,0 +1,361 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: adaptive deep sleep interval, against its Python twin
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include "check.h"
+#include "sleep_sched.h"
+
+static FILE *s_corpus;
+static int   s_corpus_lines;
+
+static sleep_sched_t s_s;           /* RTC_DATA_ATTR on the target */
+
+static void fresh(const sleep_sched_config_t *cfg)
+{
+    memset(&s_s, 0xA5, sizeof(s_s));
+    sleep_sched_init(&s_s, cfg);
+}
+
+static uint32_t wake(const sleep_sched_config_t *cfg, uint32_t now_s, int32_t value,
+                     uint32_t awake_ms, uint32_t batt_mv)
+{
+    sleep_sched_input_t in = {
+        .now_s = now_s, .has_value = true, .value = value,
+        .awake_ms = awake_ms, .batt_mv = batt_mv,
+    };
+    return sleep_sched_update(&s_s, cfg, &in);
+}
+
+static void test_init_and_defaults(void)
+{
+    sleep_sched_config_t cfg = { .start_s = 5 };
+
+    fresh(&cfg);
+    CHECK_EQ(s_s.interval_s, SLEEP_SCHED_MIN_DEFAULT_S);    /* start below min */
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_START);
+    CHECK_EQ(s_s.readings, 0);
+
+    /* no rule on: start_s every time */
+    CHECK_EQ(wake(&cfg, 0, 100, 250, 3700), SLEEP_SCHED_MIN_DEFAULT_S);
+    CHECK_EQ(wake(&cfg, 10, 900, 250, 3700), SLEEP_SCHED_MIN_DEFAULT_S);
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_START);
+
+    /* a valid RTC copy survives init */
+    sleep_sched_init(&s_s, &cfg);
+    CHECK_EQ(s_s.wakes, 2);
+    CHECK_EQ(s_s.last_value, 900);
+
+    cfg = (sleep_sched_config_t){ .start_s = 5000 };
+    fresh(&cfg);
+    CHECK_EQ(s_s.interval_s, SLEEP_SCHED_MAX_DEFAULT_S);
+
+    cfg = (sleep_sched_config_t){ .min_s = 60, .max_s = 30 };  /* max < min */
+    fresh(&cfg);
+    CHECK_EQ(wake(&cfg, 0, 0, 0, 0), 60);
+}
+
+/*
+ * change 20 per wake. A jump of 60 in 30 s -> 2000 per 1000 s -> 10 s. Calm
+ * readings decay the rate by 1/4 per wake, so the interval grows by 4/3
+ * until the signal wants more than max_s.
+ */
+static void test_signal(void)
+{
+    sleep_sched_config_t cfg = { .min_s = 10, .max_s = 900, .start_s = 30, .change = 20 };
+    uint32_t now = 0;
+
+    fresh(&cfg);
+    CHECK_EQ(wake(&cfg, now, 100, 0, 0), 30);               /* one reading: no rate */
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_START);
+    now += 30;
+    CHECK_EQ(wake(&cfg, now, 160, 0, 0), 10);
+    CHECK_EQ(s_s.rate_k, 2000);
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_SIGNAL);
+
+    static const uint32_t want[] = { 13, 17, 23, 31, 42, 56 };   /* 20000 / rate */
+    for (size_t i = 0; i < sizeof(want) / sizeof(want[0]); i++) {
+        now += s_s.interval_s;
+        CHECK_EQ(wake(&cfg, now, 160, 0, 0), want[i]);
+        CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_SIGNAL);
+    }
+    for (int i = 0; i < 30; i++) {
+        now += s_s.interval_s;
+        wake(&cfg, now, 160, 0, 0);
+    }
+    CHECK_EQ(s_s.interval_s, 900);
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_MAX);
+    CHECK_EQ(s_s.signal_s, 900);
+
+    /* a move shortens at once: 200 in 900 s -> 222 per 1000 s -> 90 s */
+    now += 900;
+    CHECK_EQ(wake(&cfg, now, 360, 0, 0), 90);
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_SIGNAL);
+
+    /* faster than min_s allows */
+    now += 90;
+    CHECK_EQ(wake(&cfg, now, -30000, 0, 0), 10);
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_MIN);
+
+    /* the clock did not move: one interval assumed, no division by zero */
+    CHECK_EQ(s_s.rate_k, 337333);
+    CHECK_EQ(wake(&cfg, now, -29900, 0, 0), 10);
+    CHECK_EQ(s_s.rate_k, 337333 - (337333 - 10000) / 4);
+
+    /* extreme readings do not overflow the difference */
+    now += 1;
+    wake(&cfg, now, INT32_MIN, 0, 0);
+    now += 1;
+    wake(&cfg, now, INT32_MAX, 0, 0);
+    CHECK_EQ(s_s.rate_k, UINT32_MAX);
+    CHECK_EQ(s_s.interval_s, 10);
+}
+
+/* the signal wants 606 s at once, the ramp allows grow_pct per wake */
+static void test_ramp(void)
+{
+    sleep_sched_config_t cfg = { .start_s = 30, .change = 20, .grow_pct = 120 };
+
+    fresh(&cfg);
+    wake(&cfg, 0, 100, 0, 0);
+    CHECK_EQ(wake(&cfg, 30, 101, 0, 0), 36);
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_RAMP);
+    CHECK_EQ(wake(&cfg, 66, 101, 0, 0), 43);
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_RAMP);
+
+    /* grow_pct <= 100 still creeps up by a second */
+    cfg.grow_pct = 50;
+    fresh(&cfg);
+    wake(&cfg, 0, 100, 0, 0);
+    CHECK_EQ(wake(&cfg, 30, 101, 0, 0), 31);
+    CHECK_EQ(wake(&cfg, 61, 101, 0, 0), 32);
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_RAMP);
+}
+
+/* 200 ms x 100 mA per wake in a 40 uA budget above the floor: 500 s */
+static void test_cost(void)
+{
+    sleep_sched_config_t cfg = { .start_s = 30, .awake_ma = 100, .sleep_ua = 10, .budget_ua = 50 };
+
+    fresh(&cfg);
+    CHECK_EQ(wake(&cfg, 0, 0, 0, 0), 30);                   /* awake time unknown */
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_START);
+    CHECK_EQ(wake(&cfg, 30, 0, 200, 0), 500);
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_COST);
+    CHECK_EQ(wake(&cfg, 530, 0, 600, 0), 750);              /* EWMA 200 -> 300 ms */
+    CHECK_EQ(s_s.awake_ms, 300);
+    CHECK_EQ(wake(&cfg, 1280, 0, 0, 0), 750);               /* 0 = unknown, kept */
+
+    /* budget at or below the floor: sleep as long as allowed */
+    cfg.budget_ua = 10;
+    CHECK_EQ(wake(&cfg, 2030, 0, 300, 0), 900);
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_COST);
+
+    /* the signal wants longer than the cost: signal wins */
+    cfg = (sleep_sched_config_t){ .start_s = 30, .grow_pct = 1000, .change = 20,
+                                  .awake_ma = 100, .sleep_ua = 10, .budget_ua = 50 };
+    fresh(&cfg);
+    wake(&cfg, 0, 100, 20, 0);
+    CHECK_EQ(wake(&cfg, 30, 101, 20, 0), 300);              /* cost 50 s, ramp 300 */
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_RAMP);
+}
+
+/* stretched linearly below ok: 4x at low, max_s at or below */
+static void test_battery(void)
+{
+    sleep_sched_config_t cfg = { .start_s = 100, .batt_ok_mv = 3600, .batt_low_mv = 3200 };
+
+    fresh(&cfg);
+    CHECK_EQ(wake(&cfg, 0, 0, 0, 3700), 100);
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_START);
+    CHECK_EQ(wake(&cfg, 100, 0, 0, 0), 100);                /* unknown */
+    CHECK_EQ(wake(&cfg, 200, 0, 0, 3400), 250);             /* half way: 2.5x */
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_BATTERY);
+    CHECK_EQ(wake(&cfg, 450, 0, 0, 3201), 399);
+    CHECK_EQ(wake(&cfg, 850, 0, 0, 3200), 900);
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_BATTERY);
+
+    cfg.start_s = 400;                                      /* 1000 s -> clamped */
+    CHECK_EQ(wake(&cfg, 1750, 0, 0, 3400), 900);
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_MAX);
+
+    cfg.batt_low_mv = 3600;                                 /* misconfigured */
+    CHECK_EQ(wake(&cfg, 2650, 0, 0, 3599), 900);
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_BATTERY);
+}
+
+/* a pinned interval is taken as it is; the rate keeps being followed */
+static void test_pin(void)
+{
+    sleep_sched_config_t cfg = { .min_s = 10, .start_s = 30, .change = 20, .batt_ok_mv = 3600 };
+
+    fresh(&cfg);
+    wake(&cfg, 0, 100, 0, 0);
+    wake(&cfg, 30, 160, 0, 0);
+    CHECK_EQ(s_s.signal_s, 10);
+
+    sleep_sched_pin(&s_s, 3);
+    CHECK_EQ(s_s.signal_s, 0);
+    CHECK_EQ(wake(&cfg, 40, 160, 0, 3000), 3);              /* below min, low battery */
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_PINNED);
+    CHECK_EQ(s_s.rate_k, 1500);
+    CHECK_EQ(wake(&cfg, 43, 160, 0, 0), 3);
+    CHECK_EQ(s_s.rate_k, 1125);
+
+    /* released: the ramp starts over from start_s, not from the pin */
+    sleep_sched_pin(&s_s, 0);
+    CHECK_EQ(wake(&cfg, 46, 160, 0, 0), 23);                /* rate 844 -> 23 s */
+    CHECK_EQ(sleep_sched_limit(&s_s), SLEEP_SCHED_SIGNAL);
+
+    CHECK_STR(sleep_sched_limit_name(SLEEP_SCHED_PINNED), "pinned");
+    CHECK_STR(sleep_sched_limit_name(SLEEP_SCHED_RAMP), "ramp");
+    CHECK_STR(sleep_sched_limit_name((sleep_sched_limit_t)99), "?");
+}
+
+/* ---- random traces for the Python cross-check ---- */
+
+static uint32_t pick(uint32_t *seed, uint32_t lo, uint32_t hi)
+{
+    return lo + check_rand(seed) % (hi - lo + 1);
+}
+
+static uint32_t maybe(uint32_t *seed, uint32_t pct_zero, uint32_t lo, uint32_t hi)
+{
+    return pick(seed, 1, 100) <= pct_zero ? 0 : pick(seed, lo, hi);
+}
+
+/*
+ * "cfg <10 config values>" starts a node, then one line per wake:
+ *   wake <now_s> <value|-> <awake_ms> <batt_mv> <pin|-> <interval_s> <limit>
+ */
+static void test_random_traces(void)
+{
+    uint32_t seed = 20;
+    long wakes = 0;
+    int limits[SLEEP_SCHED_PINNED + 1] = { 0 };
+
+    for (int trace = 0; trace < 400; trace++) {
+        sleep_sched_config_t cfg = {
+            .min_s = maybe(&seed, 20, 1, 60),
+            .max_s = maybe(&seed, 20, 1, 3600),
+            .start_s = maybe(&seed, 20, 1, 600),
+            .change = maybe(&seed, 20, 1, 500),
+            .grow_pct = maybe(&seed, 30, 1, 400),
+            .awake_ma = maybe(&seed, 40, 1, 200),
+            .sleep_ua = pick(&seed, 0, 60),
+            .budget_ua = maybe(&seed, 20, 1, 500),
+            .batt_ok_mv = maybe(&seed, 50, 3300, 3800),
+            .batt_low_mv = pick(&seed, 2800, 3500),
+        };
+        uint32_t now = pick(&seed, 0, 100000);
+        int32_t value = (int32_t)pick(&seed, 0, 4095);
+        uint32_t step = pick(&seed, 0, 200);
+
+        fresh(&cfg);
+        if (s_corpus) {
+            fprintf(s_corpus, "cfg %lu %lu %lu %lu %lu %lu %lu %lu %lu %lu\n",
+                    (unsigned long)cfg.min_s, (unsigned long)cfg.max_s,
+                    (unsigned long)cfg.start_s, (unsigned long)cfg.change,
+                    (unsigned long)cfg.grow_pct, (unsigned long)cfg.awake_ma,
+                    (unsigned long)cfg.sleep_ua, (unsigned long)cfg.budget_ua,
+                    (unsigned long)cfg.batt_ok_mv, (unsigned long)cfg.batt_low_mv);
+        }
+
+        for (int w = 0; w < 60; w++) {
+            sleep_sched_input_t in = {
+                .has_value = pick(&seed, 1, 10) > 1,
+                .awake_ms = maybe(&seed, 20, 50, 5000),
+                .batt_mv = maybe(&seed, 30, 2800, 4200),
+            };
+            /* calm, drift and jumps; now and then the extremes */
+            uint32_t k = pick(&seed, 1, 100);
+            if (k <= 2) {
+                value = k == 1 ? INT32_MIN : INT32_MAX;
+            } else if (k <= 12) {
+                value = (int32_t)pick(&seed, 0, 4095);
+            } else if (k <= 50) {
+                int64_t v = (int64_t)value + pick(&seed, 0, 2 * step) - step;
+                value = (int32_t)(v < -100000 ? -100000 : (v > 100000 ? 100000 : v));
+            }
+            in.value = value;
+
+            /* the node sleeps as told; sometimes the clock stops or jumps back */
+            k = pick(&seed, 1, 100);
+            if (k <= 5) {
+                now -= now > 500 ? pick(&seed, 1, 500) : 0;
+            } else if (k > 10) {
+                now += s_s.interval_s + pick(&seed, 0, 3);
+            }
+            in.now_s = now;
+
+            long pin = -1;
+            if (pick(&seed, 1, 100) <= 4) {
+                pin = pick(&seed, 1, 100) <= 50 ? 0 : pick(&seed, 1, 7200);
+                sleep_sched_pin(&s_s, (uint32_t)pin);
+            }
+
+            uint32_t t = sleep_sched_update(&s_s, &cfg, &in);
+            CHECK_EQ(t, s_s.interval_s);
+            if (!s_s.pinned_s) {
+                uint32_t lo = cfg.min_s ? cfg.min_s : SLEEP_SCHED_MIN_DEFAULT_S;
+                uint32_t hi = cfg.max_s ? cfg.max_s : SLEEP_SCHED_MAX_DEFAULT_S;
+                CHECK(t >= lo && t <= (hi > lo ? hi : lo));
+            }
+            limits[s_s.limit]++;
+            wakes++;
+
+            if (s_corpus) {
+                char v[16] = "-", p[16] = "-";
+                if (in.has_value) {
+                    snprintf(v, sizeof(v), "%ld", (long)in.value);
+                }
+                if (pin >= 0) {
+                    snprintf(p, sizeof(p), "%ld", pin);
+                }
+                fprintf(s_corpus, "wake %lu %s %lu %lu %s %lu %s\n", (unsigned long)in.now_s,
+                        v, (unsigned long)in.awake_ms, (unsigned long)in.batt_mv, p,
+                        (unsigned long)t, sleep_sched_limit_name(sleep_sched_limit(&s_s)));
+                s_corpus_lines++;
+            }
+        }
+    }
+
+    /* every rule decided somewhere, or the traces test too little */
+    for (int l = SLEEP_SCHED_START; l <= SLEEP_SCHED_PINNED; l++) {
+        CHECK(limits[l] > 0);
+    }
+    CHECK_EQ(wakes, 400 * 60);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !(s_corpus = fopen(argv[1], "w"))) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    RUN(test_init_and_defaults);
+    RUN(test_signal);
+    RUN(test_ramp);
+    RUN(test_cost);
+    RUN(test_battery);
+    RUN(test_pin);
+    RUN(test_random_traces);
+
+    if (s_corpus) {
+        fclose(s_corpus);
+        printf("  %d wakes written to %s\n", s_corpus_lines, argv[1]);
+    }
+    return check_done();
+}
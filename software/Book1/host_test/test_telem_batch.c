@@ -0,0 +1,304 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: telemetry batch ring and its text encoder
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include "check.h"
+#include "telem_batch.h"
+
+static telem_batch_t s_b;      /* RTC_DATA_ATTR on the target */
+
+static telem_sample_t sample(uint32_t k)
+{
+    return (telem_sample_t){
+        .t_s = 1000 + k * 30,
+        .value = (uint16_t)(k * 37 % 3300),
+        .flags = (k % 5 == 0) ? TELEM_SAMPLE_RAW : 0,
+    };
+}
+
+static void fresh(void)
+{
+    memset(&s_b, 0xA5, sizeof(s_b));        /* power-on: RTC memory is garbage */
+    telem_batch_init(&s_b);
+}
+
+/*
+ * Parse "node=<id>;now=<t>;n=<k>;dropped=<d>;s=<v>[r]@<t>,..." back into
+ * samples. Returns the number of samples, -1 if the text is malformed.
+ */
+static int parse(const char *msg, const char *node, uint32_t now, uint32_t dropped,
+                 telem_sample_t *out, int max)
+{
+    char id[32];
+    unsigned long t, d;
+    unsigned n;
+    int pos = 0;
+
+    if (sscanf(msg, "node=%31[^;];now=%lu;n=%u;dropped=%lu;s=%n", id, &t, &n, &d, &pos) != 4 ||
+        pos == 0 || strcmp(id, node) != 0 || t != now || d != dropped) {
+        return -1;
+    }
+
+    const char *p = msg + pos;
+    int k = 0;
+    while (*p && k < max) {
+        unsigned v;
+        unsigned long ts;
+        int used = 0;
+        if (sscanf(p, "%u%n", &v, &used) != 1) {
+            return -1;
+        }
+        p += used;
+        out[k].value = (uint16_t)v;
+        out[k].flags = 0;
+        if (*p == 'r') {
+            out[k].flags = TELEM_SAMPLE_RAW;
+            p++;
+        }
+        if (sscanf(p, "@%lu%n", &ts, &used) != 1) {
+            return -1;
+        }
+        p += used;
+        out[k].t_s = (uint32_t)ts;
+        k++;
+        if (*p == ',') {
+            p++;
+        } else if (*p) {
+            return -1;
+        }
+    }
+    return (*p || k != (int)n) ? -1 : k;
+}
+
+static void check_samples(const telem_sample_t *got, int n, uint32_t k0)
+{
+    for (int i = 0; i < n; i++) {
+        telem_sample_t want = sample(k0 + (uint32_t)i);
+        CHECK_EQ(got[i].t_s, want.t_s);
+        CHECK_EQ(got[i].value, want.value);
+        CHECK_EQ(got[i].flags, want.flags);
+    }
+}
+
+/* ---- ring ---- */
+
+static void test_init_keeps_valid_rtc_copy(void)
+{
+    fresh();
+    CHECK_EQ(s_b.count, 0);
+    CHECK_EQ(s_b.head, 0);
+    CHECK_EQ(s_b.dropped, 0);
+
+    telem_sample_t s = sample(1);
+    telem_batch_push(&s_b, &s);
+    telem_batch_init(&s_b);                 /* deep sleep wake: content stays */
+    CHECK_EQ(s_b.count, 1);
+
+    s_b.count = TELEM_BATCH_CAPACITY + 1;   /* corrupted */
+    telem_batch_init(&s_b);
+    CHECK_EQ(s_b.count, 0);
+
+    telem_batch_push(&s_b, &s);
+    s_b.head = TELEM_BATCH_CAPACITY;
+    telem_batch_init(&s_b);
+    CHECK_EQ(s_b.count, 0);
+}
+
+static void test_push_wraps_and_counts_dropped(void)
+{
+    fresh();
+    for (uint32_t k = 0; k < TELEM_BATCH_CAPACITY + 10; k++) {
+        telem_sample_t s = sample(k);
+        telem_batch_push(&s_b, &s);
+    }
+    CHECK_EQ(s_b.count, TELEM_BATCH_CAPACITY);
+    CHECK_EQ(s_b.dropped, 10);
+    CHECK_EQ(s_b.wakes, TELEM_BATCH_CAPACITY + 10);
+
+    /* oldest first: samples 10 .. 73 */
+    for (uint16_t i = 0; i < s_b.count; i++) {
+        CHECK_EQ(telem_batch_at(&s_b, i)->t_s, sample(10 + i).t_s);
+    }
+}
+
+static void test_due(void)
+{
+    fresh();
+    CHECK(!telem_batch_due(&s_b, 1, 1));   /* nothing to send */
+
+    for (uint32_t k = 0; k < 4; k++) {
+        telem_sample_t s = sample(k);
+        telem_batch_push(&s_b, &s);
+        CHECK_EQ(telem_batch_due(&s_b, 5, 10), false);
+    }
+    telem_sample_t s = sample(4);
+    telem_batch_push(&s_b, &s);
+    CHECK(telem_batch_due(&s_b, 5, 10));   /* every 5th wake */
+
+    telem_batch_postpone(&s_b);             /* no network: wait 5 more wakes */
+    CHECK(!telem_batch_due(&s_b, 5, 10));
+    CHECK_EQ(s_b.count, 5);
+
+    CHECK(telem_batch_due(&s_b, 0, 5));    /* threshold only */
+    CHECK(!telem_batch_due(&s_b, 0, 6));
+}
+
+static void test_consume(void)
+{
+    fresh();
+    for (uint32_t k = 0; k < TELEM_BATCH_CAPACITY + 3; k++) {
+        telem_sample_t s = sample(k);
+        telem_batch_push(&s_b, &s);
+    }
+
+    telem_batch_consume(&s_b, 20);
+    CHECK_EQ(s_b.count, TELEM_BATCH_CAPACITY - 20);
+    CHECK_EQ(telem_batch_at(&s_b, 0)->t_s, sample(23).t_s);
+    CHECK_EQ(s_b.wakes, 0);
+    CHECK_EQ(s_b.dropped, 0);               /* reported with the delivered batch */
+
+    telem_batch_consume(&s_b, 1000);        /* more than there is */
+    CHECK_EQ(s_b.count, 0);
+    CHECK(s_b.head < TELEM_BATCH_CAPACITY);
+}
+
+/* ---- encoder ---- */
+
+static void test_encode_format(void)
+{
+    char buf[256];
+
+    fresh();
+    for (uint32_t k = 0; k < 3; k++) {
+        telem_sample_t s = sample(k);
+        telem_batch_push(&s_b, &s);
+    }
+    CHECK_EQ(telem_batch_encode(&s_b, "node1", 1200, buf, sizeof(buf)), 3);
+    CHECK_STR(buf, "node=node1;now=1200;n=3;dropped=0;s=0r@1000,37@1030,74@1060");
+
+    /* empty batch: header only is no message */
+    fresh();
+    CHECK_EQ(telem_batch_encode(&s_b, "node1", 1200, buf, sizeof(buf)), 0);
+    CHECK_EQ(telem_batch_encode(&s_b, "node1", 1200, buf, 0), 0);
+}
+
+/*
+ * Buffer size (with NUL) for the k oldest samples. The encoder sizes the
+ * header for all samples in the ring (n= has at most that many digits).
+ */
+static size_t need(uint16_t k)
+{
+    size_t len = (size_t)snprintf(NULL, 0, "node=node-17;now=99999;n=%u;dropped=%lu;s=",
+                                  (unsigned)s_b.count, (unsigned long)s_b.dropped);
+    for (uint16_t i = 0; i < k; i++) {
+        const telem_sample_t *smp = telem_batch_at(&s_b, i);
+        len += (size_t)snprintf(NULL, 0, "%s%u%s@%lu", i ? "," : "", (unsigned)smp->value,
+                                (smp->flags & TELEM_SAMPLE_RAW) ? "r" : "",
+                                (unsigned long)smp->t_s);
+    }
+    return len + 1;
+}
+
+/* every buffer size: as many samples as fit, never past the end, always parseable */
+static void test_encode_every_buffer_size(void)
+{
+    static char buf[2048];
+    static telem_sample_t got[TELEM_BATCH_CAPACITY];
+
+    fresh();
+    for (uint32_t k = 0; k < TELEM_BATCH_CAPACITY + 5; k++) {
+        telem_sample_t s = sample(k);
+        telem_batch_push(&s_b, &s);
+    }
+
+    CHECK_EQ(telem_batch_encode(&s_b, "node-17", 99999, buf, sizeof(buf)), TELEM_BATCH_CAPACITY);
+    size_t full = strlen(buf);
+
+    uint16_t prev = 0;
+    for (size_t len = 1; len <= full + 1; len++) {
+        memset(buf, 'X', sizeof(buf));
+        uint16_t n = telem_batch_encode(&s_b, "node-17", 99999, buf, len);
+
+        CHECK(n >= prev);                   /* more room, never fewer samples */
+        prev = n;
+        CHECK_EQ(buf[len], 'X');            /* nothing written past len */
+        if (n == 0) {
+            CHECK(len == 0 || buf[0] == '\0');
+            continue;
+        }
+        CHECK(strlen(buf) < len);
+        CHECK_EQ(parse(buf, "node-17", 99999, 5, got, TELEM_BATCH_CAPACITY), n);
+        check_samples(got, n, 5);
+
+        /* and it is the most that fits: one more sample would not */
+        CHECK(need(n) <= len);
+        if (n < TELEM_BATCH_CAPACITY) {
+            CHECK(need((uint16_t)(n + 1)) > len);
+        }
+    }
+    CHECK_EQ(prev, TELEM_BATCH_CAPACITY);
+}
+
+/*
+ * flush_batch() of AIoT_Final_Node with a small payload buffer: encode,
+ * publish, consume until empty. A failed publish postpones and keeps
+ * everything; the receiver sees every sample exactly once, in order.
+ */
+static void test_flush_in_pieces(void)
+{
+    static char msg[160];
+    static telem_sample_t got[TELEM_BATCH_CAPACITY];
+    uint32_t next = 0;
+    int messages = 0;
+
+    fresh();
+    for (uint32_t k = 0; k < 50; k++) {
+        telem_sample_t s = sample(k);
+        telem_batch_push(&s_b, &s);
+    }
+
+    /* first attempt: publish fails, nothing lost */
+    CHECK(telem_batch_encode(&s_b, "n", 5000, msg, sizeof(msg)) > 0);
+    telem_batch_postpone(&s_b);
+    CHECK_EQ(s_b.count, 50);
+
+    while (s_b.count > 0) {
+        uint16_t n = telem_batch_encode(&s_b, "n", 5000, msg, sizeof(msg));
+        CHECK(n > 0);
+        if (n == 0) {
+            break;
+        }
+        int k = parse(msg, "n", 5000, 0, got, TELEM_BATCH_CAPACITY);
+        CHECK_EQ(k, n);
+        check_samples(got, k, next);
+        next += n;
+        telem_batch_consume(&s_b, n);
+        messages++;
+    }
+    CHECK_EQ(next, 50);
+    CHECK(messages > 1);
+}
+
+int main(void)
+{
+    RUN(test_init_keeps_valid_rtc_copy);
+    RUN(test_push_wraps_and_counts_dropped);
+    RUN(test_due);
+    RUN(test_consume);
+    RUN(test_encode_format);
+    RUN(test_encode_every_buffer_size);
+    RUN(test_flush_in_pieces);
+    return check_done();
+}
@@ -0,0 +1,534 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: binary telemetry encoder and decoder (TLV)
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * Round trips, every buffer size, every truncated prefix and random
+ * mutations of real messages (ASan/UBSan watch the decoder). With a file
+ * name as argument every decoded message is also written there as
+ *
+ *   <hex> <json of the C result | malformed>
+ *
+ * and telem_tlv_crosscheck.py runs tools/telem_decode.py on the same bytes.
+ */
+
+#include "check.h"
+#include "telem_tlv.h"
+
+static FILE *s_corpus;
+static int   s_corpus_lines;
+
+static telem_batch_t  s_b;
+static telem_msg_t    s_m;
+static phase_timing_t s_pt;
+static energy_acct_t  s_ea;
+
+static telem_sample_t sample(uint32_t k)
+{
+    return (telem_sample_t){
+        .t_s = 100000 + k * 60,
+        .value = (uint16_t)(k * 977 % 65536),
+        .flags = (k % 3 == 0) ? TELEM_SAMPLE_RAW : 0,
+    };
+}
+
+static void fill_batch(uint32_t n)
+{
+    memset(&s_b, 0, sizeof(s_b));
+    telem_batch_init(&s_b);
+    for (uint32_t k = 0; k < n; k++) {
+        telem_sample_t s = sample(k);
+        telem_batch_push(&s_b, &s);
+    }
+}
+
+static void fill_stats(void)
+{
+    memset(&s_pt, 0, sizeof(s_pt));
+    s_pt.since_report = 12;
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        if (i == PHASE_NVS) {
+            continue;                       /* never reached: left out */
+        }
+        s_pt.stat[i] = (phase_stat_t){
+            .n = 12, .last_us = 1000u * (i + 1), .avg_us = 900u * (i + 1),
+            .max_us = i == PHASE_WIFI_WAIT ? UINT32_MAX : 3000u * (i + 1),
+        };
+    }
+
+    memset(&s_ea, 0, sizeof(s_ea));
+    s_ea.cycles = 40;
+    s_ea.delivered = 200;
+    s_ea.last_uas = 123456;
+    s_ea.last_ms[ENERGY_CPU] = 80;
+    s_ea.last_ms[ENERGY_RADIO_RX] = 300;
+    s_ea.last_ms[ENERGY_DEEP_SLEEP] = 60000;
+    s_ea.total_nas[ENERGY_CPU] = 3600ull * 1000 * 7;       /* 7 uAh */
+    s_ea.total_nas[ENERGY_RADIO_RX] = 3600ull * 1000 * 950;
+    s_ea.total_nas[ENERGY_DEEP_SLEEP] = 3600ull * 1000 * 25;
+}
+
+/* Everything the Final Node sends, batch last (it takes what room is left) */
+static size_t encode_full(uint8_t *buf, size_t cap, uint16_t *n_batch)
+{
+    telem_tlv_writer_t w;
+    telem_imu_t imu = {
+        .accel_mg = { 0, -1, INT32_MIN },
+        .gyro_mdps = { INT32_MAX, 63, -64 },
+    };
+
+    telem_tlv_begin(&w, buf, cap);
+    telem_tlv_put_str(&w, TELEM_TLV_NODE_ID, "node-17");
+    telem_tlv_put_str(&w, TELEM_TLV_FW_VERSION, "1.4.2");
+    telem_tlv_put_uint(&w, TELEM_TLV_WAKE_REASON, 4);
+    telem_tlv_put_uint(&w, TELEM_TLV_AWAKE_MS, 812);
+    telem_tlv_put_uint(&w, TELEM_TLV_ADC_MV, 1234);
+    telem_tlv_put_uint(&w, TELEM_TLV_ADC_RAW, 4095);
+    telem_tlv_put_imu(&w, &imu);
+    telem_tlv_put_phases(&w, &s_pt);
+    telem_tlv_put_energy(&w, &s_ea);
+    *n_batch = telem_tlv_put_batch(&w, &s_b, 200000);
+    return telem_tlv_end(&w);
+}
+
+/* ---- corpus for the Python cross-check ---- */
+
+static void put_hex(const uint8_t *p, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        fprintf(s_corpus, "%02x", p[i]);
+    }
+}
+
+static void put_str(const char *key, const char *s, bool *first)
+{
+    if (!s[0]) {
+        return;             /* empty and absent look the same in telem_msg_t */
+    }
+    fprintf(s_corpus, "%s\"%s_hex\":\"", *first ? "" : ",", key);
+    put_hex((const uint8_t *)s, strlen(s));
+    fputc('"', s_corpus);
+    *first = false;
+}
+
+static void put_uint(const char *key, bool has, uint32_t v, bool *first)
+{
+    if (has) {
+        fprintf(s_corpus, "%s\"%s\":%lu", *first ? "" : ",", key, (unsigned long)v);
+        *first = false;
+    }
+}
+
+/* Same keys as decode() in tools/telem_decode.py */
+static void corpus_add(const uint8_t *buf, size_t len, bool ok, const telem_msg_t *m)
+{
+    static const char *phase_names[PHASE_COUNT] = {
+        "boot", "adc", "nvs", "wifi_init", "wifi_wait",
+        "mqtt_start", "mqtt_wait", "publish", "sleep",
+    };
+    bool first = true;
+
+    if (!s_corpus) {
+        return;
+    }
+    put_hex(buf, len);
+    if (len == 0) {
+        fputc('-', s_corpus);               /* empty message */
+    }
+    if (!ok) {
+        fprintf(s_corpus, " malformed\n");
+        s_corpus_lines++;
+        return;
+    }
+
+    fprintf(s_corpus, " {");
+    put_str("node_id", m->node_id, &first);
+    put_str("fw_version", m->fw_version, &first);
+    put_uint("wake_reason", m->has_wake_reason, m->wake_reason, &first);
+    put_uint("awake_ms", m->has_awake_ms, m->awake_ms, &first);
+    put_uint("adc_mv", m->has_adc_mv, m->adc_mv, &first);
+    put_uint("adc_raw", m->has_adc_raw, m->adc_raw, &first);
+    if (m->has_imu) {
+        fprintf(s_corpus, "%s\"imu\":{\"accel_mg\":[%ld,%ld,%ld],\"gyro_mdps\":[%ld,%ld,%ld]}",
+                first ? "" : ",",
+                (long)m->imu.accel_mg[0], (long)m->imu.accel_mg[1], (long)m->imu.accel_mg[2],
+                (long)m->imu.gyro_mdps[0], (long)m->imu.gyro_mdps[1], (long)m->imu.gyro_mdps[2]);
+        first = false;
+    }
+    if (m->now_s || m->dropped || m->n_samples) {
+        fprintf(s_corpus, "%s\"now_s\":%lu,\"dropped\":%lu,\"samples\":[", first ? "" : ",",
+                (unsigned long)m->now_s, (unsigned long)m->dropped);
+        for (uint16_t i = 0; i < m->n_samples; i++) {
+            fprintf(s_corpus, "%s{\"t_s\":%lu,\"value\":%u,\"raw\":%s}", i ? "," : "",
+                    (unsigned long)m->samples[i].t_s, (unsigned)m->samples[i].value,
+                    (m->samples[i].flags & TELEM_SAMPLE_RAW) ? "true" : "false");
+        }
+        fputc(']', s_corpus);
+        first = false;
+    }
+    if (m->has_phases) {
+        fprintf(s_corpus, "%s\"phase_wakes\":%lu,\"phases\":{", first ? "" : ",",
+                (unsigned long)m->phase_wakes);
+        bool f2 = true;
+        for (int i = 0; i < PHASE_COUNT; i++) {
+            if (m->phase_mask & (1u << i)) {
+                fprintf(s_corpus, "%s\"%s\":{\"last_us\":%lu,\"avg_us\":%lu,\"max_us\":%lu}",
+                        f2 ? "" : ",", phase_names[i], (unsigned long)m->phases[i].last_us,
+                        (unsigned long)m->phases[i].avg_us, (unsigned long)m->phases[i].max_us);
+                f2 = false;
+            }
+        }
+        fputc('}', s_corpus);
+        first = false;
+    }
+    if (m->has_energy) {
+        fprintf(s_corpus, "%s\"energy_cycles\":%lu,\"energy_delivered\":%lu,"
+                "\"energy_uah\":%lu,\"energy_cycle_uas\":%lu,\"energy_states\":{",
+                first ? "" : ",", (unsigned long)m->energy_cycles,
+                (unsigned long)m->energy_delivered, (unsigned long)m->energy_uah,
+                (unsigned long)m->energy_cycle_uas);
+        bool f2 = true;
+        for (int i = 0; i < ENERGY_STATE_COUNT; i++) {
+            if (m->energy_mask & (1u << i)) {
+                fprintf(s_corpus, "%s\"%s\":{\"last_ms\":%lu,\"uah\":%lu}", f2 ? "" : ",",
+                        energy_acct_state_name((energy_state_t)i),
+                        (unsigned long)m->energy_ms[i], (unsigned long)m->energy_state_uah[i]);
+                f2 = false;
+            }
+        }
+        fputc('}', s_corpus);
+    }
+    fprintf(s_corpus, "}\n");
+    s_corpus_lines++;
+}
+
+/* Decode, record for the cross-check, and check the result is sane */
+static bool decode(const uint8_t *buf, size_t len)
+{
+    memset(&s_m, 0xA5, sizeof(s_m));        /* decode() must clear it */
+    bool ok = telem_tlv_decode(buf, len, &s_m);
+
+    if (ok) {
+        CHECK(memchr(s_m.node_id, '\0', sizeof(s_m.node_id)) != NULL);
+        CHECK(memchr(s_m.fw_version, '\0', sizeof(s_m.fw_version)) != NULL);
+        CHECK(s_m.n_samples <= TELEM_BATCH_CAPACITY);
+        CHECK((s_m.phase_mask >> PHASE_COUNT) == 0);
+        CHECK((s_m.energy_mask >> ENERGY_STATE_COUNT) == 0);
+    }
+    corpus_add(buf, len, ok, &s_m);
+    return ok;
+}
+
+/* ---- round trips ---- */
+
+static void test_roundtrip_full_message(void)
+{
+    static uint8_t buf[1024];
+    uint16_t n;
+
+    fill_batch(TELEM_BATCH_CAPACITY);
+    fill_stats();
+    size_t len = encode_full(buf, sizeof(buf), &n);
+    CHECK(len > 0);
+    CHECK_EQ(n, TELEM_BATCH_CAPACITY);
+    CHECK(decode(buf, len));
+
+    CHECK_STR(s_m.node_id, "node-17");
+    CHECK_STR(s_m.fw_version, "1.4.2");
+    CHECK(s_m.has_wake_reason && s_m.has_awake_ms && s_m.has_adc_mv && s_m.has_adc_raw);
+    CHECK_EQ(s_m.wake_reason, 4);
+    CHECK_EQ(s_m.awake_ms, 812);
+    CHECK_EQ(s_m.adc_mv, 1234);
+    CHECK_EQ(s_m.adc_raw, 4095);
+
+    CHECK(s_m.has_imu);
+    CHECK_EQ(s_m.imu.accel_mg[0], 0);
+    CHECK_EQ(s_m.imu.accel_mg[1], -1);
+    CHECK_EQ(s_m.imu.accel_mg[2], INT32_MIN);
+    CHECK_EQ(s_m.imu.gyro_mdps[0], INT32_MAX);
+    CHECK_EQ(s_m.imu.gyro_mdps[1], 63);
+    CHECK_EQ(s_m.imu.gyro_mdps[2], -64);
+
+    CHECK(s_m.has_phases);
+    CHECK_EQ(s_m.phase_wakes, 12);
+    CHECK_EQ(s_m.phase_mask, ((1u << PHASE_COUNT) - 1) & ~(1u << PHASE_NVS));
+    for (int i = 0; i < PHASE_COUNT; i++) {
+        if (i != PHASE_NVS) {
+            CHECK_EQ(s_m.phases[i].last_us, s_pt.stat[i].last_us);
+            CHECK_EQ(s_m.phases[i].avg_us, s_pt.stat[i].avg_us);
+            CHECK_EQ(s_m.phases[i].max_us, s_pt.stat[i].max_us);
+        }
+    }
+
+    CHECK(s_m.has_energy);
+    CHECK_EQ(s_m.energy_cycles, 40);
+    CHECK_EQ(s_m.energy_delivered, 200);
+    CHECK_EQ(s_m.energy_uah, 7 + 950 + 25);
+    CHECK_EQ(s_m.energy_cycle_uas, 123456);
+    CHECK_EQ(s_m.energy_mask, (1u << ENERGY_CPU) | (1u << ENERGY_RADIO_RX) |
+                              (1u << ENERGY_DEEP_SLEEP));
+    CHECK_EQ(s_m.energy_ms[ENERGY_RADIO_RX], 300);
+    CHECK_EQ(s_m.energy_state_uah[ENERGY_RADIO_RX], 950);
+    CHECK_EQ(s_m.energy_state_uah[ENERGY_DEEP_SLEEP], 25);
+
+    CHECK_EQ(s_m.n_samples, TELEM_BATCH_CAPACITY);
+    CHECK_EQ(s_m.dropped, 0);
+    for (uint16_t i = 0; i < s_m.n_samples; i++) {
+        telem_sample_t want = sample(i);
+        CHECK_EQ(s_m.samples[i].t_s, want.t_s);
+        CHECK_EQ(s_m.samples[i].value, want.value);
+        CHECK_EQ(s_m.samples[i].flags, want.flags);
+    }
+}
+
+/* varint length steps, both ends of the zigzag range */
+static void test_roundtrip_varint_edges(void)
+{
+    static const uint32_t values[] = {
+        0, 1, 127, 128, 16383, 16384, (1u << 21) - 1, 1u << 21,
+        (1u << 28) - 1, 1u << 28, UINT32_MAX - 1, UINT32_MAX,
+    };
+    static const int32_t svalues[] = {
+        0, -1, 1, -64, 63, -65, 64, INT32_MIN, INT32_MAX, INT32_MIN + 1,
+    };
+    uint8_t buf[64];
+    telem_tlv_writer_t w;
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        telem_tlv_begin(&w, buf, sizeof(buf));
+        telem_tlv_put_uint(&w, TELEM_TLV_AWAKE_MS, values[i]);
+        size_t len = telem_tlv_end(&w);
+        CHECK(decode(buf, len));
+        CHECK(s_m.has_awake_ms);
+        CHECK_EQ(s_m.awake_ms, values[i]);
+        CHECK(!s_m.has_adc_mv);
+    }
+
+    for (size_t i = 0; i < sizeof(svalues) / sizeof(svalues[0]); i++) {
+        telem_imu_t imu = { .accel_mg = { svalues[i], 0, 0 }, .gyro_mdps = { 0, 0, svalues[i] } };
+        telem_tlv_begin(&w, buf, sizeof(buf));
+        telem_tlv_put_imu(&w, &imu);
+        size_t len = telem_tlv_end(&w);
+        CHECK(decode(buf, len));
+        CHECK_EQ(s_m.imu.accel_mg[0], svalues[i]);
+        CHECK_EQ(s_m.imu.gyro_mdps[2], svalues[i]);
+    }
+}
+
+/*
+ * Every capacity: the message either fits whole (with as many batch
+ * samples as there was room for) or telem_tlv_end() says 0; nothing is
+ * written past cap, and what is returned always decodes.
+ */
+static void test_encode_every_capacity(void)
+{
+    static uint8_t buf[1024 + 16];
+    uint16_t n, full_n;
+
+    fill_batch(TELEM_BATCH_CAPACITY + 7);  /* 7 dropped */
+    fill_stats();
+    size_t full = encode_full(buf, 1024, &full_n);
+    CHECK_EQ(full_n, TELEM_BATCH_CAPACITY);
+
+    uint16_t prev = 0;
+    for (size_t cap = 0; cap <= full; cap++) {
+        memset(buf, 0xEE, sizeof(buf));
+        size_t len = encode_full(buf, cap, &n);
+
+        CHECK_EQ(buf[cap], 0xEE);
+        CHECK(len <= cap);
+        if (len == 0) {
+            CHECK_EQ(n, 0);
+            continue;
+        }
+        CHECK(n >= prev);
+        prev = n;
+        CHECK(decode(buf, len));
+        CHECK_EQ(s_m.n_samples, n);
+        CHECK_EQ(s_m.dropped, n ? 7 : 0);      /* no batch field without samples */
+        for (uint16_t i = 0; i < n; i++) {
+            CHECK_EQ(s_m.samples[i].t_s, sample(7 + i).t_s);
+        }
+    }
+    CHECK_EQ(prev, TELEM_BATCH_CAPACITY);
+}
+
+/* ---- malformed input ---- */
+
+static void test_rejects(void)
+{
+    static const struct {
+        const char *what;
+        uint8_t     bytes[12];
+        size_t      len;
+        bool        ok;
+    } cases[] = {
+        { "empty",                  { 0 },                                  0, false },
+        { "version 0",              { 0x00 },                               1, false },
+        { "newer version",          { 0x02, 0x04, 0x01, 0x05 },             4, false },
+        { "version only",           { 0x01 },                               1, true  },
+        { "unknown type skipped",   { 0x01, 0x7E, 0x02, 0xFF, 0xFF, 0x04, 0x01, 0x05 }, 8, true },
+        { "length past end",        { 0x01, 0x04, 0x02, 0x05 },             4, false },
+        { "length varint cut",      { 0x01, 0x04, 0x80 },                   3, false },
+        { "uint trailing byte",     { 0x01, 0x04, 0x02, 0x05, 0x00 },       5, false },
+        { "uint empty",             { 0x01, 0x04, 0x00 },                   3, false },
+        { "uint 33 bit",            { 0x01, 0x04, 0x05, 0xFF, 0xFF, 0xFF, 0xFF, 0x1F }, 8, false },
+        { "uint 6 byte varint",     { 0x01, 0x04, 0x06, 0x80, 0x80, 0x80, 0x80, 0x80, 0x00 }, 9, false },
+        { "uint max",               { 0x01, 0x04, 0x05, 0xFF, 0xFF, 0xFF, 0xFF, 0x0F }, 8, true },
+        { "string with NUL",        { 0x01, 0x01, 0x03, 'a', 0x00, 'b' },   6, false },
+        { "empty string",           { 0x01, 0x01, 0x00 },                   3, true  },
+        { "imu short",              { 0x01, 0x12, 0x05, 0, 0, 0, 0, 0 },    8, false },
+        { "batch n > capacity",     { 0x01, 0x20, 0x03, 0x00, 0x00, 0x41 }, 6, false },
+        { "batch value > 16 bit",   { 0x01, 0x20, 0x07, 0x00, 0x00, 0x01, 0x00, 0x80, 0x80, 0x08 }, 10, false },
+        { "batch n = 0",            { 0x01, 0x20, 0x03, 0x05, 0x00, 0x00 }, 6, true  },
+        { "phases bit 31 read",     { 0x01, 0x30, 0x09, 0x01, 0x80, 0x80, 0x80, 0x80, 0x08, 1, 2, 3 }, 12, true },
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        bool ok = decode(cases[i].bytes, cases[i].len);
+        if (ok != cases[i].ok) {
+            fprintf(stderr, "  case \"%s\"\n", cases[i].what);
+        }
+        CHECK_EQ(ok, cases[i].ok);
+    }
+
+    /* strings: one byte less than the struct field fits, the full size does not */
+    uint8_t buf[64] = { 0x01, TELEM_TLV_NODE_ID, 31 };
+    memset(buf + 3, 'n', 32);
+    CHECK(decode(buf, 3 + 31));
+    CHECK_EQ(strlen(s_m.node_id), 31);
+    buf[2] = 32;
+    CHECK(!decode(buf, 3 + 32));
+
+    buf[1] = TELEM_TLV_FW_VERSION;
+    buf[2] = 15;
+    CHECK(decode(buf, 3 + 15));
+    buf[2] = 16;
+    CHECK(!decode(buf, 3 + 16));
+}
+
+/* Every prefix: valid exactly at the field boundaries, never read past len */
+static void test_truncated_prefixes(void)
+{
+    static uint8_t full[1024];
+    size_t boundary[64];
+    int n_boundary = 0;
+    uint16_t n;
+
+    fill_batch(40);
+    fill_stats();
+    size_t len = encode_full(full, sizeof(full), &n);
+    CHECK(len > 0);
+
+    telem_tlv_reader_t r;
+    telem_tlv_field_t f;
+    CHECK(telem_tlv_reader_init(&r, full, len));
+    boundary[n_boundary++] = 1;
+    while (telem_tlv_next(&r, &f) == 1 && n_boundary < 64) {
+        boundary[n_boundary++] = (size_t)(r.p - full);
+    }
+    CHECK_EQ(boundary[n_boundary - 1], len);
+
+    for (size_t cut = 0; cut <= len; cut++) {
+        /* exact size copy, so ASan sees any read past the end */
+        uint8_t *p = malloc(cut ? cut : 1);
+        memcpy(p, full, cut);
+
+        bool at_boundary = false;
+        for (int i = 0; i < n_boundary; i++) {
+            at_boundary |= (boundary[i] == cut);
+        }
+        CHECK_EQ(decode(p, cut), at_boundary);
+        free(p);
+    }
+}
+
+/* Random damage to real messages: must never crash, results stay sane */
+static void test_mutations(void)
+{
+    static uint8_t full[1024];
+    uint32_t rng = 0x7E1E7E1E;
+    int accepted = 0;
+    uint16_t n;
+
+    for (int round = 0; round < 20000; round++) {
+        fill_batch(check_rand(&rng) % (TELEM_BATCH_CAPACITY + 1));
+        fill_stats();
+        size_t len = encode_full(full, 64 + check_rand(&rng) % 900, &n);
+        if (len == 0) {
+            continue;
+        }
+
+        uint8_t *p = malloc(len + 8);
+        memcpy(p, full, len);
+
+        int edits = 1 + (int)(check_rand(&rng) % 4);
+        for (int e = 0; e < edits && len > 0; e++) {
+            size_t at = check_rand(&rng) % len;
+            switch (check_rand(&rng) % 5) {
+                case 0:     /* bit flip */
+                    p[at] ^= (uint8_t)(1u << (check_rand(&rng) % 8));
+                    break;
+                case 1:     /* random byte */
+                    p[at] = (uint8_t)check_rand(&rng);
+                    break;
+                case 2:     /* continuation bit: longer varints */
+                    p[at] |= 0x80;
+                    break;
+                case 3:     /* drop a byte */
+                    memmove(p + at, p + at + 1, len - at - 1);
+                    len--;
+                    break;
+                default:    /* insert a byte */
+                    memmove(p + at + 1, p + at, len - at);
+                    p[at] = (uint8_t)check_rand(&rng);
+                    len++;
+                    break;
+            }
+        }
+
+        /* exact size again */
+        uint8_t *q = malloc(len ? len : 1);
+        memcpy(q, p, len);
+        free(p);
+        accepted += decode(q, len);
+        free(q);
+    }
+
+    /* both outcomes are exercised (the version byte and skipped types keep some valid) */
+    CHECK(accepted > 100);
+    CHECK(accepted < 19000);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !(s_corpus = fopen(argv[1], "w"))) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    RUN(test_roundtrip_full_message);
+    RUN(test_roundtrip_varint_edges);
+    RUN(test_encode_every_capacity);
+    RUN(test_rejects);
+    RUN(test_truncated_prefixes);
+    RUN(test_mutations);
+
+    if (s_corpus) {
+        fclose(s_corpus);
+        printf("  %d messages written to %s\n", s_corpus_lines, argv[1]);
+    }
+    return check_done();
+}
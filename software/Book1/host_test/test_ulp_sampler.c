@@ -0,0 +1,245 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: ULP window and wake decisions, against their Python twin
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+#include "check.h"
+#include "ulp_sampler.h"
+
+static FILE *s_corpus;
+static int   s_corpus_lines;
+
+/* what ulp_monitor_start() writes into the loaded program's .bss */
+static ulp_sampler_t sampler(uint32_t low, uint32_t high, uint32_t hyst, uint32_t batch)
+{
+    ulp_sampler_t s;
+    memset(&s, 0, sizeof(s));
+    s.low = low;
+    s.high = high;
+    s.hyst = hyst;
+    s.batch = batch;
+    return s;
+}
+
+static void test_window(void)
+{
+    ulp_sampler_t s = sampler(0, UINT32_MAX, 0, 0);
+    static const uint32_t v[] = { 2000, 1990, 2100, 4095, 0, 2050 };
+
+    for (size_t i = 0; i < sizeof(v) / sizeof(v[0]); i++) {
+        CHECK(!ulp_sampler_step(&s, v[i]));
+    }
+    CHECK_EQ(s.n, 6);
+    CHECK_EQ(s.min, 0);
+    CHECK_EQ(s.max, 4095);
+    CHECK_EQ(s.sum, 12235);
+    CHECK_EQ(s.last, 2050);
+    CHECK_EQ(s.runs, 6);
+    CHECK_EQ(s.zone, ULP_SAMPLER_ZONE_NORMAL);
+
+    /* a new window starts from its first reading, runs keep counting */
+    ulp_sampler_reset(&s);
+    CHECK(!ulp_sampler_step(&s, 3000));
+    CHECK_EQ(s.min, 3000);
+    CHECK_EQ(s.max, 3000);
+    CHECK_EQ(s.sum, 3000);
+    CHECK_EQ(s.runs, 7);
+}
+
+/* batch 0 never wakes, however long the window gets */
+static void test_batch(void)
+{
+    ulp_sampler_t s = sampler(0, UINT32_MAX, 0, 0);
+
+    for (int i = 0; i < 100000; i++) {
+        CHECK(!ulp_sampler_step(&s, 1234));
+    }
+    CHECK_EQ(s.n, 100000);
+    CHECK_EQ(s.wake, ULP_SAMPLER_WAKE_NONE);
+
+    s = sampler(0, UINT32_MAX, 0, 5);
+    for (int i = 0; i < 4; i++) {
+        CHECK(!ulp_sampler_step(&s, 1234));
+    }
+    CHECK(ulp_sampler_step(&s, 1234));
+    CHECK_EQ(s.wake, ULP_SAMPLER_WAKE_BATCH);
+    CHECK_EQ(s.n, 5);
+
+    /* main CPU not there yet: the window grows, no second wake */
+    CHECK(!ulp_sampler_step(&s, 1234));
+    CHECK_EQ(s.n, 6);
+    ulp_sampler_reset(&s);
+    CHECK_EQ(s.wake, ULP_SAMPLER_WAKE_NONE);
+    for (int i = 0; i < 4; i++) {
+        CHECK(!ulp_sampler_step(&s, 1234));
+    }
+    CHECK(ulp_sampler_step(&s, 1234));
+
+    /* batch 1: every reading */
+    s = sampler(0, UINT32_MAX, 0, 1);
+    CHECK(ulp_sampler_step(&s, 0));
+    ulp_sampler_reset(&s);
+    CHECK(ulp_sampler_step(&s, 0));
+}
+
+/* thresholds 400 / 3700, 50 counts of hysteresis back to normal */
+static void test_thresholds(void)
+{
+    ulp_sampler_t s = sampler(400, 3700, 50, 0);
+
+    CHECK(!ulp_sampler_step(&s, 400));              /* on the threshold: inside */
+    CHECK(ulp_sampler_step(&s, 399));
+    CHECK_EQ(s.wake, ULP_SAMPLER_WAKE_LOW);
+    CHECK_EQ(s.zone, ULP_SAMPLER_ZONE_LOW);
+    ulp_sampler_reset(&s);
+    CHECK_EQ(s.zone, ULP_SAMPLER_ZONE_LOW);         /* the reset keeps the zone */
+
+    CHECK(!ulp_sampler_step(&s, 420));              /* inside, not by 50 yet */
+    CHECK(!ulp_sampler_step(&s, 449));
+    CHECK(ulp_sampler_step(&s, 450));
+    CHECK_EQ(s.wake, ULP_SAMPLER_WAKE_NORMAL);
+    ulp_sampler_reset(&s);
+
+    CHECK(!ulp_sampler_step(&s, 3700));
+    CHECK(ulp_sampler_step(&s, 3701));
+    CHECK_EQ(s.wake, ULP_SAMPLER_WAKE_HIGH);
+    ulp_sampler_reset(&s);
+    CHECK(!ulp_sampler_step(&s, 3651));
+    CHECK(ulp_sampler_step(&s, 3650));
+    CHECK_EQ(s.wake, ULP_SAMPLER_WAKE_NORMAL);
+    ulp_sampler_reset(&s);
+
+    /* straight from high to low */
+    CHECK(ulp_sampler_step(&s, 4000));
+    ulp_sampler_reset(&s);
+    CHECK(ulp_sampler_step(&s, 10));
+    CHECK_EQ(s.wake, ULP_SAMPLER_WAKE_LOW);
+
+    /* no thresholds: low 0 and high UINT32_MAX (ulp_monitor_start) */
+    s = sampler(0, UINT32_MAX, 50, 0);
+    CHECK(!ulp_sampler_step(&s, 0));
+    CHECK(!ulp_sampler_step(&s, 4095));
+    CHECK_EQ(s.zone, ULP_SAMPLER_ZONE_NORMAL);
+}
+
+/* the first reason wins until the main CPU collects; the zone moves on */
+static void test_first_reason_wins(void)
+{
+    ulp_sampler_t s = sampler(400, 3700, 50, 3);
+
+    CHECK(!ulp_sampler_step(&s, 2000));
+    CHECK(ulp_sampler_step(&s, 100));
+    CHECK(!ulp_sampler_step(&s, 100));              /* batch full, already woken */
+    CHECK(!ulp_sampler_step(&s, 4000));
+    CHECK_EQ(s.wake, ULP_SAMPLER_WAKE_LOW);
+    CHECK_EQ(s.zone, ULP_SAMPLER_ZONE_HIGH);
+    CHECK_EQ(s.n, 4);
+
+    /* a zone change beats a full window in the same reading */
+    ulp_sampler_reset(&s);
+    CHECK(!ulp_sampler_step(&s, 4000));
+    CHECK(!ulp_sampler_step(&s, 4000));
+    CHECK(ulp_sampler_step(&s, 2000));
+    CHECK_EQ(s.wake, ULP_SAMPLER_WAKE_NORMAL);
+}
+
+/* ---- random traces for the Python cross-check ---- */
+
+static uint32_t pick(uint32_t *seed, uint32_t lo, uint32_t hi)
+{
+    return lo + check_rand(seed) % (hi - lo + 1);
+}
+
+/*
+ * "cfg <low> <high> <hyst> <batch>" starts a sampler, then per reading
+ *   step <v> <woke 0|1> <wake> <zone> <n> <min> <max> <sum>
+ * and "reset" where the main CPU collected.
+ */
+static void test_random_traces(void)
+{
+    uint32_t seed = 22;
+    int wakes[ULP_SAMPLER_WAKE_BATCH + 1] = { 0 };
+
+    for (int trace = 0; trace < 300; trace++) {
+        uint32_t low = pick(&seed, 1, 4) == 1 ? 0 : pick(&seed, 0, 2000);
+        uint32_t high = pick(&seed, 1, 4) == 1 ? UINT32_MAX : pick(&seed, 2000, 4095);
+        ulp_sampler_t s = sampler(low, high, pick(&seed, 0, 200),
+                                  pick(&seed, 1, 3) == 1 ? 0 : pick(&seed, 1, 60));
+        uint32_t v = pick(&seed, 0, 4095);
+        uint32_t pending = 0;
+
+        if (s_corpus) {
+            fprintf(s_corpus, "cfg %lu %lu %lu %lu\n", (unsigned long)s.low,
+                    (unsigned long)s.high, (unsigned long)s.hyst, (unsigned long)s.batch);
+        }
+        for (int i = 0; i < 500; i++) {
+            uint32_t k = pick(&seed, 1, 100);
+            if (k <= 3) {
+                v = pick(&seed, 0, 4095);
+            } else if (k <= 60) {
+                int32_t nv = (int32_t)v + (int32_t)pick(&seed, 0, 80) - 40;
+                v = nv < 0 ? 0 : (nv > 4095 ? 4095 : (uint32_t)nv);
+            }
+
+            uint32_t n_before = s.n;
+            bool woke = ulp_sampler_step(&s, v);
+            CHECK_EQ(s.n, n_before + 1);
+            CHECK(s.min <= v && v <= s.max);
+            CHECK(!woke || s.wake != ULP_SAMPLER_WAKE_NONE);
+            if (woke) {
+                wakes[s.wake]++;
+                pending = 1;
+            }
+            if (s_corpus) {
+                fprintf(s_corpus, "step %lu %d %lu %lu %lu %lu %lu %lu\n", (unsigned long)v,
+                        woke, (unsigned long)s.wake, (unsigned long)s.zone, (unsigned long)s.n,
+                        (unsigned long)s.min, (unsigned long)s.max, (unsigned long)s.sum);
+                s_corpus_lines++;
+            }
+
+            /* the main CPU takes a while to boot and collect, or never wakes */
+            if ((pending && pick(&seed, 1, 3) == 1) || pick(&seed, 1, 200) == 1) {
+                ulp_sampler_reset(&s);
+                pending = 0;
+                if (s_corpus) {
+                    fprintf(s_corpus, "reset\n");
+                }
+            }
+        }
+    }
+
+    for (int w = ULP_SAMPLER_WAKE_LOW; w <= ULP_SAMPLER_WAKE_BATCH; w++) {
+        CHECK(wakes[w] > 0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !(s_corpus = fopen(argv[1], "w"))) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    RUN(test_window);
+    RUN(test_batch);
+    RUN(test_thresholds);
+    RUN(test_first_reason_wins);
+    RUN(test_random_traces);
+
+    if (s_corpus) {
+        fclose(s_corpus);
+        printf("  %d readings written to %s\n", s_corpus_lines, argv[1]);
+    }
+    return check_done();
+}
@@ -0,0 +1,201 @@
+/******************************************************************************
+ * AIoT Workshop – Band 1
+ * Host test: boot-or-sleep decision of the wake stub
+ *
+ * Copyright (c) 2026 Friedrich Riedhammer
+ *
+ * This source code is provided as part of the book "AIoT Workshop – Band 1".
+ * Permission is granted to use, modify and compile this code for educational,
+ * research and product development purposes.
+ *
+ * Redistribution as part of other publications or commercial training material
+ * requires written permission of the author.
+ *
+ * The software is provided "as is", without warranty of any kind.
+ ******************************************************************************/
+
+/*
+ * wake_gate.h is header-only, so the stub's decision runs here unchanged.
+ * Random traces go to a corpus that wake_gate_crosscheck.py runs through
+ * the WakeGate twin of tools/ulp_energy.py.
+ */
+
+#include <stdio.h>
+
+#include "check.h"
+#include "wake_gate.h"
+
+static FILE *s_corpus;
+static int   s_corpus_lines;
+
+/* what wake_stub_arm() does after every boot */
+static void arm(wake_gate_state_t *st)
+{
+    st->skipped = 0;
+}
+
+static void test_first_wake_boots(void)
+{
+    const wake_gate_config_t cfg = { .delta = 100, .heartbeat = 0 };
+    wake_gate_state_t st = { 0 };
+
+    CHECK_EQ(wake_gate_check(&st, &cfg, 1234), WAKE_GATE_BOOT_FIRST);
+    CHECK_EQ(st.ref, 1234);
+    CHECK_EQ(st.have_ref, 1);
+    CHECK_EQ(st.skipped, 0);
+
+    /* a reference of 0 is still a reference */
+    st = (wake_gate_state_t){ 0 };
+    CHECK_EQ(wake_gate_check(&st, &cfg, 0), WAKE_GATE_BOOT_FIRST);
+    CHECK_EQ(wake_gate_check(&st, &cfg, 99), WAKE_GATE_SLEEP);
+}
+
+static void test_delta(void)
+{
+    const wake_gate_config_t cfg = { .delta = 50, .heartbeat = 0 };
+    wake_gate_state_t st = { 0 };
+
+    wake_gate_check(&st, &cfg, 1000);
+    CHECK_EQ(wake_gate_check(&st, &cfg, 1049), WAKE_GATE_SLEEP);
+    CHECK_EQ(wake_gate_check(&st, &cfg, 951), WAKE_GATE_SLEEP);
+    CHECK_EQ(st.ref, 1000);                     /* a sleep keeps the reference */
+    CHECK_EQ(st.skipped, 2);
+
+    CHECK_EQ(wake_gate_check(&st, &cfg, 950), WAKE_GATE_BOOT_DELTA);   /* >= delta */
+    CHECK_EQ(st.ref, 950);
+    CHECK_EQ(st.skipped, 2);                    /* reported to the app, arm clears it */
+    arm(&st);
+    CHECK_EQ(wake_gate_check(&st, &cfg, 999), WAKE_GATE_SLEEP);        /* measured from 950 now */
+    CHECK_EQ(wake_gate_check(&st, &cfg, 1000), WAKE_GATE_BOOT_DELTA);
+
+    /* full uint16 range both ways */
+    CHECK_EQ(wake_gate_check(&st, &cfg, 0), WAKE_GATE_BOOT_DELTA);
+    CHECK_EQ(wake_gate_check(&st, &cfg, UINT16_MAX), WAKE_GATE_BOOT_DELTA);
+    CHECK_EQ(wake_gate_check(&st, &cfg, 0), WAKE_GATE_BOOT_DELTA);
+
+    /* delta 0: every wake boots */
+    const wake_gate_config_t zero = { .delta = 0, .heartbeat = 0 };
+    CHECK_EQ(wake_gate_check(&st, &zero, 0), WAKE_GATE_BOOT_DELTA);
+}
+
+static void test_heartbeat(void)
+{
+    const wake_gate_config_t cfg = { .delta = 100, .heartbeat = 5 };
+    wake_gate_state_t st = { 0 };
+
+    wake_gate_check(&st, &cfg, 2000);
+    arm(&st);
+    for (int round = 0; round < 3; round++) {
+        for (int i = 0; i < 4; i++) {
+            CHECK_EQ(wake_gate_check(&st, &cfg, (uint16_t)(2000 + i)), WAKE_GATE_SLEEP);
+        }
+        CHECK_EQ(st.skipped, 4);
+        CHECK_EQ(wake_gate_check(&st, &cfg, 2010), WAKE_GATE_BOOT_HEARTBEAT);   /* every 5th wake */
+        CHECK_EQ(st.ref, 2010);                 /* the heartbeat reading is the new reference */
+        arm(&st);
+    }
+
+    /* a change wins over the heartbeat when both are due */
+    for (int i = 0; i < 4; i++) {
+        wake_gate_check(&st, &cfg, 2010);
+    }
+    CHECK_EQ(wake_gate_check(&st, &cfg, 2110), WAKE_GATE_BOOT_DELTA);
+
+    /* heartbeat 1: no wake is skipped */
+    const wake_gate_config_t every = { .delta = 100, .heartbeat = 1 };
+    arm(&st);
+    CHECK_EQ(wake_gate_check(&st, &every, 2110), WAKE_GATE_BOOT_HEARTBEAT);
+
+    /* heartbeat 0: never, however long it stays quiet */
+    const wake_gate_config_t never = { .delta = 100, .heartbeat = 0 };
+    arm(&st);
+    int boots = 0;
+    for (int i = 0; i < 100000; i++) {
+        boots += wake_gate_check(&st, &never, 2110) != WAKE_GATE_SLEEP;
+    }
+    CHECK_EQ(boots, 0);
+    CHECK_EQ(st.skipped, 100000);
+}
+
+static uint32_t pick(uint32_t *seed, uint32_t lo, uint32_t hi)
+{
+    return lo + check_rand(seed) % (hi - lo + 1);
+}
+
+/* drift, noise and jumps, with the stub re-armed after every boot */
+static void test_random_traces(void)
+{
+    uint32_t seed = 21;
+    int verdicts[WAKE_GATE_BOOT_HEARTBEAT + 1] = { 0 };
+
+    for (int trace = 0; trace < 300; trace++) {
+        wake_gate_config_t cfg = {
+            .delta = (uint16_t)(pick(&seed, 1, 10) == 1 ? 0 : pick(&seed, 1, 300)),
+            .heartbeat = (uint16_t)(pick(&seed, 1, 4) == 1 ? 0 : pick(&seed, 1, 40)),
+        };
+        wake_gate_state_t st = { 0 };
+        int32_t v = (int32_t)pick(&seed, 0, 4095);
+
+        if (s_corpus) {
+            fprintf(s_corpus, "cfg %u %u\n", (unsigned)cfg.delta, (unsigned)cfg.heartbeat);
+        }
+        for (int i = 0; i < 400; i++) {
+            uint32_t k = pick(&seed, 1, 100);
+            if (k <= 2) {
+                v = (int32_t)pick(&seed, 0, UINT16_MAX);
+            } else if (k <= 60) {
+                v += (int32_t)pick(&seed, 0, 40) - 20;
+                v = v < 0 ? 0 : (v > UINT16_MAX ? UINT16_MAX : v);
+            }
+
+            uint16_t ref = st.ref;
+            uint32_t skipped = st.skipped;
+            wake_gate_verdict_t verdict = wake_gate_check(&st, &cfg, (uint16_t)v);
+            verdicts[verdict]++;
+            if (verdict == WAKE_GATE_SLEEP) {
+                CHECK_EQ(st.ref, ref);
+                CHECK_EQ(st.skipped, skipped + 1);
+            } else {
+                CHECK_EQ(st.ref, v);
+                CHECK_EQ(st.skipped, skipped);
+                arm(&st);
+            }
+            if (s_corpus) {
+                fprintf(s_corpus, "wake %ld %d %u %lu\n", (long)v, verdict != WAKE_GATE_SLEEP,
+                        (unsigned)st.ref, (unsigned long)st.skipped);
+                s_corpus_lines++;
+            }
+
+            /* power loss: RTC memory gone, the next stub wake boots */
+            if (pick(&seed, 1, 300) == 1) {
+                st = (wake_gate_state_t){ 0 };
+                if (s_corpus) {
+                    fprintf(s_corpus, "poweron\n");
+                }
+            }
+        }
+    }
+
+    for (int v = WAKE_GATE_SLEEP; v <= WAKE_GATE_BOOT_HEARTBEAT; v++) {
+        CHECK(verdicts[v] > 0);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && !(s_corpus = fopen(argv[1], "w"))) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    RUN(test_first_wake_boots);
+    RUN(test_delta);
+    RUN(test_heartbeat);
+    RUN(test_random_traces);
+
+    if (s_corpus) {
+        fclose(s_corpus);
+        printf("  %d wakes written to %s\n", s_corpus_lines, argv[1]);
+    }
+    return check_done();
+}
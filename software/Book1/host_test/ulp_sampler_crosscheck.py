@@ -0,0 +1,67 @@
+#!/usr/bin/env python3
+###############################################################################
+# AIoT Workshop – Band 1
+# Host test: replay the ulp_sampler traces through tools/ulp_energy.py
+#
+# Copyright (c) 2026 Friedrich Riedhammer
+#
+# This source code is provided as part of the book "AIoT Workshop – Band 1".
+# Permission is granted to use, modify and compile this code for educational,
+# research and product development purposes.
+#
+# Redistribution as part of other publications or commercial training material
+# requires written permission of the author.
+#
+# The software is provided "as is", without warranty of any kind.
+###############################################################################
+"""
+Read the traces test_ulp_sampler writes and run every reading through the
+UlpSampler of tools/ulp_energy.py. Wake decision, zone and window must be
+the same as in ulp_sampler.h.
+
+  ./build/test_ulp_sampler build/ulp_sampler_corpus.txt
+  ./ulp_sampler_crosscheck.py build/ulp_sampler_corpus.txt
+
+  cfg <low> <high> <hyst> <batch>
+  step <v> <woke 0|1> <wake> <zone> <n> <min> <max> <sum>
+  reset
+"""
+
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tools"))
+from ulp_energy import UlpSampler  # noqa: E402
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit("usage: %s <corpus>" % sys.argv[0])
+
+    s = None
+    traces = steps = failed = 0
+    with open(sys.argv[1]) as f:
+        for n, line in enumerate(f, 1):
+            cols = line.split()
+            if cols[0] == "cfg":
+                s = UlpSampler(*map(int, cols[1:]))
+                traces += 1
+                continue
+            if cols[0] == "reset":
+                s.reset()
+                continue
+
+            v, want = int(cols[1]), [int(c) for c in cols[2:]]
+            got = [int(s.step(v)), s.wake, s.zone, s.n, s.min, s.max, s.sum]
+            steps += 1
+            if got != want:
+                failed += 1
+                if failed <= 10:
+                    print("  line %d: %s\n    C: %s  Python: %s" % (n, line.strip(), want, got))
+
+    print("  %d traces, %d readings cross-checked, %d differ" % (traces, steps, failed))
+    sys.exit(1 if failed or steps == 0 else 0)
+
+
+if __name__ == "__main__":
+    main()
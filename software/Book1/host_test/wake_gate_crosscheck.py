@@ -0,0 +1,68 @@
+#!/usr/bin/env python3
+###############################################################################
+# AIoT Workshop – Band 1
+# Host test: replay the wake_gate traces through tools/ulp_energy.py
+#
+# Copyright (c) 2026 Friedrich Riedhammer
+#
+# This source code is provided as part of the book "AIoT Workshop – Band 1".
+# Permission is granted to use, modify and compile this code for educational,
+# research and product development purposes.
+#
+# Redistribution as part of other publications or commercial training material
+# requires written permission of the author.
+#
+# The software is provided "as is", without warranty of any kind.
+###############################################################################
+"""
+Read the wakes test_wake_gate writes and run every reading through the
+WakeGate of tools/ulp_energy.py. Boot decision, reference and skipped
+count (after the re-arm of a boot) must be the same as in wake_gate.h.
+
+  ./build/test_wake_gate build/wake_gate_corpus.txt
+  ./wake_gate_crosscheck.py build/wake_gate_corpus.txt
+
+  cfg <delta> <heartbeat>
+  wake <raw> <boot 0|1> <ref> <skipped>
+  poweron
+"""
+
+import os
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tools"))
+from ulp_energy import WakeGate  # noqa: E402
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit("usage: %s <corpus>" % sys.argv[0])
+
+    g = cfg = None
+    traces = wakes = failed = 0
+    with open(sys.argv[1]) as f:
+        for n, line in enumerate(f, 1):
+            cols = line.split()
+            if cols[0] == "cfg":
+                cfg = [int(c) for c in cols[1:]]
+                g = WakeGate(*cfg)
+                traces += 1
+                continue
+            if cols[0] == "poweron":
+                g = WakeGate(*cfg)
+                continue
+
+            raw, want = int(cols[1]), [int(c) for c in cols[2:]]
+            got = [int(g.boot(raw)), g.ref, g.skipped]
+            wakes += 1
+            if got != want:
+                failed += 1
+                if failed <= 10:
+                    print("  line %d: %s\n    C: %s  Python: %s" % (n, line.strip(), want, got))
+
+    print("  %d traces, %d wakes cross-checked, %d differ" % (traces, wakes, failed))
+    sys.exit(1 if failed or wakes == 0 else 0)
+
+
+if __name__ == "__main__":
+    main()
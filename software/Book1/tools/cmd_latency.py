@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+###############################################################################
+# AIoT Workshop – Band 1
+# Tool: command round trip and current of an always-connected node
+#       (AIoT_MQTT low-power profile)
+#
+# Copyright (c) 2026 Friedrich Riedhammer
+#
+# This source code is provided as part of the book "AIoT Workshop – Band 1".
+# Permission is granted to use, modify and compile this code for educational,
+# research and product development purposes.
+#
+# Redistribution as part of other publications or commercial training material
+# requires written permission of the author.
+#
+# The software is provided "as is", without warranty of any kind.
+###############################################################################
+"""
+Send "ping;req=<n>" to aiot/<node>/cmd at random moments and time the
+"event=pong;req=<n>" on aiot/<node>/event, like a backend would see it.
+The random spacing matters: a node in Wi-Fi modem sleep only listens every
+few beacons, a fixed period would always hit the same phase.
+
+At the same time the status messages of the node are collected
+("device alive;win_ms=..;held_pct=..;light_pct=..;avg_ua=..", pm_duty.h)
+and averaged over the run, weighted by their period:
+
+  ./cmd_latency.py --host 192.168.1.10 --node node1 -n 100
+  ./cmd_latency.py --host 192.168.1.10 --ps 1 -n 100   (radio always on)
+
+--ps sends "ps=<n>" first (0 default, 1 none, 2 min_modem, 3 max_modem),
+so the same run can be repeated per modem sleep mode. The pings are part
+of the measured load: with -n 100 at --gap-s 3 the node answers one
+command every ~3 s on top of its own status messages.
+
+The avg_ua of the node is residency x current table (PM_DUTY_BOARD in
+main.c). Check it once with a power profiler and put the measured
+currents into the table.
+
+Only the Python standard library is used (MQTT client from fleet_sim.py).
+"""
+
+import argparse
+import asyncio
+import os
+import random
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+from fleet_sim import MqttConn, percentiles  # noqa: E402
+
+
+def parse_status(payload):
+    """'device alive;win_ms=5000;...' -> {'win_ms': 5000, ...} (ints only)"""
+    out = {}
+    for field in payload.split(";"):
+        key, sep, val = field.partition("=")
+        if sep and val.isdigit():
+            out[key] = int(val)
+    return out
+
+
+class Probe:
+    def __init__(self, a):
+        self.a = a
+        self.conn = MqttConn(self.on_message)
+        self.sent = {}              # req -> perf_counter of the ping
+        self.rtt = []
+        self.answers = {}           # req -> future for a single command
+        self.periods = []           # parsed status messages with win_ms
+
+    def on_message(self, topic, payload):
+        text = payload.decode(errors="replace")
+        kind = topic.rsplit("/", 1)[-1]
+        if kind == "status":
+            st = parse_status(text)
+            if st.get("win_ms"):
+                self.periods.append(st)
+                if self.a.verbose:
+                    print("  status %s" % text)
+        elif kind == "event" and ";req=" in text:
+            req = text.rpartition(";req=")[2]
+            if req in self.sent:
+                ms = (time.perf_counter() - self.sent.pop(req)) * 1000.0
+                self.rtt.append(ms)
+                if self.a.verbose:
+                    print("  %-6s %8.1f ms" % (req, ms))
+            fut = self.answers.pop(req, None)
+            if fut and not fut.done():
+                fut.set_result(text)
+
+    async def command(self, cmd, req, timeout):
+        fut = asyncio.get_running_loop().create_future()
+        self.answers[req] = fut
+        self.conn.publish(self.topic("cmd"), "%s;req=%s" % (cmd, req), qos=1)
+        return await asyncio.wait_for(fut, timeout)
+
+    def topic(self, kind):
+        return "aiot/%s/%s" % (self.a.node, kind)
+
+    async def run(self):
+        a = self.a
+        await self.conn.connect(a.host, a.port, "cmd_latency_%d" % os.getpid(), 60)
+        await self.conn.subscribe(self.topic("event"), 0)
+        await self.conn.subscribe(self.topic("status"), 0)
+
+        if a.ps is not None:
+            print("ps=%d -> %s" % (a.ps, await self.command("ps=%d" % a.ps, "ps", a.timeout)))
+            self.periods.clear()
+
+        t_ping = time.perf_counter()
+        for i in range(a.count):
+            req = "p%d" % (i + 1)
+            self.sent[req] = time.perf_counter()
+            self.conn.publish(self.topic("cmd"), "ping;req=%s" % req, qos=0)
+            await asyncio.sleep(a.gap_s * random.uniform(0.5, 1.5))
+            if time.perf_counter() - t_ping > 30:
+                self.conn.ping()
+                t_ping = time.perf_counter()
+
+        # stragglers
+        t_end = time.perf_counter() + a.timeout
+        while self.sent and time.perf_counter() < t_end:
+            await asyncio.sleep(0.05)
+        await self.conn.close(clean=True)
+
+    def report(self):
+        a = self.a
+        lost = len(self.sent)
+        print("node %s: %d pings, %d answered, %d lost" % (a.node, a.count, len(self.rtt), lost))
+        if self.rtt:
+            print("rtt ms  p50/p90/p99/max  %s   avg %.1f"
+                  % ("/".join(percentiles(self.rtt)), sum(self.rtt) / len(self.rtt)))
+
+        win = sum(p["win_ms"] for p in self.periods)
+        if not win:
+            print("no status with residency received (is the node on the new firmware?)")
+            return
+
+        def avg(key):
+            return sum(p.get(key, 0) * p["win_ms"] for p in self.periods) / win
+
+        print("node status: %d periods, %.1f s" % (len(self.periods), win / 1000.0))
+        print("  avg_ua %.0f   held %.1f %%   light sleep %.1f %%"
+              % (avg("avg_ua"), avg("held_pct"), avg("light_pct")))
+        cmds = sum(p.get("cmd_n", 0) for p in self.periods)
+        if cmds:
+            busy = sum(p.get("cmd_avg_us", 0) * p.get("cmd_n", 0) for p in self.periods) / cmds
+            print("  node side per command: avg %.0f us, max %d us"
+                  % (busy, max(p.get("cmd_max_us", 0) for p in self.periods)))
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--host", default="127.0.0.1")
+    ap.add_argument("--port", type=int, default=1883)
+    ap.add_argument("--node", default="node1", help="aiot/<node>/... (MQTT_TOPIC_* in main.c)")
+    ap.add_argument("-n", "--count", type=int, default=50, help="pings to send")
+    ap.add_argument("--gap-s", type=float, default=3.0, help="mean gap between pings (+-50%%)")
+    ap.add_argument("--timeout", type=float, default=5.0, help="seconds to wait for late answers")
+    ap.add_argument("--ps", type=int, choices=range(4), help="send ps=<n> before the pings")
+    ap.add_argument("--verbose", action="store_true", help="print every answer and status")
+    a = ap.parse_args()
+
+    probe = Probe(a)
+    try:
+        asyncio.run(probe.run())
+    except (OSError, ConnectionError, asyncio.TimeoutError) as e:
+        print("error: %s" % (str(e) or "timeout"), file=sys.stderr)
+        sys.exit(1)
+    except KeyboardInterrupt:
+        pass
+    probe.report()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,662 @@
+#!/usr/bin/env python3
+###############################################################################
+# AIoT Workshop – Band 1
+# Tool: fleet simulator – many virtual "AIoT Final Node Prof" nodes on one PC
+#
+# Copyright (c) 2026 Friedrich Riedhammer
+#
+# This source code is provided as part of the book "AIoT Workshop – Band 1".
+# Permission is granted to use, modify and compile this code for educational,
+# research and product development purposes.
+#
+# Redistribution as part of other publications or commercial training material
+# requires written permission of the author.
+#
+# The software is provided "as is", without warranty of any kind.
+###############################################################################
+"""
+Load generator for the broker and the dashboards.
+
+Every virtual node behaves like one wake cycle of "AIoT Final Node Prof":
+
+  connect (clean session, LWT aiot/<id>/status "state=offline;..." retained)
+  subscribe aiot/<id>/cmd                       (QoS 0)
+  status  "state=online;...;stage=connected"    (QoS 1, retained)
+  status  "state=online;...;reason=<wakeup>"    (QoS 1, retained)
+  telemetry  (TLV on .../telemetry/bin or key=value text, with the energy
+             account of the previous cycles)               (QoS 1)
+  wait for all PUBACKs, rest of the command window (ping, sleep=, ota=, reboot)
+  status  "state=sleep;...;next=<sec>;sched=<rule>"   (QoS 1, retained)
+  wait for all PUBACKs, "deep sleep": TCP closed WITHOUT DISCONNECT,
+  so the broker fires the LWT exactly like for a real board
+
+The MQTT 3.1.1 client is built in (asyncio, standard library only), so
+thousands of nodes fit into one process. Raise the fd limit first:
+
+  ulimit -n 65536
+  mosquitto -c fleet.conf          # listener 1883 / allow_anonymous true
+  ./fleet_sim.py -n 5000 --interval 30 --duration 300 --monitor --cmd ping --cmd-ratio 0.05
+
+Reported per interval and at the end: publishes, PUBACK latency
+percentiles, MQTT connect latency, broker deliveries/s (with --monitor)
+and command round trip (cmd;req=<id> -> event;...;req=<id>, with --cmd).
+"""
+
+import argparse
+import asyncio
+import os
+import random
+import re
+import struct
+import sys
+import time
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import telem_decode as tlv  # noqa: E402  (schema constants, one source of truth)
+
+FW_VERSION = "1.0.0"
+
+# ENERGY_BOARD_ESP32S3_DEFAULT (energy_acct.h), uA: cpu, rx, tx, light, deep
+ENERGY_UA = [35000, 95000, 150000, 250, 10]
+WAKEUP_TIMER = 4            # esp_sleep_wakeup_cause_t ESP_SLEEP_WAKEUP_TIMER
+WAKEUP_UNDEFINED = 0        # power on
+
+# ---------------------------------------------------------------------------
+# Minimal MQTT 3.1.1 client
+# ---------------------------------------------------------------------------
+
+CONNECT, CONNACK, PUBLISH, PUBACK = 0x10, 0x20, 0x30, 0x40
+SUBSCRIBE, SUBACK, PINGREQ, PINGRESP, DISCONNECT = 0x82, 0x90, 0xC0, 0xD0, 0xE0
+
+
+def _remaining_length(n):
+    out = bytearray()
+    while True:
+        b = n & 0x7F
+        n >>= 7
+        out.append(b | 0x80 if n else b)
+        if not n:
+            return bytes(out)
+
+
+def _str(s):
+    b = s.encode() if isinstance(s, str) else s
+    return struct.pack("!H", len(b)) + b
+
+
+def _packet(ptype, body):
+    return bytes([ptype]) + _remaining_length(len(body)) + body
+
+
+class MqttConn:
+    def __init__(self, on_message=None):
+        self.reader = self.writer = None
+        self.on_message = on_message
+        self.next_id = 1
+        self.pending = {}           # packet id -> future (PUBACK / SUBACK)
+        self.connack = None
+        self.rx_task = None
+
+    async def connect(self, host, port, client_id, keepalive=120, will=None, timeout=10.0):
+        self.reader, self.writer = await asyncio.wait_for(
+            asyncio.open_connection(host, port), timeout)
+
+        flags = 0x02                                    # clean session
+        payload = _str(client_id)
+        if will:
+            topic, msg, qos, retain = will
+            flags |= 0x04 | (qos << 3) | (0x20 if retain else 0)
+            payload += _str(topic) + _str(msg)
+        body = _str("MQTT") + bytes([4, flags]) + struct.pack("!H", keepalive) + payload
+
+        self.connack = asyncio.get_running_loop().create_future()
+        self.rx_task = asyncio.create_task(self._rx())
+        self.writer.write(_packet(CONNECT, body))
+        rc = await asyncio.wait_for(self.connack, timeout)
+        if rc != 0:
+            raise ConnectionError("CONNACK rc=%d" % rc)
+
+    def _packet_id(self):
+        pid = self.next_id
+        self.next_id = pid % 0xFFFF + 1
+        return pid
+
+    def publish(self, topic, payload, qos=0, retain=False):
+        """Returns a future that completes on PUBACK (QoS 1), or None."""
+        if isinstance(payload, str):
+            payload = payload.encode()
+        body = _str(topic)
+        fut = None
+        if qos:
+            pid = self._packet_id()
+            body += struct.pack("!H", pid)
+            fut = asyncio.get_running_loop().create_future()
+            self.pending[pid] = fut
+        self.writer.write(_packet(PUBLISH | (qos << 1) | (1 if retain else 0), body + payload))
+        return fut
+
+    async def subscribe(self, topic, qos=0, timeout=10.0):
+        pid = self._packet_id()
+        fut = asyncio.get_running_loop().create_future()
+        self.pending[pid] = fut
+        self.writer.write(_packet(SUBSCRIBE, struct.pack("!H", pid) + _str(topic) + bytes([qos])))
+        await asyncio.wait_for(fut, timeout)
+
+    def ping(self):
+        self.writer.write(bytes([PINGREQ, 0]))
+
+    async def _rx(self):
+        try:
+            while True:
+                hdr = await self.reader.readexactly(1)
+                n, shift = 0, 0
+                while True:
+                    b = (await self.reader.readexactly(1))[0]
+                    n |= (b & 0x7F) << shift
+                    shift += 7
+                    if not b & 0x80:
+                        break
+                body = await self.reader.readexactly(n) if n else b""
+                ptype = hdr[0] & 0xF0
+
+                if ptype == CONNACK:
+                    if not self.connack.done():
+                        self.connack.set_result(body[1])
+                elif ptype in (PUBACK, SUBACK):
+                    fut = self.pending.pop(struct.unpack("!H", body[:2])[0], None)
+                    if fut and not fut.done():
+                        fut.set_result(time.perf_counter())
+                elif ptype == PUBLISH:
+                    qos = (hdr[0] >> 1) & 3
+                    tlen = struct.unpack("!H", body[:2])[0]
+                    topic = body[2:2 + tlen].decode(errors="replace")
+                    pos = 2 + tlen
+                    if qos:
+                        pid = body[pos:pos + 2]
+                        pos += 2
+                        self.writer.write(bytes([PUBACK, 2]) + pid)
+                    if self.on_message:
+                        self.on_message(topic, body[pos:])
+        except (asyncio.IncompleteReadError, ConnectionError, OSError):
+            pass
+        finally:
+            err = ConnectionError("connection closed")
+            for fut in self.pending.values():
+                if not fut.done():
+                    fut.set_exception(err)
+            self.pending.clear()
+            if self.connack and not self.connack.done():
+                self.connack.set_exception(err)
+
+    async def close(self, clean):
+        """clean=False drops TCP without DISCONNECT (broker sends the LWT)."""
+        if not self.writer:
+            return
+        try:
+            if clean:
+                self.writer.write(bytes([DISCONNECT, 0]))
+                await self.writer.drain()
+            self.writer.close()
+        except (ConnectionError, OSError):
+            pass
+        if self.rx_task:
+            self.rx_task.cancel()
+
+
+# ---------------------------------------------------------------------------
+# Statistics
+# ---------------------------------------------------------------------------
+
+def percentiles(values, ps=(50, 90, 99)):
+    if not values:
+        return ["-"] * (len(ps) + 1)
+    v = sorted(values)
+    out = ["%.1f" % v[min(len(v) - 1, int(len(v) * p / 100))] for p in ps]
+    return out + ["%.1f" % v[-1]]
+
+
+class Stats:
+    def __init__(self):
+        self.total = {}
+        self.lat_all, self.conn_all, self.cmd_all = [], [], []
+        self.reset_interval()
+
+    def reset_interval(self):
+        self.iv = {}
+        self.lat, self.conn, self.cmd = [], [], []
+        self.iv_start = time.perf_counter()
+
+    def count(self, key, n=1):
+        self.iv[key] = self.iv.get(key, 0) + n
+        self.total[key] = self.total.get(key, 0) + n
+
+    def ack_latency(self, ms):
+        self.lat.append(ms)
+        self.lat_all.append(ms)
+
+    def connect_latency(self, ms):
+        self.conn.append(ms)
+        self.conn_all.append(ms)
+
+    def cmd_latency(self, ms):
+        self.cmd.append(ms)
+        self.cmd_all.append(ms)
+
+    def report(self, active, final=False):
+        c = self.total if final else self.iv
+        secs = max(1e-3, time.perf_counter() - (self.t0 if final else self.iv_start))
+        lat = self.lat_all if final else self.lat
+        conn = self.conn_all if final else self.conn
+        cmd = self.cmd_all if final else self.cmd
+
+        print("%s %6.0fs  awake=%d wakes=%d pub=%d (%.0f/s) acked=%d (%.0f/s) lost=%d errors=%d"
+              % ("TOTAL" if final else "     ", time.perf_counter() - self.t0, active,
+                 c.get("wakes", 0), c.get("published", 0), c.get("published", 0) / secs,
+                 c.get("acked", 0), c.get("acked", 0) / secs,
+                 c.get("ack_timeout", 0), c.get("errors", 0)))
+        print("        puback ms  p50/p90/p99/max  %s" % "/".join(percentiles(lat)))
+        print("        connect ms p50/p90/p99/max  %s" % "/".join(percentiles(conn)))
+        if "delivered" in c:
+            print("        broker delivered %d (%.0f/s), %d bytes"
+                  % (c["delivered"], c["delivered"] / secs, c.get("delivered_bytes", 0)))
+        if cmd or c.get("cmd_sent"):
+            print("        cmd sent=%d answered=%d  rtt ms p50/p90/p99/max %s"
+                  % (c.get("cmd_sent", 0), len(cmd), "/".join(percentiles(cmd))))
+        sys.stdout.flush()
+
+
+# ---------------------------------------------------------------------------
+# Virtual node (one wake cycle = one MQTT session, like the firmware)
+# ---------------------------------------------------------------------------
+
+def _varint(v):
+    out = bytearray()
+    while v >= 0x80:
+        out.append((v & 0x7F) | 0x80)
+        v >>= 7
+    out.append(v)
+    return bytes(out)
+
+
+def _tlv(ftype, value):
+    return bytes([ftype]) + _varint(len(value)) + value
+
+
+class EnergyAccount:
+    """energy_acct.c, simplified: the whole wake counts as RX, sleep as deep"""
+
+    def __init__(self):
+        self.cycles = self.delivered = self.last_uas = 0
+        self.total_nas = [0] * len(ENERGY_UA)
+        self.last_ms = [0] * len(ENERGY_UA)
+
+    def end(self, awake_ms, slept_ms):
+        self.last_ms = [0, awake_ms, 0, 0, slept_ms]
+        nas = [ms * ua for ms, ua in zip(self.last_ms, ENERGY_UA)]     # ms x uA = nAs
+        self.total_nas = [t + n for t, n in zip(self.total_nas, nas)]
+        self.last_uas = sum(nas) // 1000
+        self.cycles += 1
+
+    def mask(self):
+        return sum(1 << i for i in range(len(ENERGY_UA))
+                   if self.last_ms[i] or self.total_nas[i])
+
+    def tlv(self):
+        out = b"".join(_varint(v) for v in (self.cycles, self.delivered,
+                                             sum(self.total_nas) // 3600000,
+                                             self.last_uas, self.mask()))
+        for i in range(len(ENERGY_UA)):
+            if self.mask() & (1 << i):
+                out += _varint(self.last_ms[i]) + _varint(self.total_nas[i] // 3600000)
+        return _tlv(tlv.ENERGY, out)
+
+    def text(self):
+        out = "e_n=%d;e_smp=%d;e_uah=%d;e_cyc_uas=%d;" % (
+            self.cycles, self.delivered, sum(self.total_nas) // 3600000, self.last_uas)
+        for i, name in enumerate(tlv.ENERGY_NAMES):
+            if self.mask() & (1 << i):
+                out += "e_%s=%d/%d;" % (name, self.last_ms[i], self.total_nas[i] // 3600000)
+        return out
+
+
+class VirtualNode:
+    def __init__(self, index, args, stats):
+        mac = bytes([0x02, 0xA1, 0x07]) + index.to_bytes(3, "big")   # locally administered
+        self.node_id = mac.hex().upper()
+        self.client_id = "ESP32_" + mac[3:].hex().upper()            # IDF default client id
+        self.args = args
+        self.stats = stats
+        self.t_status = "aiot/%s/status" % self.node_id
+        self.t_telemetry = "aiot/%s/telemetry" % self.node_id
+        self.t_cmd = "aiot/%s/cmd" % self.node_id
+        self.t_event = "aiot/%s/event" % self.node_id
+        self.first_wake = True
+        self.last_awake_ms = 0
+        self.energy = EnergyAccount()
+        self.conn = None
+        self.pending = []
+        self.sleep_sec = args.interval
+        self.pinned_sec = 0             # sleep=<sec>, kept in RTC memory (sleep_sched_pin)
+        self.ota_requested = False
+        self.reboot_requested = False
+
+    # -- like publish_status_retained() / publish_event() --
+
+    def _publish(self, topic, payload, retain=False):
+        fut = self.conn.publish(topic, payload, qos=1, retain=retain)
+        self.pending.append((time.perf_counter(), fut))
+        self.stats.count("published")
+
+    def status(self, state, extra=""):
+        msg = "state=%s;id=%s;fw=%s" % (state, self.node_id, FW_VERSION)
+        self._publish(self.t_status, msg + (";" + extra if extra else ""), retain=True)
+
+    def event(self, kv):
+        self._publish(self.t_event, kv)
+
+    async def wait_acks(self, timeout_s):
+        """mqtt_ack_wait_all(): PUBACK latency per message, True if all acked."""
+        pending, self.pending = self.pending, []
+        ok = True
+        for sent, fut in pending:
+            left = max(0.0, timeout_s - (time.perf_counter() - sent))
+            try:
+                acked = await asyncio.wait_for(fut, left)
+                self.stats.ack_latency((acked - sent) * 1000.0)
+                self.stats.count("acked")
+            except asyncio.TimeoutError:
+                self.stats.count("ack_timeout")
+                ok = False
+        return ok
+
+    # -- handle_cmd_payload() / mqtt_cmd_dispatch() --
+
+    COMMANDS = {                    # name: (arg type, min, max, error reason)
+        "ping": (None, 0, 0, None),
+        "sleep": (int, 0, 86400, "bad_sleep_range"),
+        "ota": (str, 8, 255, "bad_ota_url"),
+        "reboot": (None, 0, 0, None),
+    }
+
+    def on_message(self, topic, payload):
+        if topic != self.t_cmd:
+            return
+        cmd = payload.decode(errors="replace").strip()
+
+        req = ""
+        head, sep, tail = cmd.rpartition(";")
+        if sep and tail.startswith("req="):
+            if not re.fullmatch(r"[0-9A-Za-z_-]{1,32}", tail[4:]):
+                self.event("event=err;reason=malformed")
+                return
+            cmd, req = head, ";" + tail
+
+        name, eq, arg = cmd.partition("=")
+        if not cmd:
+            self.event("event=err;reason=malformed" + req)
+            return
+        if name not in self.COMMANDS:
+            self.event("event=err;reason=unknown_cmd" + req)
+            return
+
+        kind, lo, hi, reason = self.COMMANDS[name]
+        value = None
+        if kind is None:
+            ok = not eq
+        elif kind is int:
+            ok = eq and re.fullmatch(r"[+-]?[0-9]{1,10}", arg) and lo <= int(arg) <= hi
+            value = int(arg) if ok else None
+        else:
+            ok = eq and lo <= len(arg) <= hi
+        if not ok:
+            self.event("event=err;reason=%s%s" % (reason or "bad_arg", req))
+            return
+
+        if name == "ping":
+            self.event("event=pong" + req)
+        elif name == "sleep":
+            self.pinned_sec = value
+            self.event("event=sleep_set;sec=%d;mode=%s%s"
+                       % (value, "pinned" if value else "auto", req))
+        elif name == "ota":
+            if self.ota_requested:
+                self.event("event=err;reason=ota_busy" + req)
+            else:
+                self.ota_requested = True
+                self.event("event=ota_requested" + req)
+        elif name == "reboot":
+            self.reboot_requested = True
+            self.event("event=reboot_scheduled" + req)
+
+    def telemetry(self, wakeup):
+        if self.args.format == "bin":
+            payload = (bytes([tlv.VERSION])
+                       + _tlv(tlv.NODE_ID, self.node_id.encode())
+                       + _tlv(tlv.FW_VERSION, FW_VERSION.encode())
+                       + _tlv(tlv.WAKE_REASON, _varint(wakeup))
+                       + _tlv(tlv.AWAKE_MS, _varint(self.last_awake_ms))
+                       + self.energy.tlv())
+            self._publish(self.t_telemetry + "/bin", payload)
+        else:
+            reason = "timer" if wakeup == WAKEUP_TIMER else "power_on"
+            self._publish(self.t_telemetry, "id=%s;fw=%s;reason=%s;awake_ms=%d;%s"
+                          % (self.node_id, FW_VERSION, reason, self.last_awake_ms,
+                             self.energy.text()))
+
+    async def simulate_ota(self):
+        """OTA engine events at --ota-kbps for an image of --ota-kb, then reboot."""
+        a = self.args
+        total = a.ota_kb * 1024
+        self.status("ota", "stage=running")
+        t0 = time.perf_counter()
+        done = 0
+        while done < total:
+            await asyncio.sleep(1.0)
+            done = min(total, done + a.ota_kbps * 1024)
+            ms = int((time.perf_counter() - t0) * 1000)
+            self.event("event=ota;stage=download;bytes=%d;total=%d;kbps=%d"
+                       % (done, total, done // max(1, ms)))
+        ms = int((time.perf_counter() - t0) * 1000)
+        self.event("event=ota;stage=done;bytes=%d;total=%d;kbps=%d;ms=%d;download_ms=%d;"
+                   "flash_ms=0;stall_ms=0;rx=%d;image=%d;resumed=0;retries=0;err=ESP_OK"
+                   % (total, total, total // max(1, ms), ms, ms, total, total))
+        self.status("ota", "stage=done")
+        await self.wait_acks(self.args.ack_timeout_ms / 1000.0)
+
+    async def wake_cycle(self):
+        a = self.args
+        t_wake = time.perf_counter()
+        wakeup = WAKEUP_UNDEFINED if self.first_wake else WAKEUP_TIMER
+        slept_ms = 0 if self.first_wake else self.sleep_sec * 1000
+        self.first_wake = False
+        self.sleep_sec = a.interval
+        self.stats.count("wakes")
+
+        # Wi-Fi bring-up is not simulated, only its duration
+        if a.wifi_ms:
+            await asyncio.sleep(random.uniform(0.5, 1.5) * a.wifi_ms / 1000.0)
+
+        self.conn = MqttConn(self.on_message)
+        will = (self.t_status, "state=offline;id=%s;fw=%s" % (self.node_id, FW_VERSION), 1, True)
+        t0 = time.perf_counter()
+        try:
+            await self.conn.connect(a.host, a.port, self.client_id, a.keepalive, will)
+            t_connected = time.perf_counter()
+            self.stats.connect_latency((t_connected - t0) * 1000.0)
+
+            await self.conn.subscribe(self.t_cmd, 0)
+            self.status("online", "stage=connected")
+            self.status("online", "reason=%s" % ("timer" if wakeup == WAKEUP_TIMER else "power_on"))
+            self.telemetry(wakeup)
+
+            if await self.wait_acks(a.ack_timeout_ms / 1000.0):
+                self.energy.delivered += 1
+
+            window_left = a.cmd_window_ms / 1000.0 - (time.perf_counter() - t_connected)
+            if window_left > 0:
+                await asyncio.sleep(window_left)
+
+            if self.ota_requested:           # ota_wait_if_running()
+                self.ota_requested = False
+                await self.simulate_ota()
+                self.first_wake = True
+                return 0
+
+            if self.reboot_requested:        # esp_restart(): no sleep status, fresh boot
+                self.reboot_requested = False
+                self.status("reboot")
+                await self.wait_acks(a.ack_timeout_ms / 1000.0)
+                self.first_wake = True
+                self.sleep_sec = 0
+                return 0
+
+            # the adaptive rules are not simulated: --interval stands for them
+            self.sleep_sec = self.pinned_sec or a.interval
+            self.status("sleep", "next=%d;sched=%s" % (self.sleep_sec,
+                                                       "pinned" if self.pinned_sec else "start"))
+            await self.wait_acks(a.ack_timeout_ms / 1000.0)
+        except (ConnectionError, OSError, asyncio.TimeoutError):
+            self.stats.count("errors")
+        finally:
+            await self.conn.close(clean=(a.sleep_mode == "disconnect"))
+            self.conn = None
+            self.pending = []
+        self.last_awake_ms = int((time.perf_counter() - t_wake) * 1000)
+        self.energy.end(self.last_awake_ms, slept_ms)
+        return self.sleep_sec
+
+    async def run(self, stop, active):
+        await asyncio.sleep(random.uniform(0, self.args.ramp))
+        while not stop.is_set():
+            active[0] += 1
+            try:
+                sleep_sec = await self.wake_cycle()
+            finally:
+                active[0] -= 1
+            try:
+                await asyncio.wait_for(stop.wait(), sleep_sec)
+            except asyncio.TimeoutError:
+                pass
+
+
+# ---------------------------------------------------------------------------
+# Monitor: broker throughput and command round trip (acts like a backend)
+# ---------------------------------------------------------------------------
+
+class Monitor:
+    def __init__(self, args, stats):
+        self.args = args
+        self.stats = stats
+        self.conn = MqttConn(self.on_message)
+        self.cmd_sent = {}          # req id -> perf_counter of the cmd
+        self.next_req = 1
+
+    async def start(self):
+        a = self.args
+        await self.conn.connect(a.host, a.port, "fleet_sim_monitor_%d" % os.getpid(), 60)
+        await self.conn.subscribe("aiot/+/#", 0)
+
+    def on_message(self, topic, payload):
+        self.stats.count("delivered")
+        self.stats.count("delivered_bytes", len(payload))
+
+        parts = topic.split("/")
+        if len(parts) < 3:
+            return
+        node, kind = parts[1], parts[2]
+
+        # like a backend: answer the "online" status with a command
+        if (self.args.cmd and kind == "status" and payload.endswith(b"stage=connected")
+                and random.random() < self.args.cmd_ratio):
+            req = "r%d" % self.next_req
+            self.next_req += 1
+            self.conn.publish("aiot/%s/cmd" % node, "%s;req=%s" % (self.args.cmd, req), qos=0)
+            self.cmd_sent[req] = time.perf_counter()
+            self.stats.count("cmd_sent")
+        elif kind == "event" and b";req=" in payload:
+            req = payload.rpartition(b";req=")[2].decode(errors="replace")
+            if req in self.cmd_sent:
+                self.stats.cmd_latency((time.perf_counter() - self.cmd_sent.pop(req)) * 1000.0)
+
+    async def keepalive(self, stop):
+        while not stop.is_set():
+            try:
+                await asyncio.wait_for(stop.wait(), 30)
+            except asyncio.TimeoutError:
+                self.conn.ping()
+
+
+# ---------------------------------------------------------------------------
+
+async def main_async(args):
+    stats = Stats()
+    stats.t0 = time.perf_counter()
+    stop = asyncio.Event()
+    active = [0]
+
+    tasks = []
+    monitor = None
+    if args.monitor or args.cmd:
+        monitor = Monitor(args, stats)
+        await monitor.start()
+        tasks.append(asyncio.create_task(monitor.keepalive(stop)))
+
+    nodes = [VirtualNode(i, args, stats) for i in range(args.nodes)]
+    tasks += [asyncio.create_task(n.run(stop, active)) for n in nodes]
+    print("%d virtual nodes -> %s:%d, wake every %d s, format=%s, sleep=%s"
+          % (args.nodes, args.host, args.port, args.interval, args.format, args.sleep_mode))
+
+    t_end = time.perf_counter() + args.duration if args.duration else None
+    try:
+        while not t_end or time.perf_counter() < t_end:
+            wait = args.report if not t_end else min(args.report, t_end - time.perf_counter())
+            await asyncio.sleep(max(0.0, wait))
+            stats.report(active[0])
+            stats.reset_interval()
+    finally:
+        stop.set()
+        # let running wake cycles finish (they end with the sleep status)
+        await asyncio.wait(tasks, timeout=args.ack_timeout_ms / 1000.0 + args.cmd_window_ms / 1000.0 + 5)
+        if monitor:
+            await monitor.conn.close(clean=True)
+        stats.report(active[0], final=True)
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--host", default="127.0.0.1")
+    ap.add_argument("--port", type=int, default=1883)
+    ap.add_argument("-n", "--nodes", type=int, default=100)
+    ap.add_argument("--interval", type=int, default=30, help="deep sleep seconds (DEFAULT_SLEEP_SEC)")
+    ap.add_argument("--ramp", type=float, default=None,
+                    help="spread the first wakes over this many seconds (default: interval)")
+    ap.add_argument("--duration", type=float, default=0, help="seconds, 0 = until Ctrl+C")
+    ap.add_argument("--report", type=float, default=10, help="report interval in seconds")
+    ap.add_argument("--format", choices=("bin", "text"), default="bin",
+                    help="telemetry format (TELEMETRY_BINARY)")
+    ap.add_argument("--wifi-ms", type=float, default=0,
+                    help="simulated Wi-Fi bring-up time before MQTT connect (+-50%%)")
+    ap.add_argument("--keepalive", type=int, default=120, help="MQTT keepalive (IDF default 120)")
+    ap.add_argument("--cmd-window-ms", type=int, default=800, help="CMD_WINDOW_MS")
+    ap.add_argument("--ack-timeout-ms", type=int, default=3000, help="MQTT_ACK_TIMEOUT_MS")
+    ap.add_argument("--sleep-mode", choices=("drop", "disconnect"), default="drop",
+                    help="drop = like deep sleep (LWT fires), disconnect = clean MQTT disconnect")
+    ap.add_argument("--monitor", action="store_true",
+                    help="subscribe aiot/+/# and report broker deliveries")
+    ap.add_argument("--cmd", help="command sent to nodes when they come online, e.g. ping")
+    ap.add_argument("--ota-kb", type=int, default=1024, help="simulated OTA image size")
+    ap.add_argument("--ota-kbps", type=int, default=200, help="simulated OTA download speed")
+    ap.add_argument("--cmd-ratio", type=float, default=0.1, help="fraction of wakes that get --cmd")
+    args = ap.parse_args()
+    if args.ramp is None:
+        args.ramp = args.interval
+
+    try:
+        asyncio.run(main_async(args))
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
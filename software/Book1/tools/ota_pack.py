@@ -0,0 +1,325 @@
+#!/usr/bin/env python3
+###############################################################################
+# AIoT Workshop – Band 1
+# Tool: build compressed / delta OTA images (components/aiot_ota/ota_patch.h)
+#
+# Copyright (c) 2026 Friedrich Riedhammer
+#
+# This source code is provided as part of the book "AIoT Workshop – Band 1".
+# Permission is granted to use, modify and compile this code for educational,
+# research and product development purposes.
+#
+# Redistribution as part of other publications or commercial training material
+# requires written permission of the author.
+#
+# The software is provided "as is", without warranty of any kind.
+###############################################################################
+"""
+Build OTA patch files (format version 1) for the OTA engine.
+
+  compressed image:   ./ota_pack.py pack build/AIoT_OTA.bin -o AIoT_OTA.aip
+  delta to a release: ./ota_pack.py pack new.bin --base old.bin -o new.aip
+  apply on the host:  ./ota_pack.py apply new.aip --base old.bin -o check.bin
+  show the header:    ./ota_pack.py info new.aip
+
+"pack" decodes its own output again and compares it with the input before
+writing the file. For a delta, --base must be exactly the .bin that is
+running on the nodes; the node checks its SHA-256 before applying.
+Serve the .aip file instead of the .bin (tools/ota_server.py or
+python3 -m http.server), the engine detects the format by its magic.
+
+host_test/test_ota_patch.c decodes its output with ota_patch.c at every
+chunk size and runs decode() here on the patches the C side mutated.
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+
+MAGIC = b"AIPK"
+VERSION = 1
+HDR = struct.Struct("<4sBBHII32s32s")      # 80 bytes
+FLAG_DELTA = 0x01
+
+WINDOW = 16384                              # OTA_PATCH_WINDOW
+OP_LIT, OP_NEW, OP_OLD, OP_END = 0, 1, 2, 3
+LEN_EXT = 63
+
+MIN_NEW = 4             # a NEW op costs 2..4 bytes
+MIN_OLD = 6             # an OLD op with a far offset costs up to 6 bytes
+MIN_REP = 3             # OLD at the expected offset costs 2 bytes
+OLD_KEY = 8             # k-gram length for the base image index
+NEW_KEY = 4
+
+
+class PatchError(Exception):
+    pass
+
+
+# ---- encoding helpers ----
+
+def varint(v):
+    out = bytearray()
+    while True:
+        b = v & 0x7F
+        v >>= 7
+        if v:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return out
+
+
+def zigzag(v):
+    return (v << 1) if v >= 0 else ((-v << 1) - 1)
+
+
+def op_head(op, length):
+    if length <= LEN_EXT:
+        return bytes([(op << 6) | (length - 1)])
+    return bytes([(op << 6) | LEN_EXT]) + varint(length - 64)
+
+
+def match_len(a, ai, b, bi, maxlen):
+    n = 0
+    while n + 64 <= maxlen and a[ai + n:ai + n + 64] == b[bi + n:bi + n + 64]:
+        n += 64
+    while n < maxlen and a[ai + n] == b[bi + n]:
+        n += 1
+    return n
+
+
+# ---- encoder ----
+
+def encode(new, old=None):
+    """Greedy LZ77 over the new image plus copies from the old one."""
+    out = bytearray()
+    stats = {"lit": 0, "lit_bytes": 0, "new": 0, "new_bytes": 0, "old": 0, "old_bytes": 0}
+    n = len(new)
+
+    old_index = {}
+    if old:
+        for j in range(len(old) - OLD_KEY, -1, -1):     # keep the first occurrence
+            old_index[old[j:j + OLD_KEY]] = j
+    new_index = {}
+
+    old_pos = 0         # decoder state: end of the last OLD copy
+    old_out = 0         # output position where that copy ended
+    lit_start = 0
+    i = 0
+
+    def flush_lit(end):
+        pos = lit_start
+        while pos < end:
+            k = min(end - pos, 1 << 20)
+            out.extend(op_head(OP_LIT, k))
+            out.extend(new[pos:pos + k])
+            stats["lit"] += 1
+            stats["lit_bytes"] += k
+            pos += k
+
+    while i < n:
+        maxl = n - i
+        best, kind, arg = 0, None, 0
+
+        if old:
+            # same layout as before: continue in the old image
+            rep = old_pos + (i - old_out)
+            if 0 <= rep < len(old):
+                l = match_len(old, rep, new, i, min(maxl, len(old) - rep))
+                if l >= MIN_REP:
+                    best, kind, arg = l, OP_OLD, rep
+            j = old_index.get(new[i:i + OLD_KEY]) if maxl >= OLD_KEY else None
+            if j is not None and j != rep:
+                l = match_len(old, j, new, i, min(maxl, len(old) - j))
+                if l >= MIN_OLD and l > best + 2:
+                    best, kind, arg = l, OP_OLD, j
+
+        key = new[i:i + NEW_KEY]
+        j = new_index.get(key) if maxl >= NEW_KEY else None
+        if j is not None and i - j <= WINDOW:
+            l = match_len(new, j, new, i, maxl)
+            if l >= MIN_NEW and l > best:
+                best, kind, arg = l, OP_NEW, i - j
+
+        if kind is None:
+            if maxl >= NEW_KEY:
+                new_index[key] = i
+            i += 1
+            continue
+
+        flush_lit(i)
+        out.extend(op_head(kind, best))
+        if kind == OP_NEW:
+            out.extend(varint(arg))
+            stats["new"] += 1
+            stats["new_bytes"] += best
+        else:
+            out.extend(varint(zigzag(arg - old_pos)))
+            old_pos, old_out = arg + best, i + best
+            stats["old"] += 1
+            stats["old_bytes"] += best
+        for p in range(i, min(i + best, n - NEW_KEY + 1)):
+            new_index[new[p:p + NEW_KEY]] = p
+        i += best
+        lit_start = i
+
+    flush_lit(n)
+    out.append(OP_END << 6)
+
+    flags = FLAG_DELTA if old else 0
+    old_sha = hashlib.sha256(old).digest() if old else bytes(32)
+    hdr = HDR.pack(MAGIC, VERSION, flags, 0, n, len(old) if old else 0,
+                   old_sha, hashlib.sha256(new).digest())
+    return hdr + out, stats
+
+
+# ---- decoder (twin of ota_patch.c) ----
+
+def read_header(data):
+    if len(data) < HDR.size:
+        raise PatchError("short header")
+    magic, ver, flags, _, new_size, old_size, old_sha, new_sha = HDR.unpack_from(data)
+    if magic != MAGIC or ver != VERSION:
+        raise PatchError("not a version %d patch" % VERSION)
+    return {"flags": flags, "new_size": new_size, "old_size": old_size,
+            "old_sha256": old_sha, "new_sha256": new_sha}
+
+
+def decode(data, old=None):
+    hdr = read_header(data)
+    if hdr["flags"] & FLAG_DELTA:
+        if old is None:
+            raise PatchError("delta patch needs --base")
+        if len(old) < hdr["old_size"] or \
+                hashlib.sha256(old[:hdr["old_size"]]).digest() != hdr["old_sha256"]:
+            raise PatchError("base image does not match the patch")
+
+    out = bytearray()
+    pos = HDR.size
+    old_pos = 0
+
+    def get_varint():
+        nonlocal pos
+        v, shift = 0, 0
+        while True:
+            if pos >= len(data):
+                raise PatchError("truncated")
+            b = data[pos]
+            pos += 1
+            if shift > 28 or (shift == 28 and b & 0x70):
+                raise PatchError("varint longer than 32 bits")
+            v |= (b & 0x7F) << shift
+            shift += 7
+            if not b & 0x80:
+                return v
+
+    while True:
+        if pos >= len(data):
+            raise PatchError("truncated, no END")
+        b = data[pos]
+        pos += 1
+        op = b >> 6
+        if op == OP_END:
+            if b != OP_END << 6 or pos != len(data):
+                raise PatchError("bad END")
+            break
+        length = (b & 0x3F) + 1 if (b & 0x3F) != LEN_EXT else 64 + get_varint()
+        if len(out) + length > hdr["new_size"]:
+            raise PatchError("output exceeds new_size")
+        if op == OP_LIT:
+            if pos + length > len(data):
+                raise PatchError("truncated literal")
+            out += data[pos:pos + length]
+            pos += length
+        elif op == OP_NEW:
+            dist = get_varint()
+            if dist == 0 or dist > WINDOW or dist > len(out):
+                raise PatchError("NEW distance out of range")
+            for _ in range(length):                 # may overlap
+                out.append(out[-dist])
+        else:
+            v = get_varint()
+            old_pos += (v >> 1) ^ -(v & 1)
+            if not hdr["flags"] & FLAG_DELTA or old_pos < 0 or \
+                    old_pos + length > hdr["old_size"]:
+                raise PatchError("OLD copy out of range")
+            out += old[old_pos:old_pos + length]
+            old_pos += length
+
+    if len(out) != hdr["new_size"] or hashlib.sha256(out).digest() != hdr["new_sha256"]:
+        raise PatchError("output does not match new_sha256")
+    return bytes(out)
+
+
+# ---- CLI ----
+
+def read_file(path):
+    with open(path, "rb") as f:
+        return f.read()
+
+
+def cmd_pack(a):
+    new = read_file(a.image)
+    old = read_file(a.base) if a.base else None
+    patch, st = encode(new, old)
+    if decode(patch, old) != new:
+        raise PatchError("self check failed")
+    with open(a.output, "wb") as f:
+        f.write(patch)
+    print("%s: %d -> %d bytes (%.1fx, %s)" % (a.output, len(new), len(patch),
+          len(new) / max(1, len(patch)), "delta" if old else "compressed"))
+    print("  LIT %d ops / %d B, NEW %d ops / %d B, OLD %d ops / %d B"
+          % (st["lit"], st["lit_bytes"], st["new"], st["new_bytes"], st["old"], st["old_bytes"]))
+
+
+def cmd_apply(a):
+    out = decode(read_file(a.patch), read_file(a.base) if a.base else None)
+    with open(a.output, "wb") as f:
+        f.write(out)
+    print("%s: %d bytes, sha256 ok" % (a.output, len(out)))
+
+
+def cmd_info(a):
+    data = read_file(a.patch)
+    h = read_header(data)
+    print("version %d, %s, new_size=%d, old_size=%d, patch=%d bytes (%.1fx)"
+          % (VERSION, "delta" if h["flags"] & FLAG_DELTA else "compressed", h["new_size"],
+             h["old_size"], len(data), h["new_size"] / max(1, len(data))))
+    print("old_sha256 %s" % h["old_sha256"].hex())
+    print("new_sha256 %s" % h["new_sha256"].hex())
+
+
+def main():
+    ap = argparse.ArgumentParser(description="compressed / delta OTA images")
+    sub = ap.add_subparsers(dest="cmd", required=True)
+
+    p = sub.add_parser("pack", help="image (+ base) -> patch")
+    p.add_argument("image")
+    p.add_argument("--base", help="running image, makes a delta")
+    p.add_argument("-o", "--output", required=True)
+    p.set_defaults(fn=cmd_pack)
+
+    p = sub.add_parser("apply", help="patch (+ base) -> image")
+    p.add_argument("patch")
+    p.add_argument("--base")
+    p.add_argument("-o", "--output", required=True)
+    p.set_defaults(fn=cmd_apply)
+
+    p = sub.add_parser("info", help="show the patch header")
+    p.add_argument("patch")
+    p.set_defaults(fn=cmd_info)
+
+    a = ap.parse_args()
+    try:
+        a.fn(a)
+    except (PatchError, OSError) as e:
+        print("error: %s" % e, file=sys.stderr)
+        sys.exit(1)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+###############################################################################
+# AIoT Workshop – Band 1
+# Tool: OTA test server with Range support and injected connection drops
+#
+# Copyright (c) 2026 Friedrich Riedhammer
+#
+# This source code is provided as part of the book "AIoT Workshop – Band 1".
+# Permission is granted to use, modify and compile this code for educational,
+# research and product development purposes.
+#
+# Redistribution as part of other publications or commercial training material
+# requires written permission of the author.
+#
+# The software is provided "as is", without warranty of any kind.
+###############################################################################
+"""
+Serve firmware images like `python3 -m http.server`, plus what the resumable
+OTA engine (components/aiot_ota) needs to be tested on a bad link:
+
+  - ETag (SHA-256 prefix of the file), Range / If-Range -> 206 Partial Content
+  - --drop-kb N       close the connection after N KiB of every response
+  - --drop-prob P     or after each 1 KiB block with probability P
+  - --kbps N          throttle (makes drops happen at a realistic pace)
+  - --no-range        ignore Range (engine must start over at byte 0)
+
+At the end (Ctrl-C) and whenever a response reaches the end of an image it
+prints how many body bytes were sent for it, as a multiple of its size:
+1.00x for one clean download, more = data sent twice (or several updates):
+
+  cd build && ../../tools/ota_server.py --port 8000 --drop-kb 300
+  curl -s -o /dev/null -r 1000- http://localhost:8000/AIoT_OTA.bin
+
+host_test/test_ota_engine.c starts it the same way and runs the engine
+against it (reconnects, resume after a reset, changed image, no Range).
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import hashlib
+import os
+import random
+import re
+import sys
+import threading
+import time
+from http.server import SimpleHTTPRequestHandler, ThreadingHTTPServer
+
+BLOCK = 1024
+
+stats_lock = threading.Lock()
+stats = {}          # path -> {"size", "sent", "requests", "drops", "complete"}
+
+
+def etag_of(path):
+    h = hashlib.sha256()
+    with open(path, "rb") as f:
+        for chunk in iter(lambda: f.read(65536), b""):
+            h.update(chunk)
+    return '"%s"' % h.hexdigest()[:16]
+
+
+def parse_range(value, size):
+    """'bytes=<start>-[<end>]' -> (start, end) inclusive, None if unusable."""
+    m = re.fullmatch(r"bytes=(\d+)-(\d*)", value.strip())
+    if not m:
+        return None
+    start = int(m.group(1))
+    end = int(m.group(2)) if m.group(2) else size - 1
+    if start >= size or end < start:
+        return (start, -1)          # not satisfiable
+    return (start, min(end, size - 1))
+
+
+def print_stats(prefix=""):
+    with stats_lock:
+        for path, s in sorted(stats.items()):
+            print("%s%s: size=%d sent=%d (%.2fx) requests=%d drops=%d"
+                  % (prefix, path, s["size"], s["sent"], s["sent"] / max(1, s["size"]),
+                     s["requests"], s["drops"]), flush=True)
+
+
+class OtaHandler(SimpleHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"
+    args = None
+
+    def handle(self):
+        try:
+            super().handle()
+        except (BrokenPipeError, ConnectionResetError):
+            pass                    # the node went away (reset, lost link)
+
+    def log_message(self, fmt, *a):
+        if not self.args.quiet:
+            sys.stderr.write("%s %s\n" % (self.address_string(), fmt % a))
+
+    def do_GET(self):
+        path = self.translate_path(self.path)
+        if not os.path.isfile(path):
+            self.send_error(404)
+            return
+
+        size = os.path.getsize(path)
+        etag = etag_of(path)
+        start, end, status = 0, size - 1, 200
+
+        rng = self.headers.get("Range")
+        if_range = self.headers.get("If-Range")
+        if rng and not self.args.no_range and (if_range is None or if_range == etag):
+            r = parse_range(rng, size)
+            if r and r[1] < 0:
+                self.send_response(416)
+                self.send_header("Content-Range", "bytes */%d" % size)
+                self.send_header("Content-Length", "0")
+                self.end_headers()
+                return
+            if r:
+                start, end, status = r[0], r[1], 206
+
+        length = end - start + 1
+        self.send_response(status)
+        self.send_header("Content-Type", "application/octet-stream")
+        self.send_header("Content-Length", str(length))
+        self.send_header("ETag", etag)
+        self.send_header("Accept-Ranges", "none" if self.args.no_range else "bytes")
+        if status == 206:
+            self.send_header("Content-Range", "bytes %d-%d/%d" % (start, end, size))
+        self.end_headers()
+
+        key = self.path
+        with stats_lock:
+            s = stats.setdefault(key, {"size": size, "sent": 0, "requests": 0, "drops": 0})
+            s["requests"] += 1
+
+        drop_at = self.args.drop_kb * 1024 if self.args.drop_kb else None
+        sent = 0
+        dropped = False
+        with open(path, "rb") as f:
+            f.seek(start)
+            while sent < length:
+                n = min(BLOCK, length - sent)
+                if drop_at is not None and sent + n > drop_at:
+                    n = drop_at - sent
+                    dropped = True
+                elif self.args.drop_prob and random.random() < self.args.drop_prob:
+                    dropped = True
+                if n > 0:
+                    try:
+                        self.wfile.write(f.read(n))
+                    except (BrokenPipeError, ConnectionResetError):
+                        break
+                    sent += n
+                if dropped:
+                    break
+                if self.args.kbps:
+                    time.sleep(n / (self.args.kbps * 1024.0))
+
+        with stats_lock:
+            s["sent"] += sent
+            if dropped:
+                s["drops"] += 1
+
+        if dropped:
+            self.log_message("drop after %d bytes (offset %d)", sent, start + sent)
+            self.close_connection = True
+            self.connection.shutdown(2)     # like a lost link: no more data
+        elif start + sent == size:
+            print_stats("done ")
+
+
+def main():
+    ap = argparse.ArgumentParser(description="OTA test server with Range support and drops")
+    ap.add_argument("--port", type=int, default=8000)
+    ap.add_argument("--bind", default="0.0.0.0")
+    ap.add_argument("--dir", default=".", help="directory with the .bin files")
+    ap.add_argument("--drop-kb", type=int, default=0, help="drop every response after N KiB")
+    ap.add_argument("--drop-prob", type=float, default=0.0,
+                    help="drop probability per 1 KiB block")
+    ap.add_argument("--kbps", type=int, default=0, help="throttle each response (0 = off)")
+    ap.add_argument("--no-range", action="store_true", help="ignore Range requests")
+    ap.add_argument("--seed", type=int, default=None)
+    ap.add_argument("--quiet", action="store_true")
+    args = ap.parse_args()
+
+    random.seed(args.seed)
+    os.chdir(args.dir)
+    OtaHandler.args = args
+    srv = ThreadingHTTPServer((args.bind, args.port), OtaHandler)
+    print("Serving %s on %s:%d (drop-kb=%d drop-prob=%.4f kbps=%d range=%s)"
+          % (os.getcwd(), args.bind, args.port, args.drop_kb, args.drop_prob, args.kbps,
+             "off" if args.no_range else "on"), flush=True)
+    try:
+        srv.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    print_stats()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,253 @@
+#!/usr/bin/env python3
+###############################################################################
+# AIoT Workshop – Band 1
+# Tool: replay a recorded trace through the adaptive sleep scheduler
+#       (components/aiot_sleep/sleep_sched.h)
+#
+# Copyright (c) 2026 Friedrich Riedhammer
+#
+# This source code is provided as part of the book "AIoT Workshop – Band 1".
+# Permission is granted to use, modify and compile this code for educational,
+# research and product development purposes.
+#
+# Redistribution as part of other publications or commercial training material
+# requires written permission of the author.
+#
+# The software is provided "as is", without warranty of any kind.
+###############################################################################
+"""
+Let a virtual node wake through a recorded signal, once with the adaptive
+interval (sleep_sched.h) and once with a fixed one, and compare:
+
+  wakes/h    boots (each costs --awake-ms at --awake-ma)
+  avg uA     deep sleep floor + awake charge
+  err max    worst |signal - last reading| between two wakes, i.e. how
+  err avg    far the node's view lagged behind (time-weighted mean)
+
+Trace formats (one line per point, '#' comments, comma or blank separated):
+
+  value                       one column, --trace-s apart
+  t_s value [batt_mv]         time stamp in seconds, optional battery
+
+  ./sleep_sched_replay.py trace.txt --change 20 --fixed-s 30
+  ./sleep_sched_replay.py trace.txt --verbose       (one line per wake)
+
+The Scheduler class is a twin of sleep_sched.c (same integer arithmetic),
+so --verbose shows the decisions the firmware would take.
+host_test/test_sleep_sched.c writes random traces with the C decisions and
+host_test/sleep_sched_crosscheck.py replays them through Scheduler.
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import bisect
+import sys
+
+START, SIGNAL, RAMP, COST, BATTERY, MIN, MAX, PINNED = range(8)
+LIMIT_NAMES = ["start", "signal", "ramp", "cost", "battery", "min", "max", "pinned"]
+
+U32 = 0xFFFFFFFF
+BATT_STRETCH = 4
+
+
+def sat32(v):
+    return min(v, U32)
+
+
+def ewma(avg, v):
+    return avg + ((v - avg) >> 2) if v >= avg else avg - ((avg - v) >> 2)
+
+
+class Scheduler:
+    """sleep_sched_init() / sleep_sched_update() / sleep_sched_pin()"""
+
+    def __init__(self, a):
+        self.a = a
+        self.min_s = a.min_s or 10
+        self.max_s = max(a.max_s or 900, self.min_s)
+        self.grow_pct = a.grow_pct or 150
+        self.start_s = min(max(a.start_s or self.min_s, self.min_s), self.max_s)
+        self.interval_s = self.start_s
+        self.signal_s = self.pinned_s = 0
+        self.readings = self.last_value = self.t_last_s = 0
+        self.rate_k = self.awake_ms = 0
+        self.limit = START
+
+    def pin(self, sec):
+        self.pinned_s, self.signal_s = sec, 0
+
+    def fold_value(self, now_s, value):
+        if self.readings > 0:
+            dt = now_s - self.t_last_s if now_s > self.t_last_s else self.interval_s
+            r = sat32(abs(value - self.last_value) * 1000 // max(1, dt))
+            self.rate_k = r if self.readings == 1 or r > self.rate_k else ewma(self.rate_k, r)
+        self.last_value, self.t_last_s = value, now_s
+        self.readings += 1
+
+    def update(self, now_s, value=None, awake_ms=0, batt_mv=0):
+        a = self.a
+        t, lim = self.start_s, START
+        if value is not None:
+            self.fold_value(now_s, value)
+        if awake_ms:
+            self.awake_ms = ewma(self.awake_ms, awake_ms) if self.awake_ms else awake_ms
+
+        if a.change and self.readings >= 2:
+            prev = self.signal_s or self.start_s
+            want = sat32(a.change * 1000 // self.rate_k) if self.rate_k else self.max_s
+            cap = sat32(prev * self.grow_pct // 100)
+            if cap <= prev:
+                cap = prev + 1
+            if want > cap and cap < self.max_s:
+                t, lim = cap, RAMP
+            else:
+                t, lim = want, SIGNAL
+            self.signal_s = min(max(t, self.min_s), self.max_s)
+
+        if self.pinned_s:
+            self.interval_s, self.limit = self.pinned_s, PINNED
+            return self.interval_s
+
+        if a.awake_ma and self.awake_ms:
+            t_cost = self.max_s
+            if a.budget_ua > a.sleep_ua:
+                t_cost = sat32(self.awake_ms * a.awake_ma // (a.budget_ua - a.sleep_ua))
+            if t_cost > t:
+                t, lim = t_cost, COST
+
+        if a.batt_ok_mv and batt_mv and batt_mv < a.batt_ok_mv:
+            if batt_mv <= a.batt_low_mv or a.batt_ok_mv <= a.batt_low_mv:
+                t = self.max_s
+            else:
+                span, drop = a.batt_ok_mv - a.batt_low_mv, a.batt_ok_mv - batt_mv
+                t = sat32(t * (span + (BATT_STRETCH - 1) * drop) // span)
+            lim = BATTERY
+
+        if t < self.min_s:
+            t, lim = self.min_s, MIN
+        elif t > self.max_s:
+            t, lim = self.max_s, MAX
+        self.interval_s, self.limit = t, lim
+        return t
+
+
+# ---- trace ----
+
+def load_trace(path, step_s):
+    ts, vs, bs = [], [], []
+    with open(path) as f:
+        for line in f:
+            cols = line.split("#")[0].replace(",", " ").split()
+            if not cols:
+                continue
+            if len(cols) == 1:
+                ts.append(len(ts) * step_s)
+                vs.append(int(float(cols[0])))
+                bs.append(0)
+            else:
+                ts.append(float(cols[0]))
+                vs.append(int(float(cols[1])))
+                bs.append(int(float(cols[2])) if len(cols) > 2 else 0)
+    return ts, vs, bs
+
+
+def at(ts, t):
+    """index of the trace point valid at time t (sample and hold)"""
+    return max(0, bisect.bisect_right(ts, t) - 1)
+
+
+def run(ts, vs, bs, a, interval_fn, verbose=False):
+    t0, t_end = ts[0], ts[-1]
+    t = t0
+    wakes = 0
+    err_max = err_sum = 0.0
+    limits = {}
+    while t <= t_end:
+        i = at(ts, t)
+        seen = vs[i]
+        batt = bs[i] or a.batt_mv
+        sec, lim = interval_fn(int(t - t0), seen, batt)
+        wakes += 1
+        limits[lim] = limits.get(lim, 0) + 1
+        if verbose:
+            print("%10d %8d %6d %8d %s" % (int(t - t0), seen, batt, sec, LIMIT_NAMES[lim]))
+
+        # how far the signal moves away from 'seen' until the next wake
+        t_next = min(t + sec, t_end)
+        j = i
+        while j < len(ts) and ts[j] < t_next:
+            seg = min(ts[j + 1] if j + 1 < len(ts) else t_next, t_next) - max(ts[j], t)
+            e = abs(vs[j] - seen)
+            err_max = max(err_max, e)
+            err_sum += e * max(0.0, seg)
+            j += 1
+        t += sec
+    secs = max(1.0, t_end - t0)
+    awake_mas = wakes * a.awake_ma * a.awake_ms / 1000.0
+    return {"wakes": wakes, "hours": secs / 3600.0, "err_max": err_max,
+            "err_avg": err_sum / secs, "ua": a.sleep_ua + awake_mas / secs * 1000.0,
+            "limits": limits}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("trace", help="recorded trace (see above)")
+    ap.add_argument("--trace-s", type=float, default=1.0, help="spacing of a one-column trace [s]")
+    ap.add_argument("--verbose", action="store_true",
+                    help="print t_s, value, batt_mv, next_s, rule per adaptive wake")
+    ap.add_argument("--fixed-s", type=int, default=30, help="fixed interval to compare with")
+
+    g = ap.add_argument_group("sleep_sched_config_t (0 = default / off)")
+    g.add_argument("--min-s", type=int, default=10)
+    g.add_argument("--max-s", type=int, default=900)
+    g.add_argument("--start-s", type=int, default=30)
+    g.add_argument("--change", type=int, default=20, help="allowed change between wakes")
+    g.add_argument("--grow-pct", type=int, default=150)
+    g.add_argument("--awake-ma", type=int, default=60, help="awake current (energy, cost rule)")
+    g.add_argument("--sleep-ua", type=int, default=10, help="deep sleep floor")
+    g.add_argument("--budget-ua", type=int, default=0, help="cost rule: average current allowed")
+    g.add_argument("--batt-ok-mv", type=int, default=0)
+    g.add_argument("--batt-low-mv", type=int, default=0)
+
+    g = ap.add_argument_group("node")
+    g.add_argument("--awake-ms", type=int, default=250, help="awake time per wake")
+    g.add_argument("--batt-mv", type=int, default=0, help="battery if the trace has none")
+    a = ap.parse_args()
+
+    try:
+        ts, vs, bs = load_trace(a.trace, a.trace_s)
+    except (OSError, ValueError, IndexError) as e:
+        print("error: %s" % e, file=sys.stderr)
+        sys.exit(1)
+    if a.fixed_s < 1:
+        print("error: --fixed-s must be at least 1", file=sys.stderr)
+        sys.exit(1)
+    if len(ts) < 2 or any(t1 < t0 for t0, t1 in zip(ts, ts[1:])):
+        print("error: need at least two points in time order", file=sys.stderr)
+        sys.exit(1)
+
+    # --awake-ma also prices the wakes; the cost rule is on with a budget only
+    sched = Scheduler(argparse.Namespace(**dict(vars(a), awake_ma=a.awake_ma if a.budget_ua else 0)))
+
+    def adaptive(now_s, value, batt):
+        sec = sched.update(now_s, value, a.awake_ms, batt)
+        return sec, sched.limit
+
+    if a.verbose:
+        print("%10s %8s %6s %8s %s" % ("t_s", "value", "batt", "next_s", "rule"))
+    rows = [("adaptive", run(ts, vs, bs, a, adaptive, a.verbose)),
+            ("fixed %ds" % a.fixed_s, run(ts, vs, bs, a, lambda *_: (a.fixed_s, START)))]
+
+    print("trace: %d points, %.1f h" % (len(ts), rows[0][1]["hours"]))
+    print("%-12s %8s %10s %10s %10s" % ("interval", "wakes/h", "avg uA", "err max", "err avg"))
+    for name, r in rows:
+        print("%-12s %8.1f %10.1f %10.0f %10.1f"
+              % (name, r["wakes"] / r["hours"], r["ua"], r["err_max"], r["err_avg"]))
+    print("adaptive rules: %s" % ", ".join("%s=%d" % (LIMIT_NAMES[k], v)
+                                           for k, v in sorted(rows[0][1]["limits"].items())))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,226 @@
+#!/usr/bin/env python3
+###############################################################################
+# AIoT Workshop – Band 1
+# Tool: decoder for the binary telemetry format (components/aiot_mqtt/telem_tlv.h)
+#
+# Copyright (c) 2026 Friedrich Riedhammer
+#
+# This source code is provided as part of the book "AIoT Workshop – Band 1".
+# Permission is granted to use, modify and compile this code for educational,
+# research and product development purposes.
+#
+# Redistribution as part of other publications or commercial training material
+# requires written permission of the author.
+#
+# The software is provided "as is", without warranty of any kind.
+###############################################################################
+"""
+Decode binary telemetry messages (schema version 1).
+
+  as a library:   from telem_decode import decode;  msg = decode(payload)
+  from MQTT:      mosquitto_sub -t 'aiot/+/telemetry/bin' -F %x | ./telem_decode.py
+  from a file:    ./telem_decode.py --file dump.bin
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import json
+import sys
+
+VERSION = 1
+
+NODE_ID, FW_VERSION, WAKE_REASON, AWAKE_MS = 0x01, 0x02, 0x03, 0x04
+ADC_MV, ADC_RAW, IMU = 0x10, 0x11, 0x12
+BATCH = 0x20
+PHASES = 0x30
+ENERGY = 0x31
+
+# phase_id_t in components/aiot_mqtt/include/phase_timing.h
+PHASE_NAMES = ["boot", "adc", "nvs", "wifi_init", "wifi_wait",
+               "mqtt_start", "mqtt_wait", "publish", "sleep"]
+
+# energy_state_t in components/aiot_mqtt/include/energy_acct.h
+ENERGY_NAMES = ["cpu", "rx", "tx", "light", "deep"]
+
+# limits of telem_msg_t in telem_tlv.h: the C decoder rejects anything beyond
+# them, this one does the same so both agree on every message
+STR_MAX = {NODE_ID: 31, FW_VERSION: 15}
+BATCH_MAX = 64          # TELEM_BATCH_CAPACITY
+VALUE_MAX = 0xFFFF      # telem_sample_t.value
+
+UINT_FIELDS = {
+    WAKE_REASON: "wake_reason",
+    AWAKE_MS: "awake_ms",
+    ADC_MV: "adc_mv",
+    ADC_RAW: "adc_raw",
+}
+STR_FIELDS = {NODE_ID: "node_id", FW_VERSION: "fw_version"}
+
+
+class DecodeError(ValueError):
+    pass
+
+
+def _varint(buf, pos, end):
+    value, shift = 0, 0
+    while True:
+        if pos >= end or shift > 28:
+            raise DecodeError("bad varint")
+        b = buf[pos]
+        pos += 1
+        value |= (b & 0x7F) << shift
+        if not b & 0x80:
+            if value > 0xFFFFFFFF:
+                raise DecodeError("varint > 32 bit")
+            return value, pos
+        shift += 7
+
+
+def _unzigzag(v):
+    return (v >> 1) ^ -(v & 1)
+
+
+def fields(buf):
+    """Yield (type, value_bytes) of a message, raise DecodeError if malformed."""
+    if not buf or buf[0] == 0 or buf[0] > VERSION:
+        raise DecodeError("empty or unknown schema version")
+    pos, end = 1, len(buf)
+    while pos < end:
+        ftype = buf[pos]
+        length, pos = _varint(buf, pos + 1, end)
+        if length > end - pos:
+            raise DecodeError("field 0x%02x truncated" % ftype)
+        yield ftype, buf[pos:pos + length]
+        pos += length
+
+
+def _str(ftype, value):
+    if len(value) > STR_MAX[ftype] or 0 in value:
+        raise DecodeError("bad string in field 0x%02x" % ftype)
+    return value.decode("utf-8", "replace")
+
+
+def _uint(value):
+    v, pos = _varint(value, 0, len(value))
+    if pos != len(value):
+        raise DecodeError("trailing bytes")
+    return v
+
+
+def _imu(value):
+    pos, out = 0, []
+    for _ in range(6):
+        v, pos = _varint(value, pos, len(value))
+        out.append(_unzigzag(v))
+    if pos != len(value):
+        raise DecodeError("trailing bytes in imu")
+    return {"accel_mg": out[:3], "gyro_mdps": out[3:]}
+
+
+def _batch(value):
+    end = len(value)
+    now_s, pos = _varint(value, 0, end)
+    dropped, pos = _varint(value, pos, end)
+    n, pos = _varint(value, pos, end)
+    if n > BATCH_MAX:
+        raise DecodeError("batch of %d samples" % n)
+    samples = []
+    for _ in range(n):
+        age, pos = _varint(value, pos, end)
+        word, pos = _varint(value, pos, end)
+        if word >> 1 > VALUE_MAX:
+            raise DecodeError("sample value > 16 bit")
+        samples.append({
+            "t_s": (now_s - age) & 0xFFFFFFFF,
+            "value": word >> 1,
+            "raw": bool(word & 1),
+        })
+    if pos != end:
+        raise DecodeError("trailing bytes in batch")
+    return {"now_s": now_s, "dropped": dropped, "samples": samples}
+
+
+def _phases(value):
+    end = len(value)
+    wakes, pos = _varint(value, 0, end)
+    mask, pos = _varint(value, pos, end)
+    phases = {}
+    for i in range(32):
+        if mask & (1 << i):
+            stat = []
+            for _ in range(3):
+                v, pos = _varint(value, pos, end)
+                stat.append(v)
+            name = PHASE_NAMES[i] if i < len(PHASE_NAMES) else "phase%d" % i
+            phases[name] = dict(zip(("last_us", "avg_us", "max_us"), stat))
+    if pos != end:
+        raise DecodeError("trailing bytes in phases")
+    return {"phase_wakes": wakes, "phases": phases}
+
+
+def _energy(value):
+    end = len(value)
+    head = []
+    pos = 0
+    for _ in range(5):
+        v, pos = _varint(value, pos, end)
+        head.append(v)
+    cycles, delivered, uah, cycle_uas, mask = head
+    states = {}
+    for i in range(32):
+        if mask & (1 << i):
+            ms, pos = _varint(value, pos, end)
+            s_uah, pos = _varint(value, pos, end)
+            name = ENERGY_NAMES[i] if i < len(ENERGY_NAMES) else "state%d" % i
+            states[name] = {"last_ms": ms, "uah": s_uah}
+    if pos != end:
+        raise DecodeError("trailing bytes in energy")
+    out = {"energy_cycles": cycles, "energy_delivered": delivered, "energy_uah": uah,
+           "energy_cycle_uas": cycle_uas, "energy_states": states}
+    if delivered:
+        # the number to compare firmware versions with
+        out["energy_uas_per_sample"] = round(uah * 3600.0 / delivered, 1)
+    return out
+
+
+def decode(buf):
+    """Whole message as a dict, unknown fields are skipped."""
+    msg = {"version": buf[0] if buf else None}
+    for ftype, value in fields(bytes(buf)):
+        if ftype in STR_FIELDS:
+            msg[STR_FIELDS[ftype]] = _str(ftype, value)
+        elif ftype in UINT_FIELDS:
+            msg[UINT_FIELDS[ftype]] = _uint(value)
+        elif ftype == IMU:
+            msg["imu"] = _imu(value)
+        elif ftype == BATCH:
+            msg.update(_batch(value))
+        elif ftype == PHASES:
+            msg.update(_phases(value))
+        elif ftype == ENERGY:
+            msg.update(_energy(value))
+    return msg
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    ap.add_argument("--file", help="one binary message (default: hex lines on stdin)")
+    args = ap.parse_args()
+
+    if args.file:
+        with open(args.file, "rb") as f:
+            messages = [f.read()]
+    else:
+        messages = (bytes.fromhex(line.strip()) for line in sys.stdin if line.strip())
+
+    for buf in messages:
+        try:
+            print(json.dumps(decode(buf)))
+        except DecodeError as e:
+            print("malformed (%d bytes): %s" % (len(buf), e), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
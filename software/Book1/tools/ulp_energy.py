@@ -0,0 +1,270 @@
+#!/usr/bin/env python3
+###############################################################################
+# AIoT Workshop – Band 1
+# Tool: ULP sampler model and energy estimate per hour (components/aiot_sleep)
+#
+# Copyright (c) 2026 Friedrich Riedhammer
+#
+# This source code is provided as part of the book "AIoT Workshop – Band 1".
+# Permission is granted to use, modify and compile this code for educational,
+# research and product development purposes.
+#
+# Redistribution as part of other publications or commercial training material
+# requires written permission of the author.
+#
+# The software is provided "as is", without warranty of any kind.
+###############################################################################
+"""
+Run one ADC signal through three wake designs and estimate the current:
+
+  timer   main CPU boots every --timer-s (the final node today)
+  stub    wake stub reads the ADC, boots on delta / heartbeat (wake_gate.h)
+  ulp     ULP reads every --ulp-s, wakes on threshold / full window
+          (ulp_sampler.h)
+
+The stub and ULP decisions are Python twins of the C headers, so the wake
+counts are the ones the firmware would produce for this signal.
+host_test/test_ulp_sampler.c writes random traces with the C decisions and
+host_test/ulp_sampler_crosscheck.py runs them through UlpSampler.
+
+  synthetic signal:  ./ulp_energy.py --hours 24 --events 2
+  recorded signal:   ./ulp_energy.py --signal adc.txt --signal-s 1
+                     (one raw ADC count per line, --signal-s apart)
+
+The currents and times are order-of-magnitude defaults for an ESP32-S3
+module. Measure your own board; the phase statistics the final node sends
+(t_wifi_wait, t_mqtt_wait, ...) give --boot-ms and --radio-ms.
+
+Only the Python standard library is used.
+"""
+
+import argparse
+import math
+import random
+import sys
+
+# ulp_sampler.h
+WAKE_NONE, WAKE_LOW, WAKE_HIGH, WAKE_NORMAL, WAKE_BATCH = range(5)
+ZONE_NORMAL, ZONE_LOW, ZONE_HIGH = range(3)
+WAKE_NAMES = ["none", "low", "high", "normal", "batch"]
+U32 = 0xFFFFFFFF
+
+
+# ---- twins of the C state machines ----
+
+class UlpSampler:
+    """ulp_sampler_step() / ulp_sampler_reset()"""
+
+    def __init__(self, low, high, hyst, batch):
+        self.low, self.high, self.hyst, self.batch = low, high, hyst, batch
+        self.n = self.min = self.max = self.sum = self.last = 0
+        self.zone = ZONE_NORMAL
+        self.wake = WAKE_NONE
+
+    def zone_of(self, v):
+        if v < self.low:
+            return ZONE_LOW
+        if v > self.high:
+            return ZONE_HIGH
+        if self.zone == ZONE_LOW and v - self.low < self.hyst:
+            return ZONE_LOW
+        if self.zone == ZONE_HIGH and self.high - v < self.hyst:
+            return ZONE_HIGH
+        return ZONE_NORMAL
+
+    def step(self, v):
+        z = self.zone_of(v)
+        if self.n == 0:
+            self.min = self.max = v
+            self.sum = 0
+        self.min, self.max = min(self.min, v), max(self.max, v)
+        self.sum = (self.sum + v) & U32     # 32-bit words on the ULP
+        self.n += 1
+        self.last = v
+
+        reason = WAKE_NONE
+        if z != self.zone:
+            reason = {ZONE_LOW: WAKE_LOW, ZONE_HIGH: WAKE_HIGH}.get(z, WAKE_NORMAL)
+            self.zone = z
+        elif self.batch and self.n >= self.batch:
+            reason = WAKE_BATCH
+        if reason == WAKE_NONE or self.wake != WAKE_NONE:
+            return False
+        self.wake = reason
+        return True
+
+    def reset(self):
+        self.n = self.sum = 0
+        self.wake = WAKE_NONE
+
+
+class WakeGate:
+    """wake_gate_check(); skipped restarts on every boot (wake_stub_arm)"""
+
+    def __init__(self, delta, heartbeat):
+        self.delta, self.heartbeat = delta, heartbeat
+        self.ref = None
+        self.skipped = 0
+
+    def boot(self, raw):
+        if self.ref is not None and abs(raw - self.ref) < self.delta and \
+                not (self.heartbeat and self.skipped + 1 >= self.heartbeat):
+            self.skipped += 1
+            return False
+        self.ref = raw
+        self.skipped = 0
+        return True
+
+
+# ---- signal ----
+
+def synthetic(hours, step_s, events, seed):
+    """Slow drift + noise, 'events' excursions per hour above the high threshold."""
+    rnd = random.Random(seed)
+    n = int(hours * 3600 / step_s)
+    out = []
+    starts = sorted(rnd.uniform(0, hours * 3600) for _ in range(int(events * hours)))
+    for i in range(n):
+        t = i * step_s
+        v = 2000 + 40 * math.sin(2 * math.pi * t / (6 * 3600)) + rnd.uniform(-4, 4)
+        if any(s <= t < s + 60 for s in starts):
+            v = 3850 + rnd.uniform(-20, 20)
+        out.append(int(round(min(4095, max(0, v)))))
+    return out
+
+
+def load_signal(path):
+    with open(path) as f:
+        return [int(float(line)) for line in f if line.strip()]
+
+
+def at(signal, step_s, t):
+    return signal[min(len(signal) - 1, int(t / step_s))]
+
+
+# ---- designs ----
+
+def charge_mas(ma, ms):
+    return ma * ms / 1000.0
+
+
+def run_timer(sig, step_s, secs, a):
+    wakes = int(secs / a.timer_s)
+    radio = wakes // a.batch_every
+    mas = wakes * charge_mas(a.boot_ma, a.boot_ms) + radio * charge_mas(a.radio_ma, a.radio_ms)
+    return {"main boots": wakes, "radio": radio, "ulp runs": 0, "mas": mas,
+            "floor_ua": a.sleep_ua}
+
+
+def run_stub(sig, step_s, secs, a):
+    gate = WakeGate(a.delta, a.heartbeat)
+    wakes = int(secs / a.timer_s)
+    boots = sum(1 for i in range(wakes) if gate.boot(at(sig, step_s, i * a.timer_s)))
+    radio = boots // a.batch_every
+    mas = (wakes * charge_mas(a.stub_ma, a.stub_ms) + boots * charge_mas(a.boot_ma, a.boot_ms)
+           + radio * charge_mas(a.radio_ma, a.radio_ms))
+    return {"main boots": boots, "radio": radio, "ulp runs": 0, "mas": mas,
+            "floor_ua": a.sleep_ua + a.rtc_periph_ua}
+
+
+def run_ulp(sig, step_s, secs, a, reasons):
+    s = UlpSampler(a.low, a.high or U32, a.hyst, a.batch)     # as ulp_monitor_start()
+    runs = int(secs / a.ulp_s)
+    boots = radio = windows = 0
+    for i in range(runs):
+        if s.step(at(sig, step_s, i * a.ulp_s)):
+            reasons[s.wake] = reasons.get(s.wake, 0) + 1
+            boots += 1
+            # alerts are sent at once, window summaries every Nth window
+            if s.wake == WAKE_BATCH:
+                windows += 1
+                radio += windows % max(1, a.ulp_radio_every) == 0
+            else:
+                radio += 1
+            s.reset()               # main CPU collects right away (model)
+    mas = (runs * charge_mas(a.ulp_ma, a.ulp_run_us / 1000.0)
+           + boots * charge_mas(a.boot_ma, a.boot_ms) + radio * charge_mas(a.radio_ma, a.radio_ms))
+    return {"main boots": boots, "radio": radio, "ulp runs": runs, "mas": mas,
+            "floor_ua": a.sleep_ua + a.rtc_periph_ua}
+
+
+def main():
+    ap = argparse.ArgumentParser(description=__doc__,
+                                 formatter_class=argparse.RawDescriptionHelpFormatter)
+    g = ap.add_argument_group("signal")
+    g.add_argument("--signal", help="file with one raw ADC count per line")
+    g.add_argument("--signal-s", type=float, default=1.0, help="spacing of --signal [s]")
+    g.add_argument("--hours", type=float, default=24.0, help="synthetic length")
+    g.add_argument("--events", type=float, default=2.0, help="synthetic excursions per hour")
+    g.add_argument("--seed", type=int, default=1)
+
+    g = ap.add_argument_group("designs (firmware defaults)")
+    g.add_argument("--timer-s", type=float, default=30.0, help="SLEEP_TIME_SEC")
+    g.add_argument("--batch-every", type=int, default=10, help="BATCH_EVERY_N_WAKES")
+    g.add_argument("--delta", type=int, default=25, help="WAKE_STUB_DELTA_RAW")
+    g.add_argument("--heartbeat", type=int, default=10, help="WAKE_STUB_HEARTBEAT")
+    g.add_argument("--ulp-s", type=float, default=1.0, help="ULP period")
+    g.add_argument("--batch", type=int, default=300,
+                   help="ULP window, 0 = no batch wake (ULP_MONITOR_BATCH_OFF)")
+    g.add_argument("--low", type=int, default=400, help="0 = no lower threshold")
+    g.add_argument("--high", type=int, default=3700, help="0 = no upper threshold")
+    g.add_argument("--hyst", type=int, default=50)
+    g.add_argument("--ulp-radio-every", type=int, default=1,
+                   help="window summaries per publish (alerts: always)")
+
+    g = ap.add_argument_group("energy (measure your board)")
+    g.add_argument("--sleep-ua", type=float, default=10.0, help="deep sleep floor")
+    g.add_argument("--rtc-periph-ua", type=float, default=5.0,
+                   help="extra floor with the RTC peripherals on (stub, ULP)")
+    g.add_argument("--boot-ms", type=float, default=250.0, help="reset -> sample -> sleep")
+    g.add_argument("--boot-ma", type=float, default=35.0)
+    g.add_argument("--radio-ms", type=float, default=1500.0, help="Wi-Fi + MQTT + publish")
+    g.add_argument("--radio-ma", type=float, default=100.0)
+    g.add_argument("--stub-ms", type=float, default=2.0, help="ROM + wake stub")
+    g.add_argument("--stub-ma", type=float, default=15.0)
+    g.add_argument("--ulp-run-us", type=float, default=400.0, help="one ULP reading")
+    g.add_argument("--ulp-ma", type=float, default=1.5)
+    g.add_argument("--battery-mah", type=float, default=2000.0)
+    a = ap.parse_args()
+    if not (a.batch or a.low or a.high):
+        print("error: no threshold and no batch, the ULP would never wake the CPU",
+              file=sys.stderr)
+        sys.exit(1)
+
+    if a.signal:
+        try:
+            sig = load_signal(a.signal)
+        except (OSError, ValueError) as e:
+            print("error: %s" % e, file=sys.stderr)
+            sys.exit(1)
+        step_s = a.signal_s
+    else:
+        step_s = min(a.ulp_s, a.timer_s)
+        sig = synthetic(a.hours, step_s, a.events, a.seed)
+    if not sig:
+        print("error: empty signal", file=sys.stderr)
+        sys.exit(1)
+    secs = len(sig) * step_s
+    hours = secs / 3600.0
+
+    reasons = {}
+    rows = [("timer", run_timer(sig, step_s, secs, a)),
+            ("stub", run_stub(sig, step_s, secs, a)),
+            ("ulp", run_ulp(sig, step_s, secs, a, reasons))]
+
+    print("signal: %d readings, %.1f h" % (len(sig), hours))
+    print("%-6s %10s %8s %10s %10s %10s %10s" % ("design", "boots/h", "radio/h", "ulp/h",
+                                                 "avg uA", "mAh/h", "days"))
+    base = None
+    for name, r in rows:
+        ua = r["floor_ua"] + r["mas"] / secs * 1000.0
+        base = base or ua
+        print("%-6s %10.1f %8.1f %10.0f %10.1f %10.4f %10.0f   %.2fx"
+              % (name, r["main boots"] / hours, r["radio"] / hours, r["ulp runs"] / hours,
+                 ua, ua / 1000.0, a.battery_mah / (ua / 1000.0) / 24.0, base / ua))
+    print("ulp wakes: %s" % ", ".join("%s=%d" % (WAKE_NAMES[k], v)
+                                      for k, v in sorted(reasons.items())))
+
+
+if __name__ == "__main__":
+    main()